@@ -0,0 +1,300 @@
+/*
+ * main.c
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "nxdt_utils.h"
+#include "gamecard.h"
+#include "aes.h"
+
+/* Amount of data processed per timed iteration. */
+#define BENCH_BLOCK_SIZE            0x800000    /* 8 MiB. */
+
+/* Number of timed iterations per kernel. Percentiles use the nearest-rank method over this sample set. */
+#define BENCH_ITERATIONS            32
+
+/* Number of untimed iterations run before the timed ones, letting caches and branch predictors settle. */
+#define BENCH_WARMUP_ITERATIONS     2
+
+/* Matches NCA_AES_XTS_SECTOR_SIZE - the sector size used on every NCA header crypto operation. */
+#define BENCH_XTS_SECTOR_SIZE       0x200
+
+bool g_borealisInitialized = false;
+
+static PadState g_padState = {0};
+
+/* Per-iteration wall clock times for the kernel being measured, in nanoseconds. */
+static u64 g_benchSamples[BENCH_ITERATIONS] = {0};
+
+static void utilsScanPads(void)
+{
+    padUpdate(&g_padState);
+}
+
+static u64 utilsGetButtonsDown(void)
+{
+    return padGetButtonsDown(&g_padState);
+}
+
+static void utilsWaitForButtonPress(u64 flag)
+{
+    /* Don't consider stick movement as button inputs. */
+    if (!flag) flag = ~(HidNpadButton_StickLLeft | HidNpadButton_StickLRight | HidNpadButton_StickLUp | HidNpadButton_StickLDown | HidNpadButton_StickRLeft | HidNpadButton_StickRRight | \
+                        HidNpadButton_StickRUp | HidNpadButton_StickRDown);
+
+    while(appletMainLoop())
+    {
+        utilsScanPads();
+        if (utilsGetButtonsDown() & flag) break;
+    }
+}
+
+static void consolePrint(const char *text, ...)
+{
+    va_list v;
+    va_start(v, text);
+    vfprintf(stdout, text, v);
+    va_end(v);
+    consoleUpdate(NULL);
+}
+
+static int benchSampleSortFunc(const void *a, const void *b)
+{
+    u64 sample_1 = *((const u64*)a), sample_2 = *((const u64*)b);
+    return (sample_1 > sample_2 ? 1 : (sample_1 < sample_2 ? -1 : 0));
+}
+
+static double benchCalculateSpeed(u64 elapsed_ns)
+{
+    return (elapsed_ns ? (((double)BENCH_BLOCK_SIZE / (double)0x100000) / ((double)elapsed_ns / 1000000000.0)) : 0);
+}
+
+static void benchReportResults(const char *name)
+{
+    /* Sort per-iteration times in ascending order. The pN figures represent the throughput sustained by the Nth-percentile slowest iteration. */
+    qsort(g_benchSamples, BENCH_ITERATIONS, sizeof(u64), &benchSampleSortFunc);
+
+    u32 p99_idx = ((BENCH_ITERATIONS * 99) / 100);
+    if (p99_idx >= BENCH_ITERATIONS) p99_idx = (BENCH_ITERATIONS - 1);
+
+    double best = benchCalculateSpeed(g_benchSamples[0]);
+    double p50 = benchCalculateSpeed(g_benchSamples[(BENCH_ITERATIONS * 50) / 100]);
+    double p90 = benchCalculateSpeed(g_benchSamples[(BENCH_ITERATIONS * 90) / 100]);
+    double p99 = benchCalculateSpeed(g_benchSamples[p99_idx]);
+    double worst = benchCalculateSpeed(g_benchSamples[BENCH_ITERATIONS - 1]);
+
+    consolePrint("%s: p50 %.2lf | p90 %.2lf | p99 %.2lf | worst %.2lf MiB/s\n", name, p50, p90, p99, worst);
+
+    LOG_MSG_INFO("%s: p50 %.2lf MiB/s, p90 %.2lf MiB/s, p99 %.2lf MiB/s, best %.2lf MiB/s, worst %.2lf MiB/s (%u iterations, 0x%X bytes each).", name, p50, p90, p99, best, worst, \
+                 BENCH_ITERATIONS, BENCH_BLOCK_SIZE);
+}
+
+static void benchAes128XtsNintendoCrypt(u8 *dst, const u8 *src, bool encrypt)
+{
+    Aes128XtsContext aes_ctx = {0};
+    u8 crypt_key[AES_128_KEY_SIZE] = {0}, tweak_key[AES_128_KEY_SIZE] = {0};
+
+    /* The actual key values are irrelevant for throughput. */
+    randomGet(crypt_key, sizeof(crypt_key));
+    randomGet(tweak_key, sizeof(tweak_key));
+
+    aes128XtsContextCreate(&aes_ctx, crypt_key, tweak_key, encrypt);
+
+    for(u32 i = 0; i < (BENCH_WARMUP_ITERATIONS + BENCH_ITERATIONS); i++)
+    {
+        u64 start_tick = armGetSystemTick();
+
+        if (aes128XtsNintendoCrypt(&aes_ctx, dst, src, BENCH_BLOCK_SIZE, 0, BENCH_XTS_SECTOR_SIZE, encrypt) != BENCH_BLOCK_SIZE)
+        {
+            consolePrint("aes-128-xts %s: failed!\n", encrypt ? "encrypt" : "decrypt");
+            return;
+        }
+
+        if (i >= BENCH_WARMUP_ITERATIONS) g_benchSamples[i - BENCH_WARMUP_ITERATIONS] = armTicksToNs(armGetSystemTick() - start_tick);
+    }
+
+    benchReportResults(encrypt ? "aes-128-xts encrypt" : "aes-128-xts decrypt");
+}
+
+static void benchSha256ContextUpdate(const u8 *src)
+{
+    for(u32 i = 0; i < (BENCH_WARMUP_ITERATIONS + BENCH_ITERATIONS); i++)
+    {
+        Sha256Context sha256_ctx = {0};
+        sha256ContextCreate(&sha256_ctx);
+
+        u64 start_tick = armGetSystemTick();
+        sha256ContextUpdate(&sha256_ctx, src, BENCH_BLOCK_SIZE);
+        if (i >= BENCH_WARMUP_ITERATIONS) g_benchSamples[i - BENCH_WARMUP_ITERATIONS] = armTicksToNs(armGetSystemTick() - start_tick);
+    }
+
+    benchReportResults("sha-256 update");
+}
+
+static void benchSha3ContextUpdate(const u8 *src)
+{
+    for(u32 i = 0; i < (BENCH_WARMUP_ITERATIONS + BENCH_ITERATIONS); i++)
+    {
+        Sha3Context sha3_ctx = {0};
+        sha3256ContextCreate(&sha3_ctx);
+
+        u64 start_tick = armGetSystemTick();
+        sha3ContextUpdate(&sha3_ctx, src, BENCH_BLOCK_SIZE);
+        if (i >= BENCH_WARMUP_ITERATIONS) g_benchSamples[i - BENCH_WARMUP_ITERATIONS] = armTicksToNs(armGetSystemTick() - start_tick);
+    }
+
+    benchReportResults("sha3-256 update");
+}
+
+static void benchLz4DecompressSafe(u8 *dst, const u8 *src, u8 *comp_buf, int comp_capacity)
+{
+    /* Compress the input buffer once. Decompression throughput is measured against the decompressed size, matching how the NCA compressed storage layer reads data. */
+    int comp_size = LZ4_compress_default((const char*)src, (char*)comp_buf, BENCH_BLOCK_SIZE, comp_capacity);
+    if (comp_size <= 0)
+    {
+        consolePrint("lz4 decompress: compression step failed!\n");
+        return;
+    }
+
+    for(u32 i = 0; i < (BENCH_WARMUP_ITERATIONS + BENCH_ITERATIONS); i++)
+    {
+        u64 start_tick = armGetSystemTick();
+
+        if (LZ4_decompress_safe((const char*)comp_buf, (char*)dst, comp_size, BENCH_BLOCK_SIZE) != BENCH_BLOCK_SIZE)
+        {
+            consolePrint("lz4 decompress: failed!\n");
+            return;
+        }
+
+        if (i >= BENCH_WARMUP_ITERATIONS) g_benchSamples[i - BENCH_WARMUP_ITERATIONS] = armTicksToNs(armGetSystemTick() - start_tick);
+    }
+
+    LOG_MSG_INFO("lz4 decompress: 0x%X input bytes compressed down to 0x%X bytes.", BENCH_BLOCK_SIZE, comp_size);
+
+    benchReportResults("lz4 decompress");
+}
+
+static void benchGameCardReadStorage(u8 *dst)
+{
+    u64 gc_size = 0;
+
+    if (gamecardGetStatus() != GameCardStatus_InsertedAndInfoLoaded || !gamecardGetTotalSize(&gc_size) || gc_size < BENCH_BLOCK_SIZE)
+    {
+        consolePrint("gamecard read: skipped (no gamecard available)\n");
+        LOG_MSG_INFO("gamecard read: skipped - no gamecard available.");
+        return;
+    }
+
+    u64 offset = 0;
+
+    for(u32 i = 0; i < (BENCH_WARMUP_ITERATIONS + BENCH_ITERATIONS); i++)
+    {
+        /* Wrap around instead of reading past the gamecard storage area. */
+        if ((offset + BENCH_BLOCK_SIZE) > gc_size) offset = 0;
+
+        u64 start_tick = armGetSystemTick();
+
+        if (!gamecardReadStorage(dst, BENCH_BLOCK_SIZE, offset))
+        {
+            consolePrint("gamecard read: failed at offset 0x%lX!\n", offset);
+            return;
+        }
+
+        if (i >= BENCH_WARMUP_ITERATIONS) g_benchSamples[i - BENCH_WARMUP_ITERATIONS] = armTicksToNs(armGetSystemTick() - start_tick);
+
+        offset += BENCH_BLOCK_SIZE;
+    }
+
+    benchReportResults("gamecard read");
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+
+    u8 *src = NULL, *dst = NULL, *comp_buf = NULL;
+    int comp_capacity = 0;
+
+    if (!utilsInitializeResources(argc, (const char**)argv))
+    {
+        ret = -1;
+        goto out;
+    }
+
+    /* Configure input. */
+    /* Up to 8 different, full controller inputs. */
+    /* Individual Joy-Cons not supported. */
+    padConfigureInput(8, HidNpadStyleSet_NpadFullCtrl);
+    padInitializeWithMask(&g_padState, 0x1000000FFUL);
+
+    consoleInit(NULL);
+
+    consolePrint("crypto / i/o microbenchmark suite\nblock size: 0x%X | timed iterations per kernel: %u\n\n", BENCH_BLOCK_SIZE, BENCH_ITERATIONS);
+
+    /* Allocate benchmark buffers. */
+    comp_capacity = LZ4_compressBound(BENCH_BLOCK_SIZE);
+
+    src = malloc(BENCH_BLOCK_SIZE);
+    dst = malloc(BENCH_BLOCK_SIZE);
+    comp_buf = malloc(comp_capacity);
+
+    if (!src || !dst || !comp_buf)
+    {
+        consolePrint("failed to allocate benchmark buffers!\n");
+        ret = -2;
+        goto out2;
+    }
+
+    /* Generate semi-compressible input data (roughly 2:1), so the LZ4 kernel sees a realistic mix of literals and matches. */
+    /* The crypto and hash kernels are content-independent, so they share the same input buffer. */
+    for(u64 offset = 0; offset < BENCH_BLOCK_SIZE; offset += 0x100)
+    {
+        randomGet(src + offset, 0x80);
+        memset(src + offset + 0x80, 0xAA, 0x80);
+    }
+
+    /* Run benchmark kernels. Each one writes its results to both the console and the logfile. */
+    benchAes128XtsNintendoCrypt(dst, src, true);
+    benchAes128XtsNintendoCrypt(dst, src, false);
+    benchSha256ContextUpdate(src);
+    benchSha3ContextUpdate(src);
+    benchLz4DecompressSafe(dst, src, comp_buf, comp_capacity);
+    benchGameCardReadStorage(dst);
+
+    /* bktrReadStorage() isn't benchmarked on its own: it requires a fully initialized NCA FS section context from an installed title, and its hot path is */
+    /* dominated by the AES, LZ4 and storage backend kernels measured above. */
+    consolePrint("bktr read: skipped (covered by the aes / lz4 / gamecard kernels)\n");
+
+    consolePrint("\nbenchmark suite completed - results have also been written to the logfile\n");
+    consolePrint("press any button to exit\n");
+
+    utilsWaitForButtonPress(0);
+
+out2:
+    if (comp_buf) free(comp_buf);
+    if (dst) free(dst);
+    if (src) free(src);
+
+out:
+    utilsCloseResources();
+
+    consoleExit(NULL);
+
+    return ret;
+}
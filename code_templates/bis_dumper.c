@@ -0,0 +1,620 @@
+/*
+ * main.c
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "nxdt_utils.h"
+#include "usb.h"
+
+#define BLOCK_SIZE      0x800000
+#define VBR_SIZE        0x200
+
+// fat32 volume boot record offsets used to derive the cluster layout
+#define BPB_BYTS_PER_SEC    0x0B
+#define BPB_SEC_PER_CLUS    0x0D
+#define BPB_RSVD_SEC_CNT    0x0E
+#define BPB_NUM_FATS        0x10
+#define BPB_ROOT_ENT_CNT    0x11
+#define BPB_TOT_SEC_16      0x13
+#define BPB_FAT_SZ_16       0x16
+#define BPB_TOT_SEC_32      0x20
+#define BPB_FAT_SZ_32       0x24
+#define VBR_SIGNATURE       0xAA55
+
+// minimum cluster count for a volume to qualify as fat32
+#define FAT32_MIN_CLUSTER_COUNT 65525
+
+bool g_borealisInitialized = false;
+
+static PadState g_padState = {0};
+
+typedef struct
+{
+    u8 partition_id;    ///< FsBisPartitionId.
+    const char *name;   ///< Output file name prefix.
+    bool shared;        ///< Set to true if the partition storage is already held open by the application.
+} BisPartitionEntry;
+
+typedef struct
+{
+    u64 cluster_size;       ///< Cluster size, in bytes.
+    u64 data_area_offset;   ///< Offset to the first data cluster within the partition, in bytes.
+    u32 cluster_count;      ///< Total data cluster count.
+    u32 free_cluster_count; ///< Free data cluster count.
+    u8 *free_bitmap;        ///< One bit per data cluster. Set bits represent free clusters.
+} BisFatLayout;
+
+static const BisPartitionEntry g_bisPartitions[] = {
+    { FsBisPartitionId_CalibrationFile, "PRODINFOF", false },
+    { FsBisPartitionId_SafeMode,        "SAFE",      false },
+    { FsBisPartitionId_System,          "SYSTEM",    true },
+    { FsBisPartitionId_User,            "USER",      false }
+};
+
+static const u32 g_bisPartitionsCount = MAX_ELEMENTS(g_bisPartitions);
+
+static void utilsScanPads(void)
+{
+    padUpdate(&g_padState);
+}
+
+static u64 utilsGetButtonsDown(void)
+{
+    return padGetButtonsDown(&g_padState);
+}
+
+static u64 utilsGetButtonsHeld(void)
+{
+    return padGetButtons(&g_padState);
+}
+
+static void utilsWaitForButtonPress(u64 flag)
+{
+    /* Don't consider stick movement as button inputs. */
+    if (!flag) flag = ~(HidNpadButton_StickLLeft | HidNpadButton_StickLRight | HidNpadButton_StickLUp | HidNpadButton_StickLDown | HidNpadButton_StickRLeft | HidNpadButton_StickRRight | \
+                        HidNpadButton_StickRUp | HidNpadButton_StickRDown);
+
+    while(appletMainLoop())
+    {
+        utilsScanPads();
+        if (utilsGetButtonsDown() & flag) break;
+    }
+}
+
+static void consolePrint(const char *text, ...)
+{
+    va_list v;
+    va_start(v, text);
+    vfprintf(stdout, text, v);
+    va_end(v);
+    consoleUpdate(NULL);
+}
+
+NX_INLINE u16 bisReadLe16(const u8 *buf, u64 offset)
+{
+    return (u16)(buf[offset] | ((u16)buf[offset + 1] << 8));
+}
+
+NX_INLINE u32 bisReadLe32(const u8 *buf, u64 offset)
+{
+    return (u32)(buf[offset] | ((u32)buf[offset + 1] << 8) | ((u32)buf[offset + 2] << 16) | ((u32)buf[offset + 3] << 24));
+}
+
+static void bisFreeFatLayout(BisFatLayout *layout)
+{
+    if (!layout) return;
+    if (layout->free_bitmap) free(layout->free_bitmap);
+    memset(layout, 0, sizeof(BisFatLayout));
+}
+
+/* Parses the FAT32 volume boot record from the provided BIS partition storage and builds a free cluster bitmap out of the first FAT. */
+/* Only FAT32 volumes are supported - the partitions we care about size-wise (SYSTEM, USER) are always FAT32. Returns false for anything else. */
+static bool bisParseFat32Layout(FsStorage *storage, u64 partition_size, BisFatLayout *out)
+{
+    Result rc = 0;
+    u8 vbr[VBR_SIZE] = {0};
+    u8 *fat_buf = NULL;
+    bool success = false;
+
+    if (!storage || !partition_size || !out) return false;
+
+    memset(out, 0, sizeof(BisFatLayout));
+
+    /* Read volume boot record. */
+    rc = fsStorageRead(storage, 0, vbr, sizeof(vbr));
+    if (R_FAILED(rc))
+    {
+        consolePrint("failed to read volume boot record! (0x%X)\n", rc);
+        return false;
+    }
+
+    /* Parse BPB fields. */
+    u16 byts_per_sec = bisReadLe16(vbr, BPB_BYTS_PER_SEC);
+    u8 sec_per_clus = vbr[BPB_SEC_PER_CLUS];
+    u16 rsvd_sec_cnt = bisReadLe16(vbr, BPB_RSVD_SEC_CNT);
+    u8 num_fats = vbr[BPB_NUM_FATS];
+    u16 root_ent_cnt = bisReadLe16(vbr, BPB_ROOT_ENT_CNT);
+    u16 tot_sec_16 = bisReadLe16(vbr, BPB_TOT_SEC_16);
+    u16 fat_sz_16 = bisReadLe16(vbr, BPB_FAT_SZ_16);
+    u32 tot_sec_32 = bisReadLe32(vbr, BPB_TOT_SEC_32);
+    u32 fat_sz_32 = bisReadLe32(vbr, BPB_FAT_SZ_32);
+
+    /* Validate the layout. Anything that doesn't look like a healthy FAT32 volume makes the caller fall back to a raw dump. */
+    if (bisReadLe16(vbr, VBR_SIZE - 2) != VBR_SIGNATURE || byts_per_sec < 0x200 || (byts_per_sec & (byts_per_sec - 1)) != 0 || !sec_per_clus || !rsvd_sec_cnt || !num_fats || \
+        root_ent_cnt != 0 || tot_sec_16 != 0 || fat_sz_16 != 0 || !fat_sz_32 || !tot_sec_32 || ((u64)tot_sec_32 * byts_per_sec) > partition_size) return false;
+
+    u64 data_start_sec = ((u64)rsvd_sec_cnt + ((u64)num_fats * fat_sz_32));
+    if (data_start_sec >= tot_sec_32) return false;
+
+    u32 cluster_count = (u32)((tot_sec_32 - data_start_sec) / sec_per_clus);
+    if (cluster_count < FAT32_MIN_CLUSTER_COUNT) return false;
+
+    /* Allocate free cluster bitmap. */
+    out->free_bitmap = calloc((cluster_count + 7) / 8, sizeof(u8));
+    if (!out->free_bitmap)
+    {
+        consolePrint("failed to allocate free cluster bitmap!\n");
+        return false;
+    }
+
+    out->cluster_size = ((u64)sec_per_clus * byts_per_sec);
+    out->data_area_offset = (data_start_sec * byts_per_sec);
+    out->cluster_count = cluster_count;
+
+    /* Stream the first FAT and flag free clusters. Entry values are masked to 28 bits - the top nibble is reserved. */
+    u64 fat_offset = ((u64)rsvd_sec_cnt * byts_per_sec);
+    u64 fat_size = (((u64)cluster_count + 2) * sizeof(u32));    /* Entries 0 and 1 are reserved. */
+
+    fat_buf = malloc(BLOCK_SIZE);
+    if (!fat_buf)
+    {
+        consolePrint("failed to allocate FAT read buffer!\n");
+        goto end;
+    }
+
+    for(u64 cur_offset = 0; cur_offset < fat_size; cur_offset += BLOCK_SIZE)
+    {
+        u64 read_size = ((fat_size - cur_offset) > BLOCK_SIZE ? BLOCK_SIZE : (fat_size - cur_offset));
+
+        rc = fsStorageRead(storage, fat_offset + cur_offset, fat_buf, read_size);
+        if (R_FAILED(rc))
+        {
+            consolePrint("failed to read FAT data! (0x%X)\n", rc);
+            goto end;
+        }
+
+        for(u64 i = 0; i < (read_size / sizeof(u32)); i++)
+        {
+            u64 entry_idx = ((cur_offset / sizeof(u32)) + i);
+            if (entry_idx < 2) continue;
+
+            u32 cluster_idx = (u32)(entry_idx - 2);
+            if (cluster_idx >= cluster_count) break;
+
+            if ((bisReadLe32(fat_buf, i * sizeof(u32)) & 0x0FFFFFFF) == 0)
+            {
+                out->free_bitmap[cluster_idx / 8] |= (u8)(1 << (cluster_idx % 8));
+                out->free_cluster_count++;
+            }
+        }
+    }
+
+    success = true;
+
+end:
+    if (fat_buf) free(fat_buf);
+
+    if (!success) bisFreeFatLayout(out);
+
+    return success;
+}
+
+/* Returns the length of the run starting at the provided partition offset, capped to 'size', and whether it covers free clusters only. */
+/* Everything outside the data cluster area (reserved sectors, FATs, trailing sectors) is treated as allocated. */
+static u64 bisGetRunLength(const BisFatLayout *layout, u64 offset, u64 size, bool *out_free)
+{
+    *out_free = false;
+
+    if (!layout || !layout->free_bitmap)
+    {
+        /* No FAT layout available - the whole partition is a single allocated run. */
+        return size;
+    }
+
+    if (offset < layout->data_area_offset)
+    {
+        u64 run = (layout->data_area_offset - offset);
+        return (run > size ? size : run);
+    }
+
+    u64 cluster_idx = ((offset - layout->data_area_offset) / layout->cluster_size);
+    if (cluster_idx >= layout->cluster_count) return size;
+
+    bool is_free = (layout->free_bitmap[cluster_idx / 8] & (u8)(1 << (cluster_idx % 8)));
+    u64 run_end = (layout->data_area_offset + ((cluster_idx + 1) * layout->cluster_size));
+
+    /* Extend the run across consecutive clusters with the same allocation state. */
+    for(u64 i = (cluster_idx + 1); i < layout->cluster_count && (run_end - offset) < size; i++)
+    {
+        bool cur_free = (layout->free_bitmap[i / 8] & (u8)(1 << (i % 8)));
+        if (cur_free != is_free) break;
+        run_end += layout->cluster_size;
+    }
+
+    u64 run = (run_end - offset);
+
+    *out_free = is_free;
+
+    return (run > size ? size : run);
+}
+
+static bool dumpBisPartition(const BisPartitionEntry *partition, bool skip_free_clusters, bool use_usb)
+{
+    Result rc = 0;
+    FsStorage local_storage = {0}, *storage = NULL;
+    s64 storage_size = 0;
+    u64 partition_size = 0, free_space = 0, data_written = 0, skipped_size = 0;
+    BisFatLayout fat_layout = {0};
+    u8 *buf = NULL;
+    char path[64] = {0};
+    FILE *fp = NULL;
+    bool success = false, usb_transfer_started = false;
+
+    /* Open BIS partition storage. The SYSTEM partition storage is already held open by the application for the FatFs-backed log/datfile accessors, so it's reused here. */
+    if (partition->shared)
+    {
+        storage = utilsGetEmmcBisSystemPartitionStorage();
+    } else {
+        rc = fsOpenBisStorage(&local_storage, partition->partition_id);
+        if (R_FAILED(rc))
+        {
+            consolePrint("failed to open %s partition storage! (0x%X)\n", partition->name, rc);
+            return false;
+        }
+
+        storage = &local_storage;
+    }
+
+    /* Retrieve partition size. */
+    rc = fsStorageGetSize(storage, &storage_size);
+    if (R_FAILED(rc) || storage_size <= 0)
+    {
+        consolePrint("failed to retrieve %s partition size! (0x%X)\n", partition->name, rc);
+        goto end;
+    }
+
+    partition_size = (u64)storage_size;
+
+    consolePrint("%s partition size: 0x%lX\n", partition->name, partition_size);
+
+    /* Build free cluster bitmap, if requested. Falling back to a raw dump on failure keeps the output usable either way. */
+    if (skip_free_clusters)
+    {
+        if (bisParseFat32Layout(storage, partition_size, &fat_layout))
+        {
+            consolePrint("fat32 layout: %u clusters (0x%lX each), %u free\n", fat_layout.cluster_count, fat_layout.cluster_size, fat_layout.free_cluster_count);
+        } else {
+            consolePrint("no fat32 layout detected - dumping %s partition raw\n", partition->name);
+        }
+    }
+
+    /* Allocate transfer buffer. */
+    buf = usbAllocatePageAlignedBuffer(BLOCK_SIZE);
+    if (!buf)
+    {
+        consolePrint("failed to allocate transfer buffer!\n");
+        goto end;
+    }
+
+    snprintf(path, sizeof(path), "%s%s.bin", use_usb ? "" : "sdmc:/", partition->name);
+
+    if (use_usb)
+    {
+        /* Announce the file transfer to the USB host. */
+        if (!usbSendFilePropertiesCommon(partition_size, path))
+        {
+            consolePrint("failed to send file properties for \"%s\"!\n", path);
+            goto end;
+        }
+
+        usb_transfer_started = true;
+    } else {
+        /* Check free SD card space. */
+        if (!utilsGetFileSystemStatsByPath("sdmc:/", NULL, &free_space))
+        {
+            consolePrint("failed to retrieve free sd card space\n");
+            goto end;
+        }
+
+        if (free_space <= partition_size)
+        {
+            consolePrint("dump size (0x%lX) exceeds free sd card space (0x%lX)\n", partition_size, free_space);
+            goto end;
+        }
+
+        if (partition_size > FAT32_FILESIZE_LIMIT && !utilsCreateConcatenationFile(path))
+        {
+            consolePrint("failed to create concatenation file for \"%s\"!\n", path);
+            goto end;
+        }
+
+        fp = fopen(path, "wb");
+        if (!fp)
+        {
+            consolePrint("failed to open \"%s\" for writing!\n", path);
+            goto end;
+        }
+    }
+
+    utilsSetLongRunningProcessState(true);
+
+    u8 prev_time = 0;
+    u64 prev_size = 0;
+    u8 percent = 0;
+
+    time_t btn_cancel_start_tmr = 0, btn_cancel_end_tmr = 0;
+    bool btn_cancel_cur_state = false, btn_cancel_prev_state = false, cancelled = false;
+
+    consolePrint("hold b to cancel\n\n");
+
+    time_t start = time(NULL);
+
+    while(data_written < partition_size)
+    {
+        u64 chunk_size = ((partition_size - data_written) > BLOCK_SIZE ? BLOCK_SIZE : (partition_size - data_written));
+
+        /* Fill the chunk run by run: allocated runs are read from the partition storage, free runs are zero-filled without touching the eMMC at all. */
+        /* The output stays a byte-exact-size raw image - free clusters simply hold zeroes, which skips their read cost and makes the image compress to nearly nothing. */
+        u64 chunk_offset = 0;
+
+        while(chunk_offset < chunk_size)
+        {
+            bool is_free = false;
+            u64 run_size = bisGetRunLength(&fat_layout, data_written + chunk_offset, chunk_size - chunk_offset, &is_free);
+
+            if (is_free)
+            {
+                memset(buf + chunk_offset, 0, run_size);
+                skipped_size += run_size;
+            } else {
+                rc = fsStorageRead(storage, data_written + chunk_offset, buf + chunk_offset, run_size);
+                if (R_FAILED(rc))
+                {
+                    consolePrint("failed to read 0x%lX bytes at offset 0x%lX! (0x%X)\n", run_size, data_written + chunk_offset, rc);
+                    goto end_dump;
+                }
+            }
+
+            chunk_offset += run_size;
+        }
+
+        /* Write chunk. */
+        if (use_usb)
+        {
+            if (!usbSendFileData(buf, chunk_size))
+            {
+                consolePrint("failed to send 0x%lX bytes at offset 0x%lX!\n", chunk_size, data_written);
+                goto end_dump;
+            }
+        } else {
+            if (fwrite(buf, 1, chunk_size, fp) != chunk_size)
+            {
+                consolePrint("failed to write 0x%lX bytes at offset 0x%lX!\n", chunk_size, data_written);
+                goto end_dump;
+            }
+        }
+
+        data_written += chunk_size;
+
+        /* Handle cancel button and progress output. */
+        struct tm ts = {0};
+        time_t now = time(NULL);
+        localtime_r(&now, &ts);
+
+        utilsScanPads();
+        btn_cancel_cur_state = (utilsGetButtonsHeld() & HidNpadButton_B);
+
+        if (btn_cancel_cur_state && btn_cancel_cur_state != btn_cancel_prev_state)
+        {
+            btn_cancel_start_tmr = now;
+        } else
+        if (btn_cancel_cur_state && btn_cancel_cur_state == btn_cancel_prev_state)
+        {
+            btn_cancel_end_tmr = now;
+            if ((btn_cancel_end_tmr - btn_cancel_start_tmr) >= 3)
+            {
+                cancelled = true;
+                goto end_dump;
+            }
+        } else {
+            btn_cancel_start_tmr = btn_cancel_end_tmr = 0;
+        }
+
+        btn_cancel_prev_state = btn_cancel_cur_state;
+
+        if (prev_time == ts.tm_sec || prev_size == data_written) continue;
+
+        percent = (u8)((data_written * 100) / partition_size);
+
+        prev_time = ts.tm_sec;
+        prev_size = data_written;
+
+        printf("%lu / %lu (%u%%) | Time elapsed: %lu\n", data_written, partition_size, percent, (now - start));
+        consoleUpdate(NULL);
+    }
+
+    success = true;
+
+end_dump:
+    start = (time(NULL) - start);
+
+    utilsSetLongRunningProcessState(false);
+
+    if (success)
+    {
+        consolePrint("\nprocess completed in %lu seconds\n", start);
+        if (skipped_size) consolePrint("free cluster data zero-filled without eMMC reads: 0x%lX bytes (%lu%%)\n", skipped_size, (skipped_size * 100) / partition_size);
+    } else {
+        consolePrint("\n%s\n", cancelled ? "process cancelled" : "i/o error");
+        if (use_usb && usb_transfer_started) usbCancelFileTransfer();
+    }
+
+    if (fp)
+    {
+        fclose(fp);
+        fp = NULL;
+
+        if (!success)
+        {
+            utilsRemoveConcatenationFile(path);
+        } else {
+            utilsCommitSdCardFileSystemChanges();
+        }
+    }
+
+end:
+    if (buf) free(buf);
+
+    bisFreeFatLayout(&fat_layout);
+
+    if (!partition->shared && serviceIsActive(&(local_storage.s))) fsStorageClose(&local_storage);
+
+    return success;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+
+    if (!utilsInitializeResources(argc, (const char**)argv))
+    {
+        ret = -1;
+        goto out;
+    }
+
+    /* Configure input. */
+    /* Up to 8 different, full controller inputs. */
+    /* Individual Joy-Cons not supported. */
+    padConfigureInput(8, HidNpadStyleSet_NpadFullCtrl);
+    padInitializeWithMask(&g_padState, 0x1000000FFUL);
+
+    consoleInit(NULL);
+
+    u32 selected_idx = 0;
+    bool applet_status = true, exit_prompt = true, skip_free_clusters = true, use_usb = false;
+
+    while((applet_status = appletMainLoop()))
+    {
+        consoleClear();
+        printf("select a bis partition to dump.\npress b to exit.\n\n");
+        printf("free cluster skipping (y): %s | output device (x): %s\n\n", skip_free_clusters ? "yes" : "no", use_usb ? "usb host (pc)" : "sd card");
+
+        for(u32 i = 0; i < g_bisPartitionsCount; i++) printf("%s%s\n", i == selected_idx ? " -> " : "    ", g_bisPartitions[i].name);
+
+        printf("\n");
+
+        consoleUpdate(NULL);
+
+        u64 btn_down = 0, btn_held = 0;
+
+        while((applet_status = appletMainLoop()))
+        {
+            utilsScanPads();
+            btn_down = utilsGetButtonsDown();
+            btn_held = utilsGetButtonsHeld();
+            if (btn_down || btn_held) break;
+        }
+
+        if (!applet_status) break;
+
+        if (btn_down & HidNpadButton_A)
+        {
+            consoleClear();
+
+            if (use_usb)
+            {
+                /* Make sure we have a valid USB session before starting the dump. */
+                consolePrint("waiting for usb connection... ");
+
+                u8 usb_host_speed = UsbHostSpeed_None;
+                time_t conn_start = time(NULL);
+
+                while(appletMainLoop())
+                {
+                    if ((time(NULL) - conn_start) >= 10 || (usb_host_speed = usbIsReady())) break;
+                    utilsSleep(1);
+                }
+
+                consolePrint("\n");
+
+                if (!usb_host_speed)
+                {
+                    consolePrint("usb connection failed\n");
+                    utilsSleep(3);
+                    continue;
+                }
+            }
+
+            consolePrint("dumping %s partition...\n", g_bisPartitions[selected_idx].name);
+
+            dumpBisPartition(&(g_bisPartitions[selected_idx]), skip_free_clusters, use_usb);
+
+            consolePrint("press any button to continue\n");
+            utilsWaitForButtonPress(0);
+        } else
+        if (btn_down & HidNpadButton_Y)
+        {
+            skip_free_clusters ^= true;
+        } else
+        if (btn_down & HidNpadButton_X)
+        {
+            use_usb ^= true;
+        } else
+        if ((btn_down & HidNpadButton_Down) || (btn_held & (HidNpadButton_StickLDown | HidNpadButton_StickRDown)))
+        {
+            selected_idx = ((selected_idx + 1) % g_bisPartitionsCount);
+        } else
+        if ((btn_down & HidNpadButton_Up) || (btn_held & (HidNpadButton_StickLUp | HidNpadButton_StickRUp)))
+        {
+            selected_idx = (selected_idx ? (selected_idx - 1) : (g_bisPartitionsCount - 1));
+        } else
+        if (btn_down & HidNpadButton_B)
+        {
+            exit_prompt = false;
+            goto out2;
+        }
+
+        if (btn_held & (HidNpadButton_StickLDown | HidNpadButton_StickRDown | HidNpadButton_StickLUp | HidNpadButton_StickRUp)) svcSleepThread(50000000); // 50 ms
+    }
+
+    if (!applet_status) exit_prompt = false;
+
+out2:
+    if (exit_prompt)
+    {
+        consolePrint("press any button to exit\n");
+        utilsWaitForButtonPress(0);
+    }
+
+    utilsCloseResources();
+
+    consoleExit(NULL);
+
+    return ret;
+}
@@ -1,13 +1,61 @@
+#define TITLE_INFO_EXPORT_BUFFER_SIZE   0x40000     /* 256 KiB. Fixed stdio buffer for the text export - formatted records stream through it instead of growing a heap string. */
+
+#define TITLE_INFO_BIN_MAGIC            0x4E585449  /* "NXTI". */
+#define TITLE_INFO_BIN_VERSION          1
+
+#pragma pack(push, 1)
+
+typedef struct {
+    u32 magic;              ///< "NXTI".
+    u32 format_version;     ///< TITLE_INFO_BIN_VERSION.
+    u32 title_count;        ///< Number of TitleInfoBinEntry records that follow this header.
+    u8 reserved[0x4];
+} TitleInfoBinHeader;
+
+NXDT_ASSERT(TitleInfoBinHeader, 0x10);
+
+typedef struct {
+    u64 title_id;
+    u32 version;
+    u8 storage_id;          ///< NcmStorageId.
+    u8 meta_type;           ///< NcmContentMetaType.
+    u8 install_type;        ///< NcmContentInstallType.
+    u8 reserved;
+    u64 title_size;
+    u32 content_count;      ///< Number of TitleInfoBinContentRecord entries that follow this record.
+    u16 name_len;           ///< Length of the UTF-8 name string placed after the content records. May be zero.
+    u16 author_len;         ///< Length of the UTF-8 author string placed after the name string. May be zero.
+} TitleInfoBinEntry;
+
+NXDT_ASSERT(TitleInfoBinEntry, 0x20);
+
+typedef struct {
+    u8 content_id[0x10];    ///< NcmContentId.
+    u64 size;
+    u8 content_type;        ///< NcmContentType.
+    u8 id_offset;
+    u8 reserved[0x6];
+} TitleInfoBinContentRecord;
+
+NXDT_ASSERT(TitleInfoBinContentRecord, 0x20);
+
+#pragma pack(pop)
+
     if (g_titleInfo && g_titleInfoCount)
     {
         mkdir("sdmc:/records", 0777);
 
-        FILE *title_infos_txt = NULL, *icon_jpg = NULL;
+        FILE *title_infos_txt = NULL, *title_infos_bin = NULL, *icon_jpg = NULL;
         char icon_path[FS_MAX_PATH] = {0};
 
+        /* Fixed streaming buffer shared by both exports. Keeps SD card writes big and sequential without ever buffering the whole export in RAM. */
+        char *write_buffer = malloc(TITLE_INFO_EXPORT_BUFFER_SIZE);
+
         title_infos_txt = fopen("sdmc:/records/title_infos.txt", "wb");
         if (title_infos_txt)
         {
+            if (write_buffer) setvbuf(title_infos_txt, write_buffer, _IOFBF, TITLE_INFO_EXPORT_BUFFER_SIZE);
+
             for(u32 i = 0; i < g_titleInfoCount; i++)
             {
                 fprintf(title_infos_txt, "Storage ID: 0x%02X\r\n", g_titleInfo[i].storage_id);
@@ -57,7 +105,7 @@
                             fwrite(app_metadata->icon, 1, app_metadata->icon_size, icon_jpg);
                             fclose(icon_jpg);
                             icon_jpg = NULL;
-                            utilsCommitSdCardFileSystemChanges();
+                            utilsScheduleSdCardFileSystemCommit(app_metadata->icon_size);
                         }
                     }
                 }
@@ -69,12 +117,74 @@
                 }
 
                 fprintf(title_infos_txt, "\r\n");
-
-                fflush(title_infos_txt);
             }
 
             fclose(title_infos_txt);
             title_infos_txt = NULL;
-            utilsCommitSdCardFileSystemChanges();
         }
+
+        /* Compact binary export. Fixed-size records with trailing length-prefixed strings - no text scraping needed to parse it back. */
+        title_infos_bin = fopen("sdmc:/records/title_infos.bin", "wb");
+        if (title_infos_bin)
+        {
+            if (write_buffer) setvbuf(title_infos_bin, write_buffer, _IOFBF, TITLE_INFO_EXPORT_BUFFER_SIZE);
+
+            TitleInfoBinHeader bin_header = {
+                .magic = TITLE_INFO_BIN_MAGIC,
+                .format_version = TITLE_INFO_BIN_VERSION,
+                .title_count = g_titleInfoCount,
+                .reserved = {0}
+            };
+
+            fwrite(&bin_header, 1, sizeof(TitleInfoBinHeader), title_infos_bin);
+
+            for(u32 i = 0; i < g_titleInfoCount; i++)
+            {
+                const char *name = (g_titleInfo[i].app_metadata ? g_titleInfo[i].app_metadata->lang_entry.name : NULL);
+                const char *author = (g_titleInfo[i].app_metadata ? g_titleInfo[i].app_metadata->lang_entry.author : NULL);
+
+                TitleInfoBinEntry bin_entry = {
+                    .title_id = g_titleInfo[i].meta_key.id,
+                    .version = g_titleInfo[i].meta_key.version,
+                    .storage_id = g_titleInfo[i].storage_id,
+                    .meta_type = g_titleInfo[i].meta_key.type,
+                    .install_type = g_titleInfo[i].meta_key.install_type,
+                    .reserved = 0,
+                    .title_size = g_titleInfo[i].size,
+                    .content_count = g_titleInfo[i].content_count,
+                    .name_len = (u16)(name ? strlen(name) : 0),
+                    .author_len = (u16)(author ? strlen(author) : 0)
+                };
+
+                fwrite(&bin_entry, 1, sizeof(TitleInfoBinEntry), title_infos_bin);
+
+                for(u32 j = 0; j < g_titleInfo[i].content_count; j++)
+                {
+                    u64 content_size = 0;
+                    ncmContentInfoSizeToU64(&(g_titleInfo[i].content_infos[j]), &content_size);
+
+                    TitleInfoBinContentRecord bin_content = {
+                        .size = content_size,
+                        .content_type = g_titleInfo[i].content_infos[j].content_type,
+                        .id_offset = g_titleInfo[i].content_infos[j].id_offset,
+                        .reserved = {0}
+                    };
+
+                    memcpy(bin_content.content_id, g_titleInfo[i].content_infos[j].content_id.c, sizeof(bin_content.content_id));
+
+                    fwrite(&bin_content, 1, sizeof(TitleInfoBinContentRecord), title_infos_bin);
+                }
+
+                if (bin_entry.name_len) fwrite(name, 1, bin_entry.name_len, title_infos_bin);
+                if (bin_entry.author_len) fwrite(author, 1, bin_entry.author_len, title_infos_bin);
+            }
+
+            fclose(title_infos_bin);
+            title_infos_bin = NULL;
+        }
+
+        if (write_buffer) free(write_buffer);
+
+        /* Single commit covering both exports and any scheduled icon writes. */
+        utilsCommitSdCardFileSystemChanges();
     }
@@ -20,11 +20,42 @@
  */
 
 #include "nxdt_utils.h"
+#include "nxdt_datfile.h"
 #include "gamecard.h"
 #include "usb.h"
 #include "title.h"
+#include "nca.h"
 
-#define BLOCK_SIZE  USB_TRANSFER_BUFFER_SIZE
+#define BLOCK_SIZE          USB_TRANSFER_BUFFER_SIZE
+
+/* Depth of the lock-free buffer ring shared by the read/write threads. Must be a power of two within the [4,8] range. */
+#define RING_BUFFER_COUNT   4
+
+/* Lower boundary for the feedback-driven block size used by the read thread. Must be a power of two. */
+/* Chunks shrink while the write thread starves (spiky/slow reads) and grow back while the pipeline stays balanced. The upper boundary is the budgeted ring slot size. */
+#define ADAPTIVE_BLOCK_SIZE_MIN     0x100000    /* 1 MiB. */
+
+/* Number of published chunks between adaptive block size adjustments. */
+#define ADAPTIVE_BLOCK_WINDOW       16
+
+/* Upper bound on the amount of I/O performed between transfer cancellation checks, which keeps cancellation latency bounded regardless of the current block size. */
+#define CANCEL_CHECK_SUBCHUNK_SIZE  0x100000    /* 1 MiB. */
+
+/* Magic word from dump checkpoint files ("NXCP"). */
+#define DUMP_CHECKPOINT_MAGIC       0x4E584350
+
+/* Amount of dumped data between checkpoint updates. Must be a multiple of BLOCK_SIZE. */
+/* The read thread clamps its chunks so they never cross an interval boundary, keeping checkpoint offsets aligned regardless of the adaptive block size. */
+#define DUMP_CHECKPOINT_INTERVAL    0x10000000  /* 256 MiB. */
+
+/* Amount of output file space kept preallocated ahead of the write thread on file-based dumps. Matches the size of a single FAT32 part file. */
+#define PREALLOC_WINDOW_SIZE        FAT32_FILESIZE_LIMIT
+
+/* Chrome-trace lane IDs for the dump pipeline stage threads. */
+#define TRACE_LANE_READ             0
+#define TRACE_LANE_WRITE            1
+#define TRACE_LANE_USB_WRITE        2
+#define TRACE_LANE_HASH             3
 
 bool g_borealisInitialized = false;
 
@@ -57,17 +88,58 @@ typedef struct _Menu {
 
 typedef struct
 {
-    void *data;
-    size_t data_size;
+    void *buf[RING_BUFFER_COUNT];       ///< Page-aligned buffer ring slots. Each one holds up to 'ring_slot_size' bytes.
+    size_t buf_size[RING_BUFFER_COUNT]; ///< Amount of data held by each ring slot.
+    size_t ring_slot_size;              ///< Ring slot capacity. BLOCK_SIZE under title override mode, possibly smaller under applet mode memory budgeting.
+    atomic_size_t read_count;           ///< Total number of slots filled by the read thread. Only written by the read thread.
+    atomic_size_t write_count;          ///< Total number of slots consumed by the write thread. Only written by the write thread.
+    atomic_size_t hash_count;           ///< Total number of slots consumed by the hash thread. Only written by the hash thread.
+    atomic_size_t usb_write_count;      ///< Total number of slots consumed by the USB write thread. Only written by that thread. Only used on dual output dumps.
+    atomic_size_t write_stall_count;    ///< Number of chunks the write thread had to wait on before a filled slot became available. Only written by the write thread. Signals a read-bound pipeline.
+    atomic_size_t read_busy_ns;         ///< Total time spent inside gamecard read calls by the read thread, in nanoseconds. Only written by the read thread.
+    atomic_size_t write_busy_ns;        ///< Total time spent inside write calls by the write thread, in nanoseconds. Only written by the write thread.
+    atomic_size_t usb_write_busy_ns;    ///< Total time spent inside USB send calls by the USB write thread, in nanoseconds. Only written by that thread. Only used on dual output dumps.
+    atomic_size_t hash_busy_ns;         ///< Total time spent updating checksums by the hash thread, in nanoseconds. Only written by the hash thread.
     size_t data_written;
     size_t total_size;
-    bool read_error;
-    bool write_error;
-    bool transfer_cancelled;
-    u32 xci_crc, full_xci_crc;
+    atomic_bool read_error;
+    atomic_bool write_error;
+    atomic_bool usb_write_error;
+    atomic_bool transfer_cancelled;
+    u32 xci_crc, full_xci_crc;          ///< 'full_xci_crc' only holds the key area checksum while the dump runs. Both checksums get combined via utilsCombineCrc32() once the dump completes.
+    bool calc_sha256, calc_sha1;        ///< Extra digests requested for this dump session. Unlike the CRC32 state, SHA states can't be checkpointed, so both get disabled on resumed sessions.
+    u8 xci_sha256[SHA256_HASH_SIZE];    ///< SHA-256 checksum calculated over the gamecard image. Filled by the hash thread right before it exits, if 'calc_sha256' is set.
+    u8 xci_sha1[SHA1_HASH_SIZE];        ///< SHA-1 checksum calculated over the gamecard image. Filled by the hash thread right before it exits, if 'calc_sha1' is set.
     FILE *fp;
+    bool dual_output;                   ///< Set to true to simultaneously write the dumped data to a file and send it to the USB host. A dedicated USB write thread consumes the ring on its own.
+    bool skip_padding;                  ///< Set to true to skip writing padding blocks located past the trimmed gamecard area.
+    u64 trimmed_size;                   ///< Trimmed gamecard size. Only used if 'skip_padding' is set to true.
+    u64 package_id;                     ///< Package ID from the inserted gamecard. Used to validate dump checkpoints.
+    u64 resume_offset;                  ///< Offset at which the read/write/hash threads start working. Non-zero when resuming a checkpointed dump session.
+    char *checkpoint_path;              ///< Path to the checkpoint file for this dump session. Only set on file-based dumps.
+    const char *out_path;               ///< Output file path. Used by the preallocation thread to open its own file handle. Only set on file-based dumps.
+    u64 prealloc_goal;                  ///< Full output file size, including the key area. Background file preallocation is disabled if this is set to zero.
+    bool trace_enabled;                 ///< Set to true if the chrome-trace sink is active for this dump session. Stage threads emit timeline events while it's set.
+    u64 trace_start_tick;               ///< System tick captured right before the stage threads are created. Trace event timestamps are relative to it.
 } ThreadSharedData;
 
+/// Serialized to SD card / UMS devices at fixed intervals during file-based gamecard image dumps.
+/// Holds everything needed to resume an interrupted dump session: output offset, checksum states and the option set + gamecard identity they belong to.
+typedef struct {
+    u32 magic;              ///< "NXCP".
+    u8 append_key_area;     ///< Value from g_appendKeyArea when the checkpoint was taken.
+    u8 keep_certificate;    ///< Value from g_keepCertificate when the checkpoint was taken.
+    u8 trim_dump;           ///< Value from g_trimDump when the checkpoint was taken.
+    u8 skip_padding;        ///< Value from g_skipPadding when the checkpoint was taken.
+    u8 calc_crc;            ///< Value from g_calcCrc when the checkpoint was taken.
+    u8 reserved[7];
+    u64 package_id;         ///< Package ID from the gamecard being dumped.
+    u64 total_size;         ///< Total dump size, not including the key area.
+    u64 resume_offset;      ///< Amount of gamecard bytes fully written and hashed. Always a multiple of DUMP_CHECKPOINT_INTERVAL.
+    u32 xci_crc;            ///< CRC32 state at 'resume_offset'.
+    u32 full_xci_crc;       ///< Key area CRC32. Kept for layout compatibility - it's always recalculated from the inserted gamecard on resume.
+} DumpCheckpoint;
+
 /* Function prototypes. */
 
 static void utilsScanPads(void);
@@ -84,6 +156,7 @@ void freeStorageList(void);
 void updateStorageList(void);
 
 NX_INLINE bool useUsbHost(void);
+NX_INLINE bool useDualOutput(void);
 
 static bool waitForGameCard(void);
 static bool waitForUsb(void);
@@ -93,6 +166,10 @@ static bool saveDumpTxt(void);
 
 static char *generateOutputFileName(const char *extension);
 
+static char *generateCheckpointPath(const char *filename);
+static bool loadDumpCheckpoint(ThreadSharedData *shared_data, DumpCheckpoint *out);
+static void saveDumpCheckpoint(ThreadSharedData *shared_data, u64 offset);
+
 static bool saveGameCardSpecificData(void);
 static bool saveGameCardCertificate(void);
 static bool saveGameCardInitialData(void);
@@ -100,17 +177,28 @@ static bool saveGameCardIdSet(void);
 static bool saveGameCardImage(void);
 static bool saveConsoleLafwBlob(void);
 
+static bool verifyGameCardNcaHashTrees(void);
+
 static void changeKeyAreaOption(u32 idx);
 static void changeCertificateOption(u32 idx);
 static void changeTrimOption(u32 idx);
+static void changeSkipPaddingOption(u32 idx);
 static void changeCrcOption(u32 idx);
+static void changeSha256Option(u32 idx);
+static void changeSha1Option(u32 idx);
+static void changeDualOutputOption(u32 idx);
+static void changeTraceOption(u32 idx);
 
 static void read_thread_func(void *arg);
 static void write_thread_func(void *arg);
+static void usb_write_thread_func(void *arg);
+static void hash_thread_func(void *arg);
+static void prealloc_thread_func(void *arg);
 
 /* Global variables. */
 
-static bool g_appendKeyArea = true, g_keepCertificate = false, g_trimDump = false, g_calcCrc = false;
+static bool g_appendKeyArea = true, g_keepCertificate = false, g_trimDump = false, g_skipPadding = false, g_calcCrc = false, g_calcSha256 = false, g_calcSha1 = false, g_dualOutput = false, \
+            g_genTrace = false;
 
 static char *g_xciOptions[] = { "no", "yes", NULL };
 
@@ -151,6 +239,16 @@ static MenuElement *g_xciMenuElements[] = {
             .options = g_xciOptions
         }
     },
+    &(MenuElement){
+        .str = "skip padding past trimmed area",
+        .child_menu = NULL,
+        .task_func = NULL,
+        .element_options = &(MenuElementOption){
+            .selected = 0,
+            .options_func = &changeSkipPaddingOption,
+            .options = g_xciOptions
+        }
+    },
     &(MenuElement){
         .str = "calculate crc32",
         .child_menu = NULL,
@@ -161,6 +259,46 @@ static MenuElement *g_xciMenuElements[] = {
             .options = g_xciOptions
         }
     },
+    &(MenuElement){
+        .str = "calculate sha256",
+        .child_menu = NULL,
+        .task_func = NULL,
+        .element_options = &(MenuElementOption){
+            .selected = 0,
+            .options_func = &changeSha256Option,
+            .options = g_xciOptions
+        }
+    },
+    &(MenuElement){
+        .str = "calculate sha1",
+        .child_menu = NULL,
+        .task_func = NULL,
+        .element_options = &(MenuElementOption){
+            .selected = 0,
+            .options_func = &changeSha1Option,
+            .options = g_xciOptions
+        }
+    },
+    &(MenuElement){
+        .str = "also send dump to usb host",
+        .child_menu = NULL,
+        .task_func = NULL,
+        .element_options = &(MenuElementOption){
+            .selected = 0,
+            .options_func = &changeDualOutputOption,
+            .options = g_xciOptions
+        }
+    },
+    &(MenuElement){
+        .str = "generate chrome trace timeline",
+        .child_menu = NULL,
+        .task_func = NULL,
+        .element_options = &(MenuElementOption){
+            .selected = 0,
+            .options_func = &changeTraceOption,
+            .options = g_xciOptions
+        }
+    },
     NULL
 };
 
@@ -208,6 +346,12 @@ static MenuElement *g_rootMenuElements[] = {
         .task_func = &saveGameCardSpecificData,
         .element_options = NULL
     },
+    &(MenuElement){
+        .str = "verify gamecard nca hash trees",
+        .child_menu = NULL,
+        .task_func = &verifyGameCardNcaHashTrees,
+        .element_options = NULL
+    },
     &(MenuElement){
         .str = "dump console lafw blob",
         .child_menu = NULL,
@@ -230,8 +374,7 @@ static Menu g_rootMenu = {
     .elements = g_rootMenuElements
 };
 
-static Mutex g_conMutex = 0, g_fileMutex = 0;
-static CondVar g_readCondvar = 0, g_writeCondvar = 0;
+static Mutex g_conMutex = 0;
 
 static char path[FS_MAX_PATH] = {0}, txt_info[FS_MAX_PATH] = {0};
 
@@ -430,6 +573,8 @@ int main(int argc, char *argv[])
 out:
     freeStorageList();
 
+    datfileExit();
+
     utilsCloseResources();
 
     consoleExit(NULL);
@@ -588,6 +733,12 @@ NX_INLINE bool useUsbHost(void)
     return (g_storageMenuElementOption.selected == 1);
 }
 
+NX_INLINE bool useDualOutput(void)
+{
+    /* The dual output option only applies to file-based dumps - there's only one USB host to send data to. */
+    return (g_dualOutput && !useUsbHost());
+}
+
 static bool waitForGameCard(void)
 {
     consoleClear();
@@ -758,6 +909,76 @@ static char *generateOutputFileName(const char *extension)
     return output;
 }
 
+static char *generateCheckpointPath(const char *filename)
+{
+    if (!filename || !*filename) return NULL;
+
+    size_t checkpoint_path_size = (strlen(filename) + 12);  // ".checkpoint" + NULL terminator
+
+    char *checkpoint_path = calloc(sizeof(char), checkpoint_path_size);
+    if (checkpoint_path) snprintf(checkpoint_path, checkpoint_path_size, "%s.checkpoint", filename);
+
+    return checkpoint_path;
+}
+
+static bool loadDumpCheckpoint(ThreadSharedData *shared_data, DumpCheckpoint *out)
+{
+    DumpCheckpoint checkpoint = {0};
+    bool success = false;
+
+    FILE *fp = fopen(shared_data->checkpoint_path, "rb");
+    if (!fp) return false;
+
+    /* Only accept the checkpoint if it was taken for the very same gamecard, dump size and option set, and if its resume offset makes sense. */
+    success = (fread(&checkpoint, 1, sizeof(DumpCheckpoint), fp) == sizeof(DumpCheckpoint) && checkpoint.magic == DUMP_CHECKPOINT_MAGIC && \
+               checkpoint.append_key_area == (u8)g_appendKeyArea && checkpoint.keep_certificate == (u8)g_keepCertificate && checkpoint.trim_dump == (u8)g_trimDump && \
+               checkpoint.skip_padding == (u8)g_skipPadding && checkpoint.calc_crc == (u8)g_calcCrc && checkpoint.package_id == shared_data->package_id && \
+               checkpoint.total_size == shared_data->total_size && checkpoint.resume_offset > 0 && checkpoint.resume_offset < checkpoint.total_size && \
+               IS_ALIGNED(checkpoint.resume_offset, BLOCK_SIZE));
+
+    fclose(fp);
+
+    if (success) memcpy(out, &checkpoint, sizeof(DumpCheckpoint));
+
+    return success;
+}
+
+static void saveDumpCheckpoint(ThreadSharedData *shared_data, u64 offset)
+{
+    DumpCheckpoint checkpoint = {
+        .magic = DUMP_CHECKPOINT_MAGIC,
+        .append_key_area = (u8)g_appendKeyArea,
+        .keep_certificate = (u8)g_keepCertificate,
+        .trim_dump = (u8)g_trimDump,
+        .skip_padding = (u8)g_skipPadding,
+        .calc_crc = (u8)g_calcCrc,
+        .reserved = {0},
+        .package_id = shared_data->package_id,
+        .total_size = shared_data->total_size,
+        .resume_offset = offset,
+        .xci_crc = shared_data->xci_crc,
+        .full_xci_crc = shared_data->full_xci_crc
+    };
+
+    /* Push any buffered output file data down to the filesystem layer before the checkpoint starts pointing at it. */
+    fflush(shared_data->fp);
+
+    FILE *fp = fopen(shared_data->checkpoint_path, "wb");
+    if (!fp) return;
+
+    size_t ret = fwrite(&checkpoint, 1, sizeof(DumpCheckpoint), fp);
+    fclose(fp);
+
+    if (ret != sizeof(DumpCheckpoint))
+    {
+        /* A torn checkpoint must not survive - resuming from one would corrupt the dump. */
+        remove(shared_data->checkpoint_path);
+        return;
+    }
+
+    utilsCommitSdCardFileSystemChanges();
+}
+
 static bool dumpGameCardSecurityInformation(GameCardSecurityInformation *out)
 {
     if (!out)
@@ -895,20 +1116,32 @@ static bool saveGameCardImage(void)
     GameCardSecurityInformation gc_security_information = {0};
 
     ThreadSharedData shared_data = {0};
-    Thread read_thread = {0}, write_thread = {0};
+    Thread read_thread = {0}, write_thread = {0}, usb_write_thread = {0}, hash_thread = {0}, prealloc_thread = {0};
 
     char *filename = NULL;
     u32 dev_idx = g_storageMenuElementOption.selected;
 
     bool success = false;
 
-    consolePrint("gamecard image dump\nappend key area: %s | keep certificate: %s | trim dump: %s | calculate crc32: %s\n\n", g_appendKeyArea ? "yes" : "no", g_keepCertificate ? "yes" : "no", g_trimDump ? "yes" : "no", g_calcCrc ? "yes" : "no");
+    /* Wait for a USB session if the dumped data is also being sent to the USB host. */
+    if (useDualOutput() && !waitForUsb()) return false;
+
+    consolePrint("gamecard image dump\nappend key area: %s | keep certificate: %s | trim dump: %s | skip padding: %s | calculate crc32: %s | calculate sha256: %s | calculate sha1: %s | " \
+                 "dual output: %s | chrome trace: %s\n\n", \
+                 g_appendKeyArea ? "yes" : "no", g_keepCertificate ? "yes" : "no", g_trimDump ? "yes" : "no", g_skipPadding ? "yes" : "no", g_calcCrc ? "yes" : "no", \
+                 g_calcSha256 ? "yes" : "no", g_calcSha1 ? "yes" : "no", useDualOutput() ? "yes" : "no", g_genTrace ? "yes" : "no");
+
+    /* Size the ring slots from the applet-mode memory budget. Under title override mode this always returns BLOCK_SIZE. */
+    shared_data.ring_slot_size = utilsGetDumpBlockSize(RING_BUFFER_COUNT);
 
-    shared_data.data = usbAllocatePageAlignedBuffer(BLOCK_SIZE);
-    if (!shared_data.data)
+    for(u32 i = 0; i < RING_BUFFER_COUNT; i++)
     {
-        consolePrint("failed to allocate memory for the dump procedure!\n");
-        goto end;
+        shared_data.buf[i] = usbAllocatePageAlignedBuffer(shared_data.ring_slot_size);
+        if (!shared_data.buf[i])
+        {
+            consolePrint("failed to allocate memory for the dump procedure!\n");
+            goto end;
+        }
     }
 
     if ((!g_trimDump && !gamecardGetTotalSize(&gc_size)) || (g_trimDump && !gamecardGetTrimmedSize(&gc_size)) || !gc_size)
@@ -918,9 +1151,27 @@ static bool saveGameCardImage(void)
     }
 
     shared_data.total_size = gc_size;
+    shared_data.dual_output = useDualOutput();
+    shared_data.calc_sha256 = g_calcSha256;
+    shared_data.calc_sha1 = g_calcSha1;
 
     consolePrint("gamecard size: 0x%lX\n", gc_size);
 
+    /* Padding blocks can only be skipped on untrimmed file dumps. USB transfers and trimmed dumps always write every block. */
+    /* The read and hash threads still process the full image, so the calculated checksums keep matching full-size dumps. */
+    if (g_skipPadding && !g_trimDump && !useUsbHost())
+    {
+        if (!gamecardGetTrimmedSize(&(shared_data.trimmed_size)) || !shared_data.trimmed_size)
+        {
+            consolePrint("failed to get trimmed gamecard size!\n");
+            goto end;
+        }
+
+        shared_data.skip_padding = (shared_data.trimmed_size < shared_data.total_size);
+
+        consolePrint("trimmed gamecard size: 0x%lX\n", shared_data.trimmed_size);
+    }
+
     if (g_appendKeyArea)
     {
         gc_size += sizeof(GameCardKeyArea);
@@ -942,80 +1193,165 @@ static bool saveGameCardImage(void)
     filename = generateOutputFileName(path);
     if (!filename) goto end;
 
-    if (useUsbHost())
+    if (!useUsbHost())
     {
-        if (!usbSendFilePropertiesCommon(gc_size, filename))
-        {
-            consolePrint("failed to send file properties for \"%s\"!\n", filename);
-            goto end;
-        }
+        DumpCheckpoint checkpoint = {0};
+        GameCardHeader gc_header = {0};
+        bool resume = false;
 
-        if (g_appendKeyArea && !usbSendFileData(&gc_key_area, sizeof(GameCardKeyArea)))
+        /* Look for a checkpoint from a previously interrupted dump session with the same gamecard and option set. */
+        /* Checkpoints are skipped entirely on dual output dumps - the USB host side can't resume a partial file transfer. */
+        if (!shared_data.dual_output)
         {
-            consolePrint("failed to send gamecard key area data!\n");
-            goto end;
+            shared_data.checkpoint_path = generateCheckpointPath(filename);
+            if (gamecardGetHeader(&gc_header)) shared_data.package_id = gc_header.package_id;
+            resume = (shared_data.checkpoint_path && shared_data.package_id && loadDumpCheckpoint(&shared_data, &checkpoint));
         }
-    } else {
+
         if (!utilsGetFileSystemStatsByPath(filename, NULL, &free_space))
         {
             consolePrint("failed to retrieve free space from selected device\n");
             goto end;
         }
 
-        if (gc_size >= free_space)
+        if ((gc_size - (resume ? checkpoint.resume_offset : 0)) >= free_space)
         {
             consolePrint("dump size exceeds free space\n");
             goto end;
         }
 
-        if (dev_idx == 0)
+        if (resume)
         {
-            if (gc_size > FAT32_FILESIZE_LIMIT && !utilsCreateConcatenationFile(filename))
+            /* Reopen the previous output file and seek to the checkpointed offset. Fall back to a fresh dump if that fails. */
+            shared_data.fp = fopen(filename, "rb+");
+
+            if (shared_data.fp && !fseeko(shared_data.fp, (off_t)((g_appendKeyArea ? sizeof(GameCardKeyArea) : 0) + checkpoint.resume_offset), SEEK_SET))
             {
-                consolePrint("failed to create concatenation file for \"%s\"!\n", filename);
+                shared_data.resume_offset = shared_data.data_written = checkpoint.resume_offset;
+                shared_data.xci_crc = checkpoint.xci_crc;
+
+                /* No need to restore 'full_xci_crc' - it only holds the key area checksum, which has just been recalculated from the inserted gamecard. */
+
+                /* SHA states can't be restored from a checkpoint, so the extra digests are dropped for resumed sessions instead of silently producing partial hashes. */
+                if (shared_data.calc_sha256 || shared_data.calc_sha1)
+                {
+                    consolePrint("sha digests can't be resumed from a checkpoint, skipping them for this session\n");
+                    shared_data.calc_sha256 = shared_data.calc_sha1 = false;
+                }
+
+                consolePrint("resuming previous dump session at offset 0x%lX\n", checkpoint.resume_offset);
+            } else {
+                if (shared_data.fp)
+                {
+                    fclose(shared_data.fp);
+                    shared_data.fp = NULL;
+                }
+
+                resume = false;
+            }
+        }
+
+        if (!resume)
+        {
+            if (dev_idx == 0)
+            {
+                if (gc_size > FAT32_FILESIZE_LIMIT && !utilsCreateConcatenationFile(filename))
+                {
+                    consolePrint("failed to create concatenation file for \"%s\"!\n", filename);
+                    goto end;
+                }
+            } else {
+                if (g_umsDevices[dev_idx - 2].fs_type < UsbHsFsDeviceFileSystemType_exFAT && gc_size > FAT32_FILESIZE_LIMIT)
+                {
+                    consolePrint("split dumps not supported for FAT12/16/32 volumes in UMS devices (yet)\n");
+                    goto end;
+                }
+            }
+
+            shared_data.fp = fopen(filename, "wb");
+            if (!shared_data.fp)
+            {
+                consolePrint("failed to open \"%s\" for writing!\n", filename);
                 goto end;
             }
-        } else {
-            if (g_umsDevices[dev_idx - 2].fs_type < UsbHsFsDeviceFileSystemType_exFAT && gc_size > FAT32_FILESIZE_LIMIT)
+
+            if (g_appendKeyArea && fwrite(&gc_key_area, 1, sizeof(GameCardKeyArea), shared_data.fp) != sizeof(GameCardKeyArea))
             {
-                consolePrint("split dumps not supported for FAT12/16/32 volumes in UMS devices (yet)\n");
+                consolePrint("failed to write gamecard key area data!\n");
                 goto end;
             }
         }
 
-        shared_data.fp = fopen(filename, "wb");
-        if (!shared_data.fp)
+        /* Let the preallocation thread grow the output file ahead of the write thread, so FAT cluster allocation never stalls it mid-dump. */
+        shared_data.out_path = filename;
+        shared_data.prealloc_goal = ((g_appendKeyArea ? sizeof(GameCardKeyArea) : 0) + (shared_data.skip_padding ? shared_data.trimmed_size : shared_data.total_size));
+    }
+
+    /* A single hash stage handles every enabled digest. Resolved after the checkpoint logic - resumed sessions may have dropped the SHA digests. */
+    bool use_hash_stage = (g_calcCrc || shared_data.calc_sha256 || shared_data.calc_sha1);
+
+    /* Announce the file transfer to the USB host. Carried out after the file-side setup, so its failure paths can't leave the host waiting for data. */
+    if (useUsbHost() || shared_data.dual_output)
+    {
+        /* On dual output dumps, only the file name itself is sent to the USB host - the directory prefix belongs to the local output storage. */
+        const char *usb_filename = (shared_data.dual_output ? (strrchr(filename, '/') + 1) : filename);
+
+        if (!usbSendFilePropertiesCommon(gc_size, usb_filename))
         {
-            consolePrint("failed to open \"%s\" for writing!\n", filename);
+            consolePrint("failed to send file properties for \"%s\"!\n", usb_filename);
             goto end;
         }
 
-        if (g_appendKeyArea && fwrite(&gc_key_area, 1, sizeof(GameCardKeyArea), shared_data.fp) != sizeof(GameCardKeyArea))
+        if (g_appendKeyArea && !usbSendFileData(&gc_key_area, sizeof(GameCardKeyArea)))
         {
-            consolePrint("failed to write gamecard key area data!\n");
+            consolePrint("failed to send gamecard key area data!\n");
             goto end;
         }
     }
 
+    /* Open the chrome-trace sink and label its timeline lanes. The dump still runs if the trace file can't be created - the timeline is a diagnostic aid, not dump output. */
+    if (g_genTrace)
+    {
+        shared_data.trace_enabled = logOpenTraceFile();
+
+        if (shared_data.trace_enabled)
+        {
+            logWriteTraceThreadName(TRACE_LANE_READ, "read");
+            logWriteTraceThreadName(TRACE_LANE_WRITE, useUsbHost() ? "usb write" : "file write");
+            if (shared_data.dual_output) logWriteTraceThreadName(TRACE_LANE_USB_WRITE, "usb write");
+            if (use_hash_stage) logWriteTraceThreadName(TRACE_LANE_HASH, "hash");
+        } else {
+            consolePrint("failed to open trace file - continuing without a trace timeline\n");
+        }
+    }
+
     consolePrint("creating threads\n");
+    shared_data.trace_start_tick = armGetSystemTick();
     utilsCreateThread(&read_thread, read_thread_func, &shared_data, 2);
     utilsCreateThread(&write_thread, write_thread_func, &shared_data, 2);
+    if (shared_data.dual_output) utilsCreateThread(&usb_write_thread, usb_write_thread_func, &shared_data, 2);
+    if (use_hash_stage) utilsCreateThread(&hash_thread, hash_thread_func, &shared_data, 2);
+    if (shared_data.prealloc_goal) utilsCreateThread(&prealloc_thread, prealloc_thread_func, &shared_data, 2);
 
     u8 prev_time = 0;
     u64 prev_size = 0;
     u8 percent = 0;
 
+    UtilsProgressStats progress_stats = {0};
+    char sparkline[UTILS_PROGRESS_HISTORY_SIZE + 1] = {0};
+
     time_t start = 0, btn_cancel_start_tmr = 0, btn_cancel_end_tmr = 0;
-    bool btn_cancel_cur_state = false, btn_cancel_prev_state = false;
+    bool btn_cancel_cur_state = false, btn_cancel_prev_state = false, show_stage_stats = false;
 
-    consolePrint("hold b to cancel\n\n");
+    consolePrint("hold b to cancel | press y to toggle the stage stats overlay\n\n");
     consoleRefresh();
 
     start = time(NULL);
+    u64 start_tick = armGetSystemTick();
 
     while(shared_data.data_written < shared_data.total_size)
     {
-        if (shared_data.read_error || shared_data.write_error) break;
+        if (atomic_load(&shared_data.read_error) || atomic_load(&shared_data.write_error) || atomic_load(&shared_data.usb_write_error)) break;
 
         struct tm ts = {0};
         time_t now = time(NULL);
@@ -1026,6 +1362,8 @@ static bool saveGameCardImage(void)
         utilsScanPads();
         btn_cancel_cur_state = (utilsGetButtonsHeld() & HidNpadButton_B);
 
+        if (utilsGetButtonsDown() & HidNpadButton_Y) show_stage_stats ^= true;
+
         if (btn_cancel_cur_state && btn_cancel_cur_state != btn_cancel_prev_state)
         {
             btn_cancel_start_tmr = now;
@@ -1035,9 +1373,11 @@ static bool saveGameCardImage(void)
             btn_cancel_end_tmr = now;
             if ((btn_cancel_end_tmr - btn_cancel_start_tmr) >= 3)
             {
-                mutexLock(&g_fileMutex);
-                shared_data.transfer_cancelled = true;
-                mutexUnlock(&g_fileMutex);
+                atomic_store(&shared_data.transfer_cancelled, true);
+
+                /* Abort any in-flight USB transfer right away - a stage thread may be blocked on it, unable to notice the cancel flag until it returns. */
+                if (useUsbHost() || shared_data.dual_output) usbCancelFileTransfer();
+
                 break;
             }
         } else {
@@ -1053,7 +1393,44 @@ static bool saveGameCardImage(void)
         prev_time = ts.tm_sec;
         prev_size = size;
 
+        /* Feed the instrumentation surface at the same cadence as the progress frame, so the sparkline history spans the last UTILS_PROGRESS_HISTORY_SIZE seconds. */
+        utilsUpdateProgressStats(&progress_stats, size);
+        utilsGenerateProgressSparkline(&progress_stats, sparkline, sizeof(sparkline));
+
+        u64 eta_secs = 0;
+        bool eta_valid = utilsGetProgressEta(&progress_stats, size, shared_data.total_size, &eta_secs);
+
         consolePrint("%lu / %lu (%u%%) | Time elapsed: %lu\n", size, shared_data.total_size, percent, (now - start));
+
+        consolePrint("%.2lf MiB/s | eta: ", utilsGetProgressRate(&progress_stats) / (double)0x100000);
+        if (eta_valid)
+        {
+            consolePrint("%02lu:%02lu:%02lu", eta_secs / 3600, (eta_secs % 3600) / 60, eta_secs % 60);
+        } else {
+            consolePrint("--:--:--");
+        }
+        consolePrint(" | [%s]\n", sparkline);
+
+        /* Stage stats overlay: per-stage busy percentages relative to the session wall clock. The stage closest to 100%% is the pipeline bottleneck. */
+        if (show_stage_stats)
+        {
+            u64 elapsed_ns = armTicksToNs(armGetSystemTick() - start_tick);
+            if (elapsed_ns)
+            {
+                consolePrint("stage busy: read %lu%% | %s write %lu%%", (atomic_load(&shared_data.read_busy_ns) * 100) / elapsed_ns, useUsbHost() ? "usb" : "file", \
+                             (atomic_load(&shared_data.write_busy_ns) * 100) / elapsed_ns);
+                if (shared_data.dual_output) consolePrint(" | usb write %lu%%", (atomic_load(&shared_data.usb_write_busy_ns) * 100) / elapsed_ns);
+                if (use_hash_stage) consolePrint(" | hash %lu%%", (atomic_load(&shared_data.hash_busy_ns) * 100) / elapsed_ns);
+                consolePrint("\n");
+
+                /* Per-sink effective rates: bytes delivered over the time each sink actually spent writing. Unlike the smoothed overall rate, these aren't diluted by stalls in other stages. */
+                u64 write_busy_ns = atomic_load(&shared_data.write_busy_ns), usb_write_busy_ns = atomic_load(&shared_data.usb_write_busy_ns);
+                consolePrint("sink rate: %s %.2lf MiB/s", useUsbHost() ? "usb" : "file", write_busy_ns ? (((double)size * 1000000000.0) / ((double)write_busy_ns * (double)0x100000)) : 0.0);
+                if (shared_data.dual_output) consolePrint(" | usb %.2lf MiB/s", usb_write_busy_ns ? (((double)size * 1000000000.0) / ((double)usb_write_busy_ns * (double)0x100000)) : 0.0);
+                consolePrint("\n");
+            }
+        }
+
         consoleRefresh();
     }
 
@@ -1065,41 +1442,116 @@ static bool saveGameCardImage(void)
     utilsJoinThread(&write_thread);
     consolePrint("write_thread done: %lu\n", time(NULL));
 
-    if (shared_data.read_error || shared_data.write_error)
+    if (shared_data.dual_output)
     {
-        consolePrint("i/o error\n");
-        goto end;
+        utilsJoinThread(&usb_write_thread);
+        consolePrint("usb_write_thread done: %lu\n", time(NULL));
+    }
+
+    if (use_hash_stage)
+    {
+        utilsJoinThread(&hash_thread);
+        consolePrint("hash_thread done: %lu\n", time(NULL));
     }
 
-    if (shared_data.transfer_cancelled)
+    if (shared_data.prealloc_goal)
+    {
+        utilsJoinThread(&prealloc_thread);
+        consolePrint("prealloc_thread done: %lu\n", time(NULL));
+    }
+
+    /* Check the cancel flag first: aborting an in-flight USB transfer makes the blocked send call fail, so stage errors are expected on this path. */
+    if (atomic_load(&shared_data.transfer_cancelled))
     {
         consolePrint("process cancelled\n");
         goto end;
     }
 
+    if (atomic_load(&shared_data.read_error) || atomic_load(&shared_data.write_error) || atomic_load(&shared_data.usb_write_error))
+    {
+        consolePrint("i/o error\n");
+        goto end;
+    }
+
     consolePrint("process completed in %lu seconds\n", start);
     success = true;
 
     if (g_calcCrc)
     {
+        /* Combine the key area checksum with the gamecard data checksum. The hash thread only ever checksums each block once. */
+        if (g_appendKeyArea) shared_data.full_xci_crc = utilsCombineCrc32(shared_data.full_xci_crc, shared_data.xci_crc, shared_data.total_size);
+
         if (g_appendKeyArea) consolePrint("key area crc: %08X | ", key_area_crc);
         consolePrint("xci crc: %08X", shared_data.xci_crc);
         if (g_appendKeyArea) consolePrint(" | xci crc (with key area): %08X", shared_data.full_xci_crc);
         consolePrint("\n");
+
+        /* Look up the calculated checksum in the No-Intro datfile index, if one is available. */
+        /* The first lookup after a datfile update pays for the XML parse - every other lookup just loads the sorted binary cache generated from it. */
+        if (datfileInitialize())
+        {
+            const char *release_name = NULL;
+
+            if (datfileLookupCrc32(shared_data.xci_crc, shared_data.total_size, &release_name) || datfileLookupCrc32(shared_data.xci_crc, 0, &release_name))
+            {
+                consolePrint("verified against datfile: %s\n", release_name);
+            } else {
+                consolePrint("xci crc not found in datfile\n");
+            }
+        }
+    }
+
+    if (shared_data.calc_sha256 || shared_data.calc_sha1)
+    {
+        char digest_str[(SHA256_HASH_SIZE * 2) + 1] = {0};
+
+        /* Both digests cover the gamecard image only, matching the data range behind 'xci_crc'. */
+        if (shared_data.calc_sha256)
+        {
+            utilsGenerateHexStringFromData(digest_str, sizeof(digest_str), shared_data.xci_sha256, sizeof(shared_data.xci_sha256), false);
+            consolePrint("xci sha256: %s\n", digest_str);
+        }
+
+        if (shared_data.calc_sha1)
+        {
+            utilsGenerateHexStringFromData(digest_str, sizeof(digest_str), shared_data.xci_sha1, sizeof(shared_data.xci_sha1), false);
+            consolePrint("xci sha1: %s\n", digest_str);
+        }
     }
 
 end:
     consoleRefresh();
 
+    /* Terminate and close the trace timeline. Carried out after the stage threads have joined, so no further events can show up. */
+    if (shared_data.trace_enabled) logCloseTraceFile();
+
     if (shared_data.fp)
     {
         fclose(shared_data.fp);
         shared_data.fp = NULL;
     }
 
-    if (!success && !useUsbHost()) utilsRemoveConcatenationFile(filename);
+    if (!success && !useUsbHost())
+    {
+        if (shared_data.checkpoint_path && utilsCheckIfFileExists(shared_data.checkpoint_path))
+        {
+            /* Keep the partial dump data around - the next attempt will pick it up through the checkpoint. */
+            consolePrint("a dump checkpoint is available - restart this dump to resume from it\n");
+        } else {
+            utilsRemoveConcatenationFile(filename);
+        }
+    }
 
-    if (shared_data.data) free(shared_data.data);
+    if (shared_data.checkpoint_path)
+    {
+        if (success) remove(shared_data.checkpoint_path);
+        free(shared_data.checkpoint_path);
+    }
+
+    for(u32 i = 0; i < RING_BUFFER_COUNT; i++)
+    {
+        if (shared_data.buf[i]) free(shared_data.buf[i]);
+    }
 
     if (filename) free(filename);
 
@@ -1140,6 +1592,159 @@ end:
     return success;
 }
 
+static bool verifyGameCardNcaHashTrees(void)
+{
+    TitleApplicationMetadata **app_metadata = NULL;
+    u32 app_metadata_count = 0, total_content_count = 0, ctx_idx = 0;
+
+    TitleInfo **title_infos = NULL;
+    NcaContext *nca_ctx = NULL;
+    NcaContextBatchEntry *init_entries = NULL;
+    NcaVerifyBatchEntry *verify_entries = NULL;
+
+    u32 verify_count = 0, verify_idx = 0, failed = 0;
+    time_t start = 0;
+
+    bool success = false;
+
+    consolePrint("gamecard nca hash tree verification\nno data is dumped by this process - nca contents are read, hashed and discarded\n\n");
+
+    app_metadata = titleGetGameCardApplicationMetadataEntries(&app_metadata_count);
+    if (!app_metadata)
+    {
+        consolePrint("failed to retrieve gamecard application metadata\n");
+        goto end;
+    }
+
+    title_infos = calloc(app_metadata_count, sizeof(TitleInfo*));
+    if (!title_infos)
+    {
+        consolePrint("failed to allocate title info array\n");
+        goto end;
+    }
+
+    /* Retrieve title info for every application in the inserted gamecard. */
+    for(u32 i = 0; i < app_metadata_count; i++)
+    {
+        title_infos[i] = titleGetInfoFromStorageByTitleId(NcmStorageId_GameCard, app_metadata[i]->title_id);
+        if (title_infos[i]) total_content_count += title_infos[i]->content_count;
+    }
+
+    if (!total_content_count)
+    {
+        consolePrint("no gamecard contents available\n");
+        goto end;
+    }
+
+    nca_ctx = ncaAllocateContexts(total_content_count);
+    init_entries = calloc(total_content_count, sizeof(NcaContextBatchEntry));
+    verify_entries = calloc(total_content_count, sizeof(NcaVerifyBatchEntry));
+    if (!nca_ctx || !init_entries || !verify_entries)
+    {
+        consolePrint("failed to allocate nca context data\n");
+        goto end;
+    }
+
+    /* Initialize every NCA context in a single batch - the initializer fans the work out across its own worker threads. */
+    for(u32 i = 0; i < app_metadata_count; i++)
+    {
+        TitleInfo *title_info = title_infos[i];
+        if (!title_info) continue;
+
+        for(u32 j = 0; j < title_info->content_count; j++)
+        {
+            NcaContextBatchEntry *entry = &(init_entries[ctx_idx]);
+
+            entry->nca_ctx = &(nca_ctx[ctx_idx]);
+            entry->storage_id = NcmStorageId_GameCard;
+            entry->hfs_partition_type = GameCardHashFileSystemPartitionType_Secure;
+            entry->content_info = &(title_info->content_infos[j]);
+            entry->title_version = title_info->version.value;
+            entry->tik = NULL;
+
+            ctx_idx++;
+        }
+    }
+
+    consolePrint("initializing %u nca context(s)\n", total_content_count);
+    consoleRefresh();
+
+    ncaInitializeContextBatch(init_entries, total_content_count);
+
+    /* Verify every successfully initialized NCA context in a single batch. */
+    for(u32 i = 0; i < total_content_count; i++)
+    {
+        if (init_entries[i].success) verify_entries[verify_count++].nca_ctx = init_entries[i].nca_ctx;
+    }
+
+    if (!verify_count)
+    {
+        consolePrint("no nca context could be initialized\n");
+        goto end;
+    }
+
+    consolePrint("verifying %u nca(s) - this may take a while\n\n", verify_count);
+    consoleRefresh();
+
+    start = time(NULL);
+    ncaVerifyContextBatch(verify_entries, verify_count);
+    start = (time(NULL) - start);
+
+    /* Print per-NCA results. The verify entry order matches the init entry order, minus the entries that failed to initialize. */
+    ctx_idx = 0;
+
+    for(u32 i = 0; i < app_metadata_count; i++)
+    {
+        TitleInfo *title_info = title_infos[i];
+        if (!title_info) continue;
+
+        consolePrint("%016lX - %s\n", app_metadata[i]->title_id, app_metadata[i]->lang_entry.name);
+
+        for(u32 j = 0; j < title_info->content_count; j++, ctx_idx++)
+        {
+            NcaContext *cur_nca_ctx = &(nca_ctx[ctx_idx]);
+            const char *content_type_str = titleGetNcmContentTypeName(title_info->content_infos[j].content_type);
+
+            if (!init_entries[ctx_idx].success)
+            {
+                consolePrint("  %s (%s): context initialization failed\n", *(cur_nca_ctx->content_id_str) ? cur_nca_ctx->content_id_str : "<unknown>", content_type_str);
+                failed++;
+                continue;
+            }
+
+            bool nca_success = verify_entries[verify_idx++].success;
+            if (!nca_success) failed++;
+
+            consolePrint("  %s (%s): %s\n", cur_nca_ctx->content_id_str, content_type_str, nca_success ? "pass" : "FAIL");
+        }
+    }
+
+    consolePrint("\n%u / %u nca(s) passed verification in %lu seconds\n", total_content_count - failed, total_content_count, start);
+
+    success = (failed == 0);
+
+end:
+    consoleRefresh();
+
+    if (verify_entries) free(verify_entries);
+    if (init_entries) free(init_entries);
+    if (nca_ctx) ncaFreeContexts(nca_ctx, total_content_count);
+
+    if (title_infos)
+    {
+        for(u32 i = 0; i < app_metadata_count; i++)
+        {
+            if (title_infos[i]) titleFreeTitleInfo(&(title_infos[i]));
+        }
+
+        free(title_infos);
+    }
+
+    if (app_metadata) free(app_metadata);
+
+    return success;
+}
+
 static void changeKeyAreaOption(u32 idx)
 {
     g_appendKeyArea = (idx > 0);
@@ -1155,126 +1760,466 @@ static void changeTrimOption(u32 idx)
     g_trimDump = (idx > 0);
 }
 
+static void changeSkipPaddingOption(u32 idx)
+{
+    g_skipPadding = (idx > 0);
+}
+
 static void changeCrcOption(u32 idx)
 {
     g_calcCrc = (idx > 0);
 }
 
+static void changeSha256Option(u32 idx)
+{
+    g_calcSha256 = (idx > 0);
+}
+
+static void changeSha1Option(u32 idx)
+{
+    g_calcSha1 = (idx > 0);
+}
+
+static void changeDualOutputOption(u32 idx)
+{
+    g_dualOutput = (idx > 0);
+}
+
+static void changeTraceOption(u32 idx)
+{
+    g_genTrace = (idx > 0);
+}
+
 static void read_thread_func(void *arg)
 {
     ThreadSharedData *shared_data = (ThreadSharedData*)arg;
-    if (!shared_data || !shared_data->data || !shared_data->total_size)
+    if (!shared_data || !shared_data->buf[0] || !shared_data->total_size)
     {
-        shared_data->read_error = true;
+        atomic_store(&shared_data->read_error, true);
         goto end;
     }
 
-    u8 *buf = malloc(BLOCK_SIZE);
-    if (!buf)
-    {
-        shared_data->read_error = true;
-        goto end;
-    }
+    u64 offset = shared_data->resume_offset, blksize = shared_data->ring_slot_size;
+
+    u32 window_chunks = 0;
+    u64 window_read_ns = 0;
+    size_t window_read_stalls = 0, prev_write_stalls = 0, prev_write_busy_ns = 0, prev_write_count = atomic_load(&shared_data->write_count);
 
-    for(u64 offset = 0, blksize = BLOCK_SIZE; offset < shared_data->total_size; offset += blksize)
+    while(offset < shared_data->total_size)
     {
-        if (blksize > (shared_data->total_size - offset)) blksize = (shared_data->total_size - offset);
+        /* Clamp the current chunk so it neither crosses a checkpoint interval boundary nor the end of the dump. */
+        u64 chunk_size = blksize;
+        u64 boundary = (DUMP_CHECKPOINT_INTERVAL - (offset % DUMP_CHECKPOINT_INTERVAL));
+        if (chunk_size > boundary) chunk_size = boundary;
+        if (chunk_size > (shared_data->total_size - offset)) chunk_size = (shared_data->total_size - offset);
 
         /* Check if the transfer has been cancelled by the user */
-        if (shared_data->transfer_cancelled)
+        if (atomic_load(&shared_data->transfer_cancelled)) break;
+
+        /* Wait until a ring slot becomes available. A slot can only be reused after every consumer thread (write, USB write, hash) is done with it. */
+        bool stalled = false;
+
+        while((atomic_load(&shared_data->read_count) - atomic_load(&shared_data->write_count)) >= RING_BUFFER_COUNT || \
+              (shared_data->dual_output && (atomic_load(&shared_data->read_count) - atomic_load(&shared_data->usb_write_count)) >= RING_BUFFER_COUNT) || \
+              ((g_calcCrc || shared_data->calc_sha256 || shared_data->calc_sha1) && (atomic_load(&shared_data->read_count) - atomic_load(&shared_data->hash_count)) >= RING_BUFFER_COUNT))
         {
-            condvarWakeAll(&g_writeCondvar);
-            break;
+            if (atomic_load(&shared_data->write_error) || atomic_load(&shared_data->usb_write_error) || atomic_load(&shared_data->transfer_cancelled)) break;
+            stalled = true;
+            svcSleepThread(100000); // 100 us
         }
 
-        /* Read current data chunk */
-        shared_data->read_error = !gamecardReadStorage(buf, blksize, offset);
-        if (shared_data->read_error)
+        if (stalled) window_read_stalls++;
+
+        if (atomic_load(&shared_data->write_error) || atomic_load(&shared_data->usb_write_error) || atomic_load(&shared_data->transfer_cancelled)) break;
+
+        /* Read current data chunk straight into the ring slot, keeping track of the time spent doing so. */
+        size_t slot = (atomic_load(&shared_data->read_count) % RING_BUFFER_COUNT);
+        u8 *buf = (u8*)shared_data->buf[slot];
+
+        u64 read_start_tick = armGetSystemTick();
+
+        /* Split the read into fixed sub-chunks with cancellation checks in between, so a pending cancel request never has to wait out a full adaptive-size block. */
+        bool read_error = false, read_cancelled = false;
+
+        for(u64 sub_offset = 0; sub_offset < chunk_size; sub_offset += CANCEL_CHECK_SUBCHUNK_SIZE)
+        {
+            if (sub_offset && atomic_load(&shared_data->transfer_cancelled))
+            {
+                read_cancelled = true;
+                break;
+            }
+
+            u64 sub_size = (chunk_size - sub_offset);
+            if (sub_size > CANCEL_CHECK_SUBCHUNK_SIZE) sub_size = CANCEL_CHECK_SUBCHUNK_SIZE;
+
+            if (!gamecardReadStorage(buf + sub_offset, sub_size, offset + sub_offset))
+            {
+                read_error = true;
+                break;
+            }
+        }
+
+        if (read_error)
         {
-            condvarWakeAll(&g_writeCondvar);
+            atomic_store(&shared_data->read_error, true);
             break;
         }
 
+        if (read_cancelled) break;
+
+        u64 read_ns = armTicksToNs(armGetSystemTick() - read_start_tick);
+        window_read_ns += read_ns;
+        atomic_store(&shared_data->read_busy_ns, atomic_load(&shared_data->read_busy_ns) + read_ns);
+
+        if (shared_data->trace_enabled) logWriteTraceDurationEvent("gamecardReadStorage", TRACE_LANE_READ, armTicksToNs(read_start_tick - shared_data->trace_start_tick), read_ns);
+
         /* Remove certificate */
         if (!g_keepCertificate && offset == 0) memset(buf + GAMECARD_CERTIFICATE_OFFSET, 0xFF, sizeof(FsGameCardCertificate));
 
-        /* Update checksum */
-        if (g_calcCrc)
+        /* Publish the filled slot. The size must be visible before the counter update. */
+        shared_data->buf_size[slot] = chunk_size;
+        atomic_store(&shared_data->read_count, atomic_load(&shared_data->read_count) + 1);
+
+        /* Queue depth counter: filled slots not yet consumed by the write thread. A timeline stuck at RING_BUFFER_COUNT means the pipeline is write-bound; one stuck at 1 means it's read-bound. */
+        if (shared_data->trace_enabled) logWriteTraceCounterEvent("ring queue depth", armTicksToNs(armGetSystemTick() - shared_data->trace_start_tick), \
+                                                                 atomic_load(&shared_data->read_count) - atomic_load(&shared_data->write_count));
+
+        offset += chunk_size;
+
+        /* Adjust the effective block size once per window, based on pipeline stall feedback. */
+        if (++window_chunks < ADAPTIVE_BLOCK_WINDOW) continue;
+
+        size_t write_stalls = (atomic_load(&shared_data->write_stall_count) - prev_write_stalls);
+        size_t write_busy_ns = (atomic_load(&shared_data->write_busy_ns) - prev_write_busy_ns);
+        size_t write_chunks = (atomic_load(&shared_data->write_count) - prev_write_count);
+
+        prev_write_stalls += write_stalls;
+        prev_write_busy_ns += write_busy_ns;
+        prev_write_count += write_chunks;
+
+        if (write_stalls > (ADAPTIVE_BLOCK_WINDOW / 4) && blksize > ADAPTIVE_BLOCK_SIZE_MIN)
+        {
+            /* The write thread keeps starving: reads are the bottleneck and/or spiky. Publish smaller chunks so buffered data reaches it earlier. */
+            blksize >>= 1;
+        } else
+        if (!write_stalls && blksize < shared_data->ring_slot_size)
+        {
+            /* Balanced pipeline. Grow the chunks back to cut down on per-chunk overhead (USB round trips, filesystem calls). */
+            blksize <<= 1;
+        }
+
+        LOG_MSG_DEBUG("Block size: 0x%lX. Avg read latency: %lu ns. Avg write latency: %lu ns. Read stalls: %lu. Write stalls: %lu.", blksize, window_read_ns / window_chunks, \
+                      write_chunks ? (write_busy_ns / write_chunks) : 0, window_read_stalls, write_stalls);
+
+        window_chunks = 0;
+        window_read_ns = 0;
+        window_read_stalls = 0;
+    }
+
+end:
+    threadExit();
+}
+
+static void write_thread_func(void *arg)
+{
+    ThreadSharedData *shared_data = (ThreadSharedData*)arg;
+    if (!shared_data || !shared_data->buf[0])
+    {
+        atomic_store(&shared_data->write_error, true);
+        goto end;
+    }
+
+    u64 offset = shared_data->resume_offset;
+    size_t consumed = atomic_load(&shared_data->write_count);
+    bool file_pos_synced = true, usb_in_flight = false;
+
+    while(shared_data->data_written < shared_data->total_size)
+    {
+        /* Wait until the read thread publishes a filled ring slot. */
+        bool stalled = false;
+
+        while(consumed == atomic_load(&shared_data->read_count))
         {
-            shared_data->xci_crc = crc32CalculateWithSeed(shared_data->xci_crc, buf, blksize);
-            if (g_appendKeyArea) shared_data->full_xci_crc = crc32CalculateWithSeed(shared_data->full_xci_crc, buf, blksize);
+            if (atomic_load(&shared_data->read_error) || atomic_load(&shared_data->usb_write_error) || atomic_load(&shared_data->transfer_cancelled)) break;
+            stalled = true;
+            svcSleepThread(100000); // 100 us
         }
 
-        /* Wait until the previous data chunk has been written */
-        mutexLock(&g_fileMutex);
+        /* Let the read thread know we starved on this chunk. It uses this as feedback to adapt its block size. */
+        if (stalled) atomic_store(&shared_data->write_stall_count, atomic_load(&shared_data->write_stall_count) + 1);
+
+        if (atomic_load(&shared_data->read_error) || atomic_load(&shared_data->usb_write_error) || atomic_load(&shared_data->transfer_cancelled))
+        {
+            /* On dual output dumps, the USB write thread owns the USB session and takes care of cancelling the host-side transfer. */
+            if (atomic_load(&shared_data->transfer_cancelled) && useUsbHost()) usbCancelFileTransfer();
+            break;
+        }
 
-        if (shared_data->data_size && !shared_data->write_error) condvarWait(&g_readCondvar, &g_fileMutex);
+        /* Write current file data chunk straight from the ring slot. */
+        size_t slot = (consumed % RING_BUFFER_COUNT);
+        size_t slot_size = shared_data->buf_size[slot];
+        bool write_error = false, write_cancelled = false;
 
-        if (shared_data->write_error)
+        if (shared_data->skip_padding && offset >= shared_data->trimmed_size && utilsIsPaddingBlock(shared_data->buf[slot], slot_size))
         {
-            mutexUnlock(&g_fileMutex);
+            /* Skip writing this padding block. The file position must be resynced if a non-padding block shows up later on. */
+            file_pos_synced = false;
+        } else {
+            if (!file_pos_synced)
+            {
+                write_error = (fseeko(shared_data->fp, (off_t)((g_appendKeyArea ? sizeof(GameCardKeyArea) : 0) + offset), SEEK_SET) != 0);
+                file_pos_synced = !write_error;
+            }
+
+            if (!write_error)
+            {
+                u64 write_start_tick = armGetSystemTick();
+
+                if (useUsbHost())
+                {
+                    /* Ring slots are page aligned, so usbSendFileDataAsync() posts them to the input endpoint as-is - the data never gets copied into the USB transfer buffer. */
+                    write_error = !usbSendFileDataAsync(shared_data->buf[slot], slot_size);
+                } else {
+                    /* Split the write into fixed sub-chunks with cancellation checks in between - same rationale as the read thread. */
+                    /* USB sends don't need this: usbCancelFileTransfer() aborts an in-flight transfer on its own. */
+                    for(size_t sub_offset = 0; sub_offset < slot_size && !write_error; sub_offset += CANCEL_CHECK_SUBCHUNK_SIZE)
+                    {
+                        if (sub_offset && atomic_load(&shared_data->transfer_cancelled))
+                        {
+                            write_cancelled = true;
+                            break;
+                        }
+
+                        size_t sub_size = (slot_size - sub_offset);
+                        if (sub_size > CANCEL_CHECK_SUBCHUNK_SIZE) sub_size = CANCEL_CHECK_SUBCHUNK_SIZE;
+
+                        write_error = (fwrite((u8*)shared_data->buf[slot] + sub_offset, 1, sub_size, shared_data->fp) != sub_size);
+                    }
+                }
+
+                u64 write_ns = armTicksToNs(armGetSystemTick() - write_start_tick);
+                atomic_store(&shared_data->write_busy_ns, atomic_load(&shared_data->write_busy_ns) + write_ns);
+
+                if (shared_data->trace_enabled) logWriteTraceDurationEvent(useUsbHost() ? "usbSendFileDataAsync" : "fwrite", TRACE_LANE_WRITE, \
+                                                                           armTicksToNs(write_start_tick - shared_data->trace_start_tick), write_ns);
+            }
+        }
+
+        if (write_error)
+        {
+            atomic_store(&shared_data->write_error, true);
             break;
         }
 
-        /* Copy current file data chunk to the shared buffer */
-        memcpy(shared_data->data, buf, blksize);
-        shared_data->data_size = blksize;
+        /* Bail out before accounting for this chunk - a partially written slot must never make it into a checkpoint. */
+        if (write_cancelled) break;
 
-        /* Wake up the write thread to continue writing data */
-        mutexUnlock(&g_fileMutex);
-        condvarWakeAll(&g_writeCondvar);
+        shared_data->data_written += slot_size;
+        offset += slot_size;
+        consumed++;
+
+        if (useUsbHost())
+        {
+            /* Release every slot but the current one, which stays owned by the USB driver until its transfer completes. */
+            /* usbSendFileDataAsync() waits on the previous in-flight transfer before queueing a new one, so all previously consumed slots are safe to reuse at this point. */
+            atomic_store(&shared_data->write_count, consumed - 1);
+            usb_in_flight = true;
+        } else {
+            /* Release the slot so the read thread can reuse it. */
+            atomic_store(&shared_data->write_count, consumed);
+        }
+
+        /* Persist a dump checkpoint at fixed intervals. If a CRC32 is being calculated, the hash thread handles this instead - it owns the checksum state. */
+        if (!g_calcCrc && shared_data->checkpoint_path && offset < shared_data->total_size && IS_ALIGNED(offset, DUMP_CHECKPOINT_INTERVAL)) saveDumpCheckpoint(shared_data, offset);
     }
 
-    free(buf);
+    /* Wait for the last queued USB transfer to complete and verify the host device response, then release the final ring slot. */
+    if (usb_in_flight)
+    {
+        if (usbFlushPendingTransfers())
+        {
+            atomic_store(&shared_data->write_count, consumed);
+        } else {
+            atomic_store(&shared_data->write_error, true);
+        }
+    }
 
 end:
     threadExit();
 }
 
-static void write_thread_func(void *arg)
+static void usb_write_thread_func(void *arg)
 {
     ThreadSharedData *shared_data = (ThreadSharedData*)arg;
-    if (!shared_data || !shared_data->data)
+    if (!shared_data || !shared_data->buf[0])
     {
-        shared_data->write_error = true;
+        atomic_store(&shared_data->usb_write_error, true);
         goto end;
     }
 
-    while(shared_data->data_written < shared_data->total_size)
+    size_t data_sent = 0, consumed = atomic_load(&shared_data->usb_write_count);
+    bool in_flight = false;
+
+    while(data_sent < shared_data->total_size)
     {
-        /* Wait until the current file data chunk has been read */
-        mutexLock(&g_fileMutex);
+        /* Wait until the read thread publishes a filled ring slot. */
+        while(consumed == atomic_load(&shared_data->read_count))
+        {
+            if (atomic_load(&shared_data->read_error) || atomic_load(&shared_data->write_error) || atomic_load(&shared_data->transfer_cancelled)) break;
+            svcSleepThread(100000); // 100 us
+        }
 
-        if (!shared_data->data_size && !shared_data->read_error) condvarWait(&g_writeCondvar, &g_fileMutex);
+        if (atomic_load(&shared_data->read_error) || atomic_load(&shared_data->write_error) || atomic_load(&shared_data->transfer_cancelled))
+        {
+            /* usbCancelFileTransfer() waits on any in-flight transfer before cancelling, so no ring slot is still owned by the USB driver afterwards. */
+            if (atomic_load(&shared_data->transfer_cancelled)) usbCancelFileTransfer();
+            break;
+        }
+
+        /* Queue current data chunk straight from the ring slot. The file write and hash threads consume the same slots independently. */
+        /* Ring slots are page aligned, so usbSendFileDataAsync() posts them to the input endpoint as-is - the data never gets copied into the USB transfer buffer. */
+        /* Padding blocks are never skipped here - the USB host always receives the full announced file size. */
+        size_t slot = (consumed % RING_BUFFER_COUNT);
+        size_t slot_size = shared_data->buf_size[slot];
 
-        if (shared_data->read_error || shared_data->transfer_cancelled)
+        u64 send_start_tick = armGetSystemTick();
+
+        if (!usbSendFileDataAsync(shared_data->buf[slot], slot_size))
         {
-            if (shared_data->transfer_cancelled && useUsbHost()) usbCancelFileTransfer();
-            mutexUnlock(&g_fileMutex);
+            atomic_store(&shared_data->usb_write_error, true);
             break;
         }
 
-        /* Write current file data chunk */
-        if (useUsbHost())
+        u64 send_ns = armTicksToNs(armGetSystemTick() - send_start_tick);
+        atomic_store(&shared_data->usb_write_busy_ns, atomic_load(&shared_data->usb_write_busy_ns) + send_ns);
+
+        if (shared_data->trace_enabled) logWriteTraceDurationEvent("usbSendFileDataAsync", TRACE_LANE_USB_WRITE, armTicksToNs(send_start_tick - shared_data->trace_start_tick), send_ns);
+
+        data_sent += slot_size;
+        consumed++;
+
+        /* Release every slot but the current one, which stays owned by the USB driver until its transfer completes. */
+        /* usbSendFileDataAsync() waits on the previous in-flight transfer before queueing a new one, so all previously consumed slots are safe to reuse at this point. */
+        atomic_store(&shared_data->usb_write_count, consumed - 1);
+        in_flight = true;
+    }
+
+    /* Wait for the last queued transfer to complete and verify the host device response, then release the final ring slot. */
+    if (in_flight)
+    {
+        if (usbFlushPendingTransfers())
         {
-            shared_data->write_error = !usbSendFileData(shared_data->data, shared_data->data_size);
+            atomic_store(&shared_data->usb_write_count, consumed);
         } else {
-            shared_data->write_error = (fwrite(shared_data->data, 1, shared_data->data_size, shared_data->fp) != shared_data->data_size);
+            atomic_store(&shared_data->usb_write_error, true);
         }
+    }
+
+end:
+    threadExit();
+}
+
+static void hash_thread_func(void *arg)
+{
+    ThreadSharedData *shared_data = (ThreadSharedData*)arg;
+    if (!shared_data || !shared_data->buf[0])
+    {
+        goto end;
+    }
+
+    size_t data_hashed = shared_data->resume_offset;
+
+    /* Multi-digest setup. Every requested digest gets updated from the same ring slot pass, so each dumped byte is only ever touched once by this stage. */
+    Sha256Context sha256_ctx = {0};
+    Sha1Context sha1_ctx = {0};
 
-        if (!shared_data->write_error)
+    if (shared_data->calc_sha256) sha256ContextCreate(&sha256_ctx);
+    if (shared_data->calc_sha1) sha1ContextCreate(&sha1_ctx);
+
+    const char *trace_label = ((shared_data->calc_sha256 || shared_data->calc_sha1) ? "multi-digest" : "crc32");
+
+    while(data_hashed < shared_data->total_size)
+    {
+        /* Wait until the read thread publishes a filled ring slot. */
+        while(atomic_load(&shared_data->hash_count) == atomic_load(&shared_data->read_count))
         {
-            shared_data->data_written += shared_data->data_size;
-            shared_data->data_size = 0;
+            if (atomic_load(&shared_data->read_error) || atomic_load(&shared_data->write_error) || atomic_load(&shared_data->usb_write_error) || atomic_load(&shared_data->transfer_cancelled)) break;
+            svcSleepThread(100000); // 100 us
         }
 
-        /* Wake up the read thread to continue reading data */
-        mutexUnlock(&g_fileMutex);
-        condvarWakeAll(&g_readCondvar);
+        if (atomic_load(&shared_data->hash_count) == atomic_load(&shared_data->read_count)) break;
 
-        if (shared_data->write_error) break;
+        /* Update checksums straight from the ring slot. The write thread consumes the same slots independently. */
+        size_t slot = (atomic_load(&shared_data->hash_count) % RING_BUFFER_COUNT);
+        size_t slot_size = shared_data->buf_size[slot];
+
+        u64 hash_start_tick = armGetSystemTick();
+
+        /* A single pass per block updates every enabled digest while its data is still hot in cache. */
+        /* crc32CalculateWithSeed() runs on the ARMv8 CRC32 instructions and both SHA digests run on the ARMv8 SHA instructions, courtesy of libnx. */
+        /* The key area checksum is folded into the full-image CRC32 via utilsCombineCrc32() once the dump completes. */
+        if (g_calcCrc) shared_data->xci_crc = crc32CalculateWithSeed(shared_data->xci_crc, shared_data->buf[slot], slot_size);
+        if (shared_data->calc_sha256) sha256ContextUpdate(&sha256_ctx, shared_data->buf[slot], slot_size);
+        if (shared_data->calc_sha1) sha1ContextUpdate(&sha1_ctx, shared_data->buf[slot], slot_size);
+
+        u64 hash_ns = armTicksToNs(armGetSystemTick() - hash_start_tick);
+        atomic_store(&shared_data->hash_busy_ns, atomic_load(&shared_data->hash_busy_ns) + hash_ns);
+
+        if (shared_data->trace_enabled) logWriteTraceDurationEvent(trace_label, TRACE_LANE_HASH, armTicksToNs(hash_start_tick - shared_data->trace_start_tick), hash_ns);
+
+        data_hashed += slot_size;
+
+        /* Release the slot so the read thread can reuse it. */
+        atomic_store(&shared_data->hash_count, atomic_load(&shared_data->hash_count) + 1);
+
+        /* Persist a dump checkpoint at fixed intervals, but only once the write thread has caught up - the serialized checksum state must not run ahead of the file contents. */
+        /* Checkpoints are only owned by this stage when a CRC32 is being calculated - the write thread takes care of them otherwise. */
+        if (g_calcCrc && shared_data->checkpoint_path && data_hashed < shared_data->total_size && IS_ALIGNED(data_hashed, DUMP_CHECKPOINT_INTERVAL) && \
+            data_hashed <= shared_data->data_written) saveDumpCheckpoint(shared_data, data_hashed);
     }
 
+    /* Finalize the SHA digests. Only meaningful if the whole image was hashed, which the main thread checks on its own through the stage error flags. */
+    if (shared_data->calc_sha256) sha256ContextGetHash(&sha256_ctx, shared_data->xci_sha256);
+    if (shared_data->calc_sha1) sha1ContextGetHash(&sha1_ctx, shared_data->xci_sha1);
+
 end:
     threadExit();
 }
+
+static void prealloc_thread_func(void *arg)
+{
+    ThreadSharedData *shared_data = (ThreadSharedData*)arg;
+    FILE *fp = NULL;
+    u64 cur_size = 0;
+
+    /* Open a dedicated file handle - ftruncate() calls must not mess with the file position used by the write thread. */
+    if (!shared_data || !shared_data->out_path || !shared_data->prealloc_goal || !(fp = fopen(shared_data->out_path, "rb+"))) goto end;
+
+    fseeko(fp, 0, SEEK_END);
+    cur_size = (u64)ftello(fp);
+
+    while(cur_size < shared_data->prealloc_goal)
+    {
+        if (atomic_load(&shared_data->read_error) || atomic_load(&shared_data->write_error) || atomic_load(&shared_data->usb_write_error) || atomic_load(&shared_data->transfer_cancelled)) break;
+
+        /* Keep up to a full FAT32 part file worth of clusters allocated ahead of the write thread. */
+        u64 target = ((g_appendKeyArea ? sizeof(GameCardKeyArea) : 0) + shared_data->data_written + PREALLOC_WINDOW_SIZE);
+        if (target > shared_data->prealloc_goal) target = shared_data->prealloc_goal;
+
+        if (target <= cur_size)
+        {
+            svcSleepThread(100000000); // 100 ms
+            continue;
+        }
+
+        /* Bail out if the extent can't be grown - the write thread will just fall back to allocating clusters on its own. */
+        if (ftruncate(fileno(fp), (off_t)target) != 0) break;
+
+        cur_size = target;
+    }
+
+end:
+    if (fp) fclose(fp);
+
+    threadExit();
+}
@@ -29,8 +29,20 @@
 #include "cert.h"
 #include "usb.h"
 
-#define BLOCK_SIZE  USB_TRANSFER_BUFFER_SIZE
-#define OUTPATH     "/nsp/"
+#include <zstd.h>
+
+#define BLOCK_SIZE          USB_TRANSFER_BUFFER_SIZE
+#define OUTPATH             "/nsp/"
+
+/* Depth of the per-NCA buffer ring shared by the read/patch/hash stage and the output stage. */
+#define RING_BUFFER_COUNT   4
+
+/* NSZ-style compressed output. Eligible NCAs are stored as NCZ entries: the NCA header area is kept verbatim, followed by a section block */
+/* that describes the crypto parameters for each NCA FS section, followed by a single zstd stream that holds the decrypted section data. */
+#define NCZ_SECTION_MAGIC               "NCZSECTN"
+#define NCZ_UNCOMPRESSABLE_HEADER_SIZE  0x4000      /* Amount of NCA data stored verbatim at the start of each NCZ entry. */
+#define NSZ_COMPRESSION_LEVEL           8           /* zstd compression level. Balances console CPU time against compression ratio. */
+#define NSZ_COMPRESSION_THRESHOLD       0x1000000   /* 16 MiB. Smaller NCAs are stored uncompressed - the framing overhead isn't worth it. */
 
 bool g_borealisInitialized = false;
 
@@ -45,6 +57,53 @@ typedef struct
     bool transfer_cancelled;
 } ThreadSharedData;
 
+/// Connects the per-NCA read/patch/hash stage to the output stage. Chunks flow through a small lock-free ring of page-aligned buffers.
+typedef struct
+{
+    NcaContext *nca_ctx;                    ///< NCA being streamed.
+    ContentMetaContext *cnmt_ctx;           ///< Used to apply the CNMT patch to Meta NCA chunks.
+    ThreadSharedData *shared_data;          ///< Used to honor transfer cancellations.
+    void *buf[RING_BUFFER_COUNT];           ///< Ring slots. Each one holds up to BLOCK_SIZE bytes.
+    size_t buf_size[RING_BUFFER_COUNT];     ///< Amount of data held by each ring slot.
+    atomic_size_t read_count;               ///< Total slots filled by the read stage. Only written by the read stage.
+    atomic_size_t write_count;              ///< Total slots consumed by the output stage. Only written by the output stage.
+    atomic_bool read_error;
+    atomic_bool write_error;
+    u8 sha256_hash[SHA256_HASH_SIZE];       ///< Filled by the read stage right before it exits.
+} NcaStreamContext;
+
+/// Header for the NCZ section block placed right after the verbatim NCA header area in compressed NCA entries.
+typedef struct
+{
+    u8 magic[8];        ///< "NCZSECTN".
+    u64 section_count;  ///< Number of NczSection elements following this header.
+} NczSectionBlock;
+
+/// Describes the crypto parameters for a single byte range from a compressed NCA entry.
+/// The section ranges cover the whole NCA past the verbatim header area - re-encrypting each range with its key and counter rebuilds the original NCA.
+typedef struct
+{
+    u64 offset;                         ///< Offset for this section, relative to the start of the original NCA.
+    u64 size;                           ///< Section size.
+    u64 crypto_type;                    ///< NcaEncryptionType.
+    u64 padding;
+    u8 crypto_key[AES_128_KEY_SIZE];    ///< AES-128-CTR key the section data was encrypted with. Zeroed out for plaintext sections.
+    u8 crypto_counter[AES_BLOCK_SIZE];  ///< Base AES-128-CTR counter for this section, with the block offset part zeroed out.
+} NczSection;
+
+/// Connects the per-NCA read/patch/hash stage to the output stage through a zstd compression stage. Only used when NSZ output is enabled.
+typedef struct
+{
+    NcaStreamContext *stream;               ///< Input ring, fed by the read/patch/hash stage.
+    void *buf[RING_BUFFER_COUNT];           ///< Output ring slots. Each one holds up to BLOCK_SIZE bytes of NCZ data.
+    size_t buf_size[RING_BUFFER_COUNT];     ///< Amount of data held by each output ring slot.
+    size_t cur_slot_used;                   ///< Amount of data appended so far to the output ring slot being filled. Only used by the compression stage.
+    atomic_size_t comp_count;               ///< Total slots filled by the compression stage. Only written by the compression stage.
+    atomic_size_t write_count;              ///< Total slots consumed by the output stage. Only written by the output stage.
+    atomic_bool comp_error;
+    atomic_bool finished;                   ///< Set to true by the compression stage right before it exits.
+} NszCompressContext;
+
 static const char *dump_type_strings[] = {
     "dump base application",
     "dump update",
@@ -68,6 +127,8 @@ static options_t options[] = {
     { "enable video capture", 0 },
     { "disable hdcp", 0 },
     { "append authoringtool data", 1 },
+    { "nsz compression (sd/ums only)", 0 },
+    { "incremental dump (usb only)", 0 },
     { "output device", 0 }
 };
 
@@ -124,6 +185,341 @@ static void consoleRefresh(void)
     mutexUnlock(&g_conMutex);
 }
 
+static void nca_stream_thread_func(void *arg)
+{
+    NcaStreamContext *stream = (NcaStreamContext*)arg;
+    NcaContext *cur_nca_ctx = stream->nca_ctx;
+    ThreadSharedData *shared_data = stream->shared_data;
+
+    Sha256Context sha256_ctx = {0};
+    sha256ContextCreate(&sha256_ctx);
+
+    bool dirty_header = ncaIsHeaderDirty(cur_nca_ctx);
+
+    for(u64 offset = 0, blksize = BLOCK_SIZE; offset < cur_nca_ctx->content_size; offset += blksize)
+    {
+        if ((cur_nca_ctx->content_size - offset) < blksize) blksize = (cur_nca_ctx->content_size - offset);
+
+        // bail out if the transfer was cancelled or the output stage failed
+        if (shared_data->transfer_cancelled || atomic_load(&stream->write_error)) break;
+
+        // wait until a ring slot becomes available
+        while((atomic_load(&stream->read_count) - atomic_load(&stream->write_count)) >= RING_BUFFER_COUNT)
+        {
+            if (shared_data->transfer_cancelled || atomic_load(&stream->write_error)) break;
+            svcSleepThread(100000); // 100 us
+        }
+
+        if (shared_data->transfer_cancelled || atomic_load(&stream->write_error)) break;
+
+        size_t slot = (atomic_load(&stream->read_count) % RING_BUFFER_COUNT);
+        u8 *buf = (u8*)stream->buf[slot];
+
+        // read nca chunk
+        if (!ncaReadContentFile(cur_nca_ctx, buf, blksize, offset))
+        {
+            consolePrint("nca read failed at 0x%lX for \"%s\"\n", offset, cur_nca_ctx->content_id_str);
+            atomic_store(&stream->read_error, true);
+            break;
+        }
+
+        if (dirty_header)
+        {
+            // write re-encrypted headers
+            if (!cur_nca_ctx->header_written) ncaWriteEncryptedHeaderDataToMemoryBuffer(cur_nca_ctx, buf, blksize, offset);
+
+            if (cur_nca_ctx->content_type_ctx_patch)
+            {
+                // write content type context patch
+                switch(cur_nca_ctx->content_type)
+                {
+                    case NcmContentType_Meta:
+                        cnmtWriteNcaPatch(stream->cnmt_ctx, buf, blksize, offset);
+                        break;
+                    case NcmContentType_Control:
+                        nacpWriteNcaPatch((NacpContext*)cur_nca_ctx->content_type_ctx, buf, blksize, offset);
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            // update flag to avoid entering this code block if it's not needed anymore
+            dirty_header = (!cur_nca_ctx->header_written || cur_nca_ctx->content_type_ctx_patch);
+        }
+
+        // update hash calculation
+        sha256ContextUpdate(&sha256_ctx, buf, blksize);
+
+        // publish the filled slot to the output stage
+        stream->buf_size[slot] = blksize;
+        atomic_store(&stream->read_count, atomic_load(&stream->read_count) + 1);
+    }
+
+    // get hash
+    sha256ContextGetHash(&sha256_ctx, stream->sha256_hash);
+
+    threadExit();
+}
+
+static bool nszIsNcaCompressible(NcaContext *nca_ctx)
+{
+    if (!nca_ctx || nca_ctx->content_size < NSZ_COMPRESSION_THRESHOLD || nca_ctx->format_version == NcaVersion_Nca0) return false;
+
+    u64 cur_offset = NCZ_UNCOMPRESSABLE_HEADER_SIZE;
+
+    for(u8 i = 0; i < NCA_FS_HEADER_COUNT; i++)
+    {
+        NcaFsSectionContext *fs_ctx = &(nca_ctx->fs_ctx[i]);
+        if (!fs_ctx->enabled) continue;
+
+        // only plaintext and regular aes-128-ctr sections can be expressed in the ncz section block
+        // sparse sections don't hold their full data in the content file, and patch sections use per-block counter values
+        if (fs_ctx->has_sparse_layer || (fs_ctx->encryption_type != NcaEncryptionType_None && fs_ctx->encryption_type != NcaEncryptionType_AesCtr && \
+            fs_ctx->encryption_type != NcaEncryptionType_AesCtrSkipLayerHash)) return false;
+
+        // sections must be laid out in ascending order, aligned to the aes block size and fully contained within the content file
+        if (fs_ctx->section_offset < cur_offset || !IS_ALIGNED(fs_ctx->section_offset, AES_BLOCK_SIZE) || \
+            (fs_ctx->section_offset + fs_ctx->section_size) > nca_ctx->content_size) return false;
+
+        cur_offset = (fs_ctx->section_offset + fs_ctx->section_size);
+    }
+
+    return true;
+}
+
+static u64 nszBuildSectionBlock(NcaContext *nca_ctx, void *out_buf)
+{
+    NczSectionBlock *block = (NczSectionBlock*)out_buf;
+    NczSection *sections = (NczSection*)((u8*)out_buf + sizeof(NczSectionBlock));
+    const u8 *key = (nca_ctx->rights_id_available ? nca_ctx->titlekey : nca_ctx->decrypted_key_area.aes_ctr);
+
+    u64 section_count = 0, cur_offset = NCZ_UNCOMPRESSABLE_HEADER_SIZE;
+
+    // cover gaps between fs sections with plaintext entries, so the section ranges map the whole nca past the verbatim header area
+    for(u8 i = 0; i < NCA_FS_HEADER_COUNT; i++)
+    {
+        NcaFsSectionContext *fs_ctx = &(nca_ctx->fs_ctx[i]);
+        if (!fs_ctx->enabled) continue;
+
+        if (fs_ctx->section_offset > cur_offset)
+        {
+            NczSection *gap_section = &(sections[section_count++]);
+            memset(gap_section, 0, sizeof(NczSection));
+            gap_section->offset = cur_offset;
+            gap_section->size = (fs_ctx->section_offset - cur_offset);
+            gap_section->crypto_type = NcaEncryptionType_None;
+        }
+
+        NczSection *cur_section = &(sections[section_count++]);
+        memset(cur_section, 0, sizeof(NczSection));
+        cur_section->offset = fs_ctx->section_offset;
+        cur_section->size = fs_ctx->section_size;
+
+        if (fs_ctx->encryption_type == NcaEncryptionType_None)
+        {
+            cur_section->crypto_type = NcaEncryptionType_None;
+        } else {
+            cur_section->crypto_type = NcaEncryptionType_AesCtr;
+            memcpy(cur_section->crypto_key, key, AES_128_KEY_SIZE);
+            memcpy(cur_section->crypto_counter, fs_ctx->ctr, AES_BLOCK_SIZE);
+            aes128CtrUpdatePartialCtr(cur_section->crypto_counter, 0);
+        }
+
+        cur_offset = (fs_ctx->section_offset + fs_ctx->section_size);
+    }
+
+    if (cur_offset < nca_ctx->content_size)
+    {
+        NczSection *tail_section = &(sections[section_count++]);
+        memset(tail_section, 0, sizeof(NczSection));
+        tail_section->offset = cur_offset;
+        tail_section->size = (nca_ctx->content_size - cur_offset);
+        tail_section->crypto_type = NcaEncryptionType_None;
+    }
+
+    memcpy(block->magic, NCZ_SECTION_MAGIC, sizeof(block->magic));
+    block->section_count = section_count;
+
+    return (sizeof(NczSectionBlock) + (section_count * sizeof(NczSection)));
+}
+
+static void nszDecryptChunk(NcaContext *nca_ctx, void *buf, u64 size, u64 nca_offset)
+{
+    const u8 *key = (nca_ctx->rights_id_available ? nca_ctx->titlekey : nca_ctx->decrypted_key_area.aes_ctr);
+
+    for(u8 i = 0; i < NCA_FS_HEADER_COUNT; i++)
+    {
+        NcaFsSectionContext *fs_ctx = &(nca_ctx->fs_ctx[i]);
+        if (!fs_ctx->enabled || fs_ctx->encryption_type == NcaEncryptionType_None) continue;
+
+        // intersect this chunk with the current fs section
+        u64 start_offset = (fs_ctx->section_offset > nca_offset ? fs_ctx->section_offset : nca_offset);
+        u64 end_offset = ((fs_ctx->section_offset + fs_ctx->section_size) < (nca_offset + size) ? (fs_ctx->section_offset + fs_ctx->section_size) : (nca_offset + size));
+        if (start_offset >= end_offset) continue;
+
+        // decrypt the intersection in place
+        // aes-128-ctr is a pure xor stream, so this round-trips even for data modified by nca patches
+        u8 ctr[AES_BLOCK_SIZE] = {0};
+        memcpy(ctr, fs_ctx->ctr, AES_BLOCK_SIZE);
+        aes128CtrUpdatePartialCtr(ctr, start_offset);
+
+        Aes128CtrContext ctr_ctx = {0};
+        aes128CtrContextCreate(&ctr_ctx, key, ctr);
+        aes128CtrCrypt(&ctr_ctx, (u8*)buf + (start_offset - nca_offset), (u8*)buf + (start_offset - nca_offset), (end_offset - start_offset));
+    }
+}
+
+static bool nszWaitForOutputSlot(NszCompressContext *comp)
+{
+    ThreadSharedData *shared_data = comp->stream->shared_data;
+
+    // wait until the output stage releases a ring slot
+    while((atomic_load(&comp->comp_count) - atomic_load(&comp->write_count)) >= RING_BUFFER_COUNT)
+    {
+        if (shared_data->transfer_cancelled || atomic_load(&comp->stream->read_error)) break;
+        svcSleepThread(100000); // 100 us
+    }
+
+    return !(shared_data->transfer_cancelled || atomic_load(&comp->stream->read_error));
+}
+
+static void nszPublishOutputSlot(NszCompressContext *comp)
+{
+    size_t slot = (atomic_load(&comp->comp_count) % RING_BUFFER_COUNT);
+    comp->buf_size[slot] = comp->cur_slot_used;
+    comp->cur_slot_used = 0;
+    atomic_store(&comp->comp_count, atomic_load(&comp->comp_count) + 1);
+}
+
+static bool nszEmitData(NszCompressContext *comp, const void *data, size_t size)
+{
+    const u8 *data_u8 = (const u8*)data;
+
+    while(size)
+    {
+        if (!comp->cur_slot_used && !nszWaitForOutputSlot(comp)) return false;
+
+        size_t slot = (atomic_load(&comp->comp_count) % RING_BUFFER_COUNT);
+        size_t chunk_size = (BLOCK_SIZE - comp->cur_slot_used);
+        if (chunk_size > size) chunk_size = size;
+
+        memcpy((u8*)comp->buf[slot] + comp->cur_slot_used, data_u8, chunk_size);
+        comp->cur_slot_used += chunk_size;
+        data_u8 += chunk_size;
+        size -= chunk_size;
+
+        if (comp->cur_slot_used == BLOCK_SIZE) nszPublishOutputSlot(comp);
+    }
+
+    return true;
+}
+
+static bool nszEmitCompressedData(NszCompressContext *comp, ZSTD_CStream *zstd, const void *data, size_t size, bool end_of_stream)
+{
+    ZSTD_inBuffer input = { data, size, 0 };
+    bool done = false;
+
+    while(!done)
+    {
+        if (!comp->cur_slot_used && !nszWaitForOutputSlot(comp)) return false;
+
+        size_t slot = (atomic_load(&comp->comp_count) % RING_BUFFER_COUNT);
+        ZSTD_outBuffer output = { (u8*)comp->buf[slot] + comp->cur_slot_used, (BLOCK_SIZE - comp->cur_slot_used), 0 };
+
+        size_t res = ZSTD_compressStream2(zstd, &output, &input, end_of_stream ? ZSTD_e_end : ZSTD_e_continue);
+        if (ZSTD_isError(res))
+        {
+            consolePrint("zstd compression failed: %s\n", ZSTD_getErrorName(res));
+            return false;
+        }
+
+        comp->cur_slot_used += output.pos;
+        if (comp->cur_slot_used == BLOCK_SIZE) nszPublishOutputSlot(comp);
+
+        done = (end_of_stream ? (res == 0) : (input.pos == input.size));
+    }
+
+    return true;
+}
+
+static void nsz_compress_thread_func(void *arg)
+{
+    NszCompressContext *comp = (NszCompressContext*)arg;
+    NcaStreamContext *stream = comp->stream;
+    NcaContext *cur_nca_ctx = stream->nca_ctx;
+    ThreadSharedData *shared_data = stream->shared_data;
+
+    ZSTD_CStream *zstd = NULL;
+    u8 section_block[sizeof(NczSectionBlock) + (((NCA_FS_HEADER_COUNT * 2) + 1) * sizeof(NczSection))] = {0};
+    bool success = false;
+
+    if (!(zstd = ZSTD_createCStream()))
+    {
+        consolePrint("zstd cstream alloc failed\n");
+        goto end;
+    }
+
+    ZSTD_CCtx_setParameter(zstd, ZSTD_c_compressionLevel, NSZ_COMPRESSION_LEVEL);
+
+    for(u64 offset = 0, blksize = 0; offset < cur_nca_ctx->content_size; offset += blksize)
+    {
+        // wait until the read/patch/hash stage publishes a filled ring slot
+        while(atomic_load(&stream->write_count) == atomic_load(&stream->read_count))
+        {
+            if (shared_data->transfer_cancelled || atomic_load(&stream->read_error)) break;
+            svcSleepThread(100000); // 100 us
+        }
+
+        if (shared_data->transfer_cancelled || atomic_load(&stream->read_error)) goto end;
+
+        size_t slot = (atomic_load(&stream->write_count) % RING_BUFFER_COUNT);
+        u8 *buf = (u8*)stream->buf[slot];
+        blksize = stream->buf_size[slot];
+
+        u64 comp_offset = offset, comp_size = blksize;
+
+        if (!offset)
+        {
+            // emit the verbatim nca header area, followed by the ncz section block
+            u64 section_block_size = nszBuildSectionBlock(cur_nca_ctx, section_block);
+            if (!nszEmitData(comp, buf, NCZ_UNCOMPRESSABLE_HEADER_SIZE) || !nszEmitData(comp, section_block, section_block_size)) goto end;
+
+            comp_offset += NCZ_UNCOMPRESSABLE_HEADER_SIZE;
+            comp_size -= NCZ_UNCOMPRESSABLE_HEADER_SIZE;
+        }
+
+        // decrypt the chunk in place, then feed it to the zstd stream
+        // the read/patch/hash stage already hashed this slot before publishing it, so modifying it here is safe
+        nszDecryptChunk(cur_nca_ctx, buf + (comp_offset - offset), comp_size, comp_offset);
+        if (!nszEmitCompressedData(comp, zstd, buf + (comp_offset - offset), comp_size, false)) goto end;
+
+        // release the slot so the read/patch/hash stage can reuse it
+        atomic_store(&stream->write_count, atomic_load(&stream->write_count) + 1);
+
+        // update progress in uncompressed units
+        shared_data->data_written += blksize;
+    }
+
+    // flush the zstd stream and publish the last partial slot
+    if (!nszEmitCompressedData(comp, zstd, NULL, 0, true)) goto end;
+    if (comp->cur_slot_used) nszPublishOutputSlot(comp);
+
+    success = true;
+
+end:
+    if (!success && !shared_data->transfer_cancelled && !atomic_load(&stream->read_error)) atomic_store(&comp->comp_error, true);
+
+    // make sure the read/patch/hash stage stops if we bailed out early
+    if (atomic_load(&comp->comp_error)) atomic_store(&stream->write_error, true);
+
+    if (zstd) ZSTD_freeCStream(zstd);
+
+    atomic_store(&comp->finished, true);
+
+    threadExit();
+}
+
 static void dump_thread_func(void *arg)
 {
     ThreadSharedData *shared_data = (ThreadSharedData*)arg;
@@ -138,7 +534,9 @@ static void dump_thread_func(void *arg)
     bool patch_video_capture = (options[5].val == 1);
     bool patch_hdcp = (options[6].val == 1);
     bool append_authoringtool_data = (options[7].val == 1);
-    u32 output_device = options[8].val;
+    bool nsz_compression = (options[8].val == 1);
+    bool incremental_dump = (options[9].val == 1);
+    u32 output_device = options[10].val;
     bool success = false;
 
     UsbHsFsDevice *ums_device = (output_device < 2 ? NULL : &(ums_devices[output_device - 2]));
@@ -176,8 +574,11 @@ static void dump_thread_func(void *arg)
     u64 nsp_header_size = 0, nsp_size = 0, nsp_offset = 0;
     char *tmp_name = NULL;
 
-    Sha256Context sha256_ctx = {0};
-    u8 sha256_hash[SHA256_HASH_SIZE] = {0};
+    NcaStreamContext stream = {0};
+    Thread nca_stream_thread = {0};
+
+    NszCompressContext comp = {0};
+    Thread nsz_compress_thread = {0};
 
     if (!shared_data || !(title_info = (TitleInfo*)shared_data->data) || !title_info->content_count || !title_info->content_infos) goto end;
 
@@ -187,6 +588,20 @@ static void dump_thread_func(void *arg)
         goto end;
     }
 
+    if (nsz_compression && output_device == 1)
+    {
+        // usb transfers need every entry size upfront, but compressed entry sizes aren't known until after the fact
+        consolePrint("nsz compression isn't supported for usb host transfers, option ignored\n");
+        nsz_compression = false;
+    }
+
+    if (incremental_dump && output_device != 1)
+    {
+        // cached content splicing relies on the host tool holding copies of previous dumps
+        consolePrint("incremental dump is only supported for usb host transfers, option ignored\n");
+        incremental_dump = false;
+    }
+
     /* Allocate memory for the dump process. */
     if (!(buf = usbAllocatePageAlignedBuffer(BLOCK_SIZE)))
     {
@@ -194,6 +609,27 @@ static void dump_thread_func(void *arg)
         goto end;
     }
 
+    for(u32 i = 0; i < RING_BUFFER_COUNT; i++)
+    {
+        if (!(stream.buf[i] = usbAllocatePageAlignedBuffer(BLOCK_SIZE)))
+        {
+            consolePrint("stream buf alloc failed\n");
+            goto end;
+        }
+    }
+
+    if (nsz_compression)
+    {
+        for(u32 i = 0; i < RING_BUFFER_COUNT; i++)
+        {
+            if (!(comp.buf[i] = usbAllocatePageAlignedBuffer(BLOCK_SIZE)))
+            {
+                consolePrint("comp buf alloc failed\n");
+                goto end;
+            }
+        }
+    }
+
     /* Generate output path. */
     if (!(dump_name = titleGenerateFileName(title_info, TitleNamingConvention_Full, output_device == 0 ? TitleFileNameIllegalCharReplaceType_KeepAsciiCharsOnly : TitleFileNameIllegalCharReplaceType_IllegalFsChars)))
     {
@@ -203,7 +639,7 @@ static void dump_thread_func(void *arg)
 
     if (output_device != 1) sprintf(entry_name, "%s" OUTPATH, ums_device ? ums_device->name : DEVOPTAB_SDMC_DEVICE);
 
-    if (!(path = utilsGeneratePath(entry_name, dump_name, ".nsp")))
+    if (!(path = utilsGeneratePath(entry_name, dump_name, nsz_compression ? ".nsz" : ".nsp")))
     {
         consolePrint("generate path failed\n");
         goto end;
@@ -216,9 +652,9 @@ static void dump_thread_func(void *arg)
         goto end;
     }
 
-    if (!(nca_ctx = calloc(title_info->content_count, sizeof(NcaContext))))
+    if (!(nca_ctx = ncaAllocateContexts(title_info->content_count)))
     {
-        consolePrint("nca ctx calloc failed\n");
+        consolePrint("nca ctx alloc failed\n");
         goto end;
     }
 
@@ -448,7 +884,8 @@ static void dump_thread_func(void *arg)
     for(u32 i = 0; i < title_info->content_count; i++)
     {
         NcaContext *cur_nca_ctx = &(nca_ctx[i]);
-        sprintf(entry_name, "%s.%s", cur_nca_ctx->content_id_str, cur_nca_ctx->content_type == NcmContentType_Meta ? "cnmt.nca" : "nca");
+        sprintf(entry_name, "%s.%s", cur_nca_ctx->content_id_str, cur_nca_ctx->content_type == NcmContentType_Meta ? "cnmt.nca" : \
+                ((nsz_compression && nszIsNcaCompressible(cur_nca_ctx)) ? "ncz" : "nca"));
 
         if (!pfsAddEntryInformationToFileContext(&pfs_file_ctx, entry_name, cur_nca_ctx->content_size, NULL))
         {
@@ -602,10 +1039,6 @@ static void dump_thread_func(void *arg)
     for(u32 i = 0; i < title_info->content_count; i++)
     {
         NcaContext *cur_nca_ctx = &(nca_ctx[i]);
-        u64 blksize = BLOCK_SIZE;
-
-        memset(&sha256_ctx, 0, sizeof(Sha256Context));
-        sha256ContextCreate(&sha256_ctx);
 
         if (cur_nca_ctx->content_type == NcmContentType_Meta && (!cnmtGenerateNcaPatch(&cnmt_ctx) || !ncaEncryptHeader(cur_nca_ctx)))
         {
@@ -613,11 +1046,33 @@ static void dump_thread_func(void *arg)
             goto end;
         }
 
-        bool dirty_header = ncaIsHeaderDirty(cur_nca_ctx);
-
         if (output_device == 1)
         {
             tmp_name = pfsGetEntryNameByIndexFromFileContext(&pfs_file_ctx, i);
+
+            // try to reference a host-cached copy of this nca before transferring any of its data
+            // only entries guaranteed to match the stored content byte for byte are eligible, so anything the dump process modifies is ruled out
+            if (incremental_dump && cur_nca_ctx->content_type != NcmContentType_Meta && !cur_nca_ctx->content_type_ctx_patch && !ncaIsHeaderDirty(cur_nca_ctx))
+            {
+                bool cached = false;
+
+                if (!usbSendCachedContentReference(cur_nca_ctx->content_size, tmp_name, &cached))
+                {
+                    // don't bother sending any further references if the host tool doesn't support them
+                    consolePrint("cached content reference failed (old host tool?), disabling incremental dump\n");
+                    incremental_dump = false;
+                } else
+                if (cached)
+                {
+                    // the host spliced this entry into the output nsp on its own, so its data must not be sent
+                    // the cnmt content record and the pfs entry name are left untouched on purpose - unmodified ncas keep their original hash and content id
+                    consolePrint("\"%s\" spliced from the host content cache, skipped\n", tmp_name);
+                    nsp_offset += cur_nca_ctx->content_size;
+                    shared_data->data_written += cur_nca_ctx->content_size;
+                    continue;
+                }
+            }
+
             if (!usbSendFilePropertiesCommon(cur_nca_ctx->content_size, tmp_name))
             {
                 consolePrint("usb send file properties \"%s\" failed\n", tmp_name);
@@ -625,69 +1080,123 @@ static void dump_thread_func(void *arg)
             }
         }
 
-        for(u64 offset = 0; offset < cur_nca_ctx->content_size; offset += blksize, nsp_offset += blksize, shared_data->data_written += blksize)
+        // reset per-nca stream state and spawn the read/patch/hash stage
+        stream.nca_ctx = cur_nca_ctx;
+        stream.cnmt_ctx = &cnmt_ctx;
+        stream.shared_data = shared_data;
+        atomic_store(&stream.read_count, 0);
+        atomic_store(&stream.write_count, 0);
+        atomic_store(&stream.read_error, false);
+        atomic_store(&stream.write_error, false);
+
+        utilsCreateThread(&nca_stream_thread, nca_stream_thread_func, &stream, 2);
+
+        bool compress_nca = (nsz_compression && nszIsNcaCompressible(cur_nca_ctx));
+
+        if (compress_nca)
         {
-            if (shared_data->transfer_cancelled)
+            // reset per-nca compression stage state and spawn it
+            comp.stream = &stream;
+            comp.cur_slot_used = 0;
+            atomic_store(&comp.comp_count, 0);
+            atomic_store(&comp.write_count, 0);
+            atomic_store(&comp.comp_error, false);
+            atomic_store(&comp.finished, false);
+
+            utilsCreateThread(&nsz_compress_thread, nsz_compress_thread_func, &comp, 2);
+
+            u64 compressed_size = 0;
+
+            // output stage: drain compressed ring slots until the compression stage publishes its last one
+            while(true)
             {
-                if (output_device == 1) usbCancelFileTransfer();
-                goto end;
+                // wait until the compression stage publishes a filled ring slot or finishes
+                while(atomic_load(&comp.write_count) == atomic_load(&comp.comp_count) && !atomic_load(&comp.finished))
+                {
+                    if (shared_data->transfer_cancelled || atomic_load(&stream.read_error) || atomic_load(&comp.comp_error)) break;
+                    svcSleepThread(100000); // 100 us
+                }
+
+                if (shared_data->transfer_cancelled || atomic_load(&stream.read_error) || atomic_load(&comp.comp_error))
+                {
+                    utilsJoinThread(&nsz_compress_thread);
+                    utilsJoinThread(&nca_stream_thread);
+                    goto end;
+                }
+
+                if (atomic_load(&comp.write_count) == atomic_load(&comp.comp_count)) break;
+
+                size_t slot = (atomic_load(&comp.write_count) % RING_BUFFER_COUNT);
+                size_t comp_blksize = comp.buf_size[slot];
+
+                // write ncz chunk
+                fwrite(comp.buf[slot], 1, comp_blksize, fd);
+                compressed_size += comp_blksize;
+                nsp_offset += comp_blksize;
+
+                // release the slot so the compression stage can reuse it
+                atomic_store(&comp.write_count, atomic_load(&comp.write_count) + 1);
             }
 
-            if ((cur_nca_ctx->content_size - offset) < blksize) blksize = (cur_nca_ctx->content_size - offset);
+            utilsJoinThread(&nsz_compress_thread);
+            utilsJoinThread(&nca_stream_thread);
 
-            // read nca chunk
-            if (!ncaReadContentFile(cur_nca_ctx, buf, blksize, offset))
+            if (atomic_load(&stream.read_error) || atomic_load(&comp.comp_error)) goto end;
+
+            // shrink the pfs entry down to the compressed size
+            if (!pfsUpdateEntrySizeFromFileContext(&pfs_file_ctx, i, compressed_size))
             {
-                consolePrint("nca read failed at 0x%lX for \"%s\"\n", offset, cur_nca_ctx->content_id_str);
+                consolePrint("pfs update entry size failed for nca \"%s\"\n", cur_nca_ctx->content_id_str);
                 goto end;
             }
 
-            if (dirty_header)
+            consolePrint("compressed \"%s\": 0x%lX -> 0x%lX\n", cur_nca_ctx->content_id_str, cur_nca_ctx->content_size, compressed_size);
+        } else {
+            // output stage: drain filled ring slots while the stream thread keeps reading, patching and hashing ahead of us
+            for(u64 offset = 0, blksize = 0; offset < cur_nca_ctx->content_size; offset += blksize, nsp_offset += blksize, shared_data->data_written += blksize)
             {
-                // write re-encrypted headers
-                if (!cur_nca_ctx->header_written) ncaWriteEncryptedHeaderDataToMemoryBuffer(cur_nca_ctx, buf, blksize, offset);
+                // wait until the stream thread publishes a filled ring slot
+                while(atomic_load(&stream.write_count) == atomic_load(&stream.read_count))
+                {
+                    if (shared_data->transfer_cancelled || atomic_load(&stream.read_error)) break;
+                    svcSleepThread(100000); // 100 us
+                }
 
-                if (cur_nca_ctx->content_type_ctx_patch)
+                if (shared_data->transfer_cancelled || atomic_load(&stream.read_error))
                 {
-                    // write content type context patch
-                    switch(cur_nca_ctx->content_type)
+                    if (shared_data->transfer_cancelled && output_device == 1) usbCancelFileTransfer();
+                    utilsJoinThread(&nca_stream_thread);
+                    goto end;
+                }
+
+                size_t slot = (atomic_load(&stream.write_count) % RING_BUFFER_COUNT);
+                blksize = stream.buf_size[slot];
+
+                // write nca chunk
+                if (output_device != 1)
+                {
+                    fwrite(stream.buf[slot], 1, blksize, fd);
+                } else {
+                    if (!usbSendFileData(stream.buf[slot], blksize))
                     {
-                        case NcmContentType_Meta:
-                            cnmtWriteNcaPatch(&cnmt_ctx, buf, blksize, offset);
-                            break;
-                        case NcmContentType_Control:
-                            nacpWriteNcaPatch((NacpContext*)cur_nca_ctx->content_type_ctx, buf, blksize, offset);
-                            break;
-                        default:
-                            break;
+                        consolePrint("send file data failed\n");
+                        atomic_store(&stream.write_error, true);
+                        utilsJoinThread(&nca_stream_thread);
+                        goto end;
                     }
                 }
 
-                // update flag to avoid entering this code block if it's not needed anymore
-                dirty_header = (!cur_nca_ctx->header_written || cur_nca_ctx->content_type_ctx_patch);
+                // release the slot so the stream thread can reuse it
+                atomic_store(&stream.write_count, atomic_load(&stream.write_count) + 1);
             }
 
-            // update hash calculation
-            sha256ContextUpdate(&sha256_ctx, buf, blksize);
+            utilsJoinThread(&nca_stream_thread);
 
-            // write nca chunk
-            if (output_device != 1)
-            {
-                fwrite(buf, 1, blksize, fd);
-            } else {
-                if (!usbSendFileData(buf, blksize))
-                {
-                    consolePrint("send file data failed\n");
-                    goto end;
-                }
-            }
+            if (atomic_load(&stream.read_error)) goto end;
         }
 
-        // get hash
-        sha256ContextGetHash(&sha256_ctx, sha256_hash);
-
         // update content id and hash
-        ncaUpdateContentIdAndHash(cur_nca_ctx, sha256_hash);
+        ncaUpdateContentIdAndHash(cur_nca_ctx, stream.sha256_hash);
 
         // update cnmt
         if (!cnmtUpdateContentInfo(&cnmt_ctx, cur_nca_ctx))
@@ -746,6 +1255,7 @@ static void dump_thread_func(void *arg)
         char *authoring_tool_xml = NULL;
         u64 authoring_tool_xml_size = 0;
         u32 data_idx = cur_nca_ctx->content_type_ctx_data_idx;
+        LegalInfoContext *stream_legal_info_ctx = NULL;
 
         switch(cur_nca_ctx->content_type)
         {
@@ -767,6 +1277,13 @@ static void dump_thread_func(void *arg)
                 {
                     NacpIconContext *icon_ctx = &(cur_nacp_ctx->icon_ctx[j]);
 
+                    // make sure the icon data has been loaded (no-op if the xml generation step already did)
+                    if (!nacpLoadIconData(cur_nacp_ctx, icon_ctx))
+                    {
+                        consolePrint("load icon data failed for \"%s\" (%u)\n", cur_nca_ctx->content_id_str, icon_ctx->language);
+                        goto end;
+                    }
+
                     // write icon
                     if (output_device != 1)
                     {
@@ -798,6 +1315,10 @@ static void dump_thread_func(void *arg)
                 LegalInfoContext *cur_legal_info_ctx = (LegalInfoContext*)cur_nca_ctx->content_type_ctx;
                 authoring_tool_xml = cur_legal_info_ctx->authoring_tool_xml;
                 authoring_tool_xml_size = cur_legal_info_ctx->authoring_tool_xml_size;
+
+                // legal archives too big to be materialized in memory must be streamed in chunks
+                if (!authoring_tool_xml) stream_legal_info_ctx = cur_legal_info_ctx;
+
                 break;
             }
             default:
@@ -805,7 +1326,39 @@ static void dump_thread_func(void *arg)
         }
 
         // write xml
-        if (output_device != 1)
+        if (stream_legal_info_ctx)
+        {
+            // stream xml data in fixed-size chunks through the shared transfer buffer
+            if (output_device == 1)
+            {
+                tmp_name = pfsGetEntryNameByIndexFromFileContext(&pfs_file_ctx, data_idx);
+                if (!usbSendFilePropertiesCommon(authoring_tool_xml_size, tmp_name))
+                {
+                    consolePrint("send \"%s\" failed\n", tmp_name);
+                    goto end;
+                }
+            }
+
+            for(u64 offset = 0, blksize = BLOCK_SIZE; offset < authoring_tool_xml_size; offset += blksize)
+            {
+                if (blksize > (authoring_tool_xml_size - offset)) blksize = (authoring_tool_xml_size - offset);
+
+                if (!legalInfoReadAuthoringToolXml(stream_legal_info_ctx, buf, blksize, offset))
+                {
+                    consolePrint("read xml chunk failed for \"%s\"\n", cur_nca_ctx->content_id_str);
+                    goto end;
+                }
+
+                if (output_device != 1)
+                {
+                    fwrite(buf, 1, blksize, fd);
+                } else if (!usbSendFileData(buf, blksize))
+                {
+                    consolePrint("send xml chunk failed for \"%s\"\n", cur_nca_ctx->content_id_str);
+                    goto end;
+                }
+            }
+        } else if (output_device != 1)
         {
             fwrite(authoring_tool_xml, 1, authoring_tool_xml_size, fd);
         } else {
@@ -922,12 +1475,18 @@ end:
 
     cnmtFreeContext(&cnmt_ctx);
 
-    if (nca_ctx) free(nca_ctx);
+    if (nca_ctx) ncaFreeContexts(nca_ctx, title_info->content_count);
 
     if (path) free(path);
 
     if (dump_name) free(dump_name);
 
+    for(u32 i = 0; i < RING_BUFFER_COUNT; i++)
+    {
+        if (stream.buf[i]) free(stream.buf[i]);
+        if (comp.buf[i]) free(comp.buf[i]);
+    }
+
     if (buf) free(buf);
 
     threadExit();
@@ -949,7 +1508,10 @@ static void nspDump(TitleInfo *title_info)
     u64 prev_size = 0;
     u8 prev_time = 0, percent = 0;
 
-    u32 output_device = options[8].val;
+    UtilsProgressStats progress_stats = {0};
+    char sparkline[UTILS_PROGRESS_HISTORY_SIZE + 1] = {0};
+
+    u32 output_device = options[10].val;
 
     consoleClear();
 
@@ -1072,7 +1634,24 @@ static void nspDump(TitleInfo *title_info)
         prev_time = ts.tm_sec;
         prev_size = size;
 
+        // feed the instrumentation surface once per printed frame, so the sparkline covers the last UTILS_PROGRESS_HISTORY_SIZE seconds
+        utilsUpdateProgressStats(&progress_stats, size);
+        utilsGenerateProgressSparkline(&progress_stats, sparkline, sizeof(sparkline));
+
+        u64 eta_secs = 0;
+        bool eta_valid = utilsGetProgressEta(&progress_stats, size, shared_data.total_size, &eta_secs);
+
         consolePrint("%lu / %lu (%u%%) | Time elapsed: %lu\n", size, shared_data.total_size, percent, (now - start));
+
+        consolePrint("%.2lf MiB/s | eta: ", utilsGetProgressRate(&progress_stats) / (double)0x100000);
+        if (eta_valid)
+        {
+            consolePrint("%02lu:%02lu:%02lu", eta_secs / 3600, (eta_secs % 3600) / 60, eta_secs % 60);
+        } else {
+            consolePrint("--:--:--");
+        }
+        consolePrint(" | [%s]\n", sparkline);
+
         consoleRefresh();
     }
 
@@ -1097,6 +1676,52 @@ static void nspDump(TitleInfo *title_info)
     consolePrint("process completed in %lu seconds\n", start);
 }
 
+/* Converts every title stored in the inserted gamecard to NSP format in a single sequential run, using the current dump options. */
+/* Each NSP is assembled straight from the gamecard's secure HFS partition - content data is only read once, with no intermediate XCI dump. */
+static void nspDumpGameCardTitles(void)
+{
+    u32 gc_app_count = 0;
+    TitleApplicationMetadata **gc_app_metadata = titleGetGameCardApplicationMetadataEntries(&gc_app_count);
+    if (!gc_app_metadata || !gc_app_count)
+    {
+        consolePrint("\nno gamecard titles available\n");
+        return;
+    }
+
+    u32 processed = 0;
+
+    for(u32 i = 0; i < gc_app_count; i++)
+    {
+        TitleUserApplicationData cur_app_data = {0};
+
+        if (!titleGetUserApplicationData(gc_app_metadata[i]->title_id, &cur_app_data))
+        {
+            consolePrint("\nget user application data failed for %016lX! skipping\n", gc_app_metadata[i]->title_id);
+            continue;
+        }
+
+        TitleInfo *info_blocks[] = { cur_app_data.app_info, cur_app_data.patch_info, cur_app_data.aoc_info, cur_app_data.aoc_patch_info };
+
+        for(u32 j = 0; j < MAX_ELEMENTS(info_blocks); j++)
+        {
+            for(TitleInfo *cur_title_info = info_blocks[j]; cur_title_info; cur_title_info = cur_title_info->next)
+            {
+                /* Skip titles that aren't actually stored in the gamecard (e.g. updates installed to the SD card or eMMC). */
+                if (cur_title_info->storage_id != NcmStorageId_GameCard) continue;
+
+                nspDump(cur_title_info);
+                processed++;
+            }
+        }
+
+        titleFreeUserApplicationData(&cur_app_data);
+    }
+
+    free(gc_app_metadata);
+
+    consolePrint("\nprocessed %u nsp(s) from the inserted gamecard\n", processed);
+}
+
 int main(int argc, char *argv[])
 {
     int ret = 0;
@@ -1132,6 +1757,10 @@ int main(int argc, char *argv[])
 
     bool applet_status = true;
 
+    /* Title data is streamed in on a background thread - wait for it to be fully loaded before building the menu. */
+    consolePrint("waiting for title info...\n");
+    while(appletMainLoop() && !titleIsStorageLoadComplete()) svcSleepThread(10000000); // 10 ms
+
     app_metadata = titleGetApplicationMetadataEntries(false, &app_count);
     if (!app_metadata || !app_count)
     {
@@ -1149,6 +1778,7 @@ int main(int argc, char *argv[])
         consoleClear();
 
         consolePrint("press b to %s.\n", menu == 0 ? "exit" : "go back");
+        if (menu == 0) consolePrint("press y to convert every title in the inserted gamecard to nsp.\n");
         if (ums_device_count) consolePrint("press x to safely remove all ums devices.\n");
         consolePrint("______________________________\n\n");
 
@@ -1451,6 +2081,17 @@ int main(int argc, char *argv[])
             title_info = title_info->next;
             list_idx++;
         } else
+        if ((btn_down & HidNpadButton_Y) && menu == 0)
+        {
+            utilsSetLongRunningProcessState(true);
+            nspDumpGameCardTitles();
+            utilsSetLongRunningProcessState(false);
+            device_retrieved_size = false;
+
+            consolePrint("press any button to continue\n");
+            consoleRefresh();
+            utilsWaitForButtonPress(0);
+        } else
         if ((btn_down & HidNpadButton_X) && ums_device_count)
         {
             for(u32 i = 0; i < ums_device_count; i++) usbHsFsUnmountDevice(&(ums_devices[i]), false);
@@ -24,28 +24,35 @@
 #include "gamecard.h"
 #include "title.h"
 
-#define BLOCK_SIZE  0x800000
+#define BLOCK_SIZE          0x800000
+
+/* Bounded by the NCA crypto buffer pool size, which caps how many threads can decrypt NCA data at once. */
+#define WORKER_THREAD_COUNT 3
 
 bool g_borealisInitialized = false;
 
 static PadState g_padState = {0};
 
 static Mutex g_fileMutex = 0;
-static CondVar g_readCondvar = 0, g_writeCondvar = 0;
+static Mutex g_romfsReadMutex = 0;
 
 typedef struct
 {
-    FILE *fd;
     RomFileSystemContext *romfs_ctx;
-    void *data;
-    size_t data_size;
     size_t data_written;
     size_t total_size;
+    bool queue_empty;
     bool read_error;
     bool write_error;
     bool transfer_cancelled;
 } ThreadSharedData;
 
+typedef struct
+{
+    ThreadSharedData *shared_data;
+    void *buf;
+} WorkerThreadData;
+
 static void utilsScanPads(void)
 {
     padUpdate(&g_padState);
@@ -83,19 +90,37 @@ static void consolePrint(const char *text, ...)
     consoleUpdate(NULL);
 }
 
-static void read_thread_func(void *arg)
+static RomFileSystemFileEntry *pop_file_entry(ThreadSharedData *shared_data)
 {
-    ThreadSharedData *shared_data = (ThreadSharedData*)arg;
-    if (!shared_data || shared_data->fd || !shared_data->data || !shared_data->total_size || !shared_data->romfs_ctx)
+    RomFileSystemFileEntry *file_entry = NULL;
+
+    mutexLock(&g_fileMutex);
+
+    /* Hand out the current file entry and advance the shared file table cursor. */
+    if (!shared_data->queue_empty && !shared_data->read_error && !shared_data->write_error && !shared_data->transfer_cancelled)
     {
-        shared_data->read_error = true;
-        goto end;
+        if ((file_entry = romfsGetCurrentFileEntry(shared_data->romfs_ctx)) != NULL)
+        {
+            /* Flag the end of the file table so the remaining workers bail out. */
+            if (!romfsCanMoveToNextFileEntry(shared_data->romfs_ctx) || !romfsMoveToNextFileEntry(shared_data->romfs_ctx)) shared_data->queue_empty = true;
+        } else {
+            shared_data->read_error = true;
+        }
     }
 
-    u8 *buf = malloc(BLOCK_SIZE);
-    if (!buf)
+    mutexUnlock(&g_fileMutex);
+
+    return file_entry;
+}
+
+static void worker_thread_func(void *arg)
+{
+    WorkerThreadData *worker_data = (WorkerThreadData*)arg;
+
+    ThreadSharedData *shared_data = (worker_data ? worker_data->shared_data : NULL);
+    if (!shared_data || !worker_data->buf || !shared_data->romfs_ctx || !shared_data->total_size)
     {
-        shared_data->read_error = true;
+        if (shared_data) shared_data->read_error = true;
         goto end;
     }
 
@@ -104,39 +129,19 @@ static void read_thread_func(void *arg)
     char path[FS_MAX_PATH] = {0};
     sprintf(path, "sdmc:/romfs");
 
-    /* Reset current file table offset. */
-    romfsResetFileTableOffset(shared_data->romfs_ctx);
-
-    /* Loop through all file entries. */
-    while(shared_data->data_written < shared_data->total_size && romfsCanMoveToNextFileEntry(shared_data->romfs_ctx))
+    /* Keep pulling file entries from the shared work queue until it runs dry. */
+    /* Each worker extracts a whole file on its own: NCA reads are serialized across workers, but they overlap with the SD card writes carried out by the rest. */
+    while((file_entry = pop_file_entry(shared_data)) != NULL)
     {
-        /* Check if the transfer has been cancelled by the user. */
-        if (shared_data->transfer_cancelled)
-        {
-            condvarWakeAll(&g_writeCondvar);
-            break;
-        }
-
-        /* Wait until the previous file data chunk has been written. */
-        mutexLock(&g_fileMutex);
-        if (shared_data->data_size && !shared_data->write_error) condvarWait(&g_readCondvar, &g_fileMutex);
-        mutexUnlock(&g_fileMutex);
-        if (shared_data->write_error) break;
-
-        /* Close file. */
-        if (shared_data->fd)
-        {
-            fclose(shared_data->fd);
-            shared_data->fd = NULL;
-            utilsCommitSdCardFileSystemChanges();
-        }
+        FILE *fd = NULL;
+        bool file_error = false;
 
-        /* Retrieve RomFS file entry information. */
-        shared_data->read_error = (!(file_entry = romfsGetCurrentFileEntry(shared_data->romfs_ctx)) || \
-                                    !romfsGeneratePathFromFileEntry(shared_data->romfs_ctx, file_entry, path + 11, FS_MAX_PATH - 11, RomFileSystemPathIllegalCharReplaceType_KeepAsciiCharsOnly));
-        if (shared_data->read_error)
+        /* Generate output path for the current file entry. */
+        if (!romfsGeneratePathFromFileEntry(shared_data->romfs_ctx, file_entry, path + 11, FS_MAX_PATH - 11, RomFileSystemPathIllegalCharReplaceType_KeepAsciiCharsOnly))
         {
-            condvarWakeAll(&g_writeCondvar);
+            mutexLock(&g_fileMutex);
+            shared_data->read_error = true;
+            mutexUnlock(&g_fileMutex);
             break;
         }
 
@@ -146,15 +151,17 @@ static void read_thread_func(void *arg)
         /* Create file. */
         if (file_entry->size > FAT32_FILESIZE_LIMIT && !utilsCreateConcatenationFile(path))
         {
-            shared_data->read_error = true;
-            condvarWakeAll(&g_writeCondvar);
+            mutexLock(&g_fileMutex);
+            shared_data->write_error = true;
+            mutexUnlock(&g_fileMutex);
             break;
         }
 
-        shared_data->read_error = ((shared_data->fd = fopen(path, "wb")) == NULL);
-        if (shared_data->read_error)
+        if ((fd = fopen(path, "wb")) == NULL)
         {
-            condvarWakeAll(&g_writeCondvar);
+            mutexLock(&g_fileMutex);
+            shared_data->write_error = true;
+            mutexUnlock(&g_fileMutex);
             break;
         }
 
@@ -165,104 +172,54 @@ static void read_thread_func(void *arg)
             /* Check if the transfer has been cancelled by the user. */
             if (shared_data->transfer_cancelled)
             {
-                condvarWakeAll(&g_writeCondvar);
+                file_error = true;
                 break;
             }
 
-            /* Read current file data chunk. */
-            shared_data->read_error = !romfsReadFileEntryData(shared_data->romfs_ctx, file_entry, buf, blksize, offset);
-            if (shared_data->read_error)
+            /* Read current file data chunk into this worker's buffer. */
+            mutexLock(&g_romfsReadMutex);
+            bool read_success = romfsReadFileEntryData(shared_data->romfs_ctx, file_entry, worker_data->buf, blksize, offset);
+            mutexUnlock(&g_romfsReadMutex);
+
+            if (!read_success)
             {
-                condvarWakeAll(&g_writeCondvar);
+                mutexLock(&g_fileMutex);
+                shared_data->read_error = true;
+                mutexUnlock(&g_fileMutex);
+                file_error = true;
                 break;
             }
 
-            /* Wait until the previous file data chunk has been written. */
-            mutexLock(&g_fileMutex);
-
-            if (shared_data->data_size && !shared_data->write_error) condvarWait(&g_readCondvar, &g_fileMutex);
-
-            if (shared_data->write_error)
+            /* Write current file data chunk. */
+            if (fwrite(worker_data->buf, 1, blksize, fd) != blksize)
             {
+                mutexLock(&g_fileMutex);
+                shared_data->write_error = true;
                 mutexUnlock(&g_fileMutex);
+                file_error = true;
                 break;
             }
 
-            /* Copy current file data chunk to the shared buffer. */
-            memcpy(shared_data->data, buf, blksize);
-            shared_data->data_size = blksize;
-
-            /* Wake up the write thread to continue writing data. */
+            /* Update overall progress. */
+            mutexLock(&g_fileMutex);
+            shared_data->data_written += blksize;
             mutexUnlock(&g_fileMutex);
-            condvarWakeAll(&g_writeCondvar);
         }
 
-        if (shared_data->read_error || shared_data->write_error || shared_data->transfer_cancelled) break;
+        /* Close file. */
+        fclose(fd);
 
-        /* Move to the next file entry. */
-        shared_data->read_error = !romfsMoveToNextFileEntry(shared_data->romfs_ctx);
-        if (shared_data->read_error)
-        {
-            condvarWakeAll(&g_writeCondvar);
-            break;
-        }
-    }
+        /* Remove output file if it wasn't fully extracted. */
+        if (file_error) utilsRemoveConcatenationFile(path);
 
-    /* Wait until the previous file data chunk has been written. */
-    mutexLock(&g_fileMutex);
-    if (shared_data->data_size && !shared_data->write_error) condvarWait(&g_readCondvar, &g_fileMutex);
-    mutexUnlock(&g_fileMutex);
+        /* Schedule a batched SD card commit instead of forcing one per file - per-file commits dominate the runtime on small-file-heavy RomFS images. */
+        utilsScheduleSdCardFileSystemCommit(file_entry->size);
 
-    if (shared_data->fd)
-    {
-        fclose(shared_data->fd);
-        shared_data->fd = NULL;
-        if (shared_data->read_error || shared_data->write_error || shared_data->transfer_cancelled) utilsRemoveConcatenationFile(path);
-        utilsCommitSdCardFileSystemChanges();
+        if (file_error) break;
     }
 
-    free(buf);
-
-end:
-    threadExit();
-}
-
-static void write_thread_func(void *arg)
-{
-    ThreadSharedData *shared_data = (ThreadSharedData*)arg;
-    if (!shared_data || !shared_data->data)
-    {
-        shared_data->write_error = true;
-        goto end;
-    }
-
-    while(shared_data->data_written < shared_data->total_size)
-    {
-        /* Wait until the current file data chunk has been read */
-        mutexLock(&g_fileMutex);
-
-        if (!shared_data->data_size && !shared_data->read_error) condvarWait(&g_writeCondvar, &g_fileMutex);
-
-        if (shared_data->read_error || shared_data->transfer_cancelled || !shared_data->fd)
-        {
-            mutexUnlock(&g_fileMutex);
-            break;
-        }
-
-        /* Write current file data chunk */
-        shared_data->write_error = (fwrite(shared_data->data, 1, shared_data->data_size, shared_data->fd) != shared_data->data_size);
-        if (!shared_data->write_error)
-        {
-            shared_data->data_written += shared_data->data_size;
-            shared_data->data_size = 0;
-        }
-
-        /* Wake up the read thread to continue reading data */
-        mutexUnlock(&g_fileMutex);
-        condvarWakeAll(&g_readCondvar);
-
-        if (shared_data->write_error) break;
-    }
+    /* Push any still-scheduled commit down to the filesystem before this worker goes away. */
+    utilsFlushScheduledSdCardFileSystemCommits();
 
 end:
     threadExit();
@@ -408,14 +365,17 @@ int main(int argc, char *argv[])
     u32 selected_idx = 0, page_size = 30, scroll = 0;
     bool applet_status = true, exit_prompt = true;
 
-    u8 *buf = NULL;
-
     NcaContext *base_nca_ctx = NULL, *update_nca_ctx = NULL;
 
     RomFileSystemContext romfs_ctx = {0};
 
     ThreadSharedData shared_data = {0};
-    Thread read_thread = {0}, write_thread = {0};
+    WorkerThreadData worker_data[WORKER_THREAD_COUNT] = {0};
+    Thread worker_threads[WORKER_THREAD_COUNT] = {0};
+
+    /* Title data is streamed in on a background thread - wait for it to be fully loaded before building the menu. */
+    consolePrint("waiting for title info...\n");
+    while(appletMainLoop() && !titleIsStorageLoadComplete()) svcSleepThread(10000000); // 10 ms
 
     app_metadata = titleGetApplicationMetadataEntries(false, &app_count);
     if (!app_metadata || !app_count)
@@ -426,16 +386,21 @@ int main(int argc, char *argv[])
 
     consolePrint("app metadata succeeded\n");
 
-    buf = malloc(BLOCK_SIZE);
-    if (!buf)
+    for(u32 i = 0; i < WORKER_THREAD_COUNT; i++)
     {
-        consolePrint("buf failed\n");
-        goto out2;
+        worker_data[i].shared_data = &shared_data;
+
+        worker_data[i].buf = malloc(BLOCK_SIZE);
+        if (!worker_data[i].buf)
+        {
+            consolePrint("worker buf #%u failed\n", i);
+            goto out2;
+        }
     }
 
-    consolePrint("buf succeeded\n");
+    consolePrint("worker bufs succeeded\n");
 
-    base_nca_ctx = calloc(1, sizeof(NcaContext));
+    base_nca_ctx = ncaAllocateContexts(1);
     if (!base_nca_ctx)
     {
         consolePrint("base nca ctx buf failed\n");
@@ -444,7 +409,7 @@ int main(int argc, char *argv[])
 
     consolePrint("base nca ctx buf succeeded\n");
 
-    update_nca_ctx = calloc(1, sizeof(NcaContext));
+    update_nca_ctx = ncaAllocateContexts(1);
     if (!update_nca_ctx)
     {
         consolePrint("update nca ctx buf failed\n");
@@ -656,14 +621,14 @@ int main(int argc, char *argv[])
         goto out2;
     }
 
-    shared_data.fd = NULL;
-    shared_data.data = buf;
-    shared_data.data_size = 0;
     shared_data.data_written = 0;
+    shared_data.queue_empty = false;
 
-    consolePrint("creating threads\n");
-    utilsCreateThread(&read_thread, read_thread_func, &shared_data, 2);
-    utilsCreateThread(&write_thread, write_thread_func, &shared_data, 2);
+    /* Reset current file table offset. */
+    romfsResetFileTableOffset(&romfs_ctx);
+
+    consolePrint("creating worker threads\n");
+    for(u32 i = 0; i < WORKER_THREAD_COUNT; i++) utilsCreateThread(&(worker_threads[i]), worker_thread_func, &(worker_data[i]), 2);
 
     u8 prev_time = 0;
     u64 prev_size = 0;
@@ -724,11 +689,12 @@ int main(int argc, char *argv[])
 
     start = (time(NULL) - start);
 
-    consolePrint("\nwaiting for threads to join\n");
-    utilsJoinThread(&read_thread);
-    consolePrint("read_thread done: %lu\n", time(NULL));
-    utilsJoinThread(&write_thread);
-    consolePrint("write_thread done: %lu\n", time(NULL));
+    consolePrint("\nwaiting for worker threads to join\n");
+    for(u32 i = 0; i < WORKER_THREAD_COUNT; i++)
+    {
+        utilsJoinThread(&(worker_threads[i]));
+        consolePrint("worker thread #%u done: %lu\n", i, time(NULL));
+    }
 
     utilsSetLongRunningProcessState(false);
 
@@ -755,13 +721,16 @@ out2:
 
     romfsFreeContext(&romfs_ctx);
 
-    if (update_nca_ctx) free(update_nca_ctx);
+    if (update_nca_ctx) ncaFreeContexts(update_nca_ctx, 1);
 
-    if (base_nca_ctx) free(base_nca_ctx);
+    if (base_nca_ctx) ncaFreeContexts(base_nca_ctx, 1);
 
     titleFreeUserApplicationData(&user_app_data);
 
-    if (buf) free(buf);
+    for(u32 i = 0; i < WORKER_THREAD_COUNT; i++)
+    {
+        if (worker_data[i].buf) free(worker_data[i].buf);
+    }
 
     if (app_metadata) free(app_metadata);
 
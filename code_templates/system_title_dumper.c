@@ -25,16 +25,48 @@
 #include "pfs.h"
 #include "romfs.h"
 
-#define BLOCK_SIZE  0x800000
-#define OUTPATH     "sdmc:/systitle_dumps"
+#define BLOCK_SIZE          0x800000
+#define OUTPATH             "sdmc:/systitle_dumps"
+
+/* Number of titles processed concurrently by the batch dump scheduler. System titles are small, so the bottleneck alternates between NCA decryption and SD card writes - */
+/* overlapping a few per-title pipelines keeps both busy. The effective buffer size per worker is still bounded by the dump buffer budgeter. */
+#define BATCH_WORKER_COUNT  3
 
 bool g_borealisInitialized = false;
 
 static PadState g_padState = {0};
 
-static u8 *buf = NULL;
-static FILE *filefd = NULL;
-static char path[FS_MAX_PATH * 2] = {0};
+static Mutex g_consoleMutex = 0;
+static Mutex g_ncaReadMutex = 0;
+static Mutex g_batchMutex = 0;
+
+typedef struct
+{
+    u8 *buf;                        ///< Worker-local I/O buffer.
+    u64 buf_size;                   ///< Size of 'buf'.
+    FILE *filefd;                   ///< Output file handle for the entry currently being dumped.
+    char path[FS_MAX_PATH * 2];     ///< Output path buffer.
+    const bool *cancel_flag;        ///< Optional pointer to a cancellation flag checked while dumping. May be NULL.
+} DumpContext;
+
+typedef struct
+{
+    TitleApplicationMetadata **app_metadata;    ///< System title metadata entries. Doubles as the shared work queue.
+    u32 app_count;                              ///< Total entry count.
+    u32 next_title;                             ///< Index of the next unclaimed entry.
+    u32 processed_titles;                       ///< Number of fully processed entries, successful or not.
+    u32 failed_titles;                          ///< Number of entries that couldn't be fully dumped.
+    bool cancelled;                             ///< Set once the user aborts the batch dump.
+} BatchSharedData;
+
+typedef struct
+{
+    BatchSharedData *shared_data;
+    DumpContext dump_ctx;
+} BatchWorkerData;
+
+/* Dump context for the interactive single-section flow. */
+static DumpContext g_dumpCtx = {0};
 
 static void utilsScanPads(void)
 {
@@ -66,26 +98,39 @@ static void utilsWaitForButtonPress(u64 flag)
 
 static void consolePrint(const char *text, ...)
 {
+    mutexLock(&g_consoleMutex);
+
     va_list v;
     va_start(v, text);
     vfprintf(stdout, text, v);
     va_end(v);
     consoleUpdate(NULL);
+
+    mutexUnlock(&g_consoleMutex);
 }
 
-static void dumpPartitionFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
+static bool dumpPartitionFs(DumpContext *dump_ctx, TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
 {
-    if (!buf || !info || !nca_fs_ctx) return;
+    if (!dump_ctx || !dump_ctx->buf || !dump_ctx->buf_size || !info || !nca_fs_ctx) return false;
 
     u32 pfs_entry_count = 0;
     PartitionFileSystemContext pfs_ctx = {0};
     PartitionFileSystemEntry *pfs_entry = NULL;
     char *pfs_entry_name = NULL;
 
+    char *path = dump_ctx->path;
     size_t path_len = 0;
     *path = '\0';
 
-    if (!pfsInitializeContext(&pfs_ctx, nca_fs_ctx))
+    u64 data_written = 0;
+    bool success = false;
+
+    /* NCA-backed reads are serialized across dump contexts - they share the underlying content storage session and NCA crypto buffer pool. */
+    mutexLock(&g_ncaReadMutex);
+    bool pfs_init = pfsInitializeContext(&pfs_ctx, nca_fs_ctx);
+    mutexUnlock(&g_ncaReadMutex);
+
+    if (!pfs_init)
     {
         consolePrint("pfs initialize ctx failed!\n");
         goto end;
@@ -97,13 +142,15 @@ static void dumpPartitionFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
         goto end;
     }
 
-    snprintf(path, sizeof(path), OUTPATH "/%016lX - %s/%s (%s)/Section %u (%s)", info->meta_key.id, info->app_metadata->lang_entry.name, ((NcaContext*)nca_fs_ctx->nca_ctx)->content_id_str, \
+    snprintf(path, sizeof(dump_ctx->path), OUTPATH "/%016lX - %s/%s (%s)/Section %u (%s)", info->meta_key.id, info->app_metadata->lang_entry.name, ((NcaContext*)nca_fs_ctx->nca_ctx)->content_id_str, \
              titleGetNcmContentTypeName(((NcaContext*)nca_fs_ctx->nca_ctx)->content_type), nca_fs_ctx->section_idx, ncaGetFsSectionTypeName(nca_fs_ctx));
     utilsCreateDirectoryTree(path, true);
     path_len = strlen(path);
 
     for(u32 i = 0; i < pfs_entry_count; i++)
     {
+        if (dump_ctx->cancel_flag && *(dump_ctx->cancel_flag)) goto end;
+
         if (!(pfs_entry = pfsGetEntryByIndex(&pfs_ctx, i)) || !(pfs_entry_name = pfsGetEntryNameByIndex(&pfs_ctx, i)) || !strlen(pfs_entry_name))
         {
             consolePrint("pfs get entry / get name #%u failed!\n", i);
@@ -115,8 +162,8 @@ static void dumpPartitionFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
         strcat(path, pfs_entry_name);
         utilsReplaceIllegalCharacters(path + path_len + 1, true);
 
-        filefd = fopen(path, "wb");
-        if (!filefd)
+        dump_ctx->filefd = fopen(path, "wb");
+        if (!dump_ctx->filefd)
         {
             consolePrint("failed to create \"%s\"!\n", path);
             goto end;
@@ -124,63 +171,84 @@ static void dumpPartitionFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
 
         consolePrint("dumping \"%s\"...\n", pfs_entry_name);
 
-        u64 blksize = BLOCK_SIZE;
+        u64 blksize = dump_ctx->buf_size;
         for(u64 j = 0; j < pfs_entry->size; j += blksize)
         {
             if (blksize > (pfs_entry->size - j)) blksize = (pfs_entry->size - j);
 
-            if (!pfsReadEntryData(&pfs_ctx, pfs_entry, buf, blksize, j))
+            mutexLock(&g_ncaReadMutex);
+            bool read_success = pfsReadEntryData(&pfs_ctx, pfs_entry, dump_ctx->buf, blksize, j);
+            mutexUnlock(&g_ncaReadMutex);
+
+            if (!read_success)
             {
                 consolePrint("failed to read 0x%lX block from offset 0x%lX!\n", blksize, j);
                 goto end;
             }
 
-            fwrite(buf, 1, blksize, filefd);
+            fwrite(dump_ctx->buf, 1, blksize, dump_ctx->filefd);
+            data_written += blksize;
         }
 
-        fclose(filefd);
-        filefd = NULL;
+        fclose(dump_ctx->filefd);
+        dump_ctx->filefd = NULL;
     }
 
     consolePrint("pfs dump complete\n");
+    success = true;
 
 end:
-    if (filefd)
+    if (dump_ctx->filefd)
     {
-        fclose(filefd);
+        fclose(dump_ctx->filefd);
         remove(path);
+        dump_ctx->filefd = NULL;
     }
 
-    if (*path) utilsCommitSdCardFileSystemChanges();
+    /* Schedule a batched SD card commit for the data we just wrote. */
+    if (*path) utilsScheduleSdCardFileSystemCommit(data_written);
 
     pfsFreeContext(&pfs_ctx);
+
+    return success;
 }
 
-static void dumpRomFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
+static bool dumpRomFs(DumpContext *dump_ctx, TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
 {
-    if (!buf || !info || !nca_fs_ctx) return;
+    if (!dump_ctx || !dump_ctx->buf || !dump_ctx->buf_size || !info || !nca_fs_ctx) return false;
 
     RomFileSystemContext romfs_ctx = {0};
     RomFileSystemFileEntry *romfs_file_entry = NULL;
 
+    char *path = dump_ctx->path;
     size_t path_len = 0;
     *path = '\0';
 
-    if (!romfsInitializeContext(&romfs_ctx, nca_fs_ctx, NULL))
+    u64 data_written = 0;
+    bool success = false;
+
+    /* NCA-backed reads are serialized across dump contexts - they share the underlying content storage session and NCA crypto buffer pool. */
+    mutexLock(&g_ncaReadMutex);
+    bool romfs_init = romfsInitializeContext(&romfs_ctx, nca_fs_ctx, NULL);
+    mutexUnlock(&g_ncaReadMutex);
+
+    if (!romfs_init)
     {
         consolePrint("romfs initialize ctx failed!\n");
         goto end;
     }
 
-    snprintf(path, sizeof(path), OUTPATH "/%016lX - %s/%s (%s)/Section %u (%s)", info->meta_key.id, info->app_metadata->lang_entry.name, ((NcaContext*)nca_fs_ctx->nca_ctx)->content_id_str, \
+    snprintf(path, sizeof(dump_ctx->path), OUTPATH "/%016lX - %s/%s (%s)/Section %u (%s)", info->meta_key.id, info->app_metadata->lang_entry.name, ((NcaContext*)nca_fs_ctx->nca_ctx)->content_id_str, \
              titleGetNcmContentTypeName(((NcaContext*)nca_fs_ctx->nca_ctx)->content_type), nca_fs_ctx->section_idx, ncaGetFsSectionTypeName(nca_fs_ctx));
     utilsCreateDirectoryTree(path, true);
     path_len = strlen(path);
 
     while(romfsCanMoveToNextFileEntry(&romfs_ctx))
     {
+        if (dump_ctx->cancel_flag && *(dump_ctx->cancel_flag)) goto end;
+
         if (!(romfs_file_entry = romfsGetCurrentFileEntry(&romfs_ctx)) || \
-            !romfsGeneratePathFromFileEntry(&romfs_ctx, romfs_file_entry, path + path_len, sizeof(path) - path_len, RomFileSystemPathIllegalCharReplaceType_KeepAsciiCharsOnly))
+            !romfsGeneratePathFromFileEntry(&romfs_ctx, romfs_file_entry, path + path_len, sizeof(dump_ctx->path) - path_len, RomFileSystemPathIllegalCharReplaceType_KeepAsciiCharsOnly))
         {
             consolePrint("romfs get entry / generate path failed for 0x%lX!\n", romfs_ctx.cur_file_offset);
             goto end;
@@ -188,8 +256,8 @@ static void dumpRomFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
 
         utilsCreateDirectoryTree(path, false);
 
-        filefd = fopen(path, "wb");
-        if (!filefd)
+        dump_ctx->filefd = fopen(path, "wb");
+        if (!dump_ctx->filefd)
         {
             consolePrint("failed to create \"%s\"!\n", path);
             goto end;
@@ -197,22 +265,27 @@ static void dumpRomFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
 
         consolePrint("dumping \"%s\"...\n", path + path_len);
 
-        u64 blksize = BLOCK_SIZE;
+        u64 blksize = dump_ctx->buf_size;
         for(u64 j = 0; j < romfs_file_entry->size; j += blksize)
         {
             if (blksize > (romfs_file_entry->size - j)) blksize = (romfs_file_entry->size - j);
 
-            if (!romfsReadFileEntryData(&romfs_ctx, romfs_file_entry, buf, blksize, j))
+            mutexLock(&g_ncaReadMutex);
+            bool read_success = romfsReadFileEntryData(&romfs_ctx, romfs_file_entry, dump_ctx->buf, blksize, j);
+            mutexUnlock(&g_ncaReadMutex);
+
+            if (!read_success)
             {
                 consolePrint("failed to read 0x%lX block from offset 0x%lX!\n", blksize, j);
                 goto end;
             }
 
-            fwrite(buf, 1, blksize, filefd);
+            fwrite(dump_ctx->buf, 1, blksize, dump_ctx->filefd);
+            data_written += blksize;
         }
 
-        fclose(filefd);
-        filefd = NULL;
+        fclose(dump_ctx->filefd);
+        dump_ctx->filefd = NULL;
 
         if (!romfsMoveToNextFileEntry(&romfs_ctx))
         {
@@ -222,36 +295,230 @@ static void dumpRomFs(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
     }
 
     consolePrint("romfs dump complete\n");
+    success = true;
 
 end:
-    if (filefd)
+    if (dump_ctx->filefd)
     {
-        fclose(filefd);
+        fclose(dump_ctx->filefd);
         remove(path);
+        dump_ctx->filefd = NULL;
     }
 
-    if (*path) utilsCommitSdCardFileSystemChanges();
+    /* Schedule a batched SD card commit for the data we just wrote. */
+    if (*path) utilsScheduleSdCardFileSystemCommit(data_written);
 
     romfsFreeContext(&romfs_ctx);
+
+    return success;
 }
 
-static void dumpFsSection(TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
+static bool dumpFsSection(DumpContext *dump_ctx, TitleInfo *info, NcaFsSectionContext *nca_fs_ctx)
 {
-    if (!buf || !info || !nca_fs_ctx) return;
+    if (!dump_ctx || !dump_ctx->buf || !info || !nca_fs_ctx) return false;
+
+    bool success = false;
 
     switch(nca_fs_ctx->section_type)
     {
         case NcaFsSectionType_PartitionFs:
-            dumpPartitionFs(info, nca_fs_ctx);
+            success = dumpPartitionFs(dump_ctx, info, nca_fs_ctx);
             break;
         case NcaFsSectionType_RomFs:
         case NcaFsSectionType_Nca0RomFs:
-            dumpRomFs(info, nca_fs_ctx);
+            success = dumpRomFs(dump_ctx, info, nca_fs_ctx);
             break;
         default:
             consolePrint("invalid section type!\n");
             break;
     }
+
+    return success;
+}
+
+static bool batchDumpTitle(DumpContext *dump_ctx, TitleApplicationMetadata *app_metadata)
+{
+    TitleInfo *title_info = NULL;
+    NcaContext *nca_ctx = NULL;
+    bool success = false;
+
+    consolePrint("dumping %016lX - %s\n", app_metadata->title_id, app_metadata->lang_entry.name);
+
+    title_info = titleGetInfoFromStorageByTitleId(NcmStorageId_BuiltInSystem, app_metadata->title_id);
+    if (!title_info)
+    {
+        consolePrint("failed to get title info for %016lX\n", app_metadata->title_id);
+        return false;
+    }
+
+    nca_ctx = ncaAllocateContexts(1);
+    if (!nca_ctx)
+    {
+        consolePrint("nca ctx alloc failed for %016lX\n", app_metadata->title_id);
+        goto end;
+    }
+
+    success = true;
+
+    for(u32 i = 0; i < title_info->content_count; i++)
+    {
+        if (dump_ctx->cancel_flag && *(dump_ctx->cancel_flag))
+        {
+            success = false;
+            break;
+        }
+
+        if (!ncaInitializeContext(nca_ctx, title_info->storage_id, 0, &(title_info->content_infos[i]), title_info->version.value, NULL))
+        {
+            consolePrint("nca initialize ctx failed for %016lX content #%u\n", app_metadata->title_id, i);
+            success = false;
+            continue;
+        }
+
+        /* Dump every valid PartitionFS / RomFS section from this content. */
+        for(u8 j = 0; j < NCA_FS_HEADER_COUNT; j++)
+        {
+            NcaFsSectionContext *nca_fs_ctx = &(nca_ctx->fs_ctx[j]);
+            if (!nca_fs_ctx->enabled || (nca_fs_ctx->section_type != NcaFsSectionType_PartitionFs && nca_fs_ctx->section_type != NcaFsSectionType_RomFs && \
+                nca_fs_ctx->section_type != NcaFsSectionType_Nca0RomFs)) continue;
+            if (!dumpFsSection(dump_ctx, title_info, nca_fs_ctx)) success = false;
+        }
+    }
+
+end:
+    if (nca_ctx) ncaFreeContexts(nca_ctx, 1);
+
+    titleFreeTitleInfo(&title_info);
+
+    return success;
+}
+
+static void batchWorkerThreadFunc(void *arg)
+{
+    BatchWorkerData *worker_data = (BatchWorkerData*)arg;
+
+    BatchSharedData *shared_data = (worker_data ? worker_data->shared_data : NULL);
+    if (!shared_data || !worker_data->dump_ctx.buf) goto end;
+
+    while(true)
+    {
+        TitleApplicationMetadata *app_metadata = NULL;
+
+        /* Claim the next unprocessed title. */
+        mutexLock(&g_batchMutex);
+        if (!shared_data->cancelled && shared_data->next_title < shared_data->app_count) app_metadata = shared_data->app_metadata[shared_data->next_title++];
+        mutexUnlock(&g_batchMutex);
+
+        if (!app_metadata) break;
+
+        /* Dump the claimed title using this worker's own pipeline. */
+        bool title_success = batchDumpTitle(&(worker_data->dump_ctx), app_metadata);
+
+        mutexLock(&g_batchMutex);
+        shared_data->processed_titles++;
+        if (!title_success) shared_data->failed_titles++;
+        mutexUnlock(&g_batchMutex);
+    }
+
+end:
+    threadExit();
+}
+
+static void batchDumpAllTitles(TitleApplicationMetadata **app_metadata, u32 app_count)
+{
+    BatchSharedData shared_data = {0};
+    BatchWorkerData worker_data[BATCH_WORKER_COUNT] = {0};
+    Thread worker_threads[BATCH_WORKER_COUNT] = {0};
+    u32 worker_count = 0;
+
+    shared_data.app_metadata = app_metadata;
+    shared_data.app_count = app_count;
+
+    /* Budget worker buffers. The budgeter shrinks the block size under applet mode, so a smaller pool simply degrades throughput instead of failing outright. */
+    u64 buf_size = utilsGetDumpBlockSize(BATCH_WORKER_COUNT);
+    if (buf_size > BLOCK_SIZE) buf_size = BLOCK_SIZE;
+
+    for(u32 i = 0; i < BATCH_WORKER_COUNT; i++)
+    {
+        worker_data[i].shared_data = &shared_data;
+        worker_data[i].dump_ctx.buf_size = buf_size;
+        worker_data[i].dump_ctx.cancel_flag = &(shared_data.cancelled);
+        if (!(worker_data[i].dump_ctx.buf = malloc(buf_size))) break;
+        worker_count++;
+    }
+
+    if (!worker_count)
+    {
+        consolePrint("failed to allocate worker buffers\n");
+        goto end;
+    }
+
+    consolePrint("dumping %u titles using %u workers (0x%lX block size)\nhold b to cancel\n\n", app_count, worker_count, buf_size);
+
+    /* Spread the workers across cores - each one claims whole titles off the shared queue. */
+    for(u32 i = 0; i < worker_count; i++) utilsCreateThread(&(worker_threads[i]), batchWorkerThreadFunc, &(worker_data[i]), (int)(i % 3));
+
+    time_t btn_cancel_start_tmr = 0, btn_cancel_end_tmr = 0;
+    bool btn_cancel_cur_state = false, btn_cancel_prev_state = false;
+
+    while(appletMainLoop())
+    {
+        mutexLock(&g_batchMutex);
+        bool done = (shared_data.processed_titles >= shared_data.app_count);
+        mutexUnlock(&g_batchMutex);
+
+        if (done) break;
+
+        utilsScanPads();
+        btn_cancel_cur_state = (utilsGetButtonsHeld() & HidNpadButton_B);
+
+        time_t now = time(NULL);
+
+        if (btn_cancel_cur_state && btn_cancel_cur_state != btn_cancel_prev_state)
+        {
+            btn_cancel_start_tmr = now;
+        } else
+        if (btn_cancel_cur_state && btn_cancel_cur_state == btn_cancel_prev_state)
+        {
+            btn_cancel_end_tmr = now;
+            if ((btn_cancel_end_tmr - btn_cancel_start_tmr) >= 3)
+            {
+                mutexLock(&g_batchMutex);
+                shared_data.cancelled = true;
+                mutexUnlock(&g_batchMutex);
+                break;
+            }
+        } else {
+            btn_cancel_start_tmr = btn_cancel_end_tmr = 0;
+        }
+
+        btn_cancel_prev_state = btn_cancel_cur_state;
+
+        svcSleepThread(50000000); // 50 ms
+    }
+
+    /* If the applet loop ended early, let the workers wind down after their current title instead of draining the rest of the queue. */
+    mutexLock(&g_batchMutex);
+    if (shared_data.processed_titles < shared_data.app_count) shared_data.cancelled = true;
+    mutexUnlock(&g_batchMutex);
+
+    for(u32 i = 0; i < worker_count; i++) utilsJoinThread(&(worker_threads[i]));
+
+    /* Push any scheduled commit down to the filesystem now that the batch is over. */
+    utilsFlushScheduledSdCardFileSystemCommits();
+
+    if (shared_data.cancelled)
+    {
+        consolePrint("\nbatch dump cancelled (%u / %u titles processed)\n", shared_data.processed_titles, shared_data.app_count);
+    } else {
+        consolePrint("\nbatch dump complete (%u titles processed, %u failed)\n", shared_data.processed_titles, shared_data.failed_titles);
+    }
+
+end:
+    for(u32 i = 0; i < BATCH_WORKER_COUNT; i++)
+    {
+        if (worker_data[i].dump_ctx.buf) free(worker_data[i].dump_ctx.buf);
+    }
 }
 
 int main(int argc, char *argv[])
@@ -284,6 +551,10 @@ int main(int argc, char *argv[])
 
     bool applet_status = true;
 
+    /* Title data is streamed in on a background thread - wait for it to be fully loaded before building the menu. */
+    consolePrint("waiting for title info...\n");
+    while(appletMainLoop() && !titleIsStorageLoadComplete()) svcSleepThread(10000000); // 10 ms
+
     app_metadata = titleGetApplicationMetadataEntries(true, &app_count);
     if (!app_metadata || !app_count)
     {
@@ -293,8 +564,8 @@ int main(int argc, char *argv[])
 
     consolePrint("app metadata succeeded\n");
 
-    buf = malloc(BLOCK_SIZE);
-    if (!buf)
+    g_dumpCtx.buf_size = BLOCK_SIZE;
+    if (!(g_dumpCtx.buf = malloc(g_dumpCtx.buf_size)))
     {
         consolePrint("buf failed\n");
         goto out2;
@@ -302,7 +573,7 @@ int main(int argc, char *argv[])
 
     consolePrint("buf succeeded\n");
 
-    nca_ctx = calloc(1, sizeof(NcaContext));
+    nca_ctx = ncaAllocateContexts(1);
     if (!nca_ctx)
     {
         consolePrint("nca ctx buf failed\n");
@@ -318,7 +589,9 @@ int main(int argc, char *argv[])
         consoleClear();
 
         printf("select a %s.", menu == 0 ? "system title to view its contents" : (menu == 1 ? "content" : "fs section"));
-        printf("\npress b to %s.\n\n", menu == 0 ? "exit" : "go back");
+        printf("\npress b to %s.\n", menu == 0 ? "exit" : "go back");
+        if (menu == 0) printf("press x to dump every system title.\n");
+        printf("\n");
 
         if (menu == 0)
         {
@@ -367,6 +640,17 @@ int main(int argc, char *argv[])
 
         if (!applet_status) break;
 
+        if (menu == 0 && (btn_down & HidNpadButton_X))
+        {
+            /* Batch dump every system title through the parallel scheduler. */
+            consoleClear();
+            utilsSetLongRunningProcessState(true);
+            batchDumpAllTitles(app_metadata, app_count);
+            utilsSetLongRunningProcessState(false);
+
+            consolePrint("press any button to continue\n");
+            utilsWaitForButtonPress(0);
+        } else
         if (btn_down & HidNpadButton_A)
         {
             bool error = false;
@@ -405,7 +689,8 @@ int main(int argc, char *argv[])
             {
                 consoleClear();
                 utilsSetLongRunningProcessState(true);
-                dumpFsSection(cur_title_info, &(nca_ctx->fs_ctx[selected_idx]));
+                dumpFsSection(&g_dumpCtx, cur_title_info, &(nca_ctx->fs_ctx[selected_idx]));
+                utilsFlushScheduledSdCardFileSystemCommits();
                 utilsSetLongRunningProcessState(false);
             }
 
@@ -481,9 +766,9 @@ out2:
         utilsWaitForButtonPress(0);
     }
 
-    if (nca_ctx) free(nca_ctx);
+    if (nca_ctx) ncaFreeContexts(nca_ctx, 1);
 
-    if (buf) free(buf);
+    if (g_dumpCtx.buf) free(g_dumpCtx.buf);
 
     if (app_metadata) free(app_metadata);
 
@@ -24,28 +24,28 @@
 #include "gamecard.h"
 #include "usb.h"
 #include "title.h"
+#include "dump.h"
 
-#define BLOCK_SIZE  USB_TRANSFER_BUFFER_SIZE
+#define BLOCK_SIZE              USB_TRANSFER_BUFFER_SIZE
+
+#define DIR_TABLE_CHUNK_ENTRIES 1024    /* Number of directory paths generated and announced to the host per usbSendDirectoryTable() call. */
 
 bool g_borealisInitialized = false;
 
 static PadState g_padState = {0};
 
-static Mutex g_fileMutex = 0;
-static CondVar g_readCondvar = 0, g_writeCondvar = 0;
+/* File properties for a single RomFS file entry. Attached by the producer stage to the first chunk of each file, sent to the USB host and freed by the consumer stage. */
+typedef struct {
+    char path[FS_MAX_PATH]; ///< Output path for this file entry.
+    u64 size;               ///< File entry size.
+} RomfsFileProps;
 
-typedef struct
-{
-    //FILE *fileobj;
+/* Producer stage state. RomFS file entries are streamed back-to-back as a single flat stream. */
+typedef struct {
     RomFileSystemContext *romfs_ctx;
-    void *data;
-    size_t data_size;
-    size_t data_written;
-    size_t total_size;
-    bool read_error;
-    bool write_error;
-    bool transfer_cancelled;
-} ThreadSharedData;
+    RomFileSystemFileEntry *cur_file_entry; ///< File entry currently being streamed. NULL if the next chunk starts a new file entry.
+    u64 cur_file_offset;                    ///< Read offset within the current file entry.
+} RomfsProducerContext;
 
 static void utilsScanPads(void)
 {
@@ -84,188 +84,136 @@ static void consolePrint(const char *text, ...)
     consoleUpdate(NULL);
 }
 
-static void read_thread_func(void *arg)
+static bool romfsDumpProducerFunc(void *userdata, void *buf, u64 buf_size, u64 *out_size, void **out_tag)
 {
-    ThreadSharedData *shared_data = (ThreadSharedData*)arg;
-    if (!shared_data || !shared_data->data || !shared_data->total_size || !shared_data->romfs_ctx)
-    {
-        shared_data->read_error = true;
-        goto end;
-    }
+    RomfsProducerContext *producer_ctx = (RomfsProducerContext*)userdata;
+    RomFileSystemFileEntry *file_entry = producer_ctx->cur_file_entry;
 
-    u8 *buf = malloc(BLOCK_SIZE);
-    if (!buf)
+    /* Open the next file entry if we're not streaming one. */
+    if (!file_entry)
     {
-        shared_data->read_error = true;
-        goto end;
-    }
+        /* End of stream - 'out_size' stays zero and no tag is attached. */
+        if (!romfsCanMoveToNextFileEntry(producer_ctx->romfs_ctx)) return true;
 
-    RomFileSystemFileEntry *file_entry = NULL;
-    char path[FS_MAX_PATH] = {0};
+        /* Retrieve RomFS file entry information. */
+        if (!(file_entry = romfsGetCurrentFileEntry(producer_ctx->romfs_ctx))) return false;
 
-    /* Reset current file table offset. */
-    romfsResetFileTableOffset(shared_data->romfs_ctx);
+        /* Attach the file properties to this chunk. The consumer stage sends them to the USB host in stream order, then frees them. */
+        RomfsFileProps *props = calloc(1, sizeof(RomfsFileProps));
+        if (!props) return false;
 
-    /* Loop through all file entries. */
-    while(shared_data->data_written < shared_data->total_size && romfsCanMoveToNextFileEntry(shared_data->romfs_ctx))
-    {
-        /* Check if the transfer has been cancelled by the user */
-        if (shared_data->transfer_cancelled)
+        if (!romfsGeneratePathFromFileEntry(producer_ctx->romfs_ctx, file_entry, props->path, FS_MAX_PATH, RomFileSystemPathIllegalCharReplaceType_IllegalFsChars))
         {
-            condvarWakeAll(&g_writeCondvar);
-            break;
+            free(props);
+            return false;
         }
 
-        /* Retrieve RomFS file entry information */
-        /*shared_data->read_error = (!(file_entry = romfsGetCurrentFileEntry(shared_data->romfs_ctx)));
-        if (shared_data->read_error)
-        {
-            condvarWakeAll(&g_writeCondvar);
-            break;
-        }
+        props->size = file_entry->size;
+        *out_tag = props;
 
-        bool updated = false;
-        shared_data->read_error = !romfsIsFileEntryUpdated(shared_data->romfs_ctx, file_entry, &updated);
-        if (shared_data->read_error)
-        {
-            condvarWakeAll(&g_writeCondvar);
-            break;
-        }
-
-        if (!updated)
-        {
-            shared_data->read_error = !romfsMoveToNextFileEntry(shared_data->romfs_ctx);
-            if (shared_data->read_error)
-            {
-                condvarWakeAll(&g_writeCondvar);
-                break;
-            }
+        producer_ctx->cur_file_entry = file_entry;
+        producer_ctx->cur_file_offset = 0;
 
-            continue;
-        }
-
-        shared_data->read_error = !romfsGeneratePathFromFileEntry(shared_data->romfs_ctx, file_entry, path, FS_MAX_PATH, RomFileSystemPathIllegalCharReplaceType_IllegalFsChars);*/
-
-        shared_data->read_error = (!(file_entry = romfsGetCurrentFileEntry(shared_data->romfs_ctx)) || \
-                                    !romfsGeneratePathFromFileEntry(shared_data->romfs_ctx, file_entry, path, FS_MAX_PATH, RomFileSystemPathIllegalCharReplaceType_IllegalFsChars));
-        if (shared_data->read_error)
+        /* Empty files still need their properties sent - publish a zero-length chunk holding just the tag. The USB host creates them on its own. */
+        if (!file_entry->size)
         {
-            condvarWakeAll(&g_writeCondvar);
-            break;
+            producer_ctx->cur_file_entry = NULL;
+            return romfsMoveToNextFileEntry(producer_ctx->romfs_ctx);
         }
+    }
 
-        /* Wait until the previous file data chunk has been written */
-        mutexLock(&g_fileMutex);
-        if (shared_data->data_size && !shared_data->write_error) condvarWait(&g_readCondvar, &g_fileMutex);
-        mutexUnlock(&g_fileMutex);
-        if (shared_data->write_error) break;
-
-        /* Send current file properties */
-        shared_data->read_error = !usbSendFilePropertiesCommon(file_entry->size, path);
-        if (shared_data->read_error)
-        {
-            condvarWakeAll(&g_writeCondvar);
-            break;
-        }
-
-        for(u64 offset = 0, blksize = BLOCK_SIZE; offset < file_entry->size; offset += blksize)
-        {
-            if (blksize > (file_entry->size - offset)) blksize = (file_entry->size - offset);
-
-            /* Check if the transfer has been cancelled by the user */
-            if (shared_data->transfer_cancelled)
-            {
-                condvarWakeAll(&g_writeCondvar);
-                break;
-            }
-
-            /* Read current file data chunk */
-            shared_data->read_error = !romfsReadFileEntryData(shared_data->romfs_ctx, file_entry, buf, blksize, offset);
-            if (shared_data->read_error)
-            {
-                condvarWakeAll(&g_writeCondvar);
-                break;
-            }
-
-            /* Wait until the previous file data chunk has been written */
-            mutexLock(&g_fileMutex);
+    /* Read the current file data chunk. */
+    u64 blksize = buf_size;
+    if (blksize > (file_entry->size - producer_ctx->cur_file_offset)) blksize = (file_entry->size - producer_ctx->cur_file_offset);
 
-            if (shared_data->data_size && !shared_data->write_error) condvarWait(&g_readCondvar, &g_fileMutex);
+    if (!romfsReadFileEntryData(producer_ctx->romfs_ctx, file_entry, buf, blksize, producer_ctx->cur_file_offset)) return false;
 
-            if (shared_data->write_error)
-            {
-                mutexUnlock(&g_fileMutex);
-                break;
-            }
+    *out_size = blksize;
+    producer_ctx->cur_file_offset += blksize;
 
-            /* Copy current file data chunk to the shared buffer */
-            memcpy(shared_data->data, buf, blksize);
-            shared_data->data_size = blksize;
+    /* Move past the current file entry once it has been fully read. */
+    if (producer_ctx->cur_file_offset >= file_entry->size)
+    {
+        producer_ctx->cur_file_entry = NULL;
+        return romfsMoveToNextFileEntry(producer_ctx->romfs_ctx);
+    }
 
-            /* Wake up the write thread to continue writing data */
-            mutexUnlock(&g_fileMutex);
-            condvarWakeAll(&g_writeCondvar);
-        }
+    return true;
+}
 
-        if (shared_data->read_error || shared_data->write_error || shared_data->transfer_cancelled) break;
+static bool romfsDumpConsumerFunc(void *userdata, const void *buf, u64 size, void *tag)
+{
+    (void)userdata;
 
-        /* Move to the next file entry. */
-        shared_data->read_error = !romfsMoveToNextFileEntry(shared_data->romfs_ctx);
-        if (shared_data->read_error)
-        {
-            condvarWakeAll(&g_writeCondvar);
-            break;
-        }
+    /* Send properties for the file entry that starts at this chunk. */
+    if (tag)
+    {
+        RomfsFileProps *props = (RomfsFileProps*)tag;
+        bool props_sent = usbSendFilePropertiesCommon(props->size, props->path);
+        free(props);
+        if (!props_sent) return false;
     }
 
-    free(buf);
+    /* Send current file data chunk. */
+    return (size ? usbSendFileData((void*)buf, size) : true);
+}
 
-end:
-    threadExit();
+static void romfsDumpCancelFunc(void *userdata)
+{
+    (void)userdata;
+    usbCancelFileTransfer();
 }
 
-static void write_thread_func(void *arg)
+/* Walks the parsed RomFS directory table and announces every output directory to the host, letting it create the whole directory tree in one pass. */
+static bool sendRomfsDirectoryTable(RomFileSystemContext *romfs_ctx)
 {
-    ThreadSharedData *shared_data = (ThreadSharedData*)arg;
-    if (!shared_data || !shared_data->data)
-    {
-        shared_data->write_error = true;
-        goto end;
-    }
+    char *path_buf = NULL;
+    const char **dir_paths = NULL;
+    u32 chunk_count = 0;
+    bool success = false;
 
-    while(shared_data->data_written < shared_data->total_size)
-    {
-        /* Wait until the current file data chunk has been read */
-        mutexLock(&g_fileMutex);
+    /* Allocate memory for a single chunk of directory paths. Bigger tables are sent across multiple usbSendDirectoryTable() calls. */
+    path_buf = malloc(DIR_TABLE_CHUNK_ENTRIES * FS_MAX_PATH);
+    dir_paths = malloc(DIR_TABLE_CHUNK_ENTRIES * sizeof(char*));
+    if (!path_buf || !dir_paths) goto end;
 
-        if (!shared_data->data_size && !shared_data->read_error) condvarWait(&g_writeCondvar, &g_fileMutex);
+    for(u32 i = 0; i < DIR_TABLE_CHUNK_ENTRIES; i++) dir_paths[i] = (path_buf + ((u64)i * FS_MAX_PATH));
 
-        if (shared_data->read_error || shared_data->transfer_cancelled)
-        {
-            if (shared_data->transfer_cancelled) usbCancelFileTransfer();
-            mutexUnlock(&g_fileMutex);
-            break;
-        }
+    /* Reset current directory table offset. */
+    romfsResetDirectoryTableOffset(romfs_ctx);
 
-        //shared_data->write_error = (fwrite(shared_data->data, 1, shared_data->data_size, shared_data->fileobj) != shared_data->data_size);
+    while(romfsCanMoveToNextDirectoryEntry(romfs_ctx))
+    {
+        RomFileSystemDirectoryEntry *dir_entry = romfsGetCurrentDirectoryEntry(romfs_ctx);
+        if (!dir_entry) goto end;
 
-        /* Write current file data chunk */
-        shared_data->write_error = !usbSendFileData(shared_data->data, shared_data->data_size);
-        if (!shared_data->write_error)
+        /* Skip the nameless root entry - it maps to the output directory itself. */
+        if (dir_entry->name_length)
         {
-            shared_data->data_written += shared_data->data_size;
-            shared_data->data_size = 0;
-        }
+            if (!romfsGeneratePathFromDirectoryEntry(romfs_ctx, dir_entry, path_buf + ((u64)chunk_count * FS_MAX_PATH), FS_MAX_PATH, \
+                                                     RomFileSystemPathIllegalCharReplaceType_IllegalFsChars)) goto end;
+
+            chunk_count++;
 
-        /* Wake up the read thread to continue reading data */
-        mutexUnlock(&g_fileMutex);
-        condvarWakeAll(&g_readCondvar);
+            /* Flush the current chunk if it's full. */
+            if (chunk_count == DIR_TABLE_CHUNK_ENTRIES)
+            {
+                if (!usbSendDirectoryTable(dir_paths, chunk_count)) goto end;
+                chunk_count = 0;
+            }
+        }
 
-        if (shared_data->write_error) break;
+        if (!romfsMoveToNextDirectoryEntry(romfs_ctx)) break;
     }
 
+    /* Send the last chunk. */
+    success = (chunk_count ? usbSendDirectoryTable(dir_paths, chunk_count) : true);
+
 end:
-    threadExit();
+    if (dir_paths) free(dir_paths);
+    if (path_buf) free(path_buf);
+
+    return success;
 }
 
 u8 get_program_id_offset(TitleInfo *info, u32 program_count)
@@ -408,14 +356,17 @@ int main(int argc, char *argv[])
     u32 selected_idx = 0, page_size = 30, scroll = 0;
     bool applet_status = true, exit_prompt = true;
 
-    u8 *buf = NULL;
-
     NcaContext *base_nca_ctx = NULL, *update_nca_ctx = NULL;
 
     RomFileSystemContext romfs_ctx = {0};
 
-    ThreadSharedData shared_data = {0};
-    Thread read_thread = {0}, write_thread = {0};
+    RomfsProducerContext producer_ctx = {0};
+    DumpPipeline pipeline = {0};
+    u64 total_size = 0;
+
+    /* Title data is streamed in on a background thread - wait for it to be fully loaded before building the menu. */
+    consolePrint("waiting for title info...\n");
+    while(appletMainLoop() && !titleIsStorageLoadComplete()) svcSleepThread(10000000); // 10 ms
 
     app_metadata = titleGetApplicationMetadataEntries(false, &app_count);
     if (!app_metadata || !app_count)
@@ -426,16 +377,7 @@ int main(int argc, char *argv[])
 
     consolePrint("app metadata succeeded\n");
 
-    buf = usbAllocatePageAlignedBuffer(BLOCK_SIZE);
-    if (!buf)
-    {
-        consolePrint("buf failed\n");
-        goto out2;
-    }
-
-    consolePrint("buf succeeded\n");
-
-    base_nca_ctx = calloc(1, sizeof(NcaContext));
+    base_nca_ctx = ncaAllocateContexts(1);
     if (!base_nca_ctx)
     {
         consolePrint("base nca ctx buf failed\n");
@@ -444,7 +386,7 @@ int main(int argc, char *argv[])
 
     consolePrint("base nca ctx buf succeeded\n");
 
-    update_nca_ctx = calloc(1, sizeof(NcaContext));
+    update_nca_ctx = ncaAllocateContexts(1);
     if (!update_nca_ctx)
     {
         consolePrint("update nca ctx buf failed\n");
@@ -627,9 +569,8 @@ int main(int argc, char *argv[])
         }
     }
 
-    shared_data.romfs_ctx = &romfs_ctx;
-    //if (!romfsGetTotalDataSize(&romfs_ctx, true, &(shared_data.total_size)) || !shared_data.total_size)
-    if (!romfsGetTotalDataSize(&romfs_ctx, false, &(shared_data.total_size)) || !shared_data.total_size)
+    //if (!romfsGetTotalDataSize(&romfs_ctx, true, &total_size) || !total_size)
+    if (!romfsGetTotalDataSize(&romfs_ctx, false, &total_size) || !total_size)
     {
         consolePrint("failed to retrieve total romfs size\n");
         goto out2;
@@ -637,9 +578,16 @@ int main(int argc, char *argv[])
 
     consolePrint("romfs initialize ctx succeeded\n");
 
-    shared_data.data = buf;
-    shared_data.data_size = 0;
-    shared_data.data_written = 0;
+    /* Reset current file table offset. */
+    romfsResetFileTableOffset(&romfs_ctx);
+
+    producer_ctx.romfs_ctx = &romfs_ctx;
+
+    if (!dumpPipelineInitialize(&pipeline, romfsDumpProducerFunc, &producer_ctx, NULL, NULL, romfsDumpConsumerFunc, NULL, romfsDumpCancelFunc, NULL, total_size, BLOCK_SIZE))
+    {
+        consolePrint("dump pipeline initialize failed\n");
+        goto out2;
+    }
 
     consolePrint("waiting for usb connection... ");
 
@@ -670,9 +618,16 @@ int main(int argc, char *argv[])
         goto out2;
     }
 
-    consolePrint("creating threads\n");
-    utilsCreateThread(&read_thread, read_thread_func, &shared_data, 2);
-    utilsCreateThread(&write_thread, write_thread_func, &shared_data, 2);
+    /* Transmit the RomFS directory table so the host can create the whole output directory tree in one pass. */
+    /* Not fatal on failure - older host tools simply keep creating directories on a per-file basis. */
+    if (!sendRomfsDirectoryTable(&romfs_ctx)) consolePrint("failed to send directory table preamble (old host tool?)\n");
+
+    consolePrint("starting dump pipeline\n");
+    if (!dumpPipelineStart(&pipeline))
+    {
+        consolePrint("dump pipeline start failed\n");
+        goto out2;
+    }
 
     u8 prev_time = 0;
     u64 prev_size = 0;
@@ -687,15 +642,15 @@ int main(int argc, char *argv[])
 
     start = time(NULL);
 
-    while(shared_data.data_written < shared_data.total_size)
+    while(dumpPipelineIsRunning(&pipeline))
     {
-        if (shared_data.read_error || shared_data.write_error) break;
-
         struct tm ts = {0};
         time_t now = time(NULL);
         localtime_r(&now, &ts);
 
-        size_t size = shared_data.data_written;
+        DumpPipelineStats stats = {0};
+        dumpPipelineGetStats(&pipeline, &stats);
+        size_t size = stats.consumed_size;
 
         utilsScanPads();
         btn_cancel_cur_state = (utilsGetButtonsHeld() & HidNpadButton_B);
@@ -709,9 +664,7 @@ int main(int argc, char *argv[])
             btn_cancel_end_tmr = now;
             if ((btn_cancel_end_tmr - btn_cancel_start_tmr) >= 3)
             {
-                mutexLock(&g_fileMutex);
-                shared_data.transfer_cancelled = true;
-                mutexUnlock(&g_fileMutex);
+                dumpPipelineCancel(&pipeline);
                 break;
             }
         } else {
@@ -722,34 +675,31 @@ int main(int argc, char *argv[])
 
         if (prev_time == ts.tm_sec || prev_size == size) continue;
 
-        percent = (u8)((size * 100) / shared_data.total_size);
+        percent = (u8)((size * 100) / total_size);
 
         prev_time = ts.tm_sec;
         prev_size = size;
 
-        printf("%lu / %lu (%u%%) | Time elapsed: %lu\n", size, shared_data.total_size, percent, (now - start));
+        printf("%lu / %lu (%u%%) | Time elapsed: %lu\n", size, total_size, percent, (now - start));
         consoleUpdate(NULL);
     }
 
     start = (time(NULL) - start);
 
-    consolePrint("\nwaiting for threads to join\n");
-    utilsJoinThread(&read_thread);
-    consolePrint("read_thread done: %lu\n", time(NULL));
-    utilsJoinThread(&write_thread);
-    consolePrint("write_thread done: %lu\n", time(NULL));
+    consolePrint("\nwaiting for the dump pipeline to finish\n");
+    bool dump_success = dumpPipelineWait(&pipeline);
 
     utilsSetLongRunningProcessState(false);
 
-    if (shared_data.read_error || shared_data.write_error)
+    if (!dump_success)
     {
-        consolePrint("usb transfer error\n");
-        goto out2;
-    }
+        if (dumpPipelineIsCancelled(&pipeline))
+        {
+            consolePrint("process cancelled\n");
+        } else {
+            consolePrint("usb transfer error\n");
+        }
 
-    if (shared_data.transfer_cancelled)
-    {
-        consolePrint("process cancelled\n");
         goto out2;
     }
 
@@ -762,16 +712,23 @@ out2:
         utilsWaitForButtonPress(0);
     }
 
+    /* Free file properties attached to chunks the consumer stage never got to process (error / cancellation paths). */
+    for(size_t i = atomic_load(&(pipeline.consumed_count)); i < atomic_load(&(pipeline.produced_count)); i++)
+    {
+        void *tag = pipeline.slot_tag[i % DUMP_PIPELINE_RING_BUFFER_COUNT];
+        if (tag) free(tag);
+    }
+
+    dumpPipelineClose(&pipeline);
+
     romfsFreeContext(&romfs_ctx);
 
-    if (update_nca_ctx) free(update_nca_ctx);
+    if (update_nca_ctx) ncaFreeContexts(update_nca_ctx, 1);
 
-    if (base_nca_ctx) free(base_nca_ctx);
+    if (base_nca_ctx) ncaFreeContexts(base_nca_ctx, 1);
 
     titleFreeUserApplicationData(&user_app_data);
 
-    if (buf) free(buf);
-
     if (app_metadata) free(app_metadata);
 
 out:
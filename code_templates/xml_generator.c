@@ -27,10 +27,29 @@
 #include "nacp.h"
 #include "legal_info.h"
 
+/* Number of titles processed concurrently by the batch XML generator. Content-type contexts are fully independent, so the only shared state is the console and the SD card. */
+#define BATCH_WORKER_COUNT  3
+
+/* Chunk size used to stream legal information XML documents too big to be materialized in memory. */
+#define LEGAL_INFO_CHUNK_SIZE   0x40000
+
 bool g_borealisInitialized = false;
 
 static PadState g_padState = {0};
 
+static Mutex g_consoleMutex = 0;
+static Mutex g_batchMutex = 0;
+
+typedef struct
+{
+    TitleApplicationMetadata **app_metadata;    ///< User application metadata entries. Doubles as the shared work queue.
+    u32 app_count;                              ///< Total entry count.
+    u32 next_title;                             ///< Index of the next unclaimed entry.
+    u32 processed_titles;                       ///< Number of fully processed entries, successful or not.
+    u32 failed_titles;                          ///< Number of entries that couldn't be fully processed.
+    bool cancelled;                             ///< Set once the user aborts the batch run.
+} BatchSharedData;
+
 static void utilsScanPads(void)
 {
     padUpdate(&g_padState);
@@ -61,11 +80,15 @@ static void utilsWaitForButtonPress(u64 flag)
 
 static void consolePrint(const char *text, ...)
 {
+    mutexLock(&g_consoleMutex);
+
     va_list v;
     va_start(v, text);
     vfprintf(stdout, text, v);
     va_end(v);
     consoleUpdate(NULL);
+
+    mutexUnlock(&g_consoleMutex);
 }
 
 static void writeFile(void *buf, size_t buf_size, const char *path)
@@ -75,34 +98,49 @@ static void writeFile(void *buf, size_t buf_size, const char *path)
     {
         fwrite(buf, 1, buf_size, fd);
         fclose(fd);
-        utilsCommitSdCardFileSystemChanges();
+
+        /* Schedule a batched SD card commit - callers force a flush once they're done generating output files. */
+        utilsScheduleSdCardFileSystemCommit(buf_size);
     }
 }
 
-int main(int argc, char *argv[])
+static void writeLegalInfoFile(LegalInfoContext *legal_info_ctx, const char *path)
 {
-    int ret = 0;
-
-    if (!utilsInitializeResources(argc, (const char**)argv))
+    /* Materialized documents can be written in one go. */
+    if (legal_info_ctx->authoring_tool_xml)
     {
-        ret = -1;
-        goto out;
+        writeFile(legal_info_ctx->authoring_tool_xml, legal_info_ctx->authoring_tool_xml_size, path);
+        return;
     }
 
-    /* Configure input. */
-    /* Up to 8 different, full controller inputs. */
-    /* Individual Joy-Cons not supported. */
-    padConfigureInput(8, HidNpadStyleSet_NpadFullCtrl);
-    padInitializeWithMask(&g_padState, 0x1000000FFUL);
+    /* Stream documents too big to be materialized through a fixed-size chunk buffer. */
+    u8 *buf = malloc(LEGAL_INFO_CHUNK_SIZE);
+    if (!buf) return;
 
-    consoleInit(NULL);
+    FILE *fd = fopen(path, "wb");
+    if (fd)
+    {
+        u64 xml_size = legal_info_ctx->authoring_tool_xml_size;
 
-    u32 app_count = 0;
-    TitleApplicationMetadata **app_metadata = NULL;
-    TitleUserApplicationData user_app_data = {0};
+        for(u64 offset = 0, blksize = LEGAL_INFO_CHUNK_SIZE; offset < xml_size; offset += blksize)
+        {
+            if (blksize > (xml_size - offset)) blksize = (xml_size - offset);
+            if (!legalInfoReadAuthoringToolXml(legal_info_ctx, buf, blksize, offset)) break;
+            fwrite(buf, 1, blksize, fd);
+        }
 
-    u32 selected_idx = 0, page_size = 30, scroll = 0;
-    bool applet_status = true, exit_prompt = true;
+        fclose(fd);
+
+        /* Schedule a batched SD card commit - callers force a flush once they're done generating output files. */
+        utilsScheduleSdCardFileSystemCommit(xml_size);
+    }
+
+    free(buf);
+}
+
+static bool generateXmlsForTitle(TitleApplicationMetadata *app_metadata_entry, const bool *cancel_flag)
+{
+    TitleUserApplicationData user_app_data = {0};
 
     NcaContext *nca_ctx = NULL;
     Ticket tik = {0};
@@ -121,161 +159,49 @@ int main(int argc, char *argv[])
 
     char path[FS_MAX_PATH] = {0};
 
-    app_metadata = titleGetApplicationMetadataEntries(false, &app_count);
-    if (!app_metadata || !app_count)
-    {
-        consolePrint("app metadata failed\n");
-        goto out2;
-    }
+    u64 title_id = app_metadata_entry->title_id;
+    bool success = false;
 
-    consolePrint("app metadata succeeded\n");
-
-    utilsSleep(1);
-
-    while((applet_status = appletMainLoop()))
+    if (!titleGetUserApplicationData(title_id, &user_app_data) || !user_app_data.app_info)
     {
-        consoleClear();
-        printf("select a user application to generate xmls for.\npress b to exit.\n\n");
-        printf("title: %u / %u\n", selected_idx + 1, app_count);
-        printf("selected title: %016lX - %s\n\n", app_metadata[selected_idx]->title_id, app_metadata[selected_idx]->lang_entry.name);
-
-        for(u32 i = scroll; i < app_count; i++)
-        {
-            if (i >= (scroll + page_size)) break;
-            printf("%s%016lX - %s\n", i == selected_idx ? " -> " : "    ", app_metadata[i]->title_id, app_metadata[i]->lang_entry.name);
-        }
-
-        printf("\n");
-
-        consoleUpdate(NULL);
-
-        u64 btn_down = 0, btn_held = 0;
-        while((applet_status = appletMainLoop()))
-        {
-            utilsScanPads();
-            btn_down = utilsGetButtonsDown();
-            btn_held = utilsGetButtonsHeld();
-            if (btn_down || btn_held) break;
-
-            if (titleIsGameCardInfoUpdated())
-            {
-                free(app_metadata);
-
-                app_metadata = titleGetApplicationMetadataEntries(false, &app_count);
-                if (!app_metadata)
-                {
-                    consolePrint("\napp metadata failed\n");
-                    goto out2;
-                }
-
-                selected_idx = scroll = 0;
-                break;
-            }
-        }
-
-        if (!applet_status) break;
-
-        if (btn_down & HidNpadButton_A)
-        {
-            if (!titleGetUserApplicationData(app_metadata[selected_idx]->title_id, &user_app_data) || !user_app_data.app_info)
-            {
-                consolePrint("\nthe selected title doesn't have available base content.\n");
-                utilsSleep(3);
-                titleFreeUserApplicationData(&user_app_data);
-                continue;
-            }
-
-            break;
-        } else
-        if ((btn_down & HidNpadButton_Down) || (btn_held & (HidNpadButton_StickLDown | HidNpadButton_StickRDown)))
-        {
-            selected_idx++;
-
-            if (selected_idx >= app_count)
-            {
-                if (btn_down & HidNpadButton_Down)
-                {
-                    selected_idx = scroll = 0;
-                } else {
-                    selected_idx = (app_count - 1);
-                }
-            } else
-            if (selected_idx >= (scroll + (page_size / 2)) && app_count > (scroll + page_size))
-            {
-                scroll++;
-            }
-        } else
-        if ((btn_down & HidNpadButton_Up) || (btn_held & (HidNpadButton_StickLUp | HidNpadButton_StickRUp)))
-        {
-            selected_idx--;
-
-            if (selected_idx == UINT32_MAX)
-            {
-                if (btn_down & HidNpadButton_Up)
-                {
-                    selected_idx = (app_count - 1);
-                    scroll = (app_count >= page_size ? (app_count - page_size) : 0);
-                } else {
-                    selected_idx = 0;
-                }
-            } else
-            if (selected_idx < (scroll + (page_size / 2)) && scroll > 0)
-            {
-                scroll--;
-            }
-        } else
-        if (btn_down & HidNpadButton_B)
-        {
-            exit_prompt = false;
-            goto out2;
-        }
-
-        if (btn_held & (HidNpadButton_StickLDown | HidNpadButton_StickRDown | HidNpadButton_StickLUp | HidNpadButton_StickRUp)) svcSleepThread(50000000); // 50 ms
-    }
-
-    if (!applet_status)
-    {
-        exit_prompt = false;
-        goto out2;
+        consolePrint("%016lX doesn't have available base content\n", title_id);
+        goto end;
     }
 
-    consoleClear();
-    consolePrint("selected title:\n%s (%016lX)\n\n", app_metadata[selected_idx]->lang_entry.name, app_metadata[selected_idx]->title_id);
-
-    nca_ctx = calloc(user_app_data.app_info->content_count, sizeof(NcaContext));
+    nca_ctx = ncaAllocateContexts(user_app_data.app_info->content_count);
     if (!nca_ctx)
     {
-        consolePrint("nca ctx calloc failed\n");
-        goto out2;
+        consolePrint("nca ctx alloc failed (%016lX)\n", title_id);
+        goto end;
     }
 
-    consolePrint("nca ctx calloc succeeded\n");
-
     meta_idx = (user_app_data.app_info->content_count - 1);
 
     program_count = titleGetContentCountByType(user_app_data.app_info, NcmContentType_Program);
     if (program_count && !(program_info_ctx = calloc(program_count, sizeof(ProgramInfoContext))))
     {
-        consolePrint("program info ctx calloc failed\n");
-        goto out2;
+        consolePrint("program info ctx calloc failed (%016lX)\n", title_id);
+        goto end;
     }
 
     control_count = titleGetContentCountByType(user_app_data.app_info, NcmContentType_Control);
     if (control_count && !(nacp_ctx = calloc(control_count, sizeof(NacpContext))))
     {
-        consolePrint("nacp ctx calloc failed\n");
-        goto out2;
+        consolePrint("nacp ctx calloc failed (%016lX)\n", title_id);
+        goto end;
     }
 
     legal_info_count = titleGetContentCountByType(user_app_data.app_info, NcmContentType_LegalInformation);
     if (legal_info_count && !(legal_info_ctx = calloc(legal_info_count, sizeof(LegalInfoContext))))
     {
-        consolePrint("legal info ctx calloc failed\n");
-        goto out2;
+        consolePrint("legal info ctx calloc failed (%016lX)\n", title_id);
+        goto end;
     }
 
     for(u32 i = 0, j = 0; i < user_app_data.app_info->content_count; i++)
     {
+        if (cancel_flag && *cancel_flag) goto end;
+
         // set meta nca as the last nca
         NcmContentInfo *content_info = &(user_app_data.app_info->content_infos[i]);
         if (content_info->content_type == NcmContentType_Meta) continue;
@@ -283,12 +209,10 @@ int main(int argc, char *argv[])
         if (!ncaInitializeContext(&(nca_ctx[j]), user_app_data.app_info->storage_id, (user_app_data.app_info->storage_id == NcmStorageId_GameCard ? GameCardHashFileSystemPartitionType_Secure : 0), \
             content_info, user_app_data.app_info->version.value, &tik))
         {
-            consolePrint("%s #%u initialize nca ctx failed\n", titleGetNcmContentTypeName(content_info->content_type), content_info->id_offset);
-            goto out2;
+            consolePrint("%s #%u initialize nca ctx failed (%016lX)\n", titleGetNcmContentTypeName(content_info->content_type), content_info->id_offset, title_id);
+            goto end;
         }
 
-        consolePrint("%s #%u initialize nca ctx succeeded\n", titleGetNcmContentTypeName(content_info->content_type), content_info->id_offset);
-
         if (nca_ctx[j].fs_ctx[0].has_sparse_layer) continue;
 
         switch(content_info->content_type)
@@ -297,7 +221,7 @@ int main(int argc, char *argv[])
                 if (!programInfoInitializeContext(&(program_info_ctx[program_idx]), &(nca_ctx[j])))
                 {
                     consolePrint("initialize program info ctx failed (%s)\n", nca_ctx[j].content_id_str);
-                    goto out2;
+                    goto end;
                 }
 
                 nca_ctx[j].content_type_ctx = &(program_info_ctx[program_idx++]);
@@ -307,7 +231,7 @@ int main(int argc, char *argv[])
                 if (!nacpInitializeContext(&(nacp_ctx[control_idx]), &(nca_ctx[j])))
                 {
                     consolePrint("initialize nacp ctx failed (%s)\n", nca_ctx[j].content_id_str);
-                    goto out2;
+                    goto end;
                 }
 
                 nca_ctx[j].content_type_ctx = &(nacp_ctx[control_idx++]);
@@ -317,7 +241,7 @@ int main(int argc, char *argv[])
                 if (!legalInfoInitializeContext(&(legal_info_ctx[legal_info_idx]), &(nca_ctx[j])))
                 {
                     consolePrint("initialize legal info ctx failed (%s)\n", nca_ctx[j].content_id_str);
-                    goto out2;
+                    goto end;
                 }
 
                 nca_ctx[j].content_type_ctx = &(legal_info_ctx[legal_info_idx++]);
@@ -333,35 +257,31 @@ int main(int argc, char *argv[])
     if (!ncaInitializeContext(&(nca_ctx[meta_idx]), user_app_data.app_info->storage_id, (user_app_data.app_info->storage_id == NcmStorageId_GameCard ? GameCardHashFileSystemPartitionType_Secure : 0), \
         titleGetContentInfoByTypeAndIdOffset(user_app_data.app_info, NcmContentType_Meta, 0), user_app_data.app_info->version.value, &tik))
     {
-        consolePrint("Meta nca initialize ctx failed\n");
-        goto out2;
+        consolePrint("Meta nca initialize ctx failed (%016lX)\n", title_id);
+        goto end;
     }
 
-    consolePrint("Meta nca initialize ctx succeeded\n");
-
     if (!cnmtInitializeContext(&cnmt_ctx, &(nca_ctx[meta_idx])))
     {
-        consolePrint("cnmt initialize ctx failed\n");
-        goto out2;
+        consolePrint("cnmt initialize ctx failed (%016lX)\n", title_id);
+        goto end;
     }
 
-    consolePrint("cnmt initialize ctx succeeded\n");
-
-    sprintf(path, "sdmc:/at_xml/%016lX", app_metadata[selected_idx]->title_id);
+    sprintf(path, "sdmc:/at_xml/%016lX", title_id);
     utilsCreateDirectoryTree(path, true);
 
     if (cnmtGenerateAuthoringToolXml(&cnmt_ctx, nca_ctx, user_app_data.app_info->content_count))
     {
-        consolePrint("cnmt xml succeeded\n");
-
-        sprintf(path, "sdmc:/at_xml/%016lX/%s.cnmt.xml", app_metadata[selected_idx]->title_id, cnmt_ctx.nca_ctx->content_id_str);
+        sprintf(path, "sdmc:/at_xml/%016lX/%s.cnmt.xml", title_id, cnmt_ctx.nca_ctx->content_id_str);
         writeFile(cnmt_ctx.authoring_tool_xml, cnmt_ctx.authoring_tool_xml_size, path);
     } else {
-        consolePrint("cnmt xml failed\n");
+        consolePrint("cnmt xml failed (%016lX)\n", title_id);
     }
 
     for(u32 i = 0; i < user_app_data.app_info->content_count; i++)
     {
+        if (cancel_flag && *cancel_flag) goto end;
+
         NcaContext *cur_nca_ctx = &(nca_ctx[i]);
 
         if (!cur_nca_ctx->content_type_ctx || cur_nca_ctx->content_type == NcmContentType_Meta) continue;
@@ -374,12 +294,10 @@ int main(int argc, char *argv[])
                 if (!programInfoGenerateAuthoringToolXml(cur_program_info_ctx))
                 {
                     consolePrint("program info xml failed (%s | id offset #%u)\n", cur_nca_ctx->content_id_str, cur_nca_ctx->id_offset);
-                    goto out2;
+                    goto end;
                 }
 
-                consolePrint("program info xml succeeded (%s | id offset #%u)\n", cur_nca_ctx->content_id_str, cur_nca_ctx->id_offset);
-
-                sprintf(path, "sdmc:/at_xml/%016lX/%s.programinfo.xml", app_metadata[selected_idx]->title_id, cur_nca_ctx->content_id_str);
+                sprintf(path, "sdmc:/at_xml/%016lX/%s.programinfo.xml", title_id, cur_nca_ctx->content_id_str);
                 writeFile(cur_program_info_ctx->authoring_tool_xml, cur_program_info_ctx->authoring_tool_xml_size, path);
 
                 break;
@@ -390,21 +308,24 @@ int main(int argc, char *argv[])
                 if (!nacpGenerateAuthoringToolXml(cur_nacp_ctx, user_app_data.app_info->version.value, cnmtGetRequiredTitleVersion(&cnmt_ctx)))
                 {
                     consolePrint("nacp xml failed (%s | id offset #%u)\n", cur_nca_ctx->content_id_str, cur_nca_ctx->id_offset);
-                    goto out2;
+                    goto end;
                 }
 
-                consolePrint("nacp xml succeeded (%s | id offset #%u)\n", cur_nca_ctx->content_id_str, cur_nca_ctx->id_offset);
-
-                //sprintf(path, "sdmc:/at_xml/%016lX/%s.nacp", app_metadata[selected_idx]->title_id, cur_nca_ctx->content_id_str);
-                //writeFile(cur_nacp_ctx->data, sizeof(_NacpStruct), path);
-
-                sprintf(path, "sdmc:/at_xml/%016lX/%s.nacp.xml", app_metadata[selected_idx]->title_id, cur_nca_ctx->content_id_str);
+                sprintf(path, "sdmc:/at_xml/%016lX/%s.nacp.xml", title_id, cur_nca_ctx->content_id_str);
                 writeFile(cur_nacp_ctx->authoring_tool_xml, cur_nacp_ctx->authoring_tool_xml_size, path);
 
                 for(u8 j = 0; j < cur_nacp_ctx->icon_count; j++)
                 {
                     NacpIconContext *icon_ctx = &(cur_nacp_ctx->icon_ctx[j]);
-                    sprintf(path, "sdmc:/at_xml/%016lX/%s.nx.%s.jpg", app_metadata[selected_idx]->title_id, cur_nca_ctx->content_id_str, nacpGetLanguageString(icon_ctx->language));
+
+                    /* Make sure the icon data has been loaded (no-op if the XML generation step already did). */
+                    if (!nacpLoadIconData(cur_nacp_ctx, icon_ctx))
+                    {
+                        consolePrint("load icon data failed (%s | %s)\n", cur_nca_ctx->content_id_str, nacpGetLanguageString(icon_ctx->language));
+                        goto end;
+                    }
+
+                    sprintf(path, "sdmc:/at_xml/%016lX/%s.nx.%s.jpg", title_id, cur_nca_ctx->content_id_str, nacpGetLanguageString(icon_ctx->language));
                     writeFile(icon_ctx->icon_data, icon_ctx->icon_size, path);
                 }
 
@@ -414,10 +335,8 @@ int main(int argc, char *argv[])
             {
                 LegalInfoContext *cur_legal_info_ctx = (LegalInfoContext*)cur_nca_ctx->content_type_ctx;
 
-                sprintf(path, "sdmc:/at_xml/%016lX/%s.legalinfo.xml", app_metadata[selected_idx]->title_id, cur_nca_ctx->content_id_str);
-                writeFile(cur_legal_info_ctx->authoring_tool_xml, cur_legal_info_ctx->authoring_tool_xml_size, path);
-
-                consolePrint("legal info xml succeeded (%s | id offset #%u)\n", cur_nca_ctx->content_id_str, cur_nca_ctx->id_offset);
+                sprintf(path, "sdmc:/at_xml/%016lX/%s.legalinfo.xml", title_id, cur_nca_ctx->content_id_str);
+                writeLegalInfoFile(cur_legal_info_ctx, path);
 
                 break;
             }
@@ -426,13 +345,10 @@ int main(int argc, char *argv[])
         }
     }
 
-out2:
-    if (exit_prompt)
-    {
-        consolePrint("press any button to exit\n");
-        utilsWaitForButtonPress(0);
-    }
+    consolePrint("xml set generated for %016lX - %s\n", title_id, app_metadata_entry->lang_entry.name);
+    success = true;
 
+end:
     if (legal_info_ctx)
     {
         for(u32 i = 0; i < legal_info_count; i++) legalInfoFreeContext(&(legal_info_ctx[i]));
@@ -453,7 +369,298 @@ out2:
 
     cnmtFreeContext(&cnmt_ctx);
 
-    if (nca_ctx) free(nca_ctx);
+    if (nca_ctx) ncaFreeContexts(nca_ctx, user_app_data.app_info->content_count);
+
+    titleFreeUserApplicationData(&user_app_data);
+
+    return success;
+}
+
+static void batchWorkerThreadFunc(void *arg)
+{
+    BatchSharedData *shared_data = (BatchSharedData*)arg;
+    if (!shared_data) goto end;
+
+    while(true)
+    {
+        TitleApplicationMetadata *app_metadata_entry = NULL;
+
+        /* Claim the next unprocessed title. */
+        mutexLock(&g_batchMutex);
+        if (!shared_data->cancelled && shared_data->next_title < shared_data->app_count) app_metadata_entry = shared_data->app_metadata[shared_data->next_title++];
+        mutexUnlock(&g_batchMutex);
+
+        if (!app_metadata_entry) break;
+
+        /* Generate the XML set for the claimed title. All contexts involved are worker-local. */
+        bool title_success = generateXmlsForTitle(app_metadata_entry, &(shared_data->cancelled));
+
+        mutexLock(&g_batchMutex);
+        shared_data->processed_titles++;
+        if (!title_success) shared_data->failed_titles++;
+        mutexUnlock(&g_batchMutex);
+    }
+
+end:
+    threadExit();
+}
+
+static void batchGenerateAllXmls(TitleApplicationMetadata **app_metadata, u32 app_count)
+{
+    BatchSharedData shared_data = {0};
+    Thread worker_threads[BATCH_WORKER_COUNT] = {0};
+    u32 worker_count = 0;
+
+    shared_data.app_metadata = app_metadata;
+    shared_data.app_count = app_count;
+
+    consolePrint("generating xml sets for %u titles using up to %u workers\nhold b to cancel\n\n", app_count, BATCH_WORKER_COUNT);
+
+    /* Spread the workers across cores - each one claims whole titles off the shared queue. */
+    for(u32 i = 0; i < BATCH_WORKER_COUNT; i++)
+    {
+        if (!utilsCreateThread(&(worker_threads[i]), batchWorkerThreadFunc, &shared_data, (int)(i % 3))) break;
+        worker_count++;
+    }
+
+    if (!worker_count)
+    {
+        consolePrint("failed to create worker threads\n");
+        return;
+    }
+
+    time_t btn_cancel_start_tmr = 0, btn_cancel_end_tmr = 0;
+    bool btn_cancel_cur_state = false, btn_cancel_prev_state = false;
+
+    while(appletMainLoop())
+    {
+        mutexLock(&g_batchMutex);
+        bool done = (shared_data.processed_titles >= shared_data.app_count);
+        mutexUnlock(&g_batchMutex);
+
+        if (done) break;
+
+        utilsScanPads();
+        btn_cancel_cur_state = (utilsGetButtonsHeld() & HidNpadButton_B);
+
+        time_t now = time(NULL);
+
+        if (btn_cancel_cur_state && btn_cancel_cur_state != btn_cancel_prev_state)
+        {
+            btn_cancel_start_tmr = now;
+        } else
+        if (btn_cancel_cur_state && btn_cancel_cur_state == btn_cancel_prev_state)
+        {
+            btn_cancel_end_tmr = now;
+            if ((btn_cancel_end_tmr - btn_cancel_start_tmr) >= 3)
+            {
+                mutexLock(&g_batchMutex);
+                shared_data.cancelled = true;
+                mutexUnlock(&g_batchMutex);
+                break;
+            }
+        } else {
+            btn_cancel_start_tmr = btn_cancel_end_tmr = 0;
+        }
+
+        btn_cancel_prev_state = btn_cancel_cur_state;
+
+        svcSleepThread(50000000); // 50 ms
+    }
+
+    /* If the applet loop ended early, let the workers wind down after their current title instead of draining the rest of the queue. */
+    mutexLock(&g_batchMutex);
+    if (shared_data.processed_titles < shared_data.app_count) shared_data.cancelled = true;
+    mutexUnlock(&g_batchMutex);
+
+    for(u32 i = 0; i < worker_count; i++) utilsJoinThread(&(worker_threads[i]));
+
+    /* Push any scheduled commit down to the filesystem now that the batch is over. */
+    utilsFlushScheduledSdCardFileSystemCommits();
+
+    if (shared_data.cancelled)
+    {
+        consolePrint("\nbatch xml generation cancelled (%u / %u titles processed)\n", shared_data.processed_titles, shared_data.app_count);
+    } else {
+        consolePrint("\nbatch xml generation complete (%u titles processed, %u failed)\n", shared_data.processed_titles, shared_data.failed_titles);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+
+    if (!utilsInitializeResources(argc, (const char**)argv))
+    {
+        ret = -1;
+        goto out;
+    }
+
+    /* Configure input. */
+    /* Up to 8 different, full controller inputs. */
+    /* Individual Joy-Cons not supported. */
+    padConfigureInput(8, HidNpadStyleSet_NpadFullCtrl);
+    padInitializeWithMask(&g_padState, 0x1000000FFUL);
+
+    consoleInit(NULL);
+
+    u32 app_count = 0;
+    TitleApplicationMetadata **app_metadata = NULL;
+    TitleUserApplicationData user_app_data = {0};
+
+    u32 selected_idx = 0, page_size = 30, scroll = 0;
+    bool applet_status = true, exit_prompt = true;
+
+    /* Title data is streamed in on a background thread - wait for it to be fully loaded before building the menu. */
+    consolePrint("waiting for title info...\n");
+    while(appletMainLoop() && !titleIsStorageLoadComplete()) svcSleepThread(10000000); // 10 ms
+
+    app_metadata = titleGetApplicationMetadataEntries(false, &app_count);
+    if (!app_metadata || !app_count)
+    {
+        consolePrint("app metadata failed\n");
+        goto out2;
+    }
+
+    consolePrint("app metadata succeeded\n");
+
+    utilsSleep(1);
+
+    while((applet_status = appletMainLoop()))
+    {
+        consoleClear();
+        printf("select a user application to generate xmls for.\npress x to generate xmls for every user application.\npress b to exit.\n\n");
+        printf("title: %u / %u\n", selected_idx + 1, app_count);
+        printf("selected title: %016lX - %s\n\n", app_metadata[selected_idx]->title_id, app_metadata[selected_idx]->lang_entry.name);
+
+        for(u32 i = scroll; i < app_count; i++)
+        {
+            if (i >= (scroll + page_size)) break;
+            printf("%s%016lX - %s\n", i == selected_idx ? " -> " : "    ", app_metadata[i]->title_id, app_metadata[i]->lang_entry.name);
+        }
+
+        printf("\n");
+
+        consoleUpdate(NULL);
+
+        u64 btn_down = 0, btn_held = 0;
+        while((applet_status = appletMainLoop()))
+        {
+            utilsScanPads();
+            btn_down = utilsGetButtonsDown();
+            btn_held = utilsGetButtonsHeld();
+            if (btn_down || btn_held) break;
+
+            if (titleIsGameCardInfoUpdated())
+            {
+                free(app_metadata);
+
+                app_metadata = titleGetApplicationMetadataEntries(false, &app_count);
+                if (!app_metadata)
+                {
+                    consolePrint("\napp metadata failed\n");
+                    goto out2;
+                }
+
+                selected_idx = scroll = 0;
+                break;
+            }
+        }
+
+        if (!applet_status) break;
+
+        if (btn_down & HidNpadButton_A)
+        {
+            if (!titleGetUserApplicationData(app_metadata[selected_idx]->title_id, &user_app_data) || !user_app_data.app_info)
+            {
+                consolePrint("\nthe selected title doesn't have available base content.\n");
+                utilsSleep(3);
+                titleFreeUserApplicationData(&user_app_data);
+                continue;
+            }
+
+            /* generateXmlsForTitle() retrieves its own copy of the user application data. */
+            titleFreeUserApplicationData(&user_app_data);
+
+            break;
+        } else
+        if (btn_down & HidNpadButton_X)
+        {
+            /* Generate XML sets for every user application through the parallel scheduler. */
+            consoleClear();
+            utilsSetLongRunningProcessState(true);
+            batchGenerateAllXmls(app_metadata, app_count);
+            utilsSetLongRunningProcessState(false);
+
+            consolePrint("press any button to continue\n");
+            utilsWaitForButtonPress(0);
+        } else
+        if ((btn_down & HidNpadButton_Down) || (btn_held & (HidNpadButton_StickLDown | HidNpadButton_StickRDown)))
+        {
+            selected_idx++;
+
+            if (selected_idx >= app_count)
+            {
+                if (btn_down & HidNpadButton_Down)
+                {
+                    selected_idx = scroll = 0;
+                } else {
+                    selected_idx = (app_count - 1);
+                }
+            } else
+            if (selected_idx >= (scroll + (page_size / 2)) && app_count > (scroll + page_size))
+            {
+                scroll++;
+            }
+        } else
+        if ((btn_down & HidNpadButton_Up) || (btn_held & (HidNpadButton_StickLUp | HidNpadButton_StickRUp)))
+        {
+            selected_idx--;
+
+            if (selected_idx == UINT32_MAX)
+            {
+                if (btn_down & HidNpadButton_Up)
+                {
+                    selected_idx = (app_count - 1);
+                    scroll = (app_count >= page_size ? (app_count - page_size) : 0);
+                } else {
+                    selected_idx = 0;
+                }
+            } else
+            if (selected_idx < (scroll + (page_size / 2)) && scroll > 0)
+            {
+                scroll--;
+            }
+        } else
+        if (btn_down & HidNpadButton_B)
+        {
+            exit_prompt = false;
+            goto out2;
+        }
+
+        if (btn_held & (HidNpadButton_StickLDown | HidNpadButton_StickRDown | HidNpadButton_StickLUp | HidNpadButton_StickRUp)) svcSleepThread(50000000); // 50 ms
+    }
+
+    if (!applet_status)
+    {
+        exit_prompt = false;
+        goto out2;
+    }
+
+    consoleClear();
+    consolePrint("selected title:\n%s (%016lX)\n\n", app_metadata[selected_idx]->lang_entry.name, app_metadata[selected_idx]->title_id);
+
+    utilsSetLongRunningProcessState(true);
+    generateXmlsForTitle(app_metadata[selected_idx], NULL);
+    utilsFlushScheduledSdCardFileSystemCommits();
+    utilsSetLongRunningProcessState(false);
+
+out2:
+    if (exit_prompt)
+    {
+        consolePrint("press any button to exit\n");
+        utilsWaitForButtonPress(0);
+    }
 
     titleFreeUserApplicationData(&user_app_data);
 
@@ -0,0 +1,212 @@
+/*
+ * nxdt_bench.c
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Host benchmark driver for the portable core modules. Lets SHA3 and LZ4 changes be profiled on a */
+/* development machine without deploying to hardware. An optional fixture file (e.g. a dumped NCA  */
+/* section) may be provided on the command line - synthetic data is used otherwise.                */
+
+#include "nxdt_utils.h"
+#include "sha3.h"
+#include "lz4.h"
+
+#include <time.h>
+
+#define BENCH_BUFFER_SIZE   (64 * 1024 * 1024)  /* 64 MiB. */
+#define BENCH_MIN_SECONDS   1.0                 /* Minimum wall-clock time spent on each benchmark. */
+
+typedef void (*BenchSha3HashFunc)(void *dst, const void *src, size_t size);
+
+static double benchGetTime(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0));
+}
+
+static void benchFillBuffer(u8 *buf, size_t buf_size)
+{
+    /* xorshift64 keystream. Fast, deterministic and incompressible enough to keep LZ4 honest. */
+    u64 state = 0x9E3779B97F4A7C15;
+
+    for(size_t i = 0; i < buf_size; i += sizeof(u64))
+    {
+        state ^= (state << 13);
+        state ^= (state >> 7);
+        state ^= (state << 17);
+        memcpy(buf + i, &state, sizeof(u64));
+    }
+
+    /* Zero out every other 4 KiB page to give the compressor something to latch onto. */
+    for(size_t i = 0; i < buf_size; i += 0x2000) memset(buf + i, 0, 0x1000);
+}
+
+static bool benchSha3SelfTest(void)
+{
+    /* SHA3-256("abc"), from the FIPS 202 example vectors. Catches broken permutation changes before they're benchmarked. */
+    static const u8 expected[SHA3_HASH_SIZE_BYTES(256)] = {
+        0x3A, 0x98, 0x5D, 0xA7, 0x4F, 0xE2, 0x25, 0xB2, 0x04, 0x5C, 0x17, 0x2D, 0x6B, 0xD3, 0x90, 0xBD,
+        0x85, 0x5F, 0x08, 0x6E, 0x3E, 0x9D, 0x52, 0x5B, 0x46, 0xBF, 0xE2, 0x45, 0x11, 0x43, 0x15, 0x32
+    };
+
+    u8 hash[SHA3_HASH_SIZE_BYTES(256)] = {0};
+    sha3256CalculateHash(hash, "abc", 3);
+
+    if (memcmp(hash, expected, sizeof(expected)) != 0)
+    {
+        LOG_MSG_ERROR("SHA3-256 self-test failed!");
+        return false;
+    }
+
+    return true;
+}
+
+static void benchSha3(const char *name, BenchSha3HashFunc func, const u8 *buf, size_t buf_size)
+{
+    u8 hash[SHA3_HASH_SIZE_BYTES(512)] = {0};
+    u32 iterations = 0;
+
+    /* Warm up caches and branch predictors. */
+    func(hash, buf, buf_size);
+
+    double start = benchGetTime(), elapsed = 0.0;
+
+    do {
+        func(hash, buf, buf_size);
+        iterations++;
+        elapsed = (benchGetTime() - start);
+    } while(elapsed < BENCH_MIN_SECONDS);
+
+    printf("%-12s %8.2f MiB/s (%u iterations)\n", name, ((double)buf_size * (double)iterations) / (elapsed * 1048576.0), iterations);
+}
+
+static void benchLz4(const u8 *buf, size_t buf_size)
+{
+    /* LZ4 block sizes are bounded by LZ4_MAX_INPUT_SIZE, so only benchmark a chunk of the work buffer. */
+    int src_size = (int)(buf_size > 0x400000 ? 0x400000 : buf_size);
+    int bound = LZ4_compressBound(src_size);
+
+    char *comp_buf = malloc(bound);
+    char *dec_buf = malloc(src_size);
+
+    if (!comp_buf || !dec_buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate LZ4 benchmark buffers!");
+        goto end;
+    }
+
+    /* Compression pass. */
+    u32 iterations = 0;
+    int comp_size = 0;
+    double start = benchGetTime(), elapsed = 0.0;
+
+    do {
+        comp_size = LZ4_compress_default((const char*)buf, comp_buf, src_size, bound);
+        iterations++;
+        elapsed = (benchGetTime() - start);
+    } while(comp_size > 0 && elapsed < BENCH_MIN_SECONDS);
+
+    if (comp_size <= 0)
+    {
+        LOG_MSG_ERROR("LZ4_compress_default() failed!");
+        goto end;
+    }
+
+    printf("%-12s %8.2f MiB/s (%u iterations, ratio %.2f)\n", "lz4-comp", ((double)src_size * (double)iterations) / (elapsed * 1048576.0), iterations, \
+           (double)src_size / (double)comp_size);
+
+    /* Decompression pass. */
+    iterations = 0;
+    int dec_size = 0;
+    start = benchGetTime();
+
+    do {
+        dec_size = LZ4_decompress_safe(comp_buf, dec_buf, comp_size, src_size);
+        iterations++;
+        elapsed = (benchGetTime() - start);
+    } while(dec_size > 0 && elapsed < BENCH_MIN_SECONDS);
+
+    if (dec_size != src_size || memcmp(buf, dec_buf, src_size) != 0)
+    {
+        LOG_MSG_ERROR("LZ4 roundtrip mismatch! (%d bytes out of %d).", dec_size, src_size);
+        goto end;
+    }
+
+    printf("%-12s %8.2f MiB/s (%u iterations)\n", "lz4-dec", ((double)src_size * (double)iterations) / (elapsed * 1048576.0), iterations);
+
+end:
+    if (dec_buf) free(dec_buf);
+    if (comp_buf) free(comp_buf);
+}
+
+int main(int argc, char **argv)
+{
+    int ret = EXIT_FAILURE;
+    size_t buf_size = BENCH_BUFFER_SIZE;
+
+    u8 *buf = malloc(buf_size);
+    if (!buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate work buffer!");
+        return ret;
+    }
+
+    if (argc > 1)
+    {
+        /* Load fixture data. The work buffer is filled with as much of the fixture as it can hold. */
+        FILE *fd = fopen(argv[1], "rb");
+        if (!fd)
+        {
+            LOG_MSG_ERROR("Failed to open fixture file \"%s\"!", argv[1]);
+            goto end;
+        }
+
+        size_t fixture_size = fread(buf, 1, buf_size, fd);
+        fclose(fd);
+
+        if (!fixture_size)
+        {
+            LOG_MSG_ERROR("Failed to read fixture file \"%s\"!", argv[1]);
+            goto end;
+        }
+
+        buf_size = fixture_size;
+        printf("Using %zu bytes of fixture data from \"%s\".\n\n", buf_size, argv[1]);
+    } else {
+        benchFillBuffer(buf, buf_size);
+        printf("Using %zu bytes of synthetic data.\n\n", buf_size);
+    }
+
+    if (!benchSha3SelfTest()) goto end;
+
+    benchSha3("sha3-224", &sha3224CalculateHash, buf, buf_size);
+    benchSha3("sha3-256", &sha3256CalculateHash, buf, buf_size);
+    benchSha3("sha3-384", &sha3384CalculateHash, buf, buf_size);
+    benchSha3("sha3-512", &sha3512CalculateHash, buf, buf_size);
+
+    benchLz4(buf, buf_size);
+
+    ret = EXIT_SUCCESS;
+
+end:
+    free(buf);
+
+    return ret;
+}
@@ -0,0 +1,52 @@
+/*
+ * nxdt_utils.h
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __NXDT_UTILS_H__
+#define __NXDT_UTILS_H__
+
+/* Minimal nxdt_utils.h stand-in for host benchmark builds. Provides the type definitions and logging */
+/* macros required by the portable core modules. Warnings and errors are printed to stderr. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <switch.h>
+
+#ifndef MAX
+#define MAX(x, y)                   ((x) > (y) ? (x) : (y))
+#endif
+
+#ifndef MIN
+#define MIN(x, y)                   ((x) < (y) ? (x) : (y))
+#endif
+
+#define LOG_MSG_GENERIC(fmt, ...)   fprintf(stderr, "%s: " fmt "\n", __func__, ##__VA_ARGS__)
+
+#define LOG_MSG_DEBUG(fmt, ...)     do {} while(0)
+#define LOG_MSG_INFO(fmt, ...)      do {} while(0)
+#define LOG_MSG_WARNING(fmt, ...)   LOG_MSG_GENERIC(fmt, ##__VA_ARGS__)
+#define LOG_MSG_ERROR(fmt, ...)     LOG_MSG_GENERIC(fmt, ##__VA_ARGS__)
+
+#endif /* __NXDT_UTILS_H__ */
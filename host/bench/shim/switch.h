@@ -0,0 +1,50 @@
+/*
+ * switch.h
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __SWITCH_H__
+#define __SWITCH_H__
+
+/* Minimal libnx stand-in for host benchmark builds. Only provides the integer types and helper macros */
+/* used by the portable core modules - it is not a general purpose libnx replacement. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#define NX_INLINE       __attribute__((always_inline)) static inline
+#define NX_CONSTEXPR    NX_INLINE __attribute__((const))
+
+#define BIT(n)          (1U << (n))
+#define BITL(n)         (1UL << (n))
+
+#endif /* __SWITCH_H__ */
@@ -42,6 +42,7 @@ import queue
 import shutil
 import time
 import struct
+import hashlib
 import usb.core
 import usb.util
 import warnings
@@ -81,8 +82,16 @@ USB_DEV_PRODUCT = 'nxdumptool'
 # USB timeout (milliseconds).
 USB_TRANSFER_TIMEOUT = 5000
 
-# USB transfer block size.
+# USB transfer block size (default / maximum negotiable values).
 USB_TRANSFER_BLOCK_SIZE = 0x800000
+USB_TRANSFER_MAX_BLOCK_SIZE = 0x4000000
+
+# Preferred USB transfer block size. Used during session-start negotiation whenever the client advertises support for sizes beyond the default.
+# Bigger chunks amortize per-transfer overhead on USB 3.0 hosts with fast storage.
+USB_TRANSFER_PREFERRED_BLOCK_SIZE_LOG2 = 25 # 32 MiB.
+
+# Number of preallocated transfer buffers shared between the USB reader and the file writer thread.
+USB_TRANSFER_BUFFER_COUNT = 4
 
 # USB transfer threshold. Used to determine whether a progress bar should be displayed or not.
 USB_TRANSFER_THRESHOLD = (USB_TRANSFER_BLOCK_SIZE * 4)
@@ -97,15 +106,21 @@ USB_ABI_VERSION = 1
 USB_CMD_HEADER_SIZE = 0x10
 
 # USB command IDs.
-USB_CMD_START_SESSION        = 0
-USB_CMD_SEND_FILE_PROPERTIES = 1
-USB_CMD_CANCEL_FILE_TRANSFER = 2
-USB_CMD_SEND_NSP_HEADER      = 3
-USB_CMD_END_SESSION          = 4
+USB_CMD_START_SESSION              = 0
+USB_CMD_SEND_FILE_PROPERTIES       = 1
+USB_CMD_CANCEL_FILE_TRANSFER       = 2
+USB_CMD_SEND_NSP_HEADER            = 3
+USB_CMD_END_SESSION                = 4
+USB_CMD_SEND_FILE_PROPERTIES_BATCH = 5
+USB_CMD_SEND_DIRECTORY_TABLE       = 6
+USB_CMD_USE_CACHED_CONTENT         = 7
 
 # USB command block sizes.
-USB_CMD_BLOCK_SIZE_START_SESSION        = 0x10
-USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES = 0x320
+USB_CMD_BLOCK_SIZE_START_SESSION                     = 0x10
+USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES              = 0x320
+USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES_BATCH_HEADER = 0x10
+USB_CMD_BLOCK_SIZE_SEND_DIRECTORY_TABLE_HEADER       = 0x10
+USB_CMD_BLOCK_SIZE_SEND_DIRECTORY_TABLE_ENTRY        = 0x310
 
 # Max filename length (file properties).
 USB_FILE_PROPERTIES_MAX_NAME_LENGTH = 0x300
@@ -117,6 +132,14 @@ USB_STATUS_UNSUPPORTED_CMD         = 5
 USB_STATUS_UNSUPPORTED_ABI_VERSION = 6
 USB_STATUS_MALFORMED_CMD           = 7
 USB_STATUS_HOST_IO_ERROR           = 8
+USB_STATUS_NOT_CACHED              = 9 # Not an error. Returned for UseCachedContent commands whenever the referenced file isn't available in the content cache.
+
+# Output directories pre-created from a transmitted directory table. Per-file directory creation is skipped for these paths.
+g_precreatedDirs = set()
+
+# Content cache index used to handle UseCachedContent commands. Maps (entry name, entry size) tuples to (NSP path, entry offset) tuples.
+# Built lazily on first use by scanning every NSP file under the output directory, then kept up to date as new NSP transfers finish.
+g_contentCacheIndex = None
 
 # Script title.
 SCRIPT_TITLE = "{} host script v{}".format(USB_DEV_PRODUCT, APP_VERSION)
@@ -358,6 +381,12 @@ class ProgressBarWindow:
         self.elapsed_time = 0
         self.hwnd = 0
 
+        # Transfer threads only publish counter values under this lock - all tkinter calls are performed by the GUI poll timer.
+        self.lock = threading.Lock()
+        self.active = False
+        self.pending_start = False
+        self.pending_end = False
+
         self.tk_parent = tk_parent
         self.tk_window = (tk.Toplevel(self.tk_parent) if self.tk_parent else None)
         self.withdrawn = False
@@ -387,35 +416,97 @@ class ProgressBarWindow:
             self.tk_pbar.configure(maximum=100, mode='indeterminate')
             self.tk_pbar.pack()
 
+            # Start polling progress updates. Repaints happen at ~10 Hz from the latest published counters, so GUI work never stalls the transfer path.
+            self.tk_window.after(100, self.poll_progress)
+
     def __del__(self):
         if self.tk_parent: self.tk_parent.after(0, self.tk_window.destroy)
 
     def start(self, total, n=0, divider=1, prefix='', unit='B'):
         if (total <= 0) or (n < 0) or (divider < 1): raise Exception('Invalid arguments!')
 
-        self.n = n
-        self.total = total
-        self.divider = float(divider)
-        self.total_div = (float(self.total) / self.divider)
-        self.prefix = prefix
-        self.unit = unit
-
-        if self.tk_pbar:
-            self.tk_pbar.configure(maximum=self.total_div, mode='determinate')
+        with self.lock:
+            self.n = n
+            self.total = total
+            self.divider = float(divider)
+            self.total_div = (float(self.total) / self.divider)
+            self.prefix = prefix
+            self.unit = unit
             self.start_time = time.time()
-        else:
+
+            if self.tk_pbar:
+                self.active = True
+                self.pending_start = True
+
+        if not self.tk_pbar:
             n_div = (float(self.n) / self.divider)
             self.pbar = tqdm(initial=n_div, total=self.total_div, unit=self.unit, dynamic_ncols=True, desc=self.prefix, bar_format=self.bar_format)
 
     def update(self, n):
-        cur_n = (self.n + n)
-        if cur_n > self.total: return
-
         if self.tk_window:
-            cur_n_div = (float(cur_n) / self.divider)
-            self.elapsed_time = (time.time() - self.start_time)
+            # Just publish the new counter value. The GUI poll timer picks it up on its next repaint.
+            with self.lock:
+                cur_n = (self.n + n)
+                if cur_n > self.total: return
+                self.n = cur_n
+        else:
+            cur_n = (self.n + n)
+            if cur_n > self.total: return
 
-            msg = tqdm.format_meter(n=cur_n_div, total=self.total_div, elapsed=self.elapsed_time, prefix=self.prefix, unit=self.unit, bar_format=self.bar_format)
+            n_div = (float(n) / self.divider)
+            self.pbar.update(n_div)
+
+            self.n = cur_n
+
+    def end(self):
+        with self.lock:
+            self.n = 0
+            self.total = 0
+            self.divider = 1
+            self.total_div = 0
+            self.prefix = ''
+            self.unit = 'B'
+            self.start_time = 0
+            self.elapsed_time = 0
+
+            if self.tk_window:
+                self.active = False
+                self.pending_end = True
+
+        if not self.tk_window:
+            self.pbar.close()
+            self.pbar = None
+            print()
+
+    def set_prefix(self, prefix):
+        with self.lock:
+            self.prefix = prefix
+
+    def poll_progress(self):
+        # Repaint the progress window using the latest counter values published by the transfer thread.
+        with self.lock:
+            active = self.active
+            pending_start = self.pending_start
+            pending_end = self.pending_end
+            cur_n = self.n
+            total = self.total
+            divider = self.divider
+            total_div = self.total_div
+            prefix = self.prefix
+            unit = self.unit
+            start_time = self.start_time
+
+            self.pending_start = False
+            self.pending_end = False
+
+        if active:
+            # Reconfigure the progress bar widget if a new transfer was started since the last repaint.
+            if pending_start: self.tk_pbar.configure(maximum=total_div, mode='determinate')
+
+            cur_n_div = (float(cur_n) / divider)
+            self.elapsed_time = (time.time() - start_time)
+
+            msg = tqdm.format_meter(n=cur_n_div, total=total_div, elapsed=self.elapsed_time, prefix=prefix, unit=unit, bar_format=self.bar_format)
 
             self.tk_text_var.set(msg)
             self.tk_n_var.set(cur_n_div)
@@ -432,24 +523,8 @@ class ProgressBarWindow:
 
                 self.withdrawn = False
 
-            if g_taskbar: g_taskbar.SetProgressValue(self.hwnd, cur_n, self.total)
-        else:
-            n_div = (float(n) / self.divider)
-            self.pbar.update(n_div)
-
-        self.n = cur_n
-
-    def end(self):
-        self.n = 0
-        self.total = 0
-        self.divider = 1
-        self.total_div = 0
-        self.prefix = ''
-        self.unit = 'B'
-        self.start_time = 0
-        self.elapsed_time = 0
-
-        if self.tk_window:
+            if g_taskbar: g_taskbar.SetProgressValue(self.hwnd, cur_n, total)
+        elif pending_end:
             if g_taskbar:
                 g_taskbar.SetProgressState(self.hwnd, g_tlb.TBPF_NOPROGRESS)
                 g_taskbar.UnregisterTab(self.hwnd)
@@ -460,13 +535,8 @@ class ProgressBarWindow:
             self.withdrawn = True
 
             self.tk_pbar.configure(maximum=100, mode='indeterminate')
-        else:
-            self.pbar.close()
-            self.pbar = None
-            print()
 
-    def set_prefix(self, prefix):
-        self.prefix = prefix
+        if self.tk_window: self.tk_window.after(100, self.poll_progress)
 
 def utilsGetPath(path_arg, fallback_path, is_file, create=False):
     path = os.path.abspath(os.path.expanduser(os.path.expandvars(path_arg if path_arg else fallback_path)))
@@ -492,6 +562,64 @@ def utilsResetNspInfo():
     g_nspFile = None
     g_nspFilePath = None
 
+def utilsPreallocateFile(file, size):
+    # Preallocates the full file extent upfront, avoiding incremental extent allocation in the write path.
+    # Preallocation support depends on the OS and the output filesystem, so failures here are never treated as fatal.
+    if not size: return
+
+    try:
+        if hasattr(os, 'posix_fallocate'):
+            os.posix_fallocate(file.fileno(), 0, size)
+        else:
+            # Windows doesn't expose fallocate(). Extending the file upfront makes NTFS allocate the clusters in a single pass instead.
+            file.truncate(size)
+    except OSError:
+        g_logger.debug('Failed to preallocate 0x%X bytes for the output file. Continuing anyway.' % (size))
+
+def utilsAddNspToContentCacheIndex(nsp_path):
+    # Parses the Partition FS header from the provided NSP file and indexes every file entry it holds by name and size.
+    # Unreadable and malformed files are silently skipped - they just won't contribute any cached entries.
+    try:
+        with open(nsp_path, 'rb') as nsp:
+            pfs_header = nsp.read(0x10)
+            if len(pfs_header) != 0x10: return
+
+            (magic, entry_count, string_table_size, _) = struct.unpack_from('<4sIII', pfs_header, 0)
+            if (magic != b'PFS0') or (not entry_count) or (not string_table_size): return
+
+            entry_table = nsp.read(entry_count * 0x18)
+            string_table = nsp.read(string_table_size)
+            if (len(entry_table) != (entry_count * 0x18)) or (len(string_table) != string_table_size): return
+
+            data_offset = (0x10 + len(entry_table) + string_table_size)
+
+            for i in range(entry_count):
+                (entry_offset, entry_size, name_offset, _) = struct.unpack_from('<QQII', entry_table, (i * 0x18))
+                if (not entry_size) or (name_offset >= string_table_size): continue
+
+                name_end = string_table.find(b'\x00', name_offset)
+                if name_end < 0: name_end = string_table_size
+
+                entry_name = string_table[name_offset:name_end].decode('utf-8', errors='ignore')
+                if not entry_name: continue
+
+                # Keep the first copy found for each (name, size) tuple.
+                g_contentCacheIndex.setdefault((entry_name, entry_size), (nsp_path, data_offset + entry_offset))
+    except OSError:
+        return
+
+def utilsBuildContentCacheIndex():
+    global g_contentCacheIndex
+
+    g_contentCacheIndex = {}
+
+    # Index the entries from every NSP file under the output directory, making them available for cached content splicing.
+    for (rootdir, _, files) in os.walk(g_outputDir):
+        for name in files:
+            if name.lower().endswith('.nsp'): utilsAddNspToContentCacheIndex(os.path.join(rootdir, name))
+
+    g_logger.debug('Content cache index built: %u entries from NSP files under "%s".' % (len(g_contentCacheIndex), g_outputDir))
+
 def utilsGetSizeUnitAndDivisor(size):
     size_suffixes = [ 'B', 'KiB', 'MiB', 'GiB' ]
     size_suffixes_count = len(size_suffixes)
@@ -570,6 +698,62 @@ def usbGetDeviceEndpoints():
 
     return True
 
+class FileWriter(threading.Thread):
+    # Dedicated writer thread. Keeps disk writes off the USB read path by pushing filled buffers through a bounded
+    # queue, recycling them through a pool of preallocated bytearrays so the transfer loop never allocates per chunk.
+    def __init__(self, file, buffer_count=USB_TRANSFER_BUFFER_COUNT, checksum=False):
+        super().__init__(name='FileWriter', daemon=True)
+        self.file = file
+        self.queue = queue.Queue(buffer_count)
+        self.pool = queue.Queue(buffer_count)
+        self.error = False
+
+        # Hash submitted chunks as they're written, saving a full disk-read pass for post-dump verification.
+        self.sha256 = (hashlib.sha256() if checksum else None)
+
+        # The extra byte makes room for the sentinel used on Zero-Length Termination reads.
+        for _ in range(buffer_count): self.pool.put(bytearray(g_usbTransferBlockSize + 1))
+
+        self.start()
+
+    def run(self):
+        while True:
+            item = self.queue.get()
+            if item is None: break
+
+            (buf, size) = item
+
+            try:
+                if not self.error:
+                    view = memoryview(buf)[:size]
+                    self.file.write(view)
+                    if self.sha256 is not None: self.sha256.update(view)
+            except OSError:
+                if not g_cliMode: traceback.print_exc()
+                self.error = True
+
+            self.pool.put(buf)
+
+    def get_buffer(self):
+        # Blocks until a recycled buffer becomes available, bounding reader memory usage.
+        return self.pool.get()
+
+    def submit(self, buf, size):
+        self.queue.put((buf, size))
+
+    def discard(self, buf):
+        self.pool.put(buf)
+
+    def finish(self):
+        # Flush pending writes and stop the thread. Returns False if any write failed.
+        self.queue.put(None)
+        self.join()
+        return not self.error
+
+    def checksum(self):
+        # Returns the hex digest for all written data, or None if checksum calculation was disabled.
+        return (self.sha256.hexdigest() if (self.sha256 is not None) else None)
+
 def usbRead(size, timeout=-1):
     rd = None
 
@@ -582,6 +766,18 @@ def usbRead(size, timeout=-1):
 
     return rd
 
+def usbReadIntoBuffer(buf, size, timeout=-1):
+    # Same as usbRead(), but reads into a caller-provided preallocated buffer. Returns the transferred size (None on failure).
+    rd = None
+
+    try:
+        rd = g_usbEpIn.read(memoryview(buf)[:size], timeout)
+    except usb.core.USBError:
+        if not g_cliMode: traceback.print_exc()
+        g_logger.error('\nUSB timeout triggered or console disconnected.')
+
+    return rd
+
 def usbWrite(data, timeout=-1):
     wr = 0
 
@@ -594,17 +790,23 @@ def usbWrite(data, timeout=-1):
     return wr
 
 def usbSendStatus(code):
-    status = struct.pack('<4sIH6p', USB_MAGIC_WORD, code, g_usbEpMaxPacketSize, b'')
+    status = struct.pack('<4sIHB5p', USB_MAGIC_WORD, code, g_usbEpMaxPacketSize, g_usbTransferBlockSizeLog2, b'')
     return usbWrite(status, USB_TRANSFER_TIMEOUT) == len(status)
 
 def usbHandleStartSession(cmd_block):
-    global g_nxdtVersionMajor, g_nxdtVersionMinor, g_nxdtVersionMicro, g_nxdtAbiVersion, g_nxdtGitCommit
+    global g_nxdtVersionMajor, g_nxdtVersionMinor, g_nxdtVersionMicro, g_nxdtAbiVersion, g_nxdtGitCommit, g_usbTransferBlockSize, g_usbTransferBlockSizeLog2, g_contentCacheIndex
 
     if g_cliMode: print()
     g_logger.debug('Received StartSession (%02X) command.' % (USB_CMD_START_SESSION))
 
+    # Forget about any directories pre-created during a previous session.
+    g_precreatedDirs.clear()
+
+    # Invalidate the content cache index. It'll be rebuilt whenever the first UseCachedContent command from this session arrives.
+    g_contentCacheIndex = None
+
     # Parse command block.
-    (g_nxdtVersionMajor, g_nxdtVersionMinor, g_nxdtVersionMicro, g_nxdtAbiVersion, g_nxdtGitCommit) = struct.unpack_from('<BBBB8s', cmd_block, 0)
+    (g_nxdtVersionMajor, g_nxdtVersionMinor, g_nxdtVersionMicro, g_nxdtAbiVersion, g_nxdtGitCommit, max_transfer_size_log2) = struct.unpack_from('<BBBB8sB', cmd_block, 0)
     g_nxdtGitCommit = g_nxdtGitCommit.decode('utf-8').strip('\x00')
 
     # Print client info.
@@ -615,6 +817,15 @@ def usbHandleStartSession(cmd_block):
         g_logger.error('Unsupported ABI version!')
         return USB_STATUS_UNSUPPORTED_ABI_VERSION
 
+    # Negotiate the transfer block size. Clients that don't advertise a maximum size keep using the default.
+    g_usbTransferBlockSize = USB_TRANSFER_BLOCK_SIZE
+    g_usbTransferBlockSizeLog2 = 0
+
+    if max_transfer_size_log2 and ((1 << max_transfer_size_log2) <= USB_TRANSFER_MAX_BLOCK_SIZE):
+        g_usbTransferBlockSizeLog2 = min(max_transfer_size_log2, USB_TRANSFER_PREFERRED_BLOCK_SIZE_LOG2)
+        g_usbTransferBlockSize = (1 << g_usbTransferBlockSizeLog2)
+        g_logger.debug('Negotiated transfer block size: 0x%X bytes (client maximum: 0x%X bytes).' % (g_usbTransferBlockSize, 1 << max_transfer_size_log2))
+
     # Return status code
     return USB_STATUS_SUCCESS
 
@@ -668,8 +879,8 @@ def usbHandleSendFileProperties(cmd_block):
         # Get parent directory path.
         dirpath = os.path.dirname(fullpath)
 
-        # Create full directory tree.
-        os.makedirs(dirpath, exist_ok=True)
+        # Create full directory tree, unless it was already pre-created from a transmitted directory table.
+        if dirpath not in g_precreatedDirs: os.makedirs(dirpath, exist_ok=True)
 
         # Make sure the output filepath doesn't point to an existing directory.
         if os.path.exists(fullpath) and (not os.path.isfile(fullpath)):
@@ -687,6 +898,9 @@ def usbHandleSendFileProperties(cmd_block):
         # Get file object.
         file = open(fullpath, "wb")
 
+        # Preallocate the announced file size. In NSP transfer mode, the first SendFileProperties command announces the full NSP size.
+        utilsPreallocateFile(file, file_size)
+
         if g_nspTransferMode:
             # Update NSP file object.
             g_nspFile = file
@@ -717,7 +931,7 @@ def usbHandleSendFileProperties(cmd_block):
     g_logger.debug('Data transfer started. Saving %s to: "%s".' % (file_type_str, fullpath))
 
     offset = 0
-    blksize = USB_TRANSFER_BLOCK_SIZE
+    blksize = g_usbTransferBlockSize
 
     # Check if we should use the progress bar window.
     use_pbar = (((not g_nspTransferMode) and (file_size > USB_TRANSFER_THRESHOLD)) or (g_nspTransferMode and (g_nspSize > USB_TRANSFER_THRESHOLD)))
@@ -751,8 +965,13 @@ def usbHandleSendFileProperties(cmd_block):
             # Set current prefix (holds the filename for the current NSP file entry).
             g_progressBarWindow.set_prefix(prefix)
 
+    # Create dedicated writer thread so USB reads and disk writes overlap.
+    # Checksum calculation is skipped in NSP transfer mode because the NSP header area gets rewritten after all file entries have been transferred.
+    writer = FileWriter(file, checksum=(not g_nspTransferMode))
+
     def cancelTransfer():
         # Cancel file transfer.
+        writer.finish()
         file.close()
         os.remove(fullpath)
         utilsResetNspInfo()
@@ -770,24 +989,26 @@ def usbHandleSendFileProperties(cmd_block):
         rd_size = blksize
         if ((offset + blksize) >= file_size) and utilsIsValueAlignedToEndpointPacketSize(blksize): rd_size += 1
 
-        # Read current chunk.
-        chunk = usbRead(rd_size, USB_TRANSFER_TIMEOUT)
-        if chunk is None:
+        # Grab a recycled buffer and read the current chunk into it.
+        buf = writer.get_buffer()
+
+        chunk_size = usbReadIntoBuffer(buf, rd_size, USB_TRANSFER_TIMEOUT)
+        if chunk_size is None:
             g_logger.error('Failed to read 0x%X-byte long data chunk!' % (rd_size))
 
             # Cancel file transfer.
+            writer.discard(buf)
             cancelTransfer()
 
             # Returning None will make the command handler exit right away.
             return None
 
-        chunk_size = len(chunk)
-
         # Check if we're dealing with a CancelFileTransfer command.
         if chunk_size == USB_CMD_HEADER_SIZE:
-            (magic, cmd_id, cmd_block_size) = struct.unpack_from('<4sII', chunk, 0)
+            (magic, cmd_id, cmd_block_size) = struct.unpack_from('<4sII', buf, 0)
             if (magic == USB_MAGIC_WORD) and (cmd_id == USB_CMD_CANCEL_FILE_TRANSFER):
                 # Cancel file transfer.
+                writer.discard(buf)
                 cancelTransfer()
 
                 g_logger.debug('Received CancelFileTransfer (%02X) command.' % (USB_CMD_CANCEL_FILE_TRANSFER))
@@ -796,9 +1017,8 @@ def usbHandleSendFileProperties(cmd_block):
                 # Let the command handler take care of sending the status response for us.
                 return USB_STATUS_SUCCESS
 
-        # Write current chunk.
-        file.write(chunk)
-        file.flush()
+        # Hand the current chunk over to the writer thread.
+        writer.submit(buf, chunk_size)
 
         # Update current offset.
         offset = (offset + chunk_size)
@@ -809,9 +1029,22 @@ def usbHandleSendFileProperties(cmd_block):
         # Update progress bar window (if needed).
         if use_pbar: g_progressBarWindow.update(chunk_size)
 
+    # Wait until all pending writes hit the disk.
+    if not writer.finish():
+        g_logger.error('Failed to write data to "%s"!' % (fullpath))
+        file.close()
+        os.remove(fullpath)
+        utilsResetNspInfo()
+        if use_pbar: g_progressBarWindow.end()
+        return USB_STATUS_HOST_IO_ERROR
+
     elapsed_time = round(time.time() - start_time)
     g_logger.debug('File transfer successfully completed in %s!\n' % (tqdm.format_interval(elapsed_time)))
 
+    # Report the checksum calculated on the fly by the writer thread, so the received file can be verified without re-reading it from disk.
+    checksum = writer.checksum()
+    if checksum is not None: g_logger.info('SHA-256 checksum for "%s": %s.' % (filename, checksum))
+
     # Close file handle (if needed).
     if not g_nspTransferMode: file.close()
 
@@ -820,6 +1053,257 @@ def usbHandleSendFileProperties(cmd_block):
 
     return USB_STATUS_SUCCESS
 
+def usbHandleSendFilePropertiesBatch(cmd_block):
+    g_logger.debug('Received SendFilePropertiesBatch (%02X) command.' % (USB_CMD_SEND_FILE_PROPERTIES_BATCH))
+
+    if g_nspTransferMode:
+        g_logger.error('Received SendFilePropertiesBatch command during NSP transfer mode!\n')
+        return USB_STATUS_MALFORMED_CMD
+
+    # Parse batch header.
+    (entry_count,) = struct.unpack_from('<I', cmd_block, 0)
+    if (not entry_count) or (len(cmd_block) != (USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES_BATCH_HEADER + (entry_count * USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES))):
+        g_logger.error('Invalid batch entry count! (%u).\n' % (entry_count))
+        return USB_STATUS_MALFORMED_CMD
+
+    # Parse and validate every file entry upfront, so malformed batches are rejected before any data is transferred.
+    entries = []
+    total_size = 0
+
+    for i in range(entry_count):
+        entry_offset = (USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES_BATCH_HEADER + (i * USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES))
+        (file_size, filename_length, nsp_header_size, raw_filename) = struct.unpack_from('<QII%ds' % (USB_FILE_PROPERTIES_MAX_NAME_LENGTH), cmd_block, entry_offset)
+        filename = raw_filename.decode('utf-8').strip('\x00')
+
+        if nsp_header_size or (not filename_length) or (filename_length > USB_FILE_PROPERTIES_MAX_NAME_LENGTH):
+            g_logger.error('Invalid properties for batch entry %u!\n' % (i))
+            return USB_STATUS_MALFORMED_CMD
+
+        entries.append((file_size, filename))
+        total_size += file_size
+
+    g_logger.info('Receiving %u files in batch mode (0x%X bytes).' % (entry_count, total_size))
+
+    # Make sure we have enough free space for the whole batch.
+    (total_space, used_space, free_space) = shutil.disk_usage(g_outputDir)
+    if free_space <= total_size:
+        g_logger.error('Not enough free space available in output volume!\n')
+        return USB_STATUS_HOST_IO_ERROR
+
+    # Send status response before entering the data transfer stage.
+    # This is the only acknowledgement sent until all batched file data has been received - per-file status responses are skipped on purpose.
+    usbSendStatus(USB_STATUS_SUCCESS)
+
+    # Check if we should use the progress bar window. A single bar tracks the whole batch.
+    use_pbar = (total_size > USB_TRANSFER_THRESHOLD)
+    if use_pbar:
+        if g_cliMode:
+            prefix = ''
+        else:
+            prefix = ('Receiving %u files in batch mode.\n' % (entry_count))
+            prefix += 'Use your console to cancel the file transfer if you wish to do so.'
+
+        (unit, unit_divider) = utilsGetSizeUnitAndDivisor(total_size)
+        g_progressBarWindow.start(total_size, 0, unit_divider, prefix, unit)
+
+    status = USB_STATUS_SUCCESS
+
+    for (file_size, filename) in entries:
+        # Generate full, absolute path to the destination file and create its directory tree, unless it was already pre-created from a transmitted directory table.
+        fullpath = os.path.abspath(g_outputDir + os.path.sep + filename)
+        dirpath = os.path.dirname(fullpath)
+        if dirpath not in g_precreatedDirs: os.makedirs(dirpath, exist_ok=True)
+
+        # Make sure the output filepath doesn't point to an existing directory.
+        if os.path.exists(fullpath) and (not os.path.isfile(fullpath)):
+            g_logger.error('Output filepath points to an existing directory! ("%s").\n' % (fullpath))
+            status = USB_STATUS_HOST_IO_ERROR
+            break
+
+        # Get file object.
+        file = open(fullpath, "wb")
+        utilsPreallocateFile(file, file_size)
+
+        # Empty files carry no data stage.
+        if not file_size:
+            file.close()
+            continue
+
+        g_logger.debug('Data transfer started. Saving file to: "%s".' % (fullpath))
+
+        # Create dedicated writer thread so USB reads and disk writes overlap.
+        writer = FileWriter(file)
+
+        offset = 0
+        blksize = g_usbTransferBlockSize
+        cancelled = False
+
+        while offset < file_size:
+            # Update block size (if needed).
+            diff = (file_size - offset)
+            if blksize > diff: blksize = diff
+
+            # Set block size and handle Zero-Length Termination packet (if needed).
+            rd_size = blksize
+            if ((offset + blksize) >= file_size) and utilsIsValueAlignedToEndpointPacketSize(blksize): rd_size += 1
+
+            # Grab a recycled buffer and read the current chunk into it.
+            buf = writer.get_buffer()
+
+            chunk_size = usbReadIntoBuffer(buf, rd_size, USB_TRANSFER_TIMEOUT)
+            if chunk_size is None:
+                g_logger.error('Failed to read 0x%X-byte long data chunk!' % (rd_size))
+
+                # Cancel file transfer.
+                writer.discard(buf)
+                writer.finish()
+                file.close()
+                os.remove(fullpath)
+                if use_pbar: g_progressBarWindow.end()
+
+                # Returning None will make the command handler exit right away.
+                return None
+
+            # Check if we're dealing with a CancelFileTransfer command.
+            if chunk_size == USB_CMD_HEADER_SIZE:
+                (magic, cmd_id, cmd_block_size) = struct.unpack_from('<4sII', buf, 0)
+                if (magic == USB_MAGIC_WORD) and (cmd_id == USB_CMD_CANCEL_FILE_TRANSFER):
+                    writer.discard(buf)
+                    cancelled = True
+
+                    g_logger.debug('Received CancelFileTransfer (%02X) command.' % (USB_CMD_CANCEL_FILE_TRANSFER))
+                    g_logger.warning('Transfer cancelled.')
+                    break
+
+            # Hand the current chunk over to the writer thread.
+            writer.submit(buf, chunk_size)
+
+            # Update current offset.
+            offset = (offset + chunk_size)
+
+            # Update progress bar window (if needed).
+            if use_pbar: g_progressBarWindow.update(chunk_size)
+
+        # Wait until all pending writes hit the disk.
+        write_success = writer.finish()
+        file.close()
+
+        if cancelled:
+            os.remove(fullpath)
+            if use_pbar: g_progressBarWindow.end()
+
+            # Let the command handler take care of sending the status response for us.
+            return USB_STATUS_SUCCESS
+
+        if not write_success:
+            g_logger.error('Failed to write data to "%s"!' % (fullpath))
+            os.remove(fullpath)
+            status = USB_STATUS_HOST_IO_ERROR
+            break
+
+    # Hide progress bar window (if needed).
+    if use_pbar: g_progressBarWindow.end()
+
+    if status == USB_STATUS_SUCCESS: g_logger.debug('Batch transfer successfully completed!\n')
+
+    # The status response sent by the command handler doubles as the aggregated acknowledgement for all batched file data.
+    return status
+
+def usbHandleSendDirectoryTable(cmd_block):
+    g_logger.debug('Received SendDirectoryTable (%02X) command.' % (USB_CMD_SEND_DIRECTORY_TABLE))
+
+    if g_nspTransferMode:
+        g_logger.error('Received SendDirectoryTable command during NSP transfer mode!\n')
+        return USB_STATUS_MALFORMED_CMD
+
+    # Parse table header.
+    (entry_count,) = struct.unpack_from('<I', cmd_block, 0)
+    if (not entry_count) or (len(cmd_block) != (USB_CMD_BLOCK_SIZE_SEND_DIRECTORY_TABLE_HEADER + (entry_count * USB_CMD_BLOCK_SIZE_SEND_DIRECTORY_TABLE_ENTRY))):
+        g_logger.error('Invalid directory table entry count! (%u).\n' % (entry_count))
+        return USB_STATUS_MALFORMED_CMD
+
+    # Create every announced directory upfront. Matching per-file directory creation is skipped during the data transfer stage.
+    for i in range(entry_count):
+        entry_offset = (USB_CMD_BLOCK_SIZE_SEND_DIRECTORY_TABLE_HEADER + (i * USB_CMD_BLOCK_SIZE_SEND_DIRECTORY_TABLE_ENTRY))
+        (path_length, raw_path) = struct.unpack_from('<I%ds' % (USB_FILE_PROPERTIES_MAX_NAME_LENGTH), cmd_block, entry_offset)
+        path = raw_path.decode('utf-8').strip('\x00')
+
+        if (not path_length) or (path_length > USB_FILE_PROPERTIES_MAX_NAME_LENGTH):
+            g_logger.error('Invalid path for directory table entry %u!\n' % (i))
+            return USB_STATUS_MALFORMED_CMD
+
+        dirpath = os.path.abspath(g_outputDir + os.path.sep + path)
+
+        try:
+            os.makedirs(dirpath, exist_ok=True)
+        except OSError:
+            g_logger.error('Failed to create directory! ("%s").\n' % (dirpath))
+            return USB_STATUS_HOST_IO_ERROR
+
+        g_precreatedDirs.add(dirpath)
+
+    g_logger.debug('Pre-created %u directories from transmitted directory table.' % (entry_count))
+
+    return USB_STATUS_SUCCESS
+
+def usbHandleUseCachedContent(cmd_block):
+    global g_nspRemainingSize
+
+    g_logger.debug('Received UseCachedContent (%02X) command.' % (USB_CMD_USE_CACHED_CONTENT))
+
+    # Parse command block. Cached content references reuse the SendFileProperties block layout.
+    (file_size, filename_length, nsp_header_size, raw_filename) = struct.unpack_from('<QII%ds' % (USB_FILE_PROPERTIES_MAX_NAME_LENGTH), cmd_block, 0)
+    filename = raw_filename.decode('utf-8').strip('\x00')
+
+    # Integrity checks.
+    if (not g_nspTransferMode) or (g_nspFile is None):
+        g_logger.error('Received cached content reference out of NSP transfer mode!\n')
+        return USB_STATUS_MALFORMED_CMD
+
+    if nsp_header_size or (not file_size) or (not filename_length) or (filename_length > USB_FILE_PROPERTIES_MAX_NAME_LENGTH):
+        g_logger.error('Invalid cached content reference!\n')
+        return USB_STATUS_MALFORMED_CMD
+
+    if file_size > g_nspRemainingSize:
+        g_logger.error('Referenced entry size exceeds remaining NSP data size! (0x%X > 0x%X).\n' % (file_size, g_nspRemainingSize))
+        return USB_STATUS_MALFORMED_CMD
+
+    # Build the content cache index on first use.
+    if g_contentCacheIndex is None: utilsBuildContentCacheIndex()
+
+    # Look up the referenced entry. Both its name and its exact size must match, and the current output NSP is never used as a source.
+    cached_entry = g_contentCacheIndex.get((filename, file_size))
+    if (cached_entry is None) or (cached_entry[0] == g_nspFilePath):
+        g_logger.debug('Entry "%s" (0x%X byte[s]) not found in the content cache.' % (filename, file_size))
+        return USB_STATUS_NOT_CACHED
+
+    (nsp_path, entry_offset) = cached_entry
+
+    g_logger.info('Splicing cached NSP file entry "%s" (0x%X byte[s]) from "%s".' % (filename, file_size, nsp_path))
+
+    # Copy the entry data into the output NSP at the current write position.
+    try:
+        with open(nsp_path, 'rb') as src:
+            src.seek(entry_offset)
+
+            remaining = file_size
+            while remaining:
+                chunk = src.read(min(remaining, g_usbTransferBlockSize))
+                if not chunk:
+                    g_logger.error('Failed to read cached entry data from "%s"!\n' % (nsp_path))
+                    return USB_STATUS_HOST_IO_ERROR
+
+                g_nspFile.write(chunk)
+                remaining -= len(chunk)
+    except OSError:
+        g_logger.error('Failed to splice cached entry data from "%s"!\n' % (nsp_path))
+        return USB_STATUS_HOST_IO_ERROR
+
+    # Update remaining NSP data size.
+    g_nspRemainingSize -= file_size
+
+    return USB_STATUS_SUCCESS
+
 def usbHandleSendNspHeader(cmd_block):
     global g_nspTransferMode, g_nspHeaderSize, g_nspRemainingSize, g_nspFile, g_nspFilePath
 
@@ -847,6 +1331,9 @@ def usbHandleSendNspHeader(cmd_block):
 
     g_logger.debug('Successfully wrote 0x%X-byte long NSP header to "%s".\n' % (nsp_header_size, g_nspFilePath))
 
+    # Make the entries from the finished NSP available for cached content splicing right away (if the index has already been built).
+    if g_contentCacheIndex is not None: utilsAddNspToContentCacheIndex(g_nspFilePath)
+
     # Disable NSP transfer mode.
     utilsResetNspInfo()
 
@@ -857,12 +1344,21 @@ def usbHandleEndSession(cmd_block):
     return USB_STATUS_SUCCESS
 
 def usbCommandHandler():
+    global g_usbTransferBlockSize, g_usbTransferBlockSizeLog2
+
+    # Reset negotiated transfer block size. Updated in usbHandleStartSession().
+    g_usbTransferBlockSize = USB_TRANSFER_BLOCK_SIZE
+    g_usbTransferBlockSizeLog2 = 0
+
     # CancelFileTransfer is handled in usbHandleSendFileProperties().
     cmd_dict = {
-        USB_CMD_START_SESSION:        usbHandleStartSession,
-        USB_CMD_SEND_FILE_PROPERTIES: usbHandleSendFileProperties,
-        USB_CMD_SEND_NSP_HEADER:      usbHandleSendNspHeader,
-        USB_CMD_END_SESSION:          usbHandleEndSession
+        USB_CMD_START_SESSION:              usbHandleStartSession,
+        USB_CMD_SEND_FILE_PROPERTIES:       usbHandleSendFileProperties,
+        USB_CMD_SEND_NSP_HEADER:            usbHandleSendNspHeader,
+        USB_CMD_END_SESSION:                usbHandleEndSession,
+        USB_CMD_SEND_FILE_PROPERTIES_BATCH: usbHandleSendFilePropertiesBatch,
+        USB_CMD_SEND_DIRECTORY_TABLE:       usbHandleSendDirectoryTable,
+        USB_CMD_USE_CACHED_CONTENT:         usbHandleUseCachedContent
     }
 
     # Get device endpoints.
@@ -921,6 +1417,8 @@ def usbCommandHandler():
         # Verify command block size.
         if (cmd_id == USB_CMD_START_SESSION and cmd_block_size != USB_CMD_BLOCK_SIZE_START_SESSION) or \
            (cmd_id == USB_CMD_SEND_FILE_PROPERTIES and cmd_block_size != USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES) or \
+           (cmd_id == USB_CMD_USE_CACHED_CONTENT and cmd_block_size != USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES) or \
+           (cmd_id == USB_CMD_SEND_FILE_PROPERTIES_BATCH and cmd_block_size < (USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES_BATCH_HEADER + USB_CMD_BLOCK_SIZE_SEND_FILE_PROPERTIES)) or \
            (cmd_id == USB_CMD_SEND_NSP_HEADER and not cmd_block_size):
             g_logger.error('Invalid command block size for command ID %02X! (0x%X).\n' % (cmd_id, cmd_block_size))
             usbSendStatus(USB_STATUS_MALFORMED_CMD)
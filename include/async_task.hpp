@@ -27,12 +27,123 @@
 #ifndef __ASYNC_TASK_HPP__
 #define __ASYNC_TASK_HPP__
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <exception>
+#include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace nxdt::tasks
 {
+    /* Priority classes for tasks submitted to the shared worker pool. */
+    enum class AsyncTaskPriority : int
+    {
+        UiBlocking, ///< The UI actively waits on this task. Dequeued ahead of background work, with one pool worker reserved for this class.
+        Background  ///< Long-running work the UI only monitors (e.g. file downloads).
+    };
+
+    /* Process-wide worker pool shared by all AsyncTask objects. */
+    /* Keeps a small set of persistent threads around instead of spawning a fresh one per task, which avoids both thread-creation overhead and core oversubscription. */
+    /* One worker exclusively services UI-blocking tasks, so queued background work can never starve them. */
+    class AsyncTaskPool
+    {
+        private:
+            /* Total worker count. Matches the three CPU cores available to applications - idle workers just sleep on the condition variable. */
+            static constexpr size_t WORKER_COUNT = 3;
+
+            std::vector<std::thread> m_workers{};
+            std::deque<std::function<void(void)>> m_uiQueue{}, m_bgQueue{};
+            std::mutex m_mtx{};
+            std::condition_variable m_cv{};
+            bool m_exitFlag = false;
+
+            AsyncTaskPool(void)
+            {
+                /* Create worker threads. The first one is reserved for UI-blocking tasks. */
+                for(size_t i = 0; i < WORKER_COUNT; i++) this->m_workers.emplace_back(&AsyncTaskPool::workerFunc, this, i == 0);
+            }
+
+            ~AsyncTaskPool(void) noexcept
+            {
+                /* Signal the exit flag and wait for all worker threads to finish. */
+                {
+                    std::lock_guard<std::mutex> lock(this->m_mtx);
+                    this->m_exitFlag = true;
+                }
+
+                this->m_cv.notify_all();
+
+                for(auto& worker : this->m_workers) worker.join();
+            }
+
+            /* Worker thread function. Dequeues and runs submitted tasks until the exit flag is signaled. */
+            void workerFunc(bool ui_only)
+            {
+                while(true)
+                {
+                    std::function<void(void)> task{};
+
+                    {
+                        std::unique_lock<std::mutex> lock(this->m_mtx);
+
+                        /* Wait until a suitable task is queued or the pool is being torn down. */
+                        this->m_cv.wait(lock, [this, ui_only]() {
+                            return (this->m_exitFlag || !this->m_uiQueue.empty() || (!ui_only && !this->m_bgQueue.empty()));
+                        });
+
+                        if (this->m_exitFlag && this->m_uiQueue.empty() && (ui_only || this->m_bgQueue.empty())) break;
+
+                        /* UI-blocking tasks always jump ahead of queued background work. */
+                        auto& queue = (!this->m_uiQueue.empty() ? this->m_uiQueue : this->m_bgQueue);
+                        task = std::move(queue.front());
+                        queue.pop_front();
+                    }
+
+                    /* Run task outside the lock. */
+                    task();
+                }
+            }
+
+        public:
+            /* Set class as non-copyable and non-moveable. */
+            NON_COPYABLE(AsyncTaskPool);
+            NON_MOVEABLE(AsyncTaskPool);
+
+            /* Returns a reference to the process-wide worker pool, lazily creating it on first use. */
+            static AsyncTaskPool& GetInstance(void)
+            {
+                static AsyncTaskPool instance;
+                return instance;
+            }
+
+            /* Submits a task function to the pool and returns a future for its result. */
+            template<typename Func>
+            auto Submit(AsyncTaskPriority priority, Func&& func) -> std::future<decltype(func())>
+            {
+                using FuncResult = decltype(func());
+
+                /* Wrap the task function - std::function requires copyable callables, while std::packaged_task is move-only. */
+                auto task = std::make_shared<std::packaged_task<FuncResult(void)>>(std::forward<Func>(func));
+                std::future<FuncResult> future = task->get_future();
+
+                /* Push the wrapped task function to the queue matching its priority class. */
+                {
+                    std::lock_guard<std::mutex> lock(this->m_mtx);
+                    auto& queue = (priority == AsyncTaskPriority::UiBlocking ? this->m_uiQueue : this->m_bgQueue);
+                    queue.push_back([task]() { (*task)(); });
+                }
+
+                this->m_cv.notify_one();
+
+                return future;
+            }
+    };
+
     /* Used by AsyncTask to throw exceptions whenever required. */
     class AsyncTaskException : std::exception
     {
@@ -70,6 +181,9 @@ namespace nxdt::tasks
             Result m_result{};
             std::future<Result> m_future{};
             Progress m_progress{};
+            bool m_progressUpdated = false;
+            std::chrono::milliseconds m_progressUpdateInterval{250}; /* At most ~4 progress updates per second by default. */
+            std::chrono::time_point<std::chrono::steady_clock> m_lastProgressUpdateTime{};
             bool m_cancelled = false, m_rethrowException = false;
             std::exception_ptr m_exceptionPtr{};
 
@@ -121,6 +235,12 @@ namespace nxdt::tasks
             /* This function should periodically call isCancelled() to determine if it should end prematurely. */
             virtual Result doInBackground(const Params&... params) = 0;
 
+            /* Returns the priority class used when the task is submitted to the shared worker pool. */
+            virtual AsyncTaskPriority getPriority(void) const
+            {
+                return AsyncTaskPriority::Background;
+            }
+
             /* Posts asynchronous task result. Runs on the asynchronous task thread. */
             virtual Result postResult(Result&& result)
             {
@@ -140,6 +260,7 @@ namespace nxdt::tasks
             virtual void onProgressUpdate(const Progress& progress) { }
 
             /* Stores the current progress inside the class. Runs on the asynchronous task thread. */
+            /* Publications are coalesced: loopCallback() forwards the latest stored value at most once per progress update interval. */
             virtual void publishProgress(const Progress& progress)
             {
                 std::lock_guard<std::recursive_mutex> lock(this->m_mtx);
@@ -149,6 +270,7 @@ namespace nxdt::tasks
 
                 /* Update progress. */
                 this->m_progress = progress;
+                this->m_progressUpdated = true;
             }
 
             /* Returns the current progress. May run on both threads. */
@@ -158,6 +280,14 @@ namespace nxdt::tasks
                 return this->m_progress;
             }
 
+            /* Sets the minimum interval between onProgressUpdate() calls issued by loopCallback(). May be used on both threads. */
+            /* Tasks that publish progress very often (e.g. once per dumped block) can raise this to keep redraw overhead in check. */
+            void setProgressUpdateInterval(const std::chrono::milliseconds& interval)
+            {
+                std::lock_guard<std::recursive_mutex> lock(this->m_mtx);
+                this->m_progressUpdateInterval = interval;
+            }
+
         public:
             AsyncTask(void) = default;
 
@@ -196,8 +326,9 @@ namespace nxdt::tasks
                 /* Run onPreExecute() callback. */
                 this->onPreExecute();
 
-                /* Start asynchronous task on a new thread. */
-                this->m_future = std::async(std::launch::async, [this](const Params&... params) -> Result {
+                /* Submit asynchronous task to the shared worker pool. */
+                /* Parameters are captured by value - the task may not start running until a pool worker becomes available. */
+                this->m_future = AsyncTaskPool::GetInstance().Submit(this->getPriority(), [this, params...]() -> Result {
                     /* Catch any exceptions thrown by the asynchronous task. */
                     try {
                         return this->postResult(this->doInBackground(params...));
@@ -209,7 +340,7 @@ namespace nxdt::tasks
                     }
 
                     return {};
-                }, params...);
+                });
 
                 return *this;
             }
@@ -306,8 +437,15 @@ namespace nxdt::tasks
                 switch(thread_status)
                 {
                     case std::future_status::timeout:
-                        /* Update progress. */
-                        this->onProgressUpdate(this->m_progress);
+                        /* Update progress, but only if a new value has been published and the update interval has passed. */
+                        /* Publication is latest-value-wins, so the render thread sees a bounded number of updates no matter how often the task publishes. */
+                        if (this->m_progressUpdated && (std::chrono::steady_clock::now() - this->m_lastProgressUpdateTime) >= this->m_progressUpdateInterval)
+                        {
+                            this->m_progressUpdated = false;
+                            this->m_lastProgressUpdateTime = std::chrono::steady_clock::now();
+                            this->onProgressUpdate(this->m_progress);
+                        }
+
                         break;
                     case std::future_status::ready:
                         /* Finish task. */
@@ -28,6 +28,8 @@
 extern "C" {
 #endif
 
+#define AES_XTS_TWEAK_BATCH_SIZE    64  /* Maximum number of sector tweaks precomputed per batch by aes128XtsNintendoCrypt(). */
+
 /// One-shot function to perform AES-128-ECB crypto.
 /// 'dst', 'src' and 'key' must all have a size of at least AES_BLOCK_SIZE bytes.
 /// 'dst' and 'src' can both point to the same address.
@@ -35,6 +37,7 @@ void aes128EcbCrypt(void *dst, const void *src, const void *key, bool encrypt);
 
 /// Performs an AES-128-XTS crypto operation using the non-standard Nintendo XTS tweak.
 /// The Aes128XtsContext element should have been previously initialized with aes128XtsContextCreate(). 'encrypt' should match the value of 'is_encryptor' used with that call.
+/// Sector tweaks are precomputed in batches of up to AES_XTS_TWEAK_BATCH_SIZE sectors to reduce per-sector overhead on multi-sector buffers.
 /// 'dst' and 'src' can both point to the same address.
 size_t aes128XtsNintendoCrypt(Aes128XtsContext *ctx, void *dst, const void *src, size_t size, u64 sector, size_t sector_size, bool encrypt);
 
@@ -44,14 +47,15 @@ NX_INLINE void aes128CtrInitializePartialCtr(u8 *out, const u8 *ctr, u64 offset)
 {
     if (!out || !ctr) return;
 
-    offset >>= 4;
+    /* Reverse the byte order of the upper CTR value via a single byte-swapped 64-bit store. */
+    u64 ctr_upper = 0;
+    memcpy(&ctr_upper, ctr, sizeof(ctr_upper));
+    ctr_upper = __builtin_bswap64(ctr_upper);
+    memcpy(out, &ctr_upper, sizeof(ctr_upper));
 
-    for(u8 i = 0; i < 8; i++)
-    {
-        out[i] = ctr[0x8 - i - 1];
-        out[0x10 - i - 1] = (u8)(offset & 0xFF);
-        offset >>= 8;
-    }
+    /* Store the big endian block index in the lower half of the counter. */
+    u64 block_idx = __builtin_bswap64(offset >> 4);
+    memcpy(out + 0x8, &block_idx, sizeof(block_idx));
 }
 
 /// Updates the provided AES partial counter using an offset.
@@ -60,13 +64,9 @@ NX_INLINE void aes128CtrUpdatePartialCtr(u8 *ctr, u64 offset)
 {
     if (!ctr) return;
 
-    offset >>= 4;
-
-    for(u8 i = 0; i < 8; i++)
-    {
-        ctr[0x10 - i - 1] = (u8)(offset & 0xFF);
-        offset >>= 8;
-    }
+    /* Store the big endian block index in the lower half of the counter. */
+    u64 block_idx = __builtin_bswap64(offset >> 4);
+    memcpy(ctr + 0x8, &block_idx, sizeof(block_idx));
 }
 
 /// Updates the provided AES partial counter using an offset and a 32-bit CTR value.
@@ -75,19 +75,13 @@ NX_INLINE void aes128CtrUpdatePartialCtrEx(u8 *ctr, u32 ctr_val, u64 offset)
 {
     if (!ctr) return;
 
-    offset >>= 4;
-
-    for(u8 i = 0; i < 8; i++)
-    {
-        ctr[0x10 - i - 1] = (u8)(offset & 0xFF);
-        offset >>= 8;
-    }
+    /* Store the big endian block index in the lower half of the counter. */
+    u64 block_idx = __builtin_bswap64(offset >> 4);
+    memcpy(ctr + 0x8, &block_idx, sizeof(block_idx));
 
-    for(u8 i = 0; i < 4; i++)
-    {
-        ctr[0x8 - i - 1] = (u8)(ctr_val & 0xFF);
-        ctr_val >>= 8;
-    }
+    /* Store the big endian 32-bit CTR value right before the block index. */
+    u32 ctr_val_be = __builtin_bswap32(ctr_val);
+    memcpy(ctr + 0x4, &ctr_val_be, sizeof(ctr_val_be));
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,67 @@
+/*
+ * benchmark.h
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCHMARK_NUM_BLOCK_SIZES   4   /* Number of block sizes probed per storage device. */
+
+/// Per-block-size result from a storage write benchmark.
+typedef struct {
+    u32 block_size;     ///< Block size used for this benchmark pass.
+    double speed;       ///< Measured sequential write throughput, in MiB/s. Zero if this pass failed.
+} BenchmarkBlockResult;
+
+/// Storage device write benchmark results.
+typedef struct {
+    char name[0x40];                                            ///< Display name for the benchmarked storage device.
+    char root_path[0x20];                                       ///< Root path for the benchmarked storage device (e.g. "sdmc:/").
+    BenchmarkBlockResult block_results[BENCHMARK_NUM_BLOCK_SIZES];  ///< Per-block-size results.
+    u32 best_block_size;                                        ///< Block size that achieved the highest write throughput. Zero if every pass failed.
+    double best_speed;                                          ///< Write throughput achieved using 'best_block_size', in MiB/s.
+} BenchmarkDeviceResult;
+
+/// Runs a sequential write benchmark on the SD card and every available USB Mass Storage device.
+/// Returns a pointer to a dynamically allocated array of BenchmarkDeviceResult elements, which must be freed by the calling function. Returns NULL if an error occurs.
+/// The best block size for each device is saved to the configuration file, and can later be retrieved via benchmarkGetBestBlockSizeByDevicePath().
+/// This is a blocking, I/O heavy operation - it shouldn't be carried out while a dump operation is in progress.
+BenchmarkDeviceResult *benchmarkAllStorageDevices(u32 *out_count);
+
+/// Runs a sequential write benchmark on the storage device pointed to by the provided root path (e.g. "sdmc:/", "ums0:/").
+/// Returns false if an error occurs. Partial per-block-size failures don't make the whole benchmark fail.
+/// The best block size is saved to the configuration file if 'config_key' isn't NULL.
+bool benchmarkStorageDevice(const char *root_path, const char *config_key, BenchmarkDeviceResult *out_result);
+
+/// Returns the best write block size previously benchmarked for the storage device pointed to by the provided root path.
+/// Returns zero if the device hasn't been benchmarked yet.
+u32 benchmarkGetBestBlockSizeByDevicePath(const char *root_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCHMARK_H__ */
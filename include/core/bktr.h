@@ -50,6 +50,8 @@ extern "C" {
 
 #define BKTR_MAX_SUBSTORAGE_COUNT           2
 
+#define BKTR_NODE_CACHE_COUNT               4                           /* Number of MRU entry set ranges cached per Bucket Tree context. */
+
 /// Used as the header for both BucketTreeOffsetNode and BucketTreeEntryNode.
 typedef struct {
     u32 index;  ///< BucketTreeOffsetNode / BucketTreeEntryNode index.
@@ -161,6 +163,13 @@ typedef enum {
     BucketTreeSubStorageType_Count      = 5     ///< Total values supported by this enum.
 } BucketTreeSubStorageType;
 
+/// Caches the virtual offset range covered by a previously resolved BucketTreeEntryNode, making it possible to skip the tree walk on subsequent lookups within the same range.
+typedef struct {
+    u32 entry_set_index;    ///< BucketTreeEntryNode index within the Bucket Tree Table.
+    u64 start_offset;       ///< Virtual start offset for this entry set (inclusive).
+    u64 end_offset;         ///< Virtual end offset for this entry set (exclusive).
+} BucketTreeNodeCacheEntry;
+
 // Forward declaration for BucketTreeSubStorage.
 typedef struct _BucketTreeContext BucketTreeContext;
 
@@ -184,8 +193,19 @@ struct _BucketTreeContext {
     u64 start_offset;                                               ///< Virtual storage start offset.
     u64 end_offset;                                                 ///< Virtual storage end offset.
     BucketTreeSubStorage substorages[BKTR_MAX_SUBSTORAGE_COUNT];    ///< Substorages required for this BucketTree storage. May be set after initializing this context.
+    BucketTreeNodeCacheEntry node_cache[BKTR_NODE_CACHE_COUNT];     ///< MRU cache with the entry set ranges resolved by the last few storage entry lookups.
+    u8 node_cache_count;                                            ///< Number of valid elements within 'node_cache'.
+    void *compressed_scratch;                                       ///< Persistent scratch buffer used for LZ4 decompression under Compressed storages. Grown on demand, reused across reads.
+    u64 compressed_scratch_size;                                    ///< Size of the buffer pointed to by 'compressed_scratch'.
 };
 
+/// Used by bktrClassifyBlocksWithinIndirectStorageRange() to classify multiple block extents in a single pass.
+typedef struct {
+    u64 offset;     ///< Virtual block offset. Must be within the target storage's range.
+    u64 size;       ///< Block size. Must not be zero.
+    bool updated;   ///< Set to true if any part of this block is covered by Indirect Storage entry nodes with a Patch storage index.
+} BucketTreeBlockClassification;
+
 /// Initializes a Bucket Tree context using the provided NCA FS section context and a storage type.
 /// 'storage_type' may only be BucketTreeStorageType_Indirect, BucketTreeStorageType_AesCtrEx or BucketTreeStorageType_Sparse.
 bool bktrInitializeContext(BucketTreeContext *out, NcaFsSectionContext *nca_fs_ctx, u8 storage_type);
@@ -209,12 +229,18 @@ bool bktrReadStorage(BucketTreeContext *ctx, void *out, u64 read_size, u64 offse
 /// The storage type from the provided BucketTreeContext may only be BucketTreeStorageType_Indirect or BucketTreeStorageType_Compressed (with an underlying Indirect substorage).
 bool bktrIsBlockWithinIndirectStorageRange(BucketTreeContext *ctx, u64 offset, u64 size, bool *out);
 
+/// Classifies multiple block extents against the provided BucketTreeContext's Indirect Storage, updating the 'updated' flag from each BucketTreeBlockClassification element.
+/// The provided blocks must be sorted by offset in ascending order. Indirect Storages are processed through a single sequential entry node walk, regardless of the block count.
+/// The storage type from the provided BucketTreeContext may only be BucketTreeStorageType_Indirect or BucketTreeStorageType_Compressed (with an underlying Indirect substorage).
+bool bktrClassifyBlocksWithinIndirectStorageRange(BucketTreeContext *ctx, BucketTreeBlockClassification *blocks, u32 block_count);
+
 /// Helper inline functions.
 
 NX_INLINE void bktrFreeContext(BucketTreeContext *ctx)
 {
     if (!ctx) return;
     if (ctx->storage_table) free(ctx->storage_table);
+    if (ctx->compressed_scratch) free(ctx->compressed_scratch);
     memset(ctx, 0, sizeof(BucketTreeContext));
 }
 
@@ -168,7 +168,8 @@ NX_INLINE CertCommonBlock *certGetCommonBlock(void *buf)
 
 NX_INLINE bool certIsValidPublicKeyType(u32 type)
 {
-    return (type == CertPubKeyType_Rsa4096 || type == CertPubKeyType_Rsa2048 || type == CertPubKeyType_Ecc480);
+    /* Public key type values are contiguous, so a simple range check will suffice. */
+    return (type <= CertPubKeyType_Ecc480);
 }
 
 NX_INLINE u8 *certGetPublicKey(CertCommonBlock *cert_common_block)
@@ -178,16 +179,25 @@ NX_INLINE u8 *certGetPublicKey(CertCommonBlock *cert_common_block)
 
 NX_INLINE u64 certGetPublicKeySize(u32 type)
 {
-    return (u64)(type == CertPubKeyType_Rsa4096 ? MEMBER_SIZE(CertPublicKeyBlockRsa4096, public_key) : \
-                (type == CertPubKeyType_Rsa2048 ? MEMBER_SIZE(CertPublicKeyBlockRsa2048, public_key) : \
-                (type == CertPubKeyType_Ecc480  ? MEMBER_SIZE(CertPublicKeyBlockEcc480,  public_key) : 0)));
+    /* Layout properties are resolved through constant lookup tables instead of branch chains - bulk certificate iteration hits these helpers once per parsed entry. */
+    static const u16 pub_key_sizes[] = {
+        MEMBER_SIZE(CertPublicKeyBlockRsa4096, public_key),     /* CertPubKeyType_Rsa4096. */
+        MEMBER_SIZE(CertPublicKeyBlockRsa2048, public_key),     /* CertPubKeyType_Rsa2048. */
+        MEMBER_SIZE(CertPublicKeyBlockEcc480,  public_key)      /* CertPubKeyType_Ecc480. */
+    };
+
+    return (u64)(certIsValidPublicKeyType(type) ? pub_key_sizes[type] : 0);
 }
 
 NX_INLINE u64 certGetPublicKeyBlockSize(u32 type)
 {
-    return (u64)(type == CertPubKeyType_Rsa4096 ? sizeof(CertPublicKeyBlockRsa4096) : \
-                (type == CertPubKeyType_Rsa2048 ? sizeof(CertPublicKeyBlockRsa2048) : \
-                (type == CertPubKeyType_Ecc480  ? sizeof(CertPublicKeyBlockEcc480)  : 0)));
+    static const u16 pub_key_block_sizes[] = {
+        sizeof(CertPublicKeyBlockRsa4096),  /* CertPubKeyType_Rsa4096. */
+        sizeof(CertPublicKeyBlockRsa2048),  /* CertPubKeyType_Rsa2048. */
+        sizeof(CertPublicKeyBlockEcc480)    /* CertPubKeyType_Ecc480. */
+    };
+
+    return (u64)(certIsValidPublicKeyType(type) ? pub_key_block_sizes[type] : 0);
 }
 
 NX_INLINE u32 certGetPublicExponent(CertCommonBlock *cert_common_block)
@@ -308,6 +308,18 @@ typedef struct {
 /// Initializes a ContentMetaContext using a previously initialized NcaContext (which must belong to a Meta NCA).
 bool cnmtInitializeContext(ContentMetaContext *out, NcaContext *nca_ctx);
 
+/// Used by cnmtInitializeContextBatch() to initialize multiple ContentMetaContext elements at once.
+typedef struct {
+    ContentMetaContext *cnmt_ctx;   ///< Output ContentMetaContext. Must point to a valid element that isn't shared with any other batch entry.
+    NcaContext *nca_ctx;            ///< Pointer to a previously initialized NcaContext for a Meta NCA. Must not be shared with any other batch entry.
+    bool success;                   ///< Output field. Set to true if this ContentMetaContext was successfully initialized.
+} ContentMetaBatchEntry;
+
+/// Initializes multiple ContentMetaContext elements at once, fanning the work out across worker threads - the calling thread chips in as well.
+/// Each entry behaves exactly like a standalone cnmtInitializeContext() call, with its result written to the 'success' member.
+/// The worker thread count is capped by the NCA crypto buffer pool size. Returns true if every entry was successfully initialized.
+bool cnmtInitializeContextBatch(ContentMetaBatchEntry *entries, u32 entry_count);
+
 /// Updates NcmPackagedContentInfo data for the content entry with size, type and ID offset values that match the ones from the input NcaContext.
 bool cnmtUpdateContentInfo(ContentMetaContext *cnmt_ctx, NcaContext *nca_ctx);
 
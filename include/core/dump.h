@@ -0,0 +1,143 @@
+/*
+ * dump.h
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __DUMP_H__
+#define __DUMP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Shared multi-threaded dump engine.
+/// Every dump flow boils down to the same shape: a producer stage that generates data chunks (gamecard storage, NCA sections, RomFS file entries...), an optional filter stage that
+/// inspects the stream without modifying it (checksum calculation), and a consumer stage that disposes of each chunk (file write, USB transfer). This module implements that pipeline
+/// once - ring buffer pool, stage threads, backpressure, cancellation and transfer statistics - so individual dumpers only provide per-stage callbacks and userdata.
+/// Chunks flow through a fixed ring of preallocated slots. The producer stalls whenever every slot is still owned by a downstream stage, which caps memory usage and provides natural
+/// backpressure. Filter and consumer stages run concurrently on the same filled slots - a slot is only recycled after both stages have moved past it.
+
+#define DUMP_PIPELINE_RING_BUFFER_COUNT 4           /* Must be a power of two. Statistically, three slots already keep both I/O ends busy - the fourth absorbs scheduling jitter. */
+
+#define DUMP_PIPELINE_DEFAULT_BLOCK_SIZE 0x800000   /* Default ring slot size (8 MiB). Matches the block size used by the standalone dumpers. */
+
+/// Producer stage callback. Called from the producer thread once per chunk.
+/// Shall fill 'buf' with up to 'buf_size' bytes and update 'out_size' with the amount of data actually generated. Setting 'out_size' to zero signals the end of the stream.
+/// 'out_tag' may be updated with an opaque, caller-owned pointer that travels through the pipeline attached to this chunk and gets handed to the consumer stage in stream order.
+/// Tags make it possible to interleave in-band control data with the stream (e.g. file properties for USB transfers). The engine never dereferences nor frees them.
+/// Shall return false if an irrecoverable error occurs.
+typedef bool (*DumpPipelineProducerFunc)(void *userdata, void *buf, u64 buf_size, u64 *out_size, void **out_tag);
+
+/// Filter stage callback. Called from the filter thread once per filled chunk, in stream order. Shall treat 'buf' as read-only.
+/// Shall return false if an irrecoverable error occurs.
+typedef bool (*DumpPipelineFilterFunc)(void *userdata, const void *buf, u64 size);
+
+/// Consumer stage callback. Called from the consumer thread once per filled chunk, in stream order. Shall treat 'buf' as read-only.
+/// 'tag' holds the opaque pointer attached to this chunk by the producer stage, or NULL if none was set.
+/// Shall return false if an irrecoverable error occurs.
+typedef bool (*DumpPipelineConsumerFunc)(void *userdata, const void *buf, u64 size, void *tag);
+
+/// Cancellation callback. Optional. Called exactly once from dumpPipelineCancel() to unblock a consumer stage stuck inside a blocking call (e.g. usbCancelFileTransfer()).
+typedef void (*DumpPipelineCancelFunc)(void *userdata);
+
+/// Transfer statistics. Retrieved via dumpPipelineGetStats(). Safe to poll from the UI thread while the pipeline is running.
+typedef struct {
+    u64 total_size;             ///< Expected stream size, as provided to dumpPipelineInitialize(). Zero if unknown.
+    u64 produced_size;          ///< Total amount of data generated by the producer stage thus far.
+    u64 consumed_size;          ///< Total amount of data processed by the consumer stage thus far. Use this for progress reporting.
+    u64 producer_stall_count;   ///< Number of chunks the producer stage had to wait on before a free ring slot became available. Signals a downstream-bound pipeline.
+    u64 consumer_stall_count;   ///< Number of chunks the consumer stage had to wait on before a filled ring slot became available. Signals a producer-bound pipeline.
+    u64 producer_busy_ns;       ///< Total time spent inside the producer stage callback, in nanoseconds.
+    u64 filter_busy_ns;         ///< Total time spent inside the filter stage callback, in nanoseconds. Zero if no filter stage was registered.
+    u64 consumer_busy_ns;       ///< Total time spent inside the consumer stage callback, in nanoseconds.
+} DumpPipelineStats;
+
+/// Dump pipeline context. Zero out before using dumpPipelineInitialize().
+typedef struct {
+    bool initialized;                                   ///< Set to true by dumpPipelineInitialize().
+    bool started;                                       ///< Set to true by dumpPipelineStart(). Cleared by dumpPipelineWait().
+    void *buf[DUMP_PIPELINE_RING_BUFFER_COUNT];         ///< Page-aligned ring slots. Each one holds up to 'block_size' bytes.
+    u64 slot_size[DUMP_PIPELINE_RING_BUFFER_COUNT];     ///< Amount of data held by each ring slot.
+    void *slot_tag[DUMP_PIPELINE_RING_BUFFER_COUNT];    ///< Opaque per-chunk tag attached by the producer stage. NULL if none was set.
+    u64 total_size;                                     ///< Expected stream size. Zero if unknown. Informational only - the stream ends when the producer stage says so.
+    u64 block_size;                                     ///< Ring slot size.
+    DumpPipelineProducerFunc producer_func;             ///< Producer stage callback.
+    DumpPipelineFilterFunc filter_func;                 ///< Filter stage callback. May be NULL.
+    DumpPipelineConsumerFunc consumer_func;             ///< Consumer stage callback.
+    DumpPipelineCancelFunc cancel_func;                 ///< Cancellation callback. May be NULL.
+    void *producer_userdata;                            ///< Opaque pointer handed to the producer stage callback.
+    void *filter_userdata;                              ///< Opaque pointer handed to the filter stage callback.
+    void *consumer_userdata;                            ///< Opaque pointer handed to the consumer stage callback.
+    void *cancel_userdata;                              ///< Opaque pointer handed to the cancellation callback.
+    Thread producer_thread;                             ///< Producer stage thread.
+    Thread filter_thread;                               ///< Filter stage thread. Only created if a filter stage callback was registered.
+    Thread consumer_thread;                             ///< Consumer stage thread.
+    atomic_size_t produced_count;                       ///< Total number of slots filled by the producer stage. Only written by the producer thread.
+    atomic_size_t filtered_count;                       ///< Total number of slots processed by the filter stage. Only written by the filter thread.
+    atomic_size_t consumed_count;                       ///< Total number of slots processed by the consumer stage. Only written by the consumer thread.
+    atomic_size_t produced_size;                        ///< Total amount of data generated by the producer stage. Only written by the producer thread.
+    atomic_size_t consumed_size;                        ///< Total amount of data processed by the consumer stage. Only written by the consumer thread.
+    atomic_size_t producer_stall_count;                 ///< Producer stage stall counter. Only written by the producer thread.
+    atomic_size_t consumer_stall_count;                 ///< Consumer stage stall counter. Only written by the consumer thread.
+    atomic_size_t producer_busy_ns;                     ///< Producer stage callback busy time. Only written by the producer thread.
+    atomic_size_t filter_busy_ns;                       ///< Filter stage callback busy time. Only written by the filter thread.
+    atomic_size_t consumer_busy_ns;                     ///< Consumer stage callback busy time. Only written by the consumer thread.
+    atomic_bool eof_flag;                               ///< Set by the producer thread once the stream has been fully generated.
+    atomic_bool producer_error;                         ///< Set by the producer thread if its stage callback fails.
+    atomic_bool filter_error;                           ///< Set by the filter thread if its stage callback fails.
+    atomic_bool consumer_error;                         ///< Set by the consumer thread if its stage callback fails.
+    atomic_bool cancel_flag;                            ///< Set by dumpPipelineCancel().
+    atomic_int active_stage_count;                      ///< Number of stage threads that haven't exited yet.
+} DumpPipeline;
+
+/// Initializes a dump pipeline using the provided stage callbacks and allocates its ring slots.
+/// 'filter_func' and 'cancel_func' may be NULL. 'total_size' may be zero if the stream size isn't known upfront. 'block_size' may be zero to use DUMP_PIPELINE_DEFAULT_BLOCK_SIZE.
+/// Ring slots are page-aligned, so consumer stages built on top of the USB interface get zero-copy transfers for free.
+bool dumpPipelineInitialize(DumpPipeline *pipeline, DumpPipelineProducerFunc producer_func, void *producer_userdata, DumpPipelineFilterFunc filter_func, void *filter_userdata, \
+                            DumpPipelineConsumerFunc consumer_func, void *consumer_userdata, DumpPipelineCancelFunc cancel_func, void *cancel_userdata, u64 total_size, u64 block_size);
+
+/// Starts the stage threads from a previously initialized dump pipeline.
+bool dumpPipelineStart(DumpPipeline *pipeline);
+
+/// Returns true while at least one stage thread from a previously started dump pipeline is still running.
+bool dumpPipelineIsRunning(DumpPipeline *pipeline);
+
+/// Fills the provided DumpPipelineStats element with statistics from a previously initialized dump pipeline. Safe to call while the pipeline is running.
+void dumpPipelineGetStats(DumpPipeline *pipeline, DumpPipelineStats *out_stats);
+
+/// Requests the cancellation of a previously started dump pipeline. Every stage stops at the next chunk boundary. Use dumpPipelineWait() afterwards.
+void dumpPipelineCancel(DumpPipeline *pipeline);
+
+/// Waits until every stage thread from a previously started dump pipeline exits.
+/// Returns true if the whole stream was processed successfully, or false if a stage failed or the pipeline was cancelled. Use dumpPipelineIsCancelled() to tell both cases apart.
+bool dumpPipelineWait(DumpPipeline *pipeline);
+
+/// Returns true if the provided dump pipeline was cancelled via dumpPipelineCancel().
+bool dumpPipelineIsCancelled(DumpPipeline *pipeline);
+
+/// Frees the resources from a previously initialized dump pipeline. If the pipeline is still running, it is cancelled and waited on first.
+void dumpPipelineClose(DumpPipeline *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DUMP_H__ */
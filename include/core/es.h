@@ -37,6 +37,11 @@ Result esCountPersonalizedTicket(s32 *out_count);
 Result esListCommonTicket(s32 *out_entries_written, FsRightsId *out_ids, s32 count);
 Result esListPersonalizedTicket(s32 *out_entries_written, FsRightsId *out_ids, s32 count);
 
+/// The following functions retrieve the full rights ID set for their ticket type using a single list exchange, instead of requiring the caller to size a buffer beforehand.
+/// The returned buffer is sorted by rights ID and must be freed by the caller. A NULL buffer with a zero count is returned if no tickets are available.
+Result esListAllCommonTicket(FsRightsId **out_ids, s32 *out_count);
+Result esListAllPersonalizedTicket(FsRightsId **out_ids, s32 *out_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -230,9 +230,20 @@ typedef enum {
     GameCardStatus_LotusAsicFirmwareUpdateRequired = 3, ///< A gamecard has been inserted, but a LAFW update is needed before being able to read the secure storage area.
                                                         ///< Operations on the normal storage area are still possible, though.
     GameCardStatus_InsertedAndInfoNotLoaded        = 4, ///< A gamecard has been inserted, but an unexpected error unrelated to both "nogc" patch and LAFW version occurred.
-    GameCardStatus_InsertedAndInfoLoaded           = 5  ///< A gamecard has been inserted and all required information could be successfully retrieved from it.
+    GameCardStatus_InsertedAndInfoLoaded           = 5  ///< A gamecard has been inserted and all required basic information could be successfully retrieved from it.
+                                                        ///< Hash FS partition data is parsed in a deferred stage - use gamecardGetInfoLoadState() to check its availability.
 } GameCardStatus;
 
+/// Bitmask flags returned by gamecardGetInfoLoadState().
+/// Gamecard info is loaded in stages by the background detection thread, so listeners can render basic information while the rest is still being parsed.
+typedef enum {
+    GameCardInfoLoadState_None   = 0,       ///< No gamecard info is available.
+    GameCardInfoLoadState_Basic  = BIT(0),  ///< Header, decrypted CardInfo area, storage area sizes and capacity are available.
+    GameCardInfoLoadState_HashFs = BIT(1),  ///< Hash FS contexts for all gamecard partitions are available.
+
+    GameCardInfoLoadState_All    = (GameCardInfoLoadState_Basic | GameCardInfoLoadState_HashFs)
+} GameCardInfoLoadState;
+
 typedef enum {
     GameCardHashFileSystemPartitionType_None   = 0, ///< Not a real value.
     GameCardHashFileSystemPartitionType_Root   = 1,
@@ -290,9 +301,17 @@ void gamecardExit(void);
 /// If the gamecard interface hasn't been initialized, this returns NULL.
 UEvent *gamecardGetStatusChangeUserEvent(void);
 
+/// Returns true if the gamecard status has been updated by the background detection thread since the last time this function was called.
+/// Only reads an internal flag - no IPC calls are issued, making it suitable for cheap periodic polling.
+bool gamecardIsStatusUpdated(void);
+
 /// Returns the current GameCardStatus value.
 u8 gamecardGetStatus(void);
 
+/// Returns a bitmask of GameCardInfoLoadState values that reflects which gamecard info stages have been loaded so far.
+/// Only meaningful while the gamecard status is set to GameCardStatus_InsertedAndInfoLoaded.
+u8 gamecardGetInfoLoadState(void);
+
 /// Fills the provided GameCardSecurityInformation pointer.
 /// This area can't be read using gamecardReadStorage().
 bool gamecardGetSecurityInformation(GameCardSecurityInformation* out);
@@ -335,10 +354,12 @@ bool gamecardGetBundledFirmwareUpdateVersion(Version *out);
 
 /// Fills the provided HashFileSystemContext pointer using information from the requested Hash FS partition.
 /// Hash FS functions can be used on the retrieved HashFileSystemContext. hfsFreeContext() must be used to free the underlying data from the filled context.
+/// All Hash FS partitions are parsed once at gamecard insertion and kept cached until removal, so this call only duplicates in-memory data and never hits the storage medium.
 bool gamecardGetHashFileSystemContext(u8 hfs_partition_type, HashFileSystemContext *out);
 
 /// One-shot function to retrieve meaningful information from a Hash FS entry by name without using gamecardGetHashFileSystemContext() + Hash FS functions.
 /// 'out_offset' or 'out_size' may be set to NULL, but at least one of them must be a valid pointer. The returned offset is always relative to the start of the gamecard image.
+/// Just like gamecardGetHashFileSystemContext(), this is served from the Hash FS contexts cached at gamecard insertion.
 /// If you need to get entry information by index, just retrieve the Hash FS context for the target partition and use Hash FS functions on it.
 bool gamecardGetHashFileSystemEntryInfoByName(u8 hfs_partition_type, const char *entry_name, u64 *out_offset, u64 *out_size);
 
@@ -53,14 +53,26 @@ NXDT_ASSERT(HashFileSystemEntry, 0x40);
 /// Internally used by gamecard functions.
 /// Use gamecardGetHashFileSystemContext() to retrieve a Hash FS context.
 typedef struct {
-    u8 type;            ///< GameCardHashFileSystemPartitionType.
-    char *name;         ///< Dynamically allocated partition name.
-    u64 offset;         ///< Partition offset (relative to the start of gamecard image).
-    u64 size;           ///< Partition size.
-    u64 header_size;    ///< Full header size.
-    u8 *header;         ///< HashFileSystemHeader + (HashFileSystemEntry * entry_count) + Name Table.
+    u8 type;                ///< GameCardHashFileSystemPartitionType.
+    char *name;             ///< Dynamically allocated partition name.
+    u64 offset;             ///< Partition offset (relative to the start of gamecard image).
+    u64 size;               ///< Partition size.
+    u64 header_size;        ///< Full header size.
+    u8 *header;             ///< HashFileSystemHeader + (HashFileSystemEntry * entry_count) + Name Table.
+    u32 *name_lookup;       ///< Dynamically allocated open-addressing hash table over the name table. Each slot holds (entry index + 1); zero means empty. Built on the first name lookup.
+    u32 name_lookup_size;   ///< Slot count for 'name_lookup'. Always a power of two.
 } HashFileSystemContext;
 
+/// Used to perform a verified, sequential read of a Hash FS entry.
+/// The per-entry hashed region is checksummed incrementally while data is streamed out, removing the need for a separate verification pass over the entry.
+typedef struct {
+    HashFileSystemContext *hfs_ctx;     ///< Hash FS context the entry belongs to.
+    HashFileSystemEntry *fs_entry;      ///< Hash FS entry being read.
+    Sha256Context sha256_ctx;           ///< Incremental SHA-256 state for the hashed region.
+    u64 cur_offset;                     ///< Current sequential read offset within the entry.
+    bool hash_checked;                  ///< Set once the hashed region has been fully consumed and its checksum validated.
+} HashFileSystemVerifiedReadContext;
+
 /// Retrieves a Hash FS entry index by its name.
 bool hfsGetEntryIndexByName(HashFileSystemContext *ctx, const char *name, u32 *out_idx);
 
@@ -72,6 +84,13 @@ bool hfsReadPartitionData(HashFileSystemContext *ctx, void *out, u64 read_size,
 /// Input offset must be relative to the start of the Hash FS entry.
 bool hfsReadEntryData(HashFileSystemContext *ctx, HashFileSystemEntry *fs_entry, void *out, u64 read_size, u64 offset);
 
+/// Initializes a verified read context for the provided Hash FS entry.
+bool hfsInitializeVerifiedEntryRead(HashFileSystemVerifiedReadContext *out, HashFileSystemContext *hfs_ctx, HashFileSystemEntry *fs_entry);
+
+/// Reads data from a Hash FS entry using a previously initialized verified read context, hashing the per-entry hash target region on the fly.
+/// Reads are strictly sequential, starting at the beginning of the entry. Fails if the calculated checksum doesn't match the one from the Hash FS entry.
+bool hfsReadVerifiedEntryData(HashFileSystemVerifiedReadContext *ctx, void *out, u64 read_size);
+
 /// Calculates the extracted Hash FS size.
 bool hfsGetTotalDataSize(HashFileSystemContext *ctx, u64 *out_size);
 
@@ -82,6 +101,7 @@ NX_INLINE void hfsFreeContext(HashFileSystemContext *ctx)
     if (!ctx) return;
     if (ctx->name) free(ctx->name);
     if (ctx->header) free(ctx->header);
+    if (ctx->name_lookup) free(ctx->name_lookup);
     memset(ctx, 0, sizeof(HashFileSystemContext));
 }
 
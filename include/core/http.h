@@ -38,8 +38,9 @@ typedef curl_xferinfo_callback HttpProgressCallback;
 
 /// Used by httpWriteBufferCallback().
 typedef struct {
-    char *data;     ///< Dynamically allocated buffer.
-    size_t size;    ///< Buffer size.
+    char *data;         ///< Dynamically allocated buffer.
+    size_t size;        ///< Number of bytes written to the buffer.
+    size_t capacity;    ///< Allocated buffer size. Always greater than or equal to 'size'.
 } HttpBuffer;
 
 /// Initializes the HTTP client interface.
@@ -53,15 +54,22 @@ void httpExit(void);
 size_t httpWriteFileCallback(char *buffer, size_t size, size_t nitems, void *outstream);
 
 /// Writes downloaded data to an output buffer. May be used as the write callback for httpPerformGetRequest().
-/// Expects 'outstream' / 'write_ptr' to be a pointer to a HttpBuffer element. Its 'data' member is reallocated throughout the download process.
+/// Expects 'outstream' / 'write_ptr' to be a pointer to a HttpBuffer element. Its 'data' member is grown geometrically throughout the download process.
 size_t httpWriteBufferCallback(char *buffer, size_t size, size_t nitems, void *outstream);
 
 /// Performs a HTTP GET request. Blocks the calling thread until the whole transfer is complete.
+/// Thread-safe: each call gets its own CURL easy handle, so requests issued from different threads overlap instead of serializing.
 /// Callbacks are optional, but they should be provided to save downloaded data and/or handle progress updates.
 /// If 'outsize' is provided, the download size will be stored in it if the request succeeds.
 bool httpPerformGetRequest(const char *url, bool force_https, size_t *outsize, HttpWriteCallback write_cb, void *write_ptr, HttpProgressCallback progress_cb, void *progress_ptr);
 
+/// Performs a HTTP HEAD request to retrieve the download size for the provided URL, without downloading any actual data.
+/// Returns false if the request fails or if the server doesn't provide a usable content length.
+bool httpGetDownloadSize(const char *url, bool force_https, u64 *out_size);
+
 /// Wrapper for httpPerformGetRequest() + httpWriteFileCallback() that opens/closes the output file on its own.
+/// Downloads bigger than HTTP_RANGED_MIN_SIZE with a known size are fetched through parallel HTTP range requests, which work around per-connection bandwidth throttling.
+/// A single connection download is carried out if the download size can't be determined beforehand or if the server doesn't honor range requests.
 /// Returns false if the request fails.
 bool httpDownloadFile(const char *path, const char *url, bool force_https, HttpProgressCallback progress_cb, void *progress_ptr);
 
@@ -70,6 +78,13 @@ bool httpDownloadFile(const char *path, const char *url, bool force_https, HttpP
 /// Providing 'outsize' is mandatory. Returns NULL if the request fails.
 char *httpDownloadData(size_t *outsize, const char *url, bool force_https, HttpProgressCallback progress_cb, void *progress_ptr);
 
+/// Variant of httpDownloadData() backed by an on-disk cache file at 'cache_path'.
+/// ETag / Last-Modified validators from previous downloads are stored in the cache file alongside the downloaded data, and turn subsequent downloads into conditional requests.
+/// If the server replies with 304 Not Modified, the cached copy is returned for the cost of a single header round-trip. Fresh data updates the cache file.
+/// Returns a pointer to a dynamically allocated buffer that holds the downloaded data, which must be freed by the user. This buffer is not NULL terminated.
+/// Providing 'outsize' is mandatory. Returns NULL if the request fails.
+char *httpDownloadDataCached(size_t *outsize, const char *url, bool force_https, const char *cache_path, HttpProgressCallback progress_cb, void *progress_ptr);
+
 #ifdef __cplusplus
 }
 #endif
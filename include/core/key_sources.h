@@ -165,6 +165,16 @@ static const u8 g_ncaKeyAreaEncryptionKeySources[NcaKeyAreaEncryptionKeyIndex_Co
     { 0x87, 0x45, 0xF1, 0xBB, 0xA6, 0xBE, 0x79, 0x64, 0x7D, 0x04, 0x8B, 0xA6, 0x7B, 0x5F, 0xDA, 0x4A }  ///< System.
 };
 
+/* Randomly generated KEK source used to derive the console-unique key that encrypts the on-SD keyset cache. Application-specific data - not tied to any official keydata. */
+static const u8 g_keysetCacheKekSource[AES_128_KEY_SIZE] = {
+    0x8B, 0x4A, 0xF0, 0x1E, 0x6D, 0x29, 0xC5, 0x77, 0x3A, 0x91, 0x5C, 0xE8, 0x02, 0xBD, 0x64, 0xD3
+};
+
+/* Randomly generated key source used to derive the console-unique key that encrypts the on-SD keyset cache. Application-specific data - not tied to any official keydata. */
+static const u8 g_keysetCacheKeySource[AES_128_KEY_SIZE] = {
+    0x2F, 0xA6, 0x58, 0xC1, 0x97, 0x0B, 0xE3, 0x4D, 0xD9, 0x12, 0x7E, 0x85, 0x36, 0xFA, 0xC0, 0x69
+};
+
 #ifdef __cplusplus
 }
 #endif
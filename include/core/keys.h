@@ -31,6 +31,7 @@ extern "C" {
 #endif
 
 /// Loads (and derives) keydata from sysmodule program memory, the Lockpick_RCM keys file and hardcoded/obfuscated information.
+/// Derived keydata is cached on the SD card in encrypted form - launches after the first one load it directly from there, falling back to a full derivation if the cache is stale or unusable.
 /// Must be called (and succeed) before calling any of the functions below.
 bool keysLoadKeyset(void);
 
@@ -30,20 +30,31 @@
 extern "C" {
 #endif
 
+/// Documents bigger than this size aren't materialized in memory - their data must be streamed via legalInfoReadAuthoringToolXml().
+#define LEGAL_INFO_XML_MAX_BUFFER_SIZE  0x100000    /* 1 MiB. */
+
 typedef struct {
-    NcaContext *nca_ctx;            ///< Pointer to the NCA context for the LegalInformation NCA from which XML data is retrieved.
-    char *authoring_tool_xml;       ///< Pointer to a dynamically allocated, NULL-terminated buffer that holds AuthoringTool-like XML data.
-    u64 authoring_tool_xml_size;    ///< Size for the AuthoringTool-like XML. This is essentially the same as using strlen() on 'authoring_tool_xml'.
+    NcaContext *nca_ctx;                ///< Pointer to the NCA context for the LegalInformation NCA from which XML data is retrieved.
+    RomFileSystemContext romfs_ctx;     ///< RomFS context for the LegalInformation NCA. Kept initialized for the whole context lifetime so XML data can be streamed in chunks.
+    RomFileSystemFileEntry *xml_entry;  ///< RomFS file entry for "legalinfo.xml". Points to data from 'romfs_ctx'.
+    char *authoring_tool_xml;           ///< Pointer to a dynamically allocated, NULL-terminated buffer that holds AuthoringTool-like XML data.
+                                        ///< Set to NULL for documents bigger than LEGAL_INFO_XML_MAX_BUFFER_SIZE - use legalInfoReadAuthoringToolXml() to stream their data instead.
+    u64 authoring_tool_xml_size;        ///< Size for the AuthoringTool-like XML. This is essentially the same as using strlen() on 'authoring_tool_xml'.
 } LegalInfoContext;
 
 /// Initializes a LegalInfoContext using a previously initialized NcaContext (which must belong to a LegalInformation NCA).
 bool legalInfoInitializeContext(LegalInfoContext *out, NcaContext *nca_ctx);
 
+/// Reads a chunk of AuthoringTool-like XML data from a previously initialized LegalInfoContext into the provided buffer.
+/// Serves the read from memory for small documents, or straight from the underlying RomFS for documents too big to be materialized.
+bool legalInfoReadAuthoringToolXml(LegalInfoContext *legal_info_ctx, void *out, u64 read_size, u64 offset);
+
 /// Helper inline functions.
 
 NX_INLINE void legalInfoFreeContext(LegalInfoContext *legal_info_ctx)
 {
     if (!legal_info_ctx) return;
+    romfsFreeContext(&(legal_info_ctx->romfs_ctx));
     if (legal_info_ctx->authoring_tool_xml) free(legal_info_ctx->authoring_tool_xml);
     memset(legal_info_ctx, 0, sizeof(LegalInfoContext));
 }
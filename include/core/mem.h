@@ -42,6 +42,12 @@ typedef struct {
     u64 data_size;
 } MemoryLocation;
 
+/// Callback definition for the memSearch*() functions. Called for each memory window streamed from the target program.
+/// 'window' / 'window_size' hold the current window data, while 'window_offset' holds the offset of the first window byte relative to the start of the streamed memory range.
+/// Shall return true to stop the search (match found), or false to keep going.
+/// The callback must not use any of the LOG_*() macros - the logfile mutex is held for the whole duration of the search whenever the target program is the FS sysmodule.
+typedef bool (*MemoryWindowSearchFunc)(const u8 *window, u64 window_size, u64 window_offset, void *userdata);
+
 /// Retrieves memory segment (.text, .rodata, .data) data from a running program.
 /// These are memory pages with read permission (Perm_R) enabled and type MemType_CodeStatic or MemType_CodeMutable.
 bool memRetrieveProgramMemorySegment(MemoryLocation *location);
@@ -51,6 +57,15 @@ bool memRetrieveProgramMemorySegment(MemoryLocation *location);
 /// MemType_Unmapped, MemType_Io, MemType_ThreadLocal and MemType_Reserved memory pages are excluded if FS program memory is being retrieved, in order to avoid hangs.
 bool memRetrieveFullProgramMemory(MemoryLocation *location);
 
+/// Works like memRetrieveProgramMemorySegment(), but instead of copying the whole memory range into a single heap buffer, it streams fixed-size windows into a small
+/// reusable buffer and runs the provided callback on each one, stopping at the first match. The 'data' / 'data_size' members from the provided MemoryLocation element are never populated.
+/// Consecutive windows overlap by 'overlap_size' bytes, which callers should set to the size of the longest pattern they look for minus one, so matches crossing window boundaries aren't missed.
+/// Returns true if the callback reported a match.
+bool memSearchProgramMemorySegment(MemoryLocation *location, u64 overlap_size, MemoryWindowSearchFunc search_func, void *userdata);
+
+/// Same as memSearchProgramMemorySegment(), but streams the same memory ranges memRetrieveFullProgramMemory() would retrieve.
+bool memSearchFullProgramMemory(MemoryLocation *location, u64 overlap_size, MemoryWindowSearchFunc search_func, void *userdata);
+
 /// Frees a populated MemoryLocation element.
 NX_INLINE void memFreeMemoryLocation(MemoryLocation *location)
 {
@@ -416,7 +416,7 @@ NXDT_ASSERT(_NacpStruct, 0x4000);
 typedef struct {
     u8 language;    ///< NacpLanguage.
     u64 icon_size;  ///< JPG icon size. Must not exceed NACP_MAX_ICON_SIZE.
-    u8 *icon_data;  ///< Pointer to a dynamically allocated buffer that holds the JPG icon data.
+    u8 *icon_data;  ///< Pointer to a dynamically allocated buffer that holds the JPG icon data. NULL until the icon data is loaded via nacpLoadIconData().
 } NacpIconContext;
 
 typedef struct {
@@ -436,8 +436,16 @@ typedef struct {
 } NacpContext;
 
 /// Initializes a NacpContext using a previously initialized NcaContext (which must belong to a Control NCA).
+/// Icon contexts are enumerated and validated, but their JPG data isn't read - use nacpLoadIconData() / nacpPrefetchIconData() for that.
 bool nacpInitializeContext(NacpContext *out, NcaContext *nca_ctx);
 
+/// Loads JPG icon data for a single icon context from a previously initialized NacpContext. No-op if the icon data has already been loaded.
+bool nacpLoadIconData(NacpContext *nacp_ctx, NacpIconContext *icon_ctx);
+
+/// Loads JPG icon data for every icon context from a previously initialized NacpContext.
+/// Prefetch hint for flows that know they'll need all icons. nacpGenerateAuthoringToolXml() calls this on its own, since icon hashes are part of the generated XML.
+bool nacpPrefetchIconData(NacpContext *nacp_ctx);
+
 /// Changes flags in the NACP from the input NacpContext and generates a RomFS file entry patch if needed.
 /// If 'patch_sua' is true, StartupUserAccount is set to None, the IsOptional bit in StartupUserAccountOption is cleared and UserAccountSwitchLock is set to Disable.
 /// If 'patch_screenshot' is true, Screenshot is set to Allow.
@@ -515,7 +523,8 @@ NX_INLINE void nacpFreeContext(NacpContext *nacp_ctx)
 
 NX_INLINE bool nacpIsValidIconContext(NacpIconContext *icon_ctx)
 {
-    return (icon_ctx && icon_ctx->language < NacpLanguage_Count && icon_ctx->icon_size && icon_ctx->icon_data);
+    /* Don't require icon data to be present - it's loaded lazily via nacpLoadIconData(). */
+    return (icon_ctx && icon_ctx->language < NacpLanguage_Count && icon_ctx->icon_size);
 }
 
 NX_INLINE bool nacpIsValidContext(NacpContext *nacp_ctx)
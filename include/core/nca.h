@@ -58,6 +58,9 @@ extern "C" {
 
 #define NCA_AES_XTS_SECTOR_SIZE                     0x200
 
+#define NCA_FS_SECTION_CACHE_BLOCK_SIZE             0x4000                      /* 16 KiB. Size of each decrypted data cache block within NcaFsSectionContext. */
+#define NCA_FS_SECTION_CACHE_BLOCK_COUNT            2                           /* Number of decrypted data cache blocks within NcaFsSectionContext. */
+
 #define NCA_SIGNATURE_AREA_SIZE                     0x200                       /* Signature is calculated starting at the NCA header magic word. */
 
 typedef enum {
@@ -402,6 +405,20 @@ typedef struct {
     Aes128XtsContext xts_decrypt_ctx;   ///< Used internally by NCA functions to perform AES-128-XTS decryption.
     Aes128XtsContext xts_encrypt_ctx;   ///< Used internally by NCA functions to perform AES-128-XTS encryption.
 
+    ///< Decrypted data cache. Used internally by ncaReadFsSection() to avoid re-decrypting frequently accessed blocks (e.g. RomFS / Partition FS entry tables) on small, repeated reads.
+    struct {
+        u64 offset;                                 ///< Section-relative offset for this cache block. Aligned to NCA_FS_SECTION_CACHE_BLOCK_SIZE.
+        u64 size;                                   ///< Amount of decrypted data held by this cache block.
+        u64 lru_counter;                            ///< Used to determine the least recently used cache block.
+        u8 data[NCA_FS_SECTION_CACHE_BLOCK_SIZE];   ///< Decrypted data.
+    } read_cache[NCA_FS_SECTION_CACHE_BLOCK_COUNT];
+    u8 read_cache_count;                            ///< Number of valid cache blocks within 'read_cache'.
+    u64 read_cache_lru_counter;                     ///< Incremented on every cache block access.
+
+    ///< Thread safety.
+    Mutex read_mtx;                     ///< Serializes read / patch generation operations against this FS section. They mutate shared per-section state (AES-128-CTR IV, sparse layer \
+                                        ///< virtual offset, decrypted data cache), so concurrent callers must take turns.
+
     ///< NSP-related fields.
     bool header_written;                ///< Set to true after this FS section header has been written to an output dump.
 } NcaFsSectionContext;
@@ -441,7 +458,7 @@ struct _NcaContext {
     u32 title_version;
     bool rights_id_available;
     bool titlekey_retrieved;
-    bool valid_main_signature;
+    bool valid_main_signature;                          ///< Filled asynchronously by the RSA worker thread. Only safe to read after calling rsa2048WaitForQueuedPssVerifications().
     u8 titlekey[AES_128_KEY_SIZE];                      ///< Decrypted titlekey from the ticket.
     NcaHeader header;                                   ///< Plaintext NCA header.
     u8 header_hash[SHA256_HASH_SIZE];                   ///< Plaintext NCA header hash. Used to determine if it's necessary to replace the NCA header while dumping this NCA.
@@ -452,6 +469,8 @@ struct _NcaContext {
 
     ///< NSP-related fields.
     bool header_written;                                ///< Set to true after the NCA header and the FS section headers have been written to an output dump.
+    u8 dirty_header_sectors;                            ///< Bitmap of modified AES-XTS sectors within the NCA header area. Bits 0-1 map to the NCA header, while bit (2 + i) maps to FS section header 'i'.
+                                                        ///< Updated by ncaEncryptHeader(). Used by ncaWriteEncryptedHeaderDataToMemoryBuffer() to only overwrite sectors that were actually modified.
     void *content_type_ctx;                             ///< Pointer to a content type context (e.g. ContentMetaContext, ProgramInfoContext, NacpContext, LegalInfoContext). Set to NULL if unused.
     bool content_type_ctx_patch;                        ///< Set to true if a NCA patch generated by the content type context is needed and hasn't been completely written yet.
     u32 content_type_ctx_data_idx;                      ///< Start index for the data generated by the content type context. Used while creating NSPs.
@@ -477,11 +496,24 @@ typedef struct {
     NcaHashDataPatch hash_level_patch[NCA_IVFC_LEVEL_COUNT];
 } NcaHierarchicalIntegrityPatch;
 
-/// Functions to control the internal heap buffer used by NCA FS section crypto operations.
+/// Functions to control the internal heap buffer pool used by NCA FS section crypto operations.
+/// Buffers are handed out per-thread on demand, which makes it possible to process multiple NCAs concurrently.
 /// Must be called at startup.
 bool ncaAllocateCryptoBuffer(void);
 void ncaFreeCryptoBuffer(void);
 
+/// Allocates a zeroed block holding 'count' contiguous NCA contexts, reusing a block from the internal context pool whenever possible.
+/// NcaContext is a large structure, so pool reuse keeps batch operations over many contents from churning and fragmenting the heap - particularly under applet mode.
+/// Returns NULL if 'count' is zero or if no memory is available.
+NcaContext *ncaAllocateContexts(u32 count);
+
+/// Returns a context block retrieved via ncaAllocateContexts() to the internal context pool, or to the heap if every pool slot is taken.
+/// 'count' must match the value passed to the matching ncaAllocateContexts() call.
+void ncaFreeContexts(NcaContext *ctx, u32 count);
+
+/// Frees every context block held by the internal context pool. Must be called at exit.
+void ncaFreeContextPool(void);
+
 /// Initializes a NCA context.
 /// If 'storage_id' == NcmStorageId_GameCard, the 'hfs_partition_type' argument must be a valid GameCardHashFileSystemPartitionType value.
 /// If the NCA holds a populated Rights ID field, ticket data will need to be retrieved.
@@ -490,6 +522,42 @@ void ncaFreeCryptoBuffer(void);
 /// If ticket data can't be retrieved, the context will still be initialized, but anything that involves working with encrypted NCA FS section blocks won't be possible (e.g. ncaReadFsSection()).
 bool ncaInitializeContext(NcaContext *out, u8 storage_id, u8 hfs_partition_type, const NcmContentInfo *content_info, u32 title_version, Ticket *tik);
 
+/// Used by ncaInitializeContextBatch() to initialize multiple NCA contexts at once.
+typedef struct {
+    NcaContext *nca_ctx;                    ///< Output NCA context. Must point to a valid NcaContext element that isn't shared with any other batch entry.
+    u8 storage_id;                          ///< NcmStorageId.
+    u8 hfs_partition_type;                  ///< GameCardHashFileSystemPartitionType. Only used if 'storage_id' == NcmStorageId_GameCard.
+    const NcmContentInfo *content_info;     ///< Info for the content to initialize a NCA context for.
+    u32 title_version;                      ///< Title version.
+    Ticket *tik;                            ///< Optional - may be NULL. Must not be shared with any other batch entry.
+    bool success;                           ///< Output field. Set to true if this NCA context was successfully initialized.
+} NcaContextBatchEntry;
+
+/// Initializes multiple NCA contexts at once, fanning the work out across worker threads - the calling thread chips in as well.
+/// Each entry behaves exactly like a standalone ncaInitializeContext() call, with its result written to the 'success' member.
+/// The worker thread count is capped by the NCA crypto buffer pool size. Returns true if every entry was successfully initialized.
+bool ncaInitializeContextBatch(NcaContextBatchEntry *entries, u32 entry_count);
+
+/// Verifies the hierarchical hash tree from an initialized NCA FS section context by walking every hash layer against the layer that precedes it.
+/// Both HierarchicalSha256 regions and HierarchicalIntegrity (IVFC) levels are supported, including their SHA3-256 variants.
+/// Patch RomFS sections and sections without a hash tree are skipped (returns true) - their data can't be checked against the section header on its own.
+/// No output data is generated: section data is read, hashed and discarded in fixed-size chunks.
+bool ncaVerifyFsSectionHashTree(NcaFsSectionContext *ctx);
+
+/// Verifies every enabled FS section from the provided NCA context using ncaVerifyFsSectionHashTree(). Returns true only if all of them pass.
+bool ncaVerifyContext(NcaContext *ctx);
+
+/// Used by ncaVerifyContextBatch() to verify multiple NCA contexts at once.
+typedef struct {
+    NcaContext *nca_ctx;    ///< NCA context to verify. Must have been previously initialized and must not be shared with any other batch entry.
+    bool success;           ///< Output field. Set to true if every enabled FS section from this NCA context passed hash tree verification.
+} NcaVerifyBatchEntry;
+
+/// Verifies multiple NCA contexts at once, fanning the work out across hash worker threads - the calling thread chips in as well.
+/// Each entry behaves exactly like a standalone ncaVerifyContext() call, with its result written to the 'success' member.
+/// The worker thread count is capped by the NCA crypto buffer pool size. Returns true if every entry passed verification.
+bool ncaVerifyContextBatch(NcaVerifyBatchEntry *entries, u32 entry_count);
+
 /// Reads raw encrypted data from a NCA using an input context, previously initialized by ncaInitializeContext().
 /// Input offset must be relative to the start of the NCA content file.
 bool ncaReadContentFile(NcaContext *ctx, void *out, u64 read_size, u64 offset);
@@ -540,12 +608,14 @@ bool ncaRemoveTitleKeyCrypto(NcaContext *ctx);
 /// Encrypts NCA header and NCA FS headers.
 /// The 'encrypted_header' member from the NCA context and its underlying NCA FS section contexts is updated by this function.
 /// Internally uses ncaIsHeaderDirty() to determine if NCA header / NCA FS section header re-encryption is needed.
+/// The 'dirty_header_sectors' member from the NCA context is updated as well by comparing old and new ciphertext on a per-sector basis.
 bool ncaEncryptHeader(NcaContext *ctx);
 
 /// Used to replace the NCA header and the NCA FS section headers while writing a NCA if they were modified in any way.
 /// Overwrites block(s) from a buffer holding raw NCA data using a previously initialized NcaContext.
 /// 'buf_offset' must hold the raw NCA offset where the data stored in 'buf' was read from.
 /// Bear in mind this function doesn't call ncaIsHeaderDirty() on its own to avoid taking up too much execution time, so it will attempt to overwrite data even if it isn't needed.
+/// Only header sectors flagged in the 'dirty_header_sectors' bitmap - populated by ncaEncryptHeader() - are actually overwritten.
 void ncaWriteEncryptedHeaderDataToMemoryBuffer(NcaContext *ctx, void *buf, u64 buf_size, u64 buf_offset);
 
 /// Updates the content ID and hash from a NCA context using a provided SHA-256 checksum.
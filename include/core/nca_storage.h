@@ -66,6 +66,10 @@ bool ncaStorageRead(NcaStorageContext *ctx, void *out, u64 read_size, u64 offset
 /// Checks if the provided block extents are within the provided Patch NcaStorageContext's Indirect Storage.
 bool ncaStorageIsBlockWithinPatchStorageRange(NcaStorageContext *ctx, u64 offset, u64 size, bool *out);
 
+/// Classifies multiple block extents against the provided Patch NcaStorageContext's Indirect Storage, updating the 'updated' flag from each BucketTreeBlockClassification element.
+/// The provided blocks must be sorted by offset in ascending order.
+bool ncaStorageClassifyBlocksWithinPatchStorageRange(NcaStorageContext *ctx, BucketTreeBlockClassification *blocks, u32 block_count);
+
 /// Frees a previously initialized NCA storage context.
 void ncaStorageFreeContext(NcaStorageContext *ctx);
 
@@ -0,0 +1,55 @@
+/*
+ * nxdt_datfile.h
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __NXDT_DATFILE_H__
+#define __NXDT_DATFILE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Initializes the datfile interface.
+/// Loads a No-Intro datfile from NOINTRO_DAT_PATH into a checksum-indexed lookup table.
+/// The datfile XML is only parsed the very first time it's seen: the generated table is saved to NOINTRO_DAT_CACHE_PATH as a sorted binary index, \
+/// which is loaded as-is on subsequent calls (and rebuilt whenever the datfile size changes).
+/// Returns false if no datfile is available or if an error occurs.
+bool datfileInitialize(void);
+
+/// Closes the datfile interface.
+void datfileExit(void);
+
+/// Returns the number of entries held by the loaded lookup table, or 0 if the datfile interface hasn't been initialized.
+u32 datfileGetEntryCount(void);
+
+/// Looks up the provided CRC32 checksum in the loaded lookup table.
+/// If 'size' is non-zero, only entries matching both the checksum and the provided size, in bytes, are considered.
+/// If a match is found and 'out_name' is provided, it will be updated to point to the release name from the matched entry.
+/// The returned string is only guaranteed to remain valid until datfileExit() is called.
+/// Returns false if no match is found or if the datfile interface hasn't been initialized.
+bool datfileLookupCrc32(u32 crc, u64 size, const char **out_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NXDT_DATFILE_H__ */
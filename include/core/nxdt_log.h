@@ -40,6 +40,19 @@ extern "C" {
 /// If a value lower than LOG_LEVEL_DEBUG or equal to/greater than LOG_LEVEL_NONE is used, logfile output will be entirely disabled.
 #define LOG_LEVEL           LOG_LEVEL_DEBUG /* TODO: change before release (warning?). */
 
+/// Per-module log level override. A translation unit may define this macro before including this header to strip its own
+/// LOG_MSG/LOG_DATA calls below the provided level at compile time, without affecting the rest of the application.
+/// Hot dump-path modules honor the LOG_MODULE_LEVEL_HOT build flag this way - see the LOG_FLAVOR variable in the Makefile.
+#ifndef LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL    LOG_LEVEL
+#endif
+
+/// Messages below the global log level are rejected at runtime anyway, so a lower per-module level is simply clamped.
+#if LOG_MODULE_LEVEL < LOG_LEVEL
+#undef LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL    LOG_LEVEL
+#endif
+
 #if (LOG_LEVEL >= LOG_LEVEL_DEBUG) && (LOG_LEVEL < LOG_LEVEL_NONE)
 
 /// Helper macros.
@@ -48,7 +61,7 @@ extern "C" {
 #define LOG_MSG_BUF_GENERIC(dst, dst_size, level, fmt, ...) logWriteFormattedStringToBuffer(dst, dst_size, level, __FILENAME__, __LINE__, __func__, fmt, ##__VA_ARGS__)
 #define LOG_DATA_GENERIC(data, data_size, level, fmt, ...)  logWriteBinaryDataToLogFile(data, data_size, level, __FILENAME__, __LINE__, __func__, fmt, ##__VA_ARGS__)
 
-#if LOG_LEVEL == LOG_LEVEL_DEBUG
+#if LOG_MODULE_LEVEL == LOG_LEVEL_DEBUG
 #define LOG_MSG_DEBUG(fmt, ...)                             LOG_MSG_GENERIC(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
 #define LOG_MSG_BUF_DEBUG(dst, dst_size, fmt, ...)          LOG_MSG_BUF_GENERIC(dst, dst_size, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
 #define LOG_DATA_DEBUG(data, data_size, fmt, ...)           LOG_DATA_GENERIC(data, data_size, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
@@ -56,9 +69,9 @@ extern "C" {
 #define LOG_MSG_DEBUG(fmt, ...)                             do {} while(0)
 #define LOG_MSG_BUF_DEBUG(dst, dst_size, fmt, ...)          do {} while(0)
 #define LOG_DATA_DEBUG(data, data_size, fmt, ...)           do {} while(0)
-#endif  /* LOG_LEVEL == LOG_LEVEL_DEBUG */
+#endif  /* LOG_MODULE_LEVEL == LOG_LEVEL_DEBUG */
 
-#if LOG_LEVEL <= LOG_LEVEL_INFO
+#if LOG_MODULE_LEVEL <= LOG_LEVEL_INFO
 #define LOG_MSG_INFO(fmt, ...)                              LOG_MSG_GENERIC(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
 #define LOG_MSG_BUF_INFO(dst, dst_size, fmt, ...)           LOG_MSG_BUF_GENERIC(dst, dst_size, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
 #define LOG_DATA_INFO(data, data_size, fmt, ...)            LOG_DATA_GENERIC(data, data_size, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
@@ -66,9 +79,9 @@ extern "C" {
 #define LOG_MSG_INFO(fmt, ...)                              do {} while(0)
 #define LOG_MSG_BUF_INFO(dst, dst_size, fmt, ...)           do {} while(0)
 #define LOG_DATA_INFO(data, data_size, fmt, ...)            do {} while(0)
-#endif  /* LOG_LEVEL <= LOG_LEVEL_INFO */
+#endif  /* LOG_MODULE_LEVEL <= LOG_LEVEL_INFO */
 
-#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#if LOG_MODULE_LEVEL <= LOG_LEVEL_WARNING
 #define LOG_MSG_WARNING(fmt, ...)                           LOG_MSG_GENERIC(LOG_LEVEL_WARNING, fmt, ##__VA_ARGS__)
 #define LOG_MSG_BUF_WARNING(dst, dst_size, fmt, ...)        LOG_MSG_BUF_GENERIC(dst, dst_size, LOG_LEVEL_WARNING, fmt, ##__VA_ARGS__)
 #define LOG_DATA_WARNING(data, data_size, fmt, ...)         LOG_DATA_GENERIC(data, data_size, LOG_LEVEL_WARNING, fmt, ##__VA_ARGS__)
@@ -76,9 +89,9 @@ extern "C" {
 #define LOG_MSG_WARNING(fmt, ...)                           do {} while(0)
 #define LOG_MSG_BUF_WARNING(dst, dst_size, fmt, ...)        do {} while(0)
 #define LOG_DATA_WARNING(data, data_size, fmt, ...)         do {} while(0)
-#endif  /* LOG_LEVEL <= LOG_LEVEL_WARNING */
+#endif  /* LOG_MODULE_LEVEL <= LOG_LEVEL_WARNING */
 
-#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#if LOG_MODULE_LEVEL <= LOG_LEVEL_ERROR
 #define LOG_MSG_ERROR(fmt, ...)                             LOG_MSG_GENERIC(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
 #define LOG_MSG_BUF_ERROR(dst, dst_size, fmt, ...)          LOG_MSG_BUF_GENERIC(dst, dst_size, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
 #define LOG_DATA_ERROR(data, data_size, fmt, ...)           LOG_DATA_GENERIC(data, data_size, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
@@ -86,7 +99,7 @@ extern "C" {
 #define LOG_MSG_ERROR(fmt, ...)                             do {} while(0)
 #define LOG_MSG_BUF_ERROR(dst, dst_size, fmt, ...)          do {} while(0)
 #define LOG_DATA_ERROR(data, data_size, fmt, ...)           do {} while(0)
-#endif  /* LOG_LEVEL <= LOG_LEVEL_ERROR */
+#endif  /* LOG_MODULE_LEVEL <= LOG_LEVEL_ERROR */
 
 /// Writes the provided string to the logfile.
 /// If the logfile hasn't been created and/or opened, this function takes care of it.
@@ -117,6 +130,38 @@ void logGetLastMessage(char *dst, size_t dst_size);
 /// Use with caution.
 void logControlMutex(bool lock);
 
+/// Chrome-trace sink. Generates a JSON timeline compatible with chrome://tracing and Perfetto, used to visualize dump pipeline activity.
+/// Trace data is kept in a dedicated file and buffer, so instrumented threads never contend with regular logfile writers.
+/// Event names must not hold JSON special characters - they're copied verbatim into the timeline.
+
+/// Opens the trace file and writes the timeline header. Any trace file from a previous session is overwritten.
+bool logOpenTraceFile(void);
+
+/// Writes a thread name metadata event to the trace timeline. Used to label a timeline lane (e.g. "read", "hash").
+void logWriteTraceThreadName(u32 tid, const char *name);
+
+/// Writes a complete duration event to the trace timeline. Timestamps are expressed in nanoseconds (e.g. armTicksToNs() output).
+void logWriteTraceDurationEvent(const char *name, u32 tid, u64 start_ns, u64 duration_ns);
+
+/// Writes a counter event to the trace timeline (e.g. ring buffer queue depth).
+void logWriteTraceCounterEvent(const char *name, u64 timestamp_ns, u64 value);
+
+/// Writes any buffered trace data, terminates the JSON timeline and closes the trace file. No-op if the trace file hasn't been opened.
+void logCloseTraceFile(void);
+
+/// Crash report sink. Reserves a preopened file handle at startup so the exception handler can persist crash reports without performing
+/// any heap allocations or filesystem metadata operations at exception time.
+
+/// Creates and opens the crash report file. Called once at startup. Any crash report from a previous session is overwritten.
+bool logOpenCrashReportFile(void);
+
+/// Writes the provided string to the preopened crash report file and flushes it right away. No-op if the file hasn't been opened.
+/// Unlike logWriteStringToLogFile(), this function never allocates memory and never attempts to open the file on its own.
+void logWriteCrashReportString(const char *str);
+
+/// Closes the crash report file. The file is deleted if no crash report was written during the current session.
+void logCloseCrashReportFile(void);
+
 #else   /* (LOG_LEVEL >= LOG_LEVEL_DEBUG) && (LOG_LEVEL < LOG_LEVEL_NONE) */
 
 /// Helper macros.
@@ -84,6 +84,14 @@ FsFileSystem *utilsGetSdCardFileSystemObject(void);
 /// Must be used after closing a file handle from the SD card.
 bool utilsCommitSdCardFileSystemChanges(void);
 
+/// Schedules a deferred SD card filesystem commit covering 'size' bytes of freshly written data.
+/// The commit is carried out right away if too much time has passed since the last one or if too much scheduled data has piled up - otherwise it's batched with later requests.
+/// Write-heavy flows that close many small files should use this instead of utilsCommitSdCardFileSystemChanges(), then force a flush at their own checkpoints / exit paths.
+bool utilsScheduleSdCardFileSystemCommit(u64 size);
+
+/// Immediately commits any data previously scheduled through utilsScheduleSdCardFileSystemCommit(). No-op if nothing is pending.
+bool utilsFlushScheduledSdCardFileSystemCommits(void);
+
 /// Returns a UtilsCustomFirmwareType value.
 u8 utilsGetCustomFirmwareType(void);
 
@@ -96,6 +104,14 @@ bool utilsIsDevelopmentUnit(void);
 /// Returns true if the application is running under applet mode.
 bool utilsIsAppletMode(void);
 
+/// Returns the amount of heap memory currently available to the application, in bytes.
+u64 utilsGetFreeHeapSize(void);
+
+/// Returns a budgeted dump buffer size for a pool of 'buffer_count' equally sized buffers.
+/// Under title override mode, this always returns USB_TRANSFER_BUFFER_SIZE. Under applet mode, where the available heap shrinks drastically, the returned size is halved until the whole
+/// pool fits within the available heap while leaving a reserve for NCA crypto buffers and other runtime allocations - degrading dump performance gracefully instead of failing outright.
+u64 utilsGetDumpBlockSize(u32 buffer_count);
+
 /// Returns a pointer to the FsStorage object for the eMMC BIS System partition.
 FsStorage *utilsGetEmmcBisSystemPartitionStorage(void);
 
@@ -104,6 +120,9 @@ FsStorage *utilsGetEmmcBisSystemPartitionStorage(void);
 /// If state is set to false, regular system behavior is restored.
 void utilsSetLongRunningProcessState(bool state);
 
+/// Returns true if a long-running process is currently active.
+bool utilsGetLongRunningProcessState(void);
+
 /// Thread management functions.
 bool utilsCreateThread(Thread *out_thread, ThreadFunc func, void *arg, int cpu_id);
 void utilsJoinThread(Thread *thread);
@@ -112,6 +131,26 @@ void utilsJoinThread(Thread *thread);
 /// If the buffer isn't big enough to hold both its current contents and the new formatted string, it will be resized.
 __attribute__((format(printf, 3, 4))) bool utilsAppendFormattedStringToBuffer(char **dst, size_t *dst_size, const char *fmt, ...);
 
+/// Arena-backed string builder. Zero-initialize before use.
+/// Unlike utilsAppendFormattedStringToBuffer(), the arena grows geometrically and the current string length is tracked explicitly, \
+/// so building a big document out of thousands of small appends doesn't degenerate into constant reallocation and repeated full-string scans.
+typedef struct {
+    char *buf;      ///< Arena buffer. Always NULL-terminated at 'length' while the builder is in use.
+    u64 length;     ///< Current string length, not including the NULL terminator.
+    u64 capacity;   ///< Current arena capacity, in bytes.
+} UtilsStringBuilder;
+
+/// Formats a string and appends it in-place to the provided string builder, growing its arena on demand.
+__attribute__((format(printf, 2, 3))) bool utilsStringBuilderAppendFormat(UtilsStringBuilder *sb, const char *fmt, ...);
+
+/// Returns a dynamically allocated, exact-size copy of the string held by the provided string builder, then frees the builder arena.
+/// If 'out_size' is provided, it will be updated to hold the string length, not including the NULL terminator.
+/// Returns NULL if the builder is empty or if an error occurs - the arena is freed regardless.
+char *utilsStringBuilderFinalize(UtilsStringBuilder *sb, u64 *out_size);
+
+/// Frees the arena from the provided string builder and resets its state.
+void utilsStringBuilderFree(UtilsStringBuilder *sb);
+
 /// Replaces illegal FAT characters in the provided UTF-8 string with underscores.
 /// If 'ascii_only' is set to true, all codepoints outside the [0x20,0x7F) range will also be replaced with underscores.
 /// Replacements are performed on a per-codepoint basis, which means the string length can be reduced by this function.
@@ -127,6 +166,59 @@ void utilsGenerateHexStringFromData(char *dst, size_t dst_size, const void *src,
 /// Formats the provided 'size' value to a human-readable size string and stores it in 'dst'.
 void utilsGenerateFormattedSizeString(double size, char *dst, size_t dst_size);
 
+/// Integer-only variant of utilsGenerateFormattedSizeString(). Uses fixed-point math to generate the two decimal places, avoiding floating point division entirely.
+/// Preferred for paths that format sizes repeatedly (e.g. progress rendering).
+void utilsGenerateFormattedSizeStringFromU64(u64 size, char *dst, size_t dst_size);
+
+/// Caches a formatted size string, so repeatedly formatting a value that rarely changes only costs an integer comparison. Zero out before first use.
+typedef struct {
+    bool valid;         ///< Whether the cached string holds usable data.
+    u64 last_size;      ///< Raw value the cached string was generated from.
+    char str[0x20];     ///< Cached formatted size string.
+} UtilsFormattedSizeCache;
+
+/// Returns a formatted size string for the provided value, regenerating the cached string only if the value changed since the last call.
+/// The returned pointer stays valid for as long as the cache element does.
+const char *utilsGetFormattedSizeStringFromCache(UtilsFormattedSizeCache *cache, u64 size);
+
+/// Number of throughput samples kept by UtilsProgressStats. At one sample per progress refresh (~1 Hz), the sparkline covers roughly the last half minute.
+#define UTILS_PROGRESS_HISTORY_SIZE 30
+
+/// Throughput instrumentation for dump progress rendering. Zero out before first use, then feed it the current byte count on every progress refresh.
+typedef struct {
+    u64 last_tick;                                  ///< System tick from the previous sample. Zero until the first utilsUpdateProgressStats() call.
+    u64 last_size;                                  ///< Byte count from the previous sample.
+    double ewma_rate;                               ///< Exponentially-weighted throughput, in bytes per second. Stable within a few samples, unlike a naive running average.
+    double ewma_var;                                ///< Exponentially-weighted variance of the sampled throughput. Feeds the ETA safety margin.
+    double history[UTILS_PROGRESS_HISTORY_SIZE];    ///< Ring buffer holding the most recent raw throughput samples. Rendered by utilsGenerateProgressSparkline().
+    u32 history_index;                              ///< Next ring buffer slot to fill.
+    u32 history_count;                              ///< Total samples stored so far. Caps out at UTILS_PROGRESS_HISTORY_SIZE.
+} UtilsProgressStats;
+
+/// Takes a throughput sample from the provided byte count and updates the smoothed rate, variance and history ring buffer.
+/// Samples taken less than ~100 ms apart are ignored, so calling this from a UI loop that refreshes faster than once per second is safe.
+void utilsUpdateProgressStats(UtilsProgressStats *stats, u64 cur_size);
+
+/// Returns the smoothed throughput, in bytes per second. Returns 0.0 until at least one full sample interval has elapsed.
+double utilsGetProgressRate(const UtilsProgressStats *stats);
+
+/// Calculates a variance-aware ETA: the remaining bytes are divided by a throughput estimate lowered by one standard deviation, so bursty transfers don't produce over-optimistic figures.
+/// Returns false until enough samples have been taken for the estimate to be meaningful.
+bool utilsGetProgressEta(const UtilsProgressStats *stats, u64 cur_size, u64 total_size, u64 *out_eta_secs);
+
+/// Renders the throughput history ring buffer as a fixed-width ASCII sparkline (oldest sample first), scaled against the highest sample on record.
+/// 'dst_size' must be big enough to hold UTILS_PROGRESS_HISTORY_SIZE characters plus a NULL terminator - the output is padded with spaces while the ring buffer fills up.
+void utilsGenerateProgressSparkline(const UtilsProgressStats *stats, char *dst, size_t dst_size);
+
+/// Returns true if the provided block is completely filled with either 0x00 or 0xFF bytes.
+/// Runs at memory bandwidth, so padding detection over big blocks is essentially free compared to any I/O on them.
+bool utilsIsPaddingBlock(const void *buf, u64 size);
+
+/// Combines two CRC32 checksums, as if the data that generated 'crc2' had been appended to the data that generated 'crc1'.
+/// 'len2' must hold the length, in bytes, of the data that generated 'crc2'.
+/// Makes it possible to checksum independent parts of a data stream separately (even in parallel) instead of paying for multiple sequential passes over shared data.
+u32 utilsCombineCrc32(u32 crc1, u32 crc2, u64 len2);
+
 /// Saves the total size and free space available from the filesystem pointed to by the input path (e.g. "sdmc:/") to 'out_total' and 'out_free', respectively.
 /// Either 'out_total' or 'out_free' can be NULL, but at least one of them must be a valid pointer.
 /// Returns false if there's an error.
@@ -147,8 +239,13 @@ bool utilsCreateConcatenationFile(const char *path);
 
 /// Creates a full directory tree using the provided path.
 /// If 'create_last_element' is true, the last element from the provided path will be created as well.
+/// Directories created during the current session are tracked in a hash set, so repeated calls over paths sharing ancestors (e.g. mass extraction) only touch each directory once.
 void utilsCreateDirectoryTree(const char *path, bool create_last_element);
 
+/// Flushes the created-directory cache used by utilsCreateDirectoryTree().
+/// Must be called if previously created directories may have been removed by an external actor (e.g. after SD card ejection).
+void utilsFlushDirectoryTreeCache(void);
+
 /// Returns a pointer to a dynamically allocated string that holds the full path formed by the provided arguments. Both path prefix and file extension are optional.
 /// If any elements from the generated path exceed safe filesystem limits, each exceeding element will be truncated. Truncations, if needed, are performed on a per-codepoint basis (UTF-8).
 /// If an extension is provided, it will always be preserved, regardless of any possible truncations being carried out.
@@ -65,8 +65,13 @@ typedef struct {
 typedef struct {
     PartitionFileSystemHeader header;   ///< Partition FS header. Holds the entry count and name table size.
     PartitionFileSystemEntry *entries;  ///< Partition FS entries.
+    u32 entries_capacity;               ///< Allocated Partition FS entry count. Grown geometrically by pfsAddEntryInformationToFileContext().
     char *name_table;                   ///< Name table.
+    u32 name_table_capacity;            ///< Allocated name table size. Grown geometrically by pfsAddEntryInformationToFileContext().
     u64 fs_size;                        ///< Partition FS data size. Updated each time a new entry is added.
+    u8 *cached_header;                  ///< Serialized full Partition FS header. Generated by pfsWriteFileContextHeaderToMemoryBuffer().
+    u64 cached_header_size;             ///< Serialized full Partition FS header size.
+    bool header_dirty;                  ///< Set to true if the Partition FS layout changed after the last header serialization.
 } PartitionFileSystemFileContext;
 
 /// Initializes a Partition FS context.
@@ -99,7 +104,12 @@ bool pfsAddEntryInformationToFileContext(PartitionFileSystemFileContext *ctx, co
 /// Updates the name from a Partition FS entry in an existing PartitionFileSystemFileContext, using an entry index and the new entry name.
 bool pfsUpdateEntryNameFromFileContext(PartitionFileSystemFileContext *ctx, u32 entry_idx, const char *new_entry_name);
 
+/// Updates the size from a Partition FS entry in an existing PartitionFileSystemFileContext, using an entry index and the new entry size.
+/// The data offsets for all subsequent Partition FS entries are rebuilt to match the new size.
+bool pfsUpdateEntrySizeFromFileContext(PartitionFileSystemFileContext *ctx, u32 entry_idx, u64 new_entry_size);
+
 /// Generates a full Partition FS header from an existing PartitionFileSystemFileContext and writes it to the provided memory buffer.
+/// The serialized header is cached within the context and only rebuilt if the Partition FS layout changed since the last call.
 bool pfsWriteFileContextHeaderToMemoryBuffer(PartitionFileSystemFileContext *ctx, void *buf, u64 buf_size, u64 *out_header_size);
 
 /// Miscellaneous functions.
@@ -170,6 +180,7 @@ NX_INLINE void pfsFreeFileContext(PartitionFileSystemFileContext *ctx)
     if (!ctx) return;
     if (ctx->entries) free(ctx->entries);
     if (ctx->name_table) free(ctx->name_table);
+    if (ctx->cached_header) free(ctx->cached_header);
     memset(ctx, 0, sizeof(PartitionFileSystemFileContext));
 }
 
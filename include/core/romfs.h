@@ -122,6 +122,23 @@ typedef struct {
     u64 body_offset;                        ///< RomFS file data body offset (relative to the start of the RomFS).
     u64 cur_dir_offset;                     ///< Current RomFS directory offset (relative to the start of the directory entries table). Used for RomFS browsing.
     u64 cur_file_offset;                    ///< Current RomFS file offset (relative to the start of the file entries table). Used for RomFS browsing.
+    u64 *path_index;                        ///< Optional hash-indexed lookup table for child entry lookups by name. Built on demand by the path resolution helpers.
+    u32 path_index_capacity;                ///< Bucket count for 'path_index'. Always a power of two.
+    u64 *size_memo_offsets;                 ///< Optional sorted directory table offsets, one per directory entry. Maps directory entries to 'dir_size_memo' slots via binary search.
+    u64 *dir_size_memo;                     ///< Optional memoized extracted sizes (subtree totals), one per directory entry. Built on demand by romfsGetDirectoryDataSize().
+    u32 size_memo_count;                    ///< Number of entries in 'size_memo_offsets' / 'dir_size_memo'.
+    u64 total_size_memo[2];                 ///< Memoized romfsGetTotalDataSize() results. Index 0: all file entries. Index 1: updated file entries only.
+    bool total_size_memo_valid[2];          ///< Set to true once the corresponding 'total_size_memo' entry has been calculated.
+    u64 *updated_memo_offsets;              ///< Optional sorted file table offsets, one per file entry. Maps file entries to 'updated_memo_bitmap' bits via binary search.
+    u8 *updated_memo_bitmap;                ///< Optional bitmap with one bit per file entry, set if the entry is updated by the Patch RomFS. Built on demand by romfsIsFileEntryUpdated().
+    u32 updated_memo_count;                 ///< Number of entries in 'updated_memo_offsets' / bits in 'updated_memo_bitmap'.
+    u8 *data_cache;                         ///< Optional read coalescing buffer for small file entry reads. Allocated on demand by romfsReadFileEntryData().
+    u64 data_cache_offset;                  ///< Offset for the cached file data span (relative to the start of the RomFS).
+    u64 data_cache_size;                    ///< Size for the cached file data span. Set to zero if no data is currently cached.
+    u32 cached_dir_offset;                  ///< Parent directory offset for 'cached_dir_path'. Only valid if 'cached_dir_path_len' is non-zero.
+    u8 cached_dir_replace_type;             ///< Illegal character replace type used to generate 'cached_dir_path'.
+    size_t cached_dir_path_len;             ///< Length for 'cached_dir_path'. Zero means no directory path is currently cached.
+    char cached_dir_path[FS_MAX_PATH];      ///< Directory path generated by the last romfsGeneratePathFromFileEntry() call. Reused by files sharing the same parent directory.
 } RomFileSystemContext;
 
 typedef struct {
@@ -148,13 +165,16 @@ bool romfsReadFileSystemData(RomFileSystemContext *ctx, void *out, u64 read_size
 
 /// Reads data from a previously retrieved RomFileSystemFileEntry using a RomFS context.
 /// Input offset must be relative to the start of the RomFS file entry data.
+/// Small reads are served through a coalescing buffer that decrypts a larger file data span in one go, which greatly speeds up extraction of many small, adjacent file entries.
 bool romfsReadFileEntryData(RomFileSystemContext *ctx, RomFileSystemFileEntry *file_entry, void *out, u64 read_size, u64 offset);
 
 /// Calculates the extracted RomFS size.
 /// If 'only_updated' is set to true and the provided RomFS context was initialized as a Patch RomFS context, only files modified by the update will be considered.
+/// The calculated size is memoized - repeated calls on the same context are served without walking the file entry table again.
 bool romfsGetTotalDataSize(RomFileSystemContext *ctx, bool only_updated, u64 *out_size);
 
 /// Calculates the extracted size from a RomFS directory.
+/// Sizes for the whole directory tree are calculated in a single traversal the first time this function is called on a context, then served from a memo table afterwards.
 bool romfsGetDirectoryDataSize(RomFileSystemContext *ctx, RomFileSystemDirectoryEntry *dir_entry, u64 *out_size);
 
 /// Retrieves a RomFS directory entry by path.
@@ -173,6 +193,7 @@ bool romfsGeneratePathFromFileEntry(RomFileSystemContext *ctx, RomFileSystemFile
 
 /// Checks if a RomFS file entry is updated by the Patch RomFS.
 /// Only works if the provided RomFileSystemContext was initialized as a Patch RomFS context.
+/// All file entries are classified in a single Indirect Storage pass the first time this function is called on a context, then served from a memoized bitmap afterwards.
 bool romfsIsFileEntryUpdated(RomFileSystemContext *ctx, RomFileSystemFileEntry *file_entry, bool *out);
 
 /// Generates HierarchicalSha256 (NCA0) / HierarchicalIntegrity (NCA2/NCA3) FS section patch data using a RomFS context + file entry, which can be used to seamlessly replace NCA data.
@@ -189,6 +210,12 @@ NX_INLINE void romfsFreeContext(RomFileSystemContext *ctx)
     ncaStorageFreeContext(&(ctx->storage_ctx[1]));
     if (ctx->dir_table) free(ctx->dir_table);
     if (ctx->file_table) free(ctx->file_table);
+    if (ctx->path_index) free(ctx->path_index);
+    if (ctx->size_memo_offsets) free(ctx->size_memo_offsets);
+    if (ctx->dir_size_memo) free(ctx->dir_size_memo);
+    if (ctx->updated_memo_offsets) free(ctx->updated_memo_offsets);
+    if (ctx->updated_memo_bitmap) free(ctx->updated_memo_bitmap);
+    if (ctx->data_cache) free(ctx->data_cache);
     memset(ctx, 0, sizeof(RomFileSystemContext));
 }
 
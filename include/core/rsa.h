@@ -39,6 +39,22 @@ extern "C" {
 /// The provided signature and modulus should have sizes of at least RSA2048_SIG_SIZE and RSA2048_PUBKEY_SIZE, respectively.
 bool rsa2048VerifySha256BasedPssSignature(const void *data, size_t data_size, const void *signature, const void *modulus, const void *public_exponent, size_t public_exponent_size);
 
+/// Queues a RSA-2048-PSS with SHA-256 signature verification, which is processed by a dedicated worker thread so the expensive modexp overlaps with whatever the calling thread does next.
+/// The SHA-256 checksum for the input data is calculated before this function returns, and the signature is copied into the queue entry - neither buffer needs to remain valid afterwards.
+/// The modulus and public exponent buffers must remain valid until the queued verification is processed. In practice, all callers use statically allocated key data.
+/// RSA contexts are cached per modulus by the worker thread, so Montgomery precomputation steps are shared between queued verifications that use the same public key.
+/// The verification result is written to 'out_result' by the worker thread - call rsa2048WaitForQueuedPssVerifications() before reading it.
+/// Falls back to a synchronous verification if the worker thread isn't available. Returns false if the provided parameters are invalid.
+bool rsa2048QueueSha256BasedPssSignatureVerification(const void *data, size_t data_size, const void *signature, const void *modulus, const void *public_exponent, size_t public_exponent_size, \
+                                                     bool *out_result);
+
+/// Blocks until all previously queued RSA-2048-PSS signature verifications have been processed.
+void rsa2048WaitForQueuedPssVerifications(void);
+
+/// Destroys the RSA-2048-PSS signature verification worker thread, processing any pending queue entries beforehand, and frees all cached RSA contexts.
+/// The thread is created automatically by rsa2048QueueSha256BasedPssSignatureVerification(), so this only needs to be called while exiting the application.
+void rsaDestroyPssVerificationThread(void);
+
 /// Performs RSA-2048-OAEP decryption.
 /// Suitable to decrypt the titlekey block from tickets with personalized crypto.
 /// The provided signature and modulus should have sizes of at least RSA2048_SIG_SIZE and RSA2048_PUBKEY_SIZE, respectively.
@@ -47,6 +47,8 @@ extern "C" {
 
 #define ACTION_VERIFY                   (1<<2)
 
+#define SAVE_FAT_STORAGE_MAX_EXTENTS    32      /* FAT storages with more fragments than this fall back to per-read chain iteration. */
+
 typedef enum {
     VALIDITY_UNCHECKED = 0,
     VALIDITY_INVALID,
@@ -384,12 +386,20 @@ typedef struct {
     fat_header_t *header;
 } allocation_table_ctx_t;
 
+typedef struct {
+    u32 virtual_block;
+    u32 physical_block;
+    u32 block_count;
+} allocation_table_extent_t;
+
 typedef struct {
     hierarchical_integrity_verification_storage_ctx_t *base_storage;
     u32 block_size;
     u32 initial_block;
     allocation_table_ctx_t *fat;
     u64 _length;
+    allocation_table_extent_t extents[SAVE_FAT_STORAGE_MAX_EXTENTS];
+    u32 extent_count;
 } allocation_table_storage_ctx_t;
 
 typedef struct {
@@ -454,6 +464,9 @@ typedef struct {
     u32 used_list_head_index;
     allocation_table_storage_ctx_t storage;
     u32 capacity;
+    save_fs_list_entry_t *cached_entries;   ///< Optional in-memory copy of the whole entry list. Built by save_process() once the savefile FS has been initialized.
+    u64 *lookup_index;                      ///< Optional hash-indexed lookup table (name hash -> entry list index). Used by save_fs_list_get_index_from_key().
+    u32 lookup_capacity;                    ///< Bucket count for 'lookup_index'. Always a power of two.
 } save_filesystem_list_ctx_t;
 
 typedef struct {
@@ -70,6 +70,11 @@ typedef struct {
 
 NXDT_ASSERT(SignatureBlockHmac160, 0x40);
 
+/// Compile-time constant accessors for the fixed signature block layouts.
+/// Use these instead of the runtime helpers below whenever the signature block layout is already known at compile time.
+#define SIGNATURE_BLOCK_SIZE(sigtype)   sizeof(SignatureBlock##sigtype)
+#define SIGNATURE_SIG_SIZE(sigtype)     MEMBER_SIZE(SignatureBlock##sigtype, signature)
+
 /// Helper inline functions.
 
 NX_INLINE u32 signatureGetSigType(void *buf, bool byteswap)
@@ -80,9 +85,8 @@ NX_INLINE u32 signatureGetSigType(void *buf, bool byteswap)
 
 NX_INLINE bool signatureIsValidSigType(u32 type)
 {
-    return (type == SignatureType_Rsa4096Sha1   || type == SignatureType_Rsa2048Sha1   || type == SignatureType_Ecc480Sha1   || \
-            type == SignatureType_Rsa4096Sha256 || type == SignatureType_Rsa2048Sha256 || type == SignatureType_Ecc480Sha256 || \
-            type == SignatureType_Hmac160Sha1);
+    /* Signature type values are contiguous, so a simple range check will suffice. */
+    return (type >= SignatureType_Rsa4096Sha1 && type <= SignatureType_Hmac160Sha1);
 }
 
 NX_INLINE u8 *signatureGetSig(void *buf)
@@ -92,18 +96,33 @@ NX_INLINE u8 *signatureGetSig(void *buf)
 
 NX_INLINE u64 signatureGetSigSize(u32 type)
 {
-    return (u64)((type == SignatureType_Rsa4096Sha1 || type == SignatureType_Rsa4096Sha256) ? MEMBER_SIZE(SignatureBlockRsa4096, signature) : \
-                ((type == SignatureType_Rsa2048Sha1 || type == SignatureType_Rsa2048Sha256) ? MEMBER_SIZE(SignatureBlockRsa2048, signature) : \
-                ((type == SignatureType_Ecc480Sha1  || type == SignatureType_Ecc480Sha256)  ? MEMBER_SIZE(SignatureBlockEcc480,  signature) : \
-                 (type == SignatureType_Hmac160Sha1                                         ? MEMBER_SIZE(SignatureBlockHmac160, signature) : 0))));
+    /* Layout properties are resolved through constant lookup tables instead of branch chains - bulk certificate / ticket iteration hits these helpers once per parsed entry. */
+    static const u16 sig_sizes[] = {
+        SIGNATURE_SIG_SIZE(Rsa4096),    /* SignatureType_Rsa4096Sha1. */
+        SIGNATURE_SIG_SIZE(Rsa2048),    /* SignatureType_Rsa2048Sha1. */
+        SIGNATURE_SIG_SIZE(Ecc480),     /* SignatureType_Ecc480Sha1. */
+        SIGNATURE_SIG_SIZE(Rsa4096),    /* SignatureType_Rsa4096Sha256. */
+        SIGNATURE_SIG_SIZE(Rsa2048),    /* SignatureType_Rsa2048Sha256. */
+        SIGNATURE_SIG_SIZE(Ecc480),     /* SignatureType_Ecc480Sha256. */
+        SIGNATURE_SIG_SIZE(Hmac160)     /* SignatureType_Hmac160Sha1. */
+    };
+
+    return (u64)(signatureIsValidSigType(type) ? sig_sizes[type - SignatureType_Rsa4096Sha1] : 0);
 }
 
 NX_INLINE u64 signatureGetBlockSize(u32 type)
 {
-    return (u64)((type == SignatureType_Rsa4096Sha1 || type == SignatureType_Rsa4096Sha256) ? sizeof(SignatureBlockRsa4096) : \
-                ((type == SignatureType_Rsa2048Sha1 || type == SignatureType_Rsa2048Sha256) ? sizeof(SignatureBlockRsa2048) : \
-                ((type == SignatureType_Ecc480Sha1  || type == SignatureType_Ecc480Sha256)  ? sizeof(SignatureBlockEcc480)  : \
-                 (type == SignatureType_Hmac160Sha1                                         ? sizeof(SignatureBlockHmac160) : 0))));
+    static const u16 block_sizes[] = {
+        SIGNATURE_BLOCK_SIZE(Rsa4096),  /* SignatureType_Rsa4096Sha1. */
+        SIGNATURE_BLOCK_SIZE(Rsa2048),  /* SignatureType_Rsa2048Sha1. */
+        SIGNATURE_BLOCK_SIZE(Ecc480),   /* SignatureType_Ecc480Sha1. */
+        SIGNATURE_BLOCK_SIZE(Rsa4096),  /* SignatureType_Rsa4096Sha256. */
+        SIGNATURE_BLOCK_SIZE(Rsa2048),  /* SignatureType_Rsa2048Sha256. */
+        SIGNATURE_BLOCK_SIZE(Ecc480),   /* SignatureType_Ecc480Sha256. */
+        SIGNATURE_BLOCK_SIZE(Hmac160)   /* SignatureType_Hmac160Sha1. */
+    };
+
+    return (u64)(signatureIsValidSigType(type) ? block_sizes[type - SignatureType_Rsa4096Sha1] : 0);
 }
 
 NX_INLINE void *signatureGetPayload(void *buf, bool big_endian_sig_type)
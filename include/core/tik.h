@@ -183,6 +183,11 @@ bool tikRetrieveTicketByRightsId(Ticket *dst, const FsRightsId *id, bool use_gam
 /// Raw certificate chain data will be saved to the provided pointers. certGenerateRawCertificateChainBySignatureIssuer() is used internally, so the output buffer must be freed by the user.
 bool tikConvertPersonalizedTicketToCommonTicket(Ticket *tik, u8 **out_raw_cert_chain, u64 *out_raw_cert_chain_size);
 
+/// Builds / refreshes the ticket indexes for both common and personalized tickets, so later rights ID lookups don't pay the savefile scan cost.
+/// Safe to call repeatedly: the rebuild is skipped for any titlekey type whose installed ticket set hasn't changed since its last index build.
+/// Returns false if either index couldn't be built.
+bool tikPrewarmTicketIndexes(void);
+
 /// Helper inline functions.
 
 NX_INLINE TikCommonBlock *tikGetCommonBlock(void *buf)
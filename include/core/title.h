@@ -140,6 +140,14 @@ void titleFreeOrphanTitles(TitleInfo ***orphan_info);
 ///     2. They must be called again.
 bool titleIsGameCardInfoUpdated(void);
 
+/// Checks if the background title storage load thread has streamed in new title data since the last time this function was called.
+/// Title storages and ns record metadata are loaded incrementally after titleInitialize() returns, so data returned by other functions from this interface may grow over time.
+/// The same rules from titleIsGameCardInfoUpdated() apply if this function returns true and data from other functions from this interface was previously retrieved.
+bool titleIsStorageInfoUpdated(void);
+
+/// Returns true if the background title storage load thread has finished loading every persistent title storage and all ns record metadata.
+bool titleIsStorageLoadComplete(void);
+
 /// Returns a pointer to a dynamically allocated buffer that holds a filename string suitable for output title dumps. Returns NULL if an error occurs.
 char *titleGenerateFileName(TitleInfo *title_info, u8 naming_convention, u8 illegal_char_replace_type);
 
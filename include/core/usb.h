@@ -31,7 +31,14 @@
 extern "C" {
 #endif
 
-#define USB_TRANSFER_BUFFER_SIZE    0x800000    /* 8 MiB. */
+#define USB_TRANSFER_BUFFER_SIZE        0x800000    /* 8 MiB. Default and minimum transfer buffer size. */
+#define USB_TRANSFER_BUFFER_MAX_SIZE    0x4000000   /* 64 MiB. Maximum negotiable transfer buffer size. */
+
+/// Describes a single output file sent to the host device as part of a usbSendFilePropertiesBatch() call.
+typedef struct {
+    u64 file_size;          ///< Total file size. May be zero for empty files.
+    const char *filename;   ///< File name, including any parent directories. Must not exceed FS_MAX_PATH, including the NULL terminator.
+} UsbBatchFileEntry;
 
 /// Used to indicate the USB speed selected by the host device.
 typedef enum {
@@ -50,10 +57,18 @@ void usbExit(void);
 /// Returns a pointer to a dynamically allocated, page aligned memory buffer that's suitable for USB transfers.
 void *usbAllocatePageAlignedBuffer(size_t size);
 
+/// Returns true if the USB host connection status has been updated by the background detection thread since the last time this function was called.
+/// Only reads an internal flag - no IPC calls are issued, making it suitable for cheap periodic polling.
+bool usbIsStatusUpdated(void);
+
 /// Used to check if the console has been connected to a USB host device and if a valid USB session has been established.
 /// Returns a value from the UsbHostSpeed enum.
 u8 usbIsReady(void);
 
+/// Returns the current transfer buffer size, which is negotiated with the host device as part of the session-start handshake.
+/// Guaranteed to fall within the [USB_TRANSFER_BUFFER_SIZE, USB_TRANSFER_BUFFER_MAX_SIZE] range. Legacy hosts that skip negotiation get the default size.
+u64 usbGetTransferBufferSize(void);
+
 /// Sends file properties to the host device before starting a file data transfer. Must be called before usbSendFileData().
 /// If 'nsp_header_size' is greater than zero, NSP transfer mode will be enabled. The file will be treated as a NSP and this value will be taken as its full Partition FS header size.
 /// Under NSP transfer mode, this function must be called right before transferring data from each NSP file entry to the host device, which should in turn write it all to the same output file.
@@ -61,11 +76,40 @@ u8 usbIsReady(void);
 /// The host device should immediately write 'nsp_header_size' padding at the start of the output file and start listening for further usbSendFileProperties() calls, or a usbSendNspHeader() call.
 bool usbSendFileProperties(u64 file_size, const char *filename, u32 nsp_header_size);
 
+/// Sends properties for multiple files to the host device in a single command. Must be called before transferring data from any of the provided entries.
+/// After a successful call, data from every non-empty entry must be sent back-to-back, in order, using usbSendFileData() / usbSendFileDataAsync(). Empty entries are created by the host on its own.
+/// Sending the directory tree upfront via usbSendDirectoryTable() lets the host skip per-file directory creation during the data transfer stage.
+/// The host device only acknowledges the batch twice: once right after the announcement and once after the last data chunk from the last non-empty entry, removing the per-file command round trips.
+/// Not available under NSP transfer mode, nor while another file or batch transfer is in progress. usbCancelFileTransfer() cancels the whole batch.
+bool usbSendFilePropertiesBatch(const UsbBatchFileEntry *entries, u32 entry_count);
+
+/// Optional session preamble. Announces every output directory that upcoming file transfers will write into, letting the host device create the whole directory tree in a single pass.
+/// Each path must not exceed FS_MAX_PATH, including the NULL terminator. Tables that don't fit in the transfer buffer are automatically split across multiple commands.
+/// Failures aren't fatal for the session - older host tools that don't implement this command simply keep creating directories on a per-file basis.
+/// Not available under NSP transfer mode, nor while a file or batch transfer is in progress.
+bool usbSendDirectoryTable(const char **dir_paths, u32 dir_count);
+
+/// Asks the host device to splice a file it already holds from a previous dump into the output NSP, identified by its entry name and exact size, instead of transferring its data again.
+/// Only available under NSP transfer mode, in place of the usbSendFileProperties() call for the affected entry. Must only be used for entries whose data matches the stored content byte for byte.
+/// On success, 'out_cached' is updated to reflect the host response: true means the entry was spliced host-side and its data must not be sent, false means it must be transferred the usual way.
+/// Returns false on actual transfer failures and when talking to older host tools that don't implement this command - callers should fall back to regular transfers and stop sending references.
+bool usbSendCachedContentReference(u64 file_size, const char *filename, bool *out_cached);
+
 /// Performs a file data transfer. Must be continuously called after usbSendFileProperties() until all file data has been transferred.
 /// Data chunk size must not exceed USB_TRANSFER_BUFFER_SIZE.
 /// If the last file data chunk is aligned to the endpoint max packet size, the host device should expect a Zero Length Termination (ZLT) packet.
 bool usbSendFileData(void *data, u64 data_size);
 
+/// Double-buffered variant of usbSendFileData(). Queues the provided data chunk on the input endpoint and returns without waiting for the transfer to complete.
+/// The previous in-flight transfer (if any) is waited on before the new one is submitted, so at most one transfer remains pending at any given time.
+/// The provided buffer must not be modified nor freed until the next usbSendFileDataAsync() / usbFlushPendingTransfers() call returns. Page aligned buffers avoid an extra data copy.
+/// usbFlushPendingTransfers() must be called after the last file data chunk has been queued via this function.
+bool usbSendFileDataAsync(void *data, u64 data_size);
+
+/// Waits until the in-flight transfer queued by usbSendFileDataAsync() completes, then verifies the host device response if said transfer was the last chunk for the current file.
+/// Returns true right away if there are no pending transfers.
+bool usbFlushPendingTransfers(void);
+
 /// Used to gracefully cancel an ongoing file transfer. The current USB session is kept alive.
 void usbCancelFileTransfer(void);
 
@@ -101,6 +101,12 @@
 #define LOG_BUF_SIZE                    0x400000                                                                                /* 4 MiB. */
 #define LOG_FORCE_FLUSH                 0                                                                                       /* Forces a log buffer flush each time the logfile is written to. */
 
+#define TRACE_FILE_NAME                 APP_TITLE ".trace.json"
+#define TRACE_BUF_SIZE                  0x80000                                                                                 /* 512 KiB. */
+
+#define CRASH_REPORT_FILE_NAME          APP_TITLE ".crash.log"
+#define CRASH_REPORT_BUF_SIZE           0x8000                                                                                  /* 32 KiB. */
+
 #define BIS_SYSTEM_PARTITION_MOUNT_NAME "sys:"
 
 #define DOWNLOAD_TASK_INTERVAL          100                                                                                     /* 100 milliseconds. */
@@ -110,6 +116,8 @@
 #define HTTP_LOW_SPEED_LIMIT            30L                                                                                     /* 30 bytes per second. */
 #define HTTP_LOW_SPEED_TIME             HTTP_CONNECT_TIMEOUT
 #define HTTP_BUFFER_SIZE                131072L                                                                                 /* 128 KiB. */
+#define HTTP_RANGED_CONNECTION_COUNT    4                                                                                       /* Parallel connections used by ranged downloads. */
+#define HTTP_RANGED_MIN_SIZE            0x100000                                                                                /* 1 MiB. Smaller downloads always use a single connection. */
 
 #define GITHUB_URL                      "https://github.com"
 #define GITHUB_API_URL                  "https://api.github.com"
@@ -119,11 +127,17 @@
 #define GITHUB_NEW_ISSUE_URL            GITHUB_REPOSITORY_URL "/issues/new/choose"
 
 #define GITHUB_API_RELEASE_URL          GITHUB_API_URL "/repos/" GITHUB_REPOSITORY "/releases/latest"
+#define GITHUB_API_RELEASE_CACHE_PATH   DEVOPTAB_SDMC_DEVICE APP_BASE_PATH "release_cache.bin"
 
 #define NSWDB_XML_URL                   "http://nswdb.com/xml.php"
 #define NSWDB_XML_NAME                  "NSWreleases.xml"
 #define NSWDB_XML_PATH                  APP_BASE_PATH NSWDB_XML_NAME
 
+#define NOINTRO_DAT_NAME                "NoIntro.dat"
+#define NOINTRO_DAT_PATH                APP_BASE_PATH NOINTRO_DAT_NAME
+#define NOINTRO_DAT_CACHE_NAME          NOINTRO_DAT_NAME ".idx"
+#define NOINTRO_DAT_CACHE_PATH          APP_BASE_PATH NOINTRO_DAT_CACHE_NAME
+
 #define BOREALIS_URL                    "https://github.com/natinusala/borealis"
 #define LIBUSBHSFS_URL                  "https://github.com/DarkMatterCore/libusbhsfs"
 #define FATFS_URL                       "http://elm-chan.org/fsw/ff/00index_e.html"
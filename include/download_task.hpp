@@ -280,6 +280,12 @@ namespace nxdt::tasks
     class DownloadDataTask: public DownloadTask<DownloadDataResult, std::string, bool>
     {
         protected:
+            /* Small metadata fetches the UI waits on (e.g. release info, NSWDB XML) - keep them ahead of queued background work. */
+            AsyncTaskPriority getPriority(void) const override final
+            {
+                return AsyncTaskPriority::UiBlocking;
+            }
+
             DownloadDataResult doInBackground(const std::string& url, const bool& force_https) override final
             {
                 char *buf = NULL;
@@ -291,6 +297,29 @@ namespace nxdt::tasks
                 return std::make_pair(buf, buf_size);
             }
     };
+
+    /* Asynchronous task to store downloaded data into a dynamically allocated buffer using a URL, backed by an on-disk cache file. */
+    /* Repeated downloads are turned into conditional requests, which only cost a header round-trip as long as the remote data doesn't change. */
+    class DownloadDataCachedTask: public DownloadTask<DownloadDataResult, std::string, bool, std::string>
+    {
+        protected:
+            /* Small metadata fetches the UI waits on (e.g. release info, NSWDB XML) - keep them ahead of queued background work. */
+            AsyncTaskPriority getPriority(void) const override final
+            {
+                return AsyncTaskPriority::UiBlocking;
+            }
+
+            DownloadDataResult doInBackground(const std::string& url, const bool& force_https, const std::string& cache_path) override final
+            {
+                char *buf = NULL;
+                size_t buf_size = 0;
+
+                /* If the process fails or if it's cancelled, httpDownloadDataCached() will take care of freeing up the allocated memory and return NULL. */
+                buf = httpDownloadDataCached(&buf_size, url.c_str(), force_https, cache_path.c_str(), DownloadDataCachedTask::HttpProgressCallback, this);
+
+                return std::make_pair(buf, buf_size);
+            }
+    };
 }
 
 #endif  /* __DOWNLOAD_TASK_HPP__ */
@@ -41,7 +41,9 @@ namespace nxdt::views
     {
         private:
             RootView *root_view = nullptr;
-            nxdt::tasks::UmsEvent::Subscription ums_task_sub;
+            nxdt::tasks::UmsDeltaEvent::Subscription ums_delta_task_sub;
+
+            nxdt::tasks::UmsDeviceVector storage_devices;   ///< Mirrors the UMS device entries displayed by output_storage, in the same order.
 
             char *raw_filename = NULL;
             const char *extension = NULL;
@@ -77,6 +79,14 @@ namespace nxdt::views
                 this->raw_filename = strdup(this->filename_input->getValue().c_str());
             }
 
+            static std::string GenerateUmsDeviceString(const UsbHsFsDevice& ums_device)
+            {
+                std::string device_str = (std::string(ums_device.name) + ", ");
+                if (ums_device.product_name[0]) device_str += (std::string(ums_device.product_name) + ", ");
+                device_str += fmt::format("LUN {}, FS #{}, {}", ums_device.lun, ums_device.fs_idx, LIBUSBHSFS_FS_TYPE_STR(ums_device.fs_type));
+                return brls::i18n::getStr("dump_options/output_storage/value_02"_i18n, device_str);
+            }
+
             void UpdateStorages(const nxdt::tasks::UmsDeviceVector* ums_devices)
             {
                 if (!this->output_storage) return;
@@ -84,15 +94,15 @@ namespace nxdt::views
                 std::vector<std::string> *storages = this->output_storage->getValues();
                 storages->clear();
 
+                this->storage_devices.clear();
+
                 storages->push_back("dump_options/output_storage/value_00"_i18n);
                 storages->push_back("dump_options/output_storage/value_01"_i18n);
 
                 for(const UsbHsFsDevice& cur_ums_device : *ums_devices)
                 {
-                    std::string device_str = (std::string(cur_ums_device.name) + ", ");
-                    if (cur_ums_device.product_name[0]) device_str += (std::string(cur_ums_device.product_name) + ", ");
-                    device_str += fmt::format("LUN {}, FS #{}, {}", cur_ums_device.lun, cur_ums_device.fs_idx, LIBUSBHSFS_FS_TYPE_STR(cur_ums_device.fs_type));
-                    storages->push_back(brls::i18n::getStr("dump_options/output_storage/value_02"_i18n, device_str));
+                    storages->push_back(GenerateUmsDeviceString(cur_ums_device));
+                    this->storage_devices.push_back(cur_ums_device);
                 }
 
                 if (this->output_storage->getSelectedValue() > ConfigOutputStorage_UsbHost)
@@ -105,6 +115,65 @@ namespace nxdt::views
                 }
             }
 
+            void ApplyStorageDelta(const nxdt::tasks::UmsDeltaData* ums_delta)
+            {
+                if (!this->output_storage) return;
+
+                std::vector<std::string> *storages = this->output_storage->getValues();
+
+                /* Remember which UMS device is currently selected, if any. */
+                int selected_device_idx = (this->output_storage->getSelectedValue() > ConfigOutputStorage_UsbHost ? \
+                                           (this->output_storage->getSelectedValue() - ConfigOutputStorage_Count) : -1);
+                bool selected_removed = false;
+
+                /* Drop removed devices. */
+                for(const UsbHsFsDevice& removed_device : ums_delta->removed)
+                {
+                    for(size_t i = 0; i < this->storage_devices.size(); i++)
+                    {
+                        if (!nxdt::tasks::UmsDeviceMatch(this->storage_devices[i], removed_device)) continue;
+
+                        storages->erase(storages->begin() + ConfigOutputStorage_Count + i);
+                        this->storage_devices.erase(this->storage_devices.begin() + i);
+
+                        if (selected_device_idx >= 0)
+                        {
+                            if (static_cast<size_t>(selected_device_idx) == i)
+                            {
+                                selected_removed = true;
+                            } else
+                            if (static_cast<size_t>(selected_device_idx) > i)
+                            {
+                                selected_device_idx--;
+                            }
+                        }
+
+                        break;
+                    }
+                }
+
+                /* Append added devices. */
+                for(const UsbHsFsDevice& added_device : ums_delta->added)
+                {
+                    storages->push_back(GenerateUmsDeviceString(added_device));
+                    this->storage_devices.push_back(added_device);
+                }
+
+                if (selected_removed)
+                {
+                    /* Set the SD card as the current output storage. */
+                    this->output_storage->setSelectedValue(ConfigOutputStorage_SdCard);
+
+                    /* Regenerate filename. */
+                    this->output_storage->getValueSelectedEvent()->fire(ConfigOutputStorage_SdCard);
+                } else
+                if (selected_device_idx >= 0)
+                {
+                    /* Keep the same device selected even if its index shifted. */
+                    this->output_storage->setSelectedValue(ConfigOutputStorage_Count + selected_device_idx);
+                }
+            }
+
         protected:
             bool onCancel(void) override
             {
@@ -176,10 +245,10 @@ namespace nxdt::views
 
 
 
-                /* Subscribe to the UMS device event. */
-                this->ums_task_sub = this->root_view->RegisterUmsTaskListener([this](const nxdt::tasks::UmsDeviceVector* ums_devices) {
-                    /* Update output storages vector. */
-                    this->UpdateStorages(ums_devices);
+                /* Subscribe to the UMS device delta event. */
+                this->ums_delta_task_sub = this->root_view->RegisterUmsTaskDeltaListener([this](const nxdt::tasks::UmsDeltaData* ums_delta) {
+                    /* Patch the output storages vector instead of rebuilding it. */
+                    this->ApplyStorageDelta(ums_delta);
                 });
 
 
@@ -330,7 +399,7 @@ namespace nxdt::views
             ~DumpOptionsFrame(void)
             {
                 /* Unregister task listener. */
-                this->root_view->UnregisterUmsTaskListener(this->ums_task_sub);
+                this->root_view->UnregisterUmsTaskDeltaListener(this->ums_delta_task_sub);
 
                 if (this->raw_filename) free(this->raw_filename);
             }
@@ -40,8 +40,20 @@ namespace nxdt::views
             nxdt::tasks::GameCardStatusEvent::Subscription gc_status_task_sub;
             GameCardStatus gc_status = GameCardStatus_NotInserted;
 
+            /* Package ID from the gamecard the current view hierarchy was built for. Used to detect repeat status events from the very same card. */
+            u64 card_package_id = 0;
+
+            /* Properties table rows. Kept around so repeat status events can patch values in place instead of rebuilding the whole list. */
+            brls::TableRow *capacity_row = nullptr, *total_size_row = nullptr, *trimmed_size_row = nullptr, *update_version_row = nullptr;
+            brls::TableRow *lafw_version_row = nullptr, *sdk_version_row = nullptr, *compatibility_type_row = nullptr;
+
+            /* Last values displayed by the properties table rows, used to skip updates for fields that didn't actually change. */
+            std::string capacity_val, total_size_val, trimmed_size_val, update_version_val, lafw_version_val, sdk_version_val, compatibility_type_val;
+
             void ProcessGameCardStatus(GameCardStatus gc_status);
             std::string GetFormattedSizeString(GameCardSizeFunc func);
+            void UpdateTableRowValue(brls::TableRow *row, std::string& cur_value, const std::string& new_value);
+            void UpdatePropertiesTable(void);
             void PopulateList(void);
 
         public:
@@ -0,0 +1,61 @@
+/*
+ * lazy_tab.hpp
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __LAZY_TAB_HPP__
+#define __LAZY_TAB_HPP__
+
+#include <borealis.hpp>
+
+namespace nxdt::views
+{
+    /* Wrapper view that defers construction of an expensive tab until it's actually needed. */
+    /* The factory callback runs the first time the tab is displayed, or earlier if RootView's idle prewarm gets to it first - either way, it stays off the startup path. */
+    class LazyTab: public brls::LayerView
+    {
+        public:
+            typedef std::function<brls::View*(brls::SidebarItem*)> Factory;
+
+        private:
+            Factory factory;
+            brls::SidebarItem *sidebar_item = nullptr;
+            bool built = false;
+
+        protected:
+            void willAppear(bool resetState = false) override;
+
+        public:
+            LazyTab(Factory factory);
+
+            void SetParentSidebarItem(brls::SidebarItem *sidebar_item);
+
+            /* Runs the factory callback and adopts the view it returns. No-op if the tab has already been built. UI thread only. */
+            void Build(void);
+
+            ALWAYS_INLINE bool IsBuilt(void)
+            {
+                return this->built;
+            }
+    };
+}
+
+#endif  /* __LAZY_TAB_HPP__ */
@@ -37,7 +37,8 @@ namespace nxdt::views
             brls::ProgressDisplay *progress_display = nullptr;
             brls::Label *size_lbl = nullptr, *speed_eta_lbl = nullptr;
 
-            std::string GetFormattedSizeString(double size);
+            /* Formatted size caches. Values that don't change between progress updates (e.g. the total size) are only formatted once. */
+            UtilsFormattedSizeCache cur_size_cache = {0}, total_size_cache = {0}, speed_cache = {0};
 
         protected:
             void draw(NVGcontext* vg, int x, int y, unsigned width, unsigned height, brls::Style* style, brls::FrameContext* ctx) override;
@@ -68,7 +69,7 @@ namespace nxdt::views
     class OptionsTabUpdateApplicationFrame: public brls::StagedAppletFrame
     {
         private:
-            nxdt::tasks::DownloadDataTask json_task;
+            nxdt::tasks::DownloadDataCachedTask json_task;
             char *json_buf = NULL;
             size_t json_buf_size = 0;
             UtilsGitHubReleaseJsonData json_data = {0};
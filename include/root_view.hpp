@@ -32,11 +32,16 @@
 
 namespace nxdt::views
 {
+    class LazyTab;
+
     class RootView: public brls::TabFrame
     {
         private:
             bool applet_mode = false;
 
+            std::vector<LazyTab*> lazy_tabs;    ///< Tabs still waiting to be built by the idle prewarm in draw(). First focus may build (and remove) an entry earlier.
+            u32 prewarm_frame_count = 0;
+
             brls::Label *applet_mode_lbl = nullptr;
             brls::Label *time_lbl = nullptr;
             brls::Label *battery_icon = nullptr, *battery_percentage = nullptr;
@@ -49,6 +54,7 @@ namespace nxdt::views
             nxdt::tasks::TitleTask *title_task = nullptr;
             nxdt::tasks::UmsTask *ums_task = nullptr;
             nxdt::tasks::UsbHostTask *usb_host_task = nullptr;
+            nxdt::tasks::IdleMaintenanceTask *idle_maintenance_task = nullptr;
 
             nxdt::tasks::StatusInfoEvent::Subscription status_info_task_sub;
             nxdt::tasks::UmsEvent::Subscription ums_task_sub;
@@ -86,6 +92,10 @@ namespace nxdt::views
             EVENT_SUBSCRIPTION(GameCardTask, GameCardStatusEvent, gc_status_task);
             EVENT_SUBSCRIPTION(TitleTask, TitleEvent, title_task);
             EVENT_SUBSCRIPTION(UmsTask, UmsEvent, ums_task);
+
+            /* The UMS delta event uses its own registration functions in UmsTask, so its wrappers are spelled out here. */
+            ALWAYS_INLINE nxdt::tasks::UmsDeltaEvent::Subscription RegisterUmsTaskDeltaListener(nxdt::tasks::UmsDeltaEvent::Callback cb) { return this->ums_task->RegisterDeltaListener(cb); }
+            ALWAYS_INLINE void UnregisterUmsTaskDeltaListener(nxdt::tasks::UmsDeltaEvent::Subscription subscription) { this->ums_task->UnregisterDeltaListener(subscription); }
             EVENT_SUBSCRIPTION(UsbHostTask, UsbHostEvent, usb_host_task);
     };
 }
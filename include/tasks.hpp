@@ -24,10 +24,13 @@
 #ifndef __TASKS_HPP__
 #define __TASKS_HPP__
 
+#include <atomic>
+#include <deque>
 #include <borealis.hpp>
 
 #include "defines.h"
 #include "core/gamecard.h"
+#include "core/nca.h"
 #include "core/title.h"
 #include "core/ums.h"
 #include "core/usb.h"
@@ -54,21 +57,57 @@ namespace nxdt::tasks
     /* Used to hold UMS devices. */
     typedef std::vector<UsbHsFsDevice> UmsDeviceVector;
 
+    /* Used to push UMS device list changes. Holds full copies of the devices added and removed since the previous event. */
+    typedef struct {
+        UmsDeviceVector added;
+        UmsDeviceVector removed;
+    } UmsDeltaData;
+
+    /* Checks if two UMS device entries refer to the same filesystem on the same physical device. */
+    ALWAYS_INLINE bool UmsDeviceMatch(const UsbHsFsDevice& lhs, const UsbHsFsDevice& rhs)
+    {
+        return (lhs.usb_if_id == rhs.usb_if_id && lhs.lun == rhs.lun && lhs.fs_idx == rhs.fs_idx);
+    }
+
+    /* Used to hold pre-initialized NCA contexts for a single gamecard application title. */
+    typedef struct {
+        TitleInfo *title_info;  ///< Dynamically allocated title info duplicate for this application. Freed by GameCardTask.
+        NcaContext *nca_ctx;    ///< Dynamically allocated NCA context array with one element per content info. Freed by GameCardTask.
+        bool valid;             ///< Set to true if every NCA context from this title was successfully initialized.
+    } GameCardPrescanEntry;
+
+    /* Used to hold gamecard metadata pre-scan results. */
+    typedef std::vector<GameCardPrescanEntry> GameCardPrescanVector;
+
     /* Custom event types. */
     typedef brls::Event<const StatusInfoData*> StatusInfoEvent;
     typedef brls::Event<GameCardStatus> GameCardStatusEvent;
+    typedef brls::Event<const GameCardPrescanVector*> GameCardPrescanEvent;
     typedef brls::Event<const TitleApplicationMetadataVector*> TitleEvent;
     typedef brls::Event<const UmsDeviceVector*> UmsEvent;
+    typedef brls::Event<const UmsDeltaData*> UmsDeltaEvent;
     typedef brls::Event<UsbHostSpeed> UsbHostEvent;
 
     /* Status info task. */
     /* Its event returns a pointer to a StatusInfoData struct. */
+    /* Network state is queried on the shared worker pool and cached - NIFM calls can block for tens of milliseconds while the network is flapping, */
+    /* and this task shares its handler with the clock/battery refresh, which must never stall the render loop. */
     class StatusInfoTask: public brls::RepeatingTask
     {
         private:
             StatusInfoEvent status_info_event;
             StatusInfoData status_info_data = {0};
 
+            /* Cached network state, written by the worker pool and consumed by run(). */
+            std::mutex network_mtx;
+            std::atomic<bool> network_query_active{false};
+            NifmInternetConnectionType cached_connection_type = static_cast<NifmInternetConnectionType>(0);
+            char cached_ip_addr[0x10] = {0};
+            bool cached_ip_addr_valid = false;
+
+            /* Queries NIFM for the current network state and updates the cached copy. Runs on the shared worker pool. */
+            void UpdateNetworkState(void);
+
         protected:
             void run(retro_time_t current_time) override;
 
@@ -83,6 +122,9 @@ namespace nxdt::tasks
 
     /* Gamecard task. */
     /* Its event returns a GameCardStatus value. */
+    /* As soon as gamecard info is fully loaded, a metadata pre-scan is kicked off on the shared worker pool: it duplicates title info and initializes NCA contexts for every */
+    /* application in the inserted gamecard. This runs while any previous dump is still draining its write tail, so back-to-back dump sessions don't pay the setup cost up front. */
+    /* The pre-scan event fires once the results become available. They remain valid until the gamecard is ejected. */
     class GameCardTask: public brls::RepeatingTask
     {
         private:
@@ -91,6 +133,16 @@ namespace nxdt::tasks
             GameCardStatus prev_gc_status = GameCardStatus_NotInserted;
             bool first_notification = true;
 
+            GameCardPrescanEvent gc_prescan_event;
+            GameCardPrescanVector prescan_entries;
+            std::future<GameCardPrescanVector> prescan_future;
+            u32 prescan_counter = 0;
+
+            void StartPrescan(void);
+            GameCardPrescanVector PrescanGameCard(void);
+            void UpdatePrescanEntries(void);
+            static void ClearPrescanVector(GameCardPrescanVector& entries);
+
         protected:
             void run(retro_time_t current_time) override;
 
@@ -98,7 +150,14 @@ namespace nxdt::tasks
             GameCardTask(void);
             ~GameCardTask(void);
 
+            /* Intentionally left here to let the dump flow retrieve pre-initialized NCA contexts. Returns nullptr while a pre-scan is still running. */
+            const GameCardPrescanVector* GetPrescanEntries(void);
+
             EVENT_SUBSCRIPTION(GameCardStatusEvent, gc_status_event);
+
+            /* Pre-scan event listeners get their own registration functions to avoid clashing with the EVENT_SUBSCRIPTION overloads. */
+            ALWAYS_INLINE GameCardPrescanEvent::Subscription RegisterPrescanListener(GameCardPrescanEvent::Callback cb) { return this->gc_prescan_event.subscribe(cb); }
+            ALWAYS_INLINE void UnregisterPrescanListener(GameCardPrescanEvent::Subscription subscription) { this->gc_prescan_event.unsubscribe(subscription); }
     };
 
     /* Title task. */
@@ -128,12 +187,17 @@ namespace nxdt::tasks
 
     /* USB Mass Storage task. */
     /* Its event returns a pointer to a UmsDeviceVector. */
+    /* A separate delta event returns a pointer to a UmsDeltaData struct with the devices added and removed since the previous change, so listeners can patch their views */
+    /* incrementally instead of rebuilding them from scratch every time a single drive comes or goes. */
     class UmsTask: public brls::RepeatingTask
     {
         private:
             UmsEvent ums_event;
             UmsDeviceVector ums_devices;
 
+            UmsDeltaEvent ums_delta_event;
+            UmsDeltaData ums_delta;
+
             void PopulateUmsDeviceVector(void);
 
         protected:
@@ -147,6 +211,10 @@ namespace nxdt::tasks
             const UmsDeviceVector* GetUmsDevices(void);
 
             EVENT_SUBSCRIPTION(UmsEvent, ums_event);
+
+            /* Delta event listeners get their own registration functions to avoid clashing with the EVENT_SUBSCRIPTION overloads. */
+            ALWAYS_INLINE UmsDeltaEvent::Subscription RegisterDeltaListener(UmsDeltaEvent::Callback cb) { return this->ums_delta_event.subscribe(cb); }
+            ALWAYS_INLINE void UnregisterDeltaListener(UmsDeltaEvent::Subscription subscription) { this->ums_delta_event.unsubscribe(subscription); }
     };
 
     /* USB host device connection task. */
@@ -166,6 +234,36 @@ namespace nxdt::tasks
 
             EVENT_SUBSCRIPTION(UsbHostEvent, usb_host_event);
     };
+
+    /* Idle maintenance task. */
+    /* Keeps a queue of low-priority cache maintenance jobs and feeds them to the shared worker pool one at a time, but only while the console sits idle: no long-running process */
+    /* (e.g. a dump) may be active, and no controller input may have been received for a while. Jobs persist their own results (on-disk or in-memory caches), which is what lets */
+    /* partial progress survive an application exit - a half-built cache simply gets finished during a later idle window. */
+    class IdleMaintenanceTask: public brls::RepeatingTask
+    {
+        private:
+            /* Maintenance job entry. The job function runs on the shared worker pool and returns true once its cache is fully up to date. */
+            /* Returning false re-queues the job, making it run again after the retry delay elapses. */
+            typedef struct {
+                std::string name;               ///< Job name. Only used for logging purposes.
+                std::function<bool(void)> func; ///< Job function.
+            } MaintenanceJob;
+
+            std::deque<MaintenanceJob> jobs;
+            MaintenanceJob cur_job{};
+            std::future<bool> job_future;
+            bool job_active = false;
+
+            PadState pad_state = {0};
+            retro_time_t last_input_time = 0, retry_time = 0;
+
+        protected:
+            void run(retro_time_t current_time) override;
+
+        public:
+            IdleMaintenanceTask(void);
+            ~IdleMaintenanceTask(void);
+    };
 }
 
 #undef EVENT_SUBSCRIPTION
@@ -51,12 +51,16 @@ namespace nxdt::views
             const TitleApplicationMetadata *app_metadata = nullptr;
             bool is_system = false;
             bool click_anim;
+            bool thumbnail_loaded = false;
 
         public:
             TitlesTabItem(const TitleApplicationMetadata *app_metadata, bool is_system, bool click_anim = true);
 
             void playClickAnimation(void) override;
 
+            /* Loads the title icon into the list item. Does nothing if it has already been loaded. */
+            void LoadThumbnail(void);
+
             ALWAYS_INLINE const TitleApplicationMetadata *GetApplicationMetadata(void)
             {
                 return this->app_metadata;
@@ -68,16 +72,49 @@ namespace nxdt::views
             }
     };
 
+    /* Loads title icons into list items in small batches. */
+    /* Decoding every icon at once takes long enough to produce a visible hitch on large title lists, so the work is spread across multiple task ticks instead. */
+    /* List items are displayed right away without a thumbnail, which gets swapped in once their batch is processed. */
+    class ThumbnailLoadTask: public brls::RepeatingTask
+    {
+        private:
+            std::vector<TitlesTabItem*> pending_items{};
+
+        public:
+            ThumbnailLoadTask(void);
+
+            void run(retro_time_t current_time) override;
+
+            /* Replaces the set of list items awaiting thumbnail data. */
+            void SetPendingItems(const std::vector<TitlesTabItem*>& pending_items);
+    };
+
     class TitlesTab: public LayeredErrorFrame
     {
         private:
             RootView *root_view = nullptr;
 
+            ThumbnailLoadTask *thumbnail_load_task = nullptr;
+
             nxdt::tasks::TitleEvent::Subscription title_task_sub;
             bool is_system = false;
 
+            /* Cached metadata set and its prebuilt lowercase-name search index, both updated by PopulateList(). */
+            /* Filtering the list only needs a substring scan per entry - no metadata re-retrieval and no name conversions. */
+            nxdt::tasks::TitleApplicationMetadataVector cached_app_metadata{};
+            std::vector<std::string> search_index{};
+
+            /* Current search query. Lowercase. Empty means no filtering takes place. */
+            std::string search_query{};
+
             void PopulateList(const nxdt::tasks::TitleApplicationMetadataVector* app_metadata);
 
+            /* (Re)renders the list, displaying only the entries that match the current search query. */
+            void UpdateList(void);
+
+            /* Displays the software keyboard and updates the list if the typed search query differs from the current one. */
+            void ShowSearchKeyboard(void);
+
         public:
             TitlesTab(RootView *root_view, bool is_system);
             ~TitlesTab(void);
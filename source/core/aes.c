@@ -44,18 +44,43 @@ size_t aes128XtsNintendoCrypt(Aes128XtsContext *ctx, void *dst, const void *src,
         return 0;
     }
 
-    size_t i, crypt_res = 0;
+    size_t i = 0, crypt_res = 0;
     u64 cur_sector = sector;
 
     u8 *dst_u8 = (u8*)dst;
     const u8 *src_u8 = (const u8*)src;
 
-    for(i = 0; i < size; i += sector_size, cur_sector++)
+    u8 tweaks[AES_XTS_TWEAK_BATCH_SIZE][AES_BLOCK_SIZE];
+    size_t sector_count = (size / sector_size);
+
+    for(size_t j = 0; j < sector_count; j += AES_XTS_TWEAK_BATCH_SIZE)
     {
-        /* We have to force a sector reset on each new sector to actually enable Nintendo AES-XTS cipher tweak. */
-        aes128XtsContextResetSector(ctx, cur_sector, true);
-        crypt_res = (encrypt ? aes128XtsEncrypt(ctx, dst_u8 + i, src_u8 + i, sector_size) : aes128XtsDecrypt(ctx, dst_u8 + i, src_u8 + i, sector_size));
-        if (crypt_res != sector_size) break;
+        size_t batch_size = (sector_count - j);
+        if (batch_size > AES_XTS_TWEAK_BATCH_SIZE) batch_size = AES_XTS_TWEAK_BATCH_SIZE;
+
+        /* Generate plaintext tweaks for the whole batch. This mirrors the Nintendo tweak layout from aes128XtsContextResetSector(): the sector number as a 128-bit big endian integer, */
+        /* which places it in the last 8 tweak bytes. */
+        for(size_t k = 0; k < batch_size; k++)
+        {
+            u64 tweak_sector = (cur_sector + k);
+
+            for(u8 l = 0; l < 8; l++)
+            {
+                tweaks[k][l] = 0;
+                tweaks[k][8 + l] = (u8)(tweak_sector >> (64 - ((l + 1) * 8)));
+            }
+        }
+
+        /* Encrypt all batch tweaks back to back. The blocks are independent from each other, which keeps the AES engine fed instead of serializing each tweak with its sector data. */
+        for(size_t k = 0; k < batch_size; k++) aes128EncryptBlock(&(ctx->tweak_ctx), tweaks[k], tweaks[k]);
+
+        /* Perform XTS crypto on each sector using its precomputed tweak. */
+        for(size_t k = 0; k < batch_size; k++, i += sector_size, cur_sector++)
+        {
+            memcpy(ctx->tweak, tweaks[k], AES_BLOCK_SIZE);
+            crypt_res = (encrypt ? aes128XtsEncrypt(ctx, dst_u8 + i, src_u8 + i, sector_size) : aes128XtsDecrypt(ctx, dst_u8 + i, src_u8 + i, sector_size));
+            if (crypt_res != sector_size) return i;
+        }
     }
 
     return i;
@@ -0,0 +1,303 @@
+/*
+ * benchmark.c
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "nxdt_utils.h"
+#include "benchmark.h"
+#include "ums.h"
+#include "config.h"
+
+#define BENCHMARK_FILE_NAME         "nxdt_benchmark.tmp"
+#define BENCHMARK_PASS_SIZE         0x4000000                   /* 64 MiB written per block size. */
+#define BENCHMARK_FREE_SPACE_MARGIN 0x1000000                   /* 16 MiB. */
+
+#define BENCHMARK_SD_CARD_ROOT_PATH "sdmc:/"
+#define BENCHMARK_SD_CARD_KEY       "sd_card"
+
+/* Global variables. */
+
+/// Block sizes probed by each storage benchmark, in ascending order.
+static const u32 g_benchmarkBlockSizes[BENCHMARK_NUM_BLOCK_SIZES] = { 0x100000, 0x400000, 0x800000, 0x1000000 };
+
+/* Function prototypes. */
+
+static bool benchmarkGenerateConfigKeyByUmsDevice(const UsbHsFsDevice *device, char *out_key, size_t out_key_size);
+static bool benchmarkGenerateConfigKeyByDevicePath(const char *root_path, char *out_key, size_t out_key_size);
+static double benchmarkRunWritePass(const char *file_path, u8 *buf, u32 block_size);
+
+BenchmarkDeviceResult *benchmarkAllStorageDevices(u32 *out_count)
+{
+    if (!out_count)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return NULL;
+    }
+
+    u32 ums_device_count = 0, result_count = 0;
+    UsbHsFsDevice *ums_devices = NULL;
+    BenchmarkDeviceResult *results = NULL;
+
+    char config_key[0x40] = {0};
+
+    /* Get UMS devices. A NULL pointer isn't fatal - we'll still benchmark the SD card. */
+    ums_devices = umsGetDevices(&ums_device_count);
+
+    /* Allocate memory for the output array. */
+    results = calloc(ums_device_count + 1, sizeof(BenchmarkDeviceResult));
+    if (!results)
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the benchmark results!");
+        goto end;
+    }
+
+    /* Benchmark SD card. */
+    BenchmarkDeviceResult *cur_result = &(results[result_count]);
+    snprintf(cur_result->name, sizeof(cur_result->name), "SD card");
+    if (benchmarkStorageDevice(BENCHMARK_SD_CARD_ROOT_PATH, BENCHMARK_SD_CARD_KEY, cur_result)) result_count++;
+
+    /* Benchmark UMS devices. Failures on individual devices don't make the whole operation fail. */
+    for(u32 i = 0; i < ums_device_count; i++)
+    {
+        UsbHsFsDevice *ums_device = &(ums_devices[i]);
+        cur_result = &(results[result_count]);
+
+        /* Generate display name and root path for this device. */
+        snprintf(cur_result->name, sizeof(cur_result->name), "%s", ums_device->product_name[0] ? ums_device->product_name : ums_device->name);
+
+        char root_path[0x30] = {0};
+        snprintf(root_path, sizeof(root_path), "%s/", ums_device->name);
+
+        /* Generate config key for this device. */
+        if (!benchmarkGenerateConfigKeyByUmsDevice(ums_device, config_key, sizeof(config_key))) continue;
+
+        /* Benchmark device. */
+        if (benchmarkStorageDevice(root_path, config_key, cur_result)) result_count++;
+    }
+
+    if (!result_count)
+    {
+        LOG_MSG_ERROR("All storage benchmarks failed!");
+        free(results);
+        results = NULL;
+    }
+
+end:
+    if (ums_devices) free(ums_devices);
+
+    if (results) *out_count = result_count;
+
+    return results;
+}
+
+bool benchmarkStorageDevice(const char *root_path, const char *config_key, BenchmarkDeviceResult *out_result)
+{
+    size_t root_path_len = 0;
+
+    if (!root_path || !(root_path_len = strlen(root_path)) || root_path[root_path_len - 1] != '/' || !out_result)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    u64 free_space = 0;
+    u8 *buf = NULL;
+    char file_path[0x60] = {0};
+    bool success = false;
+
+    /* Keep the display name provided by the caller, if any. */
+    snprintf(out_result->root_path, sizeof(out_result->root_path), "%s", root_path);
+    memset(out_result->block_results, 0, sizeof(out_result->block_results));
+    out_result->best_block_size = 0;
+    out_result->best_speed = 0;
+
+    /* Make sure there's enough free space on the target device. */
+    if (!utilsGetFileSystemStatsByPath(root_path, NULL, &free_space) || free_space <= (BENCHMARK_PASS_SIZE + BENCHMARK_FREE_SPACE_MARGIN))
+    {
+        LOG_MSG_ERROR("Not enough free space available in \"%s\" to run a benchmark!", root_path);
+        goto end;
+    }
+
+    /* Allocate memory for the write buffer, using the biggest probed block size. */
+    buf = malloc(g_benchmarkBlockSizes[BENCHMARK_NUM_BLOCK_SIZES - 1]);
+    if (!buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the benchmark write buffer!");
+        goto end;
+    }
+
+    /* Fill the write buffer with a fixed pattern. The actual contents are irrelevant for sequential write throughput. */
+    memset(buf, 0xAA, g_benchmarkBlockSizes[BENCHMARK_NUM_BLOCK_SIZES - 1]);
+
+    /* Generate output file path. */
+    snprintf(file_path, sizeof(file_path), "%s" BENCHMARK_FILE_NAME, root_path);
+
+    /* Run a write pass per block size. */
+    for(u32 i = 0; i < BENCHMARK_NUM_BLOCK_SIZES; i++)
+    {
+        BenchmarkBlockResult *block_result = &(out_result->block_results[i]);
+        block_result->block_size = g_benchmarkBlockSizes[i];
+        block_result->speed = benchmarkRunWritePass(file_path, buf, g_benchmarkBlockSizes[i]);
+
+        LOG_MSG_DEBUG("\"%s\": 0x%X bytes block size -> %.2lf MiB/s.", root_path, block_result->block_size, block_result->speed);
+
+        /* Update best block size. */
+        if (block_result->speed > out_result->best_speed)
+        {
+            out_result->best_block_size = block_result->block_size;
+            out_result->best_speed = block_result->speed;
+        }
+    }
+
+    /* Consider the benchmark successful if at least one pass went through. */
+    success = (out_result->best_block_size > 0);
+
+    /* Remember the best block size for this device. */
+    if (success && config_key)
+    {
+        char config_path[0x60] = {0};
+        snprintf(config_path, sizeof(config_path), "benchmark/%s", config_key);
+        configSetInteger(config_path, (int)out_result->best_block_size);
+    }
+
+end:
+    if (buf) free(buf);
+
+    return success;
+}
+
+u32 benchmarkGetBestBlockSizeByDevicePath(const char *root_path)
+{
+    char config_key[0x40] = {0}, config_path[0x60] = {0};
+    int best_block_size = 0;
+
+    if (!benchmarkGenerateConfigKeyByDevicePath(root_path, config_key, sizeof(config_key))) return 0;
+
+    snprintf(config_path, sizeof(config_path), "benchmark/%s", config_key);
+    best_block_size = configGetInteger(config_path);
+
+    return (best_block_size > 0 ? (u32)best_block_size : 0);
+}
+
+static bool benchmarkGenerateConfigKeyByUmsDevice(const UsbHsFsDevice *device, char *out_key, size_t out_key_size)
+{
+    if (!device || !out_key || out_key_size < 2)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Use the serial number to identify the device, if available. Mount names aren't stable across replugs. */
+    const char *id = (device->serial_number[0] ? device->serial_number : (device->product_name[0] ? device->product_name : device->name));
+
+    /* Sanitize the identifier. JSON config paths use forward slashes as separators, so only alphanumeric characters are kept. */
+    size_t j = (size_t)snprintf(out_key, out_key_size, "ums_");
+
+    for(size_t i = 0; id[i] && j < (out_key_size - 1); i++) out_key[j++] = (isalnum((unsigned char)id[i]) ? (char)tolower((unsigned char)id[i]) : '_');
+
+    out_key[j] = '\0';
+
+    return true;
+}
+
+static bool benchmarkGenerateConfigKeyByDevicePath(const char *root_path, char *out_key, size_t out_key_size)
+{
+    size_t root_path_len = 0;
+
+    if (!root_path || !(root_path_len = strlen(root_path)) || !out_key || !out_key_size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* SD card paths map to a fixed key. */
+    if (!strncmp(root_path, BENCHMARK_SD_CARD_ROOT_PATH, 5))
+    {
+        snprintf(out_key, out_key_size, BENCHMARK_SD_CARD_KEY);
+        return true;
+    }
+
+    u32 ums_device_count = 0;
+    UsbHsFsDevice *ums_devices = NULL;
+    bool success = false;
+
+    /* Look for a UMS device with a mount name matching the provided path. */
+    ums_devices = umsGetDevices(&ums_device_count);
+    if (!ums_devices) return false;
+
+    for(u32 i = 0; i < ums_device_count; i++)
+    {
+        UsbHsFsDevice *ums_device = &(ums_devices[i]);
+        size_t name_len = strlen(ums_device->name);
+
+        if (root_path_len <= name_len || strncmp(root_path, ums_device->name, name_len) != 0) continue;
+
+        success = benchmarkGenerateConfigKeyByUmsDevice(ums_device, out_key, out_key_size);
+        break;
+    }
+
+    free(ums_devices);
+
+    if (!success) LOG_MSG_ERROR("Unable to find a UMS device matching \"%s\"!", root_path);
+
+    return success;
+}
+
+static double benchmarkRunWritePass(const char *file_path, u8 *buf, u32 block_size)
+{
+    FILE *fp = NULL;
+    u64 offset = 0, start_tick = 0, elapsed_ns = 0;
+    double speed = 0;
+
+    /* Open output file. Buffering is disabled to make sure each write hits the target filesystem with the probed block size. */
+    fp = fopen(file_path, "wb");
+    if (!fp)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\" for writing!", file_path);
+        return speed;
+    }
+
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    /* Write data until the pass size is reached. */
+    start_tick = armGetSystemTick();
+
+    for(offset = 0; offset < BENCHMARK_PASS_SIZE; offset += block_size)
+    {
+        if (fwrite(buf, 1, block_size, fp) != block_size)
+        {
+            LOG_MSG_ERROR("Failed to write 0x%X bytes block at offset 0x%lX to \"%s\"!", block_size, offset, file_path);
+            break;
+        }
+    }
+
+    /* Flush data to make sure device-level write caches don't skew the measurement. */
+    fflush(fp);
+    fsync(fileno(fp));
+
+    elapsed_ns = armTicksToNs(armGetSystemTick() - start_tick);
+
+    /* Calculate write throughput in MiB/s, but only if the whole pass was written. */
+    if (offset >= BENCHMARK_PASS_SIZE && elapsed_ns) speed = (((double)BENCHMARK_PASS_SIZE / (double)0x100000) / ((double)elapsed_ns / 1000000000.0));
+
+    fclose(fp);
+    remove(file_path);
+
+    return speed;
+}
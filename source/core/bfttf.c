@@ -25,6 +25,12 @@
 #include "romfs.h"
 #include "title.h"
 
+#define BFTTF_FONT_CACHE_PATH           DEVOPTAB_SDMC_DEVICE APP_BASE_PATH "font_cache.bin"
+#define BFTTF_FONT_CACHE_MAGIC          0x4E584643  /* "NXFC". */
+#define BFTTF_FONT_CACHE_VERSION        1
+
+#define BFTTF_FONT_CACHE_MAX_FONT_SIZE  0x1000000   /* 16 MiB. */
+
 /* Type definitions. */
 
 typedef struct {
@@ -34,6 +40,27 @@ typedef struct {
     u8 *data;
 } BfttfFontInfo;
 
+/// Header for the decoded font cache file stored on the SD card.
+/// Immediately followed by 'entry_count' BfttfFontCacheEntry elements.
+typedef struct {
+    u32 magic;          ///< "NXFC".
+    u32 version;        ///< Cache format version. Must match BFTTF_FONT_CACHE_VERSION.
+    u32 hos_version;    ///< Horizon OS version the cached fonts were decoded under. A firmware update invalidates the cache.
+    u32 entry_count;    ///< Number of serialized font entries. Must match g_fontInfoCount.
+} BfttfFontCacheHeader;
+
+NXDT_ASSERT(BfttfFontCacheHeader, 0x10);
+
+/// Serialized font entry from the decoded font cache file. Immediately followed by 'size' bytes of decoded font data.
+/// Entries are stored in the same order as the g_fontInfo array.
+typedef struct {
+    u64 title_id;       ///< System title ID the font was extracted from. Must match the corresponding g_fontInfo entry.
+    u32 size;           ///< Decoded font data size.
+    u8 reserved[0x4];
+} BfttfFontCacheEntry;
+
+NXDT_ASSERT(BfttfFontCacheEntry, 0x10);
+
 /* Global variables. */
 
 static Mutex g_bfttfMutex = 0;
@@ -54,6 +81,9 @@ static const u32 g_bfttfKey = 0x06186249;
 
 /* Function prototypes. */
 
+static bool bfttfLoadFontCache(void);
+static void bfttfSaveFontCache(void);
+
 static bool bfttfDecodeFont(BfttfFontInfo *font_info);
 
 bool bfttfInitialize(void)
@@ -70,8 +100,15 @@ bool bfttfInitialize(void)
         u32 count = 0;
         u64 prev_title_id = 0;
 
+        /* Try to load the decoded font cache first. A cache hit skips title lookups, NCA crypto and the XOR decode entirely. */
+        if (bfttfLoadFontCache())
+        {
+            ret = g_bfttfInterfaceInit = true;
+            break;
+        }
+
         /* Allocate memory for a temporary NCA context. */
-        nca_ctx = calloc(1, sizeof(NcaContext));
+        nca_ctx = ncaAllocateContexts(1);
         if (!nca_ctx)
         {
             LOG_MSG_ERROR("Failed to allocate memory for temporary NCA context!");
@@ -173,11 +210,15 @@ bool bfttfInitialize(void)
         /* Update flags. */
         ret = g_bfttfInterfaceInit = (count > 0);
         if (!ret) LOG_MSG_ERROR("No BFTTF fonts retrieved!");
+
+        /* Save the decoded fonts to the SD card cache so further launches under this firmware version skip this whole block. */
+        /* Partial results are purposely not cached - missing fonts get retried from scratch on the next launch. */
+        if (ret && count == g_fontInfoCount) bfttfSaveFontCache();
     }
 
     romfsFreeContext(&romfs_ctx);
 
-    if (nca_ctx) free(nca_ctx);
+    if (nca_ctx) ncaFreeContexts(nca_ctx, 1);
 
     return ret;
 }
@@ -233,6 +274,168 @@ bool bfttfGetFontByType(BfttfFontData *font_data, u8 font_type)
     return ret;
 }
 
+static bool bfttfLoadFontCache(void)
+{
+    FILE *fp = NULL;
+    BfttfFontCacheHeader cache_header = {0};
+    u32 loaded_count = 0;
+    bool success = false;
+
+    /* Open cache file. It's perfectly fine for it not to exist yet. */
+    fp = fopen(BFTTF_FONT_CACHE_PATH, "rb");
+    if (!fp) return false;
+
+    /* Read and validate cache header. */
+    if (fread(&cache_header, 1, sizeof(BfttfFontCacheHeader), fp) != sizeof(BfttfFontCacheHeader))
+    {
+        LOG_MSG_ERROR("Failed to read font cache header!");
+        goto end;
+    }
+
+    if (cache_header.magic != BFTTF_FONT_CACHE_MAGIC || cache_header.version != BFTTF_FONT_CACHE_VERSION || cache_header.hos_version != hosversionGet() || \
+        cache_header.entry_count != g_fontInfoCount)
+    {
+        LOG_MSG_INFO("Font cache is stale or unusable (0x%08X, %u, 0x%08X, %u). Discarding it.", cache_header.magic, cache_header.version, cache_header.hos_version, \
+                     cache_header.entry_count);
+        goto end;
+    }
+
+    /* Load decoded font data. */
+    for(u32 i = 0; i < g_fontInfoCount; i++)
+    {
+        BfttfFontInfo *font_info = &(g_fontInfo[i]);
+        BfttfFontCacheEntry cache_entry = {0};
+
+        /* Read and validate cache entry. */
+        if (fread(&cache_entry, 1, sizeof(BfttfFontCacheEntry), fp) != sizeof(BfttfFontCacheEntry))
+        {
+            LOG_MSG_ERROR("Failed to read font cache entry #%u!", i);
+            goto end;
+        }
+
+        if (cache_entry.title_id != font_info->title_id || cache_entry.size <= 8 || cache_entry.size > BFTTF_FONT_CACHE_MAX_FONT_SIZE)
+        {
+            LOG_MSG_ERROR("Invalid font cache entry #%u! (%016lX, 0x%X).", i, cache_entry.title_id, cache_entry.size);
+            goto end;
+        }
+
+        /* Allocate memory for the decoded font data. */
+        if (!(font_info->data = malloc(cache_entry.size)))
+        {
+            LOG_MSG_ERROR("Failed to allocate 0x%X bytes for font cache entry #%u!", cache_entry.size, i);
+            goto end;
+        }
+
+        /* Read decoded font data. */
+        if (fread(font_info->data, 1, cache_entry.size, fp) != cache_entry.size)
+        {
+            LOG_MSG_ERROR("Failed to read 0x%X bytes long font cache entry #%u!", cache_entry.size, i);
+            goto end;
+        }
+
+        /* Update font size and loaded entry count. */
+        font_info->size = cache_entry.size;
+        loaded_count++;
+    }
+
+    LOG_MSG_INFO("Loaded %u decoded font(s) from the font cache.", loaded_count);
+
+    /* Update flag. */
+    success = true;
+
+end:
+    fclose(fp);
+
+    if (!success)
+    {
+        /* Free partially loaded font data and get rid of the cache file - it gets rebuilt after a full retrieval. */
+        for(u32 i = 0; i <= loaded_count && i < g_fontInfoCount; i++)
+        {
+            BfttfFontInfo *font_info = &(g_fontInfo[i]);
+
+            font_info->size = 0;
+
+            if (font_info->data)
+            {
+                free(font_info->data);
+                font_info->data = NULL;
+            }
+        }
+
+        remove(BFTTF_FONT_CACHE_PATH);
+        utilsCommitSdCardFileSystemChanges();
+    }
+
+    return success;
+}
+
+static void bfttfSaveFontCache(void)
+{
+    FILE *fp = NULL;
+    bool success = false;
+
+    BfttfFontCacheHeader cache_header = {
+        .magic = BFTTF_FONT_CACHE_MAGIC,
+        .version = BFTTF_FONT_CACHE_VERSION,
+        .hos_version = hosversionGet(),
+        .entry_count = g_fontInfoCount
+    };
+
+    /* Open cache file. */
+    fp = fopen(BFTTF_FONT_CACHE_PATH, "wb");
+    if (!fp)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\" for writing!", BFTTF_FONT_CACHE_PATH);
+        return;
+    }
+
+    /* Write cache header. */
+    if (fwrite(&cache_header, 1, sizeof(BfttfFontCacheHeader), fp) != sizeof(BfttfFontCacheHeader))
+    {
+        LOG_MSG_ERROR("Failed to write font cache header!");
+        goto end;
+    }
+
+    /* Write decoded font data. */
+    for(u32 i = 0; i < g_fontInfoCount; i++)
+    {
+        BfttfFontInfo *font_info = &(g_fontInfo[i]);
+
+        BfttfFontCacheEntry cache_entry = {
+            .title_id = font_info->title_id,
+            .size = font_info->size,
+            .reserved = {0}
+        };
+
+        /* Write cache entry. */
+        if (fwrite(&cache_entry, 1, sizeof(BfttfFontCacheEntry), fp) != sizeof(BfttfFontCacheEntry))
+        {
+            LOG_MSG_ERROR("Failed to write font cache entry #%u!", i);
+            goto end;
+        }
+
+        /* Write decoded font data. */
+        if (fwrite(font_info->data, 1, font_info->size, fp) != font_info->size)
+        {
+            LOG_MSG_ERROR("Failed to write 0x%X bytes long font cache entry #%u!", font_info->size, i);
+            goto end;
+        }
+    }
+
+    LOG_MSG_INFO("Saved %u decoded font(s) to the font cache.", g_fontInfoCount);
+
+    /* Update flag. */
+    success = true;
+
+end:
+    fclose(fp);
+
+    /* Get rid of the cache file if an error occurred while writing it. */
+    if (!success) remove(BFTTF_FONT_CACHE_PATH);
+
+    utilsCommitSdCardFileSystemChanges();
+}
+
 static bool bfttfDecodeFont(BfttfFontInfo *font_info)
 {
     if (!font_info || font_info->size <= 8 || !IS_ALIGNED(font_info->size, 4) || !font_info->data)
@@ -20,6 +20,11 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+/* Hot dump-path module. Performance build flavors may strip verbose logging from this translation unit at compile time. */
+#ifdef LOG_MODULE_LEVEL_HOT
+#define LOG_MODULE_LEVEL    LOG_MODULE_LEVEL_HOT
+#endif
+
 #include "nxdt_utils.h"
 #include "bktr.h"
 #include "aes.h"
@@ -85,6 +90,7 @@ static bool bktrInitializeAesCtrExStorageContext(BucketTreeContext *out, NcaFsSe
 static bool bktrReadAesCtrExStorage(BucketTreeVisitor *visitor, void *out, u64 read_size, u64 offset);
 
 static bool bktrReadCompressedStorage(BucketTreeVisitor *visitor, void *out, u64 read_size, u64 offset);
+static void *bktrGetCompressedScratchBuffer(BucketTreeContext *ctx, u64 buffer_size);
 
 static bool bktrReadSubStorage(BucketTreeSubStorage *substorage, BucketTreeSubStorageReadParams *params);
 NX_INLINE void bktrInitializeSubStorageReadParams(BucketTreeSubStorageReadParams *out, void *buffer, u64 offset, u64 size, u64 virtual_offset, u32 ctr_val, bool aes_ctr_ex_crypt, u8 parent_storage_type);
@@ -500,6 +506,119 @@ end:
     return success;
 }
 
+bool bktrClassifyBlocksWithinIndirectStorageRange(BucketTreeContext *ctx, BucketTreeBlockClassification *blocks, u32 block_count)
+{
+    if (!bktrIsValidContext(ctx) || (ctx->storage_type != BucketTreeStorageType_Indirect && ctx->storage_type != BucketTreeStorageType_Compressed) || \
+        (ctx->storage_type == BucketTreeStorageType_Compressed && ctx->substorages[0].type != BucketTreeSubStorageType_Indirect) || !blocks || !block_count)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    BucketTreeVisitor visitor = {0};
+    bool success = false;
+
+    /* Validate the provided block extents and reset all classification flags. */
+    for(u32 i = 0; i < block_count; i++)
+    {
+        if (!bktrIsBlockWithinStorageRange(ctx, blocks[i].size, blocks[i].offset) || (i > 0 && blocks[i].offset < blocks[i - 1].offset))
+        {
+            LOG_MSG_ERROR("Invalid block extents! (0x%lX, 0x%lX) (#%u).", blocks[i].offset, blocks[i].size, i);
+            return false;
+        }
+
+        blocks[i].updated = false;
+    }
+
+    /* Check if we're dealing with a Compressed storage. */
+    /* Compressed entry nodes must be translated into Indirect Storage extents on a per-block basis, so we just perform individual lookups for these. */
+    /* The sorted input order still lets consecutive lookups take advantage of the entry set node cache. */
+    if (ctx->storage_type == BucketTreeStorageType_Compressed)
+    {
+        for(u32 i = 0; i < block_count; i++)
+        {
+            if (!bktrIsBlockWithinIndirectStorageRange(ctx, blocks[i].offset, blocks[i].size, &(blocks[i].updated)))
+            {
+                LOG_MSG_ERROR("Failed to classify 0x%lX-byte long Compressed storage block at offset 0x%lX! (#%u).", blocks[i].size, blocks[i].offset, i);
+                goto end;
+            }
+        }
+
+        success = true;
+        goto end;
+    }
+
+    /* Find the storage entry for the first block. */
+    if (!bktrFindStorageEntry(ctx, blocks[0].offset, &visitor))
+    {
+        LOG_MSG_ERROR("Unable to find %s storage entry for offset 0x%lX!", bktrGetStorageTypeName(ctx->storage_type), blocks[0].offset);
+        goto end;
+    }
+
+    /* Validate start entry node. */
+    BucketTreeIndirectStorageEntry *start_entry = (BucketTreeIndirectStorageEntry*)visitor.entry;
+    if (!bktrIsOffsetWithinStorageRange(ctx, start_entry->virtual_offset) || start_entry->virtual_offset > blocks[0].offset)
+    {
+        LOG_MSG_ERROR("Invalid Indirect Storage entry! (0x%lX) (#1).", start_entry->virtual_offset);
+        goto end;
+    }
+
+    /* Walk the Indirect Storage entry nodes sequentially, merging their virtual extents against the sorted block extents as we go. */
+    u64 span_start = start_entry->virtual_offset;
+    bool is_patch = (start_entry->storage_index == BucketTreeIndirectStorageIndex_Patch);
+    u32 block_idx = 0;
+
+    while(block_idx < block_count)
+    {
+        u64 span_end = ctx->end_offset;
+        BucketTreeIndirectStorageEntry *next_entry = NULL;
+
+        /* Retrieve the next entry node to determine the end of the current entry node's virtual extents. */
+        if (bktrVisitorCanMoveNext(&visitor))
+        {
+            if (!bktrVisitorMoveNext(&visitor))
+            {
+                LOG_MSG_ERROR("Failed to retrieve next Indirect Storage entry!");
+                goto end;
+            }
+
+            /* Validate next entry node. */
+            next_entry = (BucketTreeIndirectStorageEntry*)visitor.entry;
+            if (!bktrIsOffsetWithinStorageRange(ctx, next_entry->virtual_offset) || next_entry->virtual_offset <= span_start)
+            {
+                LOG_MSG_ERROR("Invalid Indirect Storage entry! (0x%lX) (#2).", next_entry->virtual_offset);
+                goto end;
+            }
+
+            span_end = next_entry->virtual_offset;
+        }
+
+        /* Flag all remaining blocks that overlap the current entry node's virtual extents, if it uses the Patch storage index. */
+        if (is_patch)
+        {
+            for(u32 i = block_idx; i < block_count && blocks[i].offset < span_end; i++)
+            {
+                if ((blocks[i].offset + blocks[i].size) > span_start) blocks[i].updated = true;
+            }
+        }
+
+        /* Skip blocks that are fully covered by the entry nodes we have processed so far. */
+        while(block_idx < block_count && (blocks[block_idx].offset + blocks[block_idx].size) <= span_end) block_idx++;
+
+        /* Break out of the loop if we have consumed the last entry node. */
+        if (!next_entry) break;
+
+        /* Update span properties. */
+        span_start = span_end;
+        is_patch = (next_entry->storage_index == BucketTreeIndirectStorageIndex_Patch);
+    }
+
+    success = true;
+
+end:
+    return success;
+}
+
 #if LOG_LEVEL <= LOG_LEVEL_ERROR
 static const char *bktrGetStorageTypeName(u8 storage_type)
 {
@@ -980,17 +1099,17 @@ static bool bktrReadCompressedStorage(BucketTreeVisitor *visitor, void *out, u64
             case BucketTreeCompressedStorageCompressionType_LZ4:
             {
                 /* We can't randomly access data that's compressed. */
-                /* Let's be lazy and allocate memory for the full entry, read it and then decompress it. */
+                /* Let's be lazy and grab scratch memory for the full entry, read it and then decompress it. */
                 const u64 data_offset = (compressed_storage_base_offset + (u64)cur_entry.physical_offset);
                 const u64 compressed_data_size = (u64)cur_entry.physical_size;
                 const u64 decompressed_data_size = (next_entry_offset - cur_entry_offset);
                 const u64 buffer_size = LZ4_DECOMPRESS_INPLACE_BUFFER_SIZE(decompressed_data_size);
                 u8 *buffer = NULL, *read_ptr = NULL;
 
-                buffer = calloc(1, buffer_size);
+                buffer = bktrGetCompressedScratchBuffer(ctx, buffer_size);
                 if (!buffer)
                 {
-                    LOG_MSG_ERROR("Failed to allocate 0x%lX-byte long buffer for data decompression! (0x%lX).", buffer_size, decompressed_data_size);
+                    LOG_MSG_ERROR("Failed to retrieve 0x%lX-byte long scratch buffer for data decompression! (0x%lX).", buffer_size, decompressed_data_size);
                     break;
                 }
 
@@ -1002,7 +1121,6 @@ static bool bktrReadCompressedStorage(BucketTreeVisitor *visitor, void *out, u64
                 if (!bktrReadSubStorage(&(ctx->substorages[0]), &params))
                 {
                     LOG_MSG_ERROR("Failed to read 0x%lX-byte long compressed block from offset 0x%lX!", compressed_data_size, data_offset);
-                    free(buffer);
                     break;
                 }
 
@@ -1011,15 +1129,13 @@ static bool bktrReadCompressedStorage(BucketTreeVisitor *visitor, void *out, u64
                 if ((lz4_res = LZ4_decompress_safe((char*)read_ptr, (char*)buffer, (int)compressed_data_size, (int)buffer_size)) != (int)decompressed_data_size)
                 {
                     LOG_MSG_ERROR("Failed to decompress 0x%lX-byte long compressed block! (%d).", compressed_data_size, lz4_res);
-                    free(buffer);
                     break;
                 }
 
                 /* Copy the data we need. */
                 memcpy(out, buffer + (offset - cur_entry_offset), read_size);
 
-                /* Free allocated buffer and update return value. */
-                free(buffer);
+                /* Update return value. */
                 success = true;
 
                 break;
@@ -1043,6 +1159,27 @@ end:
     return success;
 }
 
+static void *bktrGetCompressedScratchBuffer(BucketTreeContext *ctx, u64 buffer_size)
+{
+    /* Reuse the persistent scratch buffer if it's already big enough. Sustained Compressed Storage reads perform zero allocations this way. */
+    if (ctx->compressed_scratch && ctx->compressed_scratch_size >= buffer_size) return ctx->compressed_scratch;
+
+    /* Grow the scratch buffer. */
+    void *buffer = calloc(1, buffer_size);
+    if (!buffer)
+    {
+        LOG_MSG_ERROR("Failed to allocate 0x%lX-byte long scratch buffer for data decompression!", buffer_size);
+        return NULL;
+    }
+
+    if (ctx->compressed_scratch) free(ctx->compressed_scratch);
+
+    ctx->compressed_scratch = buffer;
+    ctx->compressed_scratch_size = buffer_size;
+
+    return buffer;
+}
+
 static bool bktrReadSubStorage(BucketTreeSubStorage *substorage, BucketTreeSubStorageReadParams *params)
 {
     if (!bktrIsValidSubStorage(substorage) || !params || !params->buffer || !params->size)
@@ -1230,6 +1367,26 @@ static bool bktrFindStorageEntry(BucketTreeContext *ctx, u64 virtual_offset, Buc
     const u64 *start_ptr = NULL, *end_ptr = NULL;
     bool success = false;
 
+    /* Check the MRU node cache before walking the tree. Sequential reads mostly land on the last resolved entry sets. */
+    for(u8 i = 0; i < ctx->node_cache_count; i++)
+    {
+        BucketTreeNodeCacheEntry cache_entry = ctx->node_cache[i];
+        if (virtual_offset < cache_entry.start_offset || virtual_offset >= cache_entry.end_offset) continue;
+
+        /* Move the cache hit to the front of the MRU cache. */
+        if (i > 0)
+        {
+            memmove(&(ctx->node_cache[1]), &(ctx->node_cache[0]), i * sizeof(BucketTreeNodeCacheEntry));
+            ctx->node_cache[0] = cache_entry;
+        }
+
+        /* Find the entry, skipping the offset node / L2 node walk entirely. */
+        success = bktrFindEntry(ctx, out_visitor, virtual_offset, cache_entry.entry_set_index);
+        if (!success) LOG_MSG_ERROR("Failed to retrieve storage entry from cached entry set!");
+
+        return success;
+    }
+
     if (bktrIsExistOffsetL2OnL1(ctx) && virtual_offset < *bktrGetOffsetNodeBegin(offset_node))
     {
         start_ptr = bktrGetOffsetNodeEnd(offset_node);
@@ -1270,7 +1427,20 @@ static bool bktrFindStorageEntry(BucketTreeContext *ctx, u64 virtual_offset, Buc
 
     /* Find the entry. */
     success = bktrFindEntry(ctx, out_visitor, virtual_offset, entry_set_index);
-    if (!success) LOG_MSG_ERROR("Failed to retrieve storage entry!");
+    if (!success)
+    {
+        LOG_MSG_ERROR("Failed to retrieve storage entry!");
+        goto end;
+    }
+
+    /* Cache the resolved entry set range at the front of the MRU cache. */
+    memmove(&(ctx->node_cache[1]), &(ctx->node_cache[0]), (BKTR_NODE_CACHE_COUNT - 1) * sizeof(BucketTreeNodeCacheEntry));
+
+    ctx->node_cache[0].entry_set_index = entry_set_index;
+    ctx->node_cache[0].start_offset = out_visitor->entry_set.start;
+    ctx->node_cache[0].end_offset = out_visitor->entry_set.header.offset;
+
+    if (ctx->node_cache_count < BKTR_NODE_CACHE_COUNT) ctx->node_cache_count++;
 
 end:
     return success;
@@ -30,16 +30,32 @@
 #define CERT_TYPE(sig)                  (pub_key_type == CertPubKeyType_Rsa4096 ? CertType_Sig##sig##_PubKeyRsa4096 : \
                                         (pub_key_type == CertPubKeyType_Rsa2048 ? CertType_Sig##sig##_PubKeyRsa2048 : CertType_Sig##sig##_PubKeyEcc480))
 
+/* Type definitions. */
+
+/// Cached certificate entry. Certificates are immutable, so once retrieved they're kept in memory for the lifetime of the process.
+typedef struct {
+    char name[SAVE_FS_LIST_MAX_NAME_LENGTH];    ///< Certificate entry name within the ES certificate system savefile.
+    Certificate cert;                           ///< Retrieved certificate data.
+} CertCacheEntry;
+
 /* Global variables. */
 
 static save_ctx_t *g_esCertSaveCtx = NULL;
 static Mutex g_esCertSaveMutex = 0;
 
+/// Protected by g_esCertSaveMutex.
+static CertCacheEntry *g_certCache = NULL;
+static u32 g_certCacheCount = 0;
+
 /* Function prototypes. */
 
 static bool certOpenEsCertSaveFile(void);
 static void certCloseEsCertSaveFile(void);
 
+static bool certRetrieveCertificateByNameCached(Certificate *dst, const char *name);
+static bool certGetCertificateFromCache(Certificate *dst, const char *name);
+static void certAddCertificateToCache(const Certificate *cert, const char *name);
+
 static bool _certRetrieveCertificateByName(Certificate *dst, const char *name);
 static u8 certGetCertificateType(void *data, u64 data_size);
 
@@ -61,8 +77,9 @@ bool certRetrieveCertificateByName(Certificate *dst, const char *name)
 
     SCOPED_LOCK(&g_esCertSaveMutex)
     {
-        if (!certOpenEsCertSaveFile()) break;
-        ret = _certRetrieveCertificateByName(dst, name);
+        ret = certRetrieveCertificateByNameCached(dst, name);
+
+        /* The savefile is only opened on cache misses. This is a no-op if every certificate was served from the cache. */
         certCloseEsCertSaveFile();
     }
 
@@ -81,8 +98,9 @@ bool certRetrieveCertificateChainBySignatureIssuer(CertificateChain *dst, const
 
     SCOPED_LOCK(&g_esCertSaveMutex)
     {
-        if (!certOpenEsCertSaveFile()) break;
         ret = _certRetrieveCertificateChainBySignatureIssuer(dst, issuer);
+
+        /* The savefile is only opened on cache misses. This is a no-op if every certificate was served from the cache. */
         certCloseEsCertSaveFile();
     }
 
@@ -200,6 +218,54 @@ static void certCloseEsCertSaveFile(void)
     g_esCertSaveCtx = NULL;
 }
 
+static bool certRetrieveCertificateByNameCached(Certificate *dst, const char *name)
+{
+    /* Check if this certificate has already been retrieved. */
+    if (certGetCertificateFromCache(dst, name)) return true;
+
+    /* Open the ES certificate system savefile, if needed. It's kept open until the top-level call closes it, so chains only open it once. */
+    if (!certOpenEsCertSaveFile()) return false;
+
+    /* Retrieve the certificate from the savefile. */
+    if (!_certRetrieveCertificateByName(dst, name)) return false;
+
+    /* Cache the retrieved certificate. A failure here isn't fatal - the certificate will simply be retrieved from the savefile again next time. */
+    certAddCertificateToCache(dst, name);
+
+    return true;
+}
+
+static bool certGetCertificateFromCache(Certificate *dst, const char *name)
+{
+    for(u32 i = 0; i < g_certCacheCount; i++)
+    {
+        CertCacheEntry *entry = &(g_certCache[i]);
+        if (strcmp(entry->name, name) != 0) continue;
+        memcpy(dst, &(entry->cert), sizeof(Certificate));
+        return true;
+    }
+
+    return false;
+}
+
+static void certAddCertificateToCache(const Certificate *cert, const char *name)
+{
+    /* Reallocate cache entry buffer. */
+    CertCacheEntry *cache_tmp = realloc(g_certCache, (g_certCacheCount + 1) * sizeof(CertCacheEntry));
+    if (!cache_tmp)
+    {
+        LOG_MSG_ERROR("Failed to reallocate certificate cache buffer! (%u entries).", g_certCacheCount + 1);
+        return;
+    }
+
+    g_certCache = cache_tmp;
+
+    /* Fill new cache entry. */
+    CertCacheEntry *entry = &(g_certCache[g_certCacheCount++]);
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    memcpy(&(entry->cert), cert, sizeof(Certificate));
+}
+
 static bool _certRetrieveCertificateByName(Certificate *dst, const char *name)
 {
     if (!g_esCertSaveCtx)
@@ -293,12 +359,6 @@ static u8 certGetCertificateType(void *data, u64 data_size)
 
 static bool _certRetrieveCertificateChainBySignatureIssuer(CertificateChain *dst, const char *issuer)
 {
-    if (!g_esCertSaveCtx)
-    {
-        LOG_MSG_ERROR("ES certificate savefile not opened!");
-        return false;
-    }
-
     u32 i = 0;
     char issuer_copy[0x40] = {0}, *pch = NULL, *state = NULL;
     bool success = true;
@@ -324,7 +384,7 @@ static bool _certRetrieveCertificateChainBySignatureIssuer(CertificateChain *dst
     pch = strtok_r(issuer_copy, "-", &state);
     while(pch)
     {
-        if (!_certRetrieveCertificateByName(&(dst->certs[i]), pch))
+        if (!certRetrieveCertificateByNameCached(&(dst->certs[i]), pch))
         {
             LOG_MSG_ERROR("Unable to retrieve certificate \"%s\"!", pch);
             success = false;
@@ -26,7 +26,19 @@
 /* Helper macros. */
 
 #define CNMT_MINIMUM_FILENAME_LENGTH    23  /* Content Meta Type + "_" + Title ID + ".cnmt". */
-#define CNMT_ADD_FMT_STR(fmt, ...)      utilsAppendFormattedStringToBuffer(&xml_buf, &xml_buf_size, fmt, ##__VA_ARGS__)
+#define CNMT_ADD_FMT_STR(fmt, ...)      utilsStringBuilderAppendFormat(&sb, fmt, ##__VA_ARGS__)
+
+#define CNMT_BATCH_MAX_THREADS          4   /* Used by batch context initialization. Matches the NCA crypto buffer pool size - extra worker threads would just block on buffer acquisition. */
+
+/* Type definitions. */
+
+/// Shared state for a cnmtInitializeContextBatch() call.
+typedef struct {
+    ContentMetaBatchEntry *entries;     ///< Batch entries provided by the caller.
+    u32 entry_count;                    ///< Total number of batch entries.
+    u32 next_entry;                     ///< Index of the next unclaimed batch entry. Protected by 'mutex'.
+    Mutex mutex;
+} ContentMetaBatchState;
 
 /* Global variables. */
 
@@ -40,6 +52,9 @@ static const char *g_cnmtAttributeStrings[ContentMetaAttribute_Count] = {
 
 static bool cnmtGetContentMetaTypeAndTitleIdFromFileName(const char *cnmt_filename, size_t cnmt_filename_len, u8 *out_content_meta_type, u64 *out_title_id);
 
+static void cnmtProcessContextBatchEntries(ContentMetaBatchState *state);
+static void cnmtInitializeContextBatchThreadFunc(void *arg);
+
 static const char *cnmtGetRequiredTitleVersionString(u8 content_meta_type);
 static const char *cnmtGetRequiredTitleTypeString(u8 content_meta_type);
 
@@ -263,6 +278,77 @@ end:
     return success;
 }
 
+bool cnmtInitializeContextBatch(ContentMetaBatchEntry *entries, u32 entry_count)
+{
+    if (!entries || !entry_count)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Process a single entry directly on the calling thread. */
+    if (entry_count == 1)
+    {
+        ContentMetaBatchEntry *entry = &(entries[0]);
+        entry->success = cnmtInitializeContext(entry->cnmt_ctx, entry->nca_ctx);
+        return entry->success;
+    }
+
+    ContentMetaBatchState state = { .entries = entries, .entry_count = entry_count, .next_entry = 0, .mutex = 0 };
+
+    Thread threads[CNMT_BATCH_MAX_THREADS] = {0};
+    u32 thread_count = (MIN(entry_count, CNMT_BATCH_MAX_THREADS) - 1), created_count = 0;   /* The calling thread processes entries as well. */
+
+    bool success = true;
+
+    /* Create worker threads, spreading them across all available cores. */
+    /* If thread creation fails at any point, the already created workers and the calling thread simply process the remaining entries between themselves. */
+    for(u32 i = 0; i < thread_count; i++)
+    {
+        if (!utilsCreateThread(&(threads[i]), cnmtInitializeContextBatchThreadFunc, &state, (int)(i % 3))) break;
+        created_count++;
+    }
+
+    /* Process batch entries on the calling thread until none are left. */
+    cnmtProcessContextBatchEntries(&state);
+
+    /* Wait for all worker threads to finish. */
+    for(u32 i = 0; i < created_count; i++) utilsJoinThread(&(threads[i]));
+
+    /* Check batch entry results. */
+    for(u32 i = 0; i < entry_count; i++)
+    {
+        if (!entries[i].success) success = false;
+    }
+
+    return success;
+}
+
+static void cnmtProcessContextBatchEntries(ContentMetaBatchState *state)
+{
+    while(true)
+    {
+        ContentMetaBatchEntry *entry = NULL;
+
+        /* Claim the next unprocessed batch entry. */
+        SCOPED_LOCK(&(state->mutex))
+        {
+            if (state->next_entry < state->entry_count) entry = &(state->entries[state->next_entry++]);
+        }
+
+        if (!entry) break;
+
+        /* Initialize ContentMetaContext. */
+        entry->success = cnmtInitializeContext(entry->cnmt_ctx, entry->nca_ctx);
+    }
+}
+
+static void cnmtInitializeContextBatchThreadFunc(void *arg)
+{
+    cnmtProcessContextBatchEntries((ContentMetaBatchState*)arg);
+    threadExit();
+}
+
 bool cnmtUpdateContentInfo(ContentMetaContext *cnmt_ctx, NcaContext *nca_ctx)
 {
     if (!cnmtIsValidContext(cnmt_ctx) || !nca_ctx || !*(nca_ctx->content_id_str) || !*(nca_ctx->hash_str) || nca_ctx->content_type > NcmContentType_DeltaFragment || !nca_ctx->content_size)
@@ -360,8 +446,7 @@ bool cnmtGenerateAuthoringToolXml(ContentMetaContext *cnmt_ctx, NcaContext *nca_
     }
 
     u32 i, j;
-    char *xml_buf = NULL;
-    u64 xml_buf_size = 0;
+    UtilsStringBuilder sb = {0};
     char digest_str[0x41] = {0};
     u8 count = 0, content_meta_type = cnmt_ctx->packaged_header->content_meta_type;
     bool success = false, invalid_nca = false;
@@ -481,16 +566,15 @@ bool cnmtGenerateAuthoringToolXml(ContentMetaContext *cnmt_ctx, NcaContext *nca_
     if (content_meta_type == NcmContentMetaType_DataPatch && \
         !CNMT_ADD_FMT_STR("  <DataId>0x%016lx</DataId>\n", ((ContentMetaDataPatchMetaExtendedHeader*)cnmt_ctx->extended_header)->data_id)) goto end;
 
-    if (!(success = CNMT_ADD_FMT_STR("</ContentMeta>"))) goto end;
+    if (!CNMT_ADD_FMT_STR("</ContentMeta>")) goto end;
 
     /* Update CNMT context. */
-    cnmt_ctx->authoring_tool_xml = xml_buf;
-    cnmt_ctx->authoring_tool_xml_size = strlen(xml_buf);
+    success = ((cnmt_ctx->authoring_tool_xml = utilsStringBuilderFinalize(&sb, &(cnmt_ctx->authoring_tool_xml_size))) != NULL);
 
 end:
     if (!success)
     {
-        if (xml_buf) free(xml_buf);
+        utilsStringBuilderFree(&sb);
         LOG_MSG_ERROR("Failed to generate CNMT AuthoringTool XML!");
     }
 
@@ -23,56 +23,121 @@
 #include "config.h"
 #include "title.h"
 
-#define CONFIG_VALIDATE_FIELD(type, name, ...) \
-if (!strcmp(key, #name)) { \
-    if (name##_found || !jsonValidate##type(val, ##__VA_ARGS__)) goto end; \
-    name##_found = true; \
-    continue; \
-}
-
-#define CONFIG_VALIDATE_OBJECT(type, name) \
-if (!strcmp(key, #name)) { \
-    if (name##_found || !configValidateJson##type##Object(val)) goto end; \
-    name##_found = true; \
-    continue; \
-}
-
-#define CONFIG_GETTER(functype, vartype, ...) \
-vartype configGet##functype(const char *path) { \
-    vartype ret = (vartype)0; \
-    SCOPED_LOCK(&g_configMutex) { \
-        if (!g_configInterfaceInit) break; \
-        ret = jsonGet##functype(g_configJson, path); \
-    } \
-    return ret; \
-}
-
-#define CONFIG_SETTER(functype, vartype, ...) \
-void configSet##functype(const char *path, vartype value) { \
-    SCOPED_LOCK(&g_configMutex) { \
-        if (!g_configInterfaceInit) break; \
-        if (jsonSet##functype(g_configJson, path, value)) configWriteConfigJson(); \
-    } \
-}
+#define CONFIG_FLUSH_DEBOUNCE_TIME      500000000ULL    /* 500 milliseconds. */
+
+#define CONFIG_MAX_FILE_SIZE            0x10000         /* 64 KiB. Sanity cap for config files. */
+#define CONFIG_MAX_PATH_LENGTH          0x60
+#define CONFIG_BENCHMARK_PATH_PREFIX    "benchmark/"
+
+#define CONFIG_FIELD(fname, ftype, ...) { #fname, ConfigDataType_##ftype, offsetof(ConfigData, fname), ##__VA_ARGS__ }
+#define CONFIG_NESTED_FIELD(parent, fname, ftype, ...) { #parent "/" #fname, ConfigDataType_##ftype, offsetof(ConfigData, parent##_##fname), ##__VA_ARGS__ }
+
+/* Type definitions. */
+
+typedef enum {
+    ConfigDataType_Boolean = 0,
+    ConfigDataType_Integer = 1
+} ConfigDataType;
+
+/// Represents a single benchmark result from the dynamic "benchmark" config object.
+typedef struct {
+    char key[0x40];     ///< Device-specific config key, generated by benchmarkGenerateConfigKeyByDevicePath().
+    int value;          ///< Best write block size for the device, in bytes.
+} ConfigBenchmarkEntry;
+
+/// Holds the whole parsed configuration.
+/// Nested JSON objects are flattened into prefixed fields, which lets the parser and the writer share a single field table instead of walking an object tree.
+typedef struct {
+    bool overclock;
+    int naming_convention;
+    int output_storage;
+    bool gamecard_prepend_key_area;
+    bool gamecard_keep_certificate;
+    bool gamecard_trim_dump;
+    bool gamecard_calculate_checksum;
+    int gamecard_checksum_lookup_method;
+    bool nsp_set_download_distribution;
+    bool nsp_remove_console_data;
+    bool nsp_remove_titlekey_crypto;
+    bool nsp_disable_linked_account_requirement;
+    bool nsp_enable_screenshots;
+    bool nsp_enable_video_capture;
+    bool nsp_disable_hdcp;
+    bool nsp_append_authoringtool_data;
+    bool nsp_lookup_checksum;
+    bool ticket_remove_console_data;
+    bool nca_fs_use_layeredfs_dir;
+    ConfigBenchmarkEntry *benchmark_entries;    ///< Dynamically allocated. The "benchmark" object holds a variable set of per-device keys.
+    u32 benchmark_entry_count;
+} ConfigData;
+
+/// Describes a single fixed config field.
+typedef struct {
+    const char *path;   ///< Full field path. Elements are separated using forward slashes.
+    u8 type;            ///< ConfigDataType.
+    u16 offset;         ///< Field offset within ConfigData.
+    int min_value;      ///< Inclusive lower boundary for integer fields.
+    int max_value;      ///< Inclusive upper boundary for integer fields.
+} ConfigFieldInfo;
 
 /* Global variables. */
 
 static Mutex g_configMutex = 0;
 static bool g_configInterfaceInit = false;
 
-static struct json_object *g_configJson = NULL;
+static ConfigData g_configData = {0};
+
+static Thread g_configFlushThread = {0};
+static UEvent g_configDirtyEvent = {0}, g_configFlushThreadExitEvent = {0};
+static bool g_configDirty = false;
+
+/// Fixed config fields. The parser requires every single one of them to show up exactly once.
+static const ConfigFieldInfo g_configFields[] = {
+    CONFIG_FIELD(overclock, Boolean, 0, 0),
+    CONFIG_FIELD(naming_convention, Integer, TitleNamingConvention_Full, TitleNamingConvention_Count - 1),
+    CONFIG_FIELD(output_storage, Integer, ConfigOutputStorage_SdCard, ConfigOutputStorage_Count - 1),
+    CONFIG_NESTED_FIELD(gamecard, prepend_key_area, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(gamecard, keep_certificate, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(gamecard, trim_dump, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(gamecard, calculate_checksum, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(gamecard, checksum_lookup_method, Integer, ConfigChecksumLookupMethod_None, ConfigChecksumLookupMethod_Count - 1),
+    CONFIG_NESTED_FIELD(nsp, set_download_distribution, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, remove_console_data, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, remove_titlekey_crypto, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, disable_linked_account_requirement, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, enable_screenshots, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, enable_video_capture, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, disable_hdcp, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, append_authoringtool_data, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nsp, lookup_checksum, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(ticket, remove_console_data, Boolean, 0, 0),
+    CONFIG_NESTED_FIELD(nca_fs, use_layeredfs_dir, Boolean, 0, 0)
+};
+
+static const u32 g_configFieldCount = MAX_ELEMENTS(g_configFields);
 
 /* Function prototypes. */
 
-static bool configParseConfigJson(void);
+static bool configCreateFlushThread(void);
+static void configDestroyFlushThread(void);
+static void configFlushThreadFunc(void *arg);
+
+static bool configParseConfigFile(const char *path, bool *out_benchmark_found, u32 *out_found_mask);
+static bool configParseObject(const char **ptr, const char *parent_path, bool *benchmark_found, u32 *found_mask);
+static bool configParseBenchmarkObject(const char **ptr);
+static bool configParseKeyString(const char **ptr, char *out, size_t out_size);
+
 static void configWriteConfigJson(void);
-static void configFreeConfigJson(void);
+static struct json_object *configGenerateJsonFromData(void);
+static void configFreeConfigData(void);
 
-static bool configValidateJsonRootObject(const struct json_object *obj);
-static bool configValidateJsonGameCardObject(const struct json_object *obj);
-static bool configValidateJsonNspObject(const struct json_object *obj);
-static bool configValidateJsonTicketObject(const struct json_object *obj);
-static bool configValidateJsonNcaFsObject(const struct json_object *obj);
+static const ConfigFieldInfo *configFindField(const char *path);
+static ConfigBenchmarkEntry *configFindBenchmarkEntry(const char *key);
+
+NX_INLINE void configSkipWhitespace(const char **ptr)
+{
+    while(**ptr == ' ' || **ptr == '\t' || **ptr == '\r' || **ptr == '\n') (*ptr)++;
+}
 
 bool configInitialize(void)
 {
@@ -83,10 +148,44 @@ bool configInitialize(void)
         ret = g_configInterfaceInit;
         if (ret) break;
 
-        /* Parse JSON config. */
-        if (!configParseConfigJson())
+        bool use_default_config = true, benchmark_found = false;
+        u32 found_mask = 0;
+
+        /* Parse config file. All fixed fields must show up exactly once, and the benchmark object must be present. */
+        if (configParseConfigFile(CONFIG_PATH, &benchmark_found, &found_mask))
+        {
+            use_default_config = (!benchmark_found || found_mask != ((u32)1 << g_configFieldCount) - 1);
+        }
+
+        if (use_default_config)
+        {
+            LOG_MSG_INFO("Loading default configuration.");
+
+            /* Wipe any partially parsed data, then parse the default config file. */
+            configFreeConfigData();
+
+            benchmark_found = false;
+            found_mask = 0;
+
+            if (!configParseConfigFile(DEFAULT_CONFIG_PATH, &benchmark_found, &found_mask) || found_mask != ((u32)1 << g_configFieldCount) - 1)
+            {
+                LOG_MSG_ERROR("Failed to parse both current and default configuration files!");
+                configFreeConfigData();
+                break;
+            }
+
+            /* Write the freshly loaded defaults back to the SD card. */
+            configWriteConfigJson();
+        }
+
+        /* Create user mode events. */
+        ueventCreate(&g_configDirtyEvent, true);
+        ueventCreate(&g_configFlushThreadExitEvent, true);
+
+        /* Create config flush thread. */
+        if (!configCreateFlushThread())
         {
-            LOG_MSG_ERROR("Failed to parse JSON configuration!");
+            configFreeConfigData();
             break;
         }
 
@@ -99,181 +198,562 @@ bool configInitialize(void)
 
 void configExit(void)
 {
+    bool init = false;
+    SCOPED_LOCK(&g_configMutex) init = g_configInterfaceInit;
+
+    /* Destroy config flush thread. Takes care of flushing any pending changes to the SD card before returning. */
+    if (init) configDestroyFlushThread();
+
+    SCOPED_LOCK(&g_configMutex)
+    {
+        /* Free parsed config data. */
+        /* We don't need to write it back to the SD card - the flush thread has already taken care of any pending changes. */
+        configFreeConfigData();
+
+        /* Update flags. */
+        g_configInterfaceInit = g_configDirty = false;
+    }
+}
+
+bool configGetBoolean(const char *path)
+{
+    bool ret = false;
+
     SCOPED_LOCK(&g_configMutex)
     {
-        /* Free JSON object. */
-        /* We don't need to write it back to the SD card - setter functions do that on their own. */
-        configFreeConfigJson();
+        if (!g_configInterfaceInit || !path || !*path) break;
+
+        const ConfigFieldInfo *field = configFindField(path);
+        if (!field || field->type != ConfigDataType_Boolean) break;
 
-        /* Update flag. */
-        g_configInterfaceInit = false;
+        ret = *(bool*)((u8*)&g_configData + field->offset);
     }
+
+    return ret;
 }
 
-CONFIG_GETTER(Boolean, bool);
-CONFIG_SETTER(Boolean, bool);
+void configSetBoolean(const char *path, bool value)
+{
+    SCOPED_LOCK(&g_configMutex)
+    {
+        if (!g_configInterfaceInit || !path || !*path) break;
+
+        const ConfigFieldInfo *field = configFindField(path);
+        if (!field || field->type != ConfigDataType_Boolean) break;
+
+        bool *dst = (bool*)((u8*)&g_configData + field->offset);
+        if (*dst == value) break;
 
-CONFIG_GETTER(Integer, int);
-CONFIG_SETTER(Integer, int);
+        *dst = value;
+
+        g_configDirty = true;
+        ueventSignal(&g_configDirtyEvent);
+    }
+}
 
-static bool configParseConfigJson(void)
+int configGetInteger(const char *path)
 {
-    bool use_default_config = true, ret = false;
+    int ret = 0;
 
-    /* Read config JSON. */
-    g_configJson = json_object_from_file(CONFIG_PATH);
-    if (g_configJson)
+    SCOPED_LOCK(&g_configMutex)
     {
-        /* Validate configuration. */
-        ret = configValidateJsonRootObject(g_configJson);
-        use_default_config = !ret;
-    } else {
-        jsonLogLastError();
+        if (!g_configInterfaceInit || !path || !*path) break;
+
+        /* Benchmark keys are dynamic, so they aren't part of the fixed field table. */
+        if (!strncmp(path, CONFIG_BENCHMARK_PATH_PREFIX, strlen(CONFIG_BENCHMARK_PATH_PREFIX)))
+        {
+            ConfigBenchmarkEntry *entry = configFindBenchmarkEntry(path + strlen(CONFIG_BENCHMARK_PATH_PREFIX));
+            if (entry) ret = entry->value;
+            break;
+        }
+
+        const ConfigFieldInfo *field = configFindField(path);
+        if (!field || field->type != ConfigDataType_Integer) break;
+
+        ret = *(int*)((u8*)&g_configData + field->offset);
     }
 
-    if (use_default_config)
+    return ret;
+}
+
+void configSetInteger(const char *path, int value)
+{
+    SCOPED_LOCK(&g_configMutex)
     {
-        LOG_MSG_INFO("Loading default configuration.");
+        if (!g_configInterfaceInit || !path || !*path) break;
 
-        /* Free config JSON. */
-        configFreeConfigJson();
+        int *dst = NULL;
 
-        /* Read default config JSON. */
-        g_configJson = json_object_from_file(DEFAULT_CONFIG_PATH);
-        if (g_configJson)
+        /* Benchmark keys are dynamic - create a new entry if the provided key doesn't exist yet. */
+        if (!strncmp(path, CONFIG_BENCHMARK_PATH_PREFIX, strlen(CONFIG_BENCHMARK_PATH_PREFIX)))
         {
-            configWriteConfigJson();
-            ret = true;
+            const char *key = (path + strlen(CONFIG_BENCHMARK_PATH_PREFIX));
+            if (!*key || strlen(key) >= MEMBER_SIZE(ConfigBenchmarkEntry, key)) break;
+
+            ConfigBenchmarkEntry *entry = configFindBenchmarkEntry(key);
+            if (!entry)
+            {
+                ConfigBenchmarkEntry *tmp = realloc(g_configData.benchmark_entries, (g_configData.benchmark_entry_count + 1) * sizeof(ConfigBenchmarkEntry));
+                if (!tmp)
+                {
+                    LOG_MSG_ERROR("Failed to reallocate benchmark entry array!");
+                    break;
+                }
+
+                g_configData.benchmark_entries = tmp;
+
+                entry = &(g_configData.benchmark_entries[g_configData.benchmark_entry_count++]);
+                memset(entry, 0, sizeof(ConfigBenchmarkEntry));
+                snprintf(entry->key, MEMBER_SIZE(ConfigBenchmarkEntry, key), "%s", key);
+            }
+
+            dst = &(entry->value);
         } else {
-            jsonLogLastError();
+            const ConfigFieldInfo *field = configFindField(path);
+            if (!field || field->type != ConfigDataType_Integer) break;
+            dst = (int*)((u8*)&g_configData + field->offset);
         }
+
+        if (*dst == value) break;
+
+        *dst = value;
+
+        g_configDirty = true;
+        ueventSignal(&g_configDirtyEvent);
     }
+}
 
-    if (!ret) LOG_MSG_ERROR("Failed to parse both current and default JSON configuration files!");
+static bool configCreateFlushThread(void)
+{
+    if (!utilsCreateThread(&g_configFlushThread, configFlushThreadFunc, NULL, 1))
+    {
+        LOG_MSG_ERROR("Failed to create config flush thread!");
+        return false;
+    }
 
-    return ret;
+    return true;
 }
 
-static void configWriteConfigJson(void)
+static void configDestroyFlushThread(void)
 {
-    if (!g_configJson) return;
-    if (json_object_to_file_ext(CONFIG_PATH, g_configJson, JSON_C_TO_STRING_SPACED | JSON_C_TO_STRING_PRETTY) != 0) jsonLogLastError();
+    /* Signal the exit event to terminate the config flush thread. */
+    ueventSignal(&g_configFlushThreadExitEvent);
+
+    /* Wait for the config flush thread to exit. */
+    utilsJoinThread(&g_configFlushThread);
 }
 
-static void configFreeConfigJson(void)
+static void configFlushThreadFunc(void *arg)
 {
-    if (!g_configJson) return;
-    json_object_put(g_configJson);
-    g_configJson = NULL;
+    (void)arg;
+
+    Result rc = 0;
+    int idx = 0;
+
+    Waiter dirty_event_waiter = waiterForUEvent(&g_configDirtyEvent);
+    Waiter exit_event_waiter = waiterForUEvent(&g_configFlushThreadExitEvent);
+
+    while(true)
+    {
+        /* Wait until an event is triggered. */
+        rc = waitMulti(&idx, -1, dirty_event_waiter, exit_event_waiter);
+        if (R_FAILED(rc)) continue;
+
+        /* Exit event triggered. */
+        bool exit_flag = (idx == 1);
+
+        /* Debounce window: absorb any further changes made shortly after the first one, so bursts of toggles only hit the SD card once. */
+        /* Cut the wait short if the exit event is signaled in the meantime. */
+        if (!exit_flag) exit_flag = R_SUCCEEDED(waitSingle(exit_event_waiter, CONFIG_FLUSH_DEBOUNCE_TIME));
+
+        /* Write config JSON if there are unflushed changes. */
+        SCOPED_LOCK(&g_configMutex)
+        {
+            if (g_configDirty)
+            {
+                configWriteConfigJson();
+                g_configDirty = false;
+            }
+        }
+
+        if (exit_flag) break;
+    }
+
+    threadExit();
 }
 
-static bool configValidateJsonRootObject(const struct json_object *obj)
+/* Parses a config file directly into the global ConfigData struct. */
+/* Unlike a full json-c parse, no intermediate object tree is built - the config is small and fixed, so the field table drives validation on the fly. */
+static bool configParseConfigFile(const char *path, bool *out_benchmark_found, u32 *out_found_mask)
 {
-    bool ret = false, overclock_found = false, naming_convention_found = false, output_storage_found = false, gamecard_found = false;
-    bool nsp_found = false, ticket_found = false, nca_fs_found = false;
+    FILE *fp = NULL;
+    char *buf = NULL;
+    long size = 0;
+    bool success = false;
+
+    fp = fopen(path, "rb");
+    if (!fp)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\"!", path);
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+
+    if (size <= 0 || size > CONFIG_MAX_FILE_SIZE)
+    {
+        LOG_MSG_ERROR("Invalid size for \"%s\"! (0x%lX).", path, size);
+        goto end;
+    }
 
-    if (!jsonValidateObject(obj)) goto end;
+    buf = malloc(size + 1);
+    if (!buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate 0x%lX bytes for \"%s\"!", size + 1, path);
+        goto end;
+    }
 
-    json_object_object_foreach(obj, key, val)
+    if (fread(buf, 1, size, fp) != (size_t)size)
     {
-        CONFIG_VALIDATE_FIELD(Boolean, overclock);
-        CONFIG_VALIDATE_FIELD(Integer, naming_convention, TitleNamingConvention_Full, TitleNamingConvention_Count - 1);
-        CONFIG_VALIDATE_FIELD(Integer, output_storage, ConfigOutputStorage_SdCard, ConfigOutputStorage_Count - 1);
-        CONFIG_VALIDATE_OBJECT(GameCard, gamecard);
-        CONFIG_VALIDATE_OBJECT(Nsp, nsp);
-        CONFIG_VALIDATE_OBJECT(Ticket, ticket);
-        CONFIG_VALIDATE_OBJECT(NcaFs, nca_fs);
+        LOG_MSG_ERROR("Failed to read 0x%lX bytes from \"%s\"!", size, path);
         goto end;
     }
 
-    ret = (overclock_found && naming_convention_found && output_storage_found && gamecard_found && nsp_found && ticket_found && nca_fs_found);
+    buf[size] = '\0';
+
+    /* Parse the root object. */
+    const char *ptr = buf;
+    success = configParseObject(&ptr, NULL, out_benchmark_found, out_found_mask);
+
+    /* Make sure there's nothing but whitespace left. */
+    if (success)
+    {
+        configSkipWhitespace(&ptr);
+        success = (*ptr == '\0');
+    }
+
+    if (!success) LOG_MSG_ERROR("Failed to parse \"%s\"! (offset 0x%lX).", path, (u64)(ptr - buf));
 
 end:
-    return ret;
+    if (buf) free(buf);
+
+    fclose(fp);
+
+    return success;
 }
 
-static bool configValidateJsonGameCardObject(const struct json_object *obj)
+static bool configParseObject(const char **ptr, const char *parent_path, bool *benchmark_found, u32 *found_mask)
 {
-    bool ret = false, prepend_key_area_found = false, keep_certificate_found = false, trim_dump_found = false, calculate_checksum_found = false, checksum_lookup_method_found = false;
+    char key[CONFIG_MAX_PATH_LENGTH] = {0}, cur_path[CONFIG_MAX_PATH_LENGTH] = {0};
 
-    if (!jsonValidateObject(obj)) goto end;
+    configSkipWhitespace(ptr);
+    if (**ptr != '{') return false;
+    (*ptr)++;
 
-    json_object_object_foreach(obj, key, val)
+    configSkipWhitespace(ptr);
+    if (**ptr == '}')
     {
-        CONFIG_VALIDATE_FIELD(Boolean, prepend_key_area);
-        CONFIG_VALIDATE_FIELD(Boolean, keep_certificate);
-        CONFIG_VALIDATE_FIELD(Boolean, trim_dump);
-        CONFIG_VALIDATE_FIELD(Boolean, calculate_checksum);
-        CONFIG_VALIDATE_FIELD(Integer, checksum_lookup_method, ConfigChecksumLookupMethod_None, ConfigChecksumLookupMethod_Count - 1);
-        goto end;
+        (*ptr)++;
+        return true;
     }
 
-    ret = (prepend_key_area_found && keep_certificate_found && trim_dump_found && calculate_checksum_found && checksum_lookup_method_found);
+    while(true)
+    {
+        /* Parse the key for the current member. */
+        configSkipWhitespace(ptr);
+        if (!configParseKeyString(ptr, key, sizeof(key))) return false;
 
-end:
-    return ret;
+        configSkipWhitespace(ptr);
+        if (**ptr != ':') return false;
+        (*ptr)++;
+
+        /* Generate the full path for the current member. */
+        size_t key_len = strlen(key);
+
+        if (parent_path)
+        {
+            size_t parent_len = strlen(parent_path);
+            if ((parent_len + 1 + key_len) >= sizeof(cur_path)) return false;
+
+            memcpy(cur_path, parent_path, parent_len);
+            cur_path[parent_len] = '/';
+            memcpy(cur_path + parent_len + 1, key, key_len + 1);
+        } else {
+            memcpy(cur_path, key, key_len + 1);
+        }
+
+        configSkipWhitespace(ptr);
+
+        if (**ptr == '{')
+        {
+            /* Nested object. The benchmark object holds dynamic keys, so it gets its own parser. */
+            if (!parent_path && !strcmp(key, "benchmark"))
+            {
+                if (*benchmark_found || !configParseBenchmarkObject(ptr)) return false;
+                *benchmark_found = true;
+            } else {
+                /* Only recurse into object names the field table actually knows about. */
+                bool known = false;
+                size_t cur_path_len = strlen(cur_path);
+
+                for(u32 i = 0; i < g_configFieldCount; i++)
+                {
+                    if (!strncmp(g_configFields[i].path, cur_path, cur_path_len) && g_configFields[i].path[cur_path_len] == '/')
+                    {
+                        known = true;
+                        break;
+                    }
+                }
+
+                if (!known || !configParseObject(ptr, cur_path, benchmark_found, found_mask)) return false;
+            }
+        } else {
+            /* Scalar value. Find the matching field and make sure it hasn't been seen before. */
+            const ConfigFieldInfo *field = configFindField(cur_path);
+            if (!field) return false;
+
+            u32 field_bit = ((u32)1 << (u32)(field - g_configFields));
+            if (*found_mask & field_bit) return false;
+
+            if (field->type == ConfigDataType_Boolean)
+            {
+                bool value = false;
+
+                if (!strncmp(*ptr, "true", 4))
+                {
+                    value = true;
+                    (*ptr) += 4;
+                } else
+                if (!strncmp(*ptr, "false", 5))
+                {
+                    (*ptr) += 5;
+                } else {
+                    return false;
+                }
+
+                *(bool*)((u8*)&g_configData + field->offset) = value;
+            } else {
+                char *end = NULL;
+                long value = strtol(*ptr, &end, 10);
+                if (end == *ptr || value < field->min_value || value > field->max_value) return false;
+                *ptr = end;
+
+                *(int*)((u8*)&g_configData + field->offset) = (int)value;
+            }
+
+            *found_mask |= field_bit;
+        }
+
+        /* Check for further members. */
+        configSkipWhitespace(ptr);
+
+        if (**ptr == ',')
+        {
+            (*ptr)++;
+            continue;
+        }
+
+        if (**ptr == '}')
+        {
+            (*ptr)++;
+            return true;
+        }
+
+        return false;
+    }
 }
 
-static bool configValidateJsonNspObject(const struct json_object *obj)
+static bool configParseBenchmarkObject(const char **ptr)
 {
-    bool ret = false, set_download_distribution_found = false, remove_console_data_found = false, remove_titlekey_crypto_found = false;
-    bool disable_linked_account_requirement_found = false, enable_screenshots_found = false, enable_video_capture_found = false, disable_hdcp_found = false, append_authoringtool_data_found = false, lookup_checksum_found = false;
+    char key[MEMBER_SIZE(ConfigBenchmarkEntry, key)] = {0};
 
-    if (!jsonValidateObject(obj)) goto end;
+    configSkipWhitespace(ptr);
+    if (**ptr != '{') return false;
+    (*ptr)++;
 
-    json_object_object_foreach(obj, key, val)
+    configSkipWhitespace(ptr);
+    if (**ptr == '}')
     {
-        CONFIG_VALIDATE_FIELD(Boolean, set_download_distribution);
-        CONFIG_VALIDATE_FIELD(Boolean, remove_console_data);
-        CONFIG_VALIDATE_FIELD(Boolean, remove_titlekey_crypto);
-        CONFIG_VALIDATE_FIELD(Boolean, disable_linked_account_requirement);
-        CONFIG_VALIDATE_FIELD(Boolean, enable_screenshots);
-        CONFIG_VALIDATE_FIELD(Boolean, enable_video_capture);
-        CONFIG_VALIDATE_FIELD(Boolean, disable_hdcp);
-        CONFIG_VALIDATE_FIELD(Boolean, lookup_checksum);
-        CONFIG_VALIDATE_FIELD(Boolean, append_authoringtool_data);
-        goto end;
+        (*ptr)++;
+        return true;
     }
 
-    ret = (set_download_distribution_found && remove_console_data_found && remove_titlekey_crypto_found && disable_linked_account_requirement_found && \
-           enable_screenshots_found && enable_video_capture_found && disable_hdcp_found && append_authoringtool_data_found && lookup_checksum_found);
+    while(true)
+    {
+        /* Parse the device-specific key for the current entry. */
+        configSkipWhitespace(ptr);
+        if (!configParseKeyString(ptr, key, sizeof(key))) return false;
 
-end:
-    return ret;
+        configSkipWhitespace(ptr);
+        if (**ptr != ':') return false;
+        (*ptr)++;
+
+        /* Parse the best block size for the current entry. */
+        configSkipWhitespace(ptr);
+
+        char *end = NULL;
+        long value = strtol(*ptr, &end, 10);
+        if (end == *ptr || value < 1 || value > INT32_MAX) return false;
+        *ptr = end;
+
+        /* Reject duplicated keys. */
+        if (configFindBenchmarkEntry(key)) return false;
+
+        /* Add a new benchmark entry. */
+        ConfigBenchmarkEntry *tmp = realloc(g_configData.benchmark_entries, (g_configData.benchmark_entry_count + 1) * sizeof(ConfigBenchmarkEntry));
+        if (!tmp)
+        {
+            LOG_MSG_ERROR("Failed to reallocate benchmark entry array!");
+            return false;
+        }
+
+        g_configData.benchmark_entries = tmp;
+
+        ConfigBenchmarkEntry *entry = &(g_configData.benchmark_entries[g_configData.benchmark_entry_count++]);
+        memset(entry, 0, sizeof(ConfigBenchmarkEntry));
+        snprintf(entry->key, MEMBER_SIZE(ConfigBenchmarkEntry, key), "%s", key);
+        entry->value = (int)value;
+
+        /* Check for further entries. */
+        configSkipWhitespace(ptr);
+
+        if (**ptr == ',')
+        {
+            (*ptr)++;
+            continue;
+        }
+
+        if (**ptr == '}')
+        {
+            (*ptr)++;
+            return true;
+        }
+
+        return false;
+    }
 }
 
-static bool configValidateJsonTicketObject(const struct json_object *obj)
+static bool configParseKeyString(const char **ptr, char *out, size_t out_size)
 {
-    bool ret = false, remove_console_data_found = false;
+    if (**ptr != '"') return false;
+    (*ptr)++;
 
-    if (!jsonValidateObject(obj)) goto end;
+    size_t len = 0;
 
-    json_object_object_foreach(obj, key, val)
+    while(**ptr && **ptr != '"')
     {
-        CONFIG_VALIDATE_FIELD(Boolean, remove_console_data);
-        goto end;
+        /* Escape sequences never show up in config keys, so they're rejected outright. */
+        if (**ptr == '\\' || len >= (out_size - 1)) return false;
+        out[len++] = *((*ptr)++);
     }
 
-    ret = remove_console_data_found;
+    if (**ptr != '"' || !len) return false;
+    (*ptr)++;
 
-end:
-    return ret;
+    out[len] = '\0';
+
+    return true;
+}
+
+/* json-c is still used to write the config file - pretty-printed output for free, and the write path is nowhere near startup. */
+static void configWriteConfigJson(void)
+{
+    struct json_object *obj = configGenerateJsonFromData();
+    if (!obj) return;
+
+    if (json_object_to_file_ext(CONFIG_PATH, obj, JSON_C_TO_STRING_SPACED | JSON_C_TO_STRING_PRETTY) != 0) jsonLogLastError();
+
+    json_object_put(obj);
 }
 
-static bool configValidateJsonNcaFsObject(const struct json_object *obj)
+static struct json_object *configGenerateJsonFromData(void)
 {
-    bool ret = false, use_layeredfs_dir_found = false;
+    struct json_object *obj = json_object_new_object();
+    if (!obj) return NULL;
 
-    if (!jsonValidateObject(obj)) goto end;
+    char parent[CONFIG_MAX_PATH_LENGTH] = {0};
+    bool success = false;
 
-    json_object_object_foreach(obj, key, val)
+    /* Add all fixed fields, creating nested objects on demand. The field table is ordered, so members from the same object are always added back to back. */
+    for(u32 i = 0; i < g_configFieldCount; i++)
     {
-        CONFIG_VALIDATE_FIELD(Boolean, use_layeredfs_dir);
-        goto end;
+        const ConfigFieldInfo *field = &(g_configFields[i]);
+        struct json_object *parent_obj = obj, *val = NULL;
+
+        const char *sep = strchr(field->path, '/');
+        const char *name = field->path;
+
+        if (sep)
+        {
+            snprintf(parent, sizeof(parent), "%.*s", (int)(sep - field->path), field->path);
+            name = (sep + 1);
+
+            if (!json_object_object_get_ex(obj, parent, &parent_obj))
+            {
+                parent_obj = json_object_new_object();
+                if (!parent_obj || json_object_object_add(obj, parent, parent_obj) != 0) goto end;
+            }
+        }
+
+        if (field->type == ConfigDataType_Boolean)
+        {
+            val = json_object_new_boolean(*(bool*)((u8*)&g_configData + field->offset));
+        } else {
+            val = json_object_new_int(*(int*)((u8*)&g_configData + field->offset));
+        }
+
+        if (!val || json_object_object_add(parent_obj, name, val) != 0) goto end;
     }
 
-    ret = use_layeredfs_dir_found;
+    /* Add benchmark entries. */
+    struct json_object *benchmark_obj = json_object_new_object();
+    if (!benchmark_obj || json_object_object_add(obj, "benchmark", benchmark_obj) != 0) goto end;
+
+    for(u32 i = 0; i < g_configData.benchmark_entry_count; i++)
+    {
+        ConfigBenchmarkEntry *entry = &(g_configData.benchmark_entries[i]);
+
+        struct json_object *val = json_object_new_int(entry->value);
+        if (!val || json_object_object_add(benchmark_obj, entry->key, val) != 0) goto end;
+    }
+
+    success = true;
 
 end:
-    return ret;
+    if (!success)
+    {
+        LOG_MSG_ERROR("Failed to generate JSON object tree from config data!");
+        json_object_put(obj);
+        obj = NULL;
+    }
+
+    return obj;
+}
+
+static void configFreeConfigData(void)
+{
+    if (g_configData.benchmark_entries) free(g_configData.benchmark_entries);
+    memset(&g_configData, 0, sizeof(ConfigData));
+}
+
+static const ConfigFieldInfo *configFindField(const char *path)
+{
+    for(u32 i = 0; i < g_configFieldCount; i++)
+    {
+        if (!strcmp(g_configFields[i].path, path)) return &(g_configFields[i]);
+    }
+
+    return NULL;
+}
+
+static ConfigBenchmarkEntry *configFindBenchmarkEntry(const char *key)
+{
+    for(u32 i = 0; i < g_configData.benchmark_entry_count; i++)
+    {
+        if (!strcmp(g_configData.benchmark_entries[i].key, key)) return &(g_configData.benchmark_entries[i]);
+    }
+
+    return NULL;
 }
@@ -0,0 +1,406 @@
+/*
+ * dump.c
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "nxdt_utils.h"
+#include "dump.h"
+#include "usb.h"
+
+#define DUMP_PIPELINE_STALL_SLEEP_TIME  100000  /* 100 us. */
+
+#define DUMP_PIPELINE_MIN_BLOCK_SIZE    0x100000    /* 1 MiB. Lower bound for the allocation fallback under memory pressure. */
+
+/* Function prototypes. */
+
+static void dumpPipelineProducerThreadFunc(void *arg);
+static void dumpPipelineFilterThreadFunc(void *arg);
+static void dumpPipelineConsumerThreadFunc(void *arg);
+
+NX_INLINE bool dumpPipelineDownstreamFailed(DumpPipeline *pipeline);
+NX_INLINE size_t dumpPipelineGetRecycledSlotCount(DumpPipeline *pipeline);
+
+bool dumpPipelineInitialize(DumpPipeline *pipeline, DumpPipelineProducerFunc producer_func, void *producer_userdata, DumpPipelineFilterFunc filter_func, void *filter_userdata, \
+                            DumpPipelineConsumerFunc consumer_func, void *consumer_userdata, DumpPipelineCancelFunc cancel_func, void *cancel_userdata, u64 total_size, u64 block_size)
+{
+    if (!pipeline || pipeline->initialized || !producer_func || !consumer_func)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    bool success = false;
+
+    /* Clear output pipeline. */
+    memset(pipeline, 0, sizeof(DumpPipeline));
+
+    /* Allocate ring slots. Page-aligned buffers let USB-backed consumer stages take the zero-copy transfer path. */
+    pipeline->block_size = (block_size ? block_size : DUMP_PIPELINE_DEFAULT_BLOCK_SIZE);
+
+    /* Clamp the slot size to the applet-mode memory budget, if any. */
+    u64 budgeted_block_size = utilsGetDumpBlockSize(DUMP_PIPELINE_RING_BUFFER_COUNT);
+    if (pipeline->block_size > budgeted_block_size) pipeline->block_size = budgeted_block_size;
+
+    while(true)
+    {
+        u32 allocated = 0;
+
+        for(allocated = 0; allocated < DUMP_PIPELINE_RING_BUFFER_COUNT; allocated++)
+        {
+            pipeline->buf[allocated] = usbAllocatePageAlignedBuffer(pipeline->block_size);
+            if (!pipeline->buf[allocated]) break;
+        }
+
+        if (allocated == DUMP_PIPELINE_RING_BUFFER_COUNT) break;
+
+        /* Free the slots we got and retry with half the size - the budget is a heap snapshot, so degrade gracefully if allocations still fail. */
+        for(u32 i = 0; i < allocated; i++)
+        {
+            free(pipeline->buf[i]);
+            pipeline->buf[i] = NULL;
+        }
+
+        if (pipeline->block_size <= DUMP_PIPELINE_MIN_BLOCK_SIZE)
+        {
+            LOG_MSG_ERROR("Failed to allocate 0x%lX bytes long ring slots!", pipeline->block_size);
+            goto end;
+        }
+
+        pipeline->block_size >>= 1;
+        LOG_MSG_INFO("Ring slot allocation failed. Retrying with 0x%lX bytes long slots.", pipeline->block_size);
+    }
+
+    /* Fill remaining pipeline info. */
+    pipeline->total_size = total_size;
+
+    pipeline->producer_func = producer_func;
+    pipeline->producer_userdata = producer_userdata;
+
+    pipeline->filter_func = filter_func;
+    pipeline->filter_userdata = filter_userdata;
+
+    pipeline->consumer_func = consumer_func;
+    pipeline->consumer_userdata = consumer_userdata;
+
+    pipeline->cancel_func = cancel_func;
+    pipeline->cancel_userdata = cancel_userdata;
+
+    /* Update flags. */
+    success = pipeline->initialized = true;
+
+end:
+    if (!success) dumpPipelineClose(pipeline);
+
+    return success;
+}
+
+bool dumpPipelineStart(DumpPipeline *pipeline)
+{
+    if (!pipeline || !pipeline->initialized || pipeline->started)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    bool producer_created = false, filter_created = false, consumer_created = false;
+
+    /* Create stage threads. The active stage counter is incremented upfront - each stage thread decrements it on exit. */
+    atomic_store(&(pipeline->active_stage_count), pipeline->filter_func ? 3 : 2);
+
+    producer_created = utilsCreateThread(&(pipeline->producer_thread), dumpPipelineProducerThreadFunc, pipeline, 2);
+    if (producer_created) consumer_created = utilsCreateThread(&(pipeline->consumer_thread), dumpPipelineConsumerThreadFunc, pipeline, 2);
+    if (consumer_created && pipeline->filter_func) filter_created = utilsCreateThread(&(pipeline->filter_thread), dumpPipelineFilterThreadFunc, pipeline, 2);
+
+    if (!producer_created || !consumer_created || (pipeline->filter_func && !filter_created))
+    {
+        LOG_MSG_ERROR("Failed to create pipeline stage threads!");
+
+        /* Tear down any stage thread we already created. */
+        atomic_store(&(pipeline->cancel_flag), true);
+        atomic_store(&(pipeline->eof_flag), true);
+
+        if (producer_created) utilsJoinThread(&(pipeline->producer_thread));
+        if (consumer_created) utilsJoinThread(&(pipeline->consumer_thread));
+        if (filter_created) utilsJoinThread(&(pipeline->filter_thread));
+
+        atomic_store(&(pipeline->active_stage_count), 0);
+
+        return false;
+    }
+
+    /* Update flag. */
+    pipeline->started = true;
+
+    return true;
+}
+
+bool dumpPipelineIsRunning(DumpPipeline *pipeline)
+{
+    return (pipeline && pipeline->started && atomic_load(&(pipeline->active_stage_count)) > 0);
+}
+
+void dumpPipelineGetStats(DumpPipeline *pipeline, DumpPipelineStats *out_stats)
+{
+    if (!pipeline || !pipeline->initialized || !out_stats)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return;
+    }
+
+    memset(out_stats, 0, sizeof(DumpPipelineStats));
+
+    out_stats->total_size = pipeline->total_size;
+    out_stats->produced_size = atomic_load(&(pipeline->produced_size));
+    out_stats->consumed_size = atomic_load(&(pipeline->consumed_size));
+    out_stats->producer_stall_count = atomic_load(&(pipeline->producer_stall_count));
+    out_stats->consumer_stall_count = atomic_load(&(pipeline->consumer_stall_count));
+    out_stats->producer_busy_ns = atomic_load(&(pipeline->producer_busy_ns));
+    out_stats->filter_busy_ns = atomic_load(&(pipeline->filter_busy_ns));
+    out_stats->consumer_busy_ns = atomic_load(&(pipeline->consumer_busy_ns));
+}
+
+void dumpPipelineCancel(DumpPipeline *pipeline)
+{
+    if (!pipeline || !pipeline->initialized || atomic_load(&(pipeline->cancel_flag))) return;
+
+    /* Every stage stops at its next chunk boundary. */
+    atomic_store(&(pipeline->cancel_flag), true);
+
+    /* Let the caller unblock a consumer stage stuck inside a blocking call. */
+    if (pipeline->cancel_func) pipeline->cancel_func(pipeline->cancel_userdata);
+}
+
+bool dumpPipelineWait(DumpPipeline *pipeline)
+{
+    if (!pipeline || !pipeline->initialized || !pipeline->started)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Wait until every stage thread exits. */
+    utilsJoinThread(&(pipeline->producer_thread));
+    utilsJoinThread(&(pipeline->consumer_thread));
+    if (pipeline->filter_func) utilsJoinThread(&(pipeline->filter_thread));
+
+    /* Update flag. */
+    pipeline->started = false;
+
+    return (!atomic_load(&(pipeline->producer_error)) && !atomic_load(&(pipeline->filter_error)) && !atomic_load(&(pipeline->consumer_error)) && !atomic_load(&(pipeline->cancel_flag)));
+}
+
+bool dumpPipelineIsCancelled(DumpPipeline *pipeline)
+{
+    return (pipeline && pipeline->initialized && atomic_load(&(pipeline->cancel_flag)));
+}
+
+void dumpPipelineClose(DumpPipeline *pipeline)
+{
+    if (!pipeline) return;
+
+    /* Tear down any stage thread that's still running. */
+    if (pipeline->started)
+    {
+        dumpPipelineCancel(pipeline);
+        dumpPipelineWait(pipeline);
+    }
+
+    /* Free ring slots. */
+    for(u32 i = 0; i < DUMP_PIPELINE_RING_BUFFER_COUNT; i++)
+    {
+        if (pipeline->buf[i]) free(pipeline->buf[i]);
+    }
+
+    memset(pipeline, 0, sizeof(DumpPipeline));
+}
+
+static void dumpPipelineProducerThreadFunc(void *arg)
+{
+    DumpPipeline *pipeline = (DumpPipeline*)arg;
+
+    while(true)
+    {
+        if (atomic_load(&(pipeline->cancel_flag)) || dumpPipelineDownstreamFailed(pipeline)) break;
+
+        /* Wait until a ring slot gets recycled by the downstream stages. */
+        bool stalled = false;
+
+        while((atomic_load(&(pipeline->produced_count)) - dumpPipelineGetRecycledSlotCount(pipeline)) >= DUMP_PIPELINE_RING_BUFFER_COUNT)
+        {
+            if (atomic_load(&(pipeline->cancel_flag)) || dumpPipelineDownstreamFailed(pipeline)) break;
+            stalled = true;
+            svcSleepThread(DUMP_PIPELINE_STALL_SLEEP_TIME);
+        }
+
+        if (stalled) atomic_store(&(pipeline->producer_stall_count), atomic_load(&(pipeline->producer_stall_count)) + 1);
+
+        if (atomic_load(&(pipeline->cancel_flag)) || dumpPipelineDownstreamFailed(pipeline)) break;
+
+        /* Generate the next chunk. */
+        size_t produced = atomic_load(&(pipeline->produced_count));
+        size_t slot = (produced % DUMP_PIPELINE_RING_BUFFER_COUNT);
+
+        u64 size = 0;
+        void *tag = NULL;
+
+        u64 start_tick = armGetSystemTick();
+        bool success = pipeline->producer_func(pipeline->producer_userdata, pipeline->buf[slot], pipeline->block_size, &size, &tag);
+        atomic_store(&(pipeline->producer_busy_ns), atomic_load(&(pipeline->producer_busy_ns)) + armTicksToNs(armGetSystemTick() - start_tick));
+
+        if (!success || size > pipeline->block_size)
+        {
+            if (success) LOG_MSG_ERROR("Producer stage overran its ring slot (0x%lX > 0x%lX)!", size, pipeline->block_size);
+            atomic_store(&(pipeline->producer_error), true);
+            break;
+        }
+
+        /* End of stream. */
+        if (!size && !tag) break;
+
+        /* Publish the filled slot. */
+        pipeline->slot_size[slot] = size;
+        pipeline->slot_tag[slot] = tag;
+
+        atomic_store(&(pipeline->produced_size), atomic_load(&(pipeline->produced_size)) + size);
+        atomic_store(&(pipeline->produced_count), produced + 1);
+    }
+
+    /* Always raise the EOF flag on the way out - even on error and cancellation paths - so the downstream stages drain their backlog and exit. */
+    atomic_store(&(pipeline->eof_flag), true);
+
+    atomic_store(&(pipeline->active_stage_count), atomic_load(&(pipeline->active_stage_count)) - 1);
+
+    threadExit();
+}
+
+static void dumpPipelineFilterThreadFunc(void *arg)
+{
+    DumpPipeline *pipeline = (DumpPipeline*)arg;
+
+    size_t filtered = atomic_load(&(pipeline->filtered_count));
+
+    while(true)
+    {
+        /* Wait until the producer stage publishes a filled ring slot. */
+        while(filtered == atomic_load(&(pipeline->produced_count)))
+        {
+            if (atomic_load(&(pipeline->eof_flag)) || atomic_load(&(pipeline->cancel_flag)) || atomic_load(&(pipeline->consumer_error))) break;
+            svcSleepThread(DUMP_PIPELINE_STALL_SLEEP_TIME);
+        }
+
+        if (atomic_load(&(pipeline->cancel_flag)) || atomic_load(&(pipeline->producer_error)) || atomic_load(&(pipeline->consumer_error))) break;
+
+        /* Exit if the stream has been fully generated and our backlog is drained. */
+        if (filtered == atomic_load(&(pipeline->produced_count)))
+        {
+            if (atomic_load(&(pipeline->eof_flag))) break;
+            continue;
+        }
+
+        /* Process the current chunk. */
+        size_t slot = (filtered % DUMP_PIPELINE_RING_BUFFER_COUNT);
+
+        u64 start_tick = armGetSystemTick();
+        bool success = pipeline->filter_func(pipeline->filter_userdata, pipeline->buf[slot], pipeline->slot_size[slot]);
+        atomic_store(&(pipeline->filter_busy_ns), atomic_load(&(pipeline->filter_busy_ns)) + armTicksToNs(armGetSystemTick() - start_tick));
+
+        if (!success)
+        {
+            atomic_store(&(pipeline->filter_error), true);
+            break;
+        }
+
+        /* Release the slot back to the producer stage (the consumer stage also has to move past it). */
+        filtered++;
+        atomic_store(&(pipeline->filtered_count), filtered);
+    }
+
+    atomic_store(&(pipeline->active_stage_count), atomic_load(&(pipeline->active_stage_count)) - 1);
+
+    threadExit();
+}
+
+static void dumpPipelineConsumerThreadFunc(void *arg)
+{
+    DumpPipeline *pipeline = (DumpPipeline*)arg;
+
+    size_t consumed = atomic_load(&(pipeline->consumed_count));
+
+    while(true)
+    {
+        /* Wait until the producer stage publishes a filled ring slot. */
+        bool stalled = false;
+
+        while(consumed == atomic_load(&(pipeline->produced_count)))
+        {
+            if (atomic_load(&(pipeline->eof_flag)) || atomic_load(&(pipeline->cancel_flag)) || atomic_load(&(pipeline->filter_error))) break;
+            stalled = true;
+            svcSleepThread(DUMP_PIPELINE_STALL_SLEEP_TIME);
+        }
+
+        if (stalled) atomic_store(&(pipeline->consumer_stall_count), atomic_load(&(pipeline->consumer_stall_count)) + 1);
+
+        if (atomic_load(&(pipeline->cancel_flag)) || atomic_load(&(pipeline->producer_error)) || atomic_load(&(pipeline->filter_error))) break;
+
+        /* Exit if the stream has been fully generated and our backlog is drained. */
+        if (consumed == atomic_load(&(pipeline->produced_count)))
+        {
+            if (atomic_load(&(pipeline->eof_flag))) break;
+            continue;
+        }
+
+        /* Process the current chunk. */
+        size_t slot = (consumed % DUMP_PIPELINE_RING_BUFFER_COUNT);
+
+        u64 start_tick = armGetSystemTick();
+        bool success = pipeline->consumer_func(pipeline->consumer_userdata, pipeline->buf[slot], pipeline->slot_size[slot], pipeline->slot_tag[slot]);
+        atomic_store(&(pipeline->consumer_busy_ns), atomic_load(&(pipeline->consumer_busy_ns)) + armTicksToNs(armGetSystemTick() - start_tick));
+
+        if (!success)
+        {
+            atomic_store(&(pipeline->consumer_error), true);
+            break;
+        }
+
+        /* Release the slot back to the producer stage (the filter stage, if any, also has to move past it). */
+        atomic_store(&(pipeline->consumed_size), atomic_load(&(pipeline->consumed_size)) + pipeline->slot_size[slot]);
+
+        consumed++;
+        atomic_store(&(pipeline->consumed_count), consumed);
+    }
+
+    atomic_store(&(pipeline->active_stage_count), atomic_load(&(pipeline->active_stage_count)) - 1);
+
+    threadExit();
+}
+
+NX_INLINE bool dumpPipelineDownstreamFailed(DumpPipeline *pipeline)
+{
+    return (atomic_load(&(pipeline->filter_error)) || atomic_load(&(pipeline->consumer_error)));
+}
+
+NX_INLINE size_t dumpPipelineGetRecycledSlotCount(DumpPipeline *pipeline)
+{
+    /* A ring slot is only safe to refill after both downstream stages have moved past it. */
+    size_t consumed = atomic_load(&(pipeline->consumed_count));
+    if (!pipeline->filter_func) return consumed;
+
+    size_t filtered = atomic_load(&(pipeline->filtered_count));
+    return (filtered < consumed ? filtered : consumed);
+}
@@ -28,6 +28,10 @@ static Service g_esSrv = {0};
 
 NX_GENERATE_SERVICE_GUARD(es);
 
+static Result _esListAllTicket(bool personalized, FsRightsId **out_ids, s32 *out_count);
+
+static int _esRightsIdSortFunc(const void *a, const void *b);
+
 Result esCountCommonTicket(s32 *out_count)
 {
     struct {
@@ -84,6 +88,16 @@ Result esListPersonalizedTicket(s32 *out_entries_written, FsRightsId *out_ids, s
     return rc;
 }
 
+Result esListAllCommonTicket(FsRightsId **out_ids, s32 *out_count)
+{
+    return _esListAllTicket(false, out_ids, out_count);
+}
+
+Result esListAllPersonalizedTicket(FsRightsId **out_ids, s32 *out_count)
+{
+    return _esListAllTicket(true, out_ids, out_count);
+}
+
 NX_INLINE Result _esInitialize(void)
 {
     return smGetService(&g_esSrv, "es");
@@ -93,3 +107,51 @@ static void _esCleanup(void)
 {
     serviceClose(&g_esSrv);
 }
+
+static Result _esListAllTicket(bool personalized, FsRightsId **out_ids, s32 *out_count)
+{
+    if (!out_ids || !out_count) return MAKERESULT(Module_Libnx, LibnxError_BadInput);
+
+    FsRightsId *ids = NULL;
+    s32 count = 0, written = 0;
+
+    /* Get ticket count. */
+    Result rc = (personalized ? esCountPersonalizedTicket(&count) : esCountCommonTicket(&count));
+    if (R_FAILED(rc)) return rc;
+
+    if (count > 0)
+    {
+        /* Allocate memory for the full rights ID set. */
+        ids = calloc((size_t)count, sizeof(FsRightsId));
+        if (!ids) return MAKERESULT(Module_Libnx, LibnxError_HeapAllocFailed);
+
+        /* Retrieve the full rights ID set in a single list exchange. */
+        /* Tickets may have been removed in-between calls, so we just rely on the written entry count. */
+        rc = (personalized ? esListPersonalizedTicket(&written, ids, count) : esListCommonTicket(&written, ids, count));
+        if (R_FAILED(rc))
+        {
+            free(ids);
+            return rc;
+        }
+
+        /* Sort rights IDs, enabling consumers to rely on binary searches and plain set comparisons. */
+        if (written > 1) qsort(ids, (size_t)written, sizeof(FsRightsId), &_esRightsIdSortFunc);
+
+        if (!written)
+        {
+            free(ids);
+            ids = NULL;
+        }
+    }
+
+    /* Update output. */
+    *out_ids = ids;
+    *out_count = written;
+
+    return rc;
+}
+
+static int _esRightsIdSortFunc(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(FsRightsId));
+}
@@ -28,6 +28,8 @@
 
 #define GAMECARD_READ_BUFFER_SIZE               0x800000                /* 8 MiB. */
 
+#define GAMECARD_READ_AHEAD_BUFFER_SIZE         GAMECARD_READ_BUFFER_SIZE
+
 #define GAMECARD_ACCESS_WAIT_TIME               3                       /* Seconds. */
 
 #define GAMECARD_UNUSED_AREA_BLOCK_SIZE         0x24
@@ -35,6 +37,8 @@
 
 #define GAMECARD_STORAGE_AREA_NAME(x)           ((x) == GameCardStorageArea_Normal ? "normal" : ((x) == GameCardStorageArea_Secure ? "secure" : "none"))
 
+#define GAMECARD_STORAGE_AREA_HANDLE(x)         (&(g_gameCardStorageAreas[(x) - 1]))    /* Zero-based index. */
+
 #define GAMECARD_HFS_PARTITION_NAME_INDEX(x)    ((x) - 1)
 
 #define LAFW_MAGIC                              0x4C414657              /* "LAFW". */
@@ -71,20 +75,37 @@ static u64 g_lafwVersion = 0;
 
 static Thread g_gameCardDetectionThread = {0};
 static UEvent g_gameCardDetectionThreadExitEvent = {0}, g_gameCardStatusChangeEvent = {0};
-static bool g_gameCardDetectionThreadCreated = false;
+static bool g_gameCardDetectionThreadCreated = false, g_gameCardStatusUpdated = false;
 
 static GameCardStatus g_gameCardStatus = GameCardStatus_NotInserted;
+static u8 g_gameCardInfoLoadState = GameCardInfoLoadState_None;
 
 static FsGameCardHandle g_gameCardHandle = {0};
-static FsStorage g_gameCardStorage = {0};
-static u8 g_gameCardCurrentStorageArea = GameCardStorageArea_None;
+/// One FsStorage session per gamecard storage area (normal, secure). Both sessions are kept open for the lifetime of the card session, \
+/// so reads that interleave between both areas don't close and reopen handles back and forth - handle open is an expensive Lotus transaction.
+/// FS invalidates gamecard handles whenever it switches between normal and secure mode, so the read path reopens a stale session on demand and retries.
+static FsStorage g_gameCardStorageAreas[2] = {0};
 static u8 *g_gameCardReadBuf = NULL;
 
 static GameCardHeader g_gameCardHeader = {0};
 static GameCardInfo g_gameCardInfoArea = {0};
+
+/// Cached security information block for the inserted gamecard. Populated on the first gamecardGetSecurityInformation() call per insertion - \
+/// retrieving it involves a full FS program memory search, which takes tens of milliseconds every time.
+static GameCardSecurityInformation g_gameCardSecurityInfo = {0};
+static bool g_gameCardSecurityInfoCached = false;
 static u64 g_gameCardNormalAreaSize = 0, g_gameCardSecureAreaSize = 0, g_gameCardTotalSize = 0;
 static u64 g_gameCardCapacity = 0;
 
+static Thread g_gameCardReadAheadThread = {0};
+static UEvent g_gameCardReadAheadWakeEvent = {0}, g_gameCardReadAheadThreadExitEvent = {0};
+static bool g_gameCardReadAheadThreadCreated = false;
+
+static u8 *g_gameCardReadAheadBuf = NULL;
+static u64 g_gameCardReadAheadOffset = 0, g_gameCardReadAheadSize = 0;
+static u64 g_gameCardReadAheadTargetOffset = 0, g_gameCardReadAheadTargetSize = 0;
+static u64 g_gameCardLastReadEndOffset = 0;
+
 static u32 g_gameCardHfsCount = 0;
 static HashFileSystemContext **g_gameCardHfsCtx = NULL;
 
@@ -126,28 +147,42 @@ static const char *g_lafwDeviceTypeStrings[LotusAsicDeviceType_Count] = {
 
 /* Function prototypes. */
 
+static bool gamecardFindLotusAsicFirmwareBlob(const u8 *window, u64 window_size, u64 window_offset, void *userdata);
 static bool gamecardReadLotusAsicFirmwareBlob(void);
 
 static bool gamecardCreateDetectionThread(void);
 static void gamecardDestroyDetectionThread(void);
 static void gamecardDetectionThreadFunc(void *arg);
 
+static bool gamecardCreateReadAheadThread(void);
+static void gamecardDestroyReadAheadThread(void);
+static void gamecardReadAheadThreadFunc(void *arg);
+
+static bool gamecardReadStorageFromCache(void *out, u64 read_size, u64 offset);
+static void gamecardUpdateReadAheadState(u64 read_size, u64 offset);
+static void gamecardInvalidateReadAheadCache(void);
+
 NX_INLINE bool gamecardIsInserted(void);
 
-static void gamecardLoadInfo(void);
+static void gamecardLoadBasicInfo(void);
+static void gamecardLoadDeferredInfo(void);
+static bool gamecardLoadHashFileSystemContexts(void);
 static void gamecardFreeInfo(bool clear_status);
 
 static bool gamecardReadHeader(void);
 
 static bool _gamecardGetDecryptedCardInfoArea(void);
 
+static bool gamecardFindInitialDataBlock(const u8 *window, u64 window_size, u64 window_offset, void *userdata);
 static bool gamecardReadSecurityInformation(GameCardSecurityInformation *out);
 
 static bool gamecardGetHandleAndStorage(u32 partition);
 NX_INLINE void gamecardCloseHandle(void);
 
 static bool gamecardOpenStorageArea(u8 area);
+static Result gamecardReadStorageAreaWithRetry(u8 area, void *out, u64 read_size, u64 base_offset);
 static bool gamecardReadStorageArea(void *out, u64 read_size, u64 offset);
+static void gamecardCloseStorageAreaSession(u8 area);
 static void gamecardCloseStorageArea(void);
 
 static bool gamecardGetStorageAreasSizes(void);
@@ -174,6 +209,14 @@ bool gamecardInitialize(void)
             break;
         }
 
+        /* Allocate memory for the gamecard readahead buffer. */
+        g_gameCardReadAheadBuf = malloc(GAMECARD_READ_AHEAD_BUFFER_SIZE);
+        if (!g_gameCardReadAheadBuf)
+        {
+            LOG_MSG_ERROR("Unable to allocate memory for the gamecard readahead buffer!");
+            break;
+        }
+
         /* Open device operator. */
         rc = fsOpenDeviceOperator(&g_deviceOperator);
         if (R_FAILED(rc))
@@ -216,6 +259,13 @@ bool gamecardInitialize(void)
         /* Create gamecard detection thread. */
         if (!(g_gameCardDetectionThreadCreated = gamecardCreateDetectionThread())) break;
 
+        /* Create user-mode readahead events. */
+        ueventCreate(&g_gameCardReadAheadWakeEvent, true);
+        ueventCreate(&g_gameCardReadAheadThreadExitEvent, true);
+
+        /* Create gamecard readahead thread. */
+        if (!(g_gameCardReadAheadThreadCreated = gamecardCreateReadAheadThread())) break;
+
         /* Update flags. */
         ret = g_gameCardInterfaceInit = true;
     }
@@ -227,6 +277,13 @@ void gamecardExit(void)
 {
     SCOPED_LOCK(&g_gameCardMutex)
     {
+        /* Destroy gamecard readahead thread. */
+        if (g_gameCardReadAheadThreadCreated)
+        {
+            gamecardDestroyReadAheadThread();
+            g_gameCardReadAheadThreadCreated = false;
+        }
+
         /* Destroy gamecard detection thread. */
         if (g_gameCardDetectionThreadCreated)
         {
@@ -262,6 +319,13 @@ void gamecardExit(void)
             g_openDeviceOperator = false;
         }
 
+        /* Free gamecard readahead buffer. */
+        if (g_gameCardReadAheadBuf)
+        {
+            free(g_gameCardReadAheadBuf);
+            g_gameCardReadAheadBuf = NULL;
+        }
+
         /* Free gamecard read buffer. */
         if (g_gameCardReadBuf)
         {
@@ -269,7 +333,7 @@ void gamecardExit(void)
             g_gameCardReadBuf = NULL;
         }
 
-        g_gameCardInterfaceInit = false;
+        g_gameCardInterfaceInit = g_gameCardStatusUpdated = false;
     }
 }
 
@@ -285,6 +349,19 @@ UEvent *gamecardGetStatusChangeUserEvent(void)
     return event;
 }
 
+bool gamecardIsStatusUpdated(void)
+{
+    bool ret = false;
+
+    SCOPED_TRY_LOCK(&g_gameCardMutex)
+    {
+        ret = (g_gameCardInterfaceInit && g_gameCardStatusUpdated);
+        g_gameCardStatusUpdated = false;
+    }
+
+    return ret;
+}
+
 u8 gamecardGetStatus(void)
 {
     u8 status = GameCardStatus_Processing;
@@ -297,6 +374,18 @@ u8 gamecardGetStatus(void)
     return status;
 }
 
+u8 gamecardGetInfoLoadState(void)
+{
+    u8 state = GameCardInfoLoadState_None;
+
+    SCOPED_TRY_LOCK(&g_gameCardMutex)
+    {
+        if (g_gameCardInterfaceInit) state = g_gameCardInfoLoadState;
+    }
+
+    return state;
+}
+
 /* Read full FS program memory to retrieve the GameCardSecurityInformation block. */
 /* In FS program memory, this is returned by Lotus command "ChangeToSecureMode" (0xF). */
 /* This means it is only available *after* the gamecard secure area has been mounted, which is taken care of in gamecardReadSecurityInformation(). */
@@ -347,7 +436,16 @@ bool gamecardGetLotusAsicFirmwareBlob(LotusAsicFirmwareBlob *out_lafw_blob, u64
 bool gamecardReadStorage(void *out, u64 read_size, u64 offset)
 {
     bool ret = false;
-    SCOPED_LOCK(&g_gameCardMutex) ret = gamecardReadStorageArea(out, read_size, offset);
+
+    SCOPED_LOCK(&g_gameCardMutex)
+    {
+        /* Serve the request straight from the readahead cache whenever possible, falling back to a synchronous read otherwise. */
+        ret = (gamecardReadStorageFromCache(out, read_size, offset) || gamecardReadStorageArea(out, read_size, offset));
+
+        /* Update sequential access detection state and kick the readahead thread if this read extends a sequential run. */
+        if (ret) gamecardUpdateReadAheadState(read_size, offset);
+    }
+
     return ret;
 }
 
@@ -487,7 +585,8 @@ bool gamecardGetHashFileSystemContext(u8 hfs_partition_type, HashFileSystemConte
         out->size = fs_ctx->size;
         out->header_size = fs_ctx->header_size;
 
-        out->header = calloc(fs_ctx->header_size, sizeof(u8));
+        /* No need to zero out the allocated buffer - it's fully overwritten by the subsequent memcpy() call. */
+        out->header = malloc(fs_ctx->header_size);
         if (!out->header)
         {
             LOG_MSG_ERROR("Failed to duplicate Hash FS partition header! (%s).", fs_ctx->name);
@@ -576,10 +675,35 @@ const char *gamecardGetLafwDeviceTypeString(u64 device_type)
     return (device_type < LotusAsicDeviceType_Count ? g_lafwDeviceTypeStrings[device_type] : NULL);
 }
 
+static bool gamecardFindLotusAsicFirmwareBlob(const u8 *window, u64 window_size, u64 window_offset, void *userdata)
+{
+    (void)window_offset;
+
+    bool dev_unit = (userdata && *((bool*)userdata));
+
+    /* Look for the LAFW ReadFw blob within the current window. */
+    for(u64 offset = 0; offset < window_size; offset++)
+    {
+        if ((window_size - offset) < sizeof(LotusAsicFirmwareBlob)) break;
+
+        const LotusAsicFirmwareBlob *lafw_blob = (const LotusAsicFirmwareBlob*)(window + offset);
+        u32 magic = __builtin_bswap32(lafw_blob->magic), fw_type = lafw_blob->fw_type;
+
+        if (magic == LAFW_MAGIC && ((!dev_unit && fw_type == LotusAsicFirmwareType_ReadFw) || (dev_unit && fw_type == LotusAsicFirmwareType_ReadDevFw)))
+        {
+            /* Jackpot. */
+            memcpy(g_lafwBlob, lafw_blob, sizeof(LotusAsicFirmwareBlob));
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static bool gamecardReadLotusAsicFirmwareBlob(void)
 {
     u64 fw_version = 0;
-    bool ret = false, found = false, dev_unit = utilsIsDevelopmentUnit();
+    bool ret = false, dev_unit = utilsIsDevelopmentUnit();
 
     /* Allocate memory for the LAFW blob. */
     g_lafwBlob = calloc(1, sizeof(LotusAsicFirmwareBlob));
@@ -592,37 +716,13 @@ static bool gamecardReadLotusAsicFirmwareBlob(void)
     /* Temporarily set the segment mask to .data. */
     g_fsProgramMemory.mask = MemoryProgramSegmentType_Data;
 
-    /* Retrieve full FS program memory dump. */
-    ret = memRetrieveProgramMemorySegment(&g_fsProgramMemory);
+    /* Stream the FS .data segment through a windowed search instead of dumping it whole. */
+    ret = memSearchProgramMemorySegment(&g_fsProgramMemory, sizeof(LotusAsicFirmwareBlob) - 1, &gamecardFindLotusAsicFirmwareBlob, &dev_unit);
 
     /* Clear segment mask. */
     g_fsProgramMemory.mask = 0;
 
     if (!ret)
-    {
-        LOG_MSG_ERROR("Failed to retrieve FS .data segment dump!");
-        goto end;
-    }
-
-    /* Look for the LAFW ReadFw blob in the FS .data memory dump. */
-    for(u64 offset = 0; offset < g_fsProgramMemory.data_size; offset++)
-    {
-        if ((g_fsProgramMemory.data_size - offset) < sizeof(LotusAsicFirmwareBlob)) break;
-
-        LotusAsicFirmwareBlob *lafw_blob = (LotusAsicFirmwareBlob*)(g_fsProgramMemory.data + offset);
-        u32 magic = __builtin_bswap32(lafw_blob->magic), fw_type = lafw_blob->fw_type;
-
-        if (magic == LAFW_MAGIC && ((!dev_unit && fw_type == LotusAsicFirmwareType_ReadFw) || (dev_unit && fw_type == LotusAsicFirmwareType_ReadDevFw)))
-        {
-            /* Jackpot. */
-            memcpy(g_lafwBlob, lafw_blob, sizeof(LotusAsicFirmwareBlob));
-            fw_version = lafw_blob->fw_version;
-            found = true;
-            break;
-        }
-    }
-
-    if (!found)
     {
         LOG_MSG_ERROR("Unable to locate Lotus %s blob in FS .data segment!", dev_unit ? "ReadDevFw" : "ReadFw");
         goto end;
@@ -630,6 +730,7 @@ static bool gamecardReadLotusAsicFirmwareBlob(void)
 
     /* Convert LAFW version bitmask to an integer. */
     g_lafwVersion = 0;
+    fw_version = g_lafwBlob->fw_version;
 
     while(fw_version)
     {
@@ -639,12 +740,7 @@ static bool gamecardReadLotusAsicFirmwareBlob(void)
 
     LOG_MSG_INFO("LAFW version: %lu.", g_lafwVersion);
 
-    /* Update flag. */
-    ret = true;
-
 end:
-    memFreeMemoryLocation(&g_fsProgramMemory);
-
     return ret;
 }
 
@@ -682,10 +778,14 @@ static void gamecardDetectionThreadFunc(void *arg)
     /* Load gamecard info right away if a gamecard is inserted, then signal the user mode gamecard status change event. */
     SCOPED_LOCK(&g_gameCardMutex)
     {
-        if (gamecardIsInserted()) gamecardLoadInfo();
+        if (gamecardIsInserted()) gamecardLoadBasicInfo();
+        g_gameCardStatusUpdated = true;
         ueventSignal(&g_gameCardStatusChangeEvent);
     }
 
+    /* Parse Hash FS partition data in a deferred stage, now that status listeners are free to render basic gamecard info. */
+    gamecardLoadDeferredInfo();
+
     while(true)
     {
         /* Wait until an event is triggered. */
@@ -707,13 +807,17 @@ static void gamecardDetectionThreadFunc(void *arg)
                 /* Don't access the gamecard immediately to avoid conflicts with HOS / sysmodules. */
                 utilsSleep(GAMECARD_ACCESS_WAIT_TIME);
 
-                /* Load gamecard info. */
-                gamecardLoadInfo();
+                /* Load basic gamecard info. */
+                gamecardLoadBasicInfo();
             }
 
             /* Signal user mode gamecard status change event. */
+            g_gameCardStatusUpdated = true;
             ueventSignal(&g_gameCardStatusChangeEvent);
         }
+
+        /* Parse Hash FS partition data in a deferred stage, now that status listeners are free to render basic gamecard info. */
+        gamecardLoadDeferredInfo();
     }
 
     /* Free gamecard info and close gamecard handle. */
@@ -722,6 +826,105 @@ static void gamecardDetectionThreadFunc(void *arg)
     threadExit();
 }
 
+static bool gamecardCreateReadAheadThread(void)
+{
+    if (!utilsCreateThread(&g_gameCardReadAheadThread, gamecardReadAheadThreadFunc, NULL, 1))
+    {
+        LOG_MSG_ERROR("Failed to create gamecard readahead thread!");
+        return false;
+    }
+
+    return true;
+}
+
+static void gamecardDestroyReadAheadThread(void)
+{
+    /* Signal the exit event to terminate the gamecard readahead thread. */
+    ueventSignal(&g_gameCardReadAheadThreadExitEvent);
+
+    /* Wait for the gamecard readahead thread to exit. */
+    utilsJoinThread(&g_gameCardReadAheadThread);
+}
+
+static void gamecardReadAheadThreadFunc(void *arg)
+{
+    (void)arg;
+
+    Result rc = 0;
+    int idx = 0;
+
+    Waiter wake_event_waiter = waiterForUEvent(&g_gameCardReadAheadWakeEvent);
+    Waiter exit_event_waiter = waiterForUEvent(&g_gameCardReadAheadThreadExitEvent);
+
+    while(true)
+    {
+        /* Wait until an event is triggered. */
+        rc = waitMulti(&idx, -1, wake_event_waiter, exit_event_waiter);
+        if (R_FAILED(rc)) continue;
+
+        /* Exit event triggered. */
+        if (idx == 1) break;
+
+        SCOPED_LOCK(&g_gameCardMutex)
+        {
+            u64 target_offset = g_gameCardReadAheadTargetOffset, target_size = g_gameCardReadAheadTargetSize;
+
+            /* Bail out if the gamecard went away or the target chunk became stale while we waited for the lock. */
+            if (g_gameCardStatus != GameCardStatus_InsertedAndInfoLoaded || !g_gameCardReadAheadBuf || !target_size || (target_offset + target_size) > g_gameCardTotalSize) break;
+
+            /* Speculatively read the next chunk. Errors aren't fatal here -- the consumer will simply take the synchronous path. */
+            if (gamecardReadStorageArea(g_gameCardReadAheadBuf, target_size, target_offset))
+            {
+                g_gameCardReadAheadOffset = target_offset;
+                g_gameCardReadAheadSize = target_size;
+            } else {
+                gamecardInvalidateReadAheadCache();
+            }
+        }
+    }
+
+    threadExit();
+}
+
+static bool gamecardReadStorageFromCache(void *out, u64 read_size, u64 offset)
+{
+    if (!g_gameCardReadAheadSize || !out || !read_size || offset < g_gameCardReadAheadOffset || (offset + read_size) > (g_gameCardReadAheadOffset + g_gameCardReadAheadSize)) return false;
+
+    memcpy(out, g_gameCardReadAheadBuf + (offset - g_gameCardReadAheadOffset), read_size);
+
+    return true;
+}
+
+static void gamecardUpdateReadAheadState(u64 read_size, u64 offset)
+{
+    /* Only trigger readahead for sequential access patterns that leave data to be read. */
+    u64 next_offset = (offset + read_size);
+    bool sequential = (offset > 0 && offset == g_gameCardLastReadEndOffset);
+
+    g_gameCardLastReadEndOffset = next_offset;
+
+    if (!sequential || next_offset >= g_gameCardTotalSize) return;
+
+    /* Cap the speculative chunk to both the readahead buffer size and the remaining storage space. */
+    u64 target_size = (read_size > GAMECARD_READ_AHEAD_BUFFER_SIZE ? GAMECARD_READ_AHEAD_BUFFER_SIZE : read_size);
+    if (target_size > (g_gameCardTotalSize - next_offset)) target_size = (g_gameCardTotalSize - next_offset);
+
+    /* Skip the wakeup if the cache already covers the next chunk. */
+    if (g_gameCardReadAheadSize && next_offset >= g_gameCardReadAheadOffset && (next_offset + target_size) <= (g_gameCardReadAheadOffset + g_gameCardReadAheadSize)) return;
+
+    g_gameCardReadAheadTargetOffset = next_offset;
+    g_gameCardReadAheadTargetSize = target_size;
+
+    ueventSignal(&g_gameCardReadAheadWakeEvent);
+}
+
+static void gamecardInvalidateReadAheadCache(void)
+{
+    g_gameCardReadAheadOffset = g_gameCardReadAheadSize = 0;
+    g_gameCardReadAheadTargetOffset = g_gameCardReadAheadTargetSize = 0;
+    g_gameCardLastReadEndOffset = 0;
+}
+
 NX_INLINE bool gamecardIsInserted(void)
 {
     bool inserted = false;
@@ -730,16 +933,13 @@ NX_INLINE bool gamecardIsInserted(void)
     return (R_SUCCEEDED(rc) && inserted);
 }
 
-static void gamecardLoadInfo(void)
+static void gamecardLoadBasicInfo(void)
 {
     if (g_gameCardStatus == GameCardStatus_InsertedAndInfoLoaded) return;
 
-    HashFileSystemContext *root_fs_ctx = NULL;
-    u32 root_fs_entry_count = 0, root_fs_name_table_size = 0;
-    char *root_fs_name_table = NULL;
-
     /* Set initial gamecard status. */
     g_gameCardStatus = GameCardStatus_InsertedAndInfoNotLoaded;
+    g_gameCardInfoLoadState = GameCardInfoLoadState_None;
 
     /* Read gamecard header. */
     /* This step *will* fail if the running CFW enabled the "nogc" patch. */
@@ -780,6 +980,47 @@ static void gamecardLoadInfo(void)
         g_gameCardSecureAreaSize = (g_gameCardCapacity - (g_gameCardNormalAreaSize + GAMECARD_UNUSED_AREA_SIZE(g_gameCardCapacity)));
     }
 
+    /* Update gamecard status and info load state. */
+    /* Hash FS partition data is parsed at a later point by the detection thread via gamecardLoadDeferredInfo(), so status listeners can render basic info right away. */
+    g_gameCardStatus = GameCardStatus_InsertedAndInfoLoaded;
+    g_gameCardInfoLoadState = GameCardInfoLoadState_Basic;
+
+end:
+    if (g_gameCardStatus != GameCardStatus_InsertedAndInfoLoaded) gamecardFreeInfo(false);
+}
+
+static void gamecardLoadDeferredInfo(void)
+{
+    SCOPED_LOCK(&g_gameCardMutex)
+    {
+        /* Don't proceed if the basic info load stage didn't complete, or if the deferred stage already ran. */
+        if (g_gameCardStatus != GameCardStatus_InsertedAndInfoLoaded || g_gameCardInfoLoadState != GameCardInfoLoadState_Basic) break;
+
+        /* Initialize Hash FS contexts for all gamecard partitions. */
+        if (gamecardLoadHashFileSystemContexts())
+        {
+            /* Update info load state. */
+            g_gameCardInfoLoadState |= GameCardInfoLoadState_HashFs;
+        } else {
+            /* Treat a Hash FS parsing failure the same way the old single-stage load path did. */
+            g_gameCardStatus = GameCardStatus_InsertedAndInfoNotLoaded;
+            gamecardFreeInfo(false);
+
+            /* Let status listeners know about the status change. */
+            g_gameCardStatusUpdated = true;
+            ueventSignal(&g_gameCardStatusChangeEvent);
+        }
+    }
+}
+
+static bool gamecardLoadHashFileSystemContexts(void)
+{
+    HashFileSystemContext *root_fs_ctx = NULL;
+    u32 root_fs_entry_count = 0, root_fs_name_table_size = 0;
+    char *root_fs_name_table = NULL;
+
+    bool success = false;
+
     /* Initialize Hash FS context for the root partition. */
     root_fs_ctx = gamecardInitializeHashFileSystemContext(NULL, g_gameCardHeader.partition_fs_header_address, 0, g_gameCardHeader.partition_fs_header_hash, 0, g_gameCardHeader.partition_fs_header_size);
     if (!root_fs_ctx) goto end;
@@ -820,20 +1061,17 @@ static void gamecardLoadInfo(void)
         if (!g_gameCardHfsCtx[i + 1]) goto end;
     }
 
-    /* Update gamecard status. */
-    g_gameCardStatus = GameCardStatus_InsertedAndInfoLoaded;
+    /* Update flag. */
+    success = true;
 
 end:
-    if (g_gameCardStatus != GameCardStatus_InsertedAndInfoLoaded)
+    if (!success && !g_gameCardHfsCtx && root_fs_ctx)
     {
-        if (!g_gameCardHfsCtx && root_fs_ctx)
-        {
-            hfsFreeContext(root_fs_ctx);
-            free(root_fs_ctx);
-        }
-
-        gamecardFreeInfo(false);
+        hfsFreeContext(root_fs_ctx);
+        free(root_fs_ctx);
     }
+
+    return success;
 }
 
 static void gamecardFreeInfo(bool clear_status)
@@ -842,6 +1080,9 @@ static void gamecardFreeInfo(bool clear_status)
 
     memset(&g_gameCardInfoArea, 0, sizeof(GameCardInfo));
 
+    memset(&g_gameCardSecurityInfo, 0, sizeof(GameCardSecurityInformation));
+    g_gameCardSecurityInfoCached = false;
+
     g_gameCardNormalAreaSize = g_gameCardSecureAreaSize = g_gameCardTotalSize = 0;
 
     g_gameCardCapacity = 0;
@@ -864,8 +1105,12 @@ static void gamecardFreeInfo(bool clear_status)
 
     g_gameCardHfsCount = 0;
 
+    gamecardInvalidateReadAheadCache();
+
     gamecardCloseStorageArea();
 
+    g_gameCardInfoLoadState = GameCardInfoLoadState_None;
+
     if (clear_status) g_gameCardStatus = GameCardStatus_NotInserted;
 }
 
@@ -880,7 +1125,7 @@ static bool gamecardReadHeader(void)
 
     /* Read gamecard header. */
     /* This step doesn't rely on gamecardReadStorageArea() because of its dependence on storage area sizes (which we haven't retrieved). */
-    Result rc = fsStorageRead(&g_gameCardStorage, 0, &g_gameCardHeader, sizeof(GameCardHeader));
+    Result rc = fsStorageRead(GAMECARD_STORAGE_AREA_HANDLE(GameCardStorageArea_Normal), 0, &g_gameCardHeader, sizeof(GameCardHeader));
     if (R_FAILED(rc))
     {
         LOG_MSG_ERROR("fsStorageRead failed to read gamecard header! (0x%X).", rc);
@@ -927,6 +1172,38 @@ static bool _gamecardGetDecryptedCardInfoArea(void)
     return true;
 }
 
+static bool gamecardFindInitialDataBlock(const u8 *window, u64 window_size, u64 window_offset, void *userdata)
+{
+    (void)window_offset;
+
+    GameCardSecurityInformation *out = (GameCardSecurityInformation*)userdata;
+    u8 tmp_hash[SHA256_HASH_SIZE] = {0};
+
+    /* Look for the initial data block within the current window using the package ID and the initial data hash from the gamecard header. */
+    /* The security information block it belongs to precedes it in FS program memory, so we skip any offsets that can't hold the full block. */
+    for(u64 offset = (sizeof(GameCardSecurityInformation) - sizeof(GameCardInitialData)); offset < window_size; offset++)
+    {
+        if ((window_size - offset) < sizeof(GameCardInitialData)) break;
+
+        if (memcmp(window + offset, &(g_gameCardHeader.package_id), sizeof(g_gameCardHeader.package_id)) != 0) continue;
+
+        sha256CalculateHash(tmp_hash, window + offset, sizeof(GameCardInitialData));
+        if (!memcmp(tmp_hash, g_gameCardHeader.initial_data_hash, SHA256_HASH_SIZE))
+        {
+            /* Jackpot. */
+            memcpy(out, window + offset + sizeof(GameCardInitialData) - sizeof(GameCardSecurityInformation), sizeof(GameCardSecurityInformation));
+
+            /* Clear out the current ASIC session hash. */
+            /* It's not actually part of the gamecard data, and this changes every time a gamecard (re)insertion takes place. */
+            memset(out->specific_data.asic_session_hash, 0xFF, sizeof(out->specific_data.asic_session_hash));
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static bool gamecardReadSecurityInformation(GameCardSecurityInformation *out)
 {
     if (!g_gameCardInterfaceInit || g_gameCardStatus != GameCardStatus_InsertedAndInfoLoaded || !out)
@@ -935,6 +1212,13 @@ static bool gamecardReadSecurityInformation(GameCardSecurityInformation *out)
         return false;
     }
 
+    /* Serve the request from the cached copy if the security information block has already been retrieved for this insertion. */
+    if (g_gameCardSecurityInfoCached)
+    {
+        memcpy(out, &g_gameCardSecurityInfo, sizeof(GameCardSecurityInformation));
+        return true;
+    }
+
     /* Clear output. */
     memset(out, 0, sizeof(GameCardSecurityInformation));
 
@@ -945,41 +1229,17 @@ static bool gamecardReadSecurityInformation(GameCardSecurityInformation *out)
         return false;
     }
 
-    bool found = false;
-    u8 tmp_hash[SHA256_HASH_SIZE] = {0};
+    /* Stream FS program memory through a windowed search instead of dumping it whole. */
+    bool found = memSearchFullProgramMemory(&g_fsProgramMemory, sizeof(GameCardSecurityInformation) - 1, &gamecardFindInitialDataBlock, out);
+    if (!found) LOG_MSG_ERROR("Unable to locate initial data block in FS program memory!");
 
-    /* Retrieve full FS program memory dump. */
-    if (!memRetrieveFullProgramMemory(&g_fsProgramMemory))
+    /* Cache the retrieved block so further calls within this insertion don't pay for the FS program memory search again. */
+    if (found)
     {
-        LOG_MSG_ERROR("Failed to retrieve full FS program memory dump!");
-        return false;
+        memcpy(&g_gameCardSecurityInfo, out, sizeof(GameCardSecurityInformation));
+        g_gameCardSecurityInfoCached = true;
     }
 
-    /* Look for the initial data block in the FS memory dump using the package ID and the initial data hash from the gamecard header. */
-    for(u64 offset = 0; offset < g_fsProgramMemory.data_size; offset++)
-    {
-        if ((g_fsProgramMemory.data_size - offset) < sizeof(GameCardInitialData)) break;
-
-        if (memcmp(g_fsProgramMemory.data + offset, &(g_gameCardHeader.package_id), sizeof(g_gameCardHeader.package_id)) != 0) continue;
-
-        sha256CalculateHash(tmp_hash, g_fsProgramMemory.data + offset, sizeof(GameCardInitialData));
-        if (!memcmp(tmp_hash, g_gameCardHeader.initial_data_hash, SHA256_HASH_SIZE))
-        {
-            /* Jackpot. */
-            memcpy(out, g_fsProgramMemory.data + offset + sizeof(GameCardInitialData) - sizeof(GameCardSecurityInformation), sizeof(GameCardSecurityInformation));
-
-            /* Clear out the current ASIC session hash. */
-            /* It's not actually part of the gamecard data, and this changes every time a gamecard (re)insertion takes place. */
-            memset(out->specific_data.asic_session_hash, 0xFF, sizeof(out->specific_data.asic_session_hash));
-
-            found = true;
-            break;
-        }
-    }
-
-    /* Free FS memory dump. */
-    memFreeMemoryLocation(&g_fsProgramMemory);
-
     return found;
 }
 
@@ -1009,7 +1269,7 @@ static bool gamecardGetHandleAndStorage(u32 partition)
         }
 
         /* If the previous call succeeded, let's try to open the desired gamecard storage area. */
-        rc = fsOpenGameCardStorage(&g_gameCardStorage, &g_gameCardHandle, partition);
+        rc = fsOpenGameCardStorage(&(g_gameCardStorageAreas[partition]), &g_gameCardHandle, partition);
         if (R_FAILED(rc))
         {
             gamecardCloseHandle(); /* Close invalid gamecard handle. */
@@ -1043,11 +1303,12 @@ static bool gamecardOpenStorageArea(u8 area)
         return false;
     }
 
-    /* Return right away if a valid handle has already been retrieved and the desired gamecard storage area is currently open. */
-    if (g_gameCardHandle.value && serviceIsActive(&(g_gameCardStorage.s)) && g_gameCardCurrentStorageArea == area) return true;
+    /* Return right away if a valid handle has already been retrieved and a session for the desired gamecard storage area is currently open. */
+    /* The session for the other storage area (if any) is purposely left alone - both can stay open at the same time. */
+    if (g_gameCardHandle.value && serviceIsActive(&(GAMECARD_STORAGE_AREA_HANDLE(area)->s))) return true;
 
-    /* Close both gamecard handle and open storage area. */
-    gamecardCloseStorageArea();
+    /* Close a stale session for this storage area, if any. */
+    gamecardCloseStorageAreaSession(area);
 
     /* Retrieve both a new gamecard handle and a storage area handle. */
     if (!gamecardGetHandleAndStorage(area - 1)) /* Zero-based index. */
@@ -1056,12 +1317,31 @@ static bool gamecardOpenStorageArea(u8 area)
         return false;
     }
 
-    /* Update current gamecard storage area. */
-    g_gameCardCurrentStorageArea = area;
-
     return true;
 }
 
+static Result gamecardReadStorageAreaWithRetry(u8 area, void *out, u64 read_size, u64 base_offset)
+{
+    /* Issue the read using the persistent session for this storage area. */
+    Result rc = fsStorageRead(GAMECARD_STORAGE_AREA_HANDLE(area), base_offset, out, read_size);
+    if (R_SUCCEEDED(rc)) return rc;
+
+    /* The cached session may have been invalidated by a mode switch triggered when the other storage area was opened. */
+    /* Drop both the session and the gamecard handle, reopen this storage area and retry the read once. */
+    LOG_MSG_DEBUG("Retrying 0x%lX bytes long read at offset 0x%lX from %s storage area with a fresh session (0x%X).", read_size, base_offset, GAMECARD_STORAGE_AREA_NAME(area), rc);
+
+    gamecardCloseStorageAreaSession(area);
+    gamecardCloseHandle();
+
+    if (!gamecardOpenStorageArea(area))
+    {
+        LOG_MSG_ERROR("Failed to reopen %s storage area!", GAMECARD_STORAGE_AREA_NAME(area));
+        return rc;
+    }
+
+    return fsStorageRead(GAMECARD_STORAGE_AREA_HANDLE(area), base_offset, out, read_size);
+}
+
 static bool gamecardReadStorageArea(void *out, u64 read_size, u64 offset)
 {
     if (g_gameCardStatus < GameCardStatus_InsertedAndInfoNotLoaded || !g_gameCardNormalAreaSize || !g_gameCardSecureAreaSize || !out || !read_size || (offset + read_size) > g_gameCardTotalSize)
@@ -1105,7 +1385,7 @@ static bool gamecardReadStorageArea(void *out, u64 read_size, u64 offset)
     if (!(base_offset % GAMECARD_PAGE_SIZE) && !(read_size % GAMECARD_PAGE_SIZE))
     {
         /* Optimization for reads that are already aligned to a GAMECARD_PAGE_SIZE boundary. */
-        rc = fsStorageRead(&g_gameCardStorage, base_offset, out_u8, read_size);
+        rc = gamecardReadStorageAreaWithRetry(area, out_u8, read_size, base_offset);
         if (R_FAILED(rc))
         {
             LOG_MSG_ERROR("fsStorageRead failed to read 0x%lX bytes at offset 0x%lX from %s storage area! (0x%X) (aligned).", read_size, base_offset, GAMECARD_STORAGE_AREA_NAME(area), rc);
@@ -1123,7 +1403,7 @@ static bool gamecardReadStorageArea(void *out, u64 read_size, u64 offset)
         u64 chunk_size = (block_size > GAMECARD_READ_BUFFER_SIZE ? GAMECARD_READ_BUFFER_SIZE : block_size);
         u64 out_chunk_size = (block_size > GAMECARD_READ_BUFFER_SIZE ? (GAMECARD_READ_BUFFER_SIZE - data_start_offset) : read_size);
 
-        rc = fsStorageRead(&g_gameCardStorage, block_start_offset, g_gameCardReadBuf, chunk_size);
+        rc = gamecardReadStorageAreaWithRetry(area, g_gameCardReadBuf, chunk_size, block_start_offset);
         if (R_FAILED(rc))
         {
             LOG_MSG_ERROR("fsStorageRead failed to read 0x%lX bytes at offset 0x%lX from %s storage area! (0x%X) (unaligned).", chunk_size, block_start_offset, GAMECARD_STORAGE_AREA_NAME(area), rc);
@@ -1139,19 +1419,24 @@ end:
     return success;
 }
 
-static void gamecardCloseStorageArea(void)
+static void gamecardCloseStorageAreaSession(u8 area)
 {
-    if (g_gameCardCurrentStorageArea == GameCardStorageArea_None) return;
+    FsStorage *storage = GAMECARD_STORAGE_AREA_HANDLE(area);
 
-    if (serviceIsActive(&(g_gameCardStorage.s)))
+    if (serviceIsActive(&(storage->s)))
     {
-        fsStorageClose(&g_gameCardStorage);
-        memset(&g_gameCardStorage, 0, sizeof(FsStorage));
+        fsStorageClose(storage);
+        memset(storage, 0, sizeof(FsStorage));
     }
+}
 
-    gamecardCloseHandle();
+static void gamecardCloseStorageArea(void)
+{
+    /* Close both persistent storage area sessions. */
+    gamecardCloseStorageAreaSession(GameCardStorageArea_Normal);
+    gamecardCloseStorageAreaSession(GameCardStorageArea_Secure);
 
-    g_gameCardCurrentStorageArea = GameCardStorageArea_None;
+    gamecardCloseHandle();
 }
 
 static bool gamecardGetStorageAreasSizes(void)
@@ -1168,9 +1453,7 @@ static bool gamecardGetStorageAreasSizes(void)
             return false;
         }
 
-        rc = fsStorageGetSize(&g_gameCardStorage, (s64*)&area_size);
-
-        gamecardCloseStorageArea();
+        rc = fsStorageGetSize(GAMECARD_STORAGE_AREA_HANDLE(area), (s64*)&area_size);
 
         if (R_FAILED(rc) || !area_size)
         {
@@ -1358,8 +1641,8 @@ static HashFileSystemContext *_gamecardGetHashFileSystemContext(u8 hfs_partition
 {
     HashFileSystemContext *fs_ctx = NULL;
 
-    if (!g_gameCardInterfaceInit || g_gameCardStatus != GameCardStatus_InsertedAndInfoLoaded || !g_gameCardHfsCount || !g_gameCardHfsCtx || !hfs_partition_type || \
-        hfs_partition_type >= GameCardHashFileSystemPartitionType_Count)
+    if (!g_gameCardInterfaceInit || g_gameCardStatus != GameCardStatus_InsertedAndInfoLoaded || !(g_gameCardInfoLoadState & GameCardInfoLoadState_HashFs) || !g_gameCardHfsCount || \
+        !g_gameCardHfsCtx || !hfs_partition_type || hfs_partition_type >= GameCardHashFileSystemPartitionType_Count)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         goto end;
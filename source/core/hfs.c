@@ -22,6 +22,12 @@
 #include "nxdt_utils.h"
 #include "gamecard.h"
 
+/* Function prototypes. */
+
+static bool hfsBuildNameLookupTable(HashFileSystemContext *ctx);
+
+NX_INLINE u32 hfsCalculateNameHash(const char *name);
+
 bool hfsReadPartitionData(HashFileSystemContext *ctx, void *out, u64 read_size, u64 offset)
 {
     if (!ctx || !ctx->size || !out || !read_size || (offset + read_size) > ctx->size)
@@ -100,6 +106,33 @@ bool hfsGetEntryIndexByName(HashFileSystemContext *ctx, const char *name, u32 *o
 
     name_table_size = ((HashFileSystemHeader*)ctx->header)->name_table_size;
 
+    /* Build the name lookup table on the first lookup. If it can't be built, we simply fall back to a linear scan over the name table. */
+    if (!ctx->name_lookup && !hfsBuildNameLookupTable(ctx)) LOG_MSG_DEBUG("Unable to build name lookup table for Hash FS partition \"%s\". Falling back to a linear scan.", ctx->name);
+
+    if (ctx->name_lookup)
+    {
+        /* Probe the name lookup table, starting at the slot derived from the hashed entry name. */
+        /* Collisions are resolved through linear probing, so we only stop at an empty slot or after checking every slot in the table. */
+        u32 slot = (hfsCalculateNameHash(name) & (ctx->name_lookup_size - 1));
+
+        for(u32 i = 0; i < ctx->name_lookup_size; i++)
+        {
+            u32 slot_value = ctx->name_lookup[(slot + i) & (ctx->name_lookup_size - 1)];
+            if (!slot_value) break;
+
+            u32 entry_idx = (slot_value - 1);
+            if (!(fs_entry = hfsGetEntryByIndex(ctx, entry_idx)) || fs_entry->name_offset >= name_table_size) break;
+
+            if (!strcmp(name_table + fs_entry->name_offset, name))
+            {
+                *out_idx = entry_idx;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     for(u32 i = 0; i < entry_count; i++)
     {
         if (!(fs_entry = hfsGetEntryByIndex(ctx, i)))
@@ -123,3 +156,131 @@ bool hfsGetEntryIndexByName(HashFileSystemContext *ctx, const char *name, u32 *o
 
     return false;
 }
+
+bool hfsInitializeVerifiedEntryRead(HashFileSystemVerifiedReadContext *out, HashFileSystemContext *hfs_ctx, HashFileSystemEntry *fs_entry)
+{
+    if (!out || !hfs_ctx || !hfs_ctx->size || !fs_entry || !fs_entry->size || (fs_entry->offset + fs_entry->size) > hfs_ctx->size || \
+        (fs_entry->hash_target_offset + fs_entry->hash_target_size) > fs_entry->size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    memset(out, 0, sizeof(HashFileSystemVerifiedReadContext));
+
+    out->hfs_ctx = hfs_ctx;
+    out->fs_entry = fs_entry;
+
+    sha256ContextCreate(&(out->sha256_ctx));
+
+    /* Nothing to verify if the entry holds no hash target region. */
+    out->hash_checked = (fs_entry->hash_target_size == 0);
+
+    return true;
+}
+
+bool hfsReadVerifiedEntryData(HashFileSystemVerifiedReadContext *ctx, void *out, u64 read_size)
+{
+    if (!ctx || !ctx->hfs_ctx || !ctx->fs_entry || !out || !read_size || (ctx->cur_offset + read_size) > ctx->fs_entry->size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    HashFileSystemEntry *fs_entry = ctx->fs_entry;
+
+    /* Read entry data. */
+    if (!hfsReadEntryData(ctx->hfs_ctx, fs_entry, out, read_size, ctx->cur_offset)) return false;
+
+    /* Update the running checksum with the chunk area that overlaps the hash target region, if any. */
+    u64 hash_target_start = fs_entry->hash_target_offset;
+    u64 hash_target_end = (fs_entry->hash_target_offset + fs_entry->hash_target_size);
+    u64 chunk_end = (ctx->cur_offset + read_size);
+
+    if (!ctx->hash_checked && ctx->cur_offset < hash_target_end && chunk_end > hash_target_start)
+    {
+        u64 overlap_start = (ctx->cur_offset > hash_target_start ? ctx->cur_offset : hash_target_start);
+        u64 overlap_end = (chunk_end < hash_target_end ? chunk_end : hash_target_end);
+
+        sha256ContextUpdate(&(ctx->sha256_ctx), (const u8*)out + (overlap_start - ctx->cur_offset), overlap_end - overlap_start);
+
+        /* Validate the calculated checksum as soon as the hash target region has been fully consumed. */
+        if (overlap_end == hash_target_end)
+        {
+            u8 hash[SHA256_HASH_SIZE] = {0};
+            sha256ContextGetHash(&(ctx->sha256_ctx), hash);
+
+            if (memcmp(hash, fs_entry->hash, SHA256_HASH_SIZE) != 0)
+            {
+                LOG_MSG_ERROR("Hash target region checksum mismatch! (Hash FS partition \"%s\").", ctx->hfs_ctx->name);
+                return false;
+            }
+
+            ctx->hash_checked = true;
+        }
+    }
+
+    /* Update read offset. */
+    ctx->cur_offset = chunk_end;
+
+    return true;
+}
+
+static bool hfsBuildNameLookupTable(HashFileSystemContext *ctx)
+{
+    HashFileSystemEntry *fs_entry = NULL;
+    u32 entry_count = hfsGetEntryCount(ctx), name_table_size = 0, table_size = 0;
+    char *name_table = hfsGetNameTable(ctx);
+    u32 *name_lookup = NULL;
+
+    if (!entry_count || !name_table) return false;
+
+    name_table_size = ((HashFileSystemHeader*)ctx->header)->name_table_size;
+
+    /* Calculate table size. We use the smallest power of two that keeps the load factor at 50% or below, which keeps probe sequences short. */
+    table_size = 1;
+    while(table_size < (entry_count * 2)) table_size <<= 1;
+
+    /* Allocate memory for the lookup table. Empty slots hold zero, so we rely on calloc() clearing the buffer. */
+    name_lookup = calloc(table_size, sizeof(u32));
+    if (!name_lookup)
+    {
+        LOG_MSG_ERROR("Failed to allocate 0x%lX bytes for the name lookup table! (Hash FS partition \"%s\").", (u64)table_size * sizeof(u32), ctx->name);
+        return false;
+    }
+
+    /* Insert every entry into the lookup table, resolving collisions through linear probing. */
+    for(u32 i = 0; i < entry_count; i++)
+    {
+        if (!(fs_entry = hfsGetEntryByIndex(ctx, i)) || fs_entry->name_offset >= name_table_size)
+        {
+            LOG_MSG_ERROR("Failed to retrieve name from Hash FS entry #%u!", i);
+            free(name_lookup);
+            return false;
+        }
+
+        u32 slot = (hfsCalculateNameHash(name_table + fs_entry->name_offset) & (table_size - 1));
+        while(name_lookup[slot]) slot = ((slot + 1) & (table_size - 1));
+        name_lookup[slot] = (i + 1);
+    }
+
+    /* Update output context. */
+    ctx->name_lookup = name_lookup;
+    ctx->name_lookup_size = table_size;
+
+    return true;
+}
+
+NX_INLINE u32 hfsCalculateNameHash(const char *name)
+{
+    /* 32-bit FNV-1a. */
+    u32 hash = 0x811C9DC5;
+
+    while(*name)
+    {
+        hash ^= (u8)*name++;
+        hash *= 0x1000193;
+    }
+
+    return hash;
+}
@@ -22,11 +22,42 @@
 #include "nxdt_utils.h"
 #include "http.h"
 
+/* Type definitions. */
+
+/// Used by ranged downloads to keep track of a single connection.
+typedef struct {
+    CURL *curl;             ///< CURL easy handle driving this range.
+    FILE *fd;               ///< Output file. Shared between all ranges -- safe because the multi interface runs every transfer on the calling thread.
+    u64 cur_offset;         ///< Next absolute write offset within the output file.
+    u64 end_offset;         ///< Absolute end offset for this range (exclusive).
+    bool range_checked;     ///< Whether the HTTP status code for this range has been validated (206 Partial Content).
+    char range_str[0x30];   ///< "start-end" string passed to CURLOPT_RANGE.
+} HttpRangeContext;
+
+/// Used by cached downloads to keep track of HTTP cache validators.
+typedef struct {
+    char *etag;             ///< Dynamically allocated "ETag" header value, if available.
+    char *last_modified;    ///< Dynamically allocated "Last-Modified" header value, if available.
+} HttpCacheValidators;
+
 /* Global variables. */
 
 static Mutex g_httpMutex = 0;
 static bool g_httpInterfaceInit = false;
 
+static u32 g_httpActiveRequests = 0;
+
+/* Function prototypes. */
+
+static void httpSetCommonCurlOptions(CURL *curl, const char *url, bool force_https);
+static size_t httpWriteRangeCallback(char *buffer, size_t size, size_t nitems, void *outstream);
+static bool httpPerformRangedGetRequest(const char *url, bool force_https, FILE *fd, u64 size, HttpProgressCallback progress_cb, void *progress_ptr);
+
+static size_t httpCaptureCacheHeaderCallback(char *buffer, size_t size, size_t nitems, void *outstream);
+static void httpLoadCacheFile(const char *cache_path, HttpCacheValidators *validators, char **out_data, size_t *out_size);
+static void httpSaveCacheFile(const char *cache_path, HttpCacheValidators *validators, const char *data, size_t size);
+static void httpFreeCacheValidators(HttpCacheValidators *validators);
+
 bool httpInitialize(void)
 {
     bool ret = false;
@@ -53,14 +84,21 @@ bool httpInitialize(void)
 
 void httpExit(void)
 {
-    SCOPED_LOCK(&g_httpMutex)
-    {
-        /* Cleanup CURL. */
-        curl_global_cleanup();
+    /* Update flag. Makes sure no new requests are issued while we wait for the in-flight ones. */
+    SCOPED_LOCK(&g_httpMutex) g_httpInterfaceInit = false;
 
-        /* Update flag. */
-        g_httpInterfaceInit = false;
+    /* Wait until all in-flight requests are complete. */
+    /* curl_global_cleanup() isn't safe to call while easy handles are still being used. */
+    while(true)
+    {
+        bool busy = false;
+        SCOPED_LOCK(&g_httpMutex) busy = (g_httpActiveRequests > 0);
+        if (!busy) break;
+        svcSleepThread(10000000); /* 10 ms. */
     }
+
+    /* Cleanup CURL. */
+    curl_global_cleanup();
 }
 
 size_t httpWriteFileCallback(char *buffer, size_t size, size_t nitems, void *outstream)
@@ -76,11 +114,18 @@ size_t httpWriteBufferCallback(char *buffer, size_t size, size_t nitems, void *o
 
     if (!total_size) return 0;
 
-    char *data_tmp = realloc(http_buffer->data, http_buffer->size + total_size);
-    if (!data_tmp) return 0;
+    /* Grow the buffer geometrically instead of once per received chunk. */
+    if ((http_buffer->size + total_size) > http_buffer->capacity)
+    {
+        size_t capacity = (http_buffer->capacity ? http_buffer->capacity : (size_t)HTTP_BUFFER_SIZE);
+        while((http_buffer->size + total_size) > capacity) capacity *= 2;
+
+        char *data_tmp = realloc(http_buffer->data, capacity);
+        if (!data_tmp) return 0;
 
-    http_buffer->data = data_tmp;
-    data_tmp = NULL;
+        http_buffer->data = data_tmp;
+        http_buffer->capacity = capacity;
+    }
 
     memcpy(http_buffer->data + http_buffer->size, buffer, total_size);
     http_buffer->size += total_size;
@@ -90,96 +135,155 @@ size_t httpWriteBufferCallback(char *buffer, size_t size, size_t nitems, void *o
 
 bool httpPerformGetRequest(const char *url, bool force_https, size_t *outsize, HttpWriteCallback write_cb, void *write_ptr, HttpProgressCallback progress_cb, void *progress_ptr)
 {
-    bool ret = false;
+    bool ret = false, request_registered = false;
 
+    CURL *curl = NULL;
+    CURLcode res = CURLE_OK;
+    long http_code = 0;
+    curl_off_t download_size = 0, content_length = 0;
+    char curl_err_buf[CURL_ERROR_SIZE] = {0};
+    const char *error_str = NULL;
+
+    /* Check interface state and register this request. Only hold the mutex long enough to do that. */
+    /* Each request gets its own easy handle, so transfers issued from different threads overlap instead of serializing on the lock. */
     SCOPED_LOCK(&g_httpMutex)
     {
-        if (!g_httpInterfaceInit || !url || !*url)
-        {
-            LOG_MSG_ERROR("Invalid parameters!");
-            break;
-        }
+        request_registered = g_httpInterfaceInit;
+        if (request_registered) g_httpActiveRequests++;
+    }
 
-        CURL *curl = NULL;
-        CURLcode res = CURLE_OK;
-        long http_code = 0;
-        curl_off_t download_size = 0, content_length = 0;
-        char curl_err_buf[CURL_ERROR_SIZE] = {0};
-        const char *error_str = NULL;
+    if (!request_registered || !url || !*url)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        goto end;
+    }
 
-        /* Start CURL session. */
-        curl = curl_easy_init();
-        if (!curl)
-        {
-            LOG_MSG_ERROR("Failed to start CURL session for \"%s\"!", url);
-            break;
-        }
+    /* Start CURL session. */
+    curl = curl_easy_init();
+    if (!curl)
+    {
+        LOG_MSG_ERROR("Failed to start CURL session for \"%s\"!", url);
+        goto end;
+    }
 
-        /* Set CURL options. */
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, HTTP_USER_AGENT);
-        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curl_err_buf);
-        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 50L);
-        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, HTTP_CONNECT_TIMEOUT);
-        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, HTTP_LOW_SPEED_LIMIT);
-        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, HTTP_LOW_SPEED_TIME);
-        curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, HTTP_BUFFER_SIZE);
-        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)(force_https ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_1_1));
-
-        if (write_cb) curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
-        if (write_ptr) curl_easy_setopt(curl, CURLOPT_WRITEDATA, write_ptr);
+    /* Set CURL options. */
+    httpSetCommonCurlOptions(curl, url, force_https);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curl_err_buf);
 
-        if (progress_cb)
-        {
-            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_cb);
-        }
+    if (write_cb) curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+    if (write_ptr) curl_easy_setopt(curl, CURLOPT_WRITEDATA, write_ptr);
 
-        if (progress_ptr) curl_easy_setopt(curl, CURLOPT_XFERINFODATA, progress_ptr);
+    if (progress_cb)
+    {
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_cb);
+    }
 
-        /* Perform GET request. */
-        res = curl_easy_perform(curl);
+    if (progress_ptr) curl_easy_setopt(curl, CURLOPT_XFERINFODATA, progress_ptr);
 
-        /* Get HTTP request properties. */
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-        curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &download_size);
-        curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+    /* Perform GET request. */
+    res = curl_easy_perform(curl);
 
-        /* End CURL session. */
-        curl_easy_cleanup(curl);
+    /* Get HTTP request properties. */
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &download_size);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
 
-        /* Update return value. */
-        ret = (res == CURLE_OK && http_code >= 200 && http_code <= 299 && (content_length <= 0 || download_size == content_length));
-        if (ret)
+    /* End CURL session. */
+    curl_easy_cleanup(curl);
+
+    /* Update return value. */
+    ret = (res == CURLE_OK && http_code >= 200 && http_code <= 299 && (content_length <= 0 || download_size == content_length));
+    if (ret)
+    {
+        /* Update output size. */
+        if (outsize) *outsize = (size_t)download_size;
+    } else {
+        LOG_MSG_ERROR("curl_easy_perform failed for \"%s\"! (res %d, HTTP code %ld, download %ld, length %ld).", url, res, http_code, download_size, content_length);
+        if (res != CURLE_OK)
         {
-            /* Update output size. */
-            if (outsize) *outsize = (size_t)download_size;
-        } else {
-            LOG_MSG_ERROR("curl_easy_perform failed for \"%s\"! (res %d, HTTP code %ld, download %ld, length %ld).", url, res, http_code, download_size, content_length);
-            if (res != CURLE_OK)
+            /* Log CURL error info. */
+            if (*curl_err_buf)
             {
-                /* Log CURL error info. */
-                if (*curl_err_buf)
-                {
-                    size_t curl_err_buf_len = strlen(curl_err_buf);
-
-                    if (curl_err_buf[curl_err_buf_len - 1] == '\n') curl_err_buf[--curl_err_buf_len] = '\0';
-                    if (curl_err_buf[curl_err_buf_len - 1] == '\r') curl_err_buf[--curl_err_buf_len] = '\0';
+                size_t curl_err_buf_len = strlen(curl_err_buf);
 
-                    error_str = curl_err_buf;
-                } else {
-                    error_str = curl_easy_strerror(res);
-                }
+                if (curl_err_buf[curl_err_buf_len - 1] == '\n') curl_err_buf[--curl_err_buf_len] = '\0';
+                if (curl_err_buf[curl_err_buf_len - 1] == '\r') curl_err_buf[--curl_err_buf_len] = '\0';
 
-                if (error_str) LOG_MSG_INFO("CURL error info: \"%s\".", error_str);
+                error_str = curl_err_buf;
+            } else {
+                error_str = curl_easy_strerror(res);
             }
+
+            if (error_str) LOG_MSG_INFO("CURL error info: \"%s\".", error_str);
         }
     }
 
+end:
+    /* Unregister this request. */
+    if (request_registered) SCOPED_LOCK(&g_httpMutex) g_httpActiveRequests--;
+
+    return ret;
+}
+
+bool httpGetDownloadSize(const char *url, bool force_https, u64 *out_size)
+{
+    bool ret = false, request_registered = false;
+
+    CURL *curl = NULL;
+    CURLcode res = CURLE_OK;
+    long http_code = 0;
+    curl_off_t content_length = 0;
+
+    /* Check interface state and register this request. Only hold the mutex long enough to do that. */
+    SCOPED_LOCK(&g_httpMutex)
+    {
+        request_registered = g_httpInterfaceInit;
+        if (request_registered) g_httpActiveRequests++;
+    }
+
+    if (!request_registered || !url || !*url || !out_size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        goto end;
+    }
+
+    /* Start CURL session. */
+    curl = curl_easy_init();
+    if (!curl)
+    {
+        LOG_MSG_ERROR("Failed to start CURL session for \"%s\"!", url);
+        goto end;
+    }
+
+    /* Set CURL options. CURLOPT_NOBODY turns this into a HEAD request. */
+    httpSetCommonCurlOptions(curl, url, force_https);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+
+    /* Perform HEAD request. */
+    res = curl_easy_perform(curl);
+
+    /* Get HTTP request properties. */
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+
+    /* End CURL session. */
+    curl_easy_cleanup(curl);
+
+    /* Update return value. */
+    ret = (res == CURLE_OK && http_code >= 200 && http_code <= 299 && content_length > 0);
+    if (ret)
+    {
+        /* Update output size. */
+        *out_size = (u64)content_length;
+    } else {
+        LOG_MSG_DEBUG("HEAD request for \"%s\" didn't yield a usable download size. (res %d, HTTP code %ld, length %ld).", url, res, http_code, content_length);
+    }
+
+end:
+    /* Unregister this request. */
+    if (request_registered) SCOPED_LOCK(&g_httpMutex) g_httpActiveRequests--;
+
     return ret;
 }
 
@@ -192,6 +296,7 @@ bool httpDownloadFile(const char *path, const char *url, bool force_https, HttpP
     }
 
     FILE *fd = NULL;
+    u64 download_size = 0;
     bool ret = false;
 
     /* Open output file. */
@@ -202,11 +307,31 @@ bool httpDownloadFile(const char *path, const char *url, bool force_https, HttpP
         return false;
     }
 
-    /* Perform HTTP GET request. */
-    ret = httpPerformGetRequest(url, force_https, NULL, httpWriteFileCallback, fd, progress_cb, progress_ptr);
+    /* Attempt a ranged, multi-connection download first for big enough files. Parallel range requests work around per-connection bandwidth throttling. */
+    if (httpGetDownloadSize(url, force_https, &download_size) && download_size >= HTTP_RANGED_MIN_SIZE)
+    {
+        /* Preallocate the output file, making it possible for each connection to write data at its own offset right away. */
+        if (ftruncate(fileno(fd), (off_t)download_size) == 0)
+        {
+            /* Perform ranged HTTP GET requests. */
+            ret = httpPerformRangedGetRequest(url, force_https, fd, download_size, progress_cb, progress_ptr);
+        } else {
+            LOG_MSG_ERROR("Failed to preallocate 0x%lX bytes for \"%s\"!", download_size, path);
+        }
+
+        /* Reset the output file if the ranged download couldn't be carried out (e.g. servers that don't honor range requests). */
+        if (!ret)
+        {
+            LOG_MSG_INFO("Falling back to a single connection download for \"%s\".", url);
+            fd = freopen(path, "wb", fd);
+        }
+    }
+
+    /* Perform a regular HTTP GET request, if needed. */
+    if (!ret && fd) ret = httpPerformGetRequest(url, force_https, NULL, httpWriteFileCallback, fd, progress_cb, progress_ptr);
 
     /* Close output file. */
-    fclose(fd);
+    if (fd) fclose(fd);
 
     /* Delete output file if the request failed. */
     if (!ret) remove(path);
@@ -231,12 +356,465 @@ char *httpDownloadData(size_t *outsize, const char *url, bool force_https, HttpP
     /* Perform HTTP GET request. */
     ret = httpPerformGetRequest(url, force_https, outsize, httpWriteBufferCallback, &http_buffer, progress_cb, progress_ptr);
 
-    /* Free output buffer if the request failed. */
-    if (!ret && http_buffer.data)
+    if (ret)
     {
+        /* Shrink output buffer to the downloaded size. The write callback overallocates to avoid reallocating the buffer on every received chunk. */
+        if (http_buffer.data && http_buffer.size < http_buffer.capacity)
+        {
+            char *data_tmp = realloc(http_buffer.data, http_buffer.size);
+            if (data_tmp) http_buffer.data = data_tmp;
+        }
+    } else
+    if (http_buffer.data)
+    {
+        /* Free output buffer if the request failed. */
         free(http_buffer.data);
         http_buffer.data = NULL;
     }
 
     return http_buffer.data;
 }
+
+char *httpDownloadDataCached(size_t *outsize, const char *url, bool force_https, const char *cache_path, HttpProgressCallback progress_cb, void *progress_ptr)
+{
+    bool request_registered = false;
+
+    CURL *curl = NULL;
+    CURLcode res = CURLE_OK;
+    long http_code = 0;
+    curl_off_t download_size = 0, content_length = 0;
+    struct curl_slist *headers = NULL;
+    char hdr_buf[0x220] = {0};
+
+    HttpBuffer http_buffer = {0};
+    HttpCacheValidators cached_validators = {0}, received_validators = {0};
+    char *cached_data = NULL, *out_data = NULL;
+    size_t cached_data_size = 0;
+
+    /* Check interface state and register this request. Only hold the mutex long enough to do that. */
+    SCOPED_LOCK(&g_httpMutex)
+    {
+        request_registered = g_httpInterfaceInit;
+        if (request_registered) g_httpActiveRequests++;
+    }
+
+    if (!request_registered || !url || !*url || !outsize || !cache_path || !*cache_path)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        goto end;
+    }
+
+    /* Load cached data and validators. A missing or invalid cache file simply turns this into an unconditional request. */
+    httpLoadCacheFile(cache_path, &cached_validators, &cached_data, &cached_data_size);
+
+    /* Start CURL session. */
+    curl = curl_easy_init();
+    if (!curl)
+    {
+        LOG_MSG_ERROR("Failed to start CURL session for \"%s\"!", url);
+        goto end;
+    }
+
+    /* Set CURL options. */
+    httpSetCommonCurlOptions(curl, url, force_https);
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, httpWriteBufferCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &http_buffer);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, httpCaptureCacheHeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &received_validators);
+
+    if (progress_cb)
+    {
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_cb);
+    }
+
+    if (progress_ptr) curl_easy_setopt(curl, CURLOPT_XFERINFODATA, progress_ptr);
+
+    /* Turn this into a conditional request if we hold a cached copy with usable validators. */
+    if (cached_data)
+    {
+        if (cached_validators.etag)
+        {
+            snprintf(hdr_buf, sizeof(hdr_buf), "If-None-Match: %s", cached_validators.etag);
+            headers = curl_slist_append(headers, hdr_buf);
+        }
+
+        if (cached_validators.last_modified)
+        {
+            snprintf(hdr_buf, sizeof(hdr_buf), "If-Modified-Since: %s", cached_validators.last_modified);
+            headers = curl_slist_append(headers, hdr_buf);
+        }
+
+        if (headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    }
+
+    /* Perform GET request. */
+    res = curl_easy_perform(curl);
+
+    /* Get HTTP request properties. */
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &download_size);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+
+    /* End CURL session. */
+    curl_easy_cleanup(curl);
+
+    if (res == CURLE_OK && http_code == 304)
+    {
+        /* Not modified: hand over the cached copy for the cost of a single header round-trip. */
+        LOG_MSG_DEBUG("Cache hit for \"%s\" (0x%lX bytes).", url, cached_data_size);
+
+        *outsize = cached_data_size;
+        out_data = cached_data;
+        cached_data = NULL;
+    } else
+    if (res == CURLE_OK && http_code >= 200 && http_code <= 299 && (content_length <= 0 || download_size == content_length))
+    {
+        /* Fresh download: update the cache file with the received data and validators. */
+        httpSaveCacheFile(cache_path, &received_validators, http_buffer.data, http_buffer.size);
+
+        /* Shrink output buffer to the downloaded size. The write callback overallocates to avoid reallocating the buffer on every received chunk. */
+        if (http_buffer.data && http_buffer.size < http_buffer.capacity)
+        {
+            char *data_tmp = realloc(http_buffer.data, http_buffer.size);
+            if (data_tmp) http_buffer.data = data_tmp;
+        }
+
+        *outsize = http_buffer.size;
+        out_data = http_buffer.data;
+        http_buffer.data = NULL;
+    } else {
+        LOG_MSG_ERROR("curl_easy_perform failed for \"%s\"! (res %d, HTTP code %ld, download %ld, length %ld).", url, res, http_code, download_size, content_length);
+    }
+
+end:
+    if (headers) curl_slist_free_all(headers);
+
+    if (http_buffer.data) free(http_buffer.data);
+
+    if (cached_data) free(cached_data);
+
+    httpFreeCacheValidators(&received_validators);
+    httpFreeCacheValidators(&cached_validators);
+
+    /* Unregister this request. */
+    if (request_registered) SCOPED_LOCK(&g_httpMutex) g_httpActiveRequests--;
+
+    return out_data;
+}
+
+static void httpSetCommonCurlOptions(CURL *curl, const char *url, bool force_https)
+{
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, HTTP_USER_AGENT);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 50L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, HTTP_CONNECT_TIMEOUT);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, HTTP_LOW_SPEED_LIMIT);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, HTTP_LOW_SPEED_TIME);
+    curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, HTTP_BUFFER_SIZE);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)(force_https ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_1_1));
+}
+
+static size_t httpWriteRangeCallback(char *buffer, size_t size, size_t nitems, void *outstream)
+{
+    size_t total_size = (size * nitems);
+    HttpRangeContext *range_ctx = (HttpRangeContext*)outstream;
+
+    if (!total_size) return 0;
+
+    /* Make sure the server actually honored our range request before writing anything. A 200 reply would hold the whole resource. */
+    if (!range_ctx->range_checked)
+    {
+        long http_code = 0;
+        curl_easy_getinfo(range_ctx->curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code != 206) return 0;
+        range_ctx->range_checked = true;
+    }
+
+    /* Bail out if the server sends more data than we asked for. */
+    if ((range_ctx->cur_offset + total_size) > range_ctx->end_offset) return 0;
+
+    /* Write data at the right offset within the shared output file. */
+    if (fseeko(range_ctx->fd, (off_t)range_ctx->cur_offset, SEEK_SET) != 0 || fwrite(buffer, 1, total_size, range_ctx->fd) != total_size) return 0;
+
+    range_ctx->cur_offset += total_size;
+
+    return total_size;
+}
+
+static bool httpPerformRangedGetRequest(const char *url, bool force_https, FILE *fd, u64 size, HttpProgressCallback progress_cb, void *progress_ptr)
+{
+    bool ret = false, request_registered = false;
+
+    CURLM *curl_multi = NULL;
+    CURLMcode mres = CURLM_OK;
+    HttpRangeContext ranges[HTTP_RANGED_CONNECTION_COUNT] = {0};
+    u64 chunk_size = 0;
+    int running = 0;
+
+    /* Check interface state and register this request. Only hold the mutex long enough to do that. */
+    SCOPED_LOCK(&g_httpMutex)
+    {
+        request_registered = g_httpInterfaceInit;
+        if (request_registered) g_httpActiveRequests++;
+    }
+
+    if (!request_registered || !url || !*url || !fd || size < HTTP_RANGED_CONNECTION_COUNT)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        goto end;
+    }
+
+    /* Start CURL multi session. */
+    curl_multi = curl_multi_init();
+    if (!curl_multi)
+    {
+        LOG_MSG_ERROR("Failed to start CURL multi session for \"%s\"!", url);
+        goto end;
+    }
+
+    /* Set up one easy handle per range. The last range absorbs the remainder of the division. */
+    chunk_size = (size / HTTP_RANGED_CONNECTION_COUNT);
+
+    for(u32 i = 0; i < HTTP_RANGED_CONNECTION_COUNT; i++)
+    {
+        HttpRangeContext *range_ctx = &(ranges[i]);
+
+        range_ctx->fd = fd;
+        range_ctx->cur_offset = ((u64)i * chunk_size);
+        range_ctx->end_offset = (i == (HTTP_RANGED_CONNECTION_COUNT - 1) ? size : (range_ctx->cur_offset + chunk_size));
+
+        if (!(range_ctx->curl = curl_easy_init()))
+        {
+            LOG_MSG_ERROR("Failed to start CURL session for range #%u from \"%s\"!", i, url);
+            goto end;
+        }
+
+        snprintf(range_ctx->range_str, sizeof(range_ctx->range_str), "%lu-%lu", range_ctx->cur_offset, range_ctx->end_offset - 1);
+
+        httpSetCommonCurlOptions(range_ctx->curl, url, force_https);
+        curl_easy_setopt(range_ctx->curl, CURLOPT_RANGE, range_ctx->range_str);
+        curl_easy_setopt(range_ctx->curl, CURLOPT_WRITEFUNCTION, httpWriteRangeCallback);
+        curl_easy_setopt(range_ctx->curl, CURLOPT_WRITEDATA, range_ctx);
+
+        if ((mres = curl_multi_add_handle(curl_multi, range_ctx->curl)) != CURLM_OK)
+        {
+            LOG_MSG_ERROR("Failed to add range #%u from \"%s\" to the CURL multi session! (%s).", i, url, curl_multi_strerror(mres));
+            goto end;
+        }
+    }
+
+    /* Drive all transfers from this thread. */
+    do {
+        mres = curl_multi_perform(curl_multi, &running);
+        if (mres == CURLM_OK && running) mres = curl_multi_poll(curl_multi, NULL, 0, 1000, NULL);
+
+        if (mres != CURLM_OK)
+        {
+            LOG_MSG_ERROR("CURL multi session failed for \"%s\"! (%s).", url, curl_multi_strerror(mres));
+            break;
+        }
+
+        /* Report aggregated progress and cancel the whole download if the callback asks us to. */
+        if (progress_cb)
+        {
+            curl_off_t dlnow = 0;
+            for(u32 i = 0; i < HTTP_RANGED_CONNECTION_COUNT; i++) dlnow += (curl_off_t)(ranges[i].cur_offset - ((u64)i * chunk_size));
+            if (progress_cb(progress_ptr, (curl_off_t)size, dlnow, 0, 0) != 0) break;
+        }
+    } while(running);
+
+    if (mres == CURLM_OK && !running)
+    {
+        CURLMsg *msg = NULL;
+        int msgs_left = 0;
+
+        ret = true;
+
+        /* Check per-transfer results. */
+        while((msg = curl_multi_info_read(curl_multi, &msgs_left)))
+        {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            long http_code = 0;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &http_code);
+
+            if (msg->data.result != CURLE_OK || http_code != 206)
+            {
+                LOG_MSG_ERROR("Ranged transfer failed for \"%s\"! (res %d, HTTP code %ld).", url, msg->data.result, http_code);
+                ret = false;
+            }
+        }
+
+        /* Make sure every range was written in full. */
+        for(u32 i = 0; ret && i < HTTP_RANGED_CONNECTION_COUNT; i++) ret = (ranges[i].cur_offset == ranges[i].end_offset);
+    }
+
+end:
+    /* End CURL sessions. */
+    for(u32 i = 0; i < HTTP_RANGED_CONNECTION_COUNT; i++)
+    {
+        if (!ranges[i].curl) continue;
+        if (curl_multi) curl_multi_remove_handle(curl_multi, ranges[i].curl);
+        curl_easy_cleanup(ranges[i].curl);
+    }
+
+    if (curl_multi) curl_multi_cleanup(curl_multi);
+
+    /* Unregister this request. */
+    if (request_registered) SCOPED_LOCK(&g_httpMutex) g_httpActiveRequests--;
+
+    return ret;
+}
+
+static size_t httpCaptureCacheHeaderCallback(char *buffer, size_t size, size_t nitems, void *outstream)
+{
+    size_t total_size = (size * nitems);
+    HttpCacheValidators *validators = (HttpCacheValidators*)outstream;
+
+    const char *etag_hdr = "etag:", *last_modified_hdr = "last-modified:";
+    char **dst = NULL;
+    size_t hdr_len = 0;
+
+    if (!total_size) return 0;
+
+    /* Check if this is a header we care about. Header names are case-insensitive. */
+    if (total_size > (hdr_len = strlen(etag_hdr)) && !strncasecmp(buffer, etag_hdr, hdr_len))
+    {
+        dst = &(validators->etag);
+    } else
+    if (total_size > (hdr_len = strlen(last_modified_hdr)) && !strncasecmp(buffer, last_modified_hdr, hdr_len))
+    {
+        dst = &(validators->last_modified);
+    } else {
+        return total_size;
+    }
+
+    /* Trim leading whitespace and the trailing CRLF. */
+    const char *value = (buffer + hdr_len);
+    size_t value_len = (total_size - hdr_len);
+
+    while(value_len && (*value == ' ' || *value == '\t'))
+    {
+        value++;
+        value_len--;
+    }
+
+    while(value_len && (value[value_len - 1] == '\r' || value[value_len - 1] == '\n')) value_len--;
+
+    if (!value_len) return total_size;
+
+    /* Save header value, replacing any previous one. Redirects can yield more than one header set, and the last one always wins. */
+    char *value_dup = strndup(value, value_len);
+    if (value_dup)
+    {
+        if (*dst) free(*dst);
+        *dst = value_dup;
+    }
+
+    return total_size;
+}
+
+static void httpLoadCacheFile(const char *cache_path, HttpCacheValidators *validators, char **out_data, size_t *out_size)
+{
+    FILE *fd = NULL;
+    size_t cache_size = 0, data_size = 0;
+    char *buf = NULL, *etag_end = NULL, *last_modified_end = NULL;
+
+    /* Open cache file. */
+    fd = fopen(cache_path, "rb");
+    if (!fd) return;
+
+    /* Get cache file size. */
+    fseek(fd, 0, SEEK_END);
+    cache_size = (size_t)ftell(fd);
+    rewind(fd);
+
+    /* Read the whole cache file. */
+    if (!cache_size || !(buf = malloc(cache_size + 1)) || fread(buf, 1, cache_size, fd) != cache_size)
+    {
+        if (buf) free(buf);
+        fclose(fd);
+        return;
+    }
+
+    fclose(fd);
+    buf[cache_size] = '\0';
+
+    /* Parse cache file layout: one line per validator (possibly empty), followed by the cached payload. */
+    if (!(etag_end = memchr(buf, '\n', cache_size)) || !(last_modified_end = memchr(etag_end + 1, '\n', cache_size - (size_t)(etag_end + 1 - buf))) || \
+        !(data_size = (cache_size - (size_t)(last_modified_end + 1 - buf))))
+    {
+        LOG_MSG_DEBUG("Discarding invalid cache file \"%s\".", cache_path);
+        free(buf);
+        return;
+    }
+
+    if (etag_end > buf) validators->etag = strndup(buf, (size_t)(etag_end - buf));
+    if (last_modified_end > (etag_end + 1)) validators->last_modified = strndup(etag_end + 1, (size_t)(last_modified_end - (etag_end + 1)));
+
+    /* Copy cached payload. */
+    *out_data = malloc(data_size);
+    if (*out_data)
+    {
+        memcpy(*out_data, last_modified_end + 1, data_size);
+        *out_size = data_size;
+    } else {
+        httpFreeCacheValidators(validators);
+    }
+
+    free(buf);
+}
+
+static void httpSaveCacheFile(const char *cache_path, HttpCacheValidators *validators, const char *data, size_t size)
+{
+    FILE *fd = NULL;
+    bool success = false;
+
+    if (!data || !size) return;
+
+    /* Don't bother saving a cache file we'd never be able to validate. */
+    if (!validators->etag && !validators->last_modified) return;
+
+    /* Open cache file. */
+    fd = fopen(cache_path, "wb");
+    if (!fd)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\" for writing!", cache_path);
+        return;
+    }
+
+    /* Write validators followed by the payload. */
+    success = (fprintf(fd, "%s\n%s\n", validators->etag ? validators->etag : "", validators->last_modified ? validators->last_modified : "") > 0 && \
+               fwrite(data, 1, size, fd) == size);
+
+    fclose(fd);
+
+    /* Delete cache file if we couldn't write the whole thing. */
+    if (!success) remove(cache_path);
+
+    /* Commit SD card filesystem changes. */
+    utilsCommitSdCardFileSystemChanges();
+}
+
+static void httpFreeCacheValidators(HttpCacheValidators *validators)
+{
+    if (!validators) return;
+
+    if (validators->etag)
+    {
+        free(validators->etag);
+        validators->etag = NULL;
+    }
+
+    if (validators->last_modified)
+    {
+        free(validators->last_modified);
+        validators->last_modified = NULL;
+    }
+}
@@ -31,6 +31,10 @@
 
 #define ETICKET_RSA_DEVICE_KEY_PUBLIC_EXPONENT  0x10001
 
+#define KEYSET_CACHE_PATH                       DEVOPTAB_SDMC_DEVICE APP_BASE_PATH "keyset_cache.bin"
+#define KEYSET_CACHE_MAGIC                      0x4E584B43  /* "NXKC". */
+#define KEYSET_CACHE_VERSION                    1
+
 /* Type definitions. */
 
 typedef struct {
@@ -82,6 +86,29 @@ typedef struct {
 
 NXDT_ASSERT(EticketRsaDeviceKey, 0x240);
 
+/// Header for the encrypted keyset cache file stored on the SD card.
+/// The KeysetCachePayload block that follows it is encrypted using AES-128-CTR with a console-unique key generated through the SMC AES engine, making the file useless on any other console.
+typedef struct {
+    u32 magic;                              ///< "NXKC".
+    u32 version;                            ///< Cache format version. Must match KEYSET_CACHE_VERSION.
+    u32 hos_version;                        ///< Horizon OS version the cached keyset was derived under. A firmware update invalidates the cache.
+    u8 key_generation;                      ///< NcaKeyGeneration_Current value the cached keyset was derived under. An application update that bumps it invalidates the cache.
+    u8 reserved[0x3];
+    u8 keys_file_hash[SHA256_HASH_SIZE];    ///< SHA-256 hash calculated over the Lockpick_RCM keys file. A keys file change invalidates the cache.
+    u8 ctr[AES_128_KEY_SIZE];               ///< Randomly generated AES-128-CTR counter used to encrypt the payload.
+    u8 payload_hash[SHA256_HASH_SIZE];      ///< SHA-256 hash calculated over the decrypted payload. Detects both data corruption and cache key mismatches.
+} KeysetCacheHeader;
+
+NXDT_ASSERT(KeysetCacheHeader, 0x60);
+
+/// Payload from the encrypted keyset cache file. Holds all derived keydata used by the application.
+typedef struct {
+    SetCalRsa2048DeviceKey eticket_rsa_device_key;  ///< Decrypted eTicket RSA device key.
+    KeysNxKeyset keyset;                            ///< Fully derived NX keyset.
+    u8 latest_master_key_available;                 ///< Backs up the g_latestMasterKeyAvailable flag.
+    u8 reserved[0x7];
+} KeysetCachePayload;
+
 /* Function prototypes. */
 
 static bool keysIsKeyEmpty(const void *key);
@@ -99,6 +126,11 @@ static bool keysDeriveGcCardInfoKey(void);
 static bool keysGetDecryptedEticketRsaDeviceKey(void);
 static bool keysTestEticketRsaDeviceKey(const void *e, const void *d, const void *n);
 
+static bool keysCalculateKeysFileHash(u8 *out_hash);
+static bool keysGenerateKeysetCacheKey(u8 *out_key);
+static bool keysLoadKeysetFromCache(void);
+static void keysSaveKeysetToCache(void);
+
 static bool keysGenerateAesKek(const u8 *kek_src, u8 key_generation, SmcGenerateAesKekOption option, u8 *out_kek);
 static bool keysLoadAesKey(const u8 *kek, const u8 *key_src, u8 *out_key);
 static bool keysGenerateAesKey(const u8 *kek, const u8 *key_src, u8 *out_key);
@@ -125,6 +157,14 @@ bool keysLoadKeyset(void)
         ret = g_keysetLoaded;
         if (ret) break;
 
+        /* Try to load the previously derived keyset from the encrypted cache file first. */
+        /* A cache hit skips keys file parsing, key derivation and the eTicket RSA device key decryption + verification steps entirely. */
+        if (keysLoadKeysetFromCache())
+        {
+            ret = g_keysetLoaded = true;
+            break;
+        }
+
         /* Get eTicket RSA device key. */
         Result rc = setcalGetEticketDeviceKey(&g_eTicketRsaDeviceKey);
         if (R_FAILED(rc))
@@ -159,6 +199,10 @@ bool keysLoadKeyset(void)
         /* Get decrypted eTicket RSA device key. */
         if (!keysGetDecryptedEticketRsaDeviceKey()) break;
 
+        /* Save the freshly derived keyset to the encrypted cache file so further launches can skip all of the above. */
+        /* Failure isn't fatal - the next launch will simply derive everything again. */
+        keysSaveKeysetToCache();
+
         /* Update flags. */
         ret = g_keysetLoaded = true;
     }
@@ -863,6 +907,196 @@ static bool keysTestEticketRsaDeviceKey(const void *e, const void *d, const void
     return true;
 }
 
+static bool keysCalculateKeysFileHash(u8 *out_hash)
+{
+    FILE *keys_file = NULL;
+    size_t blksize = 0;
+    u8 buf[0x800] = {0};
+    Sha256Context sha256_ctx = {0};
+
+    const char *keys_file_path = (utilsIsDevelopmentUnit() ? DEV_KEYS_FILE_PATH : PROD_KEYS_FILE_PATH);
+
+    keys_file = fopen(keys_file_path, "rb");
+    if (!keys_file)
+    {
+        LOG_MSG_ERROR("Unable to open \"%s\" to calculate its hash!", keys_file_path);
+        return false;
+    }
+
+    sha256ContextCreate(&sha256_ctx);
+    while((blksize = fread(buf, 1, sizeof(buf), keys_file)) > 0) sha256ContextUpdate(&sha256_ctx, buf, blksize);
+    sha256ContextGetHash(&sha256_ctx, out_hash);
+
+    fclose(keys_file);
+
+    return true;
+}
+
+static bool keysGenerateKeysetCacheKey(u8 *out_key)
+{
+    Result rc = 0;
+    u8 sealed_kek[AES_128_KEY_SIZE] = {0};
+    SmcGenerateAesKekOption option = {0};
+
+    /* Prepare a device-unique KEK option. Keys generated this way can only ever be reproduced on this very console. */
+    smcPrepareGenerateAesKekOption(true, SmcKeyType_Default, SmcSealKey_LoadAesKey, &option);
+
+    /* Generate a sealed, console-unique KEK using our own hardcoded KEK source. */
+    /* Key generation 0 is used on purpose - it's available on all units regardless of their firmware version. */
+    rc = splCryptoGenerateAesKek(g_keysetCacheKekSource, 0, option.value, sealed_kek);
+    if (R_FAILED(rc))
+    {
+        LOG_MSG_ERROR("splCryptoGenerateAesKek failed! (0x%X).", rc);
+        return false;
+    }
+
+    /* Generate the actual cache key using the sealed KEK and our own hardcoded key source. */
+    rc = splCryptoGenerateAesKey(sealed_kek, g_keysetCacheKeySource, out_key);
+    if (R_FAILED(rc))
+    {
+        LOG_MSG_ERROR("splCryptoGenerateAesKey failed! (0x%X).", rc);
+        return false;
+    }
+
+    return true;
+}
+
+static bool keysLoadKeysetFromCache(void)
+{
+    FILE *cache_file = NULL;
+    KeysetCacheHeader cache_header = {0};
+    KeysetCachePayload cache_payload = {0};
+    u8 keys_file_hash[SHA256_HASH_SIZE] = {0}, payload_hash[SHA256_HASH_SIZE] = {0}, cache_key[AES_128_KEY_SIZE] = {0};
+    Aes128CtrContext cache_aes_ctx = {0};
+    bool success = false;
+
+    /* Hash the current keys file. A keys file change must always trigger a full keyset derivation. */
+    if (!keysCalculateKeysFileHash(keys_file_hash)) return false;
+
+    /* Open cache file. It's perfectly fine for it not to exist yet. */
+    cache_file = fopen(KEYSET_CACHE_PATH, "rb");
+    if (!cache_file) return false;
+
+    /* Read and validate cache header. */
+    if (fread(&cache_header, 1, sizeof(KeysetCacheHeader), cache_file) != sizeof(KeysetCacheHeader))
+    {
+        LOG_MSG_ERROR("Failed to read keyset cache header!");
+        goto end;
+    }
+
+    if (cache_header.magic != KEYSET_CACHE_MAGIC || cache_header.version != KEYSET_CACHE_VERSION || cache_header.hos_version != hosversionGet() || \
+        cache_header.key_generation != NcaKeyGeneration_Current || memcmp(cache_header.keys_file_hash, keys_file_hash, SHA256_HASH_SIZE) != 0)
+    {
+        LOG_MSG_INFO("Keyset cache is stale or unusable (0x%08X, %u, 0x%08X, 0x%02X). Discarding it.", cache_header.magic, cache_header.version, cache_header.hos_version, \
+                     cache_header.key_generation);
+        goto end;
+    }
+
+    /* Read encrypted cache payload. */
+    if (fread(&cache_payload, 1, sizeof(KeysetCachePayload), cache_file) != sizeof(KeysetCachePayload))
+    {
+        LOG_MSG_ERROR("Failed to read keyset cache payload!");
+        goto end;
+    }
+
+    /* Generate the console-unique cache key. */
+    if (!keysGenerateKeysetCacheKey(cache_key)) goto end;
+
+    /* Decrypt cache payload in-place. */
+    aes128CtrContextCreate(&cache_aes_ctx, cache_key, cache_header.ctr);
+    aes128CtrCrypt(&cache_aes_ctx, &cache_payload, &cache_payload, sizeof(KeysetCachePayload));
+
+    /* Verify the decrypted payload hash. A mismatch means the cache file is corrupted or was copied over from another console. */
+    sha256CalculateHash(payload_hash, &cache_payload, sizeof(KeysetCachePayload));
+    if (memcmp(payload_hash, cache_header.payload_hash, SHA256_HASH_SIZE) != 0)
+    {
+        LOG_MSG_ERROR("Keyset cache payload hash mismatch! Discarding cache.");
+        goto end;
+    }
+
+    /* Populate global keydata using the decrypted payload. */
+    memcpy(&g_eTicketRsaDeviceKey, &(cache_payload.eticket_rsa_device_key), sizeof(SetCalRsa2048DeviceKey));
+    memcpy(&g_nxKeyset, &(cache_payload.keyset), sizeof(KeysNxKeyset));
+    g_latestMasterKeyAvailable = (cache_payload.latest_master_key_available != 0);
+
+    LOG_MSG_INFO("Keyset successfully loaded from \"%s\".", KEYSET_CACHE_PATH);
+
+    /* Update flag. */
+    success = true;
+
+end:
+    fclose(cache_file);
+
+    if (!success)
+    {
+        /* Wipe partially populated global keydata and get rid of the cache file - it gets rebuilt after a full keyset derivation. */
+        memset(&g_eTicketRsaDeviceKey, 0, sizeof(SetCalRsa2048DeviceKey));
+        memset(&g_nxKeyset, 0, sizeof(KeysNxKeyset));
+        g_latestMasterKeyAvailable = false;
+
+        remove(KEYSET_CACHE_PATH);
+        utilsCommitSdCardFileSystemChanges();
+    }
+
+    return success;
+}
+
+static void keysSaveKeysetToCache(void)
+{
+    FILE *cache_file = NULL;
+    KeysetCacheHeader cache_header = {0};
+    KeysetCachePayload cache_payload = {0};
+    u8 cache_key[AES_128_KEY_SIZE] = {0};
+    Aes128CtrContext cache_aes_ctx = {0};
+    bool success = false;
+
+    /* Generate the console-unique cache key. */
+    if (!keysGenerateKeysetCacheKey(cache_key)) return;
+
+    /* Populate cache header. */
+    cache_header.magic = KEYSET_CACHE_MAGIC;
+    cache_header.version = KEYSET_CACHE_VERSION;
+    cache_header.hos_version = hosversionGet();
+    cache_header.key_generation = NcaKeyGeneration_Current;
+    if (!keysCalculateKeysFileHash(cache_header.keys_file_hash)) return;
+    randomGet(cache_header.ctr, sizeof(cache_header.ctr));
+
+    /* Populate cache payload and calculate its hash before encrypting it. */
+    memcpy(&(cache_payload.eticket_rsa_device_key), &g_eTicketRsaDeviceKey, sizeof(SetCalRsa2048DeviceKey));
+    memcpy(&(cache_payload.keyset), &g_nxKeyset, sizeof(KeysNxKeyset));
+    cache_payload.latest_master_key_available = (g_latestMasterKeyAvailable ? 1 : 0);
+    sha256CalculateHash(cache_header.payload_hash, &cache_payload, sizeof(KeysetCachePayload));
+
+    /* Encrypt cache payload in-place. */
+    aes128CtrContextCreate(&cache_aes_ctx, cache_key, cache_header.ctr);
+    aes128CtrCrypt(&cache_aes_ctx, &cache_payload, &cache_payload, sizeof(KeysetCachePayload));
+
+    /* Open cache file. */
+    cache_file = fopen(KEYSET_CACHE_PATH, "wb");
+    if (!cache_file)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\" for writing!", KEYSET_CACHE_PATH);
+        return;
+    }
+
+    /* Write cache header and encrypted cache payload. */
+    success = (fwrite(&cache_header, 1, sizeof(KeysetCacheHeader), cache_file) == sizeof(KeysetCacheHeader) && \
+               fwrite(&cache_payload, 1, sizeof(KeysetCachePayload), cache_file) == sizeof(KeysetCachePayload));
+
+    fclose(cache_file);
+
+    if (success)
+    {
+        LOG_MSG_INFO("Keyset cache saved to \"%s\".", KEYSET_CACHE_PATH);
+    } else {
+        LOG_MSG_ERROR("Failed to write data to \"%s\"!", KEYSET_CACHE_PATH);
+        remove(KEYSET_CACHE_PATH);
+    }
+
+    /* Commit SD card filesystem changes. */
+    utilsCommitSdCardFileSystemChanges();
+}
+
 /* Based on splCryptoGenerateAesKek(). Excludes key sealing and device-unique shenanigans. */
 static bool keysGenerateAesKek(const u8 *kek_src, u8 key_generation, SmcGenerateAesKekOption option, u8 *out_kek)
 {
@@ -63,24 +63,38 @@ bool legalInfoInitializeContext(LegalInfoContext *out, NcaContext *nca_ctx)
         goto end;
     }
 
-    /* Allocate memory for the XML. */
     out->authoring_tool_xml_size = xml_entry->size;
-    if (!(out->authoring_tool_xml = malloc(out->authoring_tool_xml_size)))
-    {
-        LOG_MSG_ERROR("Failed to allocate memory for the XML!");
-        goto end;
-    }
 
-    /* Read NACP data into memory buffer. */
-    if (!romfsReadFileEntryData(&romfs_ctx, xml_entry, out->authoring_tool_xml, out->authoring_tool_xml_size, 0))
+    if (xml_entry->size <= LEGAL_INFO_XML_MAX_BUFFER_SIZE)
     {
-        LOG_MSG_ERROR("Failed to read XML!");
-        goto end;
+        /* Allocate memory for the XML. */
+        if (!(out->authoring_tool_xml = malloc(out->authoring_tool_xml_size)))
+        {
+            LOG_MSG_ERROR("Failed to allocate memory for the XML!");
+            goto end;
+        }
+
+        /* Read XML data into memory buffer. */
+        if (!romfsReadFileEntryData(&romfs_ctx, xml_entry, out->authoring_tool_xml, out->authoring_tool_xml_size, 0))
+        {
+            LOG_MSG_ERROR("Failed to read XML!");
+            goto end;
+        }
+    } else {
+        /* The document is too big to be materialized in memory. Keep 'authoring_tool_xml' set to NULL - */
+        /* consumers must stream XML data in chunks via legalInfoReadAuthoringToolXml() instead. */
+        LOG_MSG_INFO("0x%lX bytes long XML exceeds memory buffer limit. Data will be streamed on demand.", xml_entry->size);
     }
 
     /* Update NCA context pointer in output context. */
     out->nca_ctx = nca_ctx;
 
+    /* Transfer RomFS context ownership to the output context. It is kept initialized so XML data can be read on demand. */
+    /* The default storage context pointer is self-referential, so it must be fixed up after the copy. */
+    memcpy(&(out->romfs_ctx), &romfs_ctx, sizeof(RomFileSystemContext));
+    out->romfs_ctx.default_storage_ctx = &(out->romfs_ctx.storage_ctx[romfs_ctx.default_storage_ctx == &(romfs_ctx.storage_ctx[1]) ? 1 : 0]);
+    out->xml_entry = xml_entry;
+
     /* Update content type context info in NCA context. */
     nca_ctx->content_type_ctx = out;
     nca_ctx->content_type_ctx_patch = false;
@@ -88,9 +102,36 @@ bool legalInfoInitializeContext(LegalInfoContext *out, NcaContext *nca_ctx)
     success = true;
 
 end:
-    romfsFreeContext(&romfs_ctx);
-
-    if (!success) legalInfoFreeContext(out);
+    if (!success)
+    {
+        romfsFreeContext(&romfs_ctx);
+        legalInfoFreeContext(out);
+    }
 
     return success;
 }
+
+bool legalInfoReadAuthoringToolXml(LegalInfoContext *legal_info_ctx, void *out, u64 read_size, u64 offset)
+{
+    if (!legal_info_ctx || !legal_info_ctx->xml_entry || !legal_info_ctx->authoring_tool_xml_size || !out || !read_size || (offset + read_size) > legal_info_ctx->authoring_tool_xml_size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Serve the read straight from memory if the document was materialized at context initialization time. */
+    if (legal_info_ctx->authoring_tool_xml)
+    {
+        memcpy(out, legal_info_ctx->authoring_tool_xml + offset, read_size);
+        return true;
+    }
+
+    /* Stream XML data from the underlying RomFS. */
+    if (!romfsReadFileEntryData(&(legal_info_ctx->romfs_ctx), legal_info_ctx->xml_entry, out, read_size, offset))
+    {
+        LOG_MSG_ERROR("Failed to read 0x%lX bytes long XML chunk at offset 0x%lX!", read_size, offset);
+        return false;
+    }
+
+    return true;
+}
@@ -26,6 +26,8 @@
 #define MEMLOG_DEBUG(fmt, ...)  LOG_MSG_BUF_DEBUG(&g_memLogBuf, &g_memLogBufSize, fmt, ##__VA_ARGS__)
 #define MEMLOG_ERROR(fmt, ...)  LOG_MSG_BUF_ERROR(&g_memLogBuf, &g_memLogBufSize, fmt, ##__VA_ARGS__)
 
+#define MEM_SEARCH_WINDOW_SIZE  0x100000                /* 1 MiB. */
+
 /* Global variables. */
 
 static Mutex g_memMutex = 0;
@@ -38,7 +40,7 @@ static size_t g_memLogBufSize = 0;
 
 /* Function prototypes. */
 
-static bool memRetrieveProgramMemory(MemoryLocation *location, bool is_segment);
+static bool memRetrieveProgramMemory(MemoryLocation *location, bool is_segment, u64 overlap_size, MemoryWindowSearchFunc search_func, void *userdata);
 static bool memRetrieveDebugHandleFromProgramById(Handle *out, u64 program_id);
 
 bool memRetrieveProgramMemorySegment(MemoryLocation *location)
@@ -50,7 +52,7 @@ bool memRetrieveProgramMemorySegment(MemoryLocation *location)
     }
 
     bool ret = false;
-    SCOPED_LOCK(&g_memMutex) ret = memRetrieveProgramMemory(location, true);
+    SCOPED_LOCK(&g_memMutex) ret = memRetrieveProgramMemory(location, true, 0, NULL, NULL);
     return ret;
 }
 
@@ -63,11 +65,37 @@ bool memRetrieveFullProgramMemory(MemoryLocation *location)
     }
 
     bool ret = false;
-    SCOPED_LOCK(&g_memMutex) ret = memRetrieveProgramMemory(location, false);
+    SCOPED_LOCK(&g_memMutex) ret = memRetrieveProgramMemory(location, false, 0, NULL, NULL);
+    return ret;
+}
+
+bool memSearchProgramMemorySegment(MemoryLocation *location, u64 overlap_size, MemoryWindowSearchFunc search_func, void *userdata)
+{
+    if (!location || !location->program_id || !location->mask || location->mask >= BIT(3) || overlap_size >= MEM_SEARCH_WINDOW_SIZE || !search_func)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    bool ret = false;
+    SCOPED_LOCK(&g_memMutex) ret = memRetrieveProgramMemory(location, true, overlap_size, search_func, userdata);
     return ret;
 }
 
-static bool memRetrieveProgramMemory(MemoryLocation *location, bool is_segment)
+bool memSearchFullProgramMemory(MemoryLocation *location, u64 overlap_size, MemoryWindowSearchFunc search_func, void *userdata)
+{
+    if (!location || !location->program_id || overlap_size >= MEM_SEARCH_WINDOW_SIZE || !search_func)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    bool ret = false;
+    SCOPED_LOCK(&g_memMutex) ret = memRetrieveProgramMemory(location, false, overlap_size, search_func, userdata);
+    return ret;
+}
+
+static bool memRetrieveProgramMemory(MemoryLocation *location, bool is_segment, u64 overlap_size, MemoryWindowSearchFunc search_func, void *userdata)
 {
     Result rc = 0;
     Handle debug_handle = INVALID_HANDLE;
@@ -79,6 +107,10 @@ static bool memRetrieveProgramMemory(MemoryLocation *location, bool is_segment)
     u8 segment = 1, mem_type = 0;
     u8 *tmp = NULL;
 
+    u8 *window_buf = NULL;
+    u64 window_buf_size = 0, window_len = 0, window_start_offset = 0;
+    bool search_mode = (search_func != NULL), match_found = false, data_found = false;
+
     bool success = true;
 
     /* Make sure we have access to debug SVC calls. */
@@ -95,6 +127,18 @@ static bool memRetrieveProgramMemory(MemoryLocation *location, bool is_segment)
     /* Clear output MemoryLocation element. */
     memFreeMemoryLocation(location);
 
+    if (search_mode)
+    {
+        /* Allocate window buffer. Big enough to hold a full window plus the overlap carried over from the previous one. */
+        window_buf_size = (overlap_size + MEM_SEARCH_WINDOW_SIZE);
+        window_buf = malloc(window_buf_size);
+        if (!window_buf)
+        {
+            LOG_MSG_ERROR("Failed to allocate 0x%lX-byte long search window buffer for program %016lX!", window_buf_size, location->program_id);
+            return false;
+        }
+    }
+
 #if LOG_LEVEL < LOG_LEVEL_NONE
     /* LOG_*() macros will be useless if the target program is the FS sysmodule. */
     /* This is because any FS I/O operation *will* lock up the console while FS itself is being debugged. */
@@ -168,32 +212,76 @@ static bool memRetrieveProgramMemory(MemoryLocation *location, bool is_segment)
             mem_type != MemType_Io && mem_type != MemType_ThreadLocal && mem_type != MemType_Reserved))) || (is_segment && (mem_type == MemType_CodeStatic || mem_type == MemType_CodeMutable) && \
             (((segment <<= 1) >> 1) & location->mask))))
         {
-            /* Reallocate data buffer. */
-            tmp = realloc(location->data, location->data_size + mem_info.size);
-            if (!tmp)
+            if (!search_mode)
             {
-                MEMLOG_ERROR("Failed to resize segment data buffer to 0x%lX bytes for program %016lX!", location->data_size + mem_info.size, location->program_id);
-                success = false;
-                break;
-            }
+                /* Reallocate data buffer. */
+                tmp = realloc(location->data, location->data_size + mem_info.size);
+                if (!tmp)
+                {
+                    MEMLOG_ERROR("Failed to resize segment data buffer to 0x%lX bytes for program %016lX!", location->data_size + mem_info.size, location->program_id);
+                    success = false;
+                    break;
+                }
 
-            location->data = tmp;
-            tmp = NULL;
+                location->data = tmp;
+                tmp = NULL;
 
-            rc = svcReadDebugProcessMemory(location->data + location->data_size, debug_handle, mem_info.addr, mem_info.size);
-            if (R_FAILED(rc))
-            {
-                MEMLOG_ERROR("svcReadDebugProcessMemory failed for program %016lX! (0x%X).", location->program_id, rc);
-                success = false;
-                break;
-            }
+                rc = svcReadDebugProcessMemory(location->data + location->data_size, debug_handle, mem_info.addr, mem_info.size);
+                if (R_FAILED(rc))
+                {
+                    MEMLOG_ERROR("svcReadDebugProcessMemory failed for program %016lX! (0x%X).", location->program_id, rc);
+                    success = false;
+                    break;
+                }
+
+                location->data_size += mem_info.size;
+            } else {
+                /* Stream this memory range through the search window instead of keeping it around. */
+                u64 range_offset = 0;
+
+                data_found = true;
 
-            location->data_size += mem_info.size;
+                while(range_offset < mem_info.size)
+                {
+                    /* Fill the free window buffer area with memory range data. */
+                    u64 chunk_size = (window_buf_size - window_len);
+                    if (chunk_size > (mem_info.size - range_offset)) chunk_size = (mem_info.size - range_offset);
+
+                    rc = svcReadDebugProcessMemory(window_buf + window_len, debug_handle, mem_info.addr + range_offset, chunk_size);
+                    if (R_FAILED(rc))
+                    {
+                        MEMLOG_ERROR("svcReadDebugProcessMemory failed for program %016lX! (0x%X).", location->program_id, rc);
+                        success = false;
+                        break;
+                    }
+
+                    window_len += chunk_size;
+                    range_offset += chunk_size;
+
+                    /* Scan the window in place once it's full. */
+                    if (window_len == window_buf_size)
+                    {
+                        match_found = search_func(window_buf, window_len, window_start_offset, userdata);
+                        if (match_found) break;
+
+                        /* Carry the window tail over to the next window, so patterns crossing window boundaries aren't missed. */
+                        if (overlap_size) memmove(window_buf, window_buf + (window_len - overlap_size), overlap_size);
+                        window_start_offset += (window_len - overlap_size);
+                        window_len = overlap_size;
+                    }
+                }
+
+                /* Stop at the first match - there's no need to keep streaming memory ranges. */
+                if (!success || match_found) break;
+            }
         }
 
         addr = (mem_info.addr + mem_info.size);
     } while(addr != 0 && segment < BIT(3));
 
+    /* Scan any remaining buffered data that wasn't part of a full window. */
+    if (search_mode && success && !match_found && window_len > (window_start_offset ? overlap_size : 0)) match_found = search_func(window_buf, window_len, window_start_offset, userdata);
+
 end:
     /* Close debug handle. */
     if (debug_handle != INVALID_HANDLE) svcCloseHandle(debug_handle);
@@ -203,14 +291,25 @@ end:
     logControlMutex(false);
 #endif
 
-    if (success && (!location->data || !location->data_size))
+    if (success)
     {
-        MEMLOG_ERROR("Unable to locate readable program memory pages for %016lX that match the required criteria!", location->program_id);
-        success = false;
+        if ((!search_mode && (!location->data || !location->data_size)) || (search_mode && !data_found))
+        {
+            MEMLOG_ERROR("Unable to locate readable program memory pages for %016lX that match the required criteria!", location->program_id);
+            success = false;
+        } else
+        if (search_mode && !match_found)
+        {
+            MEMLOG_DEBUG("Search against program %016lX memory yielded no matches.", location->program_id);
+            success = false;
+        }
     }
 
     if (!success) memFreeMemoryLocation(location);
 
+    /* Free search window buffer. */
+    if (window_buf) free(window_buf);
+
 #if LOG_LEVEL < LOG_LEVEL_NONE
     /* Write log buffer data. This will do nothing if the log buffer length is zero. */
     logWriteStringToLogFile(g_memLogBuf);
@@ -25,19 +25,19 @@
 
 /* Helper macros. */
 
-#define NACP_ADD_FMT_STR_T1(fmt, ...)                                                           utilsAppendFormattedStringToBuffer(&xml_buf, &xml_buf_size, fmt, ##__VA_ARGS__)
-#define NACP_ADD_FMT_STR_T2(fmt, ...)                                                           utilsAppendFormattedStringToBuffer(xml_buf, xml_buf_size, fmt, ##__VA_ARGS__)
-#define NACP_ADD_STR(tag_name, value)                                                           nacpAddStringFieldToAuthoringToolXml(&xml_buf, &xml_buf_size, tag_name, value)
-#define NACP_ADD_ENUM(tag_name, value, str_func)                                                nacpAddEnumFieldToAuthoringToolXml(&xml_buf, &xml_buf_size, tag_name, value, \
+#define NACP_ADD_FMT_STR_T1(fmt, ...)                                                           utilsStringBuilderAppendFormat(&sb, fmt, ##__VA_ARGS__)
+#define NACP_ADD_FMT_STR_T2(fmt, ...)                                                           utilsStringBuilderAppendFormat(sb, fmt, ##__VA_ARGS__)
+#define NACP_ADD_STR(tag_name, value)                                                           nacpAddStringFieldToAuthoringToolXml(&sb, tag_name, value)
+#define NACP_ADD_ENUM(tag_name, value, str_func)                                                nacpAddEnumFieldToAuthoringToolXml(&sb, tag_name, value, \
                                                                                                                                    &str_func)
-#define NACP_ADD_BITFLAG(tag_name, flag, flag_width, max_flag_idx, str_func, allow_empty_str)   nacpAddBitflagFieldToAuthoringToolXml(&xml_buf, &xml_buf_size, tag_name, flag, \
+#define NACP_ADD_BITFLAG(tag_name, flag, flag_width, max_flag_idx, str_func, allow_empty_str)   nacpAddBitflagFieldToAuthoringToolXml(&sb, tag_name, flag, \
                                                                                                                                       flag_width, max_flag_idx, &(str_func), \
                                                                                                                                       allow_empty_str)
-#define NACP_ADD_U16(tag_name, value, hex, prefix)                                              nacpAddU16FieldToAuthoringToolXml(&xml_buf, &xml_buf_size, tag_name, value, hex, \
+#define NACP_ADD_U16(tag_name, value, hex, prefix)                                              nacpAddU16FieldToAuthoringToolXml(&sb, tag_name, value, hex, \
                                                                                                                                   prefix)
-#define NACP_ADD_U32(tag_name, value, hex, prefix)                                              nacpAddU32FieldToAuthoringToolXml(&xml_buf, &xml_buf_size, tag_name, value, hex, \
+#define NACP_ADD_U32(tag_name, value, hex, prefix)                                              nacpAddU32FieldToAuthoringToolXml(&sb, tag_name, value, hex, \
                                                                                                                                   prefix)
-#define NACP_ADD_U64(tag_name, value, hex, prefix)                                              nacpAddU64FieldToAuthoringToolXml(&xml_buf, &xml_buf_size, tag_name, value, hex, \
+#define NACP_ADD_U64(tag_name, value, hex, prefix)                                              nacpAddU64FieldToAuthoringToolXml(&sb, tag_name, value, hex, \
                                                                                                                                   prefix)
 
 /* Type definitions. */
@@ -220,12 +220,12 @@ static const char *g_nacpContentsAvailabilityTransitionPolicyStrings[NacpContent
 
 NX_INLINE bool nacpCheckBitflagField(const void *flag, u8 flag_bitcount, u8 idx);
 
-static bool nacpAddStringFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, const char *value);
-static bool nacpAddEnumFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u8 value, NacpStringFunction str_func);
-static bool nacpAddBitflagFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, const void *flag, u8 flag_width, u8 max_flag_idx, NacpStringFunction str_func, bool allow_empty_str);
-static bool nacpAddU16FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u16 value, bool hex, bool prefix);
-static bool nacpAddU32FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u32 value, bool hex, bool prefix);
-static bool nacpAddU64FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u64 value, bool hex, bool prefix);
+static bool nacpAddStringFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, const char *value);
+static bool nacpAddEnumFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u8 value, NacpStringFunction str_func);
+static bool nacpAddBitflagFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, const void *flag, u8 flag_width, u8 max_flag_idx, NacpStringFunction str_func, bool allow_empty_str);
+static bool nacpAddU16FieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u16 value, bool hex, bool prefix);
+static bool nacpAddU32FieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u32 value, bool hex, bool prefix);
+static bool nacpAddU64FieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u64 value, bool hex, bool prefix);
 
 bool nacpInitializeContext(NacpContext *out, NcaContext *nca_ctx)
 {
@@ -332,21 +332,7 @@ bool nacpInitializeContext(NacpContext *out, NcaContext *nca_ctx)
         icon_ctx = &(out->icon_ctx[out->icon_count]);
         memset(icon_ctx, 0, sizeof(NacpIconContext));
 
-        /* Allocate memory for this icon data. */
-        if (!(icon_ctx->icon_data = malloc(icon_entry->size)))
-        {
-            LOG_MSG_ERROR("Failed to allocate memory for NACP icon data!");
-            goto end;
-        }
-
-        /* Read icon data. */
-        if (!romfsReadFileEntryData(&(out->romfs_ctx), icon_entry, icon_ctx->icon_data, icon_entry->size, 0))
-        {
-            LOG_MSG_ERROR("Failed to read NACP icon data!");
-            goto end;
-        }
-
-        /* Fill icon context. */
+        /* Fill icon context. Icon data is loaded lazily via nacpLoadIconData() - dumps and XML generation typically need one icon or none at all. */
         icon_ctx->language = i;
         icon_ctx->icon_size = icon_entry->size;
 
@@ -369,6 +355,67 @@ end:
     return success;
 }
 
+bool nacpLoadIconData(NacpContext *nacp_ctx, NacpIconContext *icon_ctx)
+{
+    if (!nacpIsValidContext(nacp_ctx) || !nacpIsValidIconContext(icon_ctx))
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Icon data already loaded. */
+    if (icon_ctx->icon_data) return true;
+
+    char icon_path[0x80] = {0};
+    RomFileSystemFileEntry *icon_entry = NULL;
+    u8 *icon_data = NULL;
+
+    /* Generate icon path. */
+    sprintf(icon_path, "/icon_%s.dat", nacpGetLanguageString(icon_ctx->language));
+
+    /* Retrieve RomFS file entry for this icon. The entry size was validated at context initialization time. */
+    if (!(icon_entry = romfsGetFileEntryByPath(&(nacp_ctx->romfs_ctx), icon_path)) || icon_entry->size != icon_ctx->icon_size)
+    {
+        LOG_MSG_ERROR("Failed to retrieve file entry for \"%s\" from RomFS!", icon_path);
+        return false;
+    }
+
+    /* Allocate memory for the icon data. */
+    if (!(icon_data = malloc(icon_ctx->icon_size)))
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for NACP icon data!");
+        return false;
+    }
+
+    /* Read icon data. */
+    if (!romfsReadFileEntryData(&(nacp_ctx->romfs_ctx), icon_entry, icon_data, icon_ctx->icon_size, 0))
+    {
+        LOG_MSG_ERROR("Failed to read NACP icon data!");
+        free(icon_data);
+        return false;
+    }
+
+    icon_ctx->icon_data = icon_data;
+
+    return true;
+}
+
+bool nacpPrefetchIconData(NacpContext *nacp_ctx)
+{
+    if (!nacpIsValidContext(nacp_ctx))
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    for(u8 i = 0; i < nacp_ctx->icon_count; i++)
+    {
+        if (!nacpLoadIconData(nacp_ctx, &(nacp_ctx->icon_ctx[i]))) return false;
+    }
+
+    return true;
+}
+
 bool nacpGenerateNcaPatch(NacpContext *nacp_ctx, bool patch_sua, bool patch_screenshot, bool patch_video_capture, bool patch_hdcp)
 {
     if (!nacpIsValidContext(nacp_ctx))
@@ -453,8 +500,7 @@ bool nacpGenerateAuthoringToolXml(NacpContext *nacp_ctx, u32 version, u32 requir
     Version app_ver = { .value = version };
 
     u8 i = 0, count = 0;
-    char *xml_buf = NULL;
-    u64 xml_buf_size = 0;
+    UtilsStringBuilder sb = {0};
 
     u8 icon_hash[SHA256_HASH_SIZE] = {0};
     char icon_hash_str[SHA256_HASH_SIZE + 1] = {0};
@@ -610,6 +656,9 @@ bool nacpGenerateAuthoringToolXml(NacpContext *nacp_ctx, u32 version, u32 requir
     if (!NACP_ADD_ENUM("LogoHandling", nacp->logo_handling, nacpGetLogoHandlingString)) goto end;
 
     /* Icon. */
+    /* Load any icons that haven't been retrieved yet - their hashes are part of the generated XML. */
+    if (!nacpPrefetchIconData(nacp_ctx)) goto end;
+
     for(i = 0, count = 0; i < nacp_ctx->icon_count; i++)
     {
         NacpIconContext *icon_ctx = &(nacp_ctx->icon_ctx[i]);
@@ -857,16 +906,15 @@ bool nacpGenerateAuthoringToolXml(NacpContext *nacp_ctx, u32 version, u32 requir
                              nacpGetRuntimeUpgradeString(nacp->runtime_upgrade), \
                              (nacp->supporting_limited_application_licenses & NacpSupportingLimitedApplicationLicenses_Demo) ? "Demo" : "None")) goto end;
 
-    if (!(success = NACP_ADD_FMT_STR_T1("</Application>"))) goto end;
+    if (!NACP_ADD_FMT_STR_T1("</Application>")) goto end;
 
     /* Update NACP context. */
-    nacp_ctx->authoring_tool_xml = xml_buf;
-    nacp_ctx->authoring_tool_xml_size = strlen(xml_buf);
+    success = ((nacp_ctx->authoring_tool_xml = utilsStringBuilderFinalize(&sb, &(nacp_ctx->authoring_tool_xml_size))) != NULL);
 
 end:
     if (!success)
     {
-        if (xml_buf) free(xml_buf);
+        utilsStringBuilderFree(&sb);
         LOG_MSG_ERROR("Failed to generate NACP AuthoringTool XML!");
     }
 
@@ -1019,9 +1067,9 @@ NX_INLINE bool nacpCheckBitflagField(const void *flag, u8 flag_bitcount, u8 idx)
     return (flag_u8[byte_idx] & bitmask);
 }
 
-static bool nacpAddStringFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, const char *value)
+static bool nacpAddStringFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, const char *value)
 {
-    if (!xml_buf || !xml_buf_size || !tag_name || !*tag_name || !value)
+    if (!sb || !tag_name || !*tag_name || !value)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -1030,9 +1078,9 @@ static bool nacpAddStringFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_si
     return (*value ? NACP_ADD_FMT_STR_T2("  <%s>%s</%s>\n", tag_name, value, tag_name) : NACP_ADD_FMT_STR_T2("  <%s />\n", tag_name));
 }
 
-static bool nacpAddEnumFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u8 value, NacpStringFunction str_func)
+static bool nacpAddEnumFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u8 value, NacpStringFunction str_func)
 {
-    if (!xml_buf || !xml_buf_size || !tag_name || !*tag_name || !str_func)
+    if (!sb || !tag_name || !*tag_name || !str_func)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -1041,13 +1089,13 @@ static bool nacpAddEnumFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size
     return NACP_ADD_FMT_STR_T2("  <%s>%s</%s>\n", tag_name, str_func(value), tag_name);
 }
 
-static bool nacpAddBitflagFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, const void *flag, u8 flag_width, u8 max_flag_idx, NacpStringFunction str_func, bool allow_empty_str)
+static bool nacpAddBitflagFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, const void *flag, u8 flag_width, u8 max_flag_idx, NacpStringFunction str_func, bool allow_empty_str)
 {
     u8 flag_bitcount = 0, i = 0, count = 0;
     const u8 *flag_u8 = (const u8*)flag;
     bool success = false, empty_flag = true;
 
-    if (!xml_buf || !xml_buf_size || !tag_name || !*tag_name || !flag || !flag_width || (flag_width > 1 && !IS_POWER_OF_TWO(flag_width)) || flag_width > 0x10 || \
+    if (!sb || !tag_name || !*tag_name || !flag || !flag_width || (flag_width > 1 && !IS_POWER_OF_TWO(flag_width)) || flag_width > 0x10 || \
         (flag_bitcount = (flag_width * 8)) < max_flag_idx || !str_func)
     {
         LOG_MSG_ERROR("Invalid parameters!");
@@ -1084,9 +1132,9 @@ end:
     return success;
 }
 
-static bool nacpAddU16FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u16 value, bool hex, bool prefix)
+static bool nacpAddU16FieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u16 value, bool hex, bool prefix)
 {
-    if (!xml_buf || !xml_buf_size || !tag_name || !*tag_name)
+    if (!sb || !tag_name || !*tag_name)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -1097,9 +1145,9 @@ static bool nacpAddU16FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size,
     return NACP_ADD_FMT_STR_T2(str, tag_name, value, tag_name);
 }
 
-static bool nacpAddU32FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u32 value, bool hex, bool prefix)
+static bool nacpAddU32FieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u32 value, bool hex, bool prefix)
 {
-    if (!xml_buf || !xml_buf_size || !tag_name || !*tag_name)
+    if (!sb || !tag_name || !*tag_name)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -1110,9 +1158,9 @@ static bool nacpAddU32FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size,
     return NACP_ADD_FMT_STR_T2(str, tag_name, value, tag_name);
 }
 
-static bool nacpAddU64FieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, u64 value, bool hex, bool prefix)
+static bool nacpAddU64FieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, u64 value, bool hex, bool prefix)
 {
-    if (!xml_buf || !xml_buf_size || !tag_name || !*tag_name)
+    if (!sb || !tag_name || !*tag_name)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -19,6 +19,11 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+/* Hot dump-path module. Performance build flavors may strip verbose logging from this translation unit at compile time. */
+#ifdef LOG_MODULE_LEVEL_HOT
+#define LOG_MODULE_LEVEL    LOG_MODULE_LEVEL_HOT
+#endif
+
 #include "nxdt_utils.h"
 #include "nca.h"
 #include "keys.h"
@@ -27,12 +32,77 @@
 #include "gamecard.h"
 #include "title.h"
 
-#define NCA_CRYPTO_BUFFER_SIZE  0x800000    /* 8 MiB. */
+#define NCA_CRYPTO_BUFFER_SIZE      0x800000                /* 8 MiB. */
+#define NCA_CRYPTO_BUFFER_COUNT     4                       /* Maximum number of crypto buffers handed out to concurrent NCA crypto operations. */
+
+#define NCA_CRYPTO_BUFFER_COUNT_APPLET  2                   /* Pool cap under applet mode, where the available heap shrinks drastically. Extra concurrent operations wait for a pool slot. */
+
+#define NCA_BATCH_MAX_THREADS       NCA_CRYPTO_BUFFER_COUNT /* Used by batch context initialization / verification. Extra worker threads would just block on crypto buffer acquisition. */
+
+#define NCA_VERIFY_BUFFER_SIZE      0x100000                /* 1 MiB. Read granularity used while walking hierarchical hash trees. */
+
+#define NCA_CONTEXT_POOL_SIZE           8                   /* Maximum number of context blocks kept around for reuse by the NCA context pool. */
+#define NCA_CONTEXT_POOL_SIZE_APPLET    2                   /* Pool cap under applet mode. Extra freed blocks go straight back to the heap instead of sitting idle. */
+
+#define NCA_LAYER_HASH_MAX_THREADS  3                       /* Number of extra hash worker threads spawned by ncaGenerateHashDataPatch(). The calling thread hashes blocks as well. */
+#define NCA_LAYER_HASH_MIN_BLOCKS   8                       /* Hierarchical layers with fewer hash blocks than this are hashed serially - thread creation overhead would dwarf any gains. */
+
+/* Type definitions. */
+
+typedef struct {
+    u8 *buffer;     ///< Allocated on demand, up to NCA_CRYPTO_BUFFER_SIZE bytes.
+    bool in_use;    ///< Set to true while a thread holds this buffer.
+} NcaCryptoBuffer;
+
+/// Used by the NCA context pool. Each entry holds a freed context block, ready to be cleared and handed out again by ncaAllocateContexts().
+typedef struct {
+    NcaContext *ctx;    ///< Pooled context block. NULL for empty pool slots.
+    u32 capacity;       ///< Number of NcaContext elements the block holds.
+} NcaContextPoolEntry;
+
+/// Shared state for a ncaInitializeContextBatch() call.
+typedef struct {
+    NcaContextBatchEntry *entries;  ///< Batch entries provided by the caller.
+    u32 entry_count;                ///< Total number of batch entries.
+    u32 next_entry;                 ///< Index of the next unclaimed batch entry. Protected by 'mutex'.
+    Mutex mutex;
+} NcaContextBatchState;
+
+/// Shared state for a ncaVerifyContextBatch() call.
+typedef struct {
+    NcaVerifyBatchEntry *entries;   ///< Batch entries provided by the caller.
+    u32 entry_count;                ///< Total number of batch entries.
+    u32 next_entry;                 ///< Index of the next unclaimed batch entry. Protected by 'mutex'.
+    Mutex mutex;
+} NcaVerifyBatchState;
+
+/// Shared state for parallel hash block recalculation inside ncaGenerateHashDataPatch().
+typedef struct {
+    const u8 *cur_layer_block;  ///< Plaintext data blocks from the hierarchical layer being processed.
+    u8 *parent_layer_block;     ///< Output buffer. Holds one recalculated hash per block, stored contiguously.
+    u64 cur_layer_read_size;    ///< Total size of the layer data to hash.
+    u64 hash_block_size;        ///< Hash block size used by the hierarchical layer.
+    u64 block_count;            ///< Total number of hash blocks.
+    u64 next_block;             ///< Index of the next unclaimed hash block. Protected by 'mutex'.
+    bool truncate_last_block;   ///< HierarchicalSha256 only: the final block hash just covers the remaining layer data.
+    bool use_sha3;              ///< Use SHA3-256 instead of SHA-256 for layer hash calculation.
+    Mutex mutex;
+} NcaLayerHashState;
 
 /* Global variables. */
 
-static u8 *g_ncaCryptoBuffer = NULL;
+static NcaCryptoBuffer g_ncaCryptoBufferPool[NCA_CRYPTO_BUFFER_COUNT] = {0};
 static Mutex g_ncaCryptoBufferMutex = 0;
+static CondVar g_ncaCryptoBufferCondVar = 0;
+
+static NcaContextPoolEntry g_ncaContextPool[NCA_CONTEXT_POOL_SIZE] = {0};
+static Mutex g_ncaContextPoolMutex = 0;
+
+/// Crypto buffer held by the current thread. Set while a public NCA crypto operation is in progress.
+static __thread u8 *g_ncaThreadCryptoBuffer = NULL;
+
+/// Set to true while a FS section read cache block is being filled on the current thread.
+static __thread bool g_ncaFsSectionCacheFill = false;
 
 /// Used to verify the NCA header main signature.
 static const u8 g_ncaHeaderMainSignaturePublicExponent[3] = { 0x01, 0x00, 0x01 };
@@ -127,12 +197,24 @@ static const u8 g_nca0KeyAreaHash[SHA256_HASH_SIZE] = {
 
 /* Function prototypes. */
 
+static bool ncaAcquireCryptoBuffer(void);
+static void ncaReleaseCryptoBuffer(void);
+
+static void ncaProcessContextBatchEntries(NcaContextBatchState *state);
+static void ncaInitializeContextBatchThreadFunc(void *arg);
+
+static bool ncaVerifyHashTreeMasterHash(NcaFsSectionContext *ctx, u64 layer_offset, u64 layer_size, const u8 *master_hash, bool use_sha3);
+static bool ncaVerifyHashTreeLayer(NcaFsSectionContext *ctx, u64 data_offset, u64 data_size, u64 hash_offset, u64 block_size, bool pad_last_block, bool use_sha3);
+
+static void ncaProcessVerifyBatchEntries(NcaVerifyBatchState *state);
+static void ncaVerifyContextBatchThreadFunc(void *arg);
+
 NX_INLINE bool ncaIsFsInfoEntryValid(NcaFsInfo *fs_info);
 
 static bool ncaReadDecryptedHeader(NcaContext *ctx);
 static bool ncaKeyAreaCrypt(NcaContext *ctx, bool encrypt);
 
-static bool ncaVerifyMainSignature(NcaContext *ctx);
+static void ncaVerifyMainSignature(NcaContext *ctx);
 
 NX_INLINE bool ncaIsVersion0KeyAreaEncrypted(NcaContext *ctx);
 NX_INLINE u8 ncaGetKeyGenerationValue(NcaContext *ctx);
@@ -143,10 +225,13 @@ static bool ncaFsSectionValidateHashDataBoundaries(NcaFsSectionContext *ctx);
 
 static bool _ncaReadFsSection(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset);
 static bool ncaFsSectionCheckPlaintextHashRegionAccess(NcaFsSectionContext *ctx, u64 offset, u64 size, NcaRegion *out_region);
+static bool ncaFsSectionCachedRead(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset);
 
 static bool _ncaReadAesCtrExStorage(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset, u32 ctr_val, bool decrypt);
 
 static void ncaCalculateLayerHash(void *dst, const void *src, size_t size, bool use_sha3);
+static void ncaProcessLayerHashBlocks(NcaLayerHashState *state);
+static void ncaLayerHashThreadFunc(void *arg);
 static bool ncaGenerateHashDataPatch(NcaFsSectionContext *ctx, const void *data, u64 data_size, u64 data_offset, void *out, bool is_integrity_patch);
 static bool ncaWritePatchToMemoryBuffer(NcaContext *ctx, const void *patch, u64 patch_size, u64 patch_offset, void *buf, u64 buf_size, u64 buf_offset);
 
@@ -158,8 +243,9 @@ bool ncaAllocateCryptoBuffer(void)
 
     SCOPED_LOCK(&g_ncaCryptoBufferMutex)
     {
-        if (!g_ncaCryptoBuffer) g_ncaCryptoBuffer = malloc(NCA_CRYPTO_BUFFER_SIZE);
-        ret = (g_ncaCryptoBuffer != NULL);
+        /* Only the first pool buffer is allocated upfront. The rest are allocated on demand by ncaAcquireCryptoBuffer(), whenever concurrent NCA crypto operations actually take place. */
+        if (!g_ncaCryptoBufferPool[0].buffer) g_ncaCryptoBufferPool[0].buffer = malloc(NCA_CRYPTO_BUFFER_SIZE);
+        ret = (g_ncaCryptoBufferPool[0].buffer != NULL);
     }
 
     return ret;
@@ -169,10 +255,354 @@ void ncaFreeCryptoBuffer(void)
 {
     SCOPED_LOCK(&g_ncaCryptoBufferMutex)
     {
-        if (!g_ncaCryptoBuffer) break;
-        free(g_ncaCryptoBuffer);
-        g_ncaCryptoBuffer = NULL;
+        for(u8 i = 0; i < NCA_CRYPTO_BUFFER_COUNT; i++)
+        {
+            if (!g_ncaCryptoBufferPool[i].buffer || g_ncaCryptoBufferPool[i].in_use) continue;
+            free(g_ncaCryptoBufferPool[i].buffer);
+            g_ncaCryptoBufferPool[i].buffer = NULL;
+        }
+    }
+}
+
+NcaContext *ncaAllocateContexts(u32 count)
+{
+    NcaContext *out = NULL;
+
+    if (!count) return NULL;
+
+    SCOPED_LOCK(&g_ncaContextPoolMutex)
+    {
+        /* Look for the smallest pooled context block capable of holding the requested context count. */
+        NcaContextPoolEntry *best_entry = NULL;
+
+        for(u8 i = 0; i < NCA_CONTEXT_POOL_SIZE; i++)
+        {
+            NcaContextPoolEntry *entry = &(g_ncaContextPool[i]);
+            if (!entry->ctx || entry->capacity < count) continue;
+            if (!best_entry || entry->capacity < best_entry->capacity) best_entry = entry;
+        }
+
+        if (!best_entry) break;
+
+        /* Bulk reset the reused block. Callers get the same zeroed memory a fresh calloc() would return. */
+        out = best_entry->ctx;
+        memset(out, 0, (size_t)count * sizeof(NcaContext));
+
+        best_entry->ctx = NULL;
+        best_entry->capacity = 0;
+    }
+
+    /* Fall back to the heap whenever the pool can't serve the request. */
+    if (!out) out = calloc(count, sizeof(NcaContext));
+
+    return out;
+}
+
+void ncaFreeContexts(NcaContext *ctx, u32 count)
+{
+    bool pooled = false;
+
+    if (!ctx) return;
+
+    /* Drain queued main signature verifications - the RSA worker thread writes its results straight into these contexts, so none may still be pending once the block is freed or recycled. */
+    rsa2048WaitForQueuedPssVerifications();
+
+    SCOPED_LOCK(&g_ncaContextPoolMutex)
+    {
+        if (!count) break;
+
+        /* Under applet mode the pool is capped - keeping lots of idle context blocks around would eat into the shrunken heap. */
+        u8 pool_limit = (utilsIsAppletMode() ? NCA_CONTEXT_POOL_SIZE_APPLET : NCA_CONTEXT_POOL_SIZE);
+
+        for(u8 i = 0; i < pool_limit; i++)
+        {
+            NcaContextPoolEntry *entry = &(g_ncaContextPool[i]);
+            if (entry->ctx) continue;
+
+            entry->ctx = ctx;
+            entry->capacity = count;
+            pooled = true;
+
+            break;
+        }
+    }
+
+    /* Return the block to the heap if every pool slot is already taken. */
+    if (!pooled) free(ctx);
+}
+
+void ncaFreeContextPool(void)
+{
+    SCOPED_LOCK(&g_ncaContextPoolMutex)
+    {
+        for(u8 i = 0; i < NCA_CONTEXT_POOL_SIZE; i++)
+        {
+            NcaContextPoolEntry *entry = &(g_ncaContextPool[i]);
+            if (!entry->ctx) continue;
+
+            free(entry->ctx);
+            entry->ctx = NULL;
+            entry->capacity = 0;
+        }
+    }
+}
+
+static bool ncaAcquireCryptoBuffer(void)
+{
+    SCOPED_LOCK(&g_ncaCryptoBufferMutex)
+    {
+        while(!g_ncaThreadCryptoBuffer)
+        {
+            bool any_in_use = false;
+
+            /* Look for a free pool slot, allocating its buffer on demand. */
+            /* Under applet mode the pool is capped - concurrent operations wait for a pool slot instead of growing the pool past the memory budget. */
+            u8 pool_limit = (utilsIsAppletMode() ? NCA_CRYPTO_BUFFER_COUNT_APPLET : NCA_CRYPTO_BUFFER_COUNT);
+
+            for(u8 i = 0; i < pool_limit && !g_ncaThreadCryptoBuffer; i++)
+            {
+                NcaCryptoBuffer *slot = &(g_ncaCryptoBufferPool[i]);
+
+                if (slot->in_use)
+                {
+                    any_in_use = true;
+                    continue;
+                }
+
+                if (!slot->buffer) slot->buffer = malloc(NCA_CRYPTO_BUFFER_SIZE);
+                if (!slot->buffer) continue;
+
+                slot->in_use = true;
+                g_ncaThreadCryptoBuffer = slot->buffer;
+            }
+
+            if (g_ncaThreadCryptoBuffer) break;
+
+            /* Bail out if the pool hasn't been initialized and no buffer could be allocated. */
+            if (!any_in_use)
+            {
+                LOG_MSG_ERROR("Failed to acquire NCA crypto buffer!");
+                break;
+            }
+
+            /* All pool buffers are currently in use. Wait until one of them is released. */
+            condvarWait(&g_ncaCryptoBufferCondVar, &g_ncaCryptoBufferMutex);
+        }
+    }
+
+    return (g_ncaThreadCryptoBuffer != NULL);
+}
+
+static void ncaReleaseCryptoBuffer(void)
+{
+    if (!g_ncaThreadCryptoBuffer) return;
+
+    SCOPED_LOCK(&g_ncaCryptoBufferMutex)
+    {
+        for(u8 i = 0; i < NCA_CRYPTO_BUFFER_COUNT; i++)
+        {
+            if (g_ncaCryptoBufferPool[i].buffer != g_ncaThreadCryptoBuffer) continue;
+            g_ncaCryptoBufferPool[i].in_use = false;
+            break;
+        }
+
+        g_ncaThreadCryptoBuffer = NULL;
+
+        /* Wake up any threads waiting for a pool buffer. */
+        condvarWakeAll(&g_ncaCryptoBufferCondVar);
+    }
+}
+
+static void ncaProcessContextBatchEntries(NcaContextBatchState *state)
+{
+    while(true)
+    {
+        NcaContextBatchEntry *entry = NULL;
+
+        /* Claim the next unprocessed batch entry. */
+        SCOPED_LOCK(&(state->mutex))
+        {
+            if (state->next_entry < state->entry_count) entry = &(state->entries[state->next_entry++]);
+        }
+
+        if (!entry) break;
+
+        /* Initialize NCA context. */
+        entry->success = ncaInitializeContext(entry->nca_ctx, entry->storage_id, entry->hfs_partition_type, entry->content_info, entry->title_version, entry->tik);
+    }
+}
+
+static void ncaInitializeContextBatchThreadFunc(void *arg)
+{
+    ncaProcessContextBatchEntries((NcaContextBatchState*)arg);
+    threadExit();
+}
+
+static bool ncaVerifyHashTreeMasterHash(NcaFsSectionContext *ctx, u64 layer_offset, u64 layer_size, const u8 *master_hash, bool use_sha3)
+{
+    if (!layer_size)
+    {
+        LOG_MSG_ERROR("Empty master hash layer for FS section #%u in \"%s\"!", ctx->section_idx, ctx->nca_ctx->content_id_str);
+        return false;
+    }
+
+    u8 *buf = NULL;
+    u8 calc_hash[SHA256_HASH_SIZE] = {0};
+
+    Sha256Context sha256_ctx = {0};
+    Sha3Context sha3_ctx = {0};
+
+    bool success = false;
+
+    buf = malloc(NCA_VERIFY_BUFFER_SIZE);
+    if (!buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate hash verification buffer!");
+        return false;
+    }
+
+    if (use_sha3)
+    {
+        sha3256ContextCreate(&sha3_ctx);
+    } else {
+        sha256ContextCreate(&sha256_ctx);
+    }
+
+    /* Hash the whole first hash layer in chunks. */
+    for(u64 offset = 0; offset < layer_size; )
+    {
+        u64 chunk_size = MIN(layer_size - offset, NCA_VERIFY_BUFFER_SIZE);
+
+        if (!ncaReadFsSection(ctx, buf, chunk_size, layer_offset + offset))
+        {
+            LOG_MSG_ERROR("Failed to read master hash layer data for FS section #%u in \"%s\"!", ctx->section_idx, ctx->nca_ctx->content_id_str);
+            goto end;
+        }
+
+        if (use_sha3)
+        {
+            sha3ContextUpdate(&sha3_ctx, buf, chunk_size);
+        } else {
+            sha256ContextUpdate(&sha256_ctx, buf, chunk_size);
+        }
+
+        offset += chunk_size;
     }
+
+    if (use_sha3)
+    {
+        sha3ContextGetHash(&sha3_ctx, calc_hash);
+    } else {
+        sha256ContextGetHash(&sha256_ctx, calc_hash);
+    }
+
+    success = (memcmp(calc_hash, master_hash, SHA256_HASH_SIZE) == 0);
+    if (!success) LOG_MSG_ERROR("Master hash mismatch for FS section #%u in \"%s\"!", ctx->section_idx, ctx->nca_ctx->content_id_str);
+
+end:
+    free(buf);
+
+    return success;
+}
+
+static bool ncaVerifyHashTreeLayer(NcaFsSectionContext *ctx, u64 data_offset, u64 data_size, u64 hash_offset, u64 block_size, bool pad_last_block, bool use_sha3)
+{
+    if (!data_size || !block_size)
+    {
+        LOG_MSG_ERROR("Empty hash layer for FS section #%u in \"%s\"!", ctx->section_idx, ctx->nca_ctx->content_id_str);
+        return false;
+    }
+
+    u8 *data_buf = NULL, *hash_buf = NULL;
+    u64 total_blocks = 0, blocks_per_chunk = 0, bad_blocks = 0;
+    bool success = false;
+
+    /* Process whole hash blocks per chunk. Block sizes above the verification buffer size simply degrade to one block per chunk. */
+    blocks_per_chunk = (NCA_VERIFY_BUFFER_SIZE / block_size);
+    if (!blocks_per_chunk) blocks_per_chunk = 1;
+
+    total_blocks = ((data_size + block_size - 1) / block_size);
+
+    data_buf = malloc(blocks_per_chunk * block_size);
+    hash_buf = malloc(blocks_per_chunk * SHA256_HASH_SIZE);
+    if (!data_buf || !hash_buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate hash verification buffers!");
+        goto end;
+    }
+
+    for(u64 block_idx = 0; block_idx < total_blocks; block_idx += blocks_per_chunk)
+    {
+        u64 chunk_blocks = MIN(blocks_per_chunk, total_blocks - block_idx);
+        u64 chunk_offset = (block_idx * block_size);
+        u64 chunk_size = MIN(chunk_blocks * block_size, data_size - chunk_offset);
+
+        /* Read data blocks and the expected hashes for them. */
+        if (!ncaReadFsSection(ctx, data_buf, chunk_size, data_offset + chunk_offset) || \
+            !ncaReadFsSection(ctx, hash_buf, chunk_blocks * SHA256_HASH_SIZE, hash_offset + (block_idx * SHA256_HASH_SIZE)))
+        {
+            LOG_MSG_ERROR("Failed to read hash layer data for FS section #%u in \"%s\"!", ctx->section_idx, ctx->nca_ctx->content_id_str);
+            goto end;
+        }
+
+        /* Zero out the unused tail from a trailing partial block (if needed). */
+        if (pad_last_block && chunk_size < (chunk_blocks * block_size)) memset(data_buf + chunk_size, 0, (chunk_blocks * block_size) - chunk_size);
+
+        for(u64 i = 0; i < chunk_blocks; i++)
+        {
+            u8 calc_hash[SHA256_HASH_SIZE] = {0};
+            u64 cur_block_size = ((pad_last_block || ((i + 1) * block_size) <= chunk_size) ? block_size : (chunk_size - (i * block_size)));
+
+            if (use_sha3)
+            {
+                sha3256CalculateHash(calc_hash, data_buf + (i * block_size), cur_block_size);
+            } else {
+                sha256CalculateHash(calc_hash, data_buf + (i * block_size), cur_block_size);
+            }
+
+            if (memcmp(calc_hash, hash_buf + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE) != 0)
+            {
+                /* Log the first bad block right away - with heavy corruption, logging every mismatch would swamp the logfile. */
+                if (!bad_blocks) LOG_MSG_ERROR("Hash mismatch for block %lu (section-relative offset 0x%lX) in FS section #%u from \"%s\"!", block_idx + i, \
+                                               data_offset + chunk_offset + (i * block_size), ctx->section_idx, ctx->nca_ctx->content_id_str);
+                bad_blocks++;
+            }
+        }
+    }
+
+    success = (bad_blocks == 0);
+    if (!success) LOG_MSG_ERROR("%lu / %lu hash blocks failed verification in FS section #%u from \"%s\"!", bad_blocks, total_blocks, ctx->section_idx, ctx->nca_ctx->content_id_str);
+
+end:
+    if (hash_buf) free(hash_buf);
+    if (data_buf) free(data_buf);
+
+    return success;
+}
+
+static void ncaProcessVerifyBatchEntries(NcaVerifyBatchState *state)
+{
+    while(true)
+    {
+        NcaVerifyBatchEntry *entry = NULL;
+
+        /* Claim the next unprocessed batch entry. */
+        SCOPED_LOCK(&(state->mutex))
+        {
+            if (state->next_entry < state->entry_count) entry = &(state->entries[state->next_entry++]);
+        }
+
+        if (!entry) break;
+
+        /* Verify NCA context. */
+        entry->success = ncaVerifyContext(entry->nca_ctx);
+    }
+}
+
+static void ncaVerifyContextBatchThreadFunc(void *arg)
+{
+    ncaProcessVerifyBatchEntries((NcaVerifyBatchState*)arg);
+    threadExit();
 }
 
 bool ncaInitializeContext(NcaContext *out, u8 storage_id, u8 hfs_partition_type, const NcmContentInfo *content_info, u32 title_version, Ticket *tik)
@@ -261,6 +691,204 @@ bool ncaInitializeContext(NcaContext *out, u8 storage_id, u8 hfs_partition_type,
     return (valid_fs_section_cnt > 0);
 }
 
+bool ncaInitializeContextBatch(NcaContextBatchEntry *entries, u32 entry_count)
+{
+    if (!entries || !entry_count)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Process a single entry directly on the calling thread. */
+    if (entry_count == 1)
+    {
+        NcaContextBatchEntry *entry = &(entries[0]);
+        entry->success = ncaInitializeContext(entry->nca_ctx, entry->storage_id, entry->hfs_partition_type, entry->content_info, entry->title_version, entry->tik);
+        return entry->success;
+    }
+
+    NcaContextBatchState state = { .entries = entries, .entry_count = entry_count, .next_entry = 0, .mutex = 0 };
+
+    Thread threads[NCA_BATCH_MAX_THREADS] = {0};
+    u32 thread_count = (MIN(entry_count, NCA_BATCH_MAX_THREADS) - 1), created_count = 0;    /* The calling thread processes entries as well. */
+
+    bool success = true;
+
+    /* Create worker threads, spreading them across all available cores. */
+    /* If thread creation fails at any point, the already created workers and the calling thread simply process the remaining entries between themselves. */
+    for(u32 i = 0; i < thread_count; i++)
+    {
+        if (!utilsCreateThread(&(threads[i]), ncaInitializeContextBatchThreadFunc, &state, (int)(i % 3))) break;
+        created_count++;
+    }
+
+    /* Process batch entries on the calling thread until none are left. */
+    ncaProcessContextBatchEntries(&state);
+
+    /* Wait for all worker threads to finish. */
+    for(u32 i = 0; i < created_count; i++) utilsJoinThread(&(threads[i]));
+
+    /* Check batch entry results. */
+    for(u32 i = 0; i < entry_count; i++)
+    {
+        if (!entries[i].success) success = false;
+    }
+
+    return success;
+}
+
+bool ncaVerifyFsSectionHashTree(NcaFsSectionContext *ctx)
+{
+    if (!ctx || !ctx->enabled || !ctx->nca_ctx || ctx->section_type >= NcaFsSectionType_Invalid)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    NcaContext *nca_ctx = ctx->nca_ctx;
+    bool success = false;
+
+    /* Patch RomFS sections can't be verified on their own - their hash tree covers patched data that only exists after the base NCA is applied. */
+    if (ctx->section_type == NcaFsSectionType_PatchRomFs)
+    {
+        LOG_MSG_DEBUG("Skipping hash tree verification for Patch RomFS section #%u in \"%s\".", ctx->section_idx, nca_ctx->content_id_str);
+        return true;
+    }
+
+    switch(ctx->hash_type)
+    {
+        case NcaHashType_None:
+            /* Nothing to check the section data against. */
+            success = true;
+            break;
+        case NcaHashType_HierarchicalSha256:
+        case NcaHashType_HierarchicalSha3256:
+        {
+            NcaHierarchicalSha256Data *hash_data = &(ctx->header.hash_data.hierarchical_sha256_data);
+            u32 layer_count = hash_data->hash_region_count;
+            bool use_sha3 = (ctx->hash_type == NcaHashType_HierarchicalSha3256);
+
+            if (!layer_count || layer_count > NCA_HIERARCHICAL_SHA256_MAX_REGION_COUNT || !hash_data->hash_block_size)
+            {
+                LOG_MSG_ERROR("Invalid HierarchicalSha256 data for FS section #%u in \"%s\"!", ctx->section_idx, nca_ctx->content_id_str);
+                break;
+            }
+
+            /* Verify the first hash region against the master hash from the FS section header. */
+            success = ncaVerifyHashTreeMasterHash(ctx, hash_data->hash_region[0].offset, hash_data->hash_region[0].size, hash_data->master_hash, use_sha3);
+
+            /* Verify each region against the hashes held by the region before it. The last region holds the actual FS data. */
+            /* Trailing partial blocks are hashed at their real size - HierarchicalSha256 hashes never cover padding. */
+            for(u32 i = 1; success && i < layer_count; i++)
+            {
+                success = ncaVerifyHashTreeLayer(ctx, hash_data->hash_region[i].offset, hash_data->hash_region[i].size, hash_data->hash_region[i - 1].offset, \
+                                                 hash_data->hash_block_size, false, use_sha3);
+            }
+
+            break;
+        }
+        case NcaHashType_HierarchicalIntegrity:
+        case NcaHashType_HierarchicalIntegritySha3:
+        {
+            NcaIntegrityMetaInfo *meta_info = &(ctx->header.hash_data.integrity_meta_info);
+            u32 level_count = (meta_info->info_level_hash.max_level_count - 1);
+            bool use_sha3 = (ctx->hash_type == NcaHashType_HierarchicalIntegritySha3);
+
+            if (__builtin_bswap32(meta_info->magic) != NCA_IVFC_MAGIC || !level_count || level_count > NCA_IVFC_LEVEL_COUNT)
+            {
+                LOG_MSG_ERROR("Invalid HierarchicalIntegrity data for FS section #%u in \"%s\"!", ctx->section_idx, nca_ctx->content_id_str);
+                break;
+            }
+
+            /* Verify the first hash level against the master hash from the FS section header. */
+            success = ncaVerifyHashTreeMasterHash(ctx, meta_info->info_level_hash.level_information[0].offset, meta_info->info_level_hash.level_information[0].size, \
+                                                  meta_info->master_hash, use_sha3);
+
+            /* Verify each level against the hashes held by the level before it. The last level holds the actual FS data. */
+            /* Trailing partial blocks are zero-padded to the full block size - IVFC hashes always cover whole blocks. */
+            for(u32 i = 1; success && i < level_count; i++)
+            {
+                NcaHierarchicalIntegrityVerificationLevelInformation *lvl_info = &(meta_info->info_level_hash.level_information[i]);
+                success = ncaVerifyHashTreeLayer(ctx, lvl_info->offset, lvl_info->size, meta_info->info_level_hash.level_information[i - 1].offset, \
+                                                 NCA_IVFC_BLOCK_SIZE(lvl_info->block_order), true, use_sha3);
+            }
+
+            break;
+        }
+        default:
+            LOG_MSG_ERROR("Invalid hash type for FS section #%u in \"%s\" (0x%02X).", ctx->section_idx, nca_ctx->content_id_str, ctx->hash_type);
+            break;
+    }
+
+    return success;
+}
+
+bool ncaVerifyContext(NcaContext *ctx)
+{
+    if (!ctx || !*(ctx->content_id_str))
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    bool success = true;
+
+    for(u8 i = 0; i < NCA_FS_HEADER_COUNT; i++)
+    {
+        NcaFsSectionContext *fs_ctx = &(ctx->fs_ctx[i]);
+        if (!fs_ctx->enabled) continue;
+        if (!ncaVerifyFsSectionHashTree(fs_ctx)) success = false;
+    }
+
+    return success;
+}
+
+bool ncaVerifyContextBatch(NcaVerifyBatchEntry *entries, u32 entry_count)
+{
+    if (!entries || !entry_count)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Process a single entry directly on the calling thread. */
+    if (entry_count == 1)
+    {
+        NcaVerifyBatchEntry *entry = &(entries[0]);
+        entry->success = ncaVerifyContext(entry->nca_ctx);
+        return entry->success;
+    }
+
+    NcaVerifyBatchState state = { .entries = entries, .entry_count = entry_count, .next_entry = 0, .mutex = 0 };
+
+    Thread threads[NCA_BATCH_MAX_THREADS] = {0};
+    u32 thread_count = (MIN(entry_count, NCA_BATCH_MAX_THREADS) - 1), created_count = 0;    /* The calling thread processes entries as well. */
+
+    bool success = true;
+
+    /* Create hash worker threads, spreading them across all available cores. */
+    /* If thread creation fails at any point, the already created workers and the calling thread simply process the remaining entries between themselves. */
+    for(u32 i = 0; i < thread_count; i++)
+    {
+        if (!utilsCreateThread(&(threads[i]), ncaVerifyContextBatchThreadFunc, &state, (int)(i % 3))) break;
+        created_count++;
+    }
+
+    /* Process batch entries on the calling thread until none are left. */
+    ncaProcessVerifyBatchEntries(&state);
+
+    /* Wait for all worker threads to finish. */
+    for(u32 i = 0; i < created_count; i++) utilsJoinThread(&(threads[i]));
+
+    /* Check batch entry results. */
+    for(u32 i = 0; i < entry_count; i++)
+    {
+        if (!entries[i].success) success = false;
+    }
+
+    return success;
+}
+
 bool ncaReadContentFile(NcaContext *ctx, void *out, u64 read_size, u64 offset)
 {
     if (!ctx || !*(ctx->content_id_str) || (ctx->storage_id != NcmStorageId_GameCard && !ctx->ncm_storage) || (ctx->storage_id == NcmStorageId_GameCard && !ctx->gamecard_offset) || !out || \
@@ -333,22 +961,53 @@ bool ncaGetFsSectionHashTargetExtents(NcaFsSectionContext *ctx, u64 *out_offset,
 
 bool ncaReadFsSection(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset)
 {
+    if (!ctx)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    if (!ncaAcquireCryptoBuffer()) return false;
+
+    /* Serialize operations against this FS section - they mutate shared per-section state (AES-128-CTR IV, sparse layer virtual offset, decrypted data cache). */
     bool ret = false;
-    SCOPED_LOCK(&g_ncaCryptoBufferMutex) ret = _ncaReadFsSection(ctx, out, read_size, offset);
+    SCOPED_LOCK(&(ctx->read_mtx)) ret = _ncaReadFsSection(ctx, out, read_size, offset);
+
+    ncaReleaseCryptoBuffer();
     return ret;
 }
 
 bool ncaReadAesCtrExStorage(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset, u32 ctr_val, bool decrypt)
 {
+    if (!ctx)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    if (!ncaAcquireCryptoBuffer()) return false;
+
     bool ret = false;
-    SCOPED_LOCK(&g_ncaCryptoBufferMutex) ret = _ncaReadAesCtrExStorage(ctx, out, read_size, offset, ctr_val, decrypt);
+    SCOPED_LOCK(&(ctx->read_mtx)) ret = _ncaReadAesCtrExStorage(ctx, out, read_size, offset, ctr_val, decrypt);
+
+    ncaReleaseCryptoBuffer();
     return ret;
 }
 
 bool ncaGenerateHierarchicalSha256Patch(NcaFsSectionContext *ctx, const void *data, u64 data_size, u64 data_offset, NcaHierarchicalSha256Patch *out)
 {
+    if (!ctx)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    if (!ncaAcquireCryptoBuffer()) return false;
+
     bool ret = false;
-    SCOPED_LOCK(&g_ncaCryptoBufferMutex) ret = ncaGenerateHashDataPatch(ctx, data, data_size, data_offset, out, false);
+    SCOPED_LOCK(&(ctx->read_mtx)) ret = ncaGenerateHashDataPatch(ctx, data, data_size, data_offset, out, false);
+
+    ncaReleaseCryptoBuffer();
     return ret;
 }
 
@@ -372,8 +1031,18 @@ void ncaWriteHierarchicalSha256PatchToMemoryBuffer(NcaContext *ctx, NcaHierarchi
 
 bool ncaGenerateHierarchicalIntegrityPatch(NcaFsSectionContext *ctx, const void *data, u64 data_size, u64 data_offset, NcaHierarchicalIntegrityPatch *out)
 {
+    if (!ctx)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    if (!ncaAcquireCryptoBuffer()) return false;
+
     bool ret = false;
-    SCOPED_LOCK(&g_ncaCryptoBufferMutex) ret = ncaGenerateHashDataPatch(ctx, data, data_size, data_offset, out, true);
+    SCOPED_LOCK(&(ctx->read_mtx)) ret = ncaGenerateHashDataPatch(ctx, data, data_size, data_offset, out, true);
+
+    ncaReleaseCryptoBuffer();
     return ret;
 }
 
@@ -451,6 +1120,8 @@ bool ncaEncryptHeader(NcaContext *ctx)
     const u8 *header_key = keysGetNcaHeaderKey();
     Aes128XtsContext hdr_aes_ctx = {0}, nca0_fs_header_ctx = {0};
 
+    NcaHeader encrypted_header = {0};
+
     if (!header_key)
     {
         LOG_MSG_ERROR("Failed to retrieve NCA header key!");
@@ -462,13 +1133,24 @@ bool ncaEncryptHeader(NcaContext *ctx)
     if (ctx->format_version == NcaVersion_Nca0) aes128XtsContextCreate(&nca0_fs_header_ctx, ctx->decrypted_key_area.aes_xts_1, ctx->decrypted_key_area.aes_xts_2, true);
 
     /* Encrypt NCA header. */
-    crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, &(ctx->encrypted_header), &(ctx->header), sizeof(NcaHeader), 0, NCA_AES_XTS_SECTOR_SIZE, true);
+    crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, &encrypted_header, &(ctx->header), sizeof(NcaHeader), 0, NCA_AES_XTS_SECTOR_SIZE, true);
     if (crypt_res != sizeof(NcaHeader))
     {
         LOG_MSG_ERROR("Error encrypting NCA \"%s\" header!", ctx->content_id_str);
         return false;
     }
 
+    /* Update the dirty sector bitmap before replacing the previous encrypted NCA header. */
+    /* AES-XTS is fully deterministic, so unmodified plaintext sectors always re-encrypt into the exact same ciphertext. */
+    /* Bits are OR'd on purpose - modifications carried out between multiple ncaEncryptHeader() calls must accumulate until the headers are written to an output dump. */
+    for(u8 i = 0; i < (u8)(sizeof(NcaHeader) / NCA_AES_XTS_SECTOR_SIZE); i++)
+    {
+        u64 sector_offset = ((u64)i * NCA_AES_XTS_SECTOR_SIZE);
+        if (memcmp((u8*)&encrypted_header + sector_offset, (u8*)&(ctx->encrypted_header) + sector_offset, NCA_AES_XTS_SECTOR_SIZE) != 0) ctx->dirty_header_sectors |= BIT(i);
+    }
+
+    memcpy(&(ctx->encrypted_header), &encrypted_header, sizeof(NcaHeader));
+
     /* Encrypt NCA FS section headers. */
     /* Both NCA2 and NCA3 place the NCA FS section headers right after the NCA header. However, NCA0 places them at the start sector from each NCA FS section. */
     for(u8 i = 0; i < NCA_FS_HEADER_COUNT; i++)
@@ -486,12 +1168,19 @@ bool ncaEncryptHeader(NcaContext *ctx)
         Aes128XtsContext *aes_xts_ctx = (ctx->format_version != NcaVersion_Nca0 ? &hdr_aes_ctx : &nca0_fs_header_ctx);
         u64 sector = (ctx->format_version == NcaVersion_Nca3 ? (2U + i) : (ctx->format_version == NcaVersion_Nca2 ? 0 : (fs_info->start_sector - 2)));
 
-        crypt_res = aes128XtsNintendoCrypt(aes_xts_ctx, &(fs_ctx->encrypted_header), &(fs_ctx->header), sizeof(NcaFsHeader), sector, NCA_AES_XTS_SECTOR_SIZE, true);
+        NcaFsHeader encrypted_fs_header = {0};
+
+        crypt_res = aes128XtsNintendoCrypt(aes_xts_ctx, &encrypted_fs_header, &(fs_ctx->header), sizeof(NcaFsHeader), sector, NCA_AES_XTS_SECTOR_SIZE, true);
         if (crypt_res != sizeof(NcaFsHeader))
         {
             LOG_MSG_ERROR("Error encrypting NCA%u \"%s\" FS section header #%u!", ctx->format_version, ctx->content_id_str, i);
             return false;
         }
+
+        /* Update the dirty sector bitmap before replacing the previous encrypted NCA FS section header. Each FS section header takes up exactly one AES-XTS sector. */
+        if (memcmp(&encrypted_fs_header, &(fs_ctx->encrypted_header), sizeof(NcaFsHeader)) != 0) ctx->dirty_header_sectors |= BIT(2U + i);
+
+        memcpy(&(fs_ctx->encrypted_header), &encrypted_fs_header, sizeof(NcaFsHeader));
     }
 
     return true;
@@ -505,19 +1194,27 @@ void ncaWriteEncryptedHeaderDataToMemoryBuffer(NcaContext *ctx, void *buf, u64 b
 
     ctx->header_written = true;
 
-    /* Attempt to write the NCA header. */
-    /* Return right away if the NCA header was only partially written. */
-    if (buf_offset < sizeof(NcaHeader) && !ncaWritePatchToMemoryBuffer(ctx, &(ctx->encrypted_header), sizeof(NcaHeader), 0, buf, buf_size, buf_offset))
+    /* Attempt to write dirty NCA header sectors. Unmodified sectors already hold the right data in the output buffer, so they're skipped entirely. */
+    /* Return right away if a dirty sector was only partially written. */
+    for(u8 i = 0; i < (u8)(sizeof(NcaHeader) / NCA_AES_XTS_SECTOR_SIZE); i++)
     {
-        ctx->header_written = false;
-        return;
+        if (!(ctx->dirty_header_sectors & BIT(i))) continue;
+
+        u64 sector_offset = ((u64)i * NCA_AES_XTS_SECTOR_SIZE);
+
+        if (buf_offset < (sector_offset + NCA_AES_XTS_SECTOR_SIZE) && \
+            !ncaWritePatchToMemoryBuffer(ctx, (u8*)&(ctx->encrypted_header) + sector_offset, NCA_AES_XTS_SECTOR_SIZE, sector_offset, buf, buf_size, buf_offset))
+        {
+            ctx->header_written = false;
+            return;
+        }
     }
 
-    /* Attempt to write NCA FS section headers. */
+    /* Attempt to write dirty NCA FS section headers. */
     for(u8 i = 0; i < NCA_FS_HEADER_COUNT; i++)
     {
         NcaFsSectionContext *fs_ctx = &(ctx->fs_ctx[i]);
-        if (!fs_ctx->enabled || fs_ctx->header_written) continue;
+        if (!fs_ctx->enabled || fs_ctx->header_written || !(ctx->dirty_header_sectors & BIT(2U + i))) continue;
 
         u64 fs_header_offset = (ctx->format_version != NcaVersion_Nca0 ? (sizeof(NcaHeader) + (i * sizeof(NcaFsHeader))) : fs_ctx->section_offset);
         fs_ctx->header_written = ncaWritePatchToMemoryBuffer(ctx, &(fs_ctx->encrypted_header), sizeof(NcaFsHeader), fs_header_offset, buf, buf_size, buf_offset);
@@ -588,19 +1285,24 @@ static bool ncaReadDecryptedHeader(NcaContext *ctx)
     const u8 *header_key = keysGetNcaHeaderKey();
     Aes128XtsContext hdr_aes_ctx = {0}, nca0_fs_header_ctx = {0};
 
+    u8 full_header[NCA_FULL_HEADER_LENGTH] = {0};
+
     if (!header_key)
     {
         LOG_MSG_ERROR("Failed to retrieve NCA header key!");
         return false;
     }
 
-    /* Read NCA header. */
-    if (!ncaReadContentFile(ctx, &(ctx->encrypted_header), sizeof(NcaHeader), 0))
+    /* Read the full NCA header area in a single storage call. */
+    /* NCA2/NCA3 place the NCA FS section headers right after the NCA header, so this also covers them - one IPC round-trip instead of up to five per NCA, which adds up on batch initialization. */
+    if (!ncaReadContentFile(ctx, full_header, sizeof(full_header), 0))
     {
-        LOG_MSG_ERROR("Failed to read NCA \"%s\" header!", ctx->content_id_str);
+        LOG_MSG_ERROR("Failed to read NCA \"%s\" header area!", ctx->content_id_str);
         return false;
     }
 
+    memcpy(&(ctx->encrypted_header), full_header, sizeof(NcaHeader));
+
     /* Prepare NCA header AES-128-XTS context. */
     aes128XtsContextCreate(&hdr_aes_ctx, header_key, header_key + AES_128_KEY_SIZE, false);
 
@@ -619,7 +1321,7 @@ static bool ncaReadDecryptedHeader(NcaContext *ctx)
     ctx->key_generation = ncaGetKeyGenerationValue(ctx);
     ctx->rights_id_available = ncaCheckRightsIdAvailability(ctx);
     sha256CalculateHash(ctx->header_hash, &(ctx->header), sizeof(NcaHeader));
-    ctx->valid_main_signature = ncaVerifyMainSignature(ctx);
+    ncaVerifyMainSignature(ctx);
 
     /* Decrypt NCA key area (if needed). */
     if (!ctx->rights_id_available && !ncaKeyAreaCrypt(ctx, false))
@@ -641,11 +1343,15 @@ static bool ncaReadDecryptedHeader(NcaContext *ctx)
         /* Don't proceed if this NCA FS section isn't populated. */
         if (!ncaIsFsInfoEntryValid(fs_info)) continue;
 
-        /* Read NCA FS section header. */
-        u64 fs_header_offset = (ctx->format_version != NcaVersion_Nca0 ? (sizeof(NcaHeader) + (i * sizeof(NcaFsHeader))) : NCA_FS_SECTOR_OFFSET(fs_info->start_sector));
-        if (!ncaReadContentFile(ctx, &(fs_ctx->encrypted_header), sizeof(NcaFsHeader), fs_header_offset))
+        /* Retrieve NCA FS section header. */
+        /* NCA2/NCA3 FS section headers were already pulled in as part of the full header area read - only NCA0 needs extra reads at each FS section start sector. */
+        if (ctx->format_version != NcaVersion_Nca0)
+        {
+            memcpy(&(fs_ctx->encrypted_header), full_header + sizeof(NcaHeader) + (i * sizeof(NcaFsHeader)), sizeof(NcaFsHeader));
+        } else
+        if (!ncaReadContentFile(ctx, &(fs_ctx->encrypted_header), sizeof(NcaFsHeader), NCA_FS_SECTOR_OFFSET(fs_info->start_sector)))
         {
-            LOG_MSG_ERROR("Failed to read NCA%u \"%s\" FS section header #%u at offset 0x%lX!", ctx->format_version, ctx->content_id_str, i, fs_header_offset);
+            LOG_MSG_ERROR("Failed to read NCA0 \"%s\" FS section header #%u at offset 0x%lX!", ctx->content_id_str, i, NCA_FS_SECTOR_OFFSET(fs_info->start_sector));
             return false;
         }
 
@@ -718,31 +1424,32 @@ static bool ncaKeyAreaCrypt(NcaContext *ctx, bool encrypt)
     return true;
 }
 
-static bool ncaVerifyMainSignature(NcaContext *ctx)
+static void ncaVerifyMainSignature(NcaContext *ctx)
 {
     if (!ctx)
     {
         LOG_MSG_ERROR("Invalid NCA context!");
-        return false;
+        return;
     }
 
+    ctx->valid_main_signature = false;
+
     u8 key_generation = ctx->header.main_signature_key_generation;
     if (key_generation > NcaSignatureKeyGeneration_Current)
     {
         LOG_MSG_ERROR("Unsupported key generation value! (0x%02X).", key_generation);
-        return false;
+        return;
     }
 
     /* Retrieve modulus for the NCA main signature. */
     const u8 *modulus = (utilsIsDevelopmentUnit() ? g_ncaHeaderMainSignatureModuliDev[key_generation] : g_ncaHeaderMainSignatureModuliProd[key_generation]);
 
-    /* Verify NCA signature. */
-    bool ret = rsa2048VerifySha256BasedPssSignature(&(ctx->header.magic), NCA_SIGNATURE_AREA_SIZE, ctx->header.main_signature, modulus, g_ncaHeaderMainSignaturePublicExponent, \
-                                                    sizeof(g_ncaHeaderMainSignaturePublicExponent));
-
-    LOG_MSG_DEBUG("Header signature for %s NCA \"%s\" is %s.", titleGetNcmContentTypeName(ctx->content_type), ctx->content_id_str, ret ? "valid" : "invalid");
+    /* Queue NCA signature verification. */
+    /* The expensive modexp is carried out by the RSA worker thread, overlapping with the NCA FS section header reads that follow - the header checksum is calculated before this call returns. */
+    rsa2048QueueSha256BasedPssSignatureVerification(&(ctx->header.magic), NCA_SIGNATURE_AREA_SIZE, ctx->header.main_signature, modulus, g_ncaHeaderMainSignaturePublicExponent, \
+                                                    sizeof(g_ncaHeaderMainSignaturePublicExponent), &(ctx->valid_main_signature));
 
-    return ret;
+    LOG_MSG_DEBUG("Queued header signature verification for %s NCA \"%s\".", titleGetNcmContentTypeName(ctx->content_type), ctx->content_id_str);
 }
 
 NX_INLINE bool ncaIsVersion0KeyAreaEncrypted(NcaContext *ctx)
@@ -1130,7 +1837,7 @@ static bool ncaFsSectionValidateHashDataBoundaries(NcaFsSectionContext *ctx)
 
 static bool _ncaReadFsSection(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset)
 {
-    if (!g_ncaCryptoBuffer || !ctx || !ctx->enabled || !ctx->nca_ctx || ctx->section_idx >= NCA_FS_HEADER_COUNT || ctx->section_offset < sizeof(NcaHeader) || \
+    if (!g_ncaThreadCryptoBuffer || !ctx || !ctx->enabled || !ctx->nca_ctx || ctx->section_idx >= NCA_FS_HEADER_COUNT || ctx->section_offset < sizeof(NcaHeader) || \
         ctx->section_type >= NcaFsSectionType_Invalid || ctx->encryption_type == NcaEncryptionType_Auto || ctx->encryption_type > NcaEncryptionType_AesCtrExSkipLayerHash || \
         !out || !read_size || (offset + read_size) > ctx->section_size)
     {
@@ -1163,6 +1870,14 @@ static bool _ncaReadFsSection(NcaFsSectionContext *ctx, void *out, u64 read_size
         goto end;
     }
 
+    /* Try to serve small reads from the decrypted data cache. Metadata-heavy operations re-read the same FS entry tables over and over. */
+    if (!g_ncaFsSectionCacheFill && !ctx->has_sparse_layer && !ctx->skip_hash_layer_crypto && ctx->encryption_type > NcaEncryptionType_None && \
+        read_size <= NCA_FS_SECTION_CACHE_BLOCK_SIZE && ncaFsSectionCachedRead(ctx, out, read_size, offset))
+    {
+        ret = true;
+        goto end;
+    }
+
     /* Check if we're about to read a plaintext hash layer. */
     if (ncaFsSectionCheckPlaintextHashRegionAccess(ctx, offset, read_size, &plaintext_area))
     {
@@ -1253,7 +1968,7 @@ static bool _ncaReadFsSection(NcaFsSectionContext *ctx, void *out, u64 read_size
     out_chunk_size = (block_size > NCA_CRYPTO_BUFFER_SIZE ? (NCA_CRYPTO_BUFFER_SIZE - data_start_offset) : read_size);
 
     /* Read data. */
-    if (!ncaReadContentFile(nca_ctx, g_ncaCryptoBuffer, chunk_size, block_start_offset))
+    if (!ncaReadContentFile(nca_ctx, g_ncaThreadCryptoBuffer, chunk_size, block_start_offset))
     {
         LOG_MSG_ERROR("Failed to read 0x%lX bytes encrypted data block at offset 0x%lX from NCA \"%s\" FS section #%u! (unaligned).", chunk_size, block_start_offset, nca_ctx->content_id_str, \
                       ctx->section_idx);
@@ -1265,7 +1980,7 @@ static bool _ncaReadFsSection(NcaFsSectionContext *ctx, void *out, u64 read_size
     {
         sector_num = ((nca_ctx->format_version != NcaVersion_Nca0 ? offset : (content_offset - sizeof(NcaHeader))) / NCA_AES_XTS_SECTOR_SIZE);
 
-        crypt_res = aes128XtsNintendoCrypt(&(ctx->xts_decrypt_ctx), g_ncaCryptoBuffer, g_ncaCryptoBuffer, chunk_size, sector_num, NCA_AES_XTS_SECTOR_SIZE, false);
+        crypt_res = aes128XtsNintendoCrypt(&(ctx->xts_decrypt_ctx), g_ncaThreadCryptoBuffer, g_ncaThreadCryptoBuffer, chunk_size, sector_num, NCA_AES_XTS_SECTOR_SIZE, false);
         if (crypt_res != chunk_size)
         {
             LOG_MSG_ERROR("Failed to AES-XTS decrypt 0x%lX bytes data block at offset 0x%lX from NCA \"%s\" FS section #%u! (unaligned).", chunk_size, block_start_offset, nca_ctx->content_id_str, \
@@ -1277,11 +1992,11 @@ static bool _ncaReadFsSection(NcaFsSectionContext *ctx, void *out, u64 read_size
     {
         aes128CtrUpdatePartialCtr(ctx->ctr, ALIGN_DOWN(iv_offset, AES_BLOCK_SIZE));
         aes128CtrContextResetCtr(&(ctx->ctr_ctx), ctx->ctr);
-        aes128CtrCrypt(&(ctx->ctr_ctx), g_ncaCryptoBuffer, g_ncaCryptoBuffer, chunk_size);
+        aes128CtrCrypt(&(ctx->ctr_ctx), g_ncaThreadCryptoBuffer, g_ncaThreadCryptoBuffer, chunk_size);
     }
 
     /* Copy decrypted data. */
-    memcpy(out, g_ncaCryptoBuffer + data_start_offset, out_chunk_size);
+    memcpy(out, g_ncaThreadCryptoBuffer + data_start_offset, out_chunk_size);
 
     /* Perform another read if required. */
     if (sparse_virtual_offset && block_size > NCA_CRYPTO_BUFFER_SIZE) ctx->cur_sparse_virtual_offset += out_chunk_size;
@@ -1293,6 +2008,62 @@ end:
     return ret;
 }
 
+static bool ncaFsSectionCachedRead(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset)
+{
+    /* Check if a cached block already covers the requested range. */
+    for(u8 i = 0; i < ctx->read_cache_count; i++)
+    {
+        if (offset < ctx->read_cache[i].offset || (offset + read_size) > (ctx->read_cache[i].offset + ctx->read_cache[i].size)) continue;
+
+        memcpy(out, ctx->read_cache[i].data + (offset - ctx->read_cache[i].offset), read_size);
+        ctx->read_cache[i].lru_counter = ++(ctx->read_cache_lru_counter);
+
+        return true;
+    }
+
+    /* Calculate cache block extents and bail out if the requested range crosses a cache block boundary. */
+    u64 cache_offset = ALIGN_DOWN(offset, NCA_FS_SECTION_CACHE_BLOCK_SIZE);
+    u64 cache_size = ((cache_offset + NCA_FS_SECTION_CACHE_BLOCK_SIZE) > ctx->section_size ? (ctx->section_size - cache_offset) : NCA_FS_SECTION_CACHE_BLOCK_SIZE);
+    if ((offset + read_size) > (cache_offset + cache_size)) return false;
+
+    /* Get a free cache block, or evict the least recently used one. */
+    u8 idx = 0;
+
+    if (ctx->read_cache_count < NCA_FS_SECTION_CACHE_BLOCK_COUNT)
+    {
+        idx = ctx->read_cache_count;
+    } else {
+        for(u8 i = 1; i < NCA_FS_SECTION_CACHE_BLOCK_COUNT; i++)
+        {
+            if (ctx->read_cache[i].lru_counter < ctx->read_cache[idx].lru_counter) idx = i;
+        }
+    }
+
+    /* Fill the cache block using a regular FS section read. The global flag keeps the nested call from reentering this function. */
+    g_ncaFsSectionCacheFill = true;
+    bool success = _ncaReadFsSection(ctx, ctx->read_cache[idx].data, cache_size, cache_offset);
+    g_ncaFsSectionCacheFill = false;
+
+    if (!success)
+    {
+        /* Invalidate the cache block we just tried to fill. */
+        ctx->read_cache[idx].size = 0;
+        return false;
+    }
+
+    /* Update cache block properties. */
+    ctx->read_cache[idx].offset = cache_offset;
+    ctx->read_cache[idx].size = cache_size;
+    ctx->read_cache[idx].lru_counter = ++(ctx->read_cache_lru_counter);
+
+    if (idx == ctx->read_cache_count) ctx->read_cache_count++;
+
+    /* Copy the requested range. */
+    memcpy(out, ctx->read_cache[idx].data + (offset - cache_offset), read_size);
+
+    return true;
+}
+
 static bool ncaFsSectionCheckPlaintextHashRegionAccess(NcaFsSectionContext *ctx, u64 offset, u64 size, NcaRegion *out_region)
 {
     if (!ctx->skip_hash_layer_crypto) return false;
@@ -1325,7 +2096,7 @@ static bool ncaFsSectionCheckPlaintextHashRegionAccess(NcaFsSectionContext *ctx,
 
 static bool _ncaReadAesCtrExStorage(NcaFsSectionContext *ctx, void *out, u64 read_size, u64 offset, u32 ctr_val, bool decrypt)
 {
-    if (!g_ncaCryptoBuffer || !ctx || !ctx->enabled || !ctx->nca_ctx || ctx->section_idx >= NCA_FS_HEADER_COUNT || ctx->section_offset < sizeof(NcaHeader) || \
+    if (!g_ncaThreadCryptoBuffer || !ctx || !ctx->enabled || !ctx->nca_ctx || ctx->section_idx >= NCA_FS_HEADER_COUNT || ctx->section_offset < sizeof(NcaHeader) || \
         ctx->section_type != NcaFsSectionType_PatchRomFs || (ctx->encryption_type != NcaEncryptionType_None && ctx->encryption_type != NcaEncryptionType_AesCtrEx && \
         ctx->encryption_type != NcaEncryptionType_AesCtrExSkipLayerHash) || !out || !read_size || (offset + read_size) > ctx->section_size)
     {
@@ -1380,7 +2151,7 @@ static bool _ncaReadAesCtrExStorage(NcaFsSectionContext *ctx, void *out, u64 rea
     out_chunk_size = (block_size > NCA_CRYPTO_BUFFER_SIZE ? (NCA_CRYPTO_BUFFER_SIZE - data_start_offset) : read_size);
 
     /* Read data. */
-    if (!ncaReadContentFile(nca_ctx, g_ncaCryptoBuffer, chunk_size, block_start_offset))
+    if (!ncaReadContentFile(nca_ctx, g_ncaThreadCryptoBuffer, chunk_size, block_start_offset))
     {
         LOG_MSG_ERROR("Failed to read 0x%lX bytes encrypted data block at offset 0x%lX from NCA \"%s\" FS section #%u! (unaligned).", chunk_size, block_start_offset, nca_ctx->content_id_str, \
                       ctx->section_idx);
@@ -1390,10 +2161,10 @@ static bool _ncaReadAesCtrExStorage(NcaFsSectionContext *ctx, void *out, u64 rea
     /* Decrypt data. */
     aes128CtrUpdatePartialCtrEx(ctx->ctr, ctr_val, block_start_offset);
     aes128CtrContextResetCtr(&(ctx->ctr_ctx), ctx->ctr);
-    aes128CtrCrypt(&(ctx->ctr_ctx), g_ncaCryptoBuffer, g_ncaCryptoBuffer, chunk_size);
+    aes128CtrCrypt(&(ctx->ctr_ctx), g_ncaThreadCryptoBuffer, g_ncaThreadCryptoBuffer, chunk_size);
 
     /* Copy decrypted data. */
-    memcpy(out, g_ncaCryptoBuffer + data_start_offset, out_chunk_size);
+    memcpy(out, g_ncaThreadCryptoBuffer + data_start_offset, out_chunk_size);
 
     ret = (block_size > NCA_CRYPTO_BUFFER_SIZE ? _ncaReadAesCtrExStorage(ctx, (u8*)out + out_chunk_size, read_size - out_chunk_size, offset + out_chunk_size, ctr_val, decrypt) : true);
 
@@ -1411,6 +2182,36 @@ static void ncaCalculateLayerHash(void *dst, const void *src, size_t size, bool
     }
 }
 
+static void ncaProcessLayerHashBlocks(NcaLayerHashState *state)
+{
+    while(true)
+    {
+        u64 block_idx = 0;
+
+        /* Claim the next unprocessed hash block. */
+        SCOPED_LOCK(&(state->mutex))
+        {
+            block_idx = state->next_block;
+            if (block_idx < state->block_count) state->next_block++;
+        }
+
+        if (block_idx >= state->block_count) break;
+
+        /* Hash the claimed block. Blocks within a layer are independent, and each one writes to a disjoint output range, so no locking is needed here. */
+        u64 block_offset = (block_idx * state->hash_block_size);
+        u64 block_size = state->hash_block_size;
+        if (state->truncate_last_block && block_size > (state->cur_layer_read_size - block_offset)) block_size = (state->cur_layer_read_size - block_offset);
+
+        ncaCalculateLayerHash(state->parent_layer_block + (block_idx * SHA256_HASH_SIZE), state->cur_layer_block + block_offset, block_size, state->use_sha3);
+    }
+}
+
+static void ncaLayerHashThreadFunc(void *arg)
+{
+    ncaProcessLayerHashBlocks((NcaLayerHashState*)arg);
+    threadExit();
+}
+
 /* In this function, the term "layer" is used as a generic way to refer to both HierarchicalSha256 hash regions and HierarchicalIntegrity verification levels. */
 static bool ncaGenerateHashDataPatch(NcaFsSectionContext *ctx, const void *data, u64 data_size, u64 data_offset, void *out, bool is_integrity_patch)
 {
@@ -1564,10 +2365,37 @@ static bool ncaGenerateHashDataPatch(NcaFsSectionContext *ctx, const void *data,
             /* HierarchicalSha256: size is truncated for blocks smaller than the hash block size. */
             /* HierarchicalIntegrity: size *isn't* truncated for blocks smaller than the hash block size, so we just keep using the same hash block size throughout the loop. */
             /*                        For these specific cases, the rest of the block should be filled with zeroes (already taken care of by using calloc()). */
-            for(u64 j = 0, k = 0; j < cur_layer_read_size; j += hash_block_size, k++)
+            u64 block_count = DIVIDE_UP(cur_layer_read_size, hash_block_size);
+
+            if (block_count >= NCA_LAYER_HASH_MIN_BLOCKS)
             {
-                if (!is_integrity_patch && hash_block_size > (cur_layer_read_size - j)) hash_block_size = (cur_layer_read_size - j);
-                ncaCalculateLayerHash(parent_layer_block + (k * SHA256_HASH_SIZE), cur_layer_block + j, hash_block_size, use_sha3);
+                NcaLayerHashState state = { .cur_layer_block = cur_layer_block, .parent_layer_block = parent_layer_block, .cur_layer_read_size = cur_layer_read_size, \
+                                            .hash_block_size = hash_block_size, .block_count = block_count, .next_block = 0, .truncate_last_block = !is_integrity_patch, \
+                                            .use_sha3 = use_sha3, .mutex = 0 };
+
+                Thread threads[NCA_LAYER_HASH_MAX_THREADS] = {0};
+                u32 thread_count = (u32)MIN(block_count - 1, NCA_LAYER_HASH_MAX_THREADS), created_count = 0;
+
+                /* Create hash worker threads, spreading them across all available cores. */
+                /* If thread creation fails at any point, the already created workers and the calling thread simply hash the remaining blocks between themselves. */
+                for(u32 t = 0; t < thread_count; t++)
+                {
+                    if (!utilsCreateThread(&(threads[t]), ncaLayerHashThreadFunc, &state, (int)(t % 3))) break;
+                    created_count++;
+                }
+
+                /* Hash blocks on the calling thread until none are left. */
+                ncaProcessLayerHashBlocks(&state);
+
+                /* Wait for all worker threads to finish. */
+                for(u32 t = 0; t < created_count; t++) utilsJoinThread(&(threads[t]));
+            } else {
+                /* Not enough blocks to offset the thread creation overhead - hash them serially. */
+                for(u64 j = 0, k = 0; j < cur_layer_read_size; j += hash_block_size, k++)
+                {
+                    if (!is_integrity_patch && hash_block_size > (cur_layer_read_size - j)) hash_block_size = (cur_layer_read_size - j);
+                    ncaCalculateLayerHash(parent_layer_block + (k * SHA256_HASH_SIZE), cur_layer_block + j, hash_block_size, use_sha3);
+                }
             }
         } else {
             /* Recalculate master hash from the HashData area. */
@@ -1678,7 +2506,7 @@ static void *ncaGenerateEncryptedFsSectionBlock(NcaFsSectionContext *ctx, const
     u8 *out = NULL;
     bool success = false;
 
-    if (!g_ncaCryptoBuffer || !ctx || !ctx->enabled || ctx->has_sparse_layer || ctx->has_compression_layer || !ctx->nca_ctx || ctx->section_idx >= NCA_FS_HEADER_COUNT || \
+    if (!g_ncaThreadCryptoBuffer || !ctx || !ctx->enabled || ctx->has_sparse_layer || ctx->has_compression_layer || !ctx->nca_ctx || ctx->section_idx >= NCA_FS_HEADER_COUNT || \
         ctx->section_offset < sizeof(NcaHeader) || ctx->hash_type <= NcaHashType_None || ctx->hash_type == NcaHashType_AutoSha3 || ctx->hash_type > NcaHashType_HierarchicalIntegritySha3 || \
         ctx->encryption_type == NcaEncryptionType_Auto || ctx->encryption_type == NcaEncryptionType_AesCtrEx || ctx->encryption_type >= NcaEncryptionType_AesCtrExSkipLayerHash || \
         ctx->section_type >= NcaFsSectionType_Invalid || !data || !data_size || (data_offset + data_size) > ctx->section_size || !out_block_size || !out_block_offset)
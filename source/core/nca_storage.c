@@ -242,6 +242,26 @@ bool ncaStorageIsBlockWithinPatchStorageRange(NcaStorageContext *ctx, u64 offset
     return success;
 }
 
+bool ncaStorageClassifyBlocksWithinPatchStorageRange(NcaStorageContext *ctx, BucketTreeBlockClassification *blocks, u32 block_count)
+{
+    if (!ncaStorageIsValidContext(ctx) || ctx->nca_fs_ctx->section_type != NcaFsSectionType_PatchRomFs || (ctx->base_storage_type != NcaStorageBaseStorageType_Indirect && \
+        ctx->base_storage_type != NcaStorageBaseStorageType_Compressed) || (ctx->base_storage_type == NcaStorageBaseStorageType_Indirect && !ctx->indirect_storage) || \
+        (ctx->base_storage_type == NcaStorageBaseStorageType_Compressed && !ctx->compressed_storage) || !blocks || !block_count)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Get base storage. */
+    BucketTreeContext *bktr_ctx = (ctx->base_storage_type == NcaStorageBaseStorageType_Indirect ? ctx->indirect_storage : ctx->compressed_storage);
+
+    /* Classify the provided block extents against the Indirect Storage's range. */
+    bool success = bktrClassifyBlocksWithinIndirectStorageRange(bktr_ctx, blocks, block_count);
+    if (!success) LOG_MSG_ERROR("Failed to classify block extents against the Indirect Storage's range!");
+
+    return success;
+}
+
 void ncaStorageFreeContext(NcaStorageContext *ctx)
 {
     if (!ctx) return;
@@ -23,6 +23,29 @@
 #include "npdm.h"
 #include "rsa.h"
 
+/* Type definitions. */
+
+/// Cached raw NPDM entry. NPDM data is immutable within a session, so once validated it's kept in memory for the lifetime of the process.
+/// Repeat visits to the same Program NCA (e.g. dump retries, verify-then-dump flows) skip the ExeFS read entirely.
+typedef struct {
+    NcmContentId content_id;    ///< Content ID for the Program NCA the NPDM was read from.
+    u8 *raw_data;               ///< Pointer to a dynamically allocated buffer that holds the validated raw NPDM.
+    u64 raw_data_size;          ///< Raw NPDM size.
+} NpdmCacheEntry;
+
+/* Global variables. */
+
+static Mutex g_npdmCacheMutex = 0;
+
+/// Protected by g_npdmCacheMutex.
+static NpdmCacheEntry *g_npdmCache = NULL;
+static u32 g_npdmCacheCount = 0;
+
+/* Function prototypes. */
+
+static bool npdmGetRawDataFromCache(const NcaContext *nca_ctx, u64 raw_data_size, u8 **out_raw_data);
+static void npdmAddRawDataToCache(const NcaContext *nca_ctx, const u8 *raw_data, u64 raw_data_size);
+
 bool npdmInitializeContext(NpdmContext *out, PartitionFileSystemContext *pfs_ctx)
 {
     NcaContext *nca_ctx = NULL;
@@ -57,19 +80,24 @@ bool npdmInitializeContext(NpdmContext *out, PartitionFileSystemContext *pfs_ctx
         goto end;
     }
 
-    /* Allocate memory for the raw NPDM data. */
     out->raw_data_size = pfs_entry->size;
-    if (!(out->raw_data = malloc(out->raw_data_size)))
-    {
-        LOG_MSG_ERROR("Failed to allocate memory for the raw NPDM data!");
-        goto end;
-    }
 
-    /* Read raw NPDM data into memory buffer. */
-    if (!pfsReadEntryData(pfs_ctx, pfs_entry, out->raw_data, out->raw_data_size, 0))
+    /* Check if a validated raw NPDM for this Program NCA is already cached - repeat visits within a session skip the ExeFS read entirely. */
+    if (!npdmGetRawDataFromCache(nca_ctx, out->raw_data_size, &(out->raw_data)))
     {
-        LOG_MSG_ERROR("Failed to read raw NPDM data!");
-        goto end;
+        /* Allocate memory for the raw NPDM data. */
+        if (!(out->raw_data = malloc(out->raw_data_size)))
+        {
+            LOG_MSG_ERROR("Failed to allocate memory for the raw NPDM data!");
+            goto end;
+        }
+
+        /* Read raw NPDM data into memory buffer. */
+        if (!pfsReadEntryData(pfs_ctx, pfs_entry, out->raw_data, out->raw_data_size, 0))
+        {
+            LOG_MSG_ERROR("Failed to read raw NPDM data!");
+            goto end;
+        }
     }
 
     /* Verify meta header. */
@@ -273,6 +301,9 @@ bool npdmInitializeContext(NpdmContext *out, PartitionFileSystemContext *pfs_ctx
         goto end;
     }
 
+    /* Cache the validated raw NPDM. A failure here isn't fatal - the data will simply be read from the ExeFS again next time. */
+    npdmAddRawDataToCache(nca_ctx, out->raw_data, out->raw_data_size);
+
     success = true;
 
 end:
@@ -287,3 +318,77 @@ end:
 
     return success;
 }
+
+static bool npdmGetRawDataFromCache(const NcaContext *nca_ctx, u64 raw_data_size, u8 **out_raw_data)
+{
+    bool found = false;
+
+    SCOPED_LOCK(&g_npdmCacheMutex)
+    {
+        for(u32 i = 0; i < g_npdmCacheCount; i++)
+        {
+            NpdmCacheEntry *entry = &(g_npdmCache[i]);
+            if (memcmp(&(entry->content_id), &(nca_ctx->content_id), sizeof(NcmContentId)) != 0 || entry->raw_data_size != raw_data_size) continue;
+
+            /* Copy cached data into a freshly allocated buffer - the returned buffer is owned by the caller's NpdmContext. */
+            u8 *raw_data = malloc(raw_data_size);
+            if (!raw_data)
+            {
+                LOG_MSG_ERROR("Failed to allocate memory for the cached raw NPDM data!");
+                break;
+            }
+
+            memcpy(raw_data, entry->raw_data, raw_data_size);
+            *out_raw_data = raw_data;
+
+            LOG_MSG_INFO("Serving raw NPDM data for Program NCA \"%s\" from cache.", nca_ctx->content_id_str);
+
+            found = true;
+            break;
+        }
+    }
+
+    return found;
+}
+
+static void npdmAddRawDataToCache(const NcaContext *nca_ctx, const u8 *raw_data, u64 raw_data_size)
+{
+    SCOPED_LOCK(&g_npdmCacheMutex)
+    {
+        u32 i = 0;
+
+        /* Check if this raw NPDM has already been cached. Cache hits in npdmInitializeContext() end up here as well. */
+        for(i = 0; i < g_npdmCacheCount; i++)
+        {
+            if (!memcmp(&(g_npdmCache[i].content_id), &(nca_ctx->content_id), sizeof(NcmContentId))) break;
+        }
+
+        if (i < g_npdmCacheCount) break;
+
+        /* Allocate memory for the cached raw NPDM copy. */
+        u8 *raw_data_copy = malloc(raw_data_size);
+        if (!raw_data_copy)
+        {
+            LOG_MSG_ERROR("Failed to allocate memory for the raw NPDM cache copy! (0x%lX bytes).", raw_data_size);
+            break;
+        }
+
+        /* Reallocate cache entry buffer. */
+        NpdmCacheEntry *cache_tmp = realloc(g_npdmCache, (g_npdmCacheCount + 1) * sizeof(NpdmCacheEntry));
+        if (!cache_tmp)
+        {
+            LOG_MSG_ERROR("Failed to reallocate raw NPDM cache buffer! (%u entries).", g_npdmCacheCount + 1);
+            free(raw_data_copy);
+            break;
+        }
+
+        g_npdmCache = cache_tmp;
+
+        /* Fill new cache entry. */
+        NpdmCacheEntry *entry = &(g_npdmCache[g_npdmCacheCount++]);
+        memcpy(&(entry->content_id), &(nca_ctx->content_id), sizeof(NcmContentId));
+        memcpy(raw_data_copy, raw_data, raw_data_size);
+        entry->raw_data = raw_data_copy;
+        entry->raw_data_size = raw_data_size;
+    }
+}
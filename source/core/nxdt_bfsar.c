@@ -24,8 +24,10 @@
 #include "romfs.h"
 #include "title.h"
 
-#define BFSAR_FILENAME      "qlaunch.bfsar"
-#define BFSAR_ROMFS_PATH    "/sound/" BFSAR_FILENAME
+#define BFSAR_FILENAME              "qlaunch.bfsar"
+#define BFSAR_ROMFS_PATH            "/sound/" BFSAR_FILENAME
+
+#define BFSAR_VERSION_FILENAME      BFSAR_FILENAME ".ver"
 
 /* Global variables. */
 
@@ -33,6 +35,12 @@ static Mutex g_bfsarMutex = 0;
 static bool g_bfsarInterfaceInit = false;
 
 static char g_bfsarPath[FS_MAX_PATH] = {0};
+static char g_bfsarVersionPath[FS_MAX_PATH] = {0};
+
+/* Function prototypes. */
+
+static bool bfsarIsCachedVersionCurrent(void);
+static void bfsarSaveCachedVersion(void);
 
 bool bfsarInitialize(void)
 {
@@ -68,26 +76,37 @@ bool bfsarInitialize(void)
             {
                 /* Create BFSAR file in the current working directory. */
                 snprintf(g_bfsarPath, sizeof(g_bfsarPath), "%.*s" BFSAR_FILENAME, (int)((ptr2 - ptr1) + 1), ptr1);
+                snprintf(g_bfsarVersionPath, sizeof(g_bfsarVersionPath), "%.*s" BFSAR_VERSION_FILENAME, (int)((ptr2 - ptr1) + 1), ptr1);
                 use_root = false;
             }
         }
 
         /* Create BFSAR file in the SD card root directory. */
-        if (use_root) sprintf(g_bfsarPath, "/" BFSAR_FILENAME);
+        if (use_root)
+        {
+            sprintf(g_bfsarPath, "/" BFSAR_FILENAME);
+            sprintf(g_bfsarVersionPath, "/" BFSAR_VERSION_FILENAME);
+        }
 
         LOG_MSG_DEBUG("BFSAR path: \"%s\".", g_bfsarPath);
 
-        /* Check if the BFSAR file is already available and not empty. */
+        /* Check if the BFSAR file is already available, not empty and extracted under the current firmware version. */
+        /* qlaunch's sound archive changes across firmware updates, so a stale extraction must be redone. */
         bfsar_file = fopen(g_bfsarPath, "rb");
         if (bfsar_file)
         {
             fseek(bfsar_file, 0, SEEK_END);
             bfsar_size = ftell(bfsar_file);
-            if (bfsar_size)
+            if (bfsar_size && bfsarIsCachedVersionCurrent())
             {
                 ret = g_bfsarInterfaceInit = true;
                 break;
             }
+
+            /* Close the stale BFSAR file - it gets re-extracted below. */
+            fclose(bfsar_file);
+            bfsar_file = NULL;
+            bfsar_size = 0;
         }
 
         /* Get title info. */
@@ -98,7 +117,7 @@ bool bfsarInitialize(void)
         }
 
         /* Allocate memory for a temporary NCA context. */
-        nca_ctx = calloc(1, sizeof(NcaContext));
+        nca_ctx = ncaAllocateContexts(1);
         if (!nca_ctx)
         {
             LOG_MSG_ERROR("Failed to allocate memory for temporary NCA context!");
@@ -164,6 +183,9 @@ bool bfsarInitialize(void)
             break;
         }
 
+        /* Save the firmware version the BFSAR file was extracted under. */
+        bfsarSaveCachedVersion();
+
         /* Update flags. */
         ret = g_bfsarInterfaceInit = true;
     }
@@ -180,7 +202,7 @@ bool bfsarInitialize(void)
 
     romfsFreeContext(&romfs_ctx);
 
-    if (nca_ctx) free(nca_ctx);
+    if (nca_ctx) ncaFreeContexts(nca_ctx, 1);
 
     titleFreeTitleInfo(&title_info);
 
@@ -191,12 +213,56 @@ void bfsarExit(void)
 {
     SCOPED_LOCK(&g_bfsarMutex)
     {
-        /* Clear BFSAR file path. */
-        *g_bfsarPath = '\0';
+        /* Clear BFSAR file paths. */
+        *g_bfsarPath = *g_bfsarVersionPath = '\0';
         g_bfsarInterfaceInit = false;
     }
 }
 
+static bool bfsarIsCachedVersionCurrent(void)
+{
+    FILE *version_file = NULL;
+    u32 cached_version = 0;
+    bool ret = false;
+
+    /* Open version sidecar file. It won't exist for extractions performed by previous application versions - those simply get redone once. */
+    version_file = fopen(g_bfsarVersionPath, "rb");
+    if (!version_file) return false;
+
+    /* Read and compare cached firmware version. */
+    ret = (fread(&cached_version, 1, sizeof(cached_version), version_file) == sizeof(cached_version) && cached_version == hosversionGet());
+    if (!ret) LOG_MSG_INFO("Cached BFSAR file was extracted under a different firmware version (0x%08X). Discarding it.", cached_version);
+
+    fclose(version_file);
+
+    return ret;
+}
+
+static void bfsarSaveCachedVersion(void)
+{
+    FILE *version_file = NULL;
+    u32 cur_version = hosversionGet();
+
+    /* Open version sidecar file. */
+    version_file = fopen(g_bfsarVersionPath, "wb");
+    if (!version_file)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\" for writing!", g_bfsarVersionPath);
+        return;
+    }
+
+    /* Write current firmware version. Get rid of the sidecar file on failure - the BFSAR file just gets re-extracted on the next launch. */
+    if (fwrite(&cur_version, 1, sizeof(cur_version), version_file) != sizeof(cur_version))
+    {
+        LOG_MSG_ERROR("Failed to write firmware version to \"%s\"!", g_bfsarVersionPath);
+        fclose(version_file);
+        remove(g_bfsarVersionPath);
+        return;
+    }
+
+    fclose(version_file);
+}
+
 const char *bfsarGetFilePath(void)
 {
     const char *ret = NULL;
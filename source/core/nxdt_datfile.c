@@ -0,0 +1,538 @@
+/*
+ * nxdt_datfile.c
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "nxdt_utils.h"
+#include "nxdt_datfile.h"
+
+#define DATFILE_CACHE_MAGIC         0x4E584449                  /* "NXDI". */
+#define DATFILE_CACHE_VERSION       1
+
+#define DATFILE_MAX_ENTRY_COUNT     0x100000                    /* 1048576 entries. Sanity cap for cache headers. */
+#define DATFILE_MAX_NAME_TABLE_SIZE 0x4000000                   /* 64 MiB. Sanity cap for cache headers. */
+
+#define DATFILE_XML_ATTR_LENGTH     0x200
+
+/* Type definitions. */
+
+/// Header for the binary cache generated from a parsed datfile.
+/// The entry table immediately follows the header, sorted by CRC32 checksum in ascending order. The name string table is placed right after the entry table.
+typedef struct {
+    u32 magic;          ///< "NXDI".
+    u32 version;        ///< DATFILE_CACHE_VERSION.
+    u32 entry_count;    ///< Number of entries within the entry table.
+    u32 name_table_size;    ///< Size of the name string table, in bytes.
+    u64 dat_size;       ///< Size of the source datfile, in bytes. Used to detect stale caches.
+} DatfileCacheHeader;
+
+NXDT_ASSERT(DatfileCacheHeader, 0x18);
+
+/// Represents a single "rom" element from a parsed datfile.
+typedef struct {
+    u32 crc;            ///< CRC32 checksum retrieved from the "crc" attribute.
+    u32 name_offset;    ///< Offset of the parent release name within the name string table.
+    u64 size;           ///< Data size retrieved from the "size" attribute, in bytes.
+} DatfileCacheEntry;
+
+NXDT_ASSERT(DatfileCacheEntry, 0x10);
+
+/* Global variables. */
+
+static Mutex g_datfileMutex = 0;
+static bool g_datfileInterfaceInit = false;
+
+static DatfileCacheEntry *g_datfileEntries = NULL;
+static u32 g_datfileEntryCount = 0;
+
+static char *g_datfileNameTable = NULL;
+static u32 g_datfileNameTableSize = 0;
+
+/* Function prototypes. */
+
+static bool datfileLoadCache(u64 dat_size);
+static bool datfileBuildCache(u64 dat_size);
+static bool datfileSaveCache(u64 dat_size);
+static void datfileFreeLookupTable(void);
+
+static bool datfileGetFileSize(const char *path, u64 *out_size);
+static char *datfileFindXmlElement(char *ptr, const char *name);
+static bool datfileGetXmlAttribute(const char *element, const char *name, char *out, size_t out_size);
+
+static int datfileCacheEntrySortFunction(const void *a, const void *b);
+
+bool datfileInitialize(void)
+{
+    bool ret = false;
+
+    SCOPED_LOCK(&g_datfileMutex)
+    {
+        ret = g_datfileInterfaceInit;
+        if (ret) break;
+
+        /* Retrieve datfile size. It doubles as our staleness check for a previously generated cache. */
+        u64 dat_size = 0;
+        if (!datfileGetFileSize(NOINTRO_DAT_PATH, &dat_size) || !dat_size)
+        {
+            LOG_MSG_DEBUG("No datfile available at \"%s\".", NOINTRO_DAT_PATH);
+            break;
+        }
+
+        /* Load the binary cache generated by a previous session, if possible. Otherwise, parse the datfile and generate a new cache. */
+        /* Datfiles are tens of MiB of XML, so the full parse is only ever paid once per datfile update. */
+        if (!datfileLoadCache(dat_size) && !datfileBuildCache(dat_size)) break;
+
+        ret = g_datfileInterfaceInit = true;
+    }
+
+    return ret;
+}
+
+void datfileExit(void)
+{
+    SCOPED_LOCK(&g_datfileMutex)
+    {
+        datfileFreeLookupTable();
+        g_datfileInterfaceInit = false;
+    }
+}
+
+u32 datfileGetEntryCount(void)
+{
+    u32 ret = 0;
+    SCOPED_LOCK(&g_datfileMutex) ret = (g_datfileInterfaceInit ? g_datfileEntryCount : 0);
+    return ret;
+}
+
+bool datfileLookupCrc32(u32 crc, u64 size, const char **out_name)
+{
+    bool ret = false;
+
+    SCOPED_LOCK(&g_datfileMutex)
+    {
+        if (!g_datfileInterfaceInit || !g_datfileEntryCount) break;
+
+        /* Binary search over the sorted entry table. */
+        u32 lo = 0, hi = (g_datfileEntryCount - 1);
+
+        while(lo < hi)
+        {
+            u32 mid = (lo + ((hi - lo) / 2));
+
+            if (g_datfileEntries[mid].crc < crc)
+            {
+                lo = (mid + 1);
+            } else {
+                hi = mid;
+            }
+        }
+
+        /* Walk all entries sharing the requested checksum. */
+        for(u32 i = lo; i < g_datfileEntryCount && g_datfileEntries[i].crc == crc; i++)
+        {
+            if (size && g_datfileEntries[i].size != size) continue;
+            if (out_name) *out_name = (g_datfileNameTable + g_datfileEntries[i].name_offset);
+            ret = true;
+            break;
+        }
+    }
+
+    return ret;
+}
+
+static bool datfileLoadCache(u64 dat_size)
+{
+    FILE *fp = NULL;
+    DatfileCacheHeader header = {0};
+    bool success = false;
+
+    fp = fopen(NOINTRO_DAT_CACHE_PATH, "rb");
+    if (!fp) return false;
+
+    /* Read and validate the cache header. */
+    if (fread(&header, 1, sizeof(DatfileCacheHeader), fp) != sizeof(DatfileCacheHeader) || header.magic != DATFILE_CACHE_MAGIC || header.version != DATFILE_CACHE_VERSION || \
+        !header.entry_count || header.entry_count > DATFILE_MAX_ENTRY_COUNT || !header.name_table_size || header.name_table_size > DATFILE_MAX_NAME_TABLE_SIZE || \
+        header.dat_size != dat_size)
+    {
+        LOG_MSG_DEBUG("Invalid or stale datfile cache at \"%s\".", NOINTRO_DAT_CACHE_PATH);
+        goto end;
+    }
+
+    /* Allocate memory for the lookup table. */
+    g_datfileEntries = malloc(header.entry_count * sizeof(DatfileCacheEntry));
+    g_datfileNameTable = malloc(header.name_table_size);
+    if (!g_datfileEntries || !g_datfileNameTable)
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the datfile lookup table!");
+        goto end;
+    }
+
+    /* Read both tables. They were written in this exact layout, so no per-entry fixups are needed. */
+    if (fread(g_datfileEntries, 1, header.entry_count * sizeof(DatfileCacheEntry), fp) != (header.entry_count * sizeof(DatfileCacheEntry)) || \
+        fread(g_datfileNameTable, 1, header.name_table_size, fp) != header.name_table_size)
+    {
+        LOG_MSG_ERROR("Failed to read datfile cache tables from \"%s\"!", NOINTRO_DAT_CACHE_PATH);
+        goto end;
+    }
+
+    /* Make sure the name string table is properly terminated and that all name offsets are in range. */
+    if (g_datfileNameTable[header.name_table_size - 1] != '\0')
+    {
+        LOG_MSG_ERROR("Datfile cache name string table isn't properly terminated!");
+        goto end;
+    }
+
+    for(u32 i = 0; i < header.entry_count; i++)
+    {
+        if (g_datfileEntries[i].name_offset >= header.name_table_size)
+        {
+            LOG_MSG_ERROR("Datfile cache entry #%u points past the name string table!", i);
+            goto end;
+        }
+    }
+
+    g_datfileEntryCount = header.entry_count;
+    g_datfileNameTableSize = header.name_table_size;
+
+    LOG_MSG_DEBUG("Loaded datfile cache with %u entries.", g_datfileEntryCount);
+
+    success = true;
+
+end:
+    if (!success) datfileFreeLookupTable();
+
+    fclose(fp);
+
+    return success;
+}
+
+static bool datfileBuildCache(u64 dat_size)
+{
+    FILE *fp = NULL;
+    char *xml_buf = NULL;
+
+    u32 entry_capacity = 0, name_table_capacity = 0;
+    char name[DATFILE_XML_ATTR_LENGTH] = {0}, attr[DATFILE_XML_ATTR_LENGTH] = {0};
+
+    bool success = false;
+
+    /* Read the whole datfile into memory. Streaming the parse would be possible, but this path only ever runs once per datfile update. */
+    fp = fopen(NOINTRO_DAT_PATH, "rb");
+    if (!fp)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\"!", NOINTRO_DAT_PATH);
+        return false;
+    }
+
+    xml_buf = malloc(dat_size + 1);
+    if (!xml_buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate 0x%lX bytes for the datfile!", dat_size + 1);
+        goto end;
+    }
+
+    if (fread(xml_buf, 1, dat_size, fp) != dat_size)
+    {
+        LOG_MSG_ERROR("Failed to read 0x%lX bytes from \"%s\"!", dat_size, NOINTRO_DAT_PATH);
+        goto end;
+    }
+
+    xml_buf[dat_size] = '\0';
+
+    /* Walk all "game" elements from the datfile. */
+    char *game = xml_buf;
+    while((game = datfileFindXmlElement(game, "game")) != NULL)
+    {
+        /* Retrieve the release name. */
+        if (!datfileGetXmlAttribute(game, "name", name, sizeof(name))) continue;
+
+        /* Determine where this game element ends, so rom elements from different games aren't mixed up. */
+        char *game_end = strstr(game, "</game>");
+        u32 name_offset = 0;
+        bool name_added = false;
+
+        /* Walk all "rom" elements within this game element. */
+        char *rom = game;
+        while((rom = datfileFindXmlElement(rom, "rom")) != NULL && (!game_end || rom < game_end))
+        {
+            /* Retrieve the CRC32 checksum and data size for this rom element. */
+            if (!datfileGetXmlAttribute(rom, "crc", attr, sizeof(attr))) continue;
+            u32 crc = (u32)strtoul(attr, NULL, 16);
+
+            if (!datfileGetXmlAttribute(rom, "size", attr, sizeof(attr))) continue;
+            u64 size = strtoull(attr, NULL, 10);
+
+            /* Add the release name to the name string table. It's shared by every rom element from this game element. */
+            if (!name_added)
+            {
+                u32 name_size = (u32)(strlen(name) + 1);
+
+                if ((g_datfileNameTableSize + name_size) > name_table_capacity)
+                {
+                    u32 new_capacity = (name_table_capacity ? (name_table_capacity * 2) : 0x10000);
+                    while(new_capacity < (g_datfileNameTableSize + name_size)) new_capacity *= 2;
+
+                    char *tmp = realloc(g_datfileNameTable, new_capacity);
+                    if (!tmp)
+                    {
+                        LOG_MSG_ERROR("Failed to reallocate datfile name string table!");
+                        goto end;
+                    }
+
+                    g_datfileNameTable = tmp;
+                    name_table_capacity = new_capacity;
+                }
+
+                name_offset = g_datfileNameTableSize;
+                memcpy(g_datfileNameTable + name_offset, name, name_size);
+                g_datfileNameTableSize += name_size;
+
+                name_added = true;
+            }
+
+            /* Add a new entry to the entry table. */
+            if (g_datfileEntryCount >= entry_capacity)
+            {
+                u32 new_capacity = (entry_capacity ? (entry_capacity * 2) : 0x1000);
+
+                DatfileCacheEntry *tmp = realloc(g_datfileEntries, new_capacity * sizeof(DatfileCacheEntry));
+                if (!tmp)
+                {
+                    LOG_MSG_ERROR("Failed to reallocate datfile entry table!");
+                    goto end;
+                }
+
+                g_datfileEntries = tmp;
+                entry_capacity = new_capacity;
+            }
+
+            DatfileCacheEntry *entry = &(g_datfileEntries[g_datfileEntryCount++]);
+            entry->crc = crc;
+            entry->name_offset = name_offset;
+            entry->size = size;
+        }
+    }
+
+    if (!g_datfileEntryCount || !g_datfileNameTableSize)
+    {
+        LOG_MSG_ERROR("Unable to parse any entries from \"%s\"!", NOINTRO_DAT_PATH);
+        goto end;
+    }
+
+    /* Sort the entry table by CRC32 checksum, which makes lookups a binary search instead of a scan over the whole datfile. */
+    qsort(g_datfileEntries, g_datfileEntryCount, sizeof(DatfileCacheEntry), &datfileCacheEntrySortFunction);
+
+    LOG_MSG_INFO("Parsed %u entries from \"%s\".", g_datfileEntryCount, NOINTRO_DAT_PATH);
+
+    /* Save the generated lookup table, so subsequent sessions can skip the XML parse entirely. Not a critical error if it fails. */
+    if (!datfileSaveCache(dat_size)) LOG_MSG_ERROR("Failed to save datfile cache to \"%s\"!", NOINTRO_DAT_CACHE_PATH);
+
+    success = true;
+
+end:
+    if (!success) datfileFreeLookupTable();
+
+    if (xml_buf) free(xml_buf);
+
+    fclose(fp);
+
+    return success;
+}
+
+static bool datfileSaveCache(u64 dat_size)
+{
+    FILE *fp = NULL;
+    bool success = false;
+
+    DatfileCacheHeader header = {
+        .magic = DATFILE_CACHE_MAGIC,
+        .version = DATFILE_CACHE_VERSION,
+        .entry_count = g_datfileEntryCount,
+        .name_table_size = g_datfileNameTableSize,
+        .dat_size = dat_size
+    };
+
+    fp = fopen(NOINTRO_DAT_CACHE_PATH, "wb");
+    if (!fp)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\" for writing!", NOINTRO_DAT_CACHE_PATH);
+        return false;
+    }
+
+    success = (fwrite(&header, 1, sizeof(DatfileCacheHeader), fp) == sizeof(DatfileCacheHeader) && \
+               fwrite(g_datfileEntries, 1, g_datfileEntryCount * sizeof(DatfileCacheEntry), fp) == (g_datfileEntryCount * sizeof(DatfileCacheEntry)) && \
+               fwrite(g_datfileNameTable, 1, g_datfileNameTableSize, fp) == g_datfileNameTableSize);
+
+    fclose(fp);
+
+    if (!success) remove(NOINTRO_DAT_CACHE_PATH);
+
+    utilsCommitSdCardFileSystemChanges();
+
+    return success;
+}
+
+static void datfileFreeLookupTable(void)
+{
+    if (g_datfileEntries)
+    {
+        free(g_datfileEntries);
+        g_datfileEntries = NULL;
+    }
+
+    g_datfileEntryCount = 0;
+
+    if (g_datfileNameTable)
+    {
+        free(g_datfileNameTable);
+        g_datfileNameTable = NULL;
+    }
+
+    g_datfileNameTableSize = 0;
+}
+
+static bool datfileGetFileSize(const char *path, u64 *out_size)
+{
+    if (!path || !*path || !out_size) return false;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+
+    if (size < 0) return false;
+
+    *out_size = (u64)size;
+
+    return true;
+}
+
+/* Returns a pointer to the character right after the opening tag name for the first element matching 'name', or NULL if no match is found. */
+static char *datfileFindXmlElement(char *ptr, const char *name)
+{
+    size_t name_len = strlen(name);
+
+    while((ptr = strchr(ptr, '<')) != NULL)
+    {
+        ptr++;
+
+        /* Make sure the tag name matches on its own, instead of being a prefix of a longer name (e.g. "rom" vs "romof"). */
+        if (!strncmp(ptr, name, name_len) && (ptr[name_len] == ' ' || ptr[name_len] == '>' || ptr[name_len] == '/' || ptr[name_len] == '\t' || ptr[name_len] == '\r' || \
+            ptr[name_len] == '\n')) return (ptr + name_len);
+    }
+
+    return NULL;
+}
+
+/* Retrieves the value from the attribute matching 'name' within the current element tag and stores it in 'out'. */
+/* Only the basic XML entities used by datfile release names are decoded. */
+static bool datfileGetXmlAttribute(const char *element, const char *name, char *out, size_t out_size)
+{
+    size_t name_len = strlen(name);
+
+    const char *tag_end = strchr(element, '>');
+    if (!tag_end) return false;
+
+    const char *ptr = element;
+
+    while(ptr < tag_end)
+    {
+        /* Find the next attribute name. */
+        while(ptr < tag_end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n')) ptr++;
+
+        const char *attr_name = ptr;
+        while(ptr < tag_end && *ptr != '=' && *ptr != ' ') ptr++;
+        if (ptr >= tag_end || *ptr != '=' || *(ptr + 1) != '"') return false;
+
+        size_t attr_name_len = (size_t)(ptr - attr_name);
+
+        /* Find the end of the quoted attribute value. */
+        const char *value = (ptr + 2);
+        const char *value_end = strchr(value, '"');
+        if (!value_end || value_end > tag_end) return false;
+
+        ptr = (value_end + 1);
+
+        if (attr_name_len != name_len || strncmp(attr_name, name, name_len) != 0) continue;
+
+        /* Copy the attribute value, decoding XML entities along the way. */
+        size_t out_len = 0;
+
+        while(value < value_end && out_len < (out_size - 1))
+        {
+            if (*value == '&')
+            {
+                if (!strncmp(value, "&amp;", 5))
+                {
+                    out[out_len++] = '&';
+                    value += 5;
+                    continue;
+                } else
+                if (!strncmp(value, "&quot;", 6))
+                {
+                    out[out_len++] = '"';
+                    value += 6;
+                    continue;
+                } else
+                if (!strncmp(value, "&apos;", 6))
+                {
+                    out[out_len++] = '\'';
+                    value += 6;
+                    continue;
+                } else
+                if (!strncmp(value, "&lt;", 4))
+                {
+                    out[out_len++] = '<';
+                    value += 4;
+                    continue;
+                } else
+                if (!strncmp(value, "&gt;", 4))
+                {
+                    out[out_len++] = '>';
+                    value += 4;
+                    continue;
+                }
+            }
+
+            out[out_len++] = *(value++);
+        }
+
+        out[out_len] = '\0';
+
+        return (out_len > 0);
+    }
+
+    return false;
+}
+
+static int datfileCacheEntrySortFunction(const void *a, const void *b)
+{
+    const DatfileCacheEntry *entry_1 = (const DatfileCacheEntry*)a;
+    const DatfileCacheEntry *entry_2 = (const DatfileCacheEntry*)b;
+
+    if (entry_1->crc < entry_2->crc) return -1;
+    if (entry_1->crc > entry_2->crc) return 1;
+
+    if (entry_1->size < entry_2->size) return -1;
+    if (entry_1->size > entry_2->size) return 1;
+
+    return 0;
+}
@@ -23,21 +23,52 @@
 
 #if (LOG_LEVEL >= LOG_LEVEL_DEBUG) && (LOG_LEVEL < LOG_LEVEL_NONE)
 
+#define LOG_FLUSH_INTERVAL      1000000000ULL       /* 1 second. */
+#define LOG_BUF_WATERMARK       (LOG_BUF_SIZE / 2)  /* Log buffer usage level at which the flush thread is woken up early. */
+
 /* Global variables. */
 
 static Mutex g_logMutex = 0;
+static CondVar g_logCondVar = 0;
 
 static char g_lastLogMsg[0x100] = {0};
 
 static FsFile g_logFile = {0};
 static s64 g_logFileOffset = 0;
 
-static char *g_logBuffer = NULL;
+static char *g_logBuffer = NULL, *g_logFlushBuffer = NULL;
 static size_t g_logBufferLength = 0;
+static bool g_logFlushInProgress = false;
+
+static Thread g_logFlushThread = {0};
+static UEvent g_logFlushEvent = {0}, g_logFlushThreadExitEvent = {0};
+static bool g_logFlushThreadCreated = false;
 
 static const char *g_logStrFormat = "[%d-%02d-%02d %02d:%02d:%02d.%09lu] [%s] %s:%d:%s -> ";
 static const char *g_logSessionSeparator = "________________________________________________________________\r\n";
 
+/* Chrome-trace sink. */
+
+static Mutex g_traceMutex = 0;
+
+static FsFile g_traceFile = {0};
+static s64 g_traceFileOffset = 0;
+
+static char *g_traceBuffer = NULL;
+static size_t g_traceBufferLength = 0;
+
+static bool g_traceFileOpened = false, g_traceFirstEvent = true;
+
+/* Crash report sink. */
+
+static Mutex g_crashReportMutex = 0;
+
+static FsFile g_crashReportFile = {0};
+static s64 g_crashReportFileOffset = 0;
+
+static char g_crashReportFilePath[FS_MAX_PATH] = {0};
+static bool g_crashReportFileOpened = false;
+
 static const char *g_logLevelNames[] = {
     [LOG_LEVEL_DEBUG]   = "DEBUG",
     [LOG_LEVEL_INFO]    = "INFO",
@@ -52,11 +83,21 @@ static void _logWriteFormattedStringToLogFile(bool save, u8 level, const char *f
 
 static void _logFlushLogFile(void);
 
+static bool logEnsureLogBufferSpace(size_t size);
+static void logAppendStringToLogBuffer(const char *src, size_t src_len);
+
+static bool logCreateFlushThread(void);
+static void logDestroyFlushThread(void);
+static void logFlushThreadFunc(void *arg);
+
 static bool logAllocateLogBuffer(void);
 static bool logOpenLogFile(void);
 
 static void logWriteStringToNxLink(const char *str);
 
+static void _logWriteTraceEvent(const char *event);
+static void _logFlushTraceFile(void);
+
 void logWriteStringToLogFile(const char *src)
 {
     SCOPED_LOCK(&g_logMutex) _logWriteStringToLogFile(src);
@@ -168,14 +209,30 @@ end:
 
 void logFlushLogFile(void)
 {
-    SCOPED_LOCK(&g_logMutex) _logFlushLogFile();
+    SCOPED_LOCK(&g_logMutex)
+    {
+        if (g_logFlushThreadCreated)
+        {
+            /* Wake up the flush thread and wait until all buffered data has hit the SD card. */
+            while(g_logBufferLength || g_logFlushInProgress)
+            {
+                ueventSignal(&g_logFlushEvent);
+                condvarWaitTimeout(&g_logCondVar, &g_logMutex, LOG_FLUSH_INTERVAL);
+            }
+        } else {
+            _logFlushLogFile();
+        }
+    }
 }
 
 void logCloseLogFile(void)
 {
+    /* Destroy the flush thread. It takes care of flushing any buffered data before exiting. */
+    logDestroyFlushThread();
+
     SCOPED_LOCK(&g_logMutex)
     {
-        /* Flush log buffer. */
+        /* Flush any log buffer contents generated after the flush thread was destroyed. */
         _logFlushLogFile();
 
         /* Close logfile. */
@@ -188,13 +245,19 @@ void logCloseLogFile(void)
             utilsCommitSdCardFileSystemChanges();
         }
 
-        /* Free log buffer. */
+        /* Free log buffers. */
         if (g_logBuffer)
         {
             free(g_logBuffer);
             g_logBuffer = NULL;
         }
 
+        if (g_logFlushBuffer)
+        {
+            free(g_logFlushBuffer);
+            g_logFlushBuffer = NULL;
+        }
+
         /* Reset logfile offset. */
         g_logFileOffset = 0;
     }
@@ -222,50 +285,246 @@ void logControlMutex(bool lock)
     }
 }
 
-static void _logWriteStringToLogFile(const char *src)
+bool logOpenTraceFile(void)
 {
-    /* Make sure we have allocated memory for the log buffer and opened the logfile. */
-    if (!src || !*src || !logAllocateLogBuffer() || !logOpenLogFile()) return;
-
-    Result rc = 0;
-    size_t src_len = strlen(src), tmp_len = 0;
+    bool ret = false;
 
-    /* Check if the formatted string length is lower than the log buffer size. */
-    if (src_len < LOG_BUF_SIZE)
+    SCOPED_LOCK(&g_traceMutex)
     {
-        /* Flush log buffer contents (if needed). */
-        if ((g_logBufferLength + src_len) >= LOG_BUF_SIZE)
+        if (g_traceFileOpened)
         {
-            _logFlushLogFile();
-            if (g_logBufferLength) return;
+            ret = true;
+            break;
         }
 
-        /* Copy string into the log buffer. */
-        strcpy(g_logBuffer + g_logBufferLength, src);
-        g_logBufferLength += src_len;
-    } else {
-        /* Flush log buffer. */
-        _logFlushLogFile();
-        if (g_logBufferLength) return;
+        Result rc = 0;
+        bool use_root = true;
+        const char *launch_path = utilsGetLaunchPath();
+        char path[FS_MAX_PATH] = {0}, *ptr1 = NULL, *ptr2 = NULL;
+
+        /* Get SD card FsFileSystem object. */
+        FsFileSystem *sdmc_fs = utilsGetSdCardFileSystemObject();
+        if (!sdmc_fs) break;
 
-        /* Write string data until it no longer exceeds the log buffer size. */
-        while(src_len >= LOG_BUF_SIZE)
+        /* Allocate trace buffer. */
+        if (!g_traceBuffer)
         {
-            rc = fsFileWrite(&g_logFile, g_logFileOffset, src + tmp_len, LOG_BUF_SIZE, FsWriteOption_Flush);
-            if (R_FAILED(rc)) return;
+            g_traceBuffer = malloc(TRACE_BUF_SIZE);
+            if (!g_traceBuffer) break;
+        }
+
+        /* Generate trace file path. The trace file is placed next to the logfile. */
+        if (launch_path)
+        {
+            ptr1 = strchr(launch_path, '/');
+            ptr2 = strrchr(launch_path, '/');
+
+            if (ptr1 && ptr2 && ptr1 != ptr2)
+            {
+                /* Create trace file in the current working directory. */
+                snprintf(path, sizeof(path), "%.*s" TRACE_FILE_NAME, (int)((ptr2 - ptr1) + 1), ptr1);
+                use_root = false;
+            }
+        }
+
+        /* Create trace file in the SD card root directory. */
+        if (use_root) sprintf(path, "/" TRACE_FILE_NAME);
+
+        /* Delete any trace file from a previous session. Unlike the logfile, a trace timeline always covers a single session. */
+        fsFsDeleteFile(sdmc_fs, path);
+
+        /* Create file. */
+        rc = fsFsCreateFile(sdmc_fs, path, 0, 0);
+        if (R_FAILED(rc)) break;
+
+        /* Open file. */
+        rc = fsFsOpenFile(sdmc_fs, path, FsOpenMode_Write | FsOpenMode_Append, &g_traceFile);
+        if (R_FAILED(rc)) break;
+
+        /* Reset trace state and write the timeline header. */
+        g_traceFileOffset = 0;
+        g_traceFirstEvent = true;
+        g_traceFileOpened = true;
+
+        sprintf(g_traceBuffer, "[" CRLF);
+        g_traceBufferLength = strlen(g_traceBuffer);
+
+        ret = true;
+    }
+
+    return ret;
+}
+
+void logWriteTraceThreadName(u32 tid, const char *name)
+{
+    if (!name || !*name) return;
 
-            g_logFileOffset += LOG_BUF_SIZE;
-            tmp_len += LOG_BUF_SIZE;
-            src_len -= LOG_BUF_SIZE;
+    char event[0x100] = {0};
+    snprintf(event, sizeof(event), "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}", tid, name);
+
+    SCOPED_LOCK(&g_traceMutex) _logWriteTraceEvent(event);
+}
+
+void logWriteTraceDurationEvent(const char *name, u32 tid, u64 start_ns, u64 duration_ns)
+{
+    if (!name || !*name) return;
+
+    /* Trace timestamps are expressed in microseconds. Use the fractional part to preserve nanosecond precision. */
+    char event[0x100] = {0};
+    snprintf(event, sizeof(event), "{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%lu.%03lu,\"dur\":%lu.%03lu}", tid, name, start_ns / 1000, start_ns % 1000, \
+             duration_ns / 1000, duration_ns % 1000);
+
+    SCOPED_LOCK(&g_traceMutex) _logWriteTraceEvent(event);
+}
+
+void logWriteTraceCounterEvent(const char *name, u64 timestamp_ns, u64 value)
+{
+    if (!name || !*name) return;
+
+    char event[0x100] = {0};
+    snprintf(event, sizeof(event), "{\"ph\":\"C\",\"pid\":1,\"name\":\"%s\",\"ts\":%lu.%03lu,\"args\":{\"value\":%lu}}", name, timestamp_ns / 1000, timestamp_ns % 1000, value);
+
+    SCOPED_LOCK(&g_traceMutex) _logWriteTraceEvent(event);
+}
+
+void logCloseTraceFile(void)
+{
+    SCOPED_LOCK(&g_traceMutex)
+    {
+        if (!g_traceFileOpened) break;
+
+        /* Terminate the JSON timeline, then flush any buffered trace data. */
+        /* The closing bracket always fits - _logWriteTraceEvent() never lets the trace buffer fill up completely. */
+        sprintf(g_traceBuffer + g_traceBufferLength, CRLF "]" CRLF);
+        g_traceBufferLength += strlen(g_traceBuffer + g_traceBufferLength);
+
+        _logFlushTraceFile();
+
+        /* Close trace file. */
+        fsFileClose(&g_traceFile);
+        memset(&g_traceFile, 0, sizeof(FsFile));
+
+        /* Commit SD card filesystem changes. */
+        utilsCommitSdCardFileSystemChanges();
+
+        /* Free trace buffer. */
+        free(g_traceBuffer);
+        g_traceBuffer = NULL;
+        g_traceBufferLength = 0;
+
+        /* Reset trace state. */
+        g_traceFileOffset = 0;
+        g_traceFileOpened = false;
+        g_traceFirstEvent = true;
+    }
+}
+
+bool logOpenCrashReportFile(void)
+{
+    bool ret = false;
+
+    SCOPED_LOCK(&g_crashReportMutex)
+    {
+        if (g_crashReportFileOpened)
+        {
+            ret = true;
+            break;
         }
 
-        /* Copy any remaining data from the string into the log buffer. */
-        if (src_len)
+        Result rc = 0;
+        bool use_root = true;
+        const char *launch_path = utilsGetLaunchPath();
+        char *ptr1 = NULL, *ptr2 = NULL;
+
+        /* Get SD card FsFileSystem object. */
+        FsFileSystem *sdmc_fs = utilsGetSdCardFileSystemObject();
+        if (!sdmc_fs) break;
+
+        /* Generate crash report file path. The crash report file is placed next to the logfile. */
+        if (launch_path)
         {
-            strcpy(g_logBuffer, src + tmp_len);
-            g_logBufferLength = src_len;
+            ptr1 = strchr(launch_path, '/');
+            ptr2 = strrchr(launch_path, '/');
+
+            if (ptr1 && ptr2 && ptr1 != ptr2)
+            {
+                /* Create crash report file in the current working directory. */
+                snprintf(g_crashReportFilePath, sizeof(g_crashReportFilePath), "%.*s" CRASH_REPORT_FILE_NAME, (int)((ptr2 - ptr1) + 1), ptr1);
+                use_root = false;
+            }
         }
+
+        /* Create crash report file in the SD card root directory. */
+        if (use_root) sprintf(g_crashReportFilePath, "/" CRASH_REPORT_FILE_NAME);
+
+        /* Delete any crash report file from a previous session. */
+        fsFsDeleteFile(sdmc_fs, g_crashReportFilePath);
+
+        /* Create file. */
+        rc = fsFsCreateFile(sdmc_fs, g_crashReportFilePath, 0, 0);
+        if (R_FAILED(rc)) break;
+
+        /* Open file and keep the handle around for the rest of the session. */
+        rc = fsFsOpenFile(sdmc_fs, g_crashReportFilePath, FsOpenMode_Write | FsOpenMode_Append, &g_crashReportFile);
+        if (R_FAILED(rc)) break;
+
+        g_crashReportFileOffset = 0;
+        g_crashReportFileOpened = true;
+
+        ret = true;
+    }
+
+    return ret;
+}
+
+void logWriteCrashReportString(const char *str)
+{
+    if (!str || !*str) return;
+
+    SCOPED_LOCK(&g_crashReportMutex)
+    {
+        if (!g_crashReportFileOpened) break;
+
+        /* Write string to the preopened crash report file and flush it right away. */
+        size_t str_len = strlen(str);
+        Result rc = fsFileWrite(&g_crashReportFile, g_crashReportFileOffset, str, str_len, FsWriteOption_Flush);
+        if (R_SUCCEEDED(rc)) g_crashReportFileOffset += (s64)str_len;
     }
+}
+
+void logCloseCrashReportFile(void)
+{
+    SCOPED_LOCK(&g_crashReportMutex)
+    {
+        if (!g_crashReportFileOpened) break;
+
+        /* Close crash report file. */
+        fsFileClose(&g_crashReportFile);
+        memset(&g_crashReportFile, 0, sizeof(FsFile));
+
+        /* Delete the crash report file if nothing was written to it during the current session. */
+        FsFileSystem *sdmc_fs = utilsGetSdCardFileSystemObject();
+        if (!g_crashReportFileOffset && sdmc_fs) fsFsDeleteFile(sdmc_fs, g_crashReportFilePath);
+
+        /* Commit SD card filesystem changes. */
+        utilsCommitSdCardFileSystemChanges();
+
+        /* Reset crash report state. */
+        g_crashReportFileOffset = 0;
+        g_crashReportFileOpened = false;
+    }
+}
+
+static void _logWriteStringToLogFile(const char *src)
+{
+    /* Make sure we have allocated memory for the log buffers and opened the logfile. */
+    if (!src || !*src || !logAllocateLogBuffer() || !logOpenLogFile()) return;
+
+    /* Create the flush thread. Logging falls back to synchronous flushes if this fails. */
+    logCreateFlushThread();
+
+    /* Copy string into the log buffer. */
+    logAppendStringToLogBuffer(src, strlen(src));
 
     /* Write data to nxlink. */
     logWriteStringToNxLink(src);
@@ -278,10 +537,11 @@ static void _logWriteStringToLogFile(const char *src)
 
 static void _logWriteFormattedStringToLogFile(bool save, u8 level, const char *file_name, int line, const char *func_name, const char *fmt, va_list args)
 {
-    /* Make sure we have allocated memory for the log buffer and opened the logfile. */
+    /* Make sure we have allocated memory for the log buffers and opened the logfile. */
     if (level < LOG_LEVEL || !file_name || !*file_name || !func_name || !*func_name || !fmt || !*fmt || !logAllocateLogBuffer() || !logOpenLogFile()) return;
 
-    Result rc = 0;
+    /* Create the flush thread. Logging falls back to synchronous flushes if this fails. */
+    logCreateFlushThread();
 
     int str1_len = 0, str2_len = 0;
     size_t log_str_len = 0;
@@ -325,12 +585,8 @@ static void _logWriteFormattedStringToLogFile(bool save, u8 level, const char *f
     /* Check if the formatted string length is less than the log buffer size. */
     if (log_str_len < LOG_BUF_SIZE)
     {
-        /* Flush log buffer contents (if needed). */
-        if ((g_logBufferLength + log_str_len) >= LOG_BUF_SIZE)
-        {
-            _logFlushLogFile();
-            if (g_logBufferLength) return;
-        }
+        /* Wait until the log buffer has enough room for the formatted string. */
+        if (!logEnsureLogBufferSpace(log_str_len)) return;
 
         /* Nice and easy string formatting using the log buffer. */
         sprintf(g_logBuffer + g_logBufferLength, g_logStrFormat, ts.tm_year, ts.tm_mon, ts.tm_mday, ts.tm_hour, ts.tm_min, ts.tm_sec, now.tv_nsec, g_logLevelNames[level], file_name, line, func_name);
@@ -342,11 +598,10 @@ static void _logWriteFormattedStringToLogFile(bool save, u8 level, const char *f
 
         /* Update log buffer length. */
         g_logBufferLength += log_str_len;
-    } else {
-        /* Flush log buffer. */
-        _logFlushLogFile();
-        if (g_logBufferLength) return;
 
+        /* Wake up the flush thread early if the log buffer is at least half full. */
+        if (g_logBufferLength >= LOG_BUF_WATERMARK && g_logFlushThreadCreated) ueventSignal(&g_logFlushEvent);
+    } else {
         /* Allocate memory for a temporary buffer. This will hold the formatted string. */
         tmp_str = calloc(log_str_len + 1, sizeof(char));
         if (!tmp_str) return;
@@ -359,23 +614,8 @@ static void _logWriteFormattedStringToLogFile(bool save, u8 level, const char *f
         /* Write data to nxlink. */
         logWriteStringToNxLink(tmp_str);
 
-        /* Write formatted string data until it no longer exceeds the log buffer size. */
-        while(log_str_len >= LOG_BUF_SIZE)
-        {
-            rc = fsFileWrite(&g_logFile, g_logFileOffset, tmp_str + tmp_len, LOG_BUF_SIZE, FsWriteOption_Flush);
-            if (R_FAILED(rc)) goto end;
-
-            g_logFileOffset += LOG_BUF_SIZE;
-            tmp_len += LOG_BUF_SIZE;
-            log_str_len -= LOG_BUF_SIZE;
-        }
-
-        /* Copy any remaining data from the formatted string into the log buffer. */
-        if (log_str_len)
-        {
-            strcpy(g_logBuffer, tmp_str + tmp_len);
-            g_logBufferLength = log_str_len;
-        }
+        /* Copy formatted string data into the log buffer in chunks. */
+        logAppendStringToLogBuffer(tmp_str, log_str_len);
     }
 
 #if LOG_FORCE_FLUSH == 1
@@ -383,7 +623,6 @@ static void _logWriteFormattedStringToLogFile(bool save, u8 level, const char *f
     _logFlushLogFile();
 #endif
 
-end:
     if (tmp_str) free(tmp_str);
 }
 
@@ -402,11 +641,152 @@ static void _logFlushLogFile(void)
     }
 }
 
+static bool logEnsureLogBufferSpace(size_t size)
+{
+    if (size >= LOG_BUF_SIZE) return false;
+
+    while((g_logBufferLength + size) >= LOG_BUF_SIZE)
+    {
+        if (g_logFlushThreadCreated)
+        {
+            /* Wake up the flush thread and wait until it drains the log buffer. */
+            /* A timeout is used to avoid a missed wakeup if the flush thread is being torn down. */
+            ueventSignal(&g_logFlushEvent);
+            condvarWaitTimeout(&g_logCondVar, &g_logMutex, LOG_FLUSH_INTERVAL);
+        } else {
+            /* No flush thread available - flush the log buffer synchronously. */
+            _logFlushLogFile();
+            if (g_logBufferLength) return false;
+        }
+    }
+
+    return true;
+}
+
+static void logAppendStringToLogBuffer(const char *src, size_t src_len)
+{
+    while(src_len)
+    {
+        /* Copy as much data as the log buffer can hold in one go, waiting for the flush thread to drain it if needed. */
+        size_t chunk_len = (src_len < (LOG_BUF_SIZE - 1) ? src_len : (LOG_BUF_SIZE - 1));
+        if (!logEnsureLogBufferSpace(chunk_len)) break;
+
+        memcpy(g_logBuffer + g_logBufferLength, src, chunk_len);
+        g_logBufferLength += chunk_len;
+        g_logBuffer[g_logBufferLength] = '\0';
+
+        src += chunk_len;
+        src_len -= chunk_len;
+    }
+
+    /* Wake up the flush thread early if the log buffer is at least half full. */
+    if (g_logBufferLength >= LOG_BUF_WATERMARK && g_logFlushThreadCreated) ueventSignal(&g_logFlushEvent);
+}
+
+static bool logCreateFlushThread(void)
+{
+#if LOG_FORCE_FLUSH == 1
+    /* Keep the fully synchronous flush path - every message must hit the SD card before the call that logged it returns. */
+    return false;
+#else
+    if (g_logFlushThreadCreated) return true;
+
+    /* Create user mode events. */
+    ueventCreate(&g_logFlushEvent, true);
+    ueventCreate(&g_logFlushThreadExitEvent, true);
+
+    /* Create flush thread. Not a fatal error if this fails - logging falls back to synchronous flushes. */
+    if (!utilsCreateThread(&g_logFlushThread, logFlushThreadFunc, NULL, 1)) return false;
+
+    /* Update flag. */
+    g_logFlushThreadCreated = true;
+
+    return true;
+#endif
+}
+
+static void logDestroyFlushThread(void)
+{
+    bool created = false;
+    SCOPED_LOCK(&g_logMutex) created = g_logFlushThreadCreated;
+    if (!created) return;
+
+    /* Signal the exit event to terminate the flush thread. It drains the log buffer one last time before exiting. */
+    ueventSignal(&g_logFlushThreadExitEvent);
+
+    /* Wait for the flush thread to exit. */
+    utilsJoinThread(&g_logFlushThread);
+
+    /* Update flag. */
+    SCOPED_LOCK(&g_logMutex) g_logFlushThreadCreated = false;
+}
+
+static void logFlushThreadFunc(void *arg)
+{
+    (void)arg;
+
+    Result rc = 0;
+    int idx = 0;
+
+    Waiter flush_event_waiter = waiterForUEvent(&g_logFlushEvent);
+    Waiter exit_event_waiter = waiterForUEvent(&g_logFlushThreadExitEvent);
+
+    while(true)
+    {
+        /* Wait until an event is triggered or the flush interval expires. */
+        rc = waitMulti(&idx, LOG_FLUSH_INTERVAL, flush_event_waiter, exit_event_waiter);
+
+        /* Exit event triggered. */
+        bool exit_flag = (R_SUCCEEDED(rc) && idx == 1);
+
+        char *flush_buf = NULL;
+        size_t flush_len = 0;
+
+        SCOPED_LOCK(&g_logMutex)
+        {
+            if (g_logBufferLength)
+            {
+                /* Swap buffers, so producers can keep logging while we access the SD card. */
+                flush_buf = g_logBuffer;
+                flush_len = g_logBufferLength;
+
+                g_logBuffer = g_logFlushBuffer;
+                g_logBufferLength = 0;
+                *g_logBuffer = '\0';
+
+                g_logFlushBuffer = flush_buf;
+                g_logFlushInProgress = true;
+            }
+        }
+
+        if (flush_len)
+        {
+            /* Write buffered data outside the lock - producers only ever pay for string formatting, never for SD card latency. */
+            rc = fsFileWrite(&g_logFile, g_logFileOffset, flush_buf, flush_len, FsWriteOption_Flush);
+            if (R_SUCCEEDED(rc)) g_logFileOffset += (s64)flush_len;
+
+            SCOPED_LOCK(&g_logMutex)
+            {
+                /* Update flag and wake up any producers waiting for log buffer space. */
+                g_logFlushInProgress = false;
+                condvarWakeAll(&g_logCondVar);
+            }
+        }
+
+        if (exit_flag) break;
+    }
+
+    threadExit();
+}
+
 static bool logAllocateLogBuffer(void)
 {
-    if (g_logBuffer) return true;
-    g_logBuffer = memalign(LOG_BUF_SIZE, LOG_BUF_SIZE);
-    return (g_logBuffer != NULL);
+    if (g_logBuffer && g_logFlushBuffer) return true;
+
+    if (!g_logBuffer) g_logBuffer = memalign(LOG_BUF_SIZE, LOG_BUF_SIZE);
+    if (!g_logFlushBuffer) g_logFlushBuffer = memalign(LOG_BUF_SIZE, LOG_BUF_SIZE);
+
+    return (g_logBuffer != NULL && g_logFlushBuffer != NULL);
 }
 
 static bool logOpenLogFile(void)
@@ -487,4 +867,46 @@ static void logWriteStringToNxLink(const char *str)
     }
 }
 
+static void _logWriteTraceEvent(const char *event)
+{
+    if (!g_traceFileOpened || !g_traceBuffer) return;
+
+    size_t event_len = strlen(event), sep_len = (g_traceFirstEvent ? 0 : 3);
+
+    /* Flush the trace buffer if it can't hold the new event. */
+    /* An extra 8 bytes are reserved at all times, so logCloseTraceFile() can always append the timeline terminator without flushing first. */
+    if ((g_traceBufferLength + sep_len + event_len + 8) >= TRACE_BUF_SIZE)
+    {
+        _logFlushTraceFile();
+        if ((g_traceBufferLength + sep_len + event_len + 8) >= TRACE_BUF_SIZE) return;
+    }
+
+    /* Append event separator. */
+    if (sep_len)
+    {
+        memcpy(g_traceBuffer + g_traceBufferLength, "," CRLF, sep_len);
+        g_traceBufferLength += sep_len;
+    }
+
+    /* Append event data. */
+    memcpy(g_traceBuffer + g_traceBufferLength, event, event_len);
+    g_traceBufferLength += event_len;
+
+    g_traceFirstEvent = false;
+}
+
+static void _logFlushTraceFile(void)
+{
+    if (!serviceIsActive(&(g_traceFile.s)) || !g_traceBuffer || !g_traceBufferLength) return;
+
+    /* Write trace buffer contents and flush the written data right away. */
+    Result rc = fsFileWrite(&g_traceFile, g_traceFileOffset, g_traceBuffer, g_traceBufferLength, FsWriteOption_Flush);
+    if (R_SUCCEEDED(rc))
+    {
+        /* Update global variables. */
+        g_traceFileOffset += (s64)g_traceBufferLength;
+        g_traceBufferLength = 0;
+    }
+}
+
 #endif  /* (LOG_LEVEL >= LOG_LEVEL_DEBUG) && (LOG_LEVEL < LOG_LEVEL_NONE) */
@@ -26,16 +26,32 @@
 #include "gamecard.h"
 #include "services.h"
 #include "nca.h"
+#include "rsa.h"
 #include "usb.h"
 #include "title.h"
 #include "bfttf.h"
 #include "nxdt_bfsar.h"
 #include "fatfs/ff.h"
+#include "fatfs/diskio.h"
 
 /* Reference: https://docs.microsoft.com/en-us/windows/win32/fileio/filesystem-functionality-comparison#limits. */
 /* Actually expressed in bytes, not codepoints. */
 #define NT_MAX_FILENAME_LENGTH  255
 
+/* Initial arena capacity for string builders. */
+#define STRING_BUILDER_MIN_CAPACITY 0x10000     /* 64 KiB. */
+
+/* Boundaries for applet-mode dump buffer budgeting. */
+#define DUMP_BLOCK_SIZE_MIN         0x100000    /* 1 MiB. Dump buffers never shrink below this - at some point a tiny ring just trades OOM for pathological performance. */
+#define DUMP_HEAP_RESERVE_SIZE      0x1800000   /* 24 MiB. Kept free for NCA crypto buffers, metadata caches and other runtime allocations. */
+
+/* Initial bucket count for the created-directory hash set. Always grown in powers of two. */
+#define DIR_TREE_CACHE_MIN_CAPACITY 256
+
+/* Batching thresholds for scheduled SD card filesystem commits. Each commit stalls all SD card I/O, so write-heavy flows defer them until one of these limits is hit. */
+#define SD_COMMIT_TIME_THRESHOLD    10          /* Seconds since the last commit. Bounds the amount of wall-clock time a crash can roll back. */
+#define SD_COMMIT_BYTE_THRESHOLD    0x4000000   /* 64 MiB. Bounds the amount of scheduled-but-uncommitted data a crash can roll back. */
+
 /* Type definitions. */
 
 typedef struct {
@@ -92,6 +108,16 @@ static const size_t g_outputDirsCount = MAX_ELEMENTS(g_outputDirs);
 
 static bool g_appUpdated = false;
 
+/// Scheduled SD card commit state. Guarded by its own mutex so worker threads can schedule commits without serializing against anything else.
+static Mutex g_sdCommitMutex = 0;
+static u64 g_sdCommitLastTick = 0, g_sdCommitPendingBytes = 0;
+static bool g_sdCommitPending = false;
+
+/// Created-directory hash set used by utilsCreateDirectoryTree(). Mass extraction revisits the same ancestor chains once per file, and each redundant mkdir costs a FS IPC round-trip.
+static Mutex g_dirTreeCacheMutex = 0;
+static u64 *g_dirTreeCache = NULL;
+static u32 g_dirTreeCacheCapacity = 0, g_dirTreeCacheCount = 0;
+
 /* Function prototypes. */
 
 static void _utilsGetLaunchPath(int program_argc, const char **program_argv);
@@ -102,6 +128,9 @@ static bool _utilsGetProductModel(void);
 
 static bool _utilsIsDevelopmentUnit(void);
 
+static void utilsInitializeContentChainThreadFunc(void *arg);
+static void utilsInitializeUsbChainThreadFunc(void *arg);
+
 static bool utilsMountEmmcBisSystemPartitionStorage(void);
 static void utilsUnmountEmmcBisSystemPartitionStorage(void);
 
@@ -112,6 +141,11 @@ static void utilsChangeHomeButtonBlockStatus(bool block);
 
 static size_t utilsGetUtf8StringLimit(const char *str, size_t str_size, size_t byte_limit);
 
+static bool utilsAddPathToDirectoryTreeCache(const char *path, size_t path_len);
+
+static u32 utilsMultiplyGf2Matrix(const u32 *mat, u32 vec);
+static void utilsSquareGf2Matrix(u32 *square, const u32 *mat);
+
 bool utilsInitializeResources(const int program_argc, const char **program_argv)
 {
     Result rc = 0;
@@ -150,6 +184,12 @@ bool utilsInitializeResources(const int program_argc, const char **program_argv)
         LOG_MSG_INFO("Horizon OS version: %u.%u.%u.", HOSVER_MAJOR(hos_version), HOSVER_MINOR(hos_version), HOSVER_MICRO(hos_version));
 #endif
 
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+        /* Preopen the crash report file used by the exception handler. */
+        /* Failures aren't fatal - crash reports will simply be limited to the regular logfile. */
+        logOpenCrashReportFile();
+#endif
+
         /* Retrieve custom firmware type. */
         _utilsGetCustomFirmwareType();
         if (g_customFirmwareType != UtilsCustomFirmwareType_Unknown) LOG_MSG_INFO("Detected %s CFW.", (g_customFirmwareType == UtilsCustomFirmwareType_Atmosphere ? "Atmosphère" : \
@@ -190,51 +230,35 @@ bool utilsInitializeResources(const int program_argc, const char **program_argv)
         /* cURL must be initialized before starting any other threads. */
         if (!httpInitialize()) break;
 
-        /* Initialize USB interface. */
-        if (!usbInitialize()) break;
-
-        /* Initialize USB Mass Storage interface. */
-        if (!umsInitialize()) break;
-
-        /* Load keyset. */
-        if (!keysLoadKeyset())
-        {
-            LOG_MSG_ERROR("Failed to load keyset!\nUpdate your keys file with Lockpick_RCM:\n" LOCKPICK_RCM_URL);
-            break;
-        }
-
-        /* Allocate NCA crypto buffer. */
-        if (!ncaAllocateCryptoBuffer())
-        {
-            LOG_MSG_ERROR("Unable to allocate memory for NCA crypto buffer!");
-            break;
-        }
-
-        /* Initialize gamecard interface. */
-        if (!gamecardInitialize()) break;
-
-        /* Initialize title interface. */
-        if (!titleInitialize()) break;
-
-        /* Initialize BFTTF interface. */
-        if (!bfttfInitialize()) break;
+        /* Initialize the remaining subsystems through dependency-ordered parallel chains - cold-start to interactive is dominated by this block. */
+        /* Content chain: keyset -> NCA crypto buffer -> gamecard -> title -> BFTTF (each stage depends on the previous ones). */
+        /* USB chain: USB interface -> USB Mass Storage interface (independent from all content-related subsystems). */
+        /* The filesystem-bound stages (eMMC BIS, RomFS, configuration) run on this thread in the meantime. */
+        Thread content_chain_thread = {0}, usb_chain_thread = {0};
+        bool content_chain_success = false, usb_chain_success = false, fs_stages_success = false;
 
-        /* Initialize BFSAR interface. */
-        //if (!bfsarInitialize()) break;
+        bool content_chain_created = utilsCreateThread(&content_chain_thread, utilsInitializeContentChainThreadFunc, &content_chain_success, 1);
+        bool usb_chain_created = utilsCreateThread(&usb_chain_thread, utilsInitializeUsbChainThreadFunc, &usb_chain_success, 2);
 
         /* Mount eMMC BIS System partition. */
-        if (!utilsMountEmmcBisSystemPartitionStorage()) break;
-
-        /* Mount application RomFS. */
-        rc = romfsInit();
-        if (R_FAILED(rc))
+        if (utilsMountEmmcBisSystemPartitionStorage())
         {
-            LOG_MSG_ERROR("Failed to mount " APP_TITLE "'s RomFS container!");
-            break;
+            /* Mount application RomFS. */
+            rc = romfsInit();
+            if (R_SUCCEEDED(rc))
+            {
+                /* Initialize configuration interface. */
+                fs_stages_success = configInitialize();
+            } else {
+                LOG_MSG_ERROR("Failed to mount " APP_TITLE "'s RomFS container!");
+            }
         }
 
-        /* Initialize configuration interface. */
-        if (!configInitialize()) break;
+        /* Wait for both initialization chains to finish, even if a stage from this thread failed - we can't tear anything down while they're running. */
+        if (content_chain_created) utilsJoinThread(&content_chain_thread);
+        if (usb_chain_created) utilsJoinThread(&usb_chain_thread);
+
+        if (!content_chain_created || !usb_chain_created || !content_chain_success || !usb_chain_success || !fs_stages_success) break;
 
         /* Setup an applet hook to change the hardware clocks after a system mode change (docked <-> undocked). */
         appletHook(&g_systemOverclockCookie, utilsOverclockSystemAppletHook, NULL);
@@ -280,6 +304,13 @@ void utilsCloseResources(void)
 {
     SCOPED_LOCK(&g_resourcesMutex)
     {
+#ifdef PGO_INSTRUMENTED
+        /* Flush execution profiles to the SD card while its filesystem is guaranteed to still be mounted. */
+        /* Letting the gcov runtime handle this via its exit handler would be too late - the devoptab may be gone by then. */
+        extern void __gcov_dump(void);
+        __gcov_dump();
+#endif
+
         /* Unset long running process state. */
         utilsSetLongRunningProcessState(false);
 
@@ -307,9 +338,21 @@ void utilsCloseResources(void)
         /* Deinitialize gamecard interface. */
         gamecardExit();
 
+        /* Destroy RSA signature verification thread. */
+        rsaDestroyPssVerificationThread();
+
         /* Free NCA crypto buffer. */
         ncaFreeCryptoBuffer();
 
+        /* Free pooled NCA context blocks. */
+        ncaFreeContextPool();
+
+        /* Force any scheduled SD card commit down to the filesystem. */
+        utilsFlushScheduledSdCardFileSystemCommits();
+
+        /* Flush created-directory cache. */
+        utilsFlushDirectoryTreeCache();
+
         /* Close USB Mass Storage interface. */
         umsExit();
 
@@ -340,6 +383,9 @@ void utilsCloseResources(void)
 #if LOG_LEVEL <= LOG_LEVEL_ERROR
         /* Close logfile. */
         logCloseLogFile();
+
+        /* Close crash report file. */
+        logCloseCrashReportFile();
 #endif
 
         /* Unlock applet exit. */
@@ -366,7 +412,73 @@ FsFileSystem *utilsGetSdCardFileSystemObject(void)
 
 bool utilsCommitSdCardFileSystemChanges(void)
 {
-    return (g_sdCardFileSystem ? R_SUCCEEDED(fsFsCommit(g_sdCardFileSystem)) : false);
+    bool ret = false;
+
+    SCOPED_LOCK(&g_sdCommitMutex)
+    {
+        ret = (g_sdCardFileSystem ? R_SUCCEEDED(fsFsCommit(g_sdCardFileSystem)) : false);
+
+        /* Any scheduled data is covered by the commit that just took place. */
+        if (ret)
+        {
+            g_sdCommitLastTick = armGetSystemTick();
+            g_sdCommitPendingBytes = 0;
+            g_sdCommitPending = false;
+        }
+    }
+
+    return ret;
+}
+
+bool utilsScheduleSdCardFileSystemCommit(u64 size)
+{
+    bool ret = false;
+
+    SCOPED_LOCK(&g_sdCommitMutex)
+    {
+        if (!g_sdCardFileSystem) break;
+
+        g_sdCommitPending = true;
+        g_sdCommitPendingBytes += size;
+
+        /* Leave the data sitting in the filesystem layer if no batching threshold has been hit yet. */
+        u64 elapsed = ((armGetSystemTick() - g_sdCommitLastTick) / armGetSystemTickFreq());
+        if (g_sdCommitLastTick && elapsed < SD_COMMIT_TIME_THRESHOLD && g_sdCommitPendingBytes < SD_COMMIT_BYTE_THRESHOLD)
+        {
+            ret = true;
+            break;
+        }
+
+        ret = R_SUCCEEDED(fsFsCommit(g_sdCardFileSystem));
+        if (ret)
+        {
+            g_sdCommitLastTick = armGetSystemTick();
+            g_sdCommitPendingBytes = 0;
+            g_sdCommitPending = false;
+        }
+    }
+
+    return ret;
+}
+
+bool utilsFlushScheduledSdCardFileSystemCommits(void)
+{
+    bool ret = true;
+
+    SCOPED_LOCK(&g_sdCommitMutex)
+    {
+        if (!g_sdCommitPending) break;
+
+        ret = (g_sdCardFileSystem ? R_SUCCEEDED(fsFsCommit(g_sdCardFileSystem)) : false);
+        if (ret)
+        {
+            g_sdCommitLastTick = armGetSystemTick();
+            g_sdCommitPendingBytes = 0;
+            g_sdCommitPending = false;
+        }
+    }
+
+    return ret;
 }
 
 u8 utilsGetCustomFirmwareType(void)
@@ -389,6 +501,48 @@ bool utilsIsAppletMode(void)
     return (g_programAppletType > AppletType_Application && g_programAppletType < AppletType_SystemApplication);
 }
 
+u64 utilsGetFreeHeapSize(void)
+{
+    u64 total_size = 0, used_size = 0;
+    Result rc = 0;
+
+    rc = svcGetInfo(&total_size, InfoType_TotalMemorySize, CUR_PROCESS_HANDLE, 0);
+    if (R_FAILED(rc))
+    {
+        LOG_MSG_ERROR("svcGetInfo failed! (0x%X) (InfoType_TotalMemorySize).", rc);
+        return 0;
+    }
+
+    rc = svcGetInfo(&used_size, InfoType_UsedMemorySize, CUR_PROCESS_HANDLE, 0);
+    if (R_FAILED(rc))
+    {
+        LOG_MSG_ERROR("svcGetInfo failed! (0x%X) (InfoType_UsedMemorySize).", rc);
+        return 0;
+    }
+
+    return (total_size > used_size ? (total_size - used_size) : 0);
+}
+
+u64 utilsGetDumpBlockSize(u32 buffer_count)
+{
+    u64 block_size = USB_TRANSFER_BUFFER_SIZE;
+    if (!buffer_count) return block_size;
+
+    /* Title override mode gets the full application memory pool - no budgeting needed. */
+    if (!utilsIsAppletMode()) return block_size;
+
+    /* Carve the buffer pool out of the available heap, leaving a fixed reserve for everything else. */
+    u64 free_heap = utilsGetFreeHeapSize();
+    u64 budget = (free_heap > DUMP_HEAP_RESERVE_SIZE ? (free_heap - DUMP_HEAP_RESERVE_SIZE) : 0);
+
+    while(block_size > DUMP_BLOCK_SIZE_MIN && ((u64)buffer_count * block_size) > budget) block_size >>= 1;
+
+    if (block_size != USB_TRANSFER_BUFFER_SIZE) LOG_MSG_INFO("Applet mode: dump buffers budgeted to 0x%lX bytes each (%u buffer[s], 0x%lX bytes of free heap).", block_size, buffer_count, \
+                                                             free_heap);
+
+    return block_size;
+}
+
 FsStorage *utilsGetEmmcBisSystemPartitionStorage(void)
 {
     return &g_emmcBisSystemPartitionStorage;
@@ -415,6 +569,13 @@ void utilsSetLongRunningProcessState(bool state)
     }
 }
 
+bool utilsGetLongRunningProcessState(void)
+{
+    bool ret = false;
+    SCOPED_LOCK(&g_resourcesMutex) ret = g_longRunningProcess;
+    return ret;
+}
+
 bool utilsCreateThread(Thread *out_thread, ThreadFunc func, void *arg, int cpu_id)
 {
     /* Core 3 is reserved for HOS, so we can only use cores 0, 1 and 2. */
@@ -563,6 +724,94 @@ end:
     return success;
 }
 
+__attribute__((format(printf, 2, 3))) bool utilsStringBuilderAppendFormat(UtilsStringBuilder *sb, const char *fmt, ...)
+{
+    if (!sb || (!sb->buf && (sb->length || sb->capacity)) || (sb->buf && (!sb->capacity || sb->length >= sb->capacity)) || !fmt || !*fmt)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    va_list args;
+    bool success = false;
+
+    va_start(args, fmt);
+
+    /* Retrieve the formatted string length. */
+    int formatted_str_len = 0;
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    formatted_str_len = vsnprintf(NULL, 0, fmt, args_copy);
+    va_end(args_copy);
+
+    if (formatted_str_len <= 0)
+    {
+        LOG_MSG_ERROR("Failed to retrieve formatted string length!");
+        goto end;
+    }
+
+    /* Grow the arena if needed. Capacity is doubled instead of matching the exact string length, so append-heavy workloads only ever trigger a handful of reallocations. */
+    u64 required_capacity = (sb->length + (u64)formatted_str_len + 1);
+    if (required_capacity > sb->capacity)
+    {
+        u64 new_capacity = (sb->capacity ? sb->capacity : STRING_BUILDER_MIN_CAPACITY);
+        while(new_capacity < required_capacity) new_capacity *= 2;
+
+        char *tmp = realloc(sb->buf, new_capacity);
+        if (!tmp)
+        {
+            LOG_MSG_ERROR("Failed to resize string builder arena to 0x%lX byte(s)!", new_capacity);
+            goto end;
+        }
+
+        sb->buf = tmp;
+        sb->capacity = new_capacity;
+    }
+
+    /* Generate formatted string in-place. */
+    vsprintf(sb->buf + sb->length, fmt, args);
+    sb->length += (u64)formatted_str_len;
+
+    success = true;
+
+end:
+    va_end(args);
+
+    return success;
+}
+
+char *utilsStringBuilderFinalize(UtilsStringBuilder *sb, u64 *out_size)
+{
+    if (!sb) return NULL;
+
+    char *out = NULL;
+
+    /* Generate an exact-size copy of the built string. The oversized arena is released right away instead of lingering for the lifetime of the output string. */
+    if (sb->buf && sb->length)
+    {
+        out = malloc(sb->length + 1);
+        if (out)
+        {
+            memcpy(out, sb->buf, sb->length + 1);
+            if (out_size) *out_size = sb->length;
+        } else {
+            LOG_MSG_ERROR("Failed to allocate 0x%lX bytes for the output string!", sb->length + 1);
+        }
+    }
+
+    utilsStringBuilderFree(sb);
+
+    return out;
+}
+
+void utilsStringBuilderFree(UtilsStringBuilder *sb)
+{
+    if (!sb) return;
+    if (sb->buf) free(sb->buf);
+    memset(sb, 0, sizeof(UtilsStringBuilder));
+}
+
 void utilsReplaceIllegalCharacters(char *str, bool ascii_only)
 {
     size_t str_size = 0, cur_pos = 0;
@@ -622,13 +871,13 @@ void utilsGenerateHexStringFromData(char *dst, size_t dst_size, const void *src,
     size_t i, j;
     const u8 *src_u8 = (const u8*)src;
 
+    /* Nibble lookup table. Removes the per-nibble branches from the conversion loop, which matters when hex-dumping whole buffers into the logfile. */
+    const char *nibbles = (uppercase ? "0123456789ABCDEF" : "0123456789abcdef");
+
     for(i = 0, j = 0; i < src_size; i++)
     {
-        char h_nib = ((src_u8[i] >> 4) & 0xF);
-        char l_nib = (src_u8[i] & 0xF);
-
-        dst[j++] = (h_nib + (h_nib < 0xA ? 0x30 : (uppercase ? 0x37 : 0x57)));
-        dst[j++] = (l_nib + (l_nib < 0xA ? 0x30 : (uppercase ? 0x37 : 0x57)));
+        dst[j++] = nibbles[(src_u8[i] >> 4) & 0xF];
+        dst[j++] = nibbles[src_u8[i] & 0xF];
     }
 
     dst[j] = '\0';
@@ -650,6 +899,181 @@ void utilsGenerateFormattedSizeString(double size, char *dst, size_t dst_size)
     }
 }
 
+void utilsGenerateFormattedSizeStringFromU64(u64 size, char *dst, size_t dst_size)
+{
+    if (!dst || dst_size < 2) return;
+
+    /* Pick the biggest suffix the value doesn't fully cover. */
+    u32 i = 0;
+    while((i + 1) < g_sizeSuffixesCount && size >= ((u64)1 << (10 * (i + 1)))) i++;
+
+    /* Generate the two decimal places through fixed-point math. Rounds towards zero, just like integer division. */
+    u64 whole = (size >> (10 * i));
+    u64 frac = (((size - (whole << (10 * i))) * 100) >> (10 * i));
+
+    snprintf(dst, dst_size, "%lu.%02lu %s", whole, frac, g_sizeSuffixes[i]);
+}
+
+const char *utilsGetFormattedSizeStringFromCache(UtilsFormattedSizeCache *cache, u64 size)
+{
+    if (!cache) return NULL;
+
+    /* Only regenerate the cached string if the raw value actually changed. */
+    if (!cache->valid || cache->last_size != size)
+    {
+        utilsGenerateFormattedSizeStringFromU64(size, cache->str, sizeof(cache->str));
+        cache->last_size = size;
+        cache->valid = true;
+    }
+
+    return cache->str;
+}
+
+void utilsUpdateProgressStats(UtilsProgressStats *stats, u64 cur_size)
+{
+    /* Smoothing factor for the exponentially-weighted rate and variance. Low enough to damp per-block jitter, high enough to track genuine slowdowns within a few samples. */
+    const double alpha = 0.2;
+
+    if (!stats) return;
+
+    u64 now = armGetSystemTick();
+
+    /* The first call just seeds the sample baseline. */
+    if (!stats->last_tick)
+    {
+        stats->last_tick = now;
+        stats->last_size = cur_size;
+        return;
+    }
+
+    /* Ignore samples taken too close together - tiny intervals turn tick granularity into throughput noise. */
+    u64 interval_ns = armTicksToNs(now - stats->last_tick);
+    if (interval_ns < 100000000ULL || cur_size < stats->last_size) return;
+
+    double rate = (((double)(cur_size - stats->last_size) * 1000000000.0) / (double)interval_ns);
+
+    stats->last_tick = now;
+    stats->last_size = cur_size;
+
+    if (!stats->history_count)
+    {
+        stats->ewma_rate = rate;
+        stats->ewma_var = 0.0;
+    } else {
+        /* Standard EWMA update for both the rate and its variance. */
+        double delta = (rate - stats->ewma_rate);
+        stats->ewma_rate += (alpha * delta);
+        stats->ewma_var = ((1.0 - alpha) * (stats->ewma_var + (alpha * delta * delta)));
+    }
+
+    stats->history[stats->history_index] = rate;
+    stats->history_index = ((stats->history_index + 1) % UTILS_PROGRESS_HISTORY_SIZE);
+    if (stats->history_count < UTILS_PROGRESS_HISTORY_SIZE) stats->history_count++;
+}
+
+double utilsGetProgressRate(const UtilsProgressStats *stats)
+{
+    return ((stats && stats->history_count) ? stats->ewma_rate : 0.0);
+}
+
+bool utilsGetProgressEta(const UtilsProgressStats *stats, u64 cur_size, u64 total_size, u64 *out_eta_secs)
+{
+    /* Require a handful of samples before producing a figure at all - the early-dump estimate is the part operators can't trust today. */
+    if (!stats || stats->history_count < 3 || !out_eta_secs || cur_size >= total_size || stats->ewma_rate <= 0.0) return false;
+
+    /* Lower the throughput estimate by one standard deviation, clamped to half the smoothed rate so a single outlier can't blow the ETA up. */
+    double rate = (stats->ewma_rate - sqrt(stats->ewma_var));
+    if (rate < (stats->ewma_rate / 2.0)) rate = (stats->ewma_rate / 2.0);
+
+    *out_eta_secs = (u64)(((double)(total_size - cur_size) / rate) + 0.5);
+
+    return true;
+}
+
+void utilsGenerateProgressSparkline(const UtilsProgressStats *stats, char *dst, size_t dst_size)
+{
+    /* Eight intensity levels. Sticking to plain ASCII keeps the sparkline rendering-safe on the default console font. */
+    static const char levels[] = " .:-=+*#";
+
+    if (!dst || !dst_size) return;
+
+    size_t out_len = MIN(dst_size - 1, UTILS_PROGRESS_HISTORY_SIZE);
+    memset(dst, ' ', out_len);
+    dst[out_len] = '\0';
+
+    if (!stats || !stats->history_count) return;
+
+    /* Scale every sample against the highest one on record, so relative dips stay visible regardless of the absolute transfer speed. */
+    double max_rate = 0.0;
+    for(u32 i = 0; i < stats->history_count; i++)
+    {
+        if (stats->history[i] > max_rate) max_rate = stats->history[i];
+    }
+
+    if (max_rate <= 0.0) return;
+
+    /* Walk the ring buffer from the oldest sample to the newest one, right-aligning the output while the buffer fills up. */
+    /* If the output buffer is smaller than the history, only the most recent samples are rendered. */
+    u32 start = ((stats->history_count < UTILS_PROGRESS_HISTORY_SIZE) ? 0 : stats->history_index);
+    u32 sample_count = MIN(stats->history_count, (u32)out_len);
+    size_t pad = (out_len - sample_count);
+
+    if (sample_count < stats->history_count) start = ((start + (stats->history_count - sample_count)) % UTILS_PROGRESS_HISTORY_SIZE);
+
+    for(u32 i = 0; i < sample_count; i++)
+    {
+        double sample = stats->history[(start + i) % UTILS_PROGRESS_HISTORY_SIZE];
+        u32 level = (u32)((sample / max_rate) * (double)(MAX_ELEMENTS(levels) - 2));
+        dst[pad + i] = levels[MIN(level, MAX_ELEMENTS(levels) - 2)];
+    }
+}
+
+bool utilsIsPaddingBlock(const void *buf, u64 size)
+{
+    const u8 *buf_u8 = (const u8*)buf;
+
+    if (!buf || !size) return false;
+
+    /* Only blocks completely filled with 0x00 or 0xFF bytes qualify as padding. */
+    if (buf_u8[0] != 0x00 && buf_u8[0] != 0xFF) return false;
+
+    /* Compare the block against itself with a one byte shift. */
+    /* memcmp() resolves to the vectorized libc routine on AArch64, which makes this run at memory bandwidth. */
+    return (size == 1 || !memcmp(buf_u8, buf_u8 + 1, size - 1));
+}
+
+u32 utilsCombineCrc32(u32 crc1, u32 crc2, u64 len2)
+{
+    u32 even[32] = {0};     /* Operator matrix for an even power-of-two count of zero bytes. */
+    u32 odd[32] = {0};      /* Operator matrix for an odd power-of-two count of zero bytes. */
+
+    if (!len2) return crc1;
+
+    /* Put the operator for one zero bit in 'odd'. The constant is the reflected CRC32 polynomial. */
+    odd[0] = 0xEDB88320;
+    for(u32 n = 1, row = 1; n < 32; n++, row <<= 1) odd[n] = row;
+
+    /* Put the operator for two zero bits in 'even', then the operator for four zero bits back in 'odd'. */
+    utilsSquareGf2Matrix(even, odd);
+    utilsSquareGf2Matrix(odd, even);
+
+    /* Apply 'len2' zero bytes to 'crc1'. Each matrix squaring doubles the amount of zeroes the operator appends, so this only takes log2(len2) rounds. */
+    do {
+        utilsSquareGf2Matrix(even, odd);
+        if (len2 & 1) crc1 = utilsMultiplyGf2Matrix(even, crc1);
+        len2 >>= 1;
+
+        if (!len2) break;
+
+        utilsSquareGf2Matrix(odd, even);
+        if (len2 & 1) crc1 = utilsMultiplyGf2Matrix(odd, crc1);
+        len2 >>= 1;
+    } while(len2);
+
+    /* The zero-extended 'crc1' and 'crc2' now cover the same data length, so combining them is a plain XOR. */
+    return (crc1 ^ crc2);
+}
+
 bool utilsGetFileSystemStatsByPath(const char *path, u64 *out_total, u64 *out_free)
 {
     char *name_end = NULL, stat_path[32] = {0};
@@ -745,19 +1169,39 @@ void utilsCreateDirectoryTree(const char *path, bool create_last_element)
     tmp = calloc(path_len + 1, sizeof(char));
     if (!tmp) return;
 
-    ptr = strchr(path, '/');
-    while(ptr)
+    SCOPED_LOCK(&g_dirTreeCacheMutex)
     {
-        sprintf(tmp, "%.*s", (int)(ptr - path), path);
-        mkdir(tmp, 0777);
-        ptr = strchr(++ptr, '/');
-    }
+        ptr = strchr(path, '/');
+        while(ptr)
+        {
+            size_t component_len = (size_t)(ptr - path);
+
+            /* Only issue a mkdir call if we haven't visited this ancestor before. Mass extraction revisits the same ancestor chains once per file. */
+            if (component_len && utilsAddPathToDirectoryTreeCache(path, component_len))
+            {
+                sprintf(tmp, "%.*s", (int)component_len, path);
+                mkdir(tmp, 0777);
+            }
 
-    if (create_last_element) mkdir(path, 0777);
+            ptr = strchr(++ptr, '/');
+        }
+
+        if (create_last_element && utilsAddPathToDirectoryTreeCache(path, path_len)) mkdir(path, 0777);
+    }
 
     free(tmp);
 }
 
+void utilsFlushDirectoryTreeCache(void)
+{
+    SCOPED_LOCK(&g_dirTreeCacheMutex)
+    {
+        if (g_dirTreeCache) free(g_dirTreeCache);
+        g_dirTreeCache = NULL;
+        g_dirTreeCacheCapacity = g_dirTreeCacheCount = 0;
+    }
+}
+
 char *utilsGeneratePath(const char *prefix, const char *filename, const char *extension)
 {
     if (!filename || !*filename)
@@ -1094,6 +1538,62 @@ static bool _utilsIsDevelopmentUnit(void)
     return R_SUCCEEDED(rc);
 }
 
+static void utilsInitializeContentChainThreadFunc(void *arg)
+{
+    bool *success = (bool*)arg;
+
+    /* Load keyset. */
+    if (!keysLoadKeyset())
+    {
+        LOG_MSG_ERROR("Failed to load keyset!\nUpdate your keys file with Lockpick_RCM:\n" LOCKPICK_RCM_URL);
+        goto end;
+    }
+
+    /* Allocate NCA crypto buffer. */
+    if (!ncaAllocateCryptoBuffer())
+    {
+        LOG_MSG_ERROR("Unable to allocate memory for NCA crypto buffer!");
+        goto end;
+    }
+
+    /* Initialize gamecard interface. */
+    if (!gamecardInitialize()) goto end;
+
+    /* Initialize title interface. */
+    /* Must run after the gamecard interface - it subscribes to the gamecard status change user event. */
+    if (!titleInitialize()) goto end;
+
+    /* Initialize BFTTF interface. */
+    /* Must run after both the keyset and the title interface - it pulls font data out of system title NCAs. */
+    if (!bfttfInitialize()) goto end;
+
+    /* Initialize BFSAR interface. */
+    //if (!bfsarInitialize()) goto end;
+
+    /* Update output flag. */
+    *success = true;
+
+end:
+    threadExit();
+}
+
+static void utilsInitializeUsbChainThreadFunc(void *arg)
+{
+    bool *success = (bool*)arg;
+
+    /* Initialize USB interface. */
+    if (!usbInitialize()) goto end;
+
+    /* Initialize USB Mass Storage interface. */
+    if (!umsInitialize()) goto end;
+
+    /* Update output flag. */
+    *success = true;
+
+end:
+    threadExit();
+}
+
 static bool utilsMountEmmcBisSystemPartitionStorage(void)
 {
     Result rc = 0;
@@ -1132,6 +1632,9 @@ static void utilsUnmountEmmcBisSystemPartitionStorage(void)
         g_emmcBisSystemPartitionFatFsObj = NULL;
     }
 
+    /* Free the readahead and sector cache buffers used by the FatFs diskio layer. */
+    disk_free_cache_buffers();
+
     if (serviceIsActive(&(g_emmcBisSystemPartitionStorage.s)))
     {
         fsStorageClose(&g_emmcBisSystemPartitionStorage);
@@ -1200,3 +1703,75 @@ static size_t utilsGetUtf8StringLimit(const char *str, size_t str_size, size_t b
 
     return last_cp_pos;
 }
+
+static bool utilsAddPathToDirectoryTreeCache(const char *path, size_t path_len)
+{
+    /* 64-bit FNV-1a over the path prefix. Storing hashes instead of full strings keeps the set compact; a collision across two real paths is practically impossible. */
+    u64 hash = 0xCBF29CE484222325ULL;
+
+    for(size_t i = 0; i < path_len; i++)
+    {
+        hash ^= (u8)path[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    /* Zero marks an empty bucket. */
+    if (!hash) hash = 1;
+
+    /* Allocate / grow the hash set, keeping the load factor at 50% or below. */
+    if ((g_dirTreeCacheCount * 2) >= g_dirTreeCacheCapacity)
+    {
+        u32 new_capacity = (g_dirTreeCacheCapacity ? (g_dirTreeCacheCapacity * 2) : DIR_TREE_CACHE_MIN_CAPACITY);
+
+        u64 *new_cache = calloc(new_capacity, sizeof(u64));
+        if (!new_cache) return true;    /* Out of memory. Just let the caller issue the mkdir call. */
+
+        /* Rehash existing entries. */
+        for(u32 i = 0; i < g_dirTreeCacheCapacity; i++)
+        {
+            u64 entry = g_dirTreeCache[i];
+            if (!entry) continue;
+
+            u32 slot = (u32)(entry & (new_capacity - 1));
+            while(new_cache[slot]) slot = ((slot + 1) & (new_capacity - 1));
+            new_cache[slot] = entry;
+        }
+
+        if (g_dirTreeCache) free(g_dirTreeCache);
+        g_dirTreeCache = new_cache;
+        g_dirTreeCacheCapacity = new_capacity;
+    }
+
+    /* Look for this path prefix, resolving collisions through linear probing. */
+    u32 slot = (u32)(hash & (g_dirTreeCacheCapacity - 1));
+    while(g_dirTreeCache[slot])
+    {
+        if (g_dirTreeCache[slot] == hash) return false;
+        slot = ((slot + 1) & (g_dirTreeCacheCapacity - 1));
+    }
+
+    /* Not visited before. Add it to the set. */
+    g_dirTreeCache[slot] = hash;
+    g_dirTreeCacheCount++;
+
+    return true;
+}
+
+static u32 utilsMultiplyGf2Matrix(const u32 *mat, u32 vec)
+{
+    u32 sum = 0;
+
+    while(vec)
+    {
+        if (vec & 1) sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+
+    return sum;
+}
+
+static void utilsSquareGf2Matrix(u32 *square, const u32 *mat)
+{
+    for(u32 n = 0; n < 32; n++) square[n] = utilsMultiplyGf2Matrix(mat, mat[n]);
+}
@@ -23,7 +23,10 @@
 #include "pfs.h"
 #include "npdm.h"
 
-#define PFS_FULL_HEADER_ALIGNMENT   0x20
+#define PFS_FULL_HEADER_ALIGNMENT       0x20
+
+#define PFS_FILE_CONTEXT_BASE_ENTRIES   8       /* Initial Partition FS entry capacity for PartitionFileSystemFileContext elements. */
+#define PFS_FILE_CONTEXT_BASE_NAMES     0x100   /* Initial name table capacity for PartitionFileSystemFileContext elements. */
 
 bool pfsInitializeContext(PartitionFileSystemContext *out, NcaFsSectionContext *nca_fs_ctx)
 {
@@ -255,20 +258,25 @@ bool pfsAddEntryInformationToFileContext(PartitionFileSystemFileContext *ctx, co
     PartitionFileSystemHeader *header = &(ctx->header);
 
     PartitionFileSystemEntry *tmp_pfs_entries = NULL, *cur_pfs_entry = NULL, *prev_pfs_entry = NULL;
-    u64 tmp_pfs_entries_size = ((header->entry_count + 1) * sizeof(PartitionFileSystemEntry));
 
     char *tmp_name_table = NULL;
     u32 tmp_name_table_size = (header->name_table_size + strlen(entry_name) + 1);
 
-    /* Reallocate Partition FS entries. */
-    if (!(tmp_pfs_entries = realloc(ctx->entries, tmp_pfs_entries_size)))
+    /* Reallocate Partition FS entries, if needed. Capacity is grown geometrically to keep the amortized cost of each insertion constant. */
+    if ((header->entry_count + 1) > ctx->entries_capacity)
     {
-        LOG_MSG_ERROR("Failed to reallocate Partition FS entries!");
-        return false;
-    }
+        u32 tmp_pfs_entries_capacity = (ctx->entries_capacity ? (ctx->entries_capacity * 2) : PFS_FILE_CONTEXT_BASE_ENTRIES);
+
+        if (!(tmp_pfs_entries = realloc(ctx->entries, tmp_pfs_entries_capacity * sizeof(PartitionFileSystemEntry))))
+        {
+            LOG_MSG_ERROR("Failed to reallocate Partition FS entries!");
+            return false;
+        }
 
-    ctx->entries = tmp_pfs_entries;
-    tmp_pfs_entries = NULL;
+        ctx->entries = tmp_pfs_entries;
+        ctx->entries_capacity = tmp_pfs_entries_capacity;
+        tmp_pfs_entries = NULL;
+    }
 
     /* Update Partition FS entry information. */
     cur_pfs_entry = &(ctx->entries[header->entry_count]);
@@ -280,15 +288,22 @@ bool pfsAddEntryInformationToFileContext(PartitionFileSystemFileContext *ctx, co
     cur_pfs_entry->size = entry_size;
     cur_pfs_entry->name_offset = header->name_table_size;
 
-    /* Reallocate Partition FS name table. */
-    if (!(tmp_name_table = realloc(ctx->name_table, tmp_name_table_size)))
+    /* Reallocate Partition FS name table, if needed. */
+    if (tmp_name_table_size > ctx->name_table_capacity)
     {
-        LOG_MSG_ERROR("Failed to reallocate Partition FS name table!");
-        return false;
-    }
+        u32 tmp_name_table_capacity = (ctx->name_table_capacity ? ctx->name_table_capacity : PFS_FILE_CONTEXT_BASE_NAMES);
+        while(tmp_name_table_capacity < tmp_name_table_size) tmp_name_table_capacity *= 2;
 
-    ctx->name_table = tmp_name_table;
-    tmp_name_table = NULL;
+        if (!(tmp_name_table = realloc(ctx->name_table, tmp_name_table_capacity)))
+        {
+            LOG_MSG_ERROR("Failed to reallocate Partition FS name table!");
+            return false;
+        }
+
+        ctx->name_table = tmp_name_table;
+        ctx->name_table_capacity = tmp_name_table_capacity;
+        tmp_name_table = NULL;
+    }
 
     /* Update Partition FS name table. */
     sprintf(ctx->name_table + header->name_table_size, "%s", entry_name);
@@ -301,6 +316,9 @@ bool pfsAddEntryInformationToFileContext(PartitionFileSystemFileContext *ctx, co
     header->entry_count++;
     ctx->fs_size += entry_size;
 
+    /* Invalidate the serialized header cache. */
+    ctx->header_dirty = true;
+
     return true;
 }
 
@@ -326,6 +344,38 @@ bool pfsUpdateEntryNameFromFileContext(PartitionFileSystemFileContext *ctx, u32
 
     memcpy(name_table_entry, new_entry_name, new_entry_name_len);
 
+    /* Invalidate the serialized header cache. */
+    ctx->header_dirty = true;
+
+    return true;
+}
+
+bool pfsUpdateEntrySizeFromFileContext(PartitionFileSystemFileContext *ctx, u32 entry_idx, u64 new_entry_size)
+{
+    if (!ctx || !ctx->header.entry_count || !ctx->entries || entry_idx >= ctx->header.entry_count)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Update the Partition FS entry size, then rebuild the data offsets for every entry placed after it. */
+    ctx->entries[entry_idx].size = new_entry_size;
+
+    u64 cur_offset = (ctx->entries[entry_idx].offset + new_entry_size);
+
+    for(u32 i = (entry_idx + 1); i < ctx->header.entry_count; i++)
+    {
+        PartitionFileSystemEntry *pfs_entry = &(ctx->entries[i]);
+        pfs_entry->offset = cur_offset;
+        cur_offset += pfs_entry->size;
+    }
+
+    /* Update the Partition FS data size. */
+    ctx->fs_size = cur_offset;
+
+    /* Invalidate the serialized header cache. */
+    ctx->header_dirty = true;
+
     return true;
 }
 
@@ -338,7 +388,6 @@ bool pfsWriteFileContextHeaderToMemoryBuffer(PartitionFileSystemFileContext *ctx
     }
 
     PartitionFileSystemHeader *header = &(ctx->header);
-    u8 *buf_u8 = (u8*)buf;
     u64 header_size = 0, full_header_size = 0, block_offset = 0, block_size = 0;
     u32 padding_size = 0;
 
@@ -356,22 +405,46 @@ bool pfsWriteFileContextHeaderToMemoryBuffer(PartitionFileSystemFileContext *ctx
         return false;
     }
 
-    /* Write full header. */
-    header->name_table_size += padding_size;
-    block_size = sizeof(PartitionFileSystemHeader);
-    memcpy(buf_u8 + block_offset, header, block_size);
-    block_offset += block_size;
-    header->name_table_size -= padding_size;
+    /* Serialize the full header, but only if the Partition FS layout changed since the last call. */
+    if (ctx->header_dirty || !ctx->cached_header || ctx->cached_header_size != full_header_size)
+    {
+        /* Reallocate the serialized header cache, if needed. */
+        if (ctx->cached_header_size != full_header_size)
+        {
+            u8 *tmp_cached_header = realloc(ctx->cached_header, full_header_size);
+            if (!tmp_cached_header)
+            {
+                LOG_MSG_ERROR("Failed to reallocate 0x%lX bytes buffer for the serialized Partition FS header!", full_header_size);
+                return false;
+            }
+
+            ctx->cached_header = tmp_cached_header;
+            ctx->cached_header_size = full_header_size;
+        }
+
+        /* Write full header. */
+        header->name_table_size += padding_size;
+        block_size = sizeof(PartitionFileSystemHeader);
+        memcpy(ctx->cached_header + block_offset, header, block_size);
+        block_offset += block_size;
+        header->name_table_size -= padding_size;
+
+        block_size = (header->entry_count * sizeof(PartitionFileSystemEntry));
+        memcpy(ctx->cached_header + block_offset, ctx->entries, block_size);
+        block_offset += block_size;
 
-    block_size = (header->entry_count * sizeof(PartitionFileSystemEntry));
-    memcpy(buf_u8 + block_offset, ctx->entries, block_size);
-    block_offset += block_size;
+        block_size = header->name_table_size;
+        memcpy(ctx->cached_header + block_offset, ctx->name_table, block_size);
+        block_offset += block_size;
 
-    block_size = header->name_table_size;
-    memcpy(buf_u8 + block_offset, ctx->name_table, block_size);
-    block_offset += block_size;
+        memset(ctx->cached_header + block_offset, 0, padding_size);
+
+        /* Update dirty flag. */
+        ctx->header_dirty = false;
+    }
 
-    memset(buf_u8 + block_offset, 0, padding_size);
+    /* Copy the serialized full header to the provided buffer. */
+    memcpy(buf, ctx->cached_header, full_header_size);
 
     /* Update output header size. */
     *out_header_size = full_header_size;
@@ -27,8 +27,22 @@
 
 /* Helper macros. */
 
-#define PI_ADD_FMT_STR_T1(fmt, ...) utilsAppendFormattedStringToBuffer(&xml_buf, &xml_buf_size, fmt, ##__VA_ARGS__)
-#define PI_ADD_FMT_STR_T2(fmt, ...) utilsAppendFormattedStringToBuffer(xml_buf, xml_buf_size, fmt, ##__VA_ARGS__)
+#define PI_ADD_FMT_STR_T1(fmt, ...) utilsStringBuilderAppendFormat(&sb, fmt, ##__VA_ARGS__)
+#define PI_ADD_FMT_STR_T2(fmt, ...) utilsStringBuilderAppendFormat(sb, fmt, ##__VA_ARGS__)
+
+#define PI_NSO_BATCH_MAX_THREADS    4   /* Used by parallel NSO context initialization. Matches the NCA crypto buffer pool size - extra workers would just block on buffer acquisition. */
+
+/* Type definitions. */
+
+/// Shared state for the parallel NSO context initialization performed by programInfoInitializeContext().
+typedef struct {
+    ProgramInfoContext *program_info_ctx;       ///< Context holding the preallocated NSO context array.
+    PartitionFileSystemEntry **pfs_entries;     ///< ExeFS entries to initialize NSO contexts from. Indices match the NSO context array.
+    bool *results;                              ///< Per-entry success flags.
+    u32 entry_count;                            ///< Total number of entries.
+    u32 next_entry;                             ///< Index of the next unclaimed entry. Protected by 'mutex'.
+    Mutex mutex;
+} ProgramInfoNsoBatchState;
 
 /* Global variables. */
 
@@ -46,17 +60,21 @@ static const char *g_facAccessibilityStrings[] = {
 
 /* Function prototypes. */
 
+static bool programInfoInitializeNsoContexts(ProgramInfoContext *program_info_ctx, PartitionFileSystemEntry **pfs_entries, u32 nso_count);
+static void programInfoProcessNsoBatchEntries(ProgramInfoNsoBatchState *state);
+static void programInfoNsoBatchThreadFunc(void *arg);
+
 static bool programInfoGetSdkVersionAndBuildTypeFromSdkNso(ProgramInfoContext *program_info_ctx, char **sdk_version, char **build_type);
-static bool programInfoAddNsoApiListToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, ProgramInfoContext *program_info_ctx, const char *api_list_tag, const char *api_entry_prefix, \
+static bool programInfoAddNsoApiListToAuthoringToolXml(UtilsStringBuilder *sb, ProgramInfoContext *program_info_ctx, const char *api_list_tag, const char *api_entry_prefix, \
                                                        const char *sdk_prefix);
 static bool programInfoIsApiInfoEntryValid(const char *sdk_prefix, size_t sdk_prefix_len, char *sdk_entry, char **sdk_entry_vender, int *sdk_entry_vender_len, char **sdk_entry_name, bool nnsdk);
 
-static bool programInfoAddStringFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, const char *value);
+static bool programInfoAddStringFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, const char *value);
 
-static bool programInfoAddNsoSymbolsToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, ProgramInfoContext *program_info_ctx);
+static bool programInfoAddNsoSymbolsToAuthoringToolXml(UtilsStringBuilder *sb, ProgramInfoContext *program_info_ctx);
 static bool programInfoIsElfSymbolValid(u8 *dynsym_ptr, char *dynstr_base_ptr, u64 dynstr_size, bool is_64bit, char **symbol_str);
 
-static bool programInfoAddFsAccessControlDataToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, ProgramInfoContext *program_info_ctx);
+static bool programInfoAddFsAccessControlDataToAuthoringToolXml(UtilsStringBuilder *sb, ProgramInfoContext *program_info_ctx);
 
 bool programInfoInitializeContext(ProgramInfoContext *out, NcaContext *nca_ctx)
 {
@@ -69,7 +87,7 @@ bool programInfoInitializeContext(ProgramInfoContext *out, NcaContext *nca_ctx)
     }
 
     u32 i = 0, pfs_entry_count = 0, magic = 0;
-    NsoContext *tmp_nso_ctx = NULL;
+    PartitionFileSystemEntry **nso_pfs_entries = NULL;
 
     bool success = false;
 
@@ -104,7 +122,14 @@ bool programInfoInitializeContext(ProgramInfoContext *out, NcaContext *nca_ctx)
         goto end;
     }
 
-    /* Initialize NSO contexts. */
+    /* Allocate memory for the NSO entry array. */
+    if (!(nso_pfs_entries = calloc(pfs_entry_count, sizeof(PartitionFileSystemEntry*))))
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the NSO entry array!");
+        goto end;
+    }
+
+    /* Collect all ExeFS entries holding NSOs. */
     for(i = 0; i < pfs_entry_count; i++)
     {
         /* Skip the main.npdm entry, as well as any other entries without a NSO header. */
@@ -113,27 +138,7 @@ bool programInfoInitializeContext(ProgramInfoContext *out, NcaContext *nca_ctx)
         if (!pfs_entry || !pfs_entry_name || !strcmp(pfs_entry_name, "main.npdm") || !pfsReadEntryData(&(out->pfs_ctx), pfs_entry, &magic, sizeof(u32), 0) || \
             __builtin_bswap32(magic) != NSO_HEADER_MAGIC) continue;
 
-        /* Reallocate NSO context buffer. */
-        if (!(tmp_nso_ctx = realloc(out->nso_ctx, (out->nso_count + 1) * sizeof(NsoContext))))
-        {
-            LOG_MSG_ERROR("Failed to reallocate NSO context buffer for NSO \"%s\"! (entry #%u).", pfs_entry_name, i);
-            goto end;
-        }
-
-        out->nso_ctx = tmp_nso_ctx;
-        tmp_nso_ctx = NULL;
-
-        memset(&(out->nso_ctx[out->nso_count]), 0, sizeof(NsoContext));
-
-        /* Initialize NSO context. */
-        if (!nsoInitializeContext(&(out->nso_ctx[out->nso_count]), &(out->pfs_ctx), pfs_entry))
-        {
-            LOG_MSG_ERROR("Failed to initialize context for NSO \"%s\"! (entry #%u).", pfs_entry_name, i);
-            goto end;
-        }
-
-        /* Update NSO count. */
-        out->nso_count++;
+        nso_pfs_entries[out->nso_count++] = pfs_entry;
     }
 
     /* Safety check. */
@@ -143,6 +148,16 @@ bool programInfoInitializeContext(ProgramInfoContext *out, NcaContext *nca_ctx)
         goto end;
     }
 
+    /* Allocate memory for the NSO context array. */
+    if (!(out->nso_ctx = calloc(out->nso_count, sizeof(NsoContext))))
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the NSO context array!");
+        goto end;
+    }
+
+    /* Initialize NSO contexts. Each one involves its own segment read, LZ4 decompression and hash verification, so independent NSOs are processed on parallel workers. */
+    if (!programInfoInitializeNsoContexts(out, nso_pfs_entries, out->nso_count)) goto end;
+
     /* Update output context. */
     out->nca_ctx = nca_ctx;
 
@@ -153,11 +168,94 @@ bool programInfoInitializeContext(ProgramInfoContext *out, NcaContext *nca_ctx)
     success = true;
 
 end:
+    if (nso_pfs_entries) free(nso_pfs_entries);
+
     if (!success) programInfoFreeContext(out);
 
     return success;
 }
 
+static bool programInfoInitializeNsoContexts(ProgramInfoContext *program_info_ctx, PartitionFileSystemEntry **pfs_entries, u32 nso_count)
+{
+    /* Process a single NSO directly on the calling thread. */
+    if (nso_count == 1)
+    {
+        bool ret = nsoInitializeContext(&(program_info_ctx->nso_ctx[0]), &(program_info_ctx->pfs_ctx), pfs_entries[0]);
+        if (!ret) LOG_MSG_ERROR("Failed to initialize context for NSO entry #0!");
+        return ret;
+    }
+
+    bool *results = NULL, success = true;
+
+    /* Allocate memory for the per-entry success flags. */
+    if (!(results = calloc(nso_count, sizeof(bool))))
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for NSO batch results!");
+        return false;
+    }
+
+    ProgramInfoNsoBatchState state = { .program_info_ctx = program_info_ctx, .pfs_entries = pfs_entries, .results = results, .entry_count = nso_count, .next_entry = 0, .mutex = 0 };
+
+    Thread threads[PI_NSO_BATCH_MAX_THREADS] = {0};
+    u32 thread_count = (MIN(nso_count, PI_NSO_BATCH_MAX_THREADS) - 1), created_count = 0;   /* The calling thread processes entries as well. */
+
+    /* Create worker threads, spreading them across all available cores. */
+    /* If thread creation fails at any point, the already created workers and the calling thread simply process the remaining entries between themselves. */
+    for(u32 i = 0; i < thread_count; i++)
+    {
+        if (!utilsCreateThread(&(threads[i]), programInfoNsoBatchThreadFunc, &state, (int)(i % 3))) break;
+        created_count++;
+    }
+
+    /* Process batch entries on the calling thread until none are left. */
+    programInfoProcessNsoBatchEntries(&state);
+
+    /* Wait for all worker threads to finish. */
+    for(u32 i = 0; i < created_count; i++) utilsJoinThread(&(threads[i]));
+
+    /* Check batch entry results. */
+    for(u32 i = 0; i < nso_count; i++)
+    {
+        if (results[i]) continue;
+        LOG_MSG_ERROR("Failed to initialize context for NSO entry #%u!", i);
+        success = false;
+    }
+
+    free(results);
+
+    return success;
+}
+
+static void programInfoProcessNsoBatchEntries(ProgramInfoNsoBatchState *state)
+{
+    while(true)
+    {
+        u32 idx = 0;
+        bool claimed = false;
+
+        /* Claim the next unprocessed batch entry. */
+        SCOPED_LOCK(&(state->mutex))
+        {
+            if (state->next_entry < state->entry_count)
+            {
+                idx = state->next_entry++;
+                claimed = true;
+            }
+        }
+
+        if (!claimed) break;
+
+        /* Initialize NSO context. */
+        state->results[idx] = nsoInitializeContext(&(state->program_info_ctx->nso_ctx[idx]), &(state->program_info_ctx->pfs_ctx), state->pfs_entries[idx]);
+    }
+}
+
+static void programInfoNsoBatchThreadFunc(void *arg)
+{
+    programInfoProcessNsoBatchEntries((ProgramInfoNsoBatchState*)arg);
+    threadExit();
+}
+
 bool programInfoGenerateAuthoringToolXml(ProgramInfoContext *program_info_ctx)
 {
     if (!programInfoIsValidContext(program_info_ctx))
@@ -166,8 +264,7 @@ bool programInfoGenerateAuthoringToolXml(ProgramInfoContext *program_info_ctx)
         return false;
     }
 
-    char *xml_buf = NULL;
-    u64 xml_buf_size = 0;
+    UtilsStringBuilder sb = {0};
 
     char *sdk_version = NULL, *build_type = NULL;
     bool is_64bit = (program_info_ctx->npdm_ctx.meta_header->flags.is_64bit_instruction == 1);
@@ -212,7 +309,7 @@ bool programInfoGenerateAuthoringToolXml(ProgramInfoContext *program_info_ctx)
                            "<ProgramInfo>\n")) goto end;
 
     /* SdkVersion. */
-    if (!programInfoAddStringFieldToAuthoringToolXml(&xml_buf, &xml_buf_size, "SdkVersion", sdk_version)) goto end;
+    if (!programInfoAddStringFieldToAuthoringToolXml(&sb, "SdkVersion", sdk_version)) goto end;
 
     if (!PI_ADD_FMT_STR_T1("  <ToolVersion />\n"                        /* Impossible to get. */ \
                            "  <NxAddonVersion>%s</NxAddonVersion>\n" \
@@ -222,7 +319,7 @@ bool programInfoGenerateAuthoringToolXml(ProgramInfoContext *program_info_ctx)
                            is_64bit ? 64 : 32)) goto end;
 
     /* BuildType. */
-    if (!programInfoAddStringFieldToAuthoringToolXml(&xml_buf, &xml_buf_size, "BuildType", build_type)) goto end;
+    if (!programInfoAddStringFieldToAuthoringToolXml(&sb, "BuildType", build_type)) goto end;
 
     if (!PI_ADD_FMT_STR_T1("  <EnableDeadStrip />\n"                                /* Impossible to get. */ \
                            "  <EnableDeadStripSpecified />\n"                       /* Impossible to get. */ \
@@ -237,34 +334,33 @@ bool programInfoGenerateAuthoringToolXml(ProgramInfoContext *program_info_ctx)
                            program_info_ctx->npdm_ctx.acid_header->flags.unqualified_approval ? g_trueString : g_falseString)) goto end;
 
     /* MiddlewareList. */
-    if (!programInfoAddNsoApiListToAuthoringToolXml(&xml_buf, &xml_buf_size, program_info_ctx, "Middleware", "Module", "SDK MW")) goto end;
+    if (!programInfoAddNsoApiListToAuthoringToolXml(&sb, program_info_ctx, "Middleware", "Module", "SDK MW")) goto end;
 
     /* DebugApiList. */
-    if (!programInfoAddNsoApiListToAuthoringToolXml(&xml_buf, &xml_buf_size, program_info_ctx, "DebugApi", "Api", "SDK Debug")) goto end;
+    if (!programInfoAddNsoApiListToAuthoringToolXml(&sb, program_info_ctx, "DebugApi", "Api", "SDK Debug")) goto end;
 
     /* PrivateApiList. */
-    if (!programInfoAddNsoApiListToAuthoringToolXml(&xml_buf, &xml_buf_size, program_info_ctx, "PrivateApi", "Api", "SDK Private")) goto end;
+    if (!programInfoAddNsoApiListToAuthoringToolXml(&sb, program_info_ctx, "PrivateApi", "Api", "SDK Private")) goto end;
 
     /* GuidelineApiList. */
-    if (!programInfoAddNsoApiListToAuthoringToolXml(&xml_buf, &xml_buf_size, program_info_ctx, "GuidelineApi", "Api", "SDK Guideline")) goto end;
+    if (!programInfoAddNsoApiListToAuthoringToolXml(&sb, program_info_ctx, "GuidelineApi", "Api", "SDK Guideline")) goto end;
 
     /* UnresolvedApiList. */
-    if (!programInfoAddNsoSymbolsToAuthoringToolXml(&xml_buf, &xml_buf_size, program_info_ctx)) goto end;
+    if (!programInfoAddNsoSymbolsToAuthoringToolXml(&sb, program_info_ctx)) goto end;
 
     /* FsAccessControlData. */
-    if (!programInfoAddFsAccessControlDataToAuthoringToolXml(&xml_buf, &xml_buf_size, program_info_ctx)) goto end;
+    if (!programInfoAddFsAccessControlDataToAuthoringToolXml(&sb, program_info_ctx)) goto end;
 
-    if (!(success = PI_ADD_FMT_STR_T1("  <EnableGlobalDestructor />\n"          /* Impossible to get. */ \
-                                      "  <EnableGlobalDestructorSpecified />\n" /* Impossible to get. */ \
-                                      "  <IncludeNssFile />\n"                  /* Impossible to get. */ \
-                                      "  <IncludeNssFileSpecified />\n"         /* Impossible to get. */ \
-                                      "  <History />\n"                         /* Impossible to get. */ \
-                                      "  <TargetTriplet />\n"                   /* Impossible to get. */ \
-                                      "</ProgramInfo>"))) goto end;
+    if (!PI_ADD_FMT_STR_T1("  <EnableGlobalDestructor />\n"          /* Impossible to get. */ \
+                           "  <EnableGlobalDestructorSpecified />\n" /* Impossible to get. */ \
+                           "  <IncludeNssFile />\n"                  /* Impossible to get. */ \
+                           "  <IncludeNssFileSpecified />\n"         /* Impossible to get. */ \
+                           "  <History />\n"                         /* Impossible to get. */ \
+                           "  <TargetTriplet />\n"                   /* Impossible to get. */ \
+                           "</ProgramInfo>")) goto end;
 
     /* Update ProgramInfo context. */
-    program_info_ctx->authoring_tool_xml = xml_buf;
-    program_info_ctx->authoring_tool_xml_size = strlen(xml_buf);
+    success = ((program_info_ctx->authoring_tool_xml = utilsStringBuilderFinalize(&sb, &(program_info_ctx->authoring_tool_xml_size))) != NULL);
 
 end:
     if (npdm_acid_b64) free(npdm_acid_b64);
@@ -275,7 +371,7 @@ end:
 
     if (!success)
     {
-        if (xml_buf) free(xml_buf);
+        utilsStringBuilderFree(&sb);
         LOG_MSG_ERROR("Failed to generate ProgramInfo AuthoringTool XML!");
     }
 
@@ -358,7 +454,7 @@ end:
     return success;
 }
 
-static bool programInfoAddNsoApiListToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, ProgramInfoContext *program_info_ctx, const char *api_list_tag, const char *api_entry_prefix, \
+static bool programInfoAddNsoApiListToAuthoringToolXml(UtilsStringBuilder *sb, ProgramInfoContext *program_info_ctx, const char *api_list_tag, const char *api_entry_prefix, \
                                                        const char *sdk_prefix)
 {
     size_t sdk_prefix_len = 0;
@@ -366,7 +462,7 @@ static bool programInfoAddNsoApiListToAuthoringToolXml(char **xml_buf, u64 *xml_
     char *sdk_entry = NULL, *sdk_entry_vender = NULL, *sdk_entry_name = NULL;
     bool success = false, api_list_exists = false;
 
-    if (!xml_buf || !xml_buf_size || !program_info_ctx || !program_info_ctx->nso_count || !program_info_ctx->nso_ctx || !api_list_tag || !*api_list_tag || !api_entry_prefix || \
+    if (!sb || !program_info_ctx || !program_info_ctx->nso_count || !program_info_ctx->nso_ctx || !api_list_tag || !*api_list_tag || !api_entry_prefix || \
         !*api_entry_prefix || !sdk_prefix || !(sdk_prefix_len = strlen(sdk_prefix)))
     {
         LOG_MSG_ERROR("Invalid parameters!");
@@ -458,9 +554,9 @@ static bool programInfoIsApiInfoEntryValid(const char *sdk_prefix, size_t sdk_pr
     return true;
 }
 
-static bool programInfoAddStringFieldToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, const char *tag_name, const char *value)
+static bool programInfoAddStringFieldToAuthoringToolXml(UtilsStringBuilder *sb, const char *tag_name, const char *value)
 {
-    if (!xml_buf || !xml_buf_size || !tag_name || !*tag_name)
+    if (!sb || !tag_name || !*tag_name)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -469,9 +565,9 @@ static bool programInfoAddStringFieldToAuthoringToolXml(char **xml_buf, u64 *xml
     return ((value && *value) ? PI_ADD_FMT_STR_T2("  <%s>%s</%s>\n", tag_name, value, tag_name) : PI_ADD_FMT_STR_T2("  <%s />\n", tag_name));
 }
 
-static bool programInfoAddNsoSymbolsToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, ProgramInfoContext *program_info_ctx)
+static bool programInfoAddNsoSymbolsToAuthoringToolXml(UtilsStringBuilder *sb, ProgramInfoContext *program_info_ctx)
 {
-    if (!xml_buf || !xml_buf_size || !program_info_ctx || !program_info_ctx->npdm_ctx.meta_header || !program_info_ctx->nso_count || !program_info_ctx->nso_ctx)
+    if (!sb || !program_info_ctx || !program_info_ctx->npdm_ctx.meta_header || !program_info_ctx->nso_count || !program_info_ctx->nso_ctx)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -561,14 +657,14 @@ static bool programInfoIsElfSymbolValid(u8 *dynsym_ptr, char *dynstr_base_ptr, u
     return is_valid;
 }
 
-static bool programInfoAddFsAccessControlDataToAuthoringToolXml(char **xml_buf, u64 *xml_buf_size, ProgramInfoContext *program_info_ctx)
+static bool programInfoAddFsAccessControlDataToAuthoringToolXml(UtilsStringBuilder *sb, ProgramInfoContext *program_info_ctx)
 {
     NpdmFsAccessControlData *aci_fac_data = NULL;
     NpdmFsAccessControlDataSaveDataOwnerBlock *save_data_owner_block = NULL;
     u64 *save_data_owner_ids = NULL;
     bool success = false, sdo_data_available = false;
 
-    if (!xml_buf || !xml_buf_size || !program_info_ctx || !(aci_fac_data = program_info_ctx->npdm_ctx.aci_fac_data))
+    if (!sb || !program_info_ctx || !(aci_fac_data = program_info_ctx->npdm_ctx.aci_fac_data))
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
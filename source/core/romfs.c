@@ -22,11 +22,45 @@
 #include "nxdt_utils.h"
 #include "romfs.h"
 
+#define ROMFS_PATH_INDEX_EMPTY          UINT64_MAX  /* Marks an unused path index bucket. */
+#define ROMFS_PATH_INDEX_FILE_FLAG      BIT_LONG(32)
+
+#define ROMFS_DATA_CACHE_SIZE           0x100000    /* 1 MiB. Size of the coalesced file data span read by romfsFillDataCache(). */
+#define ROMFS_DATA_CACHE_THRESHOLD      0x20000     /* 128 KiB. File entry reads up to this size are served through the data cache. */
+
+#define ROMFS_MAX_PATH_DEPTH            256         /* Maximum directory depth supported by the path generation helpers. */
+
+/* Type definitions. */
+
+/// Used by romfsBuildUpdatedFileMemo() to sort file entry data extents by offset before classifying them against the Patch storage.
+typedef struct {
+    u64 data_offset;    ///< File entry data offset (relative to the start of the NCA FS section).
+    u64 data_size;      ///< File entry data size.
+    u32 memo_idx;       ///< Index into the updated file memo tables for this file entry.
+} RomFileSystemUpdatedFileRange;
+
 /* Function prototypes. */
 
 static RomFileSystemDirectoryEntry *romfsGetChildDirectoryEntryByName(RomFileSystemContext *ctx, RomFileSystemDirectoryEntry *dir_entry, const char *name);
 static RomFileSystemFileEntry *romfsGetChildFileEntryByName(RomFileSystemContext *ctx, RomFileSystemDirectoryEntry *dir_entry, const char *name);
 
+static bool romfsFillDataCache(RomFileSystemContext *ctx, u64 offset);
+
+static bool romfsBuildDirectorySizeMemo(RomFileSystemContext *ctx);
+static bool romfsComputeDirectorySizeMemo(RomFileSystemContext *ctx, RomFileSystemDirectoryEntry *dir_entry, u64 dir_entry_offset, u64 *out_size);
+static u64 *romfsGetDirectorySizeMemoSlot(RomFileSystemContext *ctx, u64 dir_entry_offset);
+
+static bool romfsBuildUpdatedFileMemo(RomFileSystemContext *ctx);
+static int romfsUpdatedFileRangeSortFunc(const void *a, const void *b);
+
+static bool romfsFindSortedOffsetIndex(const u64 *offsets, u32 count, u64 target, u32 *out_idx);
+
+static bool romfsBuildPathIndex(RomFileSystemContext *ctx);
+static void romfsInsertPathIndexEntry(RomFileSystemContext *ctx, u64 parent_offset, const char *name, size_t name_len, u64 entry_offset, bool is_file);
+static void *romfsFindPathIndexEntry(RomFileSystemContext *ctx, u64 parent_offset, const char *name, size_t name_len, bool is_file);
+
+NX_INLINE u32 romfsCalculatePathIndexHash(u64 parent_offset, const char *name, size_t name_len);
+
 bool romfsInitializeContext(RomFileSystemContext *out, NcaFsSectionContext *base_nca_fs_ctx, NcaFsSectionContext *patch_nca_fs_ctx)
 {
     u64 dir_table_offset = 0, file_table_offset = 0;
@@ -207,8 +241,25 @@ bool romfsReadFileEntryData(RomFileSystemContext *ctx, RomFileSystemFileEntry *f
         return false;
     }
 
+    u64 data_offset = (ctx->body_offset + file_entry->offset + offset);
+
+    /* Serve small reads through the data cache. */
+    /* The file entry table is sorted by data offset, so coalescing a bigger span into a single read lets many small, adjacent file entries share one decryption pass. */
+    if (read_size <= ROMFS_DATA_CACHE_THRESHOLD)
+    {
+        /* Fill the data cache if the requested range isn't already available. */
+        if ((!ctx->data_cache_size || data_offset < ctx->data_cache_offset || (data_offset + read_size) > (ctx->data_cache_offset + ctx->data_cache_size)) && \
+            !romfsFillDataCache(ctx, data_offset)) ctx->data_cache_size = 0;
+
+        if (ctx->data_cache_size && data_offset >= ctx->data_cache_offset && (data_offset + read_size) <= (ctx->data_cache_offset + ctx->data_cache_size))
+        {
+            memcpy(out, ctx->data_cache + (data_offset - ctx->data_cache_offset), read_size);
+            return true;
+        }
+    }
+
     /* Read entry data. */
-    if (!romfsReadFileSystemData(ctx, out, read_size, ctx->body_offset + file_entry->offset + offset))
+    if (!romfsReadFileSystemData(ctx, out, read_size, data_offset))
     {
         LOG_MSG_ERROR("Failed to read RomFS file entry data!");
         return false;
@@ -227,8 +278,16 @@ bool romfsGetTotalDataSize(RomFileSystemContext *ctx, bool only_updated, u64 *ou
 
     RomFileSystemFileEntry *file_entry = NULL;
     u64 total_size = 0;
+    u8 memo_idx = (only_updated ? 1 : 0);
     bool success = false;
 
+    /* Serve the request from the memo, if available. File entry sizes never change for an initialized context. */
+    if (ctx->total_size_memo_valid[memo_idx])
+    {
+        *out_size = ctx->total_size_memo[memo_idx];
+        return true;
+    }
+
     /* Reset current file table offset. */
     romfsResetFileTableOffset(ctx);
 
@@ -265,6 +324,10 @@ bool romfsGetTotalDataSize(RomFileSystemContext *ctx, bool only_updated, u64 *ou
     *out_size = total_size;
     success = true;
 
+    /* Memoize the calculated size. */
+    ctx->total_size_memo[memo_idx] = total_size;
+    ctx->total_size_memo_valid[memo_idx] = true;
+
 end:
     /* Reset current file table offset. */
     romfsResetFileTableOffset(ctx);
@@ -287,60 +350,25 @@ bool romfsGetDirectoryDataSize(RomFileSystemContext *ctx, RomFileSystemDirectory
         return true;
     }
 
-    RomFileSystemFileEntry *cur_file_entry = NULL;
-    RomFileSystemDirectoryEntry *cur_dir_entry = NULL;
-    u64 total_size = 0, cur_entry_offset = 0, child_dir_size = 0;
-    bool success = false;
-
-    /* Loop through the child file entries' linked list. */
-    cur_entry_offset = dir_entry->file_offset;
-    while(cur_entry_offset != ROMFS_VOID_ENTRY)
+    /* Build the directory size memo, if needed. Sizes for the whole directory tree are calculated in a single traversal and served from the memo afterwards. */
+    if (!romfsBuildDirectorySizeMemo(ctx))
     {
-        /* Get current file entry. */
-        if (!(cur_file_entry = romfsGetFileEntryByOffset(ctx, cur_entry_offset)))
-        {
-            LOG_MSG_ERROR("Failed to retrieve file entry! (0x%lX, 0x%lX).", cur_entry_offset, ctx->file_table_size);
-            goto end;
-        }
-
-        /* Update total data size. */
-        total_size += cur_file_entry->size;
-
-        /* Update current file entry offset. */
-        cur_entry_offset = cur_file_entry->next_offset;
+        LOG_MSG_ERROR("Failed to build directory size memo!");
+        return false;
     }
 
-    /* Loop through the child directory entries' linked list. */
-    cur_entry_offset = dir_entry->directory_offset;
-    while(cur_entry_offset != ROMFS_VOID_ENTRY)
+    /* Retrieve the memo slot for this directory entry. */
+    u64 *memo_slot = romfsGetDirectorySizeMemoSlot(ctx, (u64)((u8*)dir_entry - (u8*)ctx->dir_table));
+    if (!memo_slot)
     {
-        /* Get current directory entry. */
-        if (!(cur_dir_entry = romfsGetDirectoryEntryByOffset(ctx, cur_entry_offset)))
-        {
-            LOG_MSG_ERROR("Failed to retrieve directory entry! (0x%lX, 0x%lX).", cur_entry_offset, ctx->dir_table_size);
-            goto end;
-        }
-
-        /* Calculate directory size. */
-        if (!romfsGetDirectoryDataSize(ctx, cur_dir_entry, &child_dir_size))
-        {
-            LOG_MSG_ERROR("Failed to get size for directory entry! (0x%lX, 0x%lX).", cur_entry_offset, ctx->dir_table_size);
-            goto end;
-        }
-
-        /* Update total data size. */
-        total_size += child_dir_size;
-
-        /* Update current directory entry offset. */
-        cur_entry_offset = cur_dir_entry->next_offset;
+        LOG_MSG_ERROR("Failed to retrieve directory size memo slot! (0x%lX).", (u64)((u8*)dir_entry - (u8*)ctx->dir_table));
+        return false;
     }
 
     /* Update output values. */
-    *out_size = total_size;
-    success = true;
+    *out_size = *memo_slot;
 
-end:
-    return success;
+    return true;
 }
 
 RomFileSystemDirectoryEntry *romfsGetDirectoryEntryByPath(RomFileSystemContext *ctx, const char *path)
@@ -460,8 +488,7 @@ bool romfsGeneratePathFromDirectoryEntry(RomFileSystemContext *ctx, RomFileSyste
     size_t path_len = 0;
     u64 dir_offset = ROMFS_VOID_ENTRY;
     u32 dir_entries_count = 0;
-    RomFileSystemDirectoryEntry **dir_entries = NULL, **tmp_dir_entries = NULL;
-    bool success = false;
+    RomFileSystemDirectoryEntry *dir_entries[ROMFS_MAX_PATH_DEPTH] = {0};
 
     if (!romfsIsValidContext(ctx) || !dir_entry || (!dir_entry->name_length && dir_entry->parent_offset) || !out_path || out_path_size < 2 || \
         illegal_char_replace_type > RomFileSystemPathIllegalCharReplaceType_KeepAsciiCharsOnly)
@@ -477,41 +504,31 @@ bool romfsGeneratePathFromDirectoryEntry(RomFileSystemContext *ctx, RomFileSyste
         return true;
     }
 
-    /* Allocate memory for our directory entries pointer array. */
-    dir_entries = calloc(1, sizeof(RomFileSystemDirectoryEntry*));
-    if (!dir_entries)
-    {
-        LOG_MSG_ERROR("Unable to allocate memory for directory entries!");
-        goto end;
-    }
-
     /* Update stats. */
     path_len = (1 + dir_entry->name_length);
-    *dir_entries = dir_entry;
+    dir_entries[0] = dir_entry;
     dir_entries_count++;
 
+    /* Walk up to the root directory, collecting parent directory entries in a fixed on-stack array. Avoids per-call heap allocations. */
     while(true)
     {
         /* Get parent directory offset. Break out of the loop if we reached the root directory. */
         dir_offset = dir_entries[dir_entries_count - 1]->parent_offset;
         if (!dir_offset) break;
 
-        /* Reallocate directory entries pointer array. */
-        if (!(tmp_dir_entries = realloc(dir_entries, (dir_entries_count + 1) * sizeof(RomFileSystemDirectoryEntry*))))
+        /* Make sure we don't exceed our maximum directory depth. No path this deep could fit into a sanely sized output buffer, anyway. */
+        if (dir_entries_count >= ROMFS_MAX_PATH_DEPTH)
         {
-            LOG_MSG_ERROR("Unable to reallocate directory entries buffer!");
-            goto end;
+            LOG_MSG_ERROR("Path depth exceeds maximum value! (%u).", ROMFS_MAX_PATH_DEPTH);
+            return false;
         }
 
-        dir_entries = tmp_dir_entries;
-        tmp_dir_entries = NULL;
-
         /* Retrieve parent directory entry using the offset we got earlier. */
         RomFileSystemDirectoryEntry **cur_dir_entry = &(dir_entries[dir_entries_count]);
         if (!(*cur_dir_entry = romfsGetDirectoryEntryByOffset(ctx, dir_offset)) || !(*cur_dir_entry)->name_length)
         {
             LOG_MSG_ERROR("Failed to retrieve directory entry!");
-            goto end;
+            return false;
         }
 
         /* Update stats. */
@@ -523,11 +540,11 @@ bool romfsGeneratePathFromDirectoryEntry(RomFileSystemContext *ctx, RomFileSyste
     if (path_len >= out_path_size)
     {
         LOG_MSG_ERROR("Output path length exceeds output buffer size! (%lu >= %lu).", path_len, out_path_size);
-        goto end;
+        return false;
     }
 
     /* Generate output path, looping through our directory entries pointer array in reverse order. */
-    *out_path = '\0';
+    /* The path length is tracked explicitly, so the output string doesn't get rescanned on every appended component. */
     path_len = 0;
 
     for(u32 i = dir_entries_count; i > 0; i--)
@@ -536,9 +553,9 @@ bool romfsGeneratePathFromDirectoryEntry(RomFileSystemContext *ctx, RomFileSyste
         RomFileSystemDirectoryEntry *cur_dir_entry = dir_entries[i - 1];
 
         /* Concatenate path separator and current directory name to the output buffer. */
-        strcat(out_path, "/");
-        strncat(out_path, cur_dir_entry->name, cur_dir_entry->name_length);
-        path_len++;
+        out_path[path_len++] = '/';
+        memcpy(out_path + path_len, cur_dir_entry->name, cur_dir_entry->name_length);
+        out_path[path_len + cur_dir_entry->name_length] = '\0';
 
         if (illegal_char_replace_type)
         {
@@ -551,13 +568,7 @@ bool romfsGeneratePathFromDirectoryEntry(RomFileSystemContext *ctx, RomFileSyste
         }
     }
 
-    /* Update return value. */
-    success = true;
-
-end:
-    if (dir_entries) free(dir_entries);
-
-    return success;
+    return true;
 }
 
 bool romfsGeneratePathFromFileEntry(RomFileSystemContext *ctx, RomFileSystemFileEntry *file_entry, char *out_path, size_t out_path_size, u8 illegal_char_replace_type)
@@ -574,14 +585,31 @@ bool romfsGeneratePathFromFileEntry(RomFileSystemContext *ctx, RomFileSystemFile
     }
 
     /* Retrieve full RomFS path up to the file entry name. */
-    if (!romfsGeneratePathFromDirectoryEntry(ctx, dir_entry, out_path, out_path_size, illegal_char_replace_type))
+    /* Extraction flows iterate over the file table in order, so long runs of files sharing the same parent directory are the common case -- reuse the cached directory path whenever possible. */
+    if (ctx->cached_dir_path_len && ctx->cached_dir_offset == file_entry->parent_offset && ctx->cached_dir_replace_type == illegal_char_replace_type && ctx->cached_dir_path_len < out_path_size)
     {
-        LOG_MSG_ERROR("Failed to retrieve RomFS directory path!");
-        goto end;
+        memcpy(out_path, ctx->cached_dir_path, ctx->cached_dir_path_len + 1);
+        path_len = ctx->cached_dir_path_len;
+    } else {
+        if (!romfsGeneratePathFromDirectoryEntry(ctx, dir_entry, out_path, out_path_size, illegal_char_replace_type))
+        {
+            LOG_MSG_ERROR("Failed to retrieve RomFS directory path!");
+            goto end;
+        }
+
+        path_len = strlen(out_path);
+
+        /* Update the cached directory path. */
+        if (path_len < sizeof(ctx->cached_dir_path))
+        {
+            memcpy(ctx->cached_dir_path, out_path, path_len + 1);
+            ctx->cached_dir_path_len = path_len;
+            ctx->cached_dir_offset = file_entry->parent_offset;
+            ctx->cached_dir_replace_type = illegal_char_replace_type;
+        }
     }
 
     /* Make sure the output buffer is big enough to hold the full path + NULL terminator. */
-    path_len = strlen(out_path);
     if ((path_len + 1 + file_entry->name_length) >= out_path_size)
     {
         LOG_MSG_ERROR("Output path length exceeds output buffer size! (%lu >= %lu).", path_len + 1 + file_entry->name_length, out_path_size);
@@ -589,14 +617,11 @@ bool romfsGeneratePathFromFileEntry(RomFileSystemContext *ctx, RomFileSystemFile
     }
 
     /* Concatenate path separator if our parent directory isn't the root directory. */
-    if (file_entry->parent_offset)
-    {
-        strcat(out_path, "/");
-        path_len++;
-    }
+    if (file_entry->parent_offset) out_path[path_len++] = '/';
 
     /* Concatenate file entry name. */
-    strncat(out_path, file_entry->name, file_entry->name_length);
+    memcpy(out_path + path_len, file_entry->name, file_entry->name_length);
+    out_path[path_len + file_entry->name_length] = '\0';
 
     /* Replace illegal characters within the file name, if needed. */
     if (illegal_char_replace_type) utilsReplaceIllegalCharacters(out_path + path_len, illegal_char_replace_type == RomFileSystemPathIllegalCharReplaceType_KeepAsciiCharsOnly);
@@ -627,6 +652,23 @@ bool romfsIsFileEntryUpdated(RomFileSystemContext *ctx, RomFileSystemFileEntry *
         goto end;
     }
 
+    /* Use the memoized classification bitmap, if available. */
+    if (romfsBuildUpdatedFileMemo(ctx))
+    {
+        u32 memo_idx = 0;
+
+        if (!romfsFindSortedOffsetIndex(ctx->updated_memo_offsets, ctx->updated_memo_count, (u64)((u8*)file_entry - (u8*)ctx->file_table), &memo_idx))
+        {
+            LOG_MSG_ERROR("Failed to retrieve updated file memo index! (0x%lX).", (u64)((u8*)file_entry - (u8*)ctx->file_table));
+            goto end;
+        }
+
+        *out = ((ctx->updated_memo_bitmap[memo_idx / 8] & BIT(memo_idx % 8)) != 0);
+        success = true;
+        goto end;
+    }
+
+    /* Fall back to an individual storage lookup. */
     /* Check if any sections from this block belong to the Patch storage. */
     if (!ncaStorageIsBlockWithinPatchStorageRange(ctx->default_storage_ctx, file_offset, file_entry->size, out))
     {
@@ -672,6 +714,359 @@ bool romfsGenerateFileEntryPatch(RomFileSystemContext *ctx, RomFileSystemFileEnt
     return success;
 }
 
+static bool romfsFillDataCache(RomFileSystemContext *ctx, u64 offset)
+{
+    if (offset >= ctx->size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    /* Clamp the cached span to the end of the RomFS. */
+    u64 cache_size = (ctx->size - offset);
+    if (cache_size > ROMFS_DATA_CACHE_SIZE) cache_size = ROMFS_DATA_CACHE_SIZE;
+
+    /* Allocate the data cache buffer, if needed. */
+    if (!ctx->data_cache && !(ctx->data_cache = malloc(ROMFS_DATA_CACHE_SIZE)))
+    {
+        LOG_MSG_ERROR("Failed to allocate 0x%X bytes for the RomFS data cache!", ROMFS_DATA_CACHE_SIZE);
+        return false;
+    }
+
+    /* Read the whole span in a single pass. */
+    if (!romfsReadFileSystemData(ctx, ctx->data_cache, cache_size, offset))
+    {
+        LOG_MSG_ERROR("Failed to read 0x%lX bytes long RomFS data span at offset 0x%lX!", cache_size, offset);
+        return false;
+    }
+
+    /* Update the cached span properties. */
+    ctx->data_cache_offset = offset;
+    ctx->data_cache_size = cache_size;
+
+    return true;
+}
+
+static bool romfsBuildDirectorySizeMemo(RomFileSystemContext *ctx)
+{
+    /* Return right away if the directory size memo has already been built. */
+    if (ctx->size_memo_offsets && ctx->dir_size_memo && ctx->size_memo_count) return true;
+
+    u64 entry_offset = 0, root_size = 0;
+    u32 entry_count = 0, entry_idx = 0;
+    RomFileSystemDirectoryEntry *root_entry = NULL;
+    bool success = false;
+
+    /* Count directory entries. */
+    while((entry_offset + sizeof(RomFileSystemDirectoryEntry)) <= ctx->dir_table_size)
+    {
+        RomFileSystemDirectoryEntry *dir_entry = romfsGetDirectoryEntryByOffset(ctx, entry_offset);
+        if (!dir_entry) return false;
+
+        entry_count++;
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemDirectoryEntry) + dir_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    if (!entry_count) return false;
+
+    /* Allocate memo buffers. */
+    ctx->size_memo_offsets = malloc(entry_count * sizeof(u64));
+    ctx->dir_size_memo = calloc(entry_count, sizeof(u64));
+
+    if (!ctx->size_memo_offsets || !ctx->dir_size_memo)
+    {
+        LOG_MSG_ERROR("Unable to allocate memory for the directory size memo! (%u entries).", entry_count);
+        goto end;
+    }
+
+    /* Fill the offsets table. The table walk yields offsets in ascending order, which makes it suitable for binary searches. */
+    entry_offset = 0;
+    while((entry_offset + sizeof(RomFileSystemDirectoryEntry)) <= ctx->dir_table_size)
+    {
+        RomFileSystemDirectoryEntry *dir_entry = romfsGetDirectoryEntryByOffset(ctx, entry_offset);
+        ctx->size_memo_offsets[entry_idx++] = entry_offset;
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemDirectoryEntry) + dir_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    ctx->size_memo_count = entry_count;
+
+    /* Get root directory entry. */
+    if (!(root_entry = romfsGetDirectoryEntryByOffset(ctx, 0)))
+    {
+        LOG_MSG_ERROR("Failed to retrieve root directory entry!");
+        goto end;
+    }
+
+    /* Calculate sizes for the whole directory tree in a single recursive traversal. */
+    if (!romfsComputeDirectorySizeMemo(ctx, root_entry, 0, &root_size))
+    {
+        LOG_MSG_ERROR("Failed to calculate directory sizes!");
+        goto end;
+    }
+
+    success = true;
+
+end:
+    if (!success)
+    {
+        if (ctx->size_memo_offsets)
+        {
+            free(ctx->size_memo_offsets);
+            ctx->size_memo_offsets = NULL;
+        }
+
+        if (ctx->dir_size_memo)
+        {
+            free(ctx->dir_size_memo);
+            ctx->dir_size_memo = NULL;
+        }
+
+        ctx->size_memo_count = 0;
+    }
+
+    return success;
+}
+
+static bool romfsComputeDirectorySizeMemo(RomFileSystemContext *ctx, RomFileSystemDirectoryEntry *dir_entry, u64 dir_entry_offset, u64 *out_size)
+{
+    RomFileSystemFileEntry *cur_file_entry = NULL;
+    RomFileSystemDirectoryEntry *cur_dir_entry = NULL;
+    u64 total_size = 0, cur_entry_offset = 0, child_dir_size = 0, *memo_slot = NULL;
+    bool success = false;
+
+    /* Loop through the child file entries' linked list. */
+    cur_entry_offset = dir_entry->file_offset;
+    while(cur_entry_offset != ROMFS_VOID_ENTRY)
+    {
+        /* Get current file entry. */
+        if (!(cur_file_entry = romfsGetFileEntryByOffset(ctx, cur_entry_offset)))
+        {
+            LOG_MSG_ERROR("Failed to retrieve file entry! (0x%lX, 0x%lX).", cur_entry_offset, ctx->file_table_size);
+            goto end;
+        }
+
+        /* Update total data size. */
+        total_size += cur_file_entry->size;
+
+        /* Update current file entry offset. */
+        cur_entry_offset = cur_file_entry->next_offset;
+    }
+
+    /* Loop through the child directory entries' linked list. */
+    cur_entry_offset = dir_entry->directory_offset;
+    while(cur_entry_offset != ROMFS_VOID_ENTRY)
+    {
+        /* Get current directory entry. */
+        if (!(cur_dir_entry = romfsGetDirectoryEntryByOffset(ctx, cur_entry_offset)))
+        {
+            LOG_MSG_ERROR("Failed to retrieve directory entry! (0x%lX, 0x%lX).", cur_entry_offset, ctx->dir_table_size);
+            goto end;
+        }
+
+        /* Calculate child directory size. */
+        if (!romfsComputeDirectorySizeMemo(ctx, cur_dir_entry, cur_entry_offset, &child_dir_size))
+        {
+            LOG_MSG_ERROR("Failed to get size for directory entry! (0x%lX, 0x%lX).", cur_entry_offset, ctx->dir_table_size);
+            goto end;
+        }
+
+        /* Update total data size. */
+        total_size += child_dir_size;
+
+        /* Update current directory entry offset. */
+        cur_entry_offset = cur_dir_entry->next_offset;
+    }
+
+    /* Store the calculated size into the memo slot for this directory entry. */
+    if (!(memo_slot = romfsGetDirectorySizeMemoSlot(ctx, dir_entry_offset)))
+    {
+        LOG_MSG_ERROR("Failed to retrieve directory size memo slot! (0x%lX).", dir_entry_offset);
+        goto end;
+    }
+
+    *memo_slot = total_size;
+
+    /* Update output values. */
+    *out_size = total_size;
+    success = true;
+
+end:
+    return success;
+}
+
+static u64 *romfsGetDirectorySizeMemoSlot(RomFileSystemContext *ctx, u64 dir_entry_offset)
+{
+    u32 memo_idx = 0;
+
+    if (!ctx->size_memo_offsets || !ctx->dir_size_memo || !ctx->size_memo_count || \
+        !romfsFindSortedOffsetIndex(ctx->size_memo_offsets, ctx->size_memo_count, dir_entry_offset, &memo_idx)) return NULL;
+
+    return &(ctx->dir_size_memo[memo_idx]);
+}
+
+static bool romfsBuildUpdatedFileMemo(RomFileSystemContext *ctx)
+{
+    /* Return right away if the updated file memo has already been built. */
+    if (ctx->updated_memo_offsets && ctx->updated_memo_bitmap && ctx->updated_memo_count) return true;
+
+    u64 entry_offset = 0;
+    u32 entry_count = 0, entry_idx = 0, range_count = 0;
+    RomFileSystemUpdatedFileRange *ranges = NULL;
+    BucketTreeBlockClassification *blocks = NULL;
+    bool success = false;
+
+    /* Count file entries. */
+    while((entry_offset + sizeof(RomFileSystemFileEntry)) <= ctx->file_table_size)
+    {
+        RomFileSystemFileEntry *file_entry = romfsGetFileEntryByOffset(ctx, entry_offset);
+        if (!file_entry) return false;
+
+        entry_count++;
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemFileEntry) + file_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    if (!entry_count) return false;
+
+    /* Allocate memo buffers and the transient file data ranges buffer. */
+    ctx->updated_memo_offsets = malloc(entry_count * sizeof(u64));
+    ctx->updated_memo_bitmap = calloc(DIVIDE_UP(entry_count, 8), sizeof(u8));
+    ranges = malloc(entry_count * sizeof(RomFileSystemUpdatedFileRange));
+
+    if (!ctx->updated_memo_offsets || !ctx->updated_memo_bitmap || !ranges)
+    {
+        LOG_MSG_ERROR("Unable to allocate memory for the updated file memo! (%u entries).", entry_count);
+        goto end;
+    }
+
+    /* Fill the offsets table and the file data ranges. The table walk yields offsets in ascending order, which makes it suitable for binary searches. */
+    /* Zero-sized file entries are skipped - they hold no data that could be affected by the Patch storage. */
+    entry_offset = 0;
+    while((entry_offset + sizeof(RomFileSystemFileEntry)) <= ctx->file_table_size)
+    {
+        RomFileSystemFileEntry *file_entry = romfsGetFileEntryByOffset(ctx, entry_offset);
+        ctx->updated_memo_offsets[entry_idx] = entry_offset;
+
+        if (file_entry->size && (file_entry->offset + file_entry->size) <= ctx->size)
+        {
+            ranges[range_count].data_offset = (ctx->offset + ctx->body_offset + file_entry->offset);
+            ranges[range_count].data_size = file_entry->size;
+            ranges[range_count].memo_idx = entry_idx;
+            range_count++;
+        }
+
+        entry_idx++;
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemFileEntry) + file_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    ctx->updated_memo_count = entry_count;
+
+    if (range_count)
+    {
+        /* Sort file data ranges by offset. File table order doesn't necessarily match file data order. */
+        if (range_count > 1) qsort(ranges, range_count, sizeof(RomFileSystemUpdatedFileRange), &romfsUpdatedFileRangeSortFunc);
+
+        /* Fill the block classification set. */
+        blocks = calloc(range_count, sizeof(BucketTreeBlockClassification));
+        if (!blocks)
+        {
+            LOG_MSG_ERROR("Unable to allocate memory for the block classification set! (%u blocks).", range_count);
+            goto end;
+        }
+
+        for(u32 i = 0; i < range_count; i++)
+        {
+            blocks[i].offset = ranges[i].data_offset;
+            blocks[i].size = ranges[i].data_size;
+        }
+
+        /* Classify all file data ranges against the Patch storage in a single pass. */
+        if (!ncaStorageClassifyBlocksWithinPatchStorageRange(ctx->default_storage_ctx, blocks, range_count))
+        {
+            LOG_MSG_ERROR("Failed to classify file data ranges against the Patch storage!");
+            goto end;
+        }
+
+        /* Propagate classification flags to the memo bitmap. */
+        for(u32 i = 0; i < range_count; i++)
+        {
+            if (blocks[i].updated) ctx->updated_memo_bitmap[ranges[i].memo_idx / 8] |= BIT(ranges[i].memo_idx % 8);
+        }
+    }
+
+    success = true;
+
+end:
+    if (blocks) free(blocks);
+
+    if (ranges) free(ranges);
+
+    if (!success)
+    {
+        if (ctx->updated_memo_offsets)
+        {
+            free(ctx->updated_memo_offsets);
+            ctx->updated_memo_offsets = NULL;
+        }
+
+        if (ctx->updated_memo_bitmap)
+        {
+            free(ctx->updated_memo_bitmap);
+            ctx->updated_memo_bitmap = NULL;
+        }
+
+        ctx->updated_memo_count = 0;
+    }
+
+    return success;
+}
+
+static int romfsUpdatedFileRangeSortFunc(const void *a, const void *b)
+{
+    const RomFileSystemUpdatedFileRange *range_1 = (const RomFileSystemUpdatedFileRange*)a;
+    const RomFileSystemUpdatedFileRange *range_2 = (const RomFileSystemUpdatedFileRange*)b;
+
+    if (range_1->data_offset < range_2->data_offset)
+    {
+        return -1;
+    } else
+    if (range_1->data_offset > range_2->data_offset)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+static bool romfsFindSortedOffsetIndex(const u64 *offsets, u32 count, u64 target, u32 *out_idx)
+{
+    if (!offsets || !count || !out_idx) return false;
+
+    /* Perform a binary search on the sorted offsets table. */
+    u32 lo = 0, hi = (count - 1);
+
+    while(lo <= hi)
+    {
+        u32 mid = (lo + ((hi - lo) / 2));
+        u64 cur_offset = offsets[mid];
+
+        if (cur_offset == target)
+        {
+            *out_idx = mid;
+            return true;
+        }
+
+        if (cur_offset < target)
+        {
+            lo = (mid + 1);
+        } else {
+            if (!mid) break;
+            hi = (mid - 1);
+        }
+    }
+
+    return false;
+}
+
 static RomFileSystemDirectoryEntry *romfsGetChildDirectoryEntryByName(RomFileSystemContext *ctx, RomFileSystemDirectoryEntry *dir_entry, const char *name)
 {
     u64 dir_offset = 0;
@@ -684,6 +1079,9 @@ static RomFileSystemDirectoryEntry *romfsGetChildDirectoryEntryByName(RomFileSys
         return NULL;
     }
 
+    /* Use the hash-indexed path lookup table, if available. */
+    if (romfsBuildPathIndex(ctx)) return (RomFileSystemDirectoryEntry*)romfsFindPathIndexEntry(ctx, (u64)((u8*)dir_entry - (u8*)ctx->dir_table), name, name_len, false);
+
     /* Loop through the child directory entries' linked list. */
     while(dir_offset != ROMFS_VOID_ENTRY)
     {
@@ -718,6 +1116,9 @@ static RomFileSystemFileEntry *romfsGetChildFileEntryByName(RomFileSystemContext
         return NULL;
     }
 
+    /* Use the hash-indexed path lookup table, if available. */
+    if (romfsBuildPathIndex(ctx)) return (RomFileSystemFileEntry*)romfsFindPathIndexEntry(ctx, (u64)((u8*)dir_entry - (u8*)ctx->dir_table), name, name_len, true);
+
     /* Loop through the child file entries' linked list. */
     while(file_offset != ROMFS_VOID_ENTRY)
     {
@@ -738,3 +1139,131 @@ static RomFileSystemFileEntry *romfsGetChildFileEntryByName(RomFileSystemContext
 
     return NULL;
 }
+
+static bool romfsBuildPathIndex(RomFileSystemContext *ctx)
+{
+    /* Return right away if the path index has already been built. */
+    if (ctx->path_index && ctx->path_index_capacity) return true;
+
+    u64 entry_offset = 0;
+    u32 entry_count = 0, capacity = 0;
+
+    /* Count directory entries. */
+    while((entry_offset + sizeof(RomFileSystemDirectoryEntry)) <= ctx->dir_table_size)
+    {
+        RomFileSystemDirectoryEntry *dir_entry = romfsGetDirectoryEntryByOffset(ctx, entry_offset);
+        if (!dir_entry) return false;
+
+        entry_count++;
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemDirectoryEntry) + dir_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    /* Count file entries. */
+    entry_offset = 0;
+    while((entry_offset + sizeof(RomFileSystemFileEntry)) <= ctx->file_table_size)
+    {
+        RomFileSystemFileEntry *file_entry = romfsGetFileEntryByOffset(ctx, entry_offset);
+        if (!file_entry) return false;
+
+        entry_count++;
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemFileEntry) + file_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    if (!entry_count) return false;
+
+    /* Calculate bucket count: the next power of two that keeps the load factor at (or below) 50%. */
+    capacity = 1;
+    while(capacity < (entry_count * 2)) capacity <<= 1;
+
+    /* Allocate and initialize path index. All buckets are set to ROMFS_PATH_INDEX_EMPTY. */
+    ctx->path_index = malloc(capacity * sizeof(u64));
+    if (!ctx->path_index)
+    {
+        LOG_MSG_ERROR("Unable to allocate memory for the path index! (%u buckets).", capacity);
+        return false;
+    }
+
+    memset(ctx->path_index, 0xFF, capacity * sizeof(u64));
+    ctx->path_index_capacity = capacity;
+
+    /* Insert directory entries. */
+    entry_offset = 0;
+    while((entry_offset + sizeof(RomFileSystemDirectoryEntry)) <= ctx->dir_table_size)
+    {
+        RomFileSystemDirectoryEntry *dir_entry = romfsGetDirectoryEntryByOffset(ctx, entry_offset);
+        romfsInsertPathIndexEntry(ctx, dir_entry->parent_offset, dir_entry->name, dir_entry->name_length, entry_offset, false);
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemDirectoryEntry) + dir_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    /* Insert file entries. */
+    entry_offset = 0;
+    while((entry_offset + sizeof(RomFileSystemFileEntry)) <= ctx->file_table_size)
+    {
+        RomFileSystemFileEntry *file_entry = romfsGetFileEntryByOffset(ctx, entry_offset);
+        romfsInsertPathIndexEntry(ctx, file_entry->parent_offset, file_entry->name, file_entry->name_length, entry_offset, true);
+        entry_offset += ALIGN_UP(sizeof(RomFileSystemFileEntry) + file_entry->name_length, ROMFS_TABLE_ENTRY_ALIGNMENT);
+    }
+
+    return true;
+}
+
+static void romfsInsertPathIndexEntry(RomFileSystemContext *ctx, u64 parent_offset, const char *name, size_t name_len, u64 entry_offset, bool is_file)
+{
+    u32 mask = (ctx->path_index_capacity - 1);
+    u32 idx = (romfsCalculatePathIndexHash(parent_offset, name, name_len) & mask);
+
+    /* Find a free bucket using linear probing. Guaranteed to succeed because the load factor never exceeds 50%. */
+    while(ctx->path_index[idx] != ROMFS_PATH_INDEX_EMPTY) idx = ((idx + 1) & mask);
+
+    ctx->path_index[idx] = (entry_offset | (is_file ? ROMFS_PATH_INDEX_FILE_FLAG : 0));
+}
+
+static void *romfsFindPathIndexEntry(RomFileSystemContext *ctx, u64 parent_offset, const char *name, size_t name_len, bool is_file)
+{
+    u32 mask = (ctx->path_index_capacity - 1);
+    u32 idx = (romfsCalculatePathIndexHash(parent_offset, name, name_len) & mask);
+
+    for(u32 probe = 0; probe <= mask; probe++, idx = ((idx + 1) & mask))
+    {
+        u64 bucket = ctx->path_index[idx];
+
+        /* An empty bucket means the requested entry doesn't exist. */
+        if (bucket == ROMFS_PATH_INDEX_EMPTY) break;
+
+        /* Skip buckets that don't match the requested entry type. */
+        if (((bucket & ROMFS_PATH_INDEX_FILE_FLAG) != 0) != is_file) continue;
+
+        u64 entry_offset = (bucket & 0xFFFFFFFFULL);
+
+        /* Compare parent offset and name to rule out hash collisions. */
+        /* strncmp() is used here instead of strcmp() because names stored in RomFS sections are not always NULL terminated. */
+        if (is_file)
+        {
+            RomFileSystemFileEntry *file_entry = romfsGetFileEntryByOffset(ctx, entry_offset);
+            if (file_entry && file_entry->parent_offset == parent_offset && file_entry->name_length == name_len && !strncmp(file_entry->name, name, name_len)) return file_entry;
+        } else {
+            RomFileSystemDirectoryEntry *dir_entry = romfsGetDirectoryEntryByOffset(ctx, entry_offset);
+            if (dir_entry && dir_entry->parent_offset == parent_offset && dir_entry->name_length == name_len && !strncmp(dir_entry->name, name, name_len)) return dir_entry;
+        }
+    }
+
+    return NULL;
+}
+
+NX_INLINE u32 romfsCalculatePathIndexHash(u64 parent_offset, const char *name, size_t name_len)
+{
+    /* 32-bit FNV-1a hash over the parent entry offset and the entry name. */
+    u32 hash = 0x811C9DC5;
+
+    for(u8 i = 0; i < 8; i++)
+    {
+        hash = ((hash ^ (u8)(parent_offset >> (i * 8))) * 0x1000193);
+    }
+
+    for(size_t i = 0; i < name_len; i++)
+    {
+        hash = ((hash ^ (u8)name[i]) * 0x1000193);
+    }
+
+    return hash;
+}
@@ -28,6 +28,51 @@
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/pk.h>
 
+#define RSA_PSS_VERIFY_QUEUE_SIZE       32
+#define RSA_PSS_VERIFY_KEY_CACHE_SIZE   8
+
+/* Type definitions. */
+
+/// Queued RSA-2048-PSS signature verification.
+typedef struct {
+    u8 hash[SHA256_HASH_SIZE];          ///< Precalculated SHA-256 checksum for the input data.
+    u8 signature[RSA2048_SIG_SIZE];     ///< Copy of the input signature.
+    const u8 *modulus;                  ///< Public key modulus. Must remain valid until this entry is processed.
+    const u8 *public_exponent;          ///< Public key exponent. Must remain valid until this entry is processed.
+    size_t public_exponent_size;        ///< Public key exponent size.
+    bool *out_result;                   ///< Where the verification result is written. Must remain valid until this entry is processed.
+} RsaPssVerifyQueueEntry;
+
+/// Cached RSA context. Reusing contexts between verifications that share the same public key makes mbedTLS carry out the Montgomery precomputation steps for each key only once.
+typedef struct {
+    mbedtls_rsa_context rsa;    ///< RSA context with imported public key data.
+    const u8 *modulus;          ///< Public key modulus used to initialize 'rsa'. NULL if this cache entry is unused.
+} RsaPssVerifyKeyCacheEntry;
+
+/* Global variables. */
+
+static Mutex g_rsaPssVerifyMutex = 0;
+static CondVar g_rsaPssVerifyCondVar = 0;
+
+static RsaPssVerifyQueueEntry g_rsaPssVerifyQueue[RSA_PSS_VERIFY_QUEUE_SIZE] = {0};
+static u32 g_rsaPssVerifyQueueHead = 0, g_rsaPssVerifyQueueCount = 0;
+static bool g_rsaPssVerifyInProgress = false;
+
+/// Only accessed by the verification thread - no locking needed.
+static RsaPssVerifyKeyCacheEntry g_rsaPssVerifyKeyCache[RSA_PSS_VERIFY_KEY_CACHE_SIZE] = {0};
+static u32 g_rsaPssVerifyKeyCacheNext = 0;
+
+static Thread g_rsaPssVerifyThread = {0};
+static UEvent g_rsaPssVerifyQueueEvent = {0}, g_rsaPssVerifyThreadExitEvent = {0};
+static bool g_rsaPssVerifyThreadCreated = false;
+
+/* Function prototypes. */
+
+static bool rsaCreatePssVerifyThread(void);
+static void rsaPssVerifyThreadFunc(void *arg);
+static bool rsaPssVerifyProcessQueueEntry(const RsaPssVerifyQueueEntry *entry);
+static mbedtls_rsa_context *rsaGetCachedRsaContext(const u8 *modulus, const u8 *public_exponent, size_t public_exponent_size);
+
 bool rsa2048VerifySha256BasedPssSignature(const void *data, size_t data_size, const void *signature, const void *modulus, const void *public_exponent, size_t public_exponent_size)
 {
     if (!data || !data_size || !signature || !modulus || !public_exponent || !public_exponent_size)
@@ -71,6 +116,82 @@ end:
     return ret;
 }
 
+bool rsa2048QueueSha256BasedPssSignatureVerification(const void *data, size_t data_size, const void *signature, const void *modulus, const void *public_exponent, size_t public_exponent_size, \
+                                                     bool *out_result)
+{
+    if (!data || !data_size || !signature || !modulus || !public_exponent || !public_exponent_size || !out_result)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    bool queued = false;
+
+    SCOPED_LOCK(&g_rsaPssVerifyMutex)
+    {
+        /* Create verification thread, if needed. */
+        if (!rsaCreatePssVerifyThread()) break;
+
+        /* Wait until there's room in the queue. The verification thread wakes us up after processing each entry. */
+        while(g_rsaPssVerifyQueueCount >= RSA_PSS_VERIFY_QUEUE_SIZE) condvarWait(&g_rsaPssVerifyCondVar, &g_rsaPssVerifyMutex);
+
+        /* Fill the next queue entry. */
+        /* The data checksum is calculated right away, so callers are free to modify the input buffer after we return. */
+        RsaPssVerifyQueueEntry *entry = &(g_rsaPssVerifyQueue[(g_rsaPssVerifyQueueHead + g_rsaPssVerifyQueueCount) % RSA_PSS_VERIFY_QUEUE_SIZE]);
+        sha256CalculateHash(entry->hash, data, data_size);
+        memcpy(entry->signature, signature, RSA2048_SIG_SIZE);
+        entry->modulus = (const u8*)modulus;
+        entry->public_exponent = (const u8*)public_exponent;
+        entry->public_exponent_size = public_exponent_size;
+        entry->out_result = out_result;
+
+        *out_result = false;
+        g_rsaPssVerifyQueueCount++;
+
+        /* Wake up the verification thread. */
+        ueventSignal(&g_rsaPssVerifyQueueEvent);
+
+        queued = true;
+    }
+
+    /* Fall back to a synchronous verification if the verification thread couldn't be created. */
+    if (!queued) *out_result = rsa2048VerifySha256BasedPssSignature(data, data_size, signature, modulus, public_exponent, public_exponent_size);
+
+    return true;
+}
+
+void rsa2048WaitForQueuedPssVerifications(void)
+{
+    SCOPED_LOCK(&g_rsaPssVerifyMutex)
+    {
+        if (!g_rsaPssVerifyThreadCreated) break;
+        while(g_rsaPssVerifyQueueCount || g_rsaPssVerifyInProgress) condvarWait(&g_rsaPssVerifyCondVar, &g_rsaPssVerifyMutex);
+    }
+}
+
+void rsaDestroyPssVerificationThread(void)
+{
+    bool thread_created = false;
+
+    SCOPED_LOCK(&g_rsaPssVerifyMutex) thread_created = g_rsaPssVerifyThreadCreated;
+    if (!thread_created) return;
+
+    /* Signal the exit event and wait for the verification thread to drain the queue and exit. */
+    ueventSignal(&g_rsaPssVerifyThreadExitEvent);
+    utilsJoinThread(&g_rsaPssVerifyThread);
+
+    SCOPED_LOCK(&g_rsaPssVerifyMutex) g_rsaPssVerifyThreadCreated = false;
+
+    /* Free cached RSA contexts. */
+    for(u32 i = 0; i < RSA_PSS_VERIFY_KEY_CACHE_SIZE; i++)
+    {
+        RsaPssVerifyKeyCacheEntry *cache_entry = &(g_rsaPssVerifyKeyCache[i]);
+        if (!cache_entry->modulus) continue;
+        mbedtls_rsa_free(&(cache_entry->rsa));
+        cache_entry->modulus = NULL;
+    }
+}
+
 bool rsa2048OaepDecrypt(void *dst, size_t dst_size, const void *signature, const void *modulus, const void *public_exponent, size_t public_exponent_size, const void *private_exponent, \
                         size_t private_exponent_size, const void *label, size_t label_size, size_t *out_size)
 {
@@ -135,3 +256,129 @@ end:
 
     return ret;
 }
+
+static bool rsaCreatePssVerifyThread(void)
+{
+    /* Called with g_rsaPssVerifyMutex held. */
+    if (g_rsaPssVerifyThreadCreated) return true;
+
+    /* Create usermode events. */
+    ueventCreate(&g_rsaPssVerifyQueueEvent, true);
+    ueventCreate(&g_rsaPssVerifyThreadExitEvent, true);
+
+    /* Create verification thread. */
+    g_rsaPssVerifyThreadCreated = utilsCreateThread(&g_rsaPssVerifyThread, rsaPssVerifyThreadFunc, NULL, 1);
+
+    return g_rsaPssVerifyThreadCreated;
+}
+
+static void rsaPssVerifyThreadFunc(void *arg)
+{
+    (void)arg;
+
+    Result rc = 0;
+    s32 idx = 0;
+
+    Waiter queue_event_waiter = waiterForUEvent(&g_rsaPssVerifyQueueEvent);
+    Waiter exit_event_waiter = waiterForUEvent(&g_rsaPssVerifyThreadExitEvent);
+
+    while(true)
+    {
+        /* Wait until an event is triggered. */
+        rc = waitMulti(&idx, -1, queue_event_waiter, exit_event_waiter);
+        if (R_FAILED(rc)) continue;
+
+        /* Exit event triggered? The queue is still drained before breaking out of the loop. */
+        bool exit_flag = (idx == 1);
+
+        /* Process queued verifications. */
+        while(true)
+        {
+            RsaPssVerifyQueueEntry entry = {0};
+            bool pending = false;
+
+            SCOPED_LOCK(&g_rsaPssVerifyMutex)
+            {
+                pending = (g_rsaPssVerifyQueueCount > 0);
+                if (!pending) break;
+
+                /* Pop the oldest queue entry. The expensive modexp is carried out with the mutex released, so other threads can keep queueing verifications in the meantime. */
+                memcpy(&entry, &(g_rsaPssVerifyQueue[g_rsaPssVerifyQueueHead]), sizeof(RsaPssVerifyQueueEntry));
+                g_rsaPssVerifyQueueHead = ((g_rsaPssVerifyQueueHead + 1) % RSA_PSS_VERIFY_QUEUE_SIZE);
+                g_rsaPssVerifyQueueCount--;
+                g_rsaPssVerifyInProgress = true;
+            }
+
+            if (!pending) break;
+
+            /* Verify signature and write the result back. */
+            *(entry.out_result) = rsaPssVerifyProcessQueueEntry(&entry);
+
+            /* Wake up any threads waiting for queue space or for the queue to be drained. */
+            SCOPED_LOCK(&g_rsaPssVerifyMutex)
+            {
+                g_rsaPssVerifyInProgress = false;
+                condvarWakeAll(&g_rsaPssVerifyCondVar);
+            }
+        }
+
+        if (exit_flag) break;
+    }
+
+    threadExit();
+}
+
+static bool rsaPssVerifyProcessQueueEntry(const RsaPssVerifyQueueEntry *entry)
+{
+    /* Retrieve a RSA context for this public key. */
+    mbedtls_rsa_context *rsa = rsaGetCachedRsaContext(entry->modulus, entry->public_exponent, entry->public_exponent_size);
+    if (!rsa) return false;
+
+    /* Verify signature. */
+    int mbedtls_ret = mbedtls_rsa_rsassa_pss_verify(rsa, NULL, NULL, MBEDTLS_RSA_PUBLIC, MBEDTLS_MD_SHA256, SHA256_HASH_SIZE, entry->hash, entry->signature);
+    if (mbedtls_ret != 0)
+    {
+        LOG_MSG_ERROR("mbedtls_rsa_rsassa_pss_verify failed! (%d).", mbedtls_ret);
+        return false;
+    }
+
+    return true;
+}
+
+static mbedtls_rsa_context *rsaGetCachedRsaContext(const u8 *modulus, const u8 *public_exponent, size_t public_exponent_size)
+{
+    RsaPssVerifyKeyCacheEntry *cache_entry = NULL;
+    int mbedtls_ret = 0;
+
+    /* Check if we already hold an initialized RSA context for this public key. */
+    for(u32 i = 0; i < RSA_PSS_VERIFY_KEY_CACHE_SIZE; i++)
+    {
+        cache_entry = &(g_rsaPssVerifyKeyCache[i]);
+        if (cache_entry->modulus && !memcmp(cache_entry->modulus, modulus, RSA2048_BYTES)) return &(cache_entry->rsa);
+    }
+
+    /* Initialize a new RSA context for this public key, replacing the oldest cache entry if needed. */
+    cache_entry = &(g_rsaPssVerifyKeyCache[g_rsaPssVerifyKeyCacheNext]);
+
+    if (cache_entry->modulus)
+    {
+        mbedtls_rsa_free(&(cache_entry->rsa));
+        cache_entry->modulus = NULL;
+    }
+
+    mbedtls_rsa_init(&(cache_entry->rsa), MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
+
+    /* Import RSA parameters. */
+    mbedtls_ret = mbedtls_rsa_import_raw(&(cache_entry->rsa), modulus, RSA2048_BYTES, NULL, 0, NULL, 0, NULL, 0, public_exponent, public_exponent_size);
+    if (mbedtls_ret != 0)
+    {
+        LOG_MSG_ERROR("mbedtls_rsa_import_raw failed! (%d).", mbedtls_ret);
+        mbedtls_rsa_free(&(cache_entry->rsa));
+        return NULL;
+    }
+
+    cache_entry->modulus = modulus;
+    g_rsaPssVerifyKeyCacheNext = ((g_rsaPssVerifyKeyCacheNext + 1) % RSA_PSS_VERIFY_KEY_CACHE_SIZE);
+
+    return &(cache_entry->rsa);
+}
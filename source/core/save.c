@@ -104,9 +104,18 @@ static u32 save_duplex_storage_read(duplex_storage_ctx_t *ctx, void *buffer, u64
     {
         u32 block_num = (u32)(in_pos / ctx->block_size);
         u32 block_pos = (u32)(in_pos % ctx->block_size);
+
+        bool use_data_b = (save_bitmap_check_bit(ctx->bitmap.bitmap, block_num) != 0);
         u32 bytes_to_read = ((ctx->block_size - block_pos) < remaining ? (ctx->block_size - block_pos) : remaining);
 
-        u8 *data = (save_bitmap_check_bit(ctx->bitmap.bitmap, block_num) ? ctx->data_b : ctx->data_a);
+        /* Extend the copy across consecutive blocks backed by the same data file - the bitmap rarely alternates on every block. */
+        for(u32 next_block = (block_num + 1); bytes_to_read < remaining && (save_bitmap_check_bit(ctx->bitmap.bitmap, next_block) != 0) == use_data_b; next_block++)
+        {
+            u32 extra = (ctx->block_size < (remaining - bytes_to_read) ? ctx->block_size : (remaining - bytes_to_read));
+            bytes_to_read += extra;
+        }
+
+        u8 *data = (use_data_b ? ctx->data_b : ctx->data_a);
         memcpy((u8*)buffer + out_pos, data + in_pos, bytes_to_read);
 
         out_pos += bytes_to_read;
@@ -775,6 +784,41 @@ static bool save_allocation_table_iterator_seek(allocation_table_iterator_ctx_t
     }
 }
 
+static void save_allocation_table_storage_build_extents(allocation_table_storage_ctx_t *ctx)
+{
+    ctx->extent_count = 0;
+
+    allocation_table_iterator_ctx_t iterator = {0};
+    if (!save_allocation_table_iterator_begin(&iterator, ctx->fat, ctx->initial_block))
+    {
+        LOG_MSG_ERROR("Failed to initialize FAT interator!");
+        return;
+    }
+
+    u32 count = 0;
+
+    while(true)
+    {
+        /* Bail out if the chain is too fragmented to fit in the extent map. Reads will fall back to per-access chain iteration. */
+        if (count >= SAVE_FAT_STORAGE_MAX_EXTENTS) return;
+
+        ctx->extents[count].virtual_block = iterator.virtual_block;
+        ctx->extents[count].physical_block = iterator.physical_block;
+        ctx->extents[count].block_count = iterator.current_segment_size;
+        count++;
+
+        if (iterator.next_block == 0xFFFFFFFF) break;
+
+        if (!save_allocation_table_iterator_move_next(&iterator))
+        {
+            LOG_MSG_ERROR("Failed to iterate to the next FAT storage segment!");
+            return;
+        }
+    }
+
+    ctx->extent_count = count;
+}
+
 u32 save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void *buffer, u64 offset, size_t count)
 {
     if (!ctx || !ctx->fat || !ctx->block_size || !buffer || !count)
@@ -783,12 +827,8 @@ u32 save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void
         return 0;
     }
 
-    allocation_table_iterator_ctx_t iterator;
-    if (!save_allocation_table_iterator_begin(&iterator, ctx->fat, ctx->initial_block))
-    {
-        LOG_MSG_ERROR("Failed to initialize FAT interator!");
-        return 0;
-    }
+    allocation_table_iterator_ctx_t iterator = {0};
+    bool iterator_initialized = false;
 
     u64 in_pos = offset;
     u32 out_pos = 0;
@@ -797,16 +837,59 @@ u32 save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void
     while(remaining)
     {
         u32 block_num = (u32)(in_pos / ctx->block_size);
-        if (!save_allocation_table_iterator_seek(&iterator, block_num))
+        u32 virtual_block = 0, physical_block = 0, segment_size = 0;
+
+        if (ctx->extent_count)
         {
-            LOG_MSG_ERROR("Failed to seek to block #%u within offset 0x%lX!", block_num, offset);
-            return out_pos;
+            /* Use the extent map precomputed by save_open_fat_storage() to locate the segment holding the current block. */
+            const allocation_table_extent_t *extent = NULL;
+
+            for(u32 i = 0; i < ctx->extent_count; i++)
+            {
+                if (block_num >= ctx->extents[i].virtual_block && block_num < (ctx->extents[i].virtual_block + ctx->extents[i].block_count))
+                {
+                    extent = &(ctx->extents[i]);
+                    break;
+                }
+            }
+
+            if (!extent)
+            {
+                LOG_MSG_ERROR("Failed to locate extent for block #%u within offset 0x%lX!", block_num, offset);
+                return out_pos;
+            }
+
+            virtual_block = extent->virtual_block;
+            physical_block = extent->physical_block;
+            segment_size = extent->block_count;
+        } else {
+            /* No extent map available. Chase the allocation table chain. */
+            if (!iterator_initialized)
+            {
+                if (!save_allocation_table_iterator_begin(&iterator, ctx->fat, ctx->initial_block))
+                {
+                    LOG_MSG_ERROR("Failed to initialize FAT interator!");
+                    return 0;
+                }
+
+                iterator_initialized = true;
+            }
+
+            if (!save_allocation_table_iterator_seek(&iterator, block_num))
+            {
+                LOG_MSG_ERROR("Failed to seek to block #%u within offset 0x%lX!", block_num, offset);
+                return out_pos;
+            }
+
+            virtual_block = iterator.virtual_block;
+            physical_block = iterator.physical_block;
+            segment_size = iterator.current_segment_size;
         }
 
-        u32 segment_pos = (u32)(in_pos - ((u64)iterator.virtual_block * ctx->block_size));
-        u64 physical_offset = ((iterator.physical_block * ctx->block_size) + segment_pos);
+        u32 segment_pos = (u32)(in_pos - ((u64)virtual_block * ctx->block_size));
+        u64 physical_offset = ((physical_block * ctx->block_size) + segment_pos);
 
-        u32 remaining_in_segment = ((iterator.current_segment_size * ctx->block_size) - segment_pos);
+        u32 remaining_in_segment = ((segment_size * ctx->block_size) - segment_pos);
         u32 bytes_to_read = (remaining < remaining_in_segment ? remaining : remaining_in_segment);
 
         u32 sector_size = ctx->base_storage->integrity_storages[3].sector_size;
@@ -854,6 +937,145 @@ static u32 save_fs_list_get_capacity(save_filesystem_list_ctx_t *ctx)
     return ctx->capacity;
 }
 
+#define SAVE_FS_LIST_INDEX_EMPTY    UINT64_MAX  /* Marks an unused FS entry lookup index bucket. */
+
+static u32 save_fs_list_calculate_key_hash(u32 parent, const char *name)
+{
+    /* 32-bit FNV-1a hash over the parent index and the entry name. */
+    u32 hash = 0x811C9DC5;
+    const u8 *parent_data = (const u8*)&parent;
+
+    for(u8 i = 0; i < (u8)sizeof(parent); i++)
+    {
+        hash ^= parent_data[i];
+        hash *= 0x1000193;
+    }
+
+    for(u8 i = 0; i < SAVE_FS_LIST_MAX_NAME_LENGTH && name[i]; i++)
+    {
+        hash ^= (u8)name[i];
+        hash *= 0x1000193;
+    }
+
+    return hash;
+}
+
+static void save_fs_list_free_index(save_filesystem_list_ctx_t *ctx)
+{
+    if (!ctx) return;
+
+    if (ctx->cached_entries)
+    {
+        free(ctx->cached_entries);
+        ctx->cached_entries = NULL;
+    }
+
+    if (ctx->lookup_index)
+    {
+        free(ctx->lookup_index);
+        ctx->lookup_index = NULL;
+    }
+
+    ctx->lookup_capacity = 0;
+}
+
+static bool save_fs_list_build_index(save_filesystem_list_ctx_t *ctx)
+{
+    if (!ctx)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    u32 used_count = 0, lookup_capacity = 0;
+    bool success = false;
+
+    u32 capacity = save_fs_list_get_capacity(ctx);
+    if (!capacity)
+    {
+        LOG_MSG_ERROR("Failed to retrieve FS capacity!");
+        return false;
+    }
+
+    /* Read the whole entry list into memory in a single pass. */
+    ctx->cached_entries = calloc(capacity, SAVE_FS_LIST_ENTRY_SIZE);
+    if (!ctx->cached_entries)
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the cached FS entry list! (%u entries).", capacity);
+        goto end;
+    }
+
+    if (save_allocation_table_storage_read(&ctx->storage, ctx->cached_entries, 0, (u64)capacity * SAVE_FS_LIST_ENTRY_SIZE) != ((u64)capacity * SAVE_FS_LIST_ENTRY_SIZE))
+    {
+        LOG_MSG_ERROR("Failed to read full FS entry list from FAT storage!");
+        goto end;
+    }
+
+    if (ctx->used_list_head_index >= capacity)
+    {
+        LOG_MSG_ERROR("Used list head index %u out of range!", ctx->used_list_head_index);
+        goto end;
+    }
+
+    /* Count used entries by walking the used entry linked list. */
+    u32 index = ctx->cached_entries[ctx->used_list_head_index].next;
+
+    while(index)
+    {
+        if (index >= capacity)
+        {
+            LOG_MSG_ERROR("Save entry index %u out of range!", index);
+            goto end;
+        }
+
+        used_count++;
+        index = ctx->cached_entries[index].next;
+    }
+
+    /* Calculate bucket count: the next power of two that keeps the load factor at (or below) 50%. */
+    lookup_capacity = 1;
+    while(lookup_capacity < ((used_count + 1) * 2)) lookup_capacity <<= 1;
+
+    /* Allocate and initialize the lookup index. All buckets are set to SAVE_FS_LIST_INDEX_EMPTY. */
+    ctx->lookup_index = malloc(lookup_capacity * sizeof(u64));
+    if (!ctx->lookup_index)
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the FS entry lookup index! (%u buckets).", lookup_capacity);
+        goto end;
+    }
+
+    memset(ctx->lookup_index, 0xFF, lookup_capacity * sizeof(u64));
+    ctx->lookup_capacity = lookup_capacity;
+
+    /* Insert used entries into the lookup index using linear probing. */
+    index = ctx->cached_entries[ctx->used_list_head_index].next;
+
+    while(index)
+    {
+        save_fs_list_entry_t *entry = &(ctx->cached_entries[index]);
+
+        u32 hash = save_fs_list_calculate_key_hash(entry->parent, entry->name);
+
+        for(u32 i = 0; i < lookup_capacity; i++)
+        {
+            u64 *bucket = &(ctx->lookup_index[(hash + i) & (lookup_capacity - 1)]);
+            if (*bucket != SAVE_FS_LIST_INDEX_EMPTY) continue;
+
+            *bucket = index;
+            break;
+        }
+
+        index = entry->next;
+    }
+
+    success = true;
+
+end:
+    if (!success) save_fs_list_free_index(ctx);
+
+    return success;
+}
+
 static u32 save_fs_list_read_entry(save_filesystem_list_ctx_t *ctx, u32 index, save_fs_list_entry_t *entry)
 {
     if (!ctx || !entry)
@@ -862,6 +1084,13 @@ static u32 save_fs_list_read_entry(save_filesystem_list_ctx_t *ctx, u32 index, s
         return 0;
     }
 
+    /* Serve the read from the cached entry list, if available. */
+    if (ctx->cached_entries && index < ctx->capacity)
+    {
+        memcpy(entry, &(ctx->cached_entries[index]), SAVE_FS_LIST_ENTRY_SIZE);
+        return SAVE_FS_LIST_ENTRY_SIZE;
+    }
+
     u32 ret = save_allocation_table_storage_read(&ctx->storage, entry, index * SAVE_FS_LIST_ENTRY_SIZE, SAVE_FS_LIST_ENTRY_SIZE);
     if (ret != SAVE_FS_LIST_ENTRY_SIZE)
     {
@@ -905,6 +1134,7 @@ bool save_fs_list_get_value(save_filesystem_list_ctx_t *ctx, u32 index, save_fs_
 u32 save_fs_list_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t *key, u32 *prev_index)
 {
     u32 prev;
+    bool use_lookup_index = (prev_index == NULL);
     if (!prev_index) prev_index = &prev;
 
     if (!ctx || !key)
@@ -920,6 +1150,25 @@ u32 save_fs_list_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_
         goto end;
     }
 
+    /* Use the hash-indexed lookup table, if available. */
+    /* The lookup index can't provide the previous used list entry, so this path is only taken if the caller doesn't request it. */
+    if (use_lookup_index && ctx->cached_entries && ctx->lookup_index && ctx->lookup_capacity)
+    {
+        u32 hash = save_fs_list_calculate_key_hash(key->parent, key->name);
+
+        for(u32 i = 0; i < ctx->lookup_capacity; i++)
+        {
+            u64 bucket = ctx->lookup_index[(hash + i) & (ctx->lookup_capacity - 1)];
+            if (bucket == SAVE_FS_LIST_INDEX_EMPTY) break;
+
+            save_fs_list_entry_t *cached_entry = &(ctx->cached_entries[(u32)bucket]);
+            if (cached_entry->parent == key->parent && !strcmp(cached_entry->name, key->name)) return (u32)bucket;
+        }
+
+        LOG_MSG_ERROR("Unable to find FS index from key!");
+        goto end;
+    }
+
     save_fs_list_entry_t entry;
     if (!save_fs_list_read_entry(ctx, ctx->used_list_head_index, &entry))
     {
@@ -1033,6 +1282,7 @@ bool save_open_fat_storage(save_filesystem_ctx_t *ctx, allocation_table_storage_
     storage_ctx->fat = &ctx->allocation_table;
     storage_ctx->block_size = (u32)ctx->header->block_size;
     storage_ctx->initial_block = block_index;
+    storage_ctx->extent_count = 0;
 
     if (block_index == 0xFFFFFFFF)
     {
@@ -1046,6 +1296,9 @@ bool save_open_fat_storage(save_filesystem_ctx_t *ctx, allocation_table_storage_
         }
 
         storage_ctx->_length = (fat_list_length * storage_ctx->block_size);
+
+        /* Walk the allocation table chain once and build an extent map, so subsequent reads can locate physical blocks through direct offset arithmetic. */
+        save_allocation_table_storage_build_extents(storage_ctx);
     }
 
     return true;
@@ -1084,6 +1337,233 @@ static bool save_filesystem_init(save_filesystem_ctx_t *ctx, void *fat, save_fs_
     return true;
 }
 
+#define SAVE_IVFC_VERIFY_THREAD_COUNT   2   /* Number of hash worker threads spawned by save_ivfc_validate_level_parallel(). */
+#define SAVE_IVFC_VERIFY_RING_SIZE      8   /* Number of in-flight hash block jobs. */
+#define SAVE_IVFC_VERIFY_MIN_BLOCKS     8   /* IVFC levels with fewer hash blocks than this are verified serially. */
+
+typedef struct {
+    u8 *data;               /* Salt (0x20 bytes) + sector data. */
+    u8 expected_hash[0x20];
+    u32 block_index;
+    u8 state;               /* 0: free, 1: ready, 2: being hashed. */
+} save_ivfc_verify_slot_t;
+
+typedef struct {
+    integrity_verification_storage_ctx_t *storage;
+    save_ivfc_verify_slot_t slots[SAVE_IVFC_VERIFY_RING_SIZE];
+    Mutex mutex;
+    CondVar producer_cv;
+    CondVar worker_cv;
+    bool done;
+} save_ivfc_verify_pool_t;
+
+static void save_ivfc_verify_worker_func(void *arg)
+{
+    save_ivfc_verify_pool_t *pool = (save_ivfc_verify_pool_t*)arg;
+    integrity_verification_storage_ctx_t *storage = pool->storage;
+
+    while(true)
+    {
+        save_ivfc_verify_slot_t *slot = NULL;
+
+        /* Wait for a hash block job, or for the producer to flag the queue as exhausted. */
+        mutexLock(&pool->mutex);
+
+        while(true)
+        {
+            for(u32 i = 0; i < SAVE_IVFC_VERIFY_RING_SIZE; i++)
+            {
+                if (pool->slots[i].state == 1)
+                {
+                    slot = &pool->slots[i];
+                    break;
+                }
+            }
+
+            if (slot || pool->done) break;
+
+            condvarWait(&pool->worker_cv, &pool->mutex);
+        }
+
+        if (!slot)
+        {
+            mutexUnlock(&pool->mutex);
+            break;
+        }
+
+        slot->state = 2;
+        mutexUnlock(&pool->mutex);
+
+        /* Hash the salted block data. This is the part that benefits from the hardware-accelerated SHA-256 context on each core. */
+        u8 hash[0x20] = {0};
+        sha256CalculateHash(hash, slot->data, storage->sector_size + 0x20);
+        hash[0x1F] |= 0x80;
+
+        /* Block validity slots are disjoint between jobs, so no locking is needed here. */
+        storage->block_validities[slot->block_index] = (!memcmp(slot->expected_hash, hash, 0x20) ? VALIDITY_VALID : VALIDITY_INVALID);
+
+        /* Release the slot and wake up the producer. */
+        mutexLock(&pool->mutex);
+        slot->state = 0;
+        mutexUnlock(&pool->mutex);
+        condvarWakeAll(&pool->producer_cv);
+    }
+
+    threadExit();
+}
+
+static validity_t save_ivfc_validate_level_parallel(hierarchical_integrity_verification_storage_ctx_t *ctx, ivfc_save_hdr_t *ivfc, u32 level)
+{
+    integrity_verification_storage_ctx_t *storage = &ctx->integrity_storages[level];
+
+    u64 block_size = storage->sector_size;
+    u32 block_count = (u32)((storage->_length + block_size - 1) / block_size);
+
+    validity_t result = VALIDITY_VALID;
+
+    save_ivfc_verify_pool_t pool = {0};
+    Thread threads[SAVE_IVFC_VERIFY_THREAD_COUNT] = {0};
+    u32 thread_count = 0, slot_count = 0;
+
+    u8 zeroes[0x20] = {0};
+
+    pool.storage = storage;
+    mutexInit(&pool.mutex);
+    condvarInit(&pool.producer_cv);
+    condvarInit(&pool.worker_cv);
+
+    /* Allocate slot buffers and prefill the level salt. */
+    for(slot_count = 0; slot_count < SAVE_IVFC_VERIFY_RING_SIZE; slot_count++)
+    {
+        if (!(pool.slots[slot_count].data = calloc(1, block_size + 0x20)))
+        {
+            LOG_MSG_ERROR("Failed to allocate memory for hash block job buffer!");
+            result = VALIDITY_INVALID;
+            goto end;
+        }
+
+        memcpy(pool.slots[slot_count].data, storage->salt, 0x20);
+    }
+
+    /* Spawn hash worker threads. */
+    for(thread_count = 0; thread_count < SAVE_IVFC_VERIFY_THREAD_COUNT; thread_count++)
+    {
+        if (!utilsCreateThread(&(threads[thread_count]), save_ivfc_verify_worker_func, &pool, 2))
+        {
+            LOG_MSG_ERROR("Failed to spawn hash worker thread #%u!", thread_count);
+            result = VALIDITY_INVALID;
+            goto end;
+        }
+    }
+
+    /* Loop through all hash blocks in this level. Savefile I/O isn't thread-safe, so all reads stay on this thread while the workers hash previously read blocks. */
+    for(u32 j = 0; j < block_count && result != VALIDITY_INVALID; j++)
+    {
+        if (ctx->level_validities[ivfc->num_levels - 2][j] != VALIDITY_UNCHECKED)
+        {
+            if (ctx->level_validities[ivfc->num_levels - 2][j] == VALIDITY_INVALID) result = VALIDITY_INVALID;
+            continue;
+        }
+
+        /* Read the expected hash for this block, validating the upper levels on the way. */
+        u8 expected_hash[0x20] = {0};
+        u64 hash_pos = ((u64)j * 0x20);
+
+        if (storage->next_level)
+        {
+            if (!save_ivfc_storage_read(storage->next_level, expected_hash, hash_pos, 0x20, 1))
+            {
+                LOG_MSG_ERROR("Failed to read hash from next IVFC level!");
+                result = VALIDITY_INVALID;
+                break;
+            }
+        } else {
+            if (save_ivfc_level_fread(storage->hash_storage, expected_hash, hash_pos, 0x20) != 0x20)
+            {
+                LOG_MSG_ERROR("Failed to read hash from hash storage!");
+                result = VALIDITY_INVALID;
+                break;
+            }
+        }
+
+        /* An all-zeroes hash covers unused space, which is always valid. */
+        if (!memcmp(expected_hash, zeroes, 0x20))
+        {
+            storage->block_validities[j] = VALIDITY_VALID;
+            continue;
+        }
+
+        /* Claim a free job slot. */
+        save_ivfc_verify_slot_t *slot = NULL;
+
+        mutexLock(&pool.mutex);
+
+        while(true)
+        {
+            for(u32 i = 0; i < SAVE_IVFC_VERIFY_RING_SIZE; i++)
+            {
+                if (pool.slots[i].state == 0)
+                {
+                    slot = &pool.slots[i];
+                    break;
+                }
+            }
+
+            if (slot) break;
+
+            condvarWait(&pool.producer_cv, &pool.mutex);
+        }
+
+        mutexUnlock(&pool.mutex);
+
+        /* Read the raw block data into the slot buffer. */
+        u32 to_read = ((storage->_length - (block_size * j)) < block_size ? (storage->_length - (block_size * j)) : block_size);
+        memset(slot->data + 0x20, 0, block_size);
+
+        if (save_ivfc_level_fread(storage->base_storage, slot->data + 0x20, block_size * j, to_read) != to_read)
+        {
+            LOG_MSG_ERROR("Failed to read IVFC level from base storage!");
+            result = VALIDITY_INVALID;
+            break;
+        }
+
+        memcpy(slot->expected_hash, expected_hash, 0x20);
+        slot->block_index = j;
+
+        /* Publish the job and wake up the workers. */
+        mutexLock(&pool.mutex);
+        slot->state = 1;
+        mutexUnlock(&pool.mutex);
+        condvarWakeAll(&pool.worker_cv);
+    }
+
+end:
+    /* Flag the job queue as exhausted, then wait for the workers to drain it and exit. */
+    mutexLock(&pool.mutex);
+    pool.done = true;
+    mutexUnlock(&pool.mutex);
+    condvarWakeAll(&pool.worker_cv);
+
+    for(u32 i = 0; i < thread_count; i++) utilsJoinThread(&(threads[i]));
+
+    /* Check the block validities written by the workers. */
+    if (result != VALIDITY_INVALID)
+    {
+        for(u32 j = 0; j < block_count; j++)
+        {
+            if (storage->block_validities[j] == VALIDITY_INVALID)
+            {
+                result = VALIDITY_INVALID;
+                break;
+            }
+        }
+    }
+
+    for(u32 i = 0; i < slot_count; i++) free(pool.slots[i].data);
+
+    return result;
+}
+
 static validity_t save_ivfc_validate(hierarchical_integrity_verification_storage_ctx_t *ctx, ivfc_save_hdr_t *ivfc)
 {
     if (!ctx || !ivfc || !ivfc->num_levels)
@@ -1101,6 +1581,13 @@ static validity_t save_ivfc_validate(hierarchical_integrity_verification_storage
         u64 block_size = storage->sector_size;
         u32 block_count = (u32)((storage->_length + block_size - 1) / block_size);
 
+        /* Fan independent hash block checks across a worker pool for levels big enough to amortize the thread setup. */
+        if (block_count >= SAVE_IVFC_VERIFY_MIN_BLOCKS)
+        {
+            result = save_ivfc_validate_level_parallel(ctx, ivfc, i);
+            continue;
+        }
+
         u8 *buffer = calloc(1, block_size);
         if (!buffer)
         {
@@ -1549,6 +2036,10 @@ bool save_process(save_ctx_t *ctx)
         goto end;
     }
 
+    /* Build in-memory FS entry list indexes. Failures aren't fatal - lookups simply fall back to individual FAT storage reads. */
+    save_fs_list_build_index(&ctx->save_filesystem_core.file_table.directory_table);
+    save_fs_list_build_index(&ctx->save_filesystem_core.file_table.file_table);
+
     success = true;
 
 end:
@@ -1593,6 +2084,9 @@ void save_free_contexts(save_ctx_t *ctx)
 {
     if (!ctx) return;
 
+    save_fs_list_free_index(&ctx->save_filesystem_core.file_table.directory_table);
+    save_fs_list_free_index(&ctx->save_filesystem_core.file_table.file_table);
+
     if (ctx->data_remap_storage.segments)
     {
         if (ctx->data_remap_storage.header)
@@ -1718,6 +2212,47 @@ void save_free_contexts(save_ctx_t *ctx)
     }
 }
 
+#define SAVE_INITIAL_CLMT_ITEM_COUNT 64 /* Initial cluster link map table size. Grown on demand for heavily fragmented savefiles. */
+
+static void save_create_cluster_link_map(FIL *fd)
+{
+    FRESULT fr = FR_OK;
+    DWORD *cltbl = NULL, *tmp = NULL;
+    DWORD item_count = SAVE_INITIAL_CLMT_ITEM_COUNT;
+
+    /* Attach a cluster link map table (CLMT) to the provided file descriptor to enable FatFs fast seek mode. */
+    /* Savefile processing is dominated by small random reads; without the map, every f_lseek() walks the cluster chain from the start of the file. */
+    cltbl = malloc(item_count * sizeof(DWORD));
+    if (!cltbl) return;
+
+    cltbl[0] = item_count;
+    fd->cltbl = cltbl;
+
+    fr = f_lseek(fd, CREATE_LINKMAP);
+    if (fr == FR_NOT_ENOUGH_CORE)
+    {
+        /* The required item count is returned through the first table entry. Retry once with a right-sized table. */
+        item_count = cltbl[0];
+
+        tmp = realloc(cltbl, item_count * sizeof(DWORD));
+        if (tmp)
+        {
+            cltbl = tmp;
+            cltbl[0] = item_count;
+            fd->cltbl = cltbl;
+            fr = f_lseek(fd, CREATE_LINKMAP);
+        }
+    }
+
+    if (fr != FR_OK)
+    {
+        /* Fast seek is just an optimization - fall back to regular cluster chain walks. */
+        LOG_MSG_DEBUG("Unable to create cluster link map table (%u). Falling back to regular seeks.", fr);
+        fd->cltbl = NULL;
+        free(cltbl);
+    }
+}
+
 save_ctx_t *save_open_savefile(const char *path, u32 action)
 {
     if (!path || !*path)
@@ -1747,6 +2282,9 @@ save_ctx_t *save_open_savefile(const char *path, u32 action)
 
     open_savefile = true;
 
+    /* Enable fast seek mode. */
+    save_create_cluster_link_map(save_fd);
+
     /* Code to dump the requested file in its entirety. Useful to retrieve protected system savefiles without exiting HOS. */
     /*char sd_path[FS_MAX_PATH] = {0};
     sprintf(sd_path, DEVOPTAB_SDMC_DEVICE "/%s", strrchr(path, '/') + 1);
@@ -1803,6 +2341,7 @@ end:
         if (save_fd)
         {
             if (open_savefile) f_close(save_fd);
+            if (save_fd->cltbl) free(save_fd->cltbl);
             free(save_fd);
         }
     }
@@ -1817,6 +2356,7 @@ void save_close_savefile(save_ctx_t *ctx)
     if (ctx->file)
     {
         f_close(ctx->file);
+        if (ctx->file->cltbl) free(ctx->file->cltbl);
         free(ctx->file);
     }
 
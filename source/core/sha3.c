@@ -24,7 +24,12 @@
 #include "nxdt_utils.h"
 #include "sha3.h"
 
-#define SHA3_NUM_ROUNDS 24
+#define SHA3_NUM_ROUNDS         24
+#define SHA3_NUM_RHO_PI_STEPS   24
+#define SHA3_STATE_WORDS        (SHA3_INTERNAL_STATE_SIZE / sizeof(u64))
+
+/// Branch-free left rotation. The shift amount must be within the (0, 64) range, which holds true for every rotation carried out by the permutation.
+#define SHA3_ROTL_U64(x, s)     (((x) << (s)) | ((x) >> (64 - (s))))
 
 #define _SHA3_CTX_OPS(bits) \
 void sha3##bits##ContextCreate(Sha3Context *out) { \
@@ -54,13 +59,13 @@ static const u64 g_iotaRoundConstant[SHA3_NUM_ROUNDS] = {
     0x0000000080000001, 0x8000000080008008
 };
 
-static const int g_rhoShiftBit[SHA3_NUM_ROUNDS] = {
+static const int g_rhoShiftBit[SHA3_NUM_RHO_PI_STEPS] = {
      1,  3,  6, 10, 15, 21, 28, 36,
     45, 55,  2, 14, 27, 41, 56,  8,
     25, 43, 62, 18, 39, 61, 20, 44
 };
 
-static const int g_rhoNextIndex[SHA3_NUM_ROUNDS] = {
+static const int g_rhoNextIndex[SHA3_NUM_RHO_PI_STEPS] = {
     10,  7, 11, 17, 18,  3,  5, 16,
      8, 21, 24,  4, 15, 23, 19, 13,
     12,  2, 20, 14, 22,  9,  6,  1
@@ -70,9 +75,6 @@ static const u64 g_finalMask = 0x8000000000000000;
 
 /* Function prototypes. */
 
-static u64 rotl_u64(u64 x, int s);
-static u64 rotr_u64(u64 x, int s);
-
 static void sha3ContextCreate(Sha3Context *out, u32 hash_size);
 
 static void sha3ProcessBlock(Sha3Context *ctx);
@@ -115,9 +117,13 @@ void sha3ContextUpdate(Sha3Context *ctx, const void *src, size_t size)
     /* Process blocks, if we have any. */
     while(remaining >= ctx->block_size)
     {
-        /* Mix the bytes into our state. */
-        u8 *dst = (u8*)ctx->internal_state;
-        for(size_t i = 0; i < ctx->block_size; ++i) dst[i] ^= src_u8[i];
+        /* Mix the bytes into our state one word at a time. The block size is always a multiple of the state word size, and unaligned input is handled by the word load. */
+        for(size_t i = 0; i < (ctx->block_size / sizeof(u64)); ++i)
+        {
+            u64 val = 0;
+            memcpy(&val, src_u8 + (i * sizeof(u64)), sizeof(u64));
+            ctx->internal_state[i] ^= val;
+        }
 
         sha3ProcessBlock(ctx);
 
@@ -162,40 +168,6 @@ _SHA3_CTX_OPS(512);
 
 #undef _SHA3_CTX_OPS
 
-static u64 rotl_u64(u64 x, int s)
-{
-    int N = (sizeof(u64) * 8);
-    int r = (s % N);
-
-    if (r == 0)
-    {
-        return x;
-    } else
-    if (r > 0)
-    {
-        return ((x << r) | (x >> (N - r)));
-    }
-
-    return rotr_u64(x, -r);
-}
-
-static u64 rotr_u64(u64 x, int s)
-{
-    int N = (sizeof(u64) * 8);
-    int r = (s % N);
-
-    if (r == 0)
-    {
-        return x;
-    } else
-    if (r > 0)
-    {
-        return ((x >> r) | (x << (N - r)));
-    }
-
-    return rotl_u64(x, -r);
-}
-
 static void sha3ContextCreate(Sha3Context *out, u32 hash_size)
 {
     if (!out)
@@ -212,43 +184,49 @@ static void sha3ContextCreate(Sha3Context *out, u32 hash_size)
 
 static void sha3ProcessBlock(Sha3Context *ctx)
 {
-    u64 tmp = 0, C[5] = {0};
+    u64 A[SHA3_STATE_WORDS] = {0};
+    u64 tmp = 0, C[5] = {0}, D[5] = {0};
+
+    /* Work on a local copy of the state. Unlike the context buffer, the compiler is free to keep it in registers for the whole permutation. */
+    memcpy(A, ctx->internal_state, sizeof(A));
 
     /* Perform all rounds. */
     for(u8 round = 0; round < SHA3_NUM_ROUNDS; ++round)
     {
         /* Handle theta. */
-        for(size_t i = 0; i < 5; ++i)
-        {
-            C[i] = (ctx->internal_state[i] ^ ctx->internal_state[i + 5] ^ ctx->internal_state[i + 10] ^ ctx->internal_state[i + 15] ^ ctx->internal_state[i + 20]);
-        }
+        for(size_t i = 0; i < 5; ++i) C[i] = (A[i] ^ A[i + 5] ^ A[i + 10] ^ A[i + 15] ^ A[i + 20]);
 
-        for(size_t i = 0; i < 5; ++i)
+        for(size_t i = 0; i < 5; ++i) D[i] = (C[(i + 4) % 5] ^ SHA3_ROTL_U64(C[(i + 1) % 5], 1));
+
+        for(size_t i = 0; i < SHA3_STATE_WORDS; i += 5)
         {
-            tmp = (C[(i + 4) % 5] ^ rotl_u64(C[(i + 1) % 5], 1));
-            for(size_t j = 0; j < 5; ++j) ctx->internal_state[(5 * j) + i] ^= tmp;
+            for(size_t j = 0; j < 5; ++j) A[i + j] ^= D[j];
         }
 
         /* Handle rho/pi. */
-        tmp = ctx->internal_state[1];
-        for(size_t i = 0; i < SHA3_NUM_ROUNDS; ++i)
+        tmp = A[1];
+
+        for(size_t i = 0; i < SHA3_NUM_RHO_PI_STEPS; ++i)
         {
             const int rho_next_idx = g_rhoNextIndex[i];
-            C[0] = ctx->internal_state[rho_next_idx];
-            ctx->internal_state[rho_next_idx] = rotl_u64(tmp, g_rhoShiftBit[i]);
-            tmp = C[0];
+            const u64 cur_lane = A[rho_next_idx];
+            A[rho_next_idx] = SHA3_ROTL_U64(tmp, g_rhoShiftBit[i]);
+            tmp = cur_lane;
         }
 
         /* Handle chi. */
-        for(size_t i = 0; i < 5; ++i)
+        for(size_t i = 0; i < SHA3_STATE_WORDS; i += 5)
         {
-            for(size_t j = 0; j < 5; ++j) C[j] = ctx->internal_state[(5 * i) + j];
-            for(size_t j = 0; j < 5; ++j) ctx->internal_state[(5 * i) + j] ^= ((~C[(j + 1) % 5]) & C[(j + 2) % 5]);
+            for(size_t j = 0; j < 5; ++j) C[j] = A[i + j];
+            for(size_t j = 0; j < 5; ++j) A[i + j] = (C[j] ^ ((~C[(j + 1) % 5]) & C[(j + 2) % 5]));
         }
 
         /* Handle iota. */
-        ctx->internal_state[0] ^= g_iotaRoundConstant[round];
+        A[0] ^= g_iotaRoundConstant[round];
     }
+
+    /* Copy the permuted state back into the context. */
+    memcpy(ctx->internal_state, A, sizeof(A));
 }
 
 static void sha3ProcessLastBlock(Sha3Context *ctx)
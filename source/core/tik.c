@@ -70,6 +70,27 @@ typedef struct {
 
 NXDT_ASSERT(TikEsCtrKeyPattern9x, 0x28);
 
+/// Used to pass data to and from tikFindEsCtrKeyEntry().
+typedef struct {
+    u8 *buf;            ///< Encrypted ticket data. Decrypted in place if the search succeeds.
+    u64 ticket_offset;  ///< Absolute ticket offset within ticket.bin. Used to initialize the AES-128-CTR counter.
+} TikEsCtrKeySearchContext;
+
+/// Entry from the in-memory rights ID -> ticket offset index built out of a "ticket_list.bin" storage.
+typedef struct {
+    FsRightsId rights_id;   ///< Rights ID for this ticket entry.
+    u64 ticket_offset;      ///< Ticket entry offset within "ticket.bin".
+} TikTicketIndexEntry;
+
+/// In-memory index for a ES ticket system savefile. Built on first lookup and kept for the lifetime of the process.
+typedef struct {
+    bool valid;                     ///< Whether this index holds usable data.
+    u32 es_ticket_count;            ///< Ticket count reported by the ES interface when the index was built. A mismatch invalidates the index.
+    FsRightsId *es_rights_ids;      ///< Sorted rights ID set reported by the ES interface when the index was built. A mismatch invalidates the index.
+    TikTicketIndexEntry *entries;   ///< Index entries, sorted by rights ID so lookups can rely on a binary search.
+    u32 entry_count;                ///< Total number of index entries.
+} TikTicketIndex;
+
 /* Global variables. */
 
 #if LOG_LEVEL <= LOG_LEVEL_ERROR
@@ -86,6 +107,12 @@ static MemoryLocation g_esMemoryLocation = {
     .data_size = 0
 };
 
+/// Serializes ticket retrieval operations. ES savedata accesses and ES program memory searches aren't safe to carry out concurrently.
+static Mutex g_tikRetrievalMutex = 0;
+
+/// Indexed by TikTitleKeyType. Protected by g_tikRetrievalMutex.
+static TikTicketIndex g_tikTicketIndexes[2] = {0};
+
 /* Function prototypes. */
 
 static bool tikRetrieveTicketFromGameCardByRightsId(Ticket *dst, const FsRightsId *id);
@@ -94,10 +121,12 @@ static bool tikRetrieveTicketFromEsSaveDataByRightsId(Ticket *dst, const FsRight
 static bool tikGetEncryptedTitleKeyFromTicket(Ticket *tik);
 static bool tikGetDecryptedTitleKey(void *dst, const void *src, u8 key_generation);
 
-static bool tikGetTitleKeyTypeFromRightsId(const FsRightsId *id, u8 *out);
-static bool tikRetrieveRightsIdsByTitleKeyType(FsRightsId **out, u32 *out_count, bool personalized);
+static int tikTicketIndexEntrySortFunc(const void *a, const void *b);
+static bool tikBuildTicketIndex(u8 titlekey_type, u32 es_ticket_count);
+static bool tikUpdateTicketIndex(u8 titlekey_type);
+static bool tikLookupTicketOffsetByRightsId(const FsRightsId *id, u64 *out_offset, u8 *out_titlekey_type);
 
-static bool tikGetTicketEntryOffsetFromTicketList(save_ctx_t *save_ctx, u8 *buf, u64 buf_size, const FsRightsId *id, u64 *out_offset, u8 titlekey_type);
+static bool tikFindEsCtrKeyEntry(const u8 *window, u64 window_size, u64 window_offset, void *userdata);
 static bool tikRetrieveTicketEntryFromTicketBin(save_ctx_t *save_ctx, u8 *buf, u64 buf_size, const FsRightsId *id, u64 ticket_offset, u8 titlekey_type);
 
 static bool tikGetTicketTypeAndSize(void *data, u64 data_size, u8 *out_type, u64 *out_size);
@@ -124,7 +153,10 @@ bool tikRetrieveTicketByRightsId(Ticket *dst, const FsRightsId *id, bool use_gam
     memset(dst, 0, sizeof(Ticket));
 
     /* Retrieve ticket data. */
-    bool tik_retrieved = (use_gamecard ? tikRetrieveTicketFromGameCardByRightsId(dst, id) : tikRetrieveTicketFromEsSaveDataByRightsId(dst, id));
+    /* A lock is used here because multiple NCA contexts may be initialized concurrently. */
+    bool tik_retrieved = false;
+    SCOPED_LOCK(&g_tikRetrievalMutex) tik_retrieved = (use_gamecard ? tikRetrieveTicketFromGameCardByRightsId(dst, id) : tikRetrieveTicketFromEsSaveDataByRightsId(dst, id));
+
     if (!tik_retrieved)
     {
         LOG_MSG_ERROR("Unable to retrieve ticket data!");
@@ -236,6 +268,19 @@ bool tikConvertPersonalizedTicketToCommonTicket(Ticket *tik, u8 **out_raw_cert_c
     return true;
 }
 
+bool tikPrewarmTicketIndexes(void)
+{
+    bool success = true;
+
+    SCOPED_LOCK(&g_tikRetrievalMutex)
+    {
+        /* Build / refresh both ticket indexes. tikUpdateTicketIndex() skips the rebuild if the installed ticket set for a titlekey type hasn't changed since its last build. */
+        for(u8 i = 0; i < 2; i++) success &= tikUpdateTicketIndex(i);
+    }
+
+    return success;
+}
+
 static bool tikRetrieveTicketFromGameCardByRightsId(Ticket *dst, const FsRightsId *id)
 {
     if (!dst || !id)
@@ -289,24 +334,24 @@ static bool tikRetrieveTicketFromEsSaveDataByRightsId(Ticket *dst, const FsRight
 
     save_ctx_t *save_ctx = NULL;
 
-    u64 buf_size = (SIGNED_TIK_MAX_SIZE * 0x100);
+    u64 buf_size = SIGNED_TIK_MAX_SIZE;
     u8 *buf = NULL;
     u64 ticket_offset = 0;
 
     bool success = false;
 
-    /* Allocate memory to retrieve the ticket. */
-    if (!(buf = malloc(buf_size)))
+    /* Look up the rights ID in the in-memory ticket indexes. This also determines the titlekey type. */
+    if (!tikLookupTicketOffsetByRightsId(id, &ticket_offset, &titlekey_type))
     {
-        LOG_MSG_ERROR("Unable to allocate 0x%lX bytes block for temporary read buffer!", buf_size);
+        LOG_MSG_ERROR("Unable to find an indexed ticket entry with a matching Rights ID!");
         return false;
     }
 
-    /* Get titlekey type. */
-    if (!tikGetTitleKeyTypeFromRightsId(id, &titlekey_type))
+    /* Allocate memory to retrieve the ticket. */
+    if (!(buf = malloc(buf_size)))
     {
-        LOG_MSG_ERROR("Unable to retrieve ticket titlekey type!");
-        goto end;
+        LOG_MSG_ERROR("Unable to allocate 0x%lX bytes block for temporary read buffer!", buf_size);
+        return false;
     }
 
     /* Open ES common/personalized system savefile. */
@@ -316,14 +361,7 @@ static bool tikRetrieveTicketFromEsSaveDataByRightsId(Ticket *dst, const FsRight
         goto end;
     }
 
-    /* Get ticket entry offset from ticket_list.bin. */
-    if (!tikGetTicketEntryOffsetFromTicketList(save_ctx, buf, buf_size, id, &ticket_offset, titlekey_type))
-    {
-        LOG_MSG_ERROR("Unable to find an entry with a matching Rights ID in \"%s\" from ES %s ticket system save!", TIK_LIST_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type]);
-        goto end;
-    }
-
-    /* Get ticket entry from ticket.bin. */
+    /* Get ticket entry from ticket.bin, using the indexed ticket offset. */
     if (!tikRetrieveTicketEntryFromTicketBin(save_ctx, buf, buf_size, id, ticket_offset, titlekey_type))
     {
         LOG_MSG_ERROR("Unable to find a matching %s ticket entry for the provided Rights ID!", g_tikTitleKeyTypeStrings[titlekey_type]);
@@ -400,173 +438,233 @@ static bool tikGetDecryptedTitleKey(void *dst, const void *src, u8 key_generatio
     return true;
 }
 
-static bool tikGetTitleKeyTypeFromRightsId(const FsRightsId *id, u8 *out)
+static int tikTicketIndexEntrySortFunc(const void *a, const void *b)
+{
+    return memcmp(((const TikTicketIndexEntry*)a)->rights_id.c, ((const TikTicketIndexEntry*)b)->rights_id.c, sizeof(FsRightsId));
+}
+
+static bool tikBuildTicketIndex(u8 titlekey_type, u32 es_ticket_count)
 {
-    if (!id || !out)
+    TikTicketIndex *index = &(g_tikTicketIndexes[titlekey_type]);
+
+    save_ctx_t *save_ctx = NULL;
+    allocation_table_storage_ctx_t fat_storage = {0};
+    u64 ticket_list_bin_size = 0, br = 0, total_br = 0;
+
+    u64 buf_size = (SIGNED_TIK_MAX_SIZE * 0x100);
+    u8 *buf = NULL;
+
+    u8 last_rights_id[0x10];
+    memset(last_rights_id, 0xFF, sizeof(last_rights_id));
+
+    bool last_entry_found = false, success = false;
+
+    /* Free any previous index data. */
+    if (index->entries) free(index->entries);
+    memset(index, 0, sizeof(TikTicketIndex));
+
+    /* Allocate memory for the read buffer. */
+    if (!(buf = malloc(buf_size)))
     {
-        LOG_MSG_ERROR("Invalid parameters!");
+        LOG_MSG_ERROR("Unable to allocate 0x%lX bytes block for temporary read buffer!", buf_size);
         return false;
     }
 
-    u32 count = 0;
-    FsRightsId *rights_ids = NULL;
-    bool found = false;
+    /* Open ES common/personalized system savefile. */
+    if (!(save_ctx = save_open_savefile(titlekey_type == TikTitleKeyType_Common ? TIK_COMMON_SAVEFILE_PATH : TIK_PERSONALIZED_SAVEFILE_PATH, 0)))
+    {
+        LOG_MSG_ERROR("Failed to open ES %s ticket system savefile!", g_tikTitleKeyTypeStrings[titlekey_type]);
+        goto end;
+    }
 
-    for(u8 i = 0; i < 2; i++)
+    /* Get FAT storage info for the ticket_list.bin stored within the opened system savefile. */
+    if (!save_get_fat_storage_from_file_entry_by_path(save_ctx, TIK_LIST_STORAGE_PATH, &fat_storage, &ticket_list_bin_size))
     {
-        count = 0;
-        rights_ids = NULL;
+        LOG_MSG_ERROR("Failed to locate \"%s\" in ES %s ticket system save!", TIK_LIST_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type]);
+        goto end;
+    }
+
+    /* Check ticket_list.bin size. */
+    if (ticket_list_bin_size < sizeof(TikListEntry) || (ticket_list_bin_size % sizeof(TikListEntry)) != 0)
+    {
+        LOG_MSG_ERROR("Invalid size for \"%s\" in ES %s ticket system save! (0x%lX).", TIK_LIST_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type], ticket_list_bin_size);
+        goto end;
+    }
 
-        if (!tikRetrieveRightsIdsByTitleKeyType(&rights_ids, &count, i == 1))
+    /* Allocate memory for the index entries. */
+    index->entries = calloc(ticket_list_bin_size / sizeof(TikListEntry), sizeof(TikTicketIndexEntry));
+    if (!index->entries)
+    {
+        LOG_MSG_ERROR("Unable to allocate memory for the %s ticket index entries!", g_tikTitleKeyTypeStrings[titlekey_type]);
+        goto end;
+    }
+
+    /* Read the whole ticket list in a single pass, adding every valid entry to the index. */
+    while(total_br < ticket_list_bin_size && !last_entry_found)
+    {
+        u64 chunk_size = MIN(buf_size, ticket_list_bin_size - total_br);
+
+        if ((br = save_allocation_table_storage_read(&fat_storage, buf, total_br, chunk_size)) != chunk_size)
         {
-            LOG_MSG_ERROR("Unable to retrieve %s rights IDs!", g_tikTitleKeyTypeStrings[i]);
-            continue;
+            LOG_MSG_ERROR("Failed to read 0x%lX bytes chunk at offset 0x%lX from \"%s\" in ES %s ticket system save!", chunk_size, total_br, TIK_LIST_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type]);
+            goto end;
         }
 
-        if (!count) continue;
-
-        for(u32 j = 0; j < count; j++)
+        for(u64 i = 0; i < chunk_size; i += sizeof(TikListEntry))
         {
-            if (!memcmp(rights_ids[j].c, id->c, 0x10))
+            TikListEntry *entry = (TikListEntry*)(buf + i);
+
+            /* Check if we found the last entry. */
+            if (!memcmp(entry->rights_id.c, last_rights_id, sizeof(last_rights_id)))
             {
-                *out = i; /* TikTitleKeyType_Common or TikTitleKeyType_Personalized. */
-                found = true;
+                last_entry_found = true;
                 break;
             }
-        }
 
-        free(rights_ids);
+            /* Add entry to the index. */
+            TikTicketIndexEntry *index_entry = &(index->entries[index->entry_count++]);
+            memcpy(&(index_entry->rights_id), &(entry->rights_id), sizeof(FsRightsId));
+            index_entry->ticket_offset = ((total_br + i) << 5); /* (entry_offset / sizeof(TikListEntry)) * SIGNED_TIK_MAX_SIZE */
+        }
 
-        if (found) break;
+        total_br += br;
     }
 
-    return found;
-}
+    /* Sort index entries by rights ID, enabling the use of a binary search for lookups. */
+    if (index->entry_count) qsort(index->entries, index->entry_count, sizeof(TikTicketIndexEntry), &tikTicketIndexEntrySortFunc);
 
-static bool tikRetrieveRightsIdsByTitleKeyType(FsRightsId **out, u32 *out_count, bool personalized)
-{
-    if (!out || !out_count)
+    index->es_ticket_count = es_ticket_count;
+    index->valid = success = true;
+
+    LOG_MSG_DEBUG("Built %s ticket index with %u entries.", g_tikTitleKeyTypeStrings[titlekey_type], index->entry_count);
+
+end:
+    if (save_ctx) save_close_savefile(save_ctx);
+
+    if (buf) free(buf);
+
+    if (!success && index->entries)
     {
-        LOG_MSG_ERROR("Invalid parameters!");
-        return false;
+        free(index->entries);
+        index->entries = NULL;
+        index->entry_count = 0;
     }
 
-    Result rc = 0;
-    u32 count = 0, ids_written = 0;
-    FsRightsId *rights_ids = NULL;
+    return success;
+}
 
-#if LOG_LEVEL <= LOG_LEVEL_ERROR
-    u8 str_idx = (personalized ? TikTitleKeyType_Personalized : TikTitleKeyType_Common);
-#endif
+static bool tikUpdateTicketIndex(u8 titlekey_type)
+{
+    TikTicketIndex *index = &(g_tikTicketIndexes[titlekey_type]);
 
-    *out = NULL;
-    *out_count = 0;
+    FsRightsId *es_rights_ids = NULL;
+    s32 es_ticket_count = 0;
+    bool personalized = (titlekey_type == TikTitleKeyType_Personalized), success = false;
 
-    rc = (personalized ? esCountPersonalizedTicket((s32*)&count) : esCountCommonTicket((s32*)&count));
+    /* Get the current sorted rights ID set for this titlekey type straight from the ES interface, using a single list exchange. */
+    /* Used to detect tickets installed or removed after the last index build -- unlike a bare ticket count, the full set also catches changes that keep the count unmodified. */
+    Result rc = (personalized ? esListAllPersonalizedTicket(&es_rights_ids, &es_ticket_count) : esListAllCommonTicket(&es_rights_ids, &es_ticket_count));
     if (R_FAILED(rc))
     {
-        LOG_MSG_ERROR("esCount%c%sTicket failed! (0x%X).", toupper(g_tikTitleKeyTypeStrings[str_idx][0]), g_tikTitleKeyTypeStrings[str_idx] + 1, rc);
-        return false;
+        LOG_MSG_ERROR("esListAll%c%sTicket failed! (0x%X).", toupper(g_tikTitleKeyTypeStrings[titlekey_type][0]), g_tikTitleKeyTypeStrings[titlekey_type] + 1, rc);
+
+        /* Keep using the current index data, if any. */
+        return index->valid;
     }
 
-    if (!count)
+    /* Skip the rebuild if the retrieved rights ID set matches the one the current index was built against. */
+    if (index->valid && index->es_ticket_count == (u32)es_ticket_count && \
+        (!es_ticket_count || !memcmp(index->es_rights_ids, es_rights_ids, (size_t)es_ticket_count * sizeof(FsRightsId))))
     {
-        LOG_MSG_ERROR("No %s tickets available!", g_tikTitleKeyTypeStrings[str_idx]);
+        if (es_rights_ids) free(es_rights_ids);
         return true;
     }
 
-    rights_ids = calloc(count, sizeof(FsRightsId));
-    if (!rights_ids)
+    /* Free the rights ID set from the previous index build. tikBuildTicketIndex() wipes the whole index. */
+    if (index->es_rights_ids)
     {
-        LOG_MSG_ERROR("Unable to allocate memory for %s rights IDs!", g_tikTitleKeyTypeStrings[str_idx]);
-        return false;
+        free(index->es_rights_ids);
+        index->es_rights_ids = NULL;
     }
 
-    rc = (personalized ? esListPersonalizedTicket((s32*)&ids_written, rights_ids, (s32)count) : esListCommonTicket((s32*)&ids_written, rights_ids, (s32)count));
-    if (R_FAILED(rc) || !ids_written)
+    /* Rebuild the index, then hand the retrieved rights ID set over to it. */
+    success = tikBuildTicketIndex(titlekey_type, (u32)es_ticket_count);
+    if (success)
     {
-        LOG_MSG_ERROR("esList%c%sTicket failed! (0x%X). Wrote %u entries, expected %u entries.", toupper(g_tikTitleKeyTypeStrings[str_idx][0]), g_tikTitleKeyTypeStrings[str_idx] + 1, rc, ids_written, count);
-        free(rights_ids);
-        return false;
+        index->es_rights_ids = es_rights_ids;
+    } else {
+        if (es_rights_ids) free(es_rights_ids);
     }
 
-    *out = rights_ids;
-    *out_count = ids_written;
-
-    return true;
+    return success;
 }
 
-static bool tikGetTicketEntryOffsetFromTicketList(save_ctx_t *save_ctx, u8 *buf, u64 buf_size, const FsRightsId *id, u64 *out_offset, u8 titlekey_type)
+static bool tikLookupTicketOffsetByRightsId(const FsRightsId *id, u64 *out_offset, u8 *out_titlekey_type)
 {
-    if (!save_ctx || !buf || !buf_size || (buf_size % sizeof(TikListEntry)) != 0 || !id || !out_offset)
-    {
-        LOG_MSG_ERROR("Invalid parameters!");
-        return false;
-    }
+    TikTicketIndexEntry key = {0};
+    memcpy(&(key.rights_id), id, sizeof(FsRightsId));
 
-    allocation_table_storage_ctx_t fat_storage = {0};
-    u64 ticket_list_bin_size = 0, br = 0, total_br = 0;
-
-    u8 last_rights_id[0x10];
-    memset(last_rights_id, 0xFF, sizeof(last_rights_id));
+    for(u8 i = 0; i < 2; i++)
+    {
+        /* Build / refresh the index for this titlekey type, if needed. */
+        if (!tikUpdateTicketIndex(i)) continue;
 
-    bool last_entry_found = false, success = false;
+        TikTicketIndex *index = &(g_tikTicketIndexes[i]);
+        if (!index->entry_count) continue;
 
-    /* Get FAT storage info for the ticket_list.bin stored within the opened system savefile. */
-    if (!save_get_fat_storage_from_file_entry_by_path(save_ctx, TIK_LIST_STORAGE_PATH, &fat_storage, &ticket_list_bin_size))
-    {
-        LOG_MSG_ERROR("Failed to locate \"%s\" in ES %s ticket system save!", TIK_LIST_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type]);
-        return false;
+        /* Look for a matching index entry. */
+        TikTicketIndexEntry *entry = bsearch(&key, index->entries, index->entry_count, sizeof(TikTicketIndexEntry), &tikTicketIndexEntrySortFunc);
+        if (entry)
+        {
+            *out_offset = entry->ticket_offset;
+            *out_titlekey_type = i; /* TikTitleKeyType_Common or TikTitleKeyType_Personalized. */
+            return true;
+        }
     }
 
-    /* Check ticket_list.bin size. */
-    if (ticket_list_bin_size < sizeof(TikListEntry) || (ticket_list_bin_size % sizeof(TikListEntry)) != 0)
-    {
-        LOG_MSG_ERROR("Invalid size for \"%s\" in ES %s ticket system save! (0x%lX).", TIK_LIST_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type], ticket_list_bin_size);
-        return false;
-    }
+    return false;
+}
 
-    /* Look for an entry matching our rights ID in ticket_list.bin. */
-    while(total_br < ticket_list_bin_size)
-    {
-        if (buf_size > (ticket_list_bin_size - total_br)) buf_size = (ticket_list_bin_size - total_br);
+static bool tikFindEsCtrKeyEntry(const u8 *window, u64 window_size, u64 window_offset, void *userdata)
+{
+    TikEsCtrKeySearchContext *ctx = (TikEsCtrKeySearchContext*)userdata;
 
-        if ((br = save_allocation_table_storage_read(&fat_storage, buf, total_br, buf_size)) != buf_size)
-        {
-            LOG_MSG_ERROR("Failed to read 0x%lX bytes chunk at offset 0x%lX from \"%s\" in ES %s ticket system save!", buf_size, total_br, TIK_LIST_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type]);
-            break;
-        }
+    Aes128CtrContext ctr_ctx = {0};
+    u8 null_ctr[AES_128_KEY_SIZE] = {0}, ctr[AES_128_KEY_SIZE] = {0}, dec_tik[SIGNED_TIK_MAX_SIZE] = {0};
 
-        for(u64 i = 0; i < buf_size; i += sizeof(TikListEntry))
-        {
-            if ((buf_size - i) < sizeof(TikListEntry)) break;
+    /* Keep the scan aligned to ES_CTRKEY_ENTRY_ALIGNMENT relative to the start of the streamed memory range. */
+    u64 start_offset = (window_offset % ES_CTRKEY_ENTRY_ALIGNMENT);
+    if (start_offset) start_offset = (ES_CTRKEY_ENTRY_ALIGNMENT - start_offset);
 
-            u64 entry_offset = (total_br + i);
-            TikListEntry *entry = (TikListEntry*)(buf + i);
+    for(u64 i = start_offset; i < window_size; i += ES_CTRKEY_ENTRY_ALIGNMENT)
+    {
+        if ((window_size - i) < (sizeof(TikEsCtrKeyEntry9x) * 2)) break;
 
-            /* Check if we found the last entry. */
-            if (!memcmp(entry->rights_id.c, last_rights_id, sizeof(last_rights_id)))
-            {
-                last_entry_found = true;
-                break;
-            }
+        /* Check if the key indexes are valid. idx2 should always be an odd number equal to idx + 1. */
+        const TikEsCtrKeyPattern9x *pattern = (const TikEsCtrKeyPattern9x*)(window + i);
+        if (pattern->idx2 != (pattern->idx1 + 1) || !(pattern->idx2 & 1)) continue;
 
-            /* Check if this is the entry we're looking for. */
-            if (!memcmp(entry->rights_id.c, id->c, sizeof(id->c)))
-            {
-                /* Jackpot. */
-                *out_offset = (entry_offset << 5); /* (entry_offset / sizeof(TikListEntry)) * SIGNED_TIK_MAX_SIZE */
-                success = true;
-                break;
-            }
-        }
+        /* Check if the key is not null and if the CTR is. */
+        const TikEsCtrKeyEntry9x *key_entry = (const TikEsCtrKeyEntry9x*)pattern;
+        if (!memcmp(key_entry->key, null_ctr, sizeof(null_ctr)) || memcmp(key_entry->ctr, null_ctr, sizeof(null_ctr)) != 0) continue;
 
-        total_br += br;
+        /* Check if we can decrypt the current ticket with this data. */
+        memset(&ctr_ctx, 0, sizeof(Aes128CtrContext));
+        aes128CtrInitializePartialCtr(ctr, key_entry->ctr, ctx->ticket_offset);
+        aes128CtrContextCreate(&ctr_ctx, key_entry->key, ctr);
+        aes128CtrCrypt(&ctr_ctx, dec_tik, ctx->buf, SIGNED_TIK_MAX_SIZE);
 
-        if (last_entry_found || success) break;
+        /* Check if we successfully decrypted this ticket. */
+        TikCommonBlock *tik_common_block = tikGetCommonBlock(dec_tik);
+        if (tik_common_block && !strncmp(tik_common_block->issuer, "Root-", 5))
+        {
+            /* Jackpot. */
+            memcpy(ctx->buf, dec_tik, SIGNED_TIK_MAX_SIZE);
+            return true;
+        }
     }
 
-    return success;
+    return false;
 }
 
 static bool tikRetrieveTicketEntryFromTicketBin(save_ctx_t *save_ctx, u8 *buf, u64 buf_size, const FsRightsId *id, u64 ticket_offset, u8 titlekey_type)
@@ -582,10 +680,7 @@ static bool tikRetrieveTicketEntryFromTicketBin(save_ctx_t *save_ctx, u8 *buf, u
 
     TikCommonBlock *tik_common_block = NULL;
 
-    Aes128CtrContext ctr_ctx = {0};
-    u8 null_ctr[AES_128_KEY_SIZE] = {0}, ctr[AES_128_KEY_SIZE] = {0}, dec_tik[SIGNED_TIK_MAX_SIZE] = {0};
-
-    bool is_volatile = false, success = false;
+    bool success = false;
 
     /* Get FAT storage info for the ticket.bin stored within the opened system savefile. */
     if (!save_get_fat_storage_from_file_entry_by_path(save_ctx, TIK_DB_STORAGE_PATH, &fat_storage, &ticket_bin_size))
@@ -613,7 +708,6 @@ static bool tikRetrieveTicketEntryFromTicketBin(save_ctx_t *save_ctx, u8 *buf, u
     if (!(tik_common_block = tikGetCommonBlock(buf)) || strncmp(tik_common_block->issuer, "Root-", 5) != 0)
     {
         tik_common_block = NULL;
-        is_volatile = true;
 
         /* Don't proceed if HOS version isn't at least 9.0.0. */
         if (!hosversionAtLeast(9, 0, 0))
@@ -622,57 +716,22 @@ static bool tikRetrieveTicketEntryFromTicketBin(save_ctx_t *save_ctx, u8 *buf, u
             return false;
         }
 
-        /* Retrieve ES program memory. */
-        if (!memRetrieveFullProgramMemory(&g_esMemoryLocation))
-        {
-            LOG_MSG_ERROR("Failed to retrieve ES program memory!");
-            return false;
-        }
-
-        /* Retrieve the CTR key/IV from ES program memory in order to decrypt this ticket. */
-        for(u64 i = 0; i < g_esMemoryLocation.data_size; i += ES_CTRKEY_ENTRY_ALIGNMENT)
-        {
-            if ((g_esMemoryLocation.data_size - i) < (sizeof(TikEsCtrKeyEntry9x) * 2)) break;
-
-            /* Check if the key indexes are valid. idx2 should always be an odd number equal to idx + 1. */
-            TikEsCtrKeyPattern9x *pattern = (TikEsCtrKeyPattern9x*)(g_esMemoryLocation.data + i);
-            if (pattern->idx2 != (pattern->idx1 + 1) || !(pattern->idx2 & 1)) continue;
-
-            /* Check if the key is not null and if the CTR is. */
-            TikEsCtrKeyEntry9x *key_entry = (TikEsCtrKeyEntry9x*)pattern;
-            if (!memcmp(key_entry->key, null_ctr, sizeof(null_ctr)) || memcmp(key_entry->ctr, null_ctr, sizeof(null_ctr)) != 0) continue;
-
-            /* Check if we can decrypt the current ticket with this data. */
-            memset(&ctr_ctx, 0, sizeof(Aes128CtrContext));
-            aes128CtrInitializePartialCtr(ctr, key_entry->ctr, ticket_offset);
-            aes128CtrContextCreate(&ctr_ctx, key_entry->key, ctr);
-            aes128CtrCrypt(&ctr_ctx, dec_tik, buf, SIGNED_TIK_MAX_SIZE);
+        /* Look for a CTR key/IV entry capable of decrypting this ticket by streaming ES program memory through a windowed search. */
+        /* The ticket data is decrypted in place by the search callback if a suitable entry is found. */
+        TikEsCtrKeySearchContext search_ctx = { .buf = buf, .ticket_offset = ticket_offset };
 
-            /* Check if we successfully decrypted this ticket. */
-            if ((tik_common_block = tikGetCommonBlock(dec_tik)) != NULL && !strncmp(tik_common_block->issuer, "Root-", 5))
-            {
-                memcpy(buf, dec_tik, SIGNED_TIK_MAX_SIZE);
-                tik_common_block = tikGetCommonBlock(buf);
-                break;
-            }
-
-            tik_common_block = NULL;
-        }
-
-        /* Check if we were able to decrypt the ticket. */
-        if (!tik_common_block)
+        if (!memSearchFullProgramMemory(&g_esMemoryLocation, (sizeof(TikEsCtrKeyEntry9x) * 2) - 1, &tikFindEsCtrKeyEntry, &search_ctx))
         {
             LOG_MSG_ERROR("Unable to decrypt volatile ticket at offset 0x%lX in \"%s\" from ES %s ticket system save!", ticket_offset, TIK_DB_STORAGE_PATH, g_tikTitleKeyTypeStrings[titlekey_type]);
-            goto end;
+            return false;
         }
+
+        tik_common_block = tikGetCommonBlock(buf);
     }
 
     /* Check if the rights ID from the ticket common block matches the one we're looking for. */
     if (!(success = (memcmp(tik_common_block->rights_id.c, id->c, 0x10) == 0))) LOG_MSG_ERROR("Retrieved ticket doesn't hold a matching Rights ID!");
 
-end:
-    if (is_volatile) memFreeMemoryLocation(&g_esMemoryLocation);
-
     return success;
 }
 
@@ -29,6 +29,14 @@
 #define TITLE_STORAGE_COUNT                 4                                       /* GameCard, BuiltInSystem, BuiltInUser, SdCard. */
 #define TITLE_STORAGE_INDEX(storage_id)     ((storage_id) - NcmStorageId_GameCard)
 
+#define TITLE_METADATA_CACHE_PATH           DEVOPTAB_SDMC_DEVICE APP_BASE_PATH "title_metadata_cache.bin"
+#define TITLE_METADATA_CACHE_MAGIC          0x4E585443                              /* "NXTC". */
+#define TITLE_METADATA_CACHE_VERSION        1
+
+#define TITLE_META_SCRATCH_BUFFER_SIZE      0x4000                                  /* 16 KiB. Initial size for the scratch buffer used to retrieve full content meta values. */
+
+#define TITLE_INFO_ARENA_CHUNK_SIZE         0x20000                                 /* 128 KiB. Size for each arena chunk used to hold title info entries. */
+
 /* Type definitions. */
 
 typedef struct {
@@ -36,14 +44,45 @@ typedef struct {
     char name[32];
 } TitleSystemEntry;
 
+/// Arena chunk used to hold title info entries.
+/// All TitleInfo elements and content info arrays from a single title storage are carved out of these chunks, which keeps title records packed together in memory \
+/// (filtering walks over them are cache-friendly) and makes it possible to free them wholesale whenever the title storage is closed.
+typedef struct _TitleInfoArenaChunk {
+    struct _TitleInfoArenaChunk *next;  ///< Pointer to the previously filled arena chunk, if any.
+    u64 used;                           ///< Number of bytes currently in use from this arena chunk.
+    u64 size;                           ///< Total capacity for this arena chunk, in bytes.
+    u8 data[];                          ///< Arena chunk data.
+} TitleInfoArenaChunk;
+
 typedef struct {
     u8 storage_id;                  ///< NcmStorageId.
     NcmContentMetaDatabase ncm_db;
     NcmContentStorage ncm_storage;
     TitleInfo **titles;
     u32 title_count;
+    TitleInfoArenaChunk *arena;     ///< Arena that holds all TitleInfo entries pointed to by the 'titles' array, as well as their content info arrays.
 } TitleStorage;
 
+/// Header for the title metadata cache file stored on the SD card.
+typedef struct {
+    u32 magic;              ///< "NXTC".
+    u32 version;            ///< Cache format version. Must match TITLE_METADATA_CACHE_VERSION.
+    u32 ns_records_crc;     ///< CRC32 checksum calculated over the raw NS application record list the cache was generated from.
+    u32 entry_count;        ///< Number of serialized TitleMetadataCacheEntry elements that follow this header.
+} TitleMetadataCacheHeader;
+
+NXDT_ASSERT(TitleMetadataCacheHeader, 0x10);
+
+/// Serialized application metadata entry from the title metadata cache file. Immediately followed by 'icon_size' bytes of JPEG icon data.
+typedef struct {
+    u64 title_id;
+    NacpLanguageEntry lang_entry;
+    u32 icon_size;
+    u8 reserved[0x4];
+} TitleMetadataCacheEntry;
+
+NXDT_ASSERT(TitleMetadataCacheEntry, 0x310);
+
 /* Global variables. */
 
 static Mutex g_titleMutex = 0;
@@ -52,15 +91,23 @@ static Thread g_titleGameCardInfoThread = {0};
 static UEvent g_titleGameCardInfoThreadExitEvent = {0}, *g_titleGameCardStatusChangeUserEvent = NULL;
 static bool g_titleInterfaceInit = false, g_titleGameCardInfoThreadCreated = false, g_titleGameCardAvailable = false, g_titleGameCardInfoUpdated = false;
 
+static Thread g_titleStorageLoadThread = {0};
+static bool g_titleStorageLoadThreadCreated = false, g_titleStorageLoadThreadExitFlag = false, g_titleStorageInfoUpdated = false, g_titleStorageLoadCompleted = false;
+
 static NsApplicationControlData *g_nsAppControlData = NULL;
 
 static TitleApplicationMetadata **g_systemMetadata = NULL, **g_userMetadata = NULL;
 static u32 g_systemMetadataCount = 0, g_userMetadataCount = 0;
 
+/// Pre-filtered views over the application metadata arrays, limited to entries with available content data. Rebuilt on demand whenever title data changes.
+static TitleApplicationMetadata **g_filteredSystemMetadata = NULL, **g_filteredUserMetadata = NULL;
+static u32 g_filteredSystemMetadataCount = 0, g_filteredUserMetadataCount = 0;
+static bool g_filteredSystemMetadataDirty = true, g_filteredUserMetadataDirty = true;
+
 static TitleStorage g_titleStorage[TITLE_STORAGE_COUNT] = {0};
 
 static TitleInfo **g_orphanTitleInfo = NULL;
-static u32 g_orphanTitleInfoCount = 0;
+static u32 g_orphanTitleInfoCount = 0, g_orphanTitleInfoCapacity = 0;
 
 static const char *g_titleNcmStorageIdNames[] = {
     [NcmStorageId_None]          = "None",
@@ -523,33 +570,51 @@ static const u32 g_systemTitlesCount = MAX_ELEMENTS(g_systemTitles);
 NX_INLINE void titleFreeApplicationMetadata(void);
 static bool titleReallocateApplicationMetadata(u32 extra_app_count, bool is_system, bool free_entries);
 
-NX_INLINE bool titleInitializePersistentTitleStorages(void);
+NX_INLINE void titleInvalidateFilteredApplicationMetadata(void);
+NX_INLINE void titleFreeFilteredApplicationMetadata(void);
+static bool titleRefreshFilteredApplicationMetadata(bool is_system);
+
 NX_INLINE void titleCloseTitleStorages(void);
 
 static bool titleInitializeTitleStorage(u8 storage_id);
 static void titleCloseTitleStorage(u8 storage_id);
 static bool titleReallocateTitleInfoFromStorage(TitleStorage *title_storage, u32 extra_title_count, bool free_entries);
 
+static void *titleStorageArenaAllocate(TitleStorage *title_storage, u64 size);
+static void titleStorageArenaFree(TitleStorage *title_storage);
+
 NX_INLINE void titleFreeOrphanTitleInfoEntries(void);
 static void titleAddOrphanTitleInfoEntry(TitleInfo *orphan_title);
+NX_INLINE bool titleIsPreviousOrphanEntry(TitleInfo **prev_orphan_info, u32 prev_orphan_count, TitleInfo *title_info);
 
 static bool titleGenerateMetadataEntriesFromSystemTitles(void);
 static bool titleGenerateMetadataEntriesFromNsRecords(void);
 static TitleApplicationMetadata *titleGenerateDummySystemMetadataEntry(u64 title_id);
 static bool titleRetrieveUserApplicationMetadataByTitleId(u64 title_id, TitleApplicationMetadata *out);
 
+static u8 *titleLoadMetadataCache(size_t *out_cache_size, u32 *out_entry_count, u32 *out_ns_records_crc);
+static const TitleMetadataCacheEntry *titleFindMetadataCacheEntry(const u8 *cache_buf, size_t cache_size, u32 cache_entry_count, u64 title_id);
+static bool titleRetrieveCachedUserApplicationMetadata(const TitleMetadataCacheEntry *cache_entry, TitleApplicationMetadata *out);
+static void titleSaveMetadataCache(u32 ns_records_crc);
+
 NX_INLINE TitleApplicationMetadata *titleFindApplicationMetadataByTitleId(u64 title_id, bool is_system, u32 extra_app_count);
 
 static bool titleGenerateTitleInfoEntriesForTitleStorage(TitleStorage *title_storage);
 static bool titleGetMetaKeysFromContentDatabase(NcmContentMetaDatabase *ncm_db, NcmContentMetaKey **out_meta_keys, u32 *out_meta_key_count);
-static bool titleGetContentInfosForMetaKey(NcmContentMetaDatabase *ncm_db, const NcmContentMetaKey *meta_key, NcmContentInfo **out_content_infos, u32 *out_content_count);
+static bool titleGetContentInfosForMetaKey(TitleStorage *title_storage, const NcmContentMetaKey *meta_key, u8 **scratch_buf, u64 *scratch_buf_size, NcmContentInfo **out_content_infos, \
+                                           u32 *out_content_count);
 
-static void titleUpdateTitleInfoLinkedLists(void);
+static void titleUpdateTitleInfoLinkedLists(bool rescan_orphans);
+static void titleRefreshApplicationMetadataPointers(void);
 
 static bool titleCreateGameCardInfoThread(void);
 static void titleDestroyGameCardInfoThread(void);
 static void titleGameCardInfoThreadFunc(void *arg);
 
+static bool titleCreateStorageLoadThread(void);
+static void titleDestroyStorageLoadThread(void);
+static void titleStorageLoadThreadFunc(void *arg);
+
 static bool titleRefreshGameCardTitleInfo(void);
 
 static bool titleIsUserApplicationContentAvailable(u64 app_id);
@@ -588,20 +653,13 @@ bool titleInitialize(void)
             break;
         }
 
-        /* Generate application metadata entries from ns records. */
-        /* Theoretically speaking, we should only need to do this once. */
-        /* However, if any new gamecard is inserted while the application is running, we *will* have to retrieve the metadata from its application(s). */
-        if (!titleGenerateMetadataEntriesFromNsRecords())
-        {
-            LOG_MSG_ERROR("Failed to generate application metadata from ns records!");
-            break;
-        }
-
-        /* Initialize persistent title storages (BuiltInSystem, BuiltInUser, SdCard). */
+        /* Initialize the title storage the UI needs right away (BuiltInUser). */
+        /* The background title storage load thread will take care of the remaining persistent title storages (SdCard, BuiltInSystem), */
+        /* as well as generating application metadata entries from ns records - results are streamed in incrementally while the application is already interactive. */
         /* The background gamecard title thread will take care of initializing the gamecard title storage. */
-        if (!titleInitializePersistentTitleStorages())
+        if (!titleInitializeTitleStorage(NcmStorageId_BuiltInUser))
         {
-            LOG_MSG_ERROR("Failed to initialize persistent title storages!");
+            LOG_MSG_ERROR("Failed to initialize user title storage!");
             break;
         }
 
@@ -619,6 +677,9 @@ bool titleInitialize(void)
         /* Create gamecard title info thread. */
         if (!(g_titleGameCardInfoThreadCreated = titleCreateGameCardInfoThread())) break;
 
+        /* Create title storage load thread. */
+        if (!(g_titleStorageLoadThreadCreated = titleCreateStorageLoadThread())) break;
+
         /* Update flags. */
         ret = g_titleInterfaceInit = true;
     }
@@ -628,6 +689,9 @@ bool titleInitialize(void)
 
 void titleExit(void)
 {
+    /* Destroy title storage load thread before taking the lock - it periodically locks the title mutex while streaming in title data. */
+    titleDestroyStorageLoadThread();
+
     SCOPED_LOCK(&g_titleMutex)
     {
         /* Destroy gamecard detection thread. */
@@ -653,6 +717,7 @@ void titleExit(void)
             g_nsAppControlData = NULL;
         }
 
+        g_titleStorageInfoUpdated = g_titleStorageLoadCompleted = false;
         g_titleInterfaceInit = false;
     }
 }
@@ -671,8 +736,7 @@ NcmContentStorage *titleGetNcmStorageByStorageId(u8 storage_id)
 
 TitleApplicationMetadata **titleGetApplicationMetadataEntries(bool is_system, u32 *out_count)
 {
-    u32 app_count = 0;
-    TitleApplicationMetadata **app_metadata = NULL, **tmp_app_metadata = NULL;
+    TitleApplicationMetadata **app_metadata = NULL;
 
     SCOPED_LOCK(&g_titleMutex)
     {
@@ -682,43 +746,30 @@ TitleApplicationMetadata **titleGetApplicationMetadataEntries(bool is_system, u3
             break;
         }
 
-        TitleApplicationMetadata **cached_app_metadata = (is_system ? g_systemMetadata : g_userMetadata);
-        u32 cached_app_metadata_count = (is_system ? g_systemMetadataCount : g_userMetadataCount);
-        bool error = false;
-
-        for(u32 i = 0; i < cached_app_metadata_count; i++)
-        {
-            TitleApplicationMetadata *cur_app_metadata = cached_app_metadata[i];
-            if (!cur_app_metadata) continue;
+        /* Rebuild the filtered metadata view if it has been invalidated since the last call. */
+        if ((is_system ? g_filteredSystemMetadataDirty : g_filteredUserMetadataDirty) && !titleRefreshFilteredApplicationMetadata(is_system)) break;
 
-            /* Skip current metadata entry if content data for this title isn't available. */
-            if ((is_system && !_titleGetInfoFromStorageByTitleId(NcmStorageId_BuiltInSystem, cur_app_metadata->title_id)) || \
-                (!is_system && !titleIsUserApplicationContentAvailable(cur_app_metadata->title_id))) continue;
+        TitleApplicationMetadata **filtered_app_metadata = (is_system ? g_filteredSystemMetadata : g_filteredUserMetadata);
+        u32 filtered_count = (is_system ? g_filteredSystemMetadataCount : g_filteredUserMetadataCount);
 
-            /* Reallocate application metadata pointer array. */
-            tmp_app_metadata = realloc(app_metadata, (app_count + 1) * sizeof(TitleApplicationMetadata*));
-            if (!tmp_app_metadata)
-            {
-                LOG_MSG_ERROR("Failed to reallocate application metadata pointer array!");
-                if (app_metadata) free(app_metadata);
-                app_metadata = NULL;
-                error = true;
-                break;
-            }
-
-            app_metadata = tmp_app_metadata;
-            tmp_app_metadata = NULL;
+        /* Update output counter. */
+        *out_count = filtered_count;
 
-            /* Set current pointer and increase counter. */
-            app_metadata[app_count++] = cur_app_metadata;
+        if (!filtered_app_metadata || !filtered_count)
+        {
+            LOG_MSG_ERROR("No content data found for %s!", is_system ? "system titles" : "user applications");
+            break;
         }
 
-        if (error) break;
-
-        /* Update output counter. */
-        *out_count = app_count;
+        /* Return a copy of the filtered view. The caller takes ownership of the returned array, and the cached one can be invalidated at any time by background threads. */
+        app_metadata = malloc(filtered_count * sizeof(TitleApplicationMetadata*));
+        if (!app_metadata)
+        {
+            LOG_MSG_ERROR("Failed to allocate application metadata pointer array! (%u element[s]).", filtered_count);
+            break;
+        }
 
-        if (!app_metadata || !app_count) LOG_MSG_ERROR("No content data found for %s!", is_system ? "system titles" : "user applications");
+        memcpy(app_metadata, filtered_app_metadata, filtered_count * sizeof(TitleApplicationMetadata*));
     }
 
     return app_metadata;
@@ -1000,6 +1051,27 @@ bool titleIsGameCardInfoUpdated(void)
     return ret;
 }
 
+bool titleIsStorageInfoUpdated(void)
+{
+    bool ret = false;
+
+    SCOPED_TRY_LOCK(&g_titleMutex)
+    {
+        /* Check if the title storage load thread streamed in new title data. */
+        ret = (g_titleInterfaceInit && g_titleStorageInfoUpdated);
+        if (ret) g_titleStorageInfoUpdated = false;
+    }
+
+    return ret;
+}
+
+bool titleIsStorageLoadComplete(void)
+{
+    bool ret = false;
+    SCOPED_TRY_LOCK(&g_titleMutex) ret = (g_titleInterfaceInit && g_titleStorageLoadCompleted);
+    return ret;
+}
+
 char *titleGenerateFileName(TitleInfo *title_info, u8 naming_convention, u8 illegal_char_replace_type)
 {
     if (!title_info || title_info->meta_key.type < NcmContentMetaType_Application || title_info->meta_key.type > NcmContentMetaType_DataPatch || \
@@ -1209,6 +1281,9 @@ NX_INLINE void titleFreeApplicationMetadata(void)
 
     g_systemMetadata = g_userMetadata = NULL;
     g_systemMetadataCount = g_userMetadataCount = 0;
+
+    /* Free filtered application metadata views. */
+    titleFreeFilteredApplicationMetadata();
 }
 
 static bool titleReallocateApplicationMetadata(u32 extra_app_count, bool is_system, bool free_entries)
@@ -1278,15 +1353,63 @@ end:
     return success;
 }
 
-NX_INLINE bool titleInitializePersistentTitleStorages(void)
+NX_INLINE void titleInvalidateFilteredApplicationMetadata(void)
+{
+    g_filteredSystemMetadataDirty = g_filteredUserMetadataDirty = true;
+}
+
+NX_INLINE void titleFreeFilteredApplicationMetadata(void)
+{
+    /* Only the pointer arrays are freed - the entries themselves belong to the application metadata arrays. */
+    if (g_filteredSystemMetadata) free(g_filteredSystemMetadata);
+    if (g_filteredUserMetadata) free(g_filteredUserMetadata);
+
+    g_filteredSystemMetadata = g_filteredUserMetadata = NULL;
+    g_filteredSystemMetadataCount = g_filteredUserMetadataCount = 0;
+
+    titleInvalidateFilteredApplicationMetadata();
+}
+
+static bool titleRefreshFilteredApplicationMetadata(bool is_system)
 {
-    for(u8 i = NcmStorageId_BuiltInSystem; i <= NcmStorageId_SdCard; i++)
+    TitleApplicationMetadata **cached_app_metadata = (is_system ? g_systemMetadata : g_userMetadata);
+    u32 cached_app_metadata_count = (is_system ? g_systemMetadataCount : g_userMetadataCount);
+
+    TitleApplicationMetadata **filtered_app_metadata = NULL;
+    u32 filtered_count = 0;
+
+    /* Allocate enough room for the worst case scenario upfront, instead of growing the array one entry at a time. */
+    filtered_app_metadata = malloc(cached_app_metadata_count * sizeof(TitleApplicationMetadata*));
+    if (!filtered_app_metadata)
     {
-        if (!titleInitializeTitleStorage(i))
-        {
-            LOG_MSG_ERROR("Failed to initialize title storage with ID %u!", i);
-            return false;
-        }
+        LOG_MSG_ERROR("Failed to allocate filtered application metadata pointer array! (%u element[s]).", cached_app_metadata_count);
+        return false;
+    }
+
+    for(u32 i = 0; i < cached_app_metadata_count; i++)
+    {
+        TitleApplicationMetadata *cur_app_metadata = cached_app_metadata[i];
+        if (!cur_app_metadata) continue;
+
+        /* Skip current metadata entry if content data for this title isn't available. */
+        if ((is_system && !_titleGetInfoFromStorageByTitleId(NcmStorageId_BuiltInSystem, cur_app_metadata->title_id)) || \
+            (!is_system && !titleIsUserApplicationContentAvailable(cur_app_metadata->title_id))) continue;
+
+        filtered_app_metadata[filtered_count++] = cur_app_metadata;
+    }
+
+    /* Replace the previous filtered view. No re-sorting needed - the source arrays are kept sorted at insertion time. */
+    if (is_system)
+    {
+        if (g_filteredSystemMetadata) free(g_filteredSystemMetadata);
+        g_filteredSystemMetadata = filtered_app_metadata;
+        g_filteredSystemMetadataCount = filtered_count;
+        g_filteredSystemMetadataDirty = false;
+    } else {
+        if (g_filteredUserMetadata) free(g_filteredUserMetadata);
+        g_filteredUserMetadata = filtered_app_metadata;
+        g_filteredUserMetadataCount = filtered_count;
+        g_filteredUserMetadataDirty = false;
     }
 
     return true;
@@ -1364,23 +1487,17 @@ static void titleCloseTitleStorage(u8 storage_id)
     NcmContentMetaDatabase *ncm_db = &(title_storage->ncm_db);
     NcmContentStorage *ncm_storage = &(title_storage->ncm_storage);
 
-    /* Free title infos from this title storage. */
+    /* Free title info pointer array from this title storage. */
+    /* The entries themselves (and their content info arrays) live in the storage arena, which is freed wholesale right afterwards. */
     if (title_storage->titles)
     {
-        for(u32 i = 0; i < title_storage->title_count; i++)
-        {
-            TitleInfo *cur_title_info = title_storage->titles[i];
-            if (cur_title_info)
-            {
-                if (cur_title_info->content_infos) free(cur_title_info->content_infos);
-                free(cur_title_info);
-            }
-        }
-
         free(title_storage->titles);
         title_storage->titles = NULL;
     }
 
+    /* Free title info arena from this title storage. */
+    titleStorageArenaFree(title_storage);
+
     /* Reset title count. */
     title_storage->title_count = 0;
 
@@ -1392,6 +1509,9 @@ static void titleCloseTitleStorage(u8 storage_id)
 
     /* Reset ncm storage ID. */
     title_storage->storage_id = NcmStorageId_None;
+
+    /* Invalidate filtered application metadata views - content data from this title storage is no longer available. */
+    titleInvalidateFilteredApplicationMetadata();
 }
 
 static bool titleReallocateTitleInfoFromStorage(TitleStorage *title_storage, u32 extra_title_count, bool free_entries)
@@ -1415,17 +1535,9 @@ static bool titleReallocateTitleInfoFromStorage(TitleStorage *title_storage, u32
             goto end;
         }
 
-        /* Free previously allocated title info entries. */
-        for(u32 i = 0; i <= extra_title_count; i++)
-        {
-            TitleInfo *cur_title_info = title_info[title_count + i];
-            if (cur_title_info)
-            {
-                if (cur_title_info->content_infos) free(cur_title_info->content_infos);
-                free(cur_title_info);
-                cur_title_info = NULL;
-            }
-        }
+        /* Clear pointers to previously allocated title info entries. */
+        /* The entries themselves are arena-backed - their memory is simply abandoned until the title storage is closed. */
+        for(u32 i = 0; i <= extra_title_count; i++) title_info[title_count + i] = NULL;
     }
 
     if (realloc_title_count)
@@ -1462,6 +1574,61 @@ end:
     return success;
 }
 
+static void *titleStorageArenaAllocate(TitleStorage *title_storage, u64 size)
+{
+    if (!title_storage || !size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return NULL;
+    }
+
+    /* Keep all arena allocations aligned to an 8-byte boundary. */
+    size = ALIGN_UP(size, 8);
+
+    TitleInfoArenaChunk *chunk = title_storage->arena;
+
+    /* Allocate a new arena chunk if we have none, or if the current one doesn't have enough room left. */
+    /* Previously filled chunks are kept around - pointers handed out by this function stay valid until the whole arena is freed. */
+    if (!chunk || (chunk->used + size) > chunk->size)
+    {
+        u64 chunk_size = (size > TITLE_INFO_ARENA_CHUNK_SIZE ? size : TITLE_INFO_ARENA_CHUNK_SIZE);
+
+        chunk = calloc(1, sizeof(TitleInfoArenaChunk) + chunk_size);
+        if (!chunk)
+        {
+            LOG_MSG_ERROR("Failed to allocate 0x%lX-byte long arena chunk!", chunk_size);
+            return NULL;
+        }
+
+        chunk->size = chunk_size;
+        chunk->next = title_storage->arena;
+
+        title_storage->arena = chunk;
+    }
+
+    /* Carve the requested block out of the current arena chunk. Returned memory is always zeroed. */
+    void *ptr = (chunk->data + chunk->used);
+    chunk->used += size;
+
+    return ptr;
+}
+
+static void titleStorageArenaFree(TitleStorage *title_storage)
+{
+    if (!title_storage) return;
+
+    TitleInfoArenaChunk *chunk = title_storage->arena;
+
+    while(chunk)
+    {
+        TitleInfoArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    title_storage->arena = NULL;
+}
+
 NX_INLINE void titleFreeOrphanTitleInfoEntries(void)
 {
     if (g_orphanTitleInfo)
@@ -1470,29 +1637,38 @@ NX_INLINE void titleFreeOrphanTitleInfoEntries(void)
         g_orphanTitleInfo = NULL;
     }
 
-    g_orphanTitleInfoCount = 0;
+    g_orphanTitleInfoCount = g_orphanTitleInfoCapacity = 0;
 }
 
 static void titleAddOrphanTitleInfoEntry(TitleInfo *orphan_title)
 {
     if (!orphan_title) return;
 
-    /* Reallocate orphan title info pointer array. */
-    TitleInfo **tmp_orphan_info = realloc(g_orphanTitleInfo, (g_orphanTitleInfoCount + 1) * sizeof(TitleInfo*));
-    if (!tmp_orphan_info)
+    /* Grow the orphan title info pointer array geometrically, if needed. */
+    /* Sorting is deferred to titleUpdateTitleInfoLinkedLists() - it's the only caller, and a single qsort pass at the end beats sorting after every addition. */
+    if (g_orphanTitleInfoCount >= g_orphanTitleInfoCapacity)
     {
-        LOG_MSG_ERROR("Failed to reallocate orphan title info pointer array!");
-        return;
-    }
+        u32 new_capacity = (g_orphanTitleInfoCapacity ? (g_orphanTitleInfoCapacity * 2) : 16);
 
-    g_orphanTitleInfo = tmp_orphan_info;
-    tmp_orphan_info = NULL;
+        TitleInfo **tmp_orphan_info = realloc(g_orphanTitleInfo, new_capacity * sizeof(TitleInfo*));
+        if (!tmp_orphan_info)
+        {
+            LOG_MSG_ERROR("Failed to reallocate orphan title info pointer array!");
+            return;
+        }
+
+        g_orphanTitleInfo = tmp_orphan_info;
+        g_orphanTitleInfoCapacity = new_capacity;
+    }
 
     /* Set orphan title info entry pointer. */
     g_orphanTitleInfo[g_orphanTitleInfoCount++] = orphan_title;
+}
 
-    /* Sort orphan title info entries by title ID, version and storage ID. */
-    if (g_orphanTitleInfoCount > 1) qsort(g_orphanTitleInfo, g_orphanTitleInfoCount, sizeof(TitleInfo*), &titleInfoEntrySortFunction);
+NX_INLINE bool titleIsPreviousOrphanEntry(TitleInfo **prev_orphan_info, u32 prev_orphan_count, TitleInfo *title_info)
+{
+    /* The previous orphan list is sorted with titleInfoEntrySortFunction(), so a binary search with the same comparator can be used for membership checks. */
+    return (prev_orphan_info && prev_orphan_count && bsearch(&title_info, prev_orphan_info, prev_orphan_count, sizeof(TitleInfo*), &titleInfoEntrySortFunction) != NULL);
 }
 
 static bool titleGenerateMetadataEntriesFromSystemTitles(void)
@@ -1533,6 +1709,9 @@ static bool titleGenerateMetadataEntriesFromSystemTitles(void)
     /* Sort metadata entries by title ID. */
     if (g_systemMetadataCount > 1) qsort(g_systemMetadata, g_systemMetadataCount, sizeof(TitleApplicationMetadata*), &titleSystemTitleMetadataEntrySortFunction);
 
+    /* Invalidate filtered application metadata views. */
+    titleInvalidateFilteredApplicationMetadata();
+
     /* Update flag. */
     success = true;
 
@@ -1551,9 +1730,14 @@ static bool titleGenerateMetadataEntriesFromNsRecords(void)
     u32 app_records_block_count = 0, app_records_count = 0, extra_app_count = 0;
     size_t app_records_size = 0, app_records_block_size = (NS_APPLICATION_RECORD_BLOCK_SIZE * sizeof(NsApplicationRecord));
 
-    bool success = false, free_entries = false;
+    u8 *cache_buf = NULL;
+    size_t cache_size = 0;
+    u32 cache_entry_count = 0, cached_ns_records_crc = 0, ns_records_crc = 0;
+
+    bool success = false, cache_dirty = false;
 
     /* Retrieve NS application records in a loop until we get them all. */
+    /* No locking needed here - only local buffers are touched. */
     do {
         /* Allocate memory for the NS application records. */
         tmp_app_records = realloc(app_records, app_records_size + app_records_block_size);
@@ -1590,38 +1774,66 @@ static bool titleGenerateMetadataEntriesFromNsRecords(void)
         goto end;
     }
 
-    /* Reallocate application metadata pointer array. */
-    if (!titleReallocateApplicationMetadata(app_records_count, false, false))
-    {
-        LOG_MSG_ERROR("Failed to reallocate application metadata pointer array for NS records!");
-        goto end;
-    }
+    /* Calculate a CRC32 checksum over the raw NS application record list. */
+    /* The title metadata cache is keyed by this value - a matching checksum means the cached data is current for every retrieved record. */
+    ns_records_crc = crc32Calculate(app_records, app_records_count * sizeof(NsApplicationRecord));
 
-    free_entries = true;
+    /* Load the title metadata cache from the SD card. */
+    cache_buf = titleLoadMetadataCache(&cache_size, &cache_entry_count, &cached_ns_records_crc);
+    cache_dirty = (!cache_buf || cached_ns_records_crc != ns_records_crc);
 
     /* Retrieve application metadata for each NS application record. */
+    /* Each record is processed under its own lock, so other title interface calls can be serviced in-between - this usually runs on the title storage load thread. */
     for(u32 i = 0; i < app_records_count; i++)
     {
-        TitleApplicationMetadata *cur_app_metadata = g_userMetadata[g_userMetadataCount + extra_app_count];
-        if (!cur_app_metadata)
+        /* Bail out if the title interface is being closed. */
+        if (g_titleStorageLoadThreadExitFlag) break;
+
+        SCOPED_LOCK(&g_titleMutex)
         {
+            /* Reallocate application metadata pointer array. */
+            if (!titleReallocateApplicationMetadata(1, false, false))
+            {
+                LOG_MSG_ERROR("Failed to reallocate application metadata pointer array for NS record #%u!", i);
+                break;
+            }
+
             /* Allocate memory for a new application metadata entry. */
-            cur_app_metadata = calloc(1, sizeof(TitleApplicationMetadata));
+            TitleApplicationMetadata *cur_app_metadata = calloc(1, sizeof(TitleApplicationMetadata));
             if (!cur_app_metadata)
             {
                 LOG_MSG_ERROR("Failed to allocate memory for application metadata entry #%u! (%u / %u).", extra_app_count, i + 1, app_records_count);
-                goto end;
+                break;
             }
 
-            /* Set application metadata entry pointer. */
-            g_userMetadata[g_userMetadataCount + extra_app_count] = cur_app_metadata;
-        }
+            /* Look up the current NS application record in the title metadata cache before issuing any expensive IPC calls. */
+            const TitleMetadataCacheEntry *cache_entry = titleFindMetadataCacheEntry(cache_buf, cache_size, cache_entry_count, app_records[i].application_id);
 
-        /* Retrieve application metadata. */
-        if (!titleRetrieveUserApplicationMetadataByTitleId(app_records[i].application_id, cur_app_metadata)) continue;
+            if (!titleRetrieveCachedUserApplicationMetadata(cache_entry, cur_app_metadata))
+            {
+                /* Cache miss. Retrieve application metadata through IPC and flag the cache for a rewrite. */
+                cache_dirty = true;
 
-        /* Increase extra application metadata counter. */
-        extra_app_count++;
+                if (!titleRetrieveUserApplicationMetadataByTitleId(app_records[i].application_id, cur_app_metadata))
+                {
+                    free(cur_app_metadata);
+                    break;
+                }
+            }
+
+            /* Set application metadata entry pointer and update the application metadata count. */
+            g_userMetadata[g_userMetadataCount++] = cur_app_metadata;
+            extra_app_count++;
+
+            /* Keep application metadata entries sorted by name while they're being streamed in. */
+            if (g_userMetadataCount > 1) qsort(g_userMetadata, g_userMetadataCount, sizeof(TitleApplicationMetadata*), &titleUserApplicationMetadataEntrySortFunction);
+
+            /* Invalidate filtered application metadata views. */
+            titleInvalidateFilteredApplicationMetadata();
+
+            /* Let pollers know new application metadata entries are available. */
+            g_titleStorageInfoUpdated = true;
+        }
     }
 
     /* Check retrieved application metadata count. */
@@ -1631,23 +1843,19 @@ static bool titleGenerateMetadataEntriesFromNsRecords(void)
         goto end;
     }
 
-    /* Update application metadata count. */
-    g_userMetadataCount += extra_app_count;
-
-    /* Free extra allocated pointers if we didn't use them. */
-    if (extra_app_count < app_records_count) titleReallocateApplicationMetadata(0, false, false);
+    /* Free extra allocated pointers if we didn't use them. Ignore return value. */
+    if (extra_app_count < app_records_count) SCOPED_LOCK(&g_titleMutex) titleReallocateApplicationMetadata(0, false, false);
 
-    /* Sort application metadata entries by name. */
-    if (g_userMetadataCount > 1) qsort(g_userMetadata, g_userMetadataCount, sizeof(TitleApplicationMetadata*), &titleUserApplicationMetadataEntrySortFunction);
+    /* Rewrite the title metadata cache if any entry had to be retrieved through IPC, or if the NS application record list changed since the cache was generated. */
+    if (cache_dirty && !g_titleStorageLoadThreadExitFlag) titleSaveMetadataCache(ns_records_crc);
 
     /* Update flag. */
     success = true;
 
 end:
-    if (app_records) free(app_records);
+    if (cache_buf) free(cache_buf);
 
-    /* Free previously allocated application metadata pointers. Ignore return value. */
-    if (!success && free_entries) titleReallocateApplicationMetadata(extra_app_count, false, true);
+    if (app_records) free(app_records);
 
     return success;
 }
@@ -1690,6 +1898,9 @@ static TitleApplicationMetadata *titleGenerateDummySystemMetadataEntry(u64 title
     /* Sort metadata entries by title ID. */
     if (g_systemMetadataCount > 1) qsort(g_systemMetadata, g_systemMetadataCount, sizeof(TitleApplicationMetadata*), &titleSystemTitleMetadataEntrySortFunction);
 
+    /* Invalidate filtered application metadata views. */
+    titleInvalidateFilteredApplicationMetadata();
+
 end:
     /* Free previously allocated application metadata pointer. Ignore return value. */
     if (!cur_app_metadata && free_entry) titleReallocateApplicationMetadata(0, true, false);
@@ -1761,6 +1972,209 @@ static bool titleRetrieveUserApplicationMetadataByTitleId(u64 title_id, TitleApp
     return true;
 }
 
+static u8 *titleLoadMetadataCache(size_t *out_cache_size, u32 *out_entry_count, u32 *out_ns_records_crc)
+{
+    FILE *fp = NULL;
+    size_t cache_size = 0;
+    TitleMetadataCacheHeader cache_header = {0};
+    u8 *cache_buf = NULL;
+    bool success = false;
+
+    /* Open the title metadata cache file. Don't log anything if it doesn't exist - it simply hasn't been generated yet. */
+    fp = fopen(TITLE_METADATA_CACHE_PATH, "rb");
+    if (!fp) return NULL;
+
+    /* Get cache file size. */
+    fseek(fp, 0, SEEK_END);
+    cache_size = (size_t)ftell(fp);
+    rewind(fp);
+
+    if (cache_size <= sizeof(TitleMetadataCacheHeader))
+    {
+        LOG_MSG_ERROR("Invalid title metadata cache file size! (0x%lX).", cache_size);
+        goto end;
+    }
+
+    /* Read and validate the cache file header. */
+    if (fread(&cache_header, 1, sizeof(TitleMetadataCacheHeader), fp) != sizeof(TitleMetadataCacheHeader))
+    {
+        LOG_MSG_ERROR("Failed to read title metadata cache header!");
+        goto end;
+    }
+
+    if (cache_header.magic != __builtin_bswap32(TITLE_METADATA_CACHE_MAGIC) || cache_header.version != TITLE_METADATA_CACHE_VERSION || !cache_header.entry_count)
+    {
+        LOG_MSG_ERROR("Invalid title metadata cache header! (0x%08X, %u, %u).", __builtin_bswap32(cache_header.magic), cache_header.version, cache_header.entry_count);
+        goto end;
+    }
+
+    cache_size -= sizeof(TitleMetadataCacheHeader);
+
+    /* Allocate memory for the serialized cache entries. */
+    cache_buf = malloc(cache_size);
+    if (!cache_buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the title metadata cache! (0x%lX).", cache_size);
+        goto end;
+    }
+
+    /* Read serialized cache entries. */
+    if (fread(cache_buf, 1, cache_size, fp) != cache_size)
+    {
+        LOG_MSG_ERROR("Failed to read title metadata cache entries! (0x%lX).", cache_size);
+        goto end;
+    }
+
+    /* Update output values. */
+    *out_cache_size = cache_size;
+    *out_entry_count = cache_header.entry_count;
+    *out_ns_records_crc = cache_header.ns_records_crc;
+
+    /* Update flag. */
+    success = true;
+
+end:
+    if (fp) fclose(fp);
+
+    if (!success)
+    {
+        if (cache_buf)
+        {
+            free(cache_buf);
+            cache_buf = NULL;
+        }
+
+        /* Delete the cache file if it couldn't be parsed - it will be regenerated from scratch afterwards. */
+        remove(TITLE_METADATA_CACHE_PATH);
+    }
+
+    return cache_buf;
+}
+
+static const TitleMetadataCacheEntry *titleFindMetadataCacheEntry(const u8 *cache_buf, size_t cache_size, u32 cache_entry_count, u64 title_id)
+{
+    if (!cache_buf || !cache_size || !cache_entry_count || !title_id) return NULL;
+
+    size_t offset = 0;
+
+    /* Walk the serialized cache entries. Variable entry sizes (icon data) make a linear scan unavoidable, but it's still orders of magnitude cheaper than a single IPC call. */
+    for(u32 i = 0; i < cache_entry_count; i++)
+    {
+        if ((offset + sizeof(TitleMetadataCacheEntry)) > cache_size) break;
+
+        const TitleMetadataCacheEntry *cache_entry = (const TitleMetadataCacheEntry*)(cache_buf + offset);
+
+        /* Bail out if the serialized icon data exceeds the cache buffer - better to refetch through IPC than to trust a truncated file. */
+        offset += (sizeof(TitleMetadataCacheEntry) + cache_entry->icon_size);
+        if (offset > cache_size) break;
+
+        if (cache_entry->title_id == title_id) return cache_entry;
+    }
+
+    return NULL;
+}
+
+static bool titleRetrieveCachedUserApplicationMetadata(const TitleMetadataCacheEntry *cache_entry, TitleApplicationMetadata *out)
+{
+    if (!cache_entry || !out) return false;
+
+    u8 *icon = NULL;
+
+    /* Duplicate cached icon data, if available. */
+    if (cache_entry->icon_size)
+    {
+        icon = malloc(cache_entry->icon_size);
+        if (!icon)
+        {
+            LOG_MSG_ERROR("Error allocating memory for the icon buffer! (0x%X).", cache_entry->icon_size);
+            return false;
+        }
+
+        memcpy(icon, (const u8*)cache_entry + sizeof(TitleMetadataCacheEntry), cache_entry->icon_size);
+    }
+
+    /* Copy data. */
+    out->title_id = cache_entry->title_id;
+
+    memcpy(&(out->lang_entry), &(cache_entry->lang_entry), sizeof(NacpLanguageEntry));
+
+    /* Make sure both strings are NULL-terminated, just in case the cache file was truncated or tampered with. */
+    out->lang_entry.name[sizeof(out->lang_entry.name) - 1] = '\0';
+    out->lang_entry.author[sizeof(out->lang_entry.author) - 1] = '\0';
+
+    out->icon_size = cache_entry->icon_size;
+    out->icon = icon;
+
+    return true;
+}
+
+static void titleSaveMetadataCache(u32 ns_records_crc)
+{
+    FILE *fp = NULL;
+    bool success = false;
+
+    TitleMetadataCacheHeader cache_header = {
+        .magic = __builtin_bswap32(TITLE_METADATA_CACHE_MAGIC),
+        .version = TITLE_METADATA_CACHE_VERSION,
+        .ns_records_crc = ns_records_crc,
+        .entry_count = 0
+    };
+
+    /* Open the title metadata cache file. */
+    fp = fopen(TITLE_METADATA_CACHE_PATH, "wb");
+    if (!fp)
+    {
+        LOG_MSG_ERROR("Failed to open \"%s\" for writing!", TITLE_METADATA_CACHE_PATH);
+        return;
+    }
+
+    SCOPED_LOCK(&g_titleMutex)
+    {
+        u32 i = 0;
+
+        /* Write cache file header. */
+        cache_header.entry_count = g_userMetadataCount;
+        if (fwrite(&cache_header, 1, sizeof(TitleMetadataCacheHeader), fp) != sizeof(TitleMetadataCacheHeader))
+        {
+            LOG_MSG_ERROR("Failed to write title metadata cache header!");
+            break;
+        }
+
+        /* Serialize user application metadata entries. */
+        for(i = 0; i < g_userMetadataCount; i++)
+        {
+            TitleApplicationMetadata *cur_app_metadata = g_userMetadata[i];
+
+            TitleMetadataCacheEntry cache_entry = {0};
+            cache_entry.title_id = cur_app_metadata->title_id;
+            memcpy(&(cache_entry.lang_entry), &(cur_app_metadata->lang_entry), sizeof(NacpLanguageEntry));
+            cache_entry.icon_size = cur_app_metadata->icon_size;
+
+            if (fwrite(&cache_entry, 1, sizeof(TitleMetadataCacheEntry), fp) != sizeof(TitleMetadataCacheEntry) || \
+                (cache_entry.icon_size && fwrite(cur_app_metadata->icon, 1, cache_entry.icon_size, fp) != cache_entry.icon_size))
+            {
+                LOG_MSG_ERROR("Failed to serialize application metadata entry #%u! (%016lX).", i, cache_entry.title_id);
+                break;
+            }
+        }
+
+        /* Update flag. */
+        success = (i >= g_userMetadataCount);
+    }
+
+    fclose(fp);
+
+    if (success)
+    {
+        /* Commit SD card filesystem changes. */
+        utilsCommitSdCardFileSystemChanges();
+        LOG_MSG_INFO("Title metadata cache saved to \"%s\".", TITLE_METADATA_CACHE_PATH);
+    } else {
+        /* Delete the incomplete cache file. */
+        remove(TITLE_METADATA_CACHE_PATH);
+    }
+}
+
 NX_INLINE TitleApplicationMetadata *titleFindApplicationMetadataByTitleId(u64 title_id, bool is_system, u32 extra_app_count)
 {
     if (!title_id || (is_system && (!g_systemMetadata || !g_systemMetadataCount)) || (!is_system && (!g_userMetadata || !g_userMetadataCount))) return NULL;
@@ -1791,6 +2205,9 @@ static bool titleGenerateTitleInfoEntriesForTitleStorage(TitleStorage *title_sto
     u32 total = 0, extra_title_count = 0;
     NcmContentMetaKey *meta_keys = NULL;
 
+    u8 *scratch_buf = NULL;
+    u64 scratch_buf_size = TITLE_META_SCRATCH_BUFFER_SIZE;
+
     bool success = false, free_entries = false;
 
     /* Get content meta keys for this storage. */
@@ -1803,6 +2220,15 @@ static bool titleGenerateTitleInfoEntriesForTitleStorage(TitleStorage *title_sto
         goto end;
     }
 
+    /* Allocate memory for the scratch buffer used to retrieve full content meta values. */
+    /* It's shared across the whole loop and only grows on demand, so title enumeration doesn't pay for per-title heap traffic. */
+    scratch_buf = malloc(scratch_buf_size);
+    if (!scratch_buf)
+    {
+        LOG_MSG_ERROR("Failed to allocate memory for the content meta scratch buffer!");
+        goto end;
+    }
+
     /* Reallocate pointer array in title storage. */
     if (!titleReallocateTitleInfoFromStorage(title_storage, total, false)) goto end;
 
@@ -1817,8 +2243,8 @@ static bool titleGenerateTitleInfoEntriesForTitleStorage(TitleStorage *title_sto
         TitleInfo *cur_title_info = title_storage->titles[title_storage->title_count + extra_title_count];
         if (!cur_title_info)
         {
-            /* Allocate memory for a new entry. */
-            cur_title_info = calloc(1, sizeof(TitleInfo));
+            /* Allocate memory for a new entry within the storage arena. */
+            cur_title_info = titleStorageArenaAllocate(title_storage, sizeof(TitleInfo));
             if (!cur_title_info)
             {
                 LOG_MSG_ERROR("Failed to allocate memory for title info entry #%u! (%u / %u).", extra_title_count, i + 1, total);
@@ -1830,7 +2256,7 @@ static bool titleGenerateTitleInfoEntriesForTitleStorage(TitleStorage *title_sto
         }
 
         /* Get content infos. */
-        if (!titleGetContentInfosForMetaKey(ncm_db, cur_meta_key, &(cur_title_info->content_infos), &(cur_title_info->content_count)))
+        if (!titleGetContentInfosForMetaKey(title_storage, cur_meta_key, &scratch_buf, &scratch_buf_size, &(cur_title_info->content_infos), &(cur_title_info->content_count)))
         {
             LOG_MSG_ERROR("Failed to get content infos for title ID %016lX!", cur_meta_key->id);
             continue;
@@ -1885,12 +2311,15 @@ static bool titleGenerateTitleInfoEntriesForTitleStorage(TitleStorage *title_sto
 
     /* Update linked lists for user applications, patches and add-on contents. */
     /* This will also keep track of orphan titles - titles with no available application metadata. */
-    titleUpdateTitleInfoLinkedLists();
+    /* A full orphan rescan is requested - the new entries may parent previously orphaned titles. */
+    titleUpdateTitleInfoLinkedLists(true);
 
     /* Update flag. */
     success = true;
 
 end:
+    if (scratch_buf) free(scratch_buf);
+
     if (meta_keys) free(meta_keys);
 
     /* Free previously allocated title info pointers. Ignore return value. */
@@ -1984,68 +2413,105 @@ end:
     return success;
 }
 
-static bool titleGetContentInfosForMetaKey(NcmContentMetaDatabase *ncm_db, const NcmContentMetaKey *meta_key, NcmContentInfo **out_content_infos, u32 *out_content_count)
+static bool titleGetContentInfosForMetaKey(TitleStorage *title_storage, const NcmContentMetaKey *meta_key, u8 **scratch_buf, u64 *scratch_buf_size, NcmContentInfo **out_content_infos, \
+                                           u32 *out_content_count)
 {
-    if (!ncm_db || !serviceIsActive(&(ncm_db->s)) || !meta_key || !out_content_infos || !out_content_count)
+    if (!title_storage || !serviceIsActive(&(title_storage->ncm_db.s)) || !meta_key || !scratch_buf || !*scratch_buf || !scratch_buf_size || !*scratch_buf_size || !out_content_infos || \
+        !out_content_count)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
     }
 
+    NcmContentMetaDatabase *ncm_db = &(title_storage->ncm_db);
+
     Result rc = 0;
 
-    NcmContentMetaHeader content_meta_header = {0};
-    u64 content_meta_header_read_size = 0;
+    NcmContentMetaHeader *content_meta_header = NULL;
+    u64 read_size = 0, required_size = 0;
 
     NcmContentInfo *content_infos = NULL;
-    u32 content_count = 0, written = 0;
+    u32 content_count = 0;
 
     bool success = false;
 
-    /* Retrieve content meta header. */
-    rc = ncmContentMetaDatabaseGet(ncm_db, meta_key, &content_meta_header_read_size, &content_meta_header, sizeof(NcmContentMetaHeader));
+    /* Retrieve the full content meta value for this meta key in a single call. */
+    /* The value holds the content meta header, the extended header and all of the content info entries, so parsing it in memory spares us */
+    /* a dedicated ncmContentMetaDatabaseListContentInfo() call per title - which effectively halves the IPC count for the whole title scan. */
+    rc = ncmContentMetaDatabaseGet(ncm_db, meta_key, &read_size, *scratch_buf, *scratch_buf_size);
     if (R_FAILED(rc))
     {
         LOG_MSG_ERROR("ncmContentMetaDatabaseGet failed! (0x%X).", rc);
         goto end;
     }
 
-    if (content_meta_header_read_size != sizeof(NcmContentMetaHeader))
+    if (read_size < sizeof(NcmContentMetaHeader))
     {
-        LOG_MSG_ERROR("Content meta header size mismatch! (0x%lX != 0x%lX).", content_meta_header_read_size, sizeof(NcmContentMetaHeader));
+        LOG_MSG_ERROR("Content meta value size is smaller than its header! (0x%lX < 0x%lX).", read_size, sizeof(NcmContentMetaHeader));
         goto end;
     }
 
     /* Get content count. */
-    content_count = (u32)content_meta_header.content_count;
+    content_meta_header = (NcmContentMetaHeader*)*scratch_buf;
+    content_count = (u32)content_meta_header->content_count;
     if (!content_count)
     {
         LOG_MSG_ERROR("Content count is zero!");
         goto end;
     }
 
-    /* Allocate memory for the content infos. */
-    content_infos = calloc(content_count, sizeof(NcmContentInfo));
-    if (!content_infos)
-    {
-        LOG_MSG_ERROR("Unable to allocate memory for the content infos buffer! (%u content[s]).", content_count);
-        goto end;
-    }
+    /* Calculate the size needed to hold the content meta header, the extended header and all of the content info entries. */
+    required_size = (sizeof(NcmContentMetaHeader) + (u64)content_meta_header->extended_header_size + ((u64)content_count * sizeof(NcmContentInfo)));
 
-    /* Retrieve content infos. */
-    rc = ncmContentMetaDatabaseListContentInfo(ncm_db, (s32*)&written, content_infos, (s32)content_count, meta_key, 0);
-    if (R_FAILED(rc))
+    /* Check if the retrieved data was truncated because our scratch buffer was too small. */
+    if (read_size < required_size)
     {
-        LOG_MSG_ERROR("ncmContentMetaDatabaseListContentInfo failed! (0x%X).", rc);
-        goto end;
+        if (*scratch_buf_size >= required_size)
+        {
+            LOG_MSG_ERROR("Content meta value size mismatch! (0x%lX < 0x%lX).", read_size, required_size);
+            goto end;
+        }
+
+        /* Reallocate scratch buffer. The new size is kept for the rest of the title enumeration loop. */
+        u8 *tmp_buf = realloc(*scratch_buf, required_size);
+        if (!tmp_buf)
+        {
+            LOG_MSG_ERROR("Failed to reallocate content meta scratch buffer! (0x%lX bytes).", required_size);
+            goto end;
+        }
+
+        *scratch_buf = tmp_buf;
+        *scratch_buf_size = required_size;
+        tmp_buf = NULL;
+
+        /* Retrieve the full content meta value once more. */
+        rc = ncmContentMetaDatabaseGet(ncm_db, meta_key, &read_size, *scratch_buf, *scratch_buf_size);
+        if (R_FAILED(rc))
+        {
+            LOG_MSG_ERROR("ncmContentMetaDatabaseGet failed! (0x%X).", rc);
+            goto end;
+        }
+
+        if (read_size < required_size)
+        {
+            LOG_MSG_ERROR("Content meta value size mismatch! (0x%lX < 0x%lX).", read_size, required_size);
+            goto end;
+        }
+
+        content_meta_header = (NcmContentMetaHeader*)*scratch_buf;
     }
 
-    if (written != content_count)
+    /* Allocate memory for the content infos within the storage arena, right next to the title info entries that reference them. */
+    content_infos = titleStorageArenaAllocate(title_storage, (u64)content_count * sizeof(NcmContentInfo));
+    if (!content_infos)
     {
-        LOG_MSG_ERROR("Content count mismatch! (%u != %u).", written, content_count);
+        LOG_MSG_ERROR("Unable to allocate memory for the content infos buffer! (%u content[s]).", content_count);
         goto end;
     }
 
+    /* Copy content info entries from the in-memory content meta value. */
+    memcpy(content_infos, *scratch_buf + sizeof(NcmContentMetaHeader) + content_meta_header->extended_header_size, (u64)content_count * sizeof(NcmContentInfo));
+
     /* Update output. */
     *out_content_infos = content_infos;
     *out_content_count = content_count;
@@ -2053,15 +2519,22 @@ static bool titleGetContentInfosForMetaKey(NcmContentMetaDatabase *ncm_db, const
     success = true;
 
 end:
-    if (!success && content_infos) free(content_infos);
-
     return success;
 }
 
-static void titleUpdateTitleInfoLinkedLists(void)
+static void titleUpdateTitleInfoLinkedLists(bool rescan_orphans)
 {
-    /* Free orphan title info entries. */
-    titleFreeOrphanTitleInfoEntries();
+    /* Invalidate filtered application metadata views - this function runs every time title info entries are added or removed. */
+    titleInvalidateFilteredApplicationMetadata();
+
+    /* Steal the previous orphan title list instead of just freeing it. */
+    /* On removal-only events (rescan_orphans == false) it lets long-standing orphans keep their status without repeating the parent title lookup - */
+    /* nothing new was added, so an orphan can't possibly be resolved. Callers that add title info or application metadata entries must request a full rescan. */
+    TitleInfo **prev_orphan_info = g_orphanTitleInfo;
+    u32 prev_orphan_count = g_orphanTitleInfoCount;
+
+    g_orphanTitleInfo = NULL;
+    g_orphanTitleInfoCount = g_orphanTitleInfoCapacity = 0;
 
     /* Loop through all available title storages. */
     for(u8 i = NcmStorageId_GameCard; i <= NcmStorageId_SdCard; i++)
@@ -2095,6 +2568,13 @@ static void titleUpdateTitleInfoLinkedLists(void)
 
             if (child_info->meta_key.type != NcmContentMetaType_Application && !child_info->app_metadata)
             {
+                /* Keep previously detected orphans as-is if no rescan was requested. */
+                if (!rescan_orphans && titleIsPreviousOrphanEntry(prev_orphan_info, prev_orphan_count, child_info))
+                {
+                    titleAddOrphanTitleInfoEntry(child_info);
+                    continue;
+                }
+
                 /* We're dealing with a patch, an add-on content or an add-on content patch. */
                 /* We'll just retrieve a pointer to the first matching user application entry and use it to set a pointer to an application metadata entry. */
                 u64 app_id = (child_info->meta_key.type == NcmContentMetaType_Patch ? titleGetApplicationIdByPatchId(child_info->meta_key.id) : \
@@ -2148,6 +2628,46 @@ static void titleUpdateTitleInfoLinkedLists(void)
             }
         }
     }
+
+    /* Sort orphan title info entries by title ID, version and storage ID. Single pass - additions during the loops above are unsorted. */
+    if (g_orphanTitleInfoCount > 1) qsort(g_orphanTitleInfo, g_orphanTitleInfoCount, sizeof(TitleInfo*), &titleInfoEntrySortFunction);
+
+    /* Free the previous orphan title list. */
+    if (prev_orphan_info) free(prev_orphan_info);
+}
+
+static void titleRefreshApplicationMetadataPointers(void)
+{
+    /* Loop through all loaded title storages, looking for title info entries without application metadata. */
+    /* This is needed for title info entries that were generated before their application metadata became available (e.g. before the ns record metadata was streamed in). */
+    for(u8 i = NcmStorageId_GameCard; i <= NcmStorageId_SdCard; i++)
+    {
+        /* Don't process system titles. */
+        if (i == NcmStorageId_BuiltInSystem) continue;
+
+        TitleStorage *title_storage = &(g_titleStorage[TITLE_STORAGE_INDEX(i)]);
+        if (!title_storage->titles || !title_storage->title_count) continue;
+
+        for(u32 j = 0; j < title_storage->title_count; j++)
+        {
+            TitleInfo *cur_title_info = title_storage->titles[j];
+            if (!cur_title_info || cur_title_info->app_metadata) continue;
+
+            /* Retrieve application metadata. */
+            u64 app_id = (cur_title_info->meta_key.type <= NcmContentMetaType_Application ? cur_title_info->meta_key.id : \
+                         (cur_title_info->meta_key.type == NcmContentMetaType_Patch ? titleGetApplicationIdByPatchId(cur_title_info->meta_key.id) : \
+                         (cur_title_info->meta_key.type == NcmContentMetaType_AddOnContent ? titleGetApplicationIdByAddOnContentId(cur_title_info->meta_key.id) : \
+                         (cur_title_info->meta_key.type == NcmContentMetaType_Delta ? titleGetApplicationIdByDeltaId(cur_title_info->meta_key.id) : \
+                         (cur_title_info->meta_key.type == NcmContentMetaType_DataPatch ? titleGetApplicationIdByDataPatchId(cur_title_info->meta_key.id) : 0)))));
+            if (!app_id) continue;
+
+            cur_title_info->app_metadata = titleFindApplicationMetadataByTitleId(app_id, false, 0);
+        }
+    }
+
+    /* Update linked lists for user applications, patches and add-on contents. */
+    /* This will also take care of orphan titles we now have application metadata for, hence the full orphan rescan. */
+    titleUpdateTitleInfoLinkedLists(true);
 }
 
 static bool titleCreateGameCardInfoThread(void)
@@ -2307,8 +2827,8 @@ static bool titleRefreshGameCardTitleInfo(void)
         if (g_userMetadataCount > 1) qsort(g_userMetadata, g_userMetadataCount, sizeof(TitleApplicationMetadata*), &titleUserApplicationMetadataEntrySortFunction);
 
         /* Update linked lists for user applications, patches and add-on contents. */
-        /* This will take care of orphan titles we might now have application metadata for. */
-        titleUpdateTitleInfoLinkedLists();
+        /* This will take care of orphan titles we might now have application metadata for, hence the full orphan rescan. */
+        titleUpdateTitleInfoLinkedLists(true);
     } else
     if (g_userMetadata[g_userMetadataCount])
     {
@@ -2337,12 +2857,82 @@ end:
         titleCloseTitleStorage(NcmStorageId_GameCard);
 
         /* Update linked lists for user applications, patches and add-on contents. */
-        titleUpdateTitleInfoLinkedLists();
+        /* Removal-only event: nothing new was added, so previously detected orphans keep their status without a rescan. */
+        titleUpdateTitleInfoLinkedLists(false);
     }
 
     return success;
 }
 
+static bool titleCreateStorageLoadThread(void)
+{
+    /* Reset flags. */
+    g_titleStorageLoadThreadExitFlag = g_titleStorageInfoUpdated = g_titleStorageLoadCompleted = false;
+
+    if (!utilsCreateThread(&g_titleStorageLoadThread, titleStorageLoadThreadFunc, NULL, 1))
+    {
+        LOG_MSG_ERROR("Failed to create title storage load thread!");
+        return false;
+    }
+
+    return true;
+}
+
+static void titleDestroyStorageLoadThread(void)
+{
+    if (!g_titleStorageLoadThreadCreated) return;
+
+    /* Signal the exit flag to terminate the title storage load thread as soon as possible. */
+    g_titleStorageLoadThreadExitFlag = true;
+
+    /* Wait for the title storage load thread to exit. */
+    utilsJoinThread(&g_titleStorageLoadThread);
+
+    g_titleStorageLoadThreadCreated = false;
+}
+
+static void titleStorageLoadThreadFunc(void *arg)
+{
+    (void)arg;
+
+    /* Generate application metadata entries from ns records. */
+    /* Theoretically speaking, we should only need to do this once. */
+    /* However, if any new gamecard is inserted while the application is running, we *will* have to retrieve the metadata from its application(s). */
+    if (!titleGenerateMetadataEntriesFromNsRecords()) LOG_MSG_ERROR("Failed to generate application metadata from ns records!");
+
+    /* Update application metadata pointers from title info entries generated before the ns record metadata became available. */
+    if (!g_titleStorageLoadThreadExitFlag)
+    {
+        SCOPED_LOCK(&g_titleMutex)
+        {
+            titleRefreshApplicationMetadataPointers();
+            g_titleStorageInfoUpdated = true;
+        }
+    }
+
+    /* Initialize the remaining persistent title storages. SdCard goes first - user titles take priority over system ones. */
+    const u8 storage_ids[] = { NcmStorageId_SdCard, NcmStorageId_BuiltInSystem };
+
+    for(u8 i = 0; i < MAX_ELEMENTS(storage_ids) && !g_titleStorageLoadThreadExitFlag; i++)
+    {
+        SCOPED_LOCK(&g_titleMutex)
+        {
+            if (!titleInitializeTitleStorage(storage_ids[i]))
+            {
+                LOG_MSG_ERROR("Failed to initialize title storage with ID %u!", storage_ids[i]);
+                break;
+            }
+
+            g_titleStorageInfoUpdated = true;
+        }
+    }
+
+    /* Update flag. */
+    SCOPED_LOCK(&g_titleMutex) g_titleStorageLoadCompleted = true;
+
+    threadExit();
+}
+
 static bool titleIsUserApplicationContentAvailable(u64 app_id)
 {
     if (!app_id) return false;
@@ -2584,7 +3174,7 @@ static char *titleGetPatchVersionString(TitleInfo *title_info)
     if (storage_id == NcmStorageId_GameCard) hfs_partition_type = GameCardHashFileSystemPartitionType_Secure;
 
     /* Allocate memory for the NCA context. */
-    nca_ctx = calloc(1, sizeof(NcaContext));
+    nca_ctx = ncaAllocateContexts(1);
     if (!nca_ctx)
     {
         LOG_MSG_ERROR("Failed to allocate memory for NCA context!");
@@ -2623,7 +3213,7 @@ static char *titleGetPatchVersionString(TitleInfo *title_info)
 end:
     nacpFreeContext(&nacp_ctx);
 
-    if (nca_ctx) free(nca_ctx);
+    if (nca_ctx) ncaFreeContexts(nca_ctx, 1);
 
     return str;
 }
@@ -22,6 +22,11 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+/* Hot dump-path module. Performance build flavors may strip verbose logging from this translation unit at compile time. */
+#ifdef LOG_MODULE_LEVEL_HOT
+#define LOG_MODULE_LEVEL    LOG_MODULE_LEVEL_HOT
+#endif
+
 #include "nxdt_utils.h"
 #include "usb.h"
 
@@ -30,6 +35,9 @@
 #define USB_CMD_HEADER_MAGIC        0x4E584454                  /* "NXDT". */
 
 #define USB_TRANSFER_ALIGNMENT      0x1000                      /* 4 KiB. */
+
+#define USB_TRANSFER_BUFFER_MIN_LOG2 23                         /* 8 MiB. */
+#define USB_TRANSFER_BUFFER_MAX_LOG2 26                         /* 64 MiB. */
 #define USB_TRANSFER_TIMEOUT        5                           /* 5 seconds. */
 
 #define USB_DEV_VID                 0x057E                      /* VID officially used by Nintendo in usb:ds. */
@@ -55,11 +63,14 @@
 /* Type definitions. */
 
 typedef enum {
-    UsbCommandType_StartSession       = 0,
-    UsbCommandType_SendFileProperties = 1,
-    UsbCommandType_CancelFileTransfer = 2,
-    UsbCommandType_SendNspHeader      = 3,
-    UsbCommandType_EndSession         = 4
+    UsbCommandType_StartSession            = 0,
+    UsbCommandType_SendFileProperties      = 1,
+    UsbCommandType_CancelFileTransfer      = 2,
+    UsbCommandType_SendNspHeader           = 3,
+    UsbCommandType_EndSession              = 4,
+    UsbCommandType_SendFilePropertiesBatch = 5,
+    UsbCommandType_SendDirectoryTable      = 6,
+    UsbCommandType_UseCachedContent        = 7
 } UsbCommandType;
 
 typedef struct {
@@ -77,7 +88,8 @@ typedef struct {
     u8 app_ver_micro;
     u8 abi_version;
     char git_commit[8];
-    u8 reserved[0x4];
+    u8 max_transfer_size_log2;  ///< Log2 of the biggest transfer buffer size supported by the console. Used for transfer size negotiation.
+    u8 reserved[0x3];
 } UsbCommandStartSession;
 
 NXDT_ASSERT(UsbCommandStartSession, 0x10);
@@ -92,6 +104,28 @@ typedef struct {
 
 NXDT_ASSERT(UsbCommandSendFileProperties, 0x320);
 
+typedef struct {
+    u32 entry_count;        ///< Number of UsbCommandSendFileProperties entries that follow this header within the command block.
+    u8 reserved[0xC];
+} UsbCommandSendFilePropertiesBatchHeader;
+
+NXDT_ASSERT(UsbCommandSendFilePropertiesBatchHeader, 0x10);
+
+typedef struct {
+    u32 entry_count;        ///< Number of UsbCommandSendDirectoryTableEntry elements that follow this header within the command block.
+    u8 reserved[0xC];
+} UsbCommandSendDirectoryTableHeader;
+
+NXDT_ASSERT(UsbCommandSendDirectoryTableHeader, 0x10);
+
+typedef struct {
+    u32 path_length;
+    char path[FS_MAX_PATH];
+    u8 reserved[0xB];
+} UsbCommandSendDirectoryTableEntry;
+
+NXDT_ASSERT(UsbCommandSendDirectoryTableEntry, 0x310);
+
 typedef enum {
     ///< Expected response code.
     UsbStatusType_Success               = 0,
@@ -106,14 +140,16 @@ typedef enum {
     UsbStatusType_UnsupportedCommand    = 5,
     UsbStatusType_UnsupportedAbiVersion = 6,
     UsbStatusType_MalformedCommand      = 7,
-    UsbStatusType_HostIoError           = 8
+    UsbStatusType_HostIoError           = 8,
+    UsbStatusType_NotCached             = 9     ///< Not an error. Returned by UseCachedContent commands whenever the host device doesn't hold a copy of the referenced file.
 } UsbStatusType;
 
 typedef struct {
     u32 magic;
-    u32 status;             ///< UsbStatusType.
-    u16 max_packet_size;    ///< USB host endpoint max packet size.
-    u8 reserved[0x6];
+    u32 status;                 ///< UsbStatusType.
+    u16 max_packet_size;        ///< USB host endpoint max packet size.
+    u8 transfer_size_log2;      ///< Log2 of the transfer buffer size chosen by the USB host. Only meaningful in the session-start response. Zero on legacy hosts.
+    u8 reserved[0x5];
 } UsbStatus;
 
 NXDT_ASSERT(UsbStatus, 0x10);
@@ -188,13 +224,27 @@ static bool g_usbInterfaceInit = false;
 static Event *g_usbStateChangeEvent = NULL;
 static Thread g_usbDetectionThread = {0};
 static UEvent g_usbDetectionThreadExitEvent = {0}, g_usbTimeoutEvent = {0};
-static bool g_usbHostAvailable = false, g_usbSessionStarted = false, g_usbDetectionThreadExitFlag = false, g_nspTransferMode = false;
+static UEvent g_usbCancelEvent = {0};
+static bool g_usbHostAvailable = false, g_usbSessionStarted = false, g_usbStatusUpdated = false, g_usbDetectionThreadExitFlag = false, g_nspTransferMode = false;
 static atomic_bool g_usbDetectionThreadCreated = false;
 
 static u8 *g_usbTransferBuffer = NULL;
+static u64 g_usbTransferBufferSize = USB_TRANSFER_BUFFER_SIZE;
 static u64 g_usbTransferRemainingSize = 0, g_usbTransferWrittenSize = 0;
 static u16 g_usbEndpointMaxPacketSize = 0;
 
+/* State from the in-flight transfer submitted by usbSendFileDataAsync(), if any. */
+static bool g_usbPendingXfer = false, g_usbPendingZlt = false, g_usbPendingStatusRead = false;
+static u32 g_usbPendingUrbId = 0;
+static u64 g_usbPendingXferSize = 0;
+
+/* State from the batch announced by usbSendFilePropertiesBatch(), if any. The host only acknowledges batched file data once, after the last chunk from the last non-empty entry. */
+static u64 *g_usbBatchFileSizes = NULL;
+static u32 g_usbBatchFileCount = 0, g_usbBatchFileIndex = 0;
+
+/* Status code from the last host device response read by usbSendCommand(). Used to tell expected non-success responses apart from actual transfer failures. */
+static u32 g_usbLastStatus = UsbStatusType_Success;
+
 /* Function prototypes. */
 
 static bool usbCreateDetectionThread(void);
@@ -212,6 +262,7 @@ static void usbLogStatusDetail(u32 status);
 
 NX_INLINE bool usbAllocateTransferBuffer(void);
 NX_INLINE void usbFreeTransferBuffer(void);
+static bool usbResizeTransferBuffer(u64 size);
 
 static bool usbInitializeComms(void);
 static void usbCloseComms(void);
@@ -223,9 +274,19 @@ NX_INLINE bool usbIsHostAvailable(void);
 
 NX_INLINE void usbSetZltPacket(bool enable);
 
+static bool usbSendFileDataImpl(void *data, u64 data_size, bool async);
+static bool usbWaitPendingFileDataTransfer(void);
+static bool usbCheckFileDataStatusResponse(void);
+
+NX_INLINE void usbResetBatchFileState(void);
+static bool usbAdvanceBatchFileEntry(void);
+
 NX_INLINE bool usbRead(void *buf, size_t size);
 NX_INLINE bool usbWrite(void *buf, size_t size);
+NX_INLINE bool usbWriteAsync(void *buf, size_t size, u32 *out_urb_id);
 static bool usbTransferData(void *buf, size_t size, UsbDsEndpoint *endpoint);
+static bool usbPostTransferAsync(void *buf, u64 size, UsbDsEndpoint *endpoint, u32 *out_urb_id);
+static bool usbWaitTransferComplete(UsbDsEndpoint *endpoint, u32 urb_id, u64 size);
 
 bool usbInitialize(void)
 {
@@ -264,6 +325,9 @@ bool usbInitialize(void)
         /* Create user-mode USB timeout event. */
         ueventCreate(&g_usbTimeoutEvent, true);
 
+        /* Create user-mode USB transfer cancel event. */
+        ueventCreate(&g_usbCancelEvent, true);
+
         /* Create USB detection thread. */
         atomic_store(&g_usbDetectionThreadCreated, usbCreateDetectionThread());
         if (!atomic_load(&g_usbDetectionThreadCreated)) break;
@@ -296,8 +360,8 @@ void usbExit(void)
         /* Free USB transfer buffer. */
         usbFreeTransferBuffer();
 
-        /* Update flag. */
-        g_usbInterfaceInit = false;
+        /* Update flags. */
+        g_usbInterfaceInit = g_usbStatusUpdated = false;
     }
 }
 
@@ -307,6 +371,19 @@ void *usbAllocatePageAlignedBuffer(size_t size)
     return memalign(USB_TRANSFER_ALIGNMENT, size);
 }
 
+bool usbIsStatusUpdated(void)
+{
+    bool ret = false;
+
+    SCOPED_TRY_LOCK(&g_usbInterfaceMutex)
+    {
+        ret = (g_usbInterfaceInit && g_usbStatusUpdated);
+        g_usbStatusUpdated = false;
+    }
+
+    return ret;
+}
+
 u8 usbIsReady(void)
 {
     u8 ret = UsbHostSpeed_None;
@@ -334,6 +411,13 @@ u8 usbIsReady(void)
     return ret;
 }
 
+u64 usbGetTransferBufferSize(void)
+{
+    u64 ret = USB_TRANSFER_BUFFER_SIZE;
+    SCOPED_LOCK(&g_usbInterfaceMutex) ret = g_usbTransferBufferSize;
+    return ret;
+}
+
 bool usbSendFileProperties(u64 file_size, const char *filename, u32 nsp_header_size)
 {
     bool ret = false;
@@ -376,111 +460,225 @@ end:
     return ret;
 }
 
-bool usbSendFileData(void *data, u64 data_size)
+bool usbSendFilePropertiesBatch(const UsbBatchFileEntry *entries, u32 entry_count)
 {
     bool ret = false;
 
     SCOPED_LOCK(&g_usbInterfaceMutex)
     {
-        void *buf = NULL;
-        bool zlt_required = false;
+        u64 cmd_block_size = (sizeof(UsbCommandSendFilePropertiesBatchHeader) + ((u64)entry_count * sizeof(UsbCommandSendFileProperties)));
 
-        if (!g_usbTransferBuffer || !g_usbInterfaceInit || !g_usbHostAvailable || !g_usbSessionStarted || !g_usbTransferRemainingSize || !data || !data_size || data_size > USB_TRANSFER_BUFFER_SIZE || \
-            data_size > g_usbTransferRemainingSize)
+        if (!g_usbInterfaceInit || !g_usbTransferBuffer || !g_usbHostAvailable || !g_usbSessionStarted || !entries || !entry_count || g_nspTransferMode || g_usbTransferRemainingSize || \
+            g_usbBatchFileCount || (sizeof(UsbCommandHeader) + cmd_block_size) > g_usbTransferBufferSize)
         {
             LOG_MSG_ERROR("Invalid parameters!");
-            goto end;
+            break;
         }
 
-        /* Optimization for buffers that already are page aligned. */
-        if (IS_ALIGNED((u64)data, USB_TRANSFER_ALIGNMENT))
+        /* Allocate memory for the batch file sizes. These are used to advance through the batch as file data transfers complete. */
+        u64 *batch_file_sizes = calloc(entry_count, sizeof(u64));
+        if (!batch_file_sizes)
         {
-            buf = data;
-        } else {
-            buf = g_usbTransferBuffer;
-            memcpy(buf, data, data_size);
+            LOG_MSG_ERROR("Failed to allocate memory for the batch file sizes!");
+            break;
         }
 
-        /* Determine if we'll need to set a Zero Length Termination (ZLT) packet. */
-        /* This is automatically handled by usbDsEndpoint_PostBufferAsync(), depending on the ZLT setting from the input (write) endpoint. */
-        /* First, check if this is the last data chunk for this file. */
-        if ((g_usbTransferRemainingSize - data_size) == 0)
+        /* Prepare command data. */
+        usbPrepareCommandHeader(UsbCommandType_SendFilePropertiesBatch, (u32)cmd_block_size);
+
+        UsbCommandSendFilePropertiesBatchHeader *batch_header = (UsbCommandSendFilePropertiesBatchHeader*)(g_usbTransferBuffer + sizeof(UsbCommandHeader));
+        memset(batch_header, 0, sizeof(UsbCommandSendFilePropertiesBatchHeader));
+        batch_header->entry_count = entry_count;
+
+        UsbCommandSendFileProperties *cmd_block = (UsbCommandSendFileProperties*)((u8*)batch_header + sizeof(UsbCommandSendFilePropertiesBatchHeader));
+
+        bool entries_valid = true;
+
+        for(u32 i = 0; i < entry_count; i++)
         {
-            /* Enable ZLT if the last chunk size is aligned to the USB endpoint max packet size. */
-            if (IS_ALIGNED(data_size, g_usbEndpointMaxPacketSize))
-            {
-                zlt_required = true;
-                usbSetZltPacket(true);
-                LOG_MSG_DEBUG("ZLT enabled. Last chunk size: 0x%lX bytes.", data_size);
-            }
-        } else {
-            /* Disable ZLT if this is the first of multiple data chunks. */
-            if (!g_usbTransferWrittenSize)
+            const UsbBatchFileEntry *entry = &(entries[i]);
+            size_t filename_length = 0;
+
+            if (!entry->filename || !(filename_length = strlen(entry->filename)) || filename_length >= FS_MAX_PATH)
             {
-                usbSetZltPacket(false);
-                LOG_MSG_DEBUG("ZLT disabled (first chunk).");
+                LOG_MSG_ERROR("Invalid filename for batch entry #%u!", i);
+                entries_valid = false;
+                break;
             }
+
+            memset(&(cmd_block[i]), 0, sizeof(UsbCommandSendFileProperties));
+
+            cmd_block[i].file_size = entry->file_size;
+            cmd_block[i].filename_length = (u32)filename_length;
+            snprintf(cmd_block[i].filename, sizeof(cmd_block[i].filename), "%s", entry->filename);
+
+            batch_file_sizes[i] = entry->file_size;
         }
 
-        /* Send data chunk. */
-        if (!(ret = usbWrite(buf, data_size)))
+        /* Send command. The host replies with a single status response for the whole batch announcement. */
+        if (!entries_valid || !(ret = usbSendCommand()))
         {
-            LOG_MSG_ERROR("Failed to write 0x%lX bytes long file data chunk from offset 0x%lX! (total size: 0x%lX).", data_size, g_usbTransferWrittenSize, \
-                    g_usbTransferRemainingSize + g_usbTransferWrittenSize);
-            goto end;
+            free(batch_file_sizes);
+            break;
         }
 
-        g_usbTransferRemainingSize -= data_size;
-        g_usbTransferWrittenSize += data_size;
+        /* Update batch state and load the first non-empty entry into the file transfer state. */
+        g_usbBatchFileSizes = batch_file_sizes;
+        g_usbBatchFileCount = entry_count;
+        g_usbBatchFileIndex = 0;
+        g_usbTransferRemainingSize = g_usbTransferWrittenSize = 0;
+
+        /* If the batch only holds empty files, the host doesn't expect any file data at all, so check its aggregated response right away. */
+        if (!usbAdvanceBatchFileEntry()) ret = usbCheckFileDataStatusResponse();
+    }
+
+    return ret;
+}
+
+bool usbSendDirectoryTable(const char **dir_paths, u32 dir_count)
+{
+    bool ret = false;
 
-        /* Check if this is the last chunk. */
-        if (!g_usbTransferRemainingSize)
+    SCOPED_LOCK(&g_usbInterfaceMutex)
+    {
+        if (!g_usbInterfaceInit || !g_usbTransferBuffer || !g_usbHostAvailable || !g_usbSessionStarted || !dir_paths || !dir_count || g_nspTransferMode || g_usbTransferRemainingSize || \
+            g_usbBatchFileCount)
         {
-            /* Check response from host device. */
-            if (!(ret = usbRead(g_usbTransferBuffer, sizeof(UsbStatus))))
-            {
-                LOG_MSG_ERROR("Failed to read 0x%lX bytes long status block!", sizeof(UsbStatus));
-                goto end;
-            }
+            LOG_MSG_ERROR("Invalid parameters!");
+            break;
+        }
+
+        /* Split the table across as many commands as needed to fit the transfer buffer. Each command is self-contained and acknowledged by the host on its own. */
+        u32 max_entries_per_cmd = (u32)((g_usbTransferBufferSize - sizeof(UsbCommandHeader) - sizeof(UsbCommandSendDirectoryTableHeader)) / sizeof(UsbCommandSendDirectoryTableEntry));
+
+        ret = true;
 
-            UsbStatus *cmd_status = (UsbStatus*)g_usbTransferBuffer;
+        for(u32 offset = 0; offset < dir_count && ret; offset += max_entries_per_cmd)
+        {
+            u32 cur_count = MIN(dir_count - offset, max_entries_per_cmd);
+
+            /* Prepare command data. */
+            usbPrepareCommandHeader(UsbCommandType_SendDirectoryTable, (u32)(sizeof(UsbCommandSendDirectoryTableHeader) + ((u64)cur_count * sizeof(UsbCommandSendDirectoryTableEntry))));
+
+            UsbCommandSendDirectoryTableHeader *table_header = (UsbCommandSendDirectoryTableHeader*)(g_usbTransferBuffer + sizeof(UsbCommandHeader));
+            memset(table_header, 0, sizeof(UsbCommandSendDirectoryTableHeader));
+            table_header->entry_count = cur_count;
 
-            if (!(ret = (cmd_status->magic == __builtin_bswap32(USB_CMD_HEADER_MAGIC))))
+            UsbCommandSendDirectoryTableEntry *cmd_block = (UsbCommandSendDirectoryTableEntry*)((u8*)table_header + sizeof(UsbCommandSendDirectoryTableHeader));
+
+            for(u32 i = 0; i < cur_count; i++)
             {
-                LOG_MSG_ERROR("Invalid status block magic word! (0x%08X).", __builtin_bswap32(cmd_status->magic));
-                goto end;
+                const char *dir_path = dir_paths[offset + i];
+                size_t path_length = 0;
+
+                if (!dir_path || !(path_length = strlen(dir_path)) || path_length >= FS_MAX_PATH)
+                {
+                    LOG_MSG_ERROR("Invalid path for directory table entry #%u!", offset + i);
+                    ret = false;
+                    break;
+                }
+
+                memset(&(cmd_block[i]), 0, sizeof(UsbCommandSendDirectoryTableEntry));
+
+                cmd_block[i].path_length = (u32)path_length;
+                snprintf(cmd_block[i].path, sizeof(cmd_block[i].path), "%s", dir_path);
             }
 
-            ret = (cmd_status->status == UsbStatusType_Success);
-#if LOG_LEVEL <= LOG_LEVEL_ERROR
-            if (!ret) usbLogStatusDetail(cmd_status->status);
-#endif
+            /* Send command. */
+            if (ret) ret = usbSendCommand();
         }
+    }
 
-end:
-        /* Disable ZLT if it was previously enabled. */
-        if (zlt_required) usbSetZltPacket(false);
+    return ret;
+}
+
+bool usbSendCachedContentReference(u64 file_size, const char *filename, bool *out_cached)
+{
+    bool ret = false;
+
+    SCOPED_LOCK(&g_usbInterfaceMutex)
+    {
+        size_t filename_length = 0;
 
-        /* Reset variables in case of errors. */
-        if (!ret)
+        if (!g_usbInterfaceInit || !g_usbTransferBuffer || !g_usbHostAvailable || !g_usbSessionStarted || !file_size || !filename || !(filename_length = strlen(filename)) || \
+            filename_length >= FS_MAX_PATH || !out_cached || !g_nspTransferMode || g_usbTransferRemainingSize || g_usbBatchFileCount)
         {
-            g_usbTransferRemainingSize = g_usbTransferWrittenSize = 0;
-            g_nspTransferMode = false;
+            LOG_MSG_ERROR("Invalid parameters!");
+            break;
+        }
+
+        /* Prepare command data. Cached content references reuse the SendFileProperties block layout - the referenced entry is identified by its name and size. */
+        usbPrepareCommandHeader(UsbCommandType_UseCachedContent, (u32)sizeof(UsbCommandSendFileProperties));
+
+        UsbCommandSendFileProperties *cmd_block = (UsbCommandSendFileProperties*)(g_usbTransferBuffer + sizeof(UsbCommandHeader));
+        memset(cmd_block, 0, sizeof(UsbCommandSendFileProperties));
+
+        cmd_block->file_size = file_size;
+        cmd_block->filename_length = (u32)filename_length;
+        snprintf(cmd_block->filename, sizeof(cmd_block->filename), "%s", filename);
+
+        /* Send command. A success response means the host device spliced the referenced file into the output NSP on its own. */
+        if (usbSendCommand())
+        {
+            *out_cached = true;
+            ret = true;
+            break;
+        }
+
+        /* A NotCached response isn't a failure - the caller is simply expected to transfer the entry the usual way. */
+        if (g_usbLastStatus == UsbStatusType_NotCached)
+        {
+            *out_cached = false;
+            ret = true;
         }
     }
 
     return ret;
 }
 
+bool usbSendFileData(void *data, u64 data_size)
+{
+    bool ret = false;
+    SCOPED_LOCK(&g_usbInterfaceMutex) ret = usbSendFileDataImpl(data, data_size, false);
+    return ret;
+}
+
+bool usbSendFileDataAsync(void *data, u64 data_size)
+{
+    bool ret = false;
+    SCOPED_LOCK(&g_usbInterfaceMutex) ret = usbSendFileDataImpl(data, data_size, true);
+    return ret;
+}
+
+bool usbFlushPendingTransfers(void)
+{
+    bool ret = false;
+    SCOPED_LOCK(&g_usbInterfaceMutex) ret = usbWaitPendingFileDataTransfer();
+    return ret;
+}
+
 void usbCancelFileTransfer(void)
 {
+    /* Signal the cancel event before acquiring the interface mutex. A thread blocked on an in-flight transfer holds the mutex, so this is the only way to bound */
+    /* cancellation latency - the transfer wait has the event wired in and aborts right away instead of sitting out the whole transfer timeout. */
+    ueventSignal(&g_usbCancelEvent);
+
     SCOPED_LOCK(&g_usbInterfaceMutex)
     {
-        if (!g_usbInterfaceInit || !g_usbTransferBuffer || !g_usbHostAvailable || !g_usbSessionStarted || (!g_usbTransferRemainingSize && !g_nspTransferMode)) break;
+        /* Clear the cancel event. By this point, any in-flight transfer has either picked it up and aborted, or finished on its own before it could - */
+        /* leaving the event signalled would abort the next unrelated transfer. */
+        ueventClear(&g_usbCancelEvent);
+
+        if (!g_usbInterfaceInit || !g_usbTransferBuffer || !g_usbHostAvailable || !g_usbSessionStarted || \
+            (!g_usbTransferRemainingSize && !g_usbPendingXfer && !g_nspTransferMode && !g_usbBatchFileCount)) break;
+
+        /* Wait for any in-flight transfer to complete before sending the cancel command. We don't care about the result here. */
+        usbWaitPendingFileDataTransfer();
 
         /* Reset variables right away. */
         g_usbTransferRemainingSize = g_usbTransferWrittenSize = 0;
         g_nspTransferMode = false;
+        usbResetBatchFileState();
 
         /* Prepare command data. */
         usbPrepareCommandHeader(UsbCommandType_CancelFileTransfer, 0);
@@ -497,7 +695,7 @@ bool usbSendNspHeader(void *nsp_header, u32 nsp_header_size)
     SCOPED_LOCK(&g_usbInterfaceMutex)
     {
         if (!g_usbInterfaceInit || !g_usbTransferBuffer || !g_usbHostAvailable || !g_usbSessionStarted || g_usbTransferRemainingSize || !g_nspTransferMode || !nsp_header || !nsp_header_size || \
-            nsp_header_size > (USB_TRANSFER_BUFFER_SIZE - sizeof(UsbCommandHeader)))
+            nsp_header_size > (g_usbTransferBufferSize - sizeof(UsbCommandHeader)))
         {
             LOG_MSG_ERROR("Invalid parameters!");
             break;
@@ -517,6 +715,199 @@ bool usbSendNspHeader(void *nsp_header, u32 nsp_header_size)
     return ret;
 }
 
+static bool usbSendFileDataImpl(void *data, u64 data_size, bool async)
+{
+    void *buf = NULL;
+    bool ret = false, zlt_required = false;
+
+    if (!g_usbTransferBuffer || !g_usbInterfaceInit || !g_usbHostAvailable || !g_usbSessionStarted || !g_usbTransferRemainingSize || !data || !data_size || data_size > g_usbTransferBufferSize || \
+        data_size > g_usbTransferRemainingSize)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        goto end;
+    }
+
+    /* Wait until the previous in-flight transfer completes before touching the input endpoint again. */
+    if (!usbWaitPendingFileDataTransfer()) goto end;
+
+    /* Optimization for buffers that already are page aligned. */
+    if (IS_ALIGNED((u64)data, USB_TRANSFER_ALIGNMENT))
+    {
+        buf = data;
+    } else {
+        buf = g_usbTransferBuffer;
+        memcpy(buf, data, data_size);
+    }
+
+    /* Determine if we'll need to set a Zero Length Termination (ZLT) packet. */
+    /* This is automatically handled by usbDsEndpoint_PostBufferAsync(), depending on the ZLT setting from the input (write) endpoint. */
+    /* First, check if this is the last data chunk for this file. */
+    if ((g_usbTransferRemainingSize - data_size) == 0)
+    {
+        /* Enable ZLT if the last chunk size is aligned to the USB endpoint max packet size. */
+        if (IS_ALIGNED(data_size, g_usbEndpointMaxPacketSize))
+        {
+            zlt_required = true;
+            usbSetZltPacket(true);
+            LOG_MSG_DEBUG("ZLT enabled. Last chunk size: 0x%lX bytes.", data_size);
+        }
+    } else {
+        /* Disable ZLT if this is the first of multiple data chunks. */
+        if (!g_usbTransferWrittenSize)
+        {
+            usbSetZltPacket(false);
+            LOG_MSG_DEBUG("ZLT disabled (first chunk).");
+        }
+    }
+
+    if (async)
+    {
+        /* Submit the data chunk without waiting for its completion. The next usbSendFileDataAsync() / usbFlushPendingTransfers() call will wait on it. */
+        u32 urb_id = 0;
+
+        if (!(ret = usbWriteAsync(buf, data_size, &urb_id)))
+        {
+            LOG_MSG_ERROR("Failed to submit 0x%lX bytes long file data chunk from offset 0x%lX! (total size: 0x%lX).", data_size, g_usbTransferWrittenSize, \
+                    g_usbTransferRemainingSize + g_usbTransferWrittenSize);
+            goto end;
+        }
+
+        g_usbTransferRemainingSize -= data_size;
+        g_usbTransferWrittenSize += data_size;
+
+        /* Store in-flight transfer state. ZLT teardown and the host status response check are deferred until the transfer completes. */
+        g_usbPendingXfer = true;
+        g_usbPendingZlt = zlt_required;
+        g_usbPendingStatusRead = (!g_usbTransferRemainingSize && !usbAdvanceBatchFileEntry());
+        g_usbPendingUrbId = urb_id;
+        g_usbPendingXferSize = data_size;
+
+        zlt_required = false;
+    } else {
+        /* Send data chunk. */
+        if (!(ret = usbWrite(buf, data_size)))
+        {
+            LOG_MSG_ERROR("Failed to write 0x%lX bytes long file data chunk from offset 0x%lX! (total size: 0x%lX).", data_size, g_usbTransferWrittenSize, \
+                    g_usbTransferRemainingSize + g_usbTransferWrittenSize);
+            goto end;
+        }
+
+        g_usbTransferRemainingSize -= data_size;
+        g_usbTransferWrittenSize += data_size;
+
+        /* Check response from host device if this was the last chunk and there are no batch entries left. */
+        if (!g_usbTransferRemainingSize && !usbAdvanceBatchFileEntry()) ret = usbCheckFileDataStatusResponse();
+    }
+
+end:
+    /* Disable ZLT if it was previously enabled. */
+    if (zlt_required) usbSetZltPacket(false);
+
+    /* Reset variables in case of errors. */
+    if (!ret)
+    {
+        g_usbTransferRemainingSize = g_usbTransferWrittenSize = 0;
+        g_nspTransferMode = false;
+        usbResetBatchFileState();
+    }
+
+    return ret;
+}
+
+static bool usbWaitPendingFileDataTransfer(void)
+{
+    bool ret = true;
+
+    if (!g_usbPendingXfer) return ret;
+
+    /* Wait for the in-flight transfer to complete. */
+    ret = usbWaitTransferComplete(g_usbEndpointIn, g_usbPendingUrbId, g_usbPendingXferSize);
+
+    /* Clear in-flight transfer state. */
+    g_usbPendingXfer = false;
+    g_usbPendingUrbId = 0;
+    g_usbPendingXferSize = 0;
+
+    /* Disable ZLT if it was enabled for the in-flight chunk. */
+    if (g_usbPendingZlt)
+    {
+        usbSetZltPacket(false);
+        g_usbPendingZlt = false;
+    }
+
+    /* Check response from host device if the in-flight chunk was the last one for the current file. */
+    if (g_usbPendingStatusRead)
+    {
+        if (ret) ret = usbCheckFileDataStatusResponse();
+        g_usbPendingStatusRead = false;
+    }
+
+    /* Reset variables in case of errors. */
+    if (!ret)
+    {
+        g_usbTransferRemainingSize = g_usbTransferWrittenSize = 0;
+        g_nspTransferMode = false;
+        usbResetBatchFileState();
+    }
+
+    return ret;
+}
+
+static bool usbCheckFileDataStatusResponse(void)
+{
+    bool ret = false;
+
+    if (!usbRead(g_usbTransferBuffer, sizeof(UsbStatus)))
+    {
+        LOG_MSG_ERROR("Failed to read 0x%lX bytes long status block!", sizeof(UsbStatus));
+        goto end;
+    }
+
+    UsbStatus *cmd_status = (UsbStatus*)g_usbTransferBuffer;
+
+    if (cmd_status->magic != __builtin_bswap32(USB_CMD_HEADER_MAGIC))
+    {
+        LOG_MSG_ERROR("Invalid status block magic word! (0x%08X).", __builtin_bswap32(cmd_status->magic));
+        goto end;
+    }
+
+    ret = (cmd_status->status == UsbStatusType_Success);
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+    if (!ret) usbLogStatusDetail(cmd_status->status);
+#endif
+
+end:
+    return ret;
+}
+
+NX_INLINE void usbResetBatchFileState(void)
+{
+    if (g_usbBatchFileSizes) free(g_usbBatchFileSizes);
+    g_usbBatchFileSizes = NULL;
+    g_usbBatchFileCount = g_usbBatchFileIndex = 0;
+}
+
+static bool usbAdvanceBatchFileEntry(void)
+{
+    if (!g_usbBatchFileCount) return false;
+
+    /* Skip empty files. The host device creates them without expecting any file data. */
+    while(g_usbBatchFileIndex < g_usbBatchFileCount && !g_usbBatchFileSizes[g_usbBatchFileIndex]) g_usbBatchFileIndex++;
+
+    /* Free the batch state if there are no entries left. */
+    if (g_usbBatchFileIndex >= g_usbBatchFileCount)
+    {
+        usbResetBatchFileState();
+        return false;
+    }
+
+    /* Load the file size from the current batch entry into the file transfer state. */
+    g_usbTransferRemainingSize = g_usbBatchFileSizes[g_usbBatchFileIndex++];
+    g_usbTransferWrittenSize = 0;
+
+    return true;
+}
+
 static bool usbCreateDetectionThread(void)
 {
     if (!utilsCreateThread(&g_usbDetectionThread, usbDetectionThreadFunc, NULL, 1))
@@ -567,6 +958,10 @@ static void usbDetectionThreadFunc(void *arg)
             g_usbSessionStarted = false;
             g_usbTransferRemainingSize = g_usbTransferWrittenSize = 0;
             g_usbEndpointMaxPacketSize = 0;
+            g_usbPendingXfer = g_usbPendingZlt = g_usbPendingStatusRead = false;
+            g_usbPendingUrbId = 0;
+            g_usbPendingXferSize = 0;
+            usbResetBatchFileState();
 
             /* Start a USB session if we're connected to a host device. */
             /* This will essentially hang this thread and all other threads that call USB-related functions until: */
@@ -585,6 +980,9 @@ static void usbDetectionThreadFunc(void *arg)
                     exit_flag = g_usbDetectionThreadExitFlag;
                 }
             }
+
+            /* Let pollers know the USB host connection status changed. */
+            g_usbStatusUpdated = true;
         }
 
         /* Check if the exit event was triggered while waiting for a session to be established. */
@@ -598,6 +996,10 @@ static void usbDetectionThreadFunc(void *arg)
         g_usbHostAvailable = g_usbSessionStarted = g_usbDetectionThreadExitFlag = false;
         g_usbTransferRemainingSize = g_usbTransferWrittenSize = 0;
         g_usbEndpointMaxPacketSize = 0;
+        g_usbPendingXfer = g_usbPendingZlt = g_usbPendingStatusRead = false;
+        g_usbPendingUrbId = 0;
+        g_usbPendingXferSize = 0;
+        usbResetBatchFileState();
     }
 
     threadExit();
@@ -625,6 +1027,9 @@ static bool usbStartSession(void)
     cmd_block->abi_version = USB_ABI_VERSION;
     snprintf(cmd_block->git_commit, sizeof(cmd_block->git_commit), "%s", GIT_COMMIT);
 
+    /* Advertise the biggest transfer buffer size we support, so the host can negotiate a bigger chunk size if it wants to. */
+    cmd_block->max_transfer_size_log2 = USB_TRANSFER_BUFFER_MAX_LOG2;
+
     ret = usbSendCommand();
     if (ret)
     {
@@ -640,6 +1045,28 @@ static bool usbStartSession(void)
             ret = false;
             g_usbEndpointMaxPacketSize = 0;
         }
+
+        if (ret)
+        {
+            /* Get the transfer buffer size chosen by the USB host. Legacy hosts return zero here, which makes us stick to the default size. */
+            u8 transfer_size_log2 = ((UsbStatus*)g_usbTransferBuffer)->transfer_size_log2;
+            u64 transfer_size = (transfer_size_log2 ? BIT_LONG(transfer_size_log2) : USB_TRANSFER_BUFFER_SIZE);
+
+            if (transfer_size_log2 && (transfer_size_log2 < USB_TRANSFER_BUFFER_MIN_LOG2 || transfer_size_log2 > USB_TRANSFER_BUFFER_MAX_LOG2))
+            {
+                LOG_MSG_ERROR("Invalid transfer buffer size value received from USB host: 2^%u.", transfer_size_log2);
+
+                /* Reset flags. */
+                ret = false;
+            } else
+            if (!usbResizeTransferBuffer(transfer_size))
+            {
+                /* Not a fatal error -- chunks sized for the default buffer still form a valid byte stream on the host side. */
+                LOG_MSG_ERROR("Failed to resize transfer buffer to 0x%lX bytes! Falling back to the default size.", transfer_size);
+            } else {
+                LOG_MSG_INFO("Negotiated transfer buffer size: 0x%lX bytes.", g_usbTransferBufferSize);
+            }
+        }
     }
 
 end:
@@ -685,7 +1112,7 @@ static bool usbSendCommand(void)
 
     bool ret = false, zlt_required = false, cmd_block_written = false;
 
-    if ((sizeof(UsbCommandHeader) + cmd_block_size) > USB_TRANSFER_BUFFER_SIZE)
+    if ((sizeof(UsbCommandHeader) + cmd_block_size) > g_usbTransferBufferSize)
     {
         LOG_MSG_ERROR("Invalid command size!");
         status = UsbStatusType_InvalidCommandSize;
@@ -745,6 +1172,9 @@ static bool usbSendCommand(void)
     ret = ((status = cmd_status->status) == UsbStatusType_Success);
 
 end:
+    /* Keep the last status code around for callers that need to inspect non-success responses. */
+    g_usbLastStatus = status;
+
 #if LOG_LEVEL <= LOG_LEVEL_ERROR
     if (!ret) usbLogStatusDetail(status);
 #endif
@@ -777,6 +1207,9 @@ static void usbLogStatusDetail(u32 status)
         case UsbStatusType_HostIoError:
             LOG_MSG_INFO("Host replied with I/O Error status code.");
             break;
+        case UsbStatusType_NotCached:
+            LOG_MSG_DEBUG("Host replied with Not Cached status code.");
+            break;
         default:
             LOG_MSG_INFO("Unknown status code: 0x%X.", status);
             break;
@@ -788,9 +1221,30 @@ NX_INLINE bool usbAllocateTransferBuffer(void)
 {
     if (g_usbTransferBuffer) return true;
     g_usbTransferBuffer = memalign(USB_TRANSFER_ALIGNMENT, USB_TRANSFER_BUFFER_SIZE);
+    g_usbTransferBufferSize = USB_TRANSFER_BUFFER_SIZE;
     return (g_usbTransferBuffer != NULL);
 }
 
+static bool usbResizeTransferBuffer(u64 size)
+{
+    if (size < USB_TRANSFER_BUFFER_SIZE || size > USB_TRANSFER_BUFFER_MAX_SIZE || !IS_ALIGNED(size, USB_TRANSFER_ALIGNMENT))
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
+        return false;
+    }
+
+    if (size == g_usbTransferBufferSize) return true;
+
+    u8 *new_buf = memalign(USB_TRANSFER_ALIGNMENT, size);
+    if (!new_buf) return false;
+
+    free(g_usbTransferBuffer);
+    g_usbTransferBuffer = new_buf;
+    g_usbTransferBufferSize = size;
+
+    return true;
+}
+
 NX_INLINE void usbFreeTransferBuffer(void)
 {
     if (!g_usbTransferBuffer) return;
@@ -1222,9 +1676,22 @@ NX_INLINE bool usbWrite(void *buf, u64 size)
     return usbTransferData(buf, size, g_usbEndpointIn);
 }
 
+NX_INLINE bool usbWriteAsync(void *buf, u64 size, u32 *out_urb_id)
+{
+    return usbPostTransferAsync(buf, size, g_usbEndpointIn, out_urb_id);
+}
+
 static bool usbTransferData(void *buf, u64 size, UsbDsEndpoint *endpoint)
 {
-    if (!buf || !IS_ALIGNED((u64)buf, USB_TRANSFER_ALIGNMENT) || !size || !endpoint)
+    u32 urb_id = 0;
+
+    /* Start a USB transfer using the provided endpoint, then wait for it to finish. */
+    return (usbPostTransferAsync(buf, size, endpoint, &urb_id) && usbWaitTransferComplete(endpoint, urb_id, size));
+}
+
+static bool usbPostTransferAsync(void *buf, u64 size, UsbDsEndpoint *endpoint, u32 *out_urb_id)
+{
+    if (!buf || !IS_ALIGNED((u64)buf, USB_TRANSFER_ALIGNMENT) || !size || !endpoint || !out_urb_id)
     {
         LOG_MSG_ERROR("Invalid parameters!");
         return false;
@@ -1236,24 +1703,46 @@ static bool usbTransferData(void *buf, u64 size, UsbDsEndpoint *endpoint)
         return false;
     }
 
-    Result rc = 0;
-    UsbDsReportData report_data = {0};
-    u32 urb_id = 0, transferred_size = 0;
-    bool thread_exit = false;
-
     /* Start a USB transfer using the provided endpoint. */
-    rc = usbDsEndpoint_PostBufferAsync(endpoint, buf, size, &urb_id);
+    Result rc = usbDsEndpoint_PostBufferAsync(endpoint, buf, size, out_urb_id);
     if (R_FAILED(rc))
     {
-        LOG_MSG_ERROR("usbDsEndpoint_PostBufferAsync failed! (0x%X) (URB ID %u).", rc, urb_id);
+        LOG_MSG_ERROR("usbDsEndpoint_PostBufferAsync failed! (0x%X) (URB ID %u).", rc, *out_urb_id);
+        return false;
+    }
+
+    return true;
+}
+
+static bool usbWaitTransferComplete(UsbDsEndpoint *endpoint, u32 urb_id, u64 size)
+{
+    if (!endpoint || !size)
+    {
+        LOG_MSG_ERROR("Invalid parameters!");
         return false;
     }
 
+    Result rc = 0;
+    UsbDsReportData report_data = {0};
+    u32 transferred_size = 0;
+    bool thread_exit = false, cancel_requested = false;
+
     /* Wait for the transfer to finish. */
     if (g_usbSessionStarted)
     {
         /* If the USB session has already been established, then use a regular timeout value. */
-        rc = eventWait(&(endpoint->CompletionEvent), USB_TRANSFER_TIMEOUT * (u64)1000000000);
+        /* The user-mode cancel event is wired into the wait so usbCancelFileTransfer() can abort a stalled transfer right away instead of eating the whole timeout. */
+        int idx = 0;
+        Waiter completion_event_waiter = waiterForEvent(&(endpoint->CompletionEvent));
+        Waiter cancel_event_waiter = waiterForUEvent(&g_usbCancelEvent);
+
+        rc = waitMulti(&idx, USB_TRANSFER_TIMEOUT * (u64)1000000000, completion_event_waiter, cancel_event_waiter);
+        if (R_SUCCEEDED(rc) && idx == 1)
+        {
+            /* Cancel event triggered. Treat it like a transfer timeout - the in-flight transfer gets aborted and the session is reset. */
+            rc = MAKERESULT(Module_Kernel, KernelError_TimedOut);
+            cancel_requested = true;
+        }
     } else {
         /* If we're starting a USB session, wait indefinitely inside a loop to let the user start the host script. */
         int idx = 0;
@@ -1285,7 +1774,14 @@ static bool usbTransferData(void *buf, u64 size, UsbDsEndpoint *endpoint)
         /* This will "reset" the USB connection by making the background thread wait until a new session is established. */
         if (g_usbSessionStarted) ueventSignal(&g_usbTimeoutEvent);
 
-        if (!thread_exit) LOG_MSG_ERROR("eventWait failed! (0x%X) (URB ID %u).", rc, urb_id);
+        if (cancel_requested)
+        {
+            LOG_MSG_DEBUG("In-flight transfer aborted by cancel request (URB ID %u).", urb_id);
+        } else
+        if (!thread_exit)
+        {
+            LOG_MSG_ERROR("eventWait failed! (0x%X) (URB ID %u).", rc, urb_id);
+        }
 
         return false;
     }
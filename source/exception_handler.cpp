@@ -29,7 +29,7 @@
 #define FP_MASK                     0xFFFFFFFFFF000000UL
 #define STACK_TRACE_SIZE            0x20
 #define IS_HB_ADDR(x)               (info.addr && info.size && (x) >= info.addr && (x) < (info.addr + info.size))
-#define EH_ADD_FMT_STR(fmt, ...)    utilsAppendFormattedStringToBuffer(&exception_str, &exception_str_size, fmt, ##__VA_ARGS__)
+#define EH_ADD_FMT_STR(fmt, ...)    nxdt::utils::AppendExceptionString(fmt, ##__VA_ARGS__)
 
 namespace i18n = brls::i18n;    /* For getStr(). */
 using namespace i18n::literals; /* For _i18n. */
@@ -62,6 +62,26 @@ namespace nxdt::utils {
     }
 
 #if LOG_LEVEL <= LOG_LEVEL_ERROR
+    /* Preallocated crash report arena. Reserved at load time so report generation doesn't depend on heap state at exception time. */
+    static char g_exceptionStr[CRASH_REPORT_BUF_SIZE] = {0};
+    static size_t g_exceptionStrLen = 0;
+
+    __attribute__((format(printf, 1, 2))) static void AppendExceptionString(const char *fmt, ...)
+    {
+        if (!fmt || !*fmt || g_exceptionStrLen >= (sizeof(g_exceptionStr) - 1)) return;
+
+        va_list args;
+        va_start(args, fmt);
+        int formatted_str_len = vsnprintf(g_exceptionStr + g_exceptionStrLen, sizeof(g_exceptionStr) - g_exceptionStrLen, fmt, args);
+        va_end(args);
+
+        if (formatted_str_len <= 0) return;
+
+        /* vsnprintf() returns the full formatted string length, even if the output was truncated to fit the arena. */
+        g_exceptionStrLen += static_cast<size_t>(formatted_str_len);
+        if (g_exceptionStrLen >= sizeof(g_exceptionStr)) g_exceptionStrLen = (sizeof(g_exceptionStr) - 1);
+    }
+
     static bool UnwindStack(u64 *out_stack_trace, u32 *out_stack_trace_size, size_t max_stack_trace_size, u64 cur_fp)
     {
         if (!out_stack_trace || !out_stack_trace_size || !max_stack_trace_size || !cur_fp)
@@ -131,7 +151,8 @@ extern "C" {
     void __libnx_exception_handler(ThreadExceptionDump *ctx)
     {
         MemoryInfo info = {0};
-        std::string error_desc_str, crash_str;
+        const char *error_desc_str = nullptr;
+        std::string crash_str;
 
         /* Get homebrew memory info. */
         nxdt::utils::GetHomebrewMemoryInfo(&info);
@@ -165,16 +186,13 @@ extern "C" {
         }
 
 #if LOG_LEVEL <= LOG_LEVEL_ERROR
-        char *exception_str = NULL;
-        size_t exception_str_size = 0;
-
         u32 stack_trace_size = 0;
         u64 stack_trace[STACK_TRACE_SIZE] = {0};
 
         /* Log exception type. */
         LOG_MSG_ERROR("*** Exception Triggered ***");
 
-        EH_ADD_FMT_STR("Type: %s (0x%X)\r\n", error_desc_str.c_str(), ctx->error_desc);
+        EH_ADD_FMT_STR("Type: %s (0x%X)\r\n", error_desc_str, ctx->error_desc);
 
         /* Log CPU registers. */
         EH_ADD_FMT_STR("Registers:");
@@ -215,11 +233,11 @@ extern "C" {
             EH_ADD_FMT_STR("\r\n");
         }
 
-        /* Write log string. */
-        logWriteStringToLogFile(exception_str);
+        /* Write crash report to the preopened crash report file first - this path performs no allocations at all. */
+        logWriteCrashReportString(nxdt::utils::g_exceptionStr);
 
-        /* Free exception info string. */
-        if (exception_str) free(exception_str);
+        /* Mirror the crash report to the regular logfile. Best-effort - unlike the crash report file, this may allocate memory. */
+        logWriteStringToLogFile(nxdt::utils::g_exceptionStr);
 #endif  /* LOG_LEVEL <= LOG_LEVEL_ERROR */
 
         /* Abort program execution. */
@@ -14,6 +14,89 @@
 
 #include "nxdt_utils.h"
 
+/*-----------------------------------------------------------------------*/
+/* Sequential readahead                                                  */
+/*-----------------------------------------------------------------------*/
+
+/* Each fsStorageRead() call on the BIS System partition pays a full IPC round trip, which dominates */
+/* small sequential reads (e.g. save.c-driven cluster chain scans). Sequential access patterns are   */
+/* detected here and serviced through a prefetched multi-sector window instead.                      */
+
+#define DISKIO_READAHEAD_BUFFER_SIZE    0x40000     /* 256 KiB. */
+#define DISKIO_READAHEAD_SECTOR_COUNT   (DISKIO_READAHEAD_BUFFER_SIZE / FF_MAX_SS)
+
+static u8 *g_readAheadBuffer = NULL;
+static LBA_t g_readAheadSector = 0;
+static UINT g_readAheadCount = 0;           /* Number of valid sectors currently held in the readahead buffer. */
+static LBA_t g_nextSequentialSector = 0;    /* Expected start sector for a sequential access pattern. */
+static u64 g_bisStorageSectorCount = 0;
+
+/*-----------------------------------------------------------------------*/
+/* Shared sector cache                                                   */
+/*-----------------------------------------------------------------------*/
+
+/* FatFs keeps a single one-sector window buffer per volume, so interleaved FAT chain walks and     */
+/* directory scans constantly re-read the same metadata sectors from BIS storage. Single-sector     */
+/* reads are kept in a set-associative LRU cache shared by all mounted volumes to absorb those      */
+/* re-reads. The readahead window above still handles sequential multi-sector access patterns.      */
+
+#define DISKIO_SECTOR_CACHE_SIZE        0x80000     /* 512 KiB. May be tuned without touching the rest of the implementation. */
+#define DISKIO_SECTOR_CACHE_ENTRIES     (DISKIO_SECTOR_CACHE_SIZE / FF_MAX_SS)
+#define DISKIO_SECTOR_CACHE_WAYS        4           /* Set associativity. The least recently used entry within a set is evicted. */
+#define DISKIO_SECTOR_CACHE_SETS        (DISKIO_SECTOR_CACHE_ENTRIES / DISKIO_SECTOR_CACHE_WAYS)
+
+static u8 *g_sectorCacheBuffer = NULL;
+static LBA_t g_sectorCacheTags[DISKIO_SECTOR_CACHE_ENTRIES] = {0};
+static u64 g_sectorCacheTicks[DISKIO_SECTOR_CACHE_ENTRIES] = {0};   /* Zero means the entry is unused. */
+static u64 g_sectorCacheTick = 0;
+
+static bool disk_sector_cache_fetch(LBA_t sector, BYTE *buff)
+{
+    if (!g_sectorCacheBuffer) return false;
+
+    UINT base = (UINT)(((u64)sector % DISKIO_SECTOR_CACHE_SETS) * DISKIO_SECTOR_CACHE_WAYS);
+
+    for(UINT i = 0; i < DISKIO_SECTOR_CACHE_WAYS; i++)
+    {
+        UINT entry = (base + i);
+        if (!g_sectorCacheTicks[entry] || g_sectorCacheTags[entry] != sector) continue;
+
+        memcpy(buff, g_sectorCacheBuffer + ((u64)entry * FF_MAX_SS), FF_MAX_SS);
+        g_sectorCacheTicks[entry] = ++g_sectorCacheTick;
+
+        return true;
+    }
+
+    return false;
+}
+
+static void disk_sector_cache_store(LBA_t sector, const BYTE *buff)
+{
+    /* Allocate the sector cache buffer, if needed. */
+    if (!g_sectorCacheBuffer && !(g_sectorCacheBuffer = malloc(DISKIO_SECTOR_CACHE_SIZE))) return;
+
+    UINT base = (UINT)(((u64)sector % DISKIO_SECTOR_CACHE_SETS) * DISKIO_SECTOR_CACHE_WAYS);
+    UINT victim = base;
+
+    /* Reuse an entry already holding this sector, an unused entry, or the least recently used entry within the set - in that order. */
+    for(UINT i = 0; i < DISKIO_SECTOR_CACHE_WAYS; i++)
+    {
+        UINT entry = (base + i);
+
+        if (g_sectorCacheTicks[entry] && g_sectorCacheTags[entry] == sector)
+        {
+            victim = entry;
+            break;
+        }
+
+        if (g_sectorCacheTicks[entry] < g_sectorCacheTicks[victim]) victim = entry;
+    }
+
+    memcpy(g_sectorCacheBuffer + ((u64)victim * FF_MAX_SS), buff, FF_MAX_SS);
+    g_sectorCacheTags[victim] = sector;
+    g_sectorCacheTicks[victim] = ++g_sectorCacheTick;
+}
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -55,8 +138,67 @@ DRESULT disk_read (
     u64 start_offset = ((u64)FF_MAX_SS * (u64)sector);
     u64 read_size = ((u64)FF_MAX_SS * (u64)count);
 
+    /* Serve single-sector requests straight from the shared sector cache on a hit. */
+    if (count == 1 && disk_sector_cache_fetch(sector, buff))
+    {
+        g_nextSequentialSector = (sector + count);
+        return RES_OK;
+    }
+
+    /* Serve the request straight from the readahead buffer on a full hit. */
+    if (g_readAheadCount && sector >= g_readAheadSector && (sector + count) <= (g_readAheadSector + g_readAheadCount))
+    {
+        memcpy(buff, g_readAheadBuffer + ((u64)(sector - g_readAheadSector) * FF_MAX_SS), read_size);
+        if (count == 1) disk_sector_cache_store(sector, buff);
+        g_nextSequentialSector = (sector + count);
+        return RES_OK;
+    }
+
+    /* Prefetch a full readahead window if this request continues a sequential access pattern. */
+    if (sector && sector == g_nextSequentialSector && count <= DISKIO_READAHEAD_SECTOR_COUNT)
+    {
+        /* Retrieve the BIS System partition sector count, if needed. */
+        if (!g_bisStorageSectorCount)
+        {
+            s64 storage_size = 0;
+            rc = fsStorageGetSize(utilsGetEmmcBisSystemPartitionStorage(), &storage_size);
+            if (R_SUCCEEDED(rc)) g_bisStorageSectorCount = ((u64)storage_size / FF_MAX_SS);
+        }
+
+        /* Allocate the readahead buffer, if needed. */
+        if (!g_readAheadBuffer) g_readAheadBuffer = malloc(DISKIO_READAHEAD_BUFFER_SIZE);
+
+        /* Clamp the readahead window to the end of the partition. */
+        u64 window_count = (g_bisStorageSectorCount > (u64)sector ? (g_bisStorageSectorCount - (u64)sector) : 0);
+        if (window_count > DISKIO_READAHEAD_SECTOR_COUNT) window_count = DISKIO_READAHEAD_SECTOR_COUNT;
+
+        if (g_readAheadBuffer && window_count >= (u64)count)
+        {
+            rc = fsStorageRead(utilsGetEmmcBisSystemPartitionStorage(), start_offset, g_readAheadBuffer, window_count * FF_MAX_SS);
+            if (R_SUCCEEDED(rc))
+            {
+                g_readAheadSector = sector;
+                g_readAheadCount = (UINT)window_count;
+                g_nextSequentialSector = (sector + count);
+
+                memcpy(buff, g_readAheadBuffer, read_size);
+                if (count == 1) disk_sector_cache_store(sector, buff);
+                return RES_OK;
+            }
+
+            /* Invalidate the readahead buffer and fall back to a direct read. */
+            g_readAheadCount = 0;
+        }
+    }
+
     rc = fsStorageRead(utilsGetEmmcBisSystemPartitionStorage(), start_offset, buff, read_size);
 
+    if (R_SUCCEEDED(rc))
+    {
+        if (count == 1) disk_sector_cache_store(sector, buff);
+        g_nextSequentialSector = (sector + count);
+    }
+
     return (R_SUCCEEDED(rc) ? RES_OK : RES_ERROR);
 }
 
@@ -82,6 +224,33 @@ DRESULT disk_write (
 
 #endif
 
+/*-----------------------------------------------------------------------*/
+/* Free Cache Buffers                                                    */
+/*-----------------------------------------------------------------------*/
+
+void disk_free_cache_buffers (void)
+{
+    if (g_readAheadBuffer)
+    {
+        free(g_readAheadBuffer);
+        g_readAheadBuffer = NULL;
+    }
+
+    g_readAheadSector = g_nextSequentialSector = 0;
+    g_readAheadCount = 0;
+    g_bisStorageSectorCount = 0;
+
+    if (g_sectorCacheBuffer)
+    {
+        free(g_sectorCacheBuffer);
+        g_sectorCacheBuffer = NULL;
+    }
+
+    memset(g_sectorCacheTags, 0, sizeof(g_sectorCacheTags));
+    memset(g_sectorCacheTicks, 0, sizeof(g_sectorCacheTicks));
+    g_sectorCacheTick = 0;
+}
+
 /*-----------------------------------------------------------------------*/
 /* Miscellaneous Functions                                               */
 /*-----------------------------------------------------------------------*/
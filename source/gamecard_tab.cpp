@@ -74,9 +74,23 @@ namespace nxdt::views
                 this->error_frame->SetMessage(i18n::getStr("gamecard_tab/error_frame/info_not_loaded"_i18n, GITHUB_NEW_ISSUE_URL));
                 break;
             case GameCardStatus_InsertedAndInfoLoaded:
-                /* Update list and switch to it. */
-                this->PopulateList();
+            {
+                GameCardHeader card_header = {0};
+                bool same_card = (gamecardGetHeader(&card_header) && card_header.package_id && card_header.package_id == this->card_package_id);
+
+                if (same_card && this->capacity_row)
+                {
+                    /* Repeat event from the very same card. Patch the property values that actually changed instead of tearing down and rebuilding the whole view hierarchy. */
+                    this->UpdatePropertiesTable();
+                    this->SwitchLayerView(false);
+                } else {
+                    /* Update list and switch to it. */
+                    this->card_package_id = card_header.package_id;
+                    this->PopulateList();
+                }
+
                 break;
+            }
             default:
                 break;
         }
@@ -96,11 +110,53 @@ namespace nxdt::views
         return std::string(strbuf);
     }
 
+    void GameCardTab::UpdateTableRowValue(brls::TableRow *row, std::string& cur_value, const std::string& new_value)
+    {
+        if (cur_value == new_value) return;
+        cur_value = new_value;
+        row->setValue(new_value);
+    }
+
+    void GameCardTab::UpdatePropertiesTable(void)
+    {
+        GameCardInfo card_info = {0};
+
+        /* Retrieve current property values. */
+        std::string capacity = this->GetFormattedSizeString(&gamecardGetRomCapacity);
+        std::string total_size = this->GetFormattedSizeString(&gamecardGetTotalSize);
+        std::string trimmed_size = this->GetFormattedSizeString(&gamecardGetTrimmedSize);
+
+        gamecardGetDecryptedCardInfoArea(&card_info);
+
+        const Version *upp_version = &(card_info.upp_version);
+        std::string update_version = fmt::format("{}.{}.{}-{}.{} (v{})", upp_version->system_version.major, upp_version->system_version.minor, upp_version->system_version.micro, \
+                                                                         upp_version->system_version.major_relstep, upp_version->system_version.minor_relstep, upp_version->value);
+
+        u64 fw_version = card_info.fw_version;
+        std::string lafw_version = fmt::format("{} ({})", fw_version, fw_version >= GameCardFwVersion_Count ? "generic/unknown"_i18n : gamecardGetRequiredHosVersionString(fw_version));
+
+        const SdkAddOnVersion *fw_mode = &(card_info.fw_mode);
+        std::string sdk_version = fmt::format("{}.{}.{}-{} (v{})", fw_mode->major, fw_mode->minor, fw_mode->micro, fw_mode->relstep, fw_mode->value);
+
+        u8 compat_type = card_info.compatibility_type;
+        std::string compatibility_type = fmt::format("{} ({})", \
+                                                     compat_type >= GameCardCompatibilityType_Count ? "generic/unknown"_i18n : gamecardGetCompatibilityTypeString(compat_type), \
+                                                     compat_type);
+
+        /* Patch only the rows whose values actually changed. */
+        this->UpdateTableRowValue(this->capacity_row, this->capacity_val, capacity);
+        this->UpdateTableRowValue(this->total_size_row, this->total_size_val, total_size);
+        this->UpdateTableRowValue(this->trimmed_size_row, this->trimmed_size_val, trimmed_size);
+        this->UpdateTableRowValue(this->update_version_row, this->update_version_val, update_version);
+        this->UpdateTableRowValue(this->lafw_version_row, this->lafw_version_val, lafw_version);
+        this->UpdateTableRowValue(this->sdk_version_row, this->sdk_version_val, sdk_version);
+        this->UpdateTableRowValue(this->compatibility_type_row, this->compatibility_type_val, compatibility_type);
+    }
+
     void GameCardTab::PopulateList(void)
     {
         TitleApplicationMetadata **app_metadata = NULL;
         u32 app_metadata_count = 0;
-        GameCardInfo card_info = {0};
 
         bool update_focused_view = this->IsListItemFocused();
         int focus_stack_index = this->GetFocusStackViewIndex();
@@ -144,34 +200,24 @@ namespace nxdt::views
         this->list->addView(new brls::Header("gamecard_tab/list/properties_table/header"_i18n));
 
         FocusableTable *properties_table = new FocusableTable();
-        brls::TableRow *capacity = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/capacity"_i18n);
-        brls::TableRow *total_size = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/total_size"_i18n);
-        brls::TableRow *trimmed_size = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/trimmed_size"_i18n);
-        brls::TableRow *update_version = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/update_version"_i18n);
-        brls::TableRow *lafw_version = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/lafw_version"_i18n);
-        brls::TableRow *sdk_version = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/sdk_version"_i18n);
-        brls::TableRow *compatibility_type = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/compatibility_type"_i18n);
-
-        capacity->setValue(this->GetFormattedSizeString(&gamecardGetRomCapacity));
-        total_size->setValue(this->GetFormattedSizeString(&gamecardGetTotalSize));
-        trimmed_size->setValue(this->GetFormattedSizeString(&gamecardGetTrimmedSize));
-
-        gamecardGetDecryptedCardInfoArea(&card_info);
-
-        const Version *upp_version = &(card_info.upp_version);
-        update_version->setValue(fmt::format("{}.{}.{}-{}.{} (v{})", upp_version->system_version.major, upp_version->system_version.minor, upp_version->system_version.micro, \
-                                                                     upp_version->system_version.major_relstep, upp_version->system_version.minor_relstep, upp_version->value));
-
-        u64 fw_version = card_info.fw_version;
-        lafw_version->setValue(fmt::format("{} ({})", fw_version, fw_version >= GameCardFwVersion_Count ? "generic/unknown"_i18n : gamecardGetRequiredHosVersionString(fw_version)));
-
-        const SdkAddOnVersion *fw_mode = &(card_info.fw_mode);
-        sdk_version->setValue(fmt::format("{}.{}.{}-{} (v{})", fw_mode->major, fw_mode->minor, fw_mode->micro, fw_mode->relstep, fw_mode->value));
-
-        u8 compat_type = card_info.compatibility_type;
-        compatibility_type->setValue(fmt::format("{} ({})", \
-                                                        compat_type >= GameCardCompatibilityType_Count ? "generic/unknown"_i18n : gamecardGetCompatibilityTypeString(compat_type), \
-                                                        compat_type));
+        this->capacity_row = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/capacity"_i18n);
+        this->total_size_row = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/total_size"_i18n);
+        this->trimmed_size_row = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/trimmed_size"_i18n);
+        this->update_version_row = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/update_version"_i18n);
+        this->lafw_version_row = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/lafw_version"_i18n);
+        this->sdk_version_row = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/sdk_version"_i18n);
+        this->compatibility_type_row = properties_table->addRow(brls::TableRowType::BODY, "gamecard_tab/list/properties_table/compatibility_type"_i18n);
+
+        /* Reset the cached property values and fill the freshly created rows. */
+        this->capacity_val.clear();
+        this->total_size_val.clear();
+        this->trimmed_size_val.clear();
+        this->update_version_val.clear();
+        this->lafw_version_val.clear();
+        this->sdk_version_val.clear();
+        this->compatibility_type_val.clear();
+
+        this->UpdatePropertiesTable();
 
         this->list->addView(properties_table);
 
@@ -0,0 +1,56 @@
+/*
+ * lazy_tab.cpp
+ *
+ * Copyright (c) 2020-2023, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of nxdumptool (https://github.com/DarkMatterCore/nxdumptool).
+ *
+ * nxdumptool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * nxdumptool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <nxdt_utils.h>
+#include <lazy_tab.hpp>
+
+namespace nxdt::views
+{
+    LazyTab::LazyTab(Factory factory) : brls::LayerView(), factory(factory) { }
+
+    void LazyTab::SetParentSidebarItem(brls::SidebarItem *sidebar_item)
+    {
+        if (sidebar_item) this->sidebar_item = sidebar_item;
+    }
+
+    void LazyTab::Build(void)
+    {
+        if (this->built) return;
+
+        /* Build the wrapped view and hand it the sidebar item it belongs to. */
+        this->addLayer(this->factory(this->sidebar_item));
+        this->changeLayer(0);
+        this->invalidate(true);
+
+        /* Update flag. */
+        this->built = true;
+
+        LOG_MSG_DEBUG("Lazy tab built.");
+    }
+
+    void LazyTab::willAppear(bool resetState)
+    {
+        /* Make sure the wrapped view exists before it gets displayed for the first time. */
+        this->Build();
+
+        brls::LayerView::willAppear(resetState);
+    }
+}
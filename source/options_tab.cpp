@@ -57,16 +57,16 @@ namespace nxdt::views
         /* Update progress percentage. */
         this->progress_display->setProgress(progress.percentage, 100);
 
-        /* Update size string. */
-        this->size_lbl->setText(fmt::format("{} / {}", this->GetFormattedSizeString(static_cast<double>(progress.current)), \
-                                                         progress.size ? this->GetFormattedSizeString(static_cast<double>(progress.size)) : "?"));
+        /* Update size string. Cached formatters only regenerate their output when the underlying raw value changes. */
+        this->size_lbl->setText(fmt::format("{} / {}", utilsGetFormattedSizeStringFromCache(&(this->cur_size_cache), static_cast<u64>(progress.current)), \
+                                                         progress.size ? utilsGetFormattedSizeStringFromCache(&(this->total_size_cache), static_cast<u64>(progress.size)) : "?"));
 
         /* Update speed / ETA string. */
         if (progress.eta.length())
         {
-            this->speed_eta_lbl->setText(fmt::format("{}/s - ETA: {}", this->GetFormattedSizeString(progress.speed), progress.eta));
+            this->speed_eta_lbl->setText(fmt::format("{}/s - ETA: {}", utilsGetFormattedSizeStringFromCache(&(this->speed_cache), static_cast<u64>(progress.speed)), progress.eta));
         } else {
-            this->speed_eta_lbl->setText(fmt::format("{}/s", this->GetFormattedSizeString(progress.speed)));
+            this->speed_eta_lbl->setText(fmt::format("{}/s", utilsGetFormattedSizeStringFromCache(&(this->speed_cache), static_cast<u64>(progress.speed))));
         }
 
         this->invalidate();
@@ -128,13 +128,6 @@ namespace nxdt::views
             this->speed_eta_lbl->getHeight());
     }
 
-    std::string OptionsTabUpdateProgress::GetFormattedSizeString(double size)
-    {
-        char strbuf[0x40] = {0};
-        utilsGenerateFormattedSizeString(size, strbuf, sizeof(strbuf));
-        return std::string(strbuf);
-    }
-
     OptionsTabUpdateFileDialog::OptionsTabUpdateFileDialog(std::string path, std::string url, bool force_https, std::string success_str) : brls::Dialog(), success_str(success_str)
     {
         /* Set content view. */
@@ -248,7 +241,7 @@ namespace nxdt::views
         });
 
         /* Start JSON task. */
-        this->json_task.execute(GITHUB_API_RELEASE_URL, true);
+        this->json_task.execute(GITHUB_API_RELEASE_URL, true, GITHUB_API_RELEASE_CACHE_PATH);
     }
 
     OptionsTabUpdateApplicationFrame::~OptionsTabUpdateApplicationFrame(void)
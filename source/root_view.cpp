@@ -21,11 +21,14 @@
 
 #include <nxdt_utils.h>
 #include <root_view.hpp>
+#include <lazy_tab.hpp>
 #include <gamecard_tab.hpp>
 #include <titles_tab.hpp>
 #include <options_tab.hpp>
 #include <about_tab.hpp>
 
+#define LAZY_TAB_PREWARM_DELAY_FRAMES   60  /* ~1 second at 60 FPS. */
+
 namespace i18n = brls::i18n;    /* For getStr(). */
 using namespace i18n::literals; /* For _i18n. */
 
@@ -103,29 +106,54 @@ namespace nxdt::views
         this->title_task = new nxdt::tasks::TitleTask();
         this->ums_task = new nxdt::tasks::UmsTask();
         this->usb_host_task = new nxdt::tasks::UsbHostTask();
+        this->idle_maintenance_task = new nxdt::tasks::IdleMaintenanceTask();
 
         /* Add tabs. */
+        /* Only the initially-focused gamecard tab is built right away - the rest are wrapped in LazyTab objects and constructed on first focus, or by the idle prewarm in draw(). */
+        /* This keeps time-to-first-frame tied to the gamecard status check instead of every subsystem the other tabs pull data from. */
         GameCardTab *gamecard_tab = new GameCardTab(this);
         this->addTab("root_view/tabs/gamecard"_i18n, gamecard_tab);
         gamecard_tab->SetParentSidebarItem(static_cast<brls::SidebarItem*>(this->sidebar->getChild(this->sidebar->getViewsCount() - 1)));
 
         this->addSeparator();
 
-        TitlesTab *user_titles_tab = new TitlesTab(this, false);
+        LazyTab *user_titles_tab = new LazyTab([this](brls::SidebarItem *sidebar_item) -> brls::View* {
+            TitlesTab *titles_tab = new TitlesTab(this, false);
+            titles_tab->SetParentSidebarItem(sidebar_item);
+            return titles_tab;
+        });
+
         this->addTab("root_view/tabs/user_titles"_i18n, user_titles_tab);
         user_titles_tab->SetParentSidebarItem(static_cast<brls::SidebarItem*>(this->sidebar->getChild(this->sidebar->getViewsCount() - 1)));
+        this->lazy_tabs.push_back(user_titles_tab);
+
+        LazyTab *system_titles_tab = new LazyTab([this](brls::SidebarItem *sidebar_item) -> brls::View* {
+            TitlesTab *titles_tab = new TitlesTab(this, true);
+            titles_tab->SetParentSidebarItem(sidebar_item);
+            return titles_tab;
+        });
 
-        TitlesTab *system_titles_tab = new TitlesTab(this, true);
         this->addTab("root_view/tabs/system_titles"_i18n, system_titles_tab);
         system_titles_tab->SetParentSidebarItem(static_cast<brls::SidebarItem*>(this->sidebar->getChild(this->sidebar->getViewsCount() - 1)));
+        this->lazy_tabs.push_back(system_titles_tab);
 
         this->addSeparator();
 
-        this->addTab("root_view/tabs/options"_i18n, new OptionsTab(this));
+        LazyTab *options_tab = new LazyTab([this](brls::SidebarItem*) -> brls::View* {
+            return new OptionsTab(this);
+        });
+
+        this->addTab("root_view/tabs/options"_i18n, options_tab);
+        this->lazy_tabs.push_back(options_tab);
 
         this->addSeparator();
 
-        this->addTab("root_view/tabs/about"_i18n, new AboutTab());
+        LazyTab *about_tab = new LazyTab([](brls::SidebarItem*) -> brls::View* {
+            return new AboutTab();
+        });
+
+        this->addTab("root_view/tabs/about"_i18n, about_tab);
+        this->lazy_tabs.push_back(about_tab);
 
         /* Subscribe to status info event. */
         this->status_info_task_sub = this->status_info_task->RegisterListener([this](const nxdt::tasks::StatusInfoData *status_info_data) {
@@ -180,6 +208,7 @@ namespace nxdt::views
         this->title_task->stop();
         this->ums_task->stop();
         this->usb_host_task->stop();
+        this->idle_maintenance_task->stop();
 
         /* Destroy labels. */
         delete this->applet_mode_lbl;
@@ -224,6 +253,15 @@ namespace nxdt::views
     {
         brls::AppletFrame::draw(vg, x, y, width, height, style, ctx);
 
+        /* Idle prewarm: once the UI has been up for a short while, build one pending lazy tab per frame. */
+        /* Spreading construction across frames keeps each one within the frame budget, and the delay keeps the prewarm itself off the startup path it exists to shorten. */
+        if (!this->lazy_tabs.empty() && ++(this->prewarm_frame_count) >= LAZY_TAB_PREWARM_DELAY_FRAMES)
+        {
+            LazyTab *lazy_tab = this->lazy_tabs.front();
+            this->lazy_tabs.erase(this->lazy_tabs.begin());
+            lazy_tab->Build();
+        }
+
         if (this->applet_mode) this->applet_mode_lbl->frame(ctx);
 
         this->time_lbl->frame(ctx);
@@ -21,9 +21,14 @@
 
 #include <nxdt_includes.h>
 #include <tasks.hpp>
+#include <core/nxdt_datfile.h>
+#include <core/rsa.h>
 
 #define NXDT_TASK_INTERVAL  250 /* 250 ms. */
 
+#define NXDT_IDLE_INPUT_THRESHOLD   10000   /* 10 seconds without controller input before maintenance jobs may run. */
+#define NXDT_IDLE_JOB_RETRY_DELAY   30000   /* 30 seconds between attempts for a re-queued maintenance job. */
+
 using namespace brls::i18n::literals;   /* For _i18n. */
 
 namespace nxdt::tasks
@@ -38,6 +43,9 @@ namespace nxdt::tasks
 
     StatusInfoTask::~StatusInfoTask(void)
     {
+        /* Wait until any in-flight network state query finishes - its callback references this object. */
+        while(this->network_query_active.load()) svcSleepThread(10000000); // 10 ms
+
         LOG_MSG_DEBUG("Status info task stopped.");
     }
 
@@ -46,6 +54,26 @@ namespace nxdt::tasks
         return (this->status_info_data.ip_addr != NULL);
     }
 
+    void StatusInfoTask::UpdateNetworkState(void)
+    {
+        u32 signal_strength = 0;
+        NifmInternetConnectionStatus connection_status = static_cast<NifmInternetConnectionStatus>(0);
+        NifmInternetConnectionType connection_type = static_cast<NifmInternetConnectionType>(0);
+        struct in_addr addr = { .s_addr = INADDR_NONE };
+
+        /* Query NIFM outside of any locks - these calls are the ones that can block while the network is flapping. */
+        Result rc = nifmGetInternetConnectionStatus(&connection_type, &signal_strength, &connection_status);
+        bool connected = (R_SUCCEEDED(rc) && connection_type && connection_status == NifmInternetConnectionStatus_Connected);
+        if (connected) nifmGetCurrentIpAddress(&(addr.s_addr));
+
+        /* Update cached network state. */
+        std::lock_guard<std::mutex> lock(this->network_mtx);
+
+        this->cached_connection_type = (R_SUCCEEDED(rc) ? connection_type : static_cast<NifmInternetConnectionType>(0));
+        this->cached_ip_addr_valid = (connected && addr.s_addr != INADDR_NONE);
+        if (this->cached_ip_addr_valid) snprintf(this->cached_ip_addr, sizeof(this->cached_ip_addr), "%s", inet_ntoa(addr));
+    }
+
     void StatusInfoTask::run(retro_time_t current_time)
     {
         brls::RepeatingTask::run(current_time);
@@ -60,24 +88,20 @@ namespace nxdt::tasks
         psmGetBatteryChargePercentage(&(status_info_data->charge_percentage));
         psmGetChargerType(&(status_info_data->charger_type));
 
-        /* Get network connection status. */
-        u32 signal_strength = 0;
-        NifmInternetConnectionStatus connection_status = static_cast<NifmInternetConnectionStatus>(0);
+        /* Kick off a network state query on the shared worker pool, unless one is already in flight. */
+        if (!this->network_query_active.exchange(true))
+        {
+            AsyncTaskPool::GetInstance().Submit(AsyncTaskPriority::Background, [this]() {
+                this->UpdateNetworkState();
+                this->network_query_active.store(false);
+            });
+        }
 
-        Result rc = nifmGetInternetConnectionStatus(&(status_info_data->connection_type), &signal_strength, &connection_status);
-        if (R_SUCCEEDED(rc))
+        /* Serve the last known network state. Stale by at most one query round trip, which is invisible next to the once-per-second status bar refresh. */
         {
-            if (status_info_data->connection_type && connection_status == NifmInternetConnectionStatus_Connected)
-            {
-                struct in_addr addr = { .s_addr = INADDR_NONE };
-                nifmGetCurrentIpAddress(&(addr.s_addr));
-                status_info_data->ip_addr = (addr.s_addr != INADDR_NONE ? inet_ntoa(addr) : NULL);
-            } else {
-                status_info_data->ip_addr = NULL;
-            }
-        } else {
-            status_info_data->connection_type = static_cast<NifmInternetConnectionType>(0);
-            status_info_data->ip_addr = NULL;
+            std::lock_guard<std::mutex> lock(this->network_mtx);
+            status_info_data->connection_type = this->cached_connection_type;
+            status_info_data->ip_addr = (this->cached_ip_addr_valid ? this->cached_ip_addr : NULL);
         }
 
         /* Fire task event. */
@@ -96,6 +120,15 @@ namespace nxdt::tasks
 
     GameCardTask::~GameCardTask(void)
     {
+        /* Wait for a pending pre-scan and free its results. */
+        if (this->prescan_future.valid())
+        {
+            GameCardPrescanVector entries = this->prescan_future.get();
+            GameCardTask::ClearPrescanVector(entries);
+        }
+
+        GameCardTask::ClearPrescanVector(this->prescan_entries);
+
         LOG_MSG_DEBUG("Gamecard task stopped.");
     }
 
@@ -103,6 +136,12 @@ namespace nxdt::tasks
     {
         brls::RepeatingTask::run(current_time);
 
+        /* Retrieve finished pre-scan results, if any. */
+        this->UpdatePrescanEntries();
+
+        /* Only proceed if the gamecard detection thread flagged a status change - avoids taking the gamecard mutex on every tick. */
+        if (!gamecardIsStatusUpdated()) return;
+
         this->cur_gc_status = static_cast<GameCardStatus>(gamecardGetStatus());
         if (this->cur_gc_status != this->prev_gc_status)
         {
@@ -126,6 +165,15 @@ namespace nxdt::tasks
                 this->first_notification = false;
             }
 
+            /* Kick off a metadata pre-scan as soon as gamecard info becomes fully loaded, and invalidate previous pre-scan results on any other status change. */
+            /* The pre-scan runs on the shared worker pool, so it overlaps with whatever the rest of the application is doing (e.g. draining the write tail from a previous dump). */
+            if (this->cur_gc_status == GameCardStatus_InsertedAndInfoLoaded)
+            {
+                this->StartPrescan();
+            } else {
+                GameCardTask::ClearPrescanVector(this->prescan_entries);
+            }
+
             /* Update previous gamecard status. */
             this->prev_gc_status = this->cur_gc_status;
 
@@ -134,6 +182,140 @@ namespace nxdt::tasks
         }
     }
 
+    const GameCardPrescanVector* GameCardTask::GetPrescanEntries(void)
+    {
+        /* Don't return anything while a pre-scan is still running - its results haven't been moved into the output vector yet. */
+        if (this->prescan_future.valid()) return nullptr;
+        return &(this->prescan_entries);
+    }
+
+    void GameCardTask::StartPrescan(void)
+    {
+        /* Invalidate any previous pre-scan results. */
+        GameCardTask::ClearPrescanVector(this->prescan_entries);
+
+        /* Wait for a still-pending pre-scan and free its results. This can only happen if gamecards get swapped faster than the task interval - stale scans fail fast on ejection. */
+        if (this->prescan_future.valid())
+        {
+            GameCardPrescanVector stale_entries = this->prescan_future.get();
+            GameCardTask::ClearPrescanVector(stale_entries);
+        }
+
+        u32 prescan_id = (++this->prescan_counter);
+
+        /* Submit the pre-scan to the shared worker pool. It only reads core library state, so it's safe to run it detached from the UI thread. */
+        this->prescan_future = AsyncTaskPool::GetInstance().Submit(AsyncTaskPriority::Background, [this, prescan_id]() {
+            LOG_MSG_DEBUG("Gamecard pre-scan #%u started.", prescan_id);
+            return this->PrescanGameCard();
+        });
+    }
+
+    GameCardPrescanVector GameCardTask::PrescanGameCard(void)
+    {
+        GameCardPrescanVector entries{};
+        std::vector<NcaContextBatchEntry> batch_entries{};
+
+        TitleApplicationMetadata **app_metadata = NULL;
+        u32 app_metadata_count = 0;
+
+        /* Retrieve metadata for all applications in the inserted gamecard. */
+        app_metadata = titleGetGameCardApplicationMetadataEntries(&app_metadata_count);
+        if (!app_metadata) return entries;
+
+        /* Duplicate title info and allocate NCA contexts for every application. */
+        for(u32 i = 0; i < app_metadata_count; i++)
+        {
+            GameCardPrescanEntry entry = {};
+
+            entry.title_info = titleGetInfoFromStorageByTitleId(NcmStorageId_GameCard, app_metadata[i]->title_id);
+            if (!entry.title_info || !entry.title_info->content_count)
+            {
+                if (entry.title_info) titleFreeTitleInfo(&(entry.title_info));
+                continue;
+            }
+
+            entry.nca_ctx = static_cast<NcaContext*>(calloc(entry.title_info->content_count, sizeof(NcaContext)));
+            if (!entry.nca_ctx)
+            {
+                LOG_MSG_ERROR("Failed to allocate NCA context array for %016lX!", entry.title_info->meta_key.id);
+                titleFreeTitleInfo(&(entry.title_info));
+                continue;
+            }
+
+            entries.push_back(entry);
+        }
+
+        /* Generate a single batch covering every content from every title, letting the batch initializer fan the work out across its own worker threads. */
+        for(auto& entry : entries)
+        {
+            for(u32 i = 0; i < entry.title_info->content_count; i++)
+            {
+                NcaContextBatchEntry batch_entry = {};
+
+                batch_entry.nca_ctx = &(entry.nca_ctx[i]);
+                batch_entry.storage_id = NcmStorageId_GameCard;
+                batch_entry.hfs_partition_type = GameCardHashFileSystemPartitionType_Secure;
+                batch_entry.content_info = &(entry.title_info->content_infos[i]);
+                batch_entry.title_version = entry.title_info->version.value;
+
+                batch_entries.push_back(batch_entry);
+            }
+        }
+
+        if (!batch_entries.empty()) ncaInitializeContextBatch(batch_entries.data(), static_cast<u32>(batch_entries.size()));
+
+        /* Update per-title validity. Individual failures (e.g. the gamecard got ejected mid-scan) don't invalidate the other titles. */
+        size_t batch_idx = 0;
+        for(auto& entry : entries)
+        {
+            entry.valid = true;
+            for(u32 i = 0; i < entry.title_info->content_count; i++) entry.valid &= batch_entries[batch_idx++].success;
+        }
+
+        /* Free application metadata array. */
+        free(app_metadata);
+
+        return entries;
+    }
+
+    void GameCardTask::UpdatePrescanEntries(void)
+    {
+        /* Only proceed if a pre-scan has finished since the last tick. */
+        if (!this->prescan_future.valid() || this->prescan_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+        GameCardPrescanVector entries = this->prescan_future.get();
+        this->prescan_future = {};
+
+        /* Discard the results if they belong to a gamecard that's no longer inserted. */
+        if (static_cast<GameCardStatus>(gamecardGetStatus()) != GameCardStatus_InsertedAndInfoLoaded)
+        {
+            GameCardTask::ClearPrescanVector(entries);
+            return;
+        }
+
+        LOG_MSG_DEBUG("Gamecard pre-scan #%u finished. Retrieved info for %lu %s.", this->prescan_counter, entries.size(), entries.size() == 1 ? "title" : "titles");
+
+        /* Move results into the output vector and fire task event. */
+        this->prescan_entries = std::move(entries);
+        this->gc_prescan_event.fire(&(this->prescan_entries));
+    }
+
+    void GameCardTask::ClearPrescanVector(GameCardPrescanVector& entries)
+    {
+        if (entries.empty()) return;
+
+        /* Drain queued main signature verifications - the RSA worker thread writes its results straight into the initialized NCA contexts. */
+        rsa2048WaitForQueuedPssVerifications();
+
+        for(auto& entry : entries)
+        {
+            if (entry.title_info) titleFreeTitleInfo(&(entry.title_info));
+            if (entry.nca_ctx) free(entry.nca_ctx);
+        }
+
+        entries.clear();
+    }
+
     /* Title task. */
 
     TitleTask::TitleTask(void) : brls::RepeatingTask(NXDT_TASK_INTERVAL)
@@ -173,6 +355,19 @@ namespace nxdt::tasks
             /* Fire task event. */
             this->title_event.fire(&(this->user_metadata));
         }
+
+        if (titleIsStorageInfoUpdated())
+        {
+            LOG_MSG_DEBUG("Title storage info updated.");
+
+            /* Update application metadata vectors. */
+            /* Both vectors are refreshed - the title storage load thread streams in system titles and ns record metadata alike. */
+            this->PopulateApplicationMetadataVector(true);
+            this->PopulateApplicationMetadataVector(false);
+
+            /* Fire task event. */
+            this->title_event.fire(&(this->user_metadata));
+        }
     }
 
     const TitleApplicationMetadataVector* TitleTask::GetApplicationMetadata(bool is_system)
@@ -231,8 +426,9 @@ namespace nxdt::tasks
             /* Update UMS device vector. */
             this->PopulateUmsDeviceVector();
 
-            /* Fire task event. */
+            /* Fire task events. */
             this->ums_event.fire(&(this->ums_devices));
+            this->ums_delta_event.fire(&(this->ums_delta));
         }
     }
 
@@ -246,6 +442,9 @@ namespace nxdt::tasks
         UsbHsFsDevice *ums_devices = NULL;
         u32 ums_device_count = 0;
 
+        /* Move the previous snapshot out of the way - it's needed to compute deltas once the new one is in place. */
+        UmsDeviceVector prev_devices = std::move(this->ums_devices);
+
         /* Clear UMS device vector. */
         this->ums_devices.clear();
 
@@ -260,7 +459,36 @@ namespace nxdt::tasks
             free(ums_devices);
         }
 
-        LOG_MSG_DEBUG("Retrieved info for %u UMS %s.", ums_device_count, ums_device_count == 1 ? "device" : "devices");
+        /* Compute add/remove deltas against the previous snapshot. */
+        this->ums_delta.added.clear();
+        this->ums_delta.removed.clear();
+
+        for(const UsbHsFsDevice& cur_device : this->ums_devices)
+        {
+            bool found = false;
+
+            for(const UsbHsFsDevice& prev_device : prev_devices)
+            {
+                if ((found = UmsDeviceMatch(prev_device, cur_device))) break;
+            }
+
+            if (!found) this->ums_delta.added.push_back(cur_device);
+        }
+
+        for(const UsbHsFsDevice& prev_device : prev_devices)
+        {
+            bool found = false;
+
+            for(const UsbHsFsDevice& cur_device : this->ums_devices)
+            {
+                if ((found = UmsDeviceMatch(prev_device, cur_device))) break;
+            }
+
+            if (!found) this->ums_delta.removed.push_back(prev_device);
+        }
+
+        LOG_MSG_DEBUG("Retrieved info for %u UMS %s (%zu added, %zu removed).", ums_device_count, ums_device_count == 1 ? "device" : "devices", this->ums_delta.added.size(), \
+                      this->ums_delta.removed.size());
     }
 
     /* USB host device connection task. */
@@ -280,6 +508,9 @@ namespace nxdt::tasks
     {
         brls::RepeatingTask::run(current_time);
 
+        /* Only proceed if the USB detection thread flagged a connection status change. */
+        if (!usbIsStatusUpdated()) return;
+
         this->cur_usb_host_speed = static_cast<UsbHostSpeed>(usbIsReady());
         if (this->cur_usb_host_speed != this->prev_usb_host_speed)
         {
@@ -293,4 +524,81 @@ namespace nxdt::tasks
             this->usb_host_event.fire(this->cur_usb_host_speed);
         }
     }
+
+    /* Idle maintenance task. */
+
+    IdleMaintenanceTask::IdleMaintenanceTask(void) : brls::RepeatingTask(NXDT_TASK_INTERVAL)
+    {
+        /* Initialize an independent pad state - borealis owns the one driving the UI, and reading it from here would race the render loop. */
+        padInitializeAny(&(this->pad_state));
+
+        /* Register the default maintenance jobs. */
+
+        /* No-Intro datfile index. One-shot: datfileInitialize() persists the generated lookup table as a binary cache on its own, and if no datfile is available there's nothing to build. */
+        this->jobs.push_back({ "datfile index", []() {
+            datfileInitialize();
+            return true;
+        }});
+
+        /* Ticket indexes. Re-queued on failure - an ES hiccup during one idle window shouldn't leave the indexes cold for the rest of the session. */
+        this->jobs.push_back({ "ticket indexes", []() {
+            return tikPrewarmTicketIndexes();
+        }});
+
+        brls::RepeatingTask::start();
+        LOG_MSG_DEBUG("Idle maintenance task started.");
+    }
+
+    IdleMaintenanceTask::~IdleMaintenanceTask(void)
+    {
+        /* Wait until any in-flight job finishes - the caches it may be writing must not be torn mid-update. */
+        if (this->job_future.valid()) this->job_future.wait();
+
+        /* Close the datfile interface in case its warm job got to run. */
+        datfileExit();
+
+        LOG_MSG_DEBUG("Idle maintenance task stopped.");
+    }
+
+    void IdleMaintenanceTask::run(retro_time_t current_time)
+    {
+        brls::RepeatingTask::run(current_time);
+
+        /* Track controller input. Analog sticks are deliberately ignored - a drifting stick would otherwise keep the console "busy" forever. */
+        /* The first run also lands here, so application startup counts as input and maintenance only begins after a full idle period. */
+        padUpdate(&(this->pad_state));
+        if (!this->last_input_time || padGetButtons(&(this->pad_state))) this->last_input_time = current_time;
+
+        /* Collect the result from a finished job, if any. */
+        if (this->job_active && this->job_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            bool job_done = this->job_future.get();
+            this->job_active = false;
+
+            if (job_done)
+            {
+                LOG_MSG_DEBUG("Maintenance job \"%s\" finished.", this->cur_job.name.c_str());
+            } else {
+                /* The job either made partial progress or couldn't run at all. Re-queue it and hold off further dispatches until the retry delay elapses. */
+                LOG_MSG_DEBUG("Maintenance job \"%s\" re-queued.", this->cur_job.name.c_str());
+                this->jobs.push_back(std::move(this->cur_job));
+                this->retry_time = (current_time + NXDT_IDLE_JOB_RETRY_DELAY);
+            }
+        }
+
+        /* Don't dispatch if a job is already in flight, there's nothing left to do, or a re-queued job is still waiting out its retry delay. */
+        if (this->job_active || this->jobs.empty() || current_time < this->retry_time) return;
+
+        /* Only run maintenance while the console is truly idle: no long-running process may be active, and no input may have been received for a while. */
+        if (utilsGetLongRunningProcessState() || (current_time - this->last_input_time) < NXDT_IDLE_INPUT_THRESHOLD) return;
+
+        /* Dispatch the next job to the shared worker pool at background priority, so even a mispredicted idle window can't stall UI-blocking work. */
+        this->cur_job = std::move(this->jobs.front());
+        this->jobs.pop_front();
+        this->job_active = true;
+
+        LOG_MSG_DEBUG("Dispatching maintenance job \"%s\".", this->cur_job.name.c_str());
+
+        this->job_future = AsyncTaskPool::GetInstance().Submit(AsyncTaskPriority::Background, [func = this->cur_job.func]() { return func(); });
+    }
 }
@@ -23,10 +23,30 @@
 #include <titles_tab.hpp>
 #include <scope_guard.hpp>
 
+#define THUMBNAIL_LOAD_INTERVAL     100 /* 100 ms. */
+#define THUMBNAIL_LOAD_BATCH_SIZE   10
+
 using namespace brls::i18n::literals;   /* For _i18n. */
 
 namespace nxdt::views
 {
+    /* ASCII-only lowercasing. Good enough for substring matching over title names - non-ASCII codepoints are matched verbatim. */
+    static std::string LowercaseString(const char *str)
+    {
+        std::string out{};
+
+        if (str)
+        {
+            for(size_t i = 0; str[i] != '\0'; i++)
+            {
+                char c = str[i];
+                out += ((c >= 'A' && c <= 'Z') ? static_cast<char>(c + 0x20) : c);
+            }
+        }
+
+        return out;
+    }
+
     TitlesTabPopup::TitlesTabPopup(const TitleApplicationMetadata *app_metadata, bool is_system) : brls::TabFrame(), app_metadata(app_metadata), is_system(is_system)
     {
         u64 title_id = this->app_metadata->title_id;
@@ -69,10 +89,8 @@ namespace nxdt::views
         /* Set sublabel. */
         if (!this->is_system) this->setSubLabel(std::string(app_metadata->lang_entry.author));
 
-        /* Set thumbnail (if needed). */
-        if (app_metadata->icon && app_metadata->icon_size) this->setThumbnail(app_metadata->icon, app_metadata->icon_size);
-
         /* Set value. */
+        /* The thumbnail isn't set here on purpose - it gets loaded at a later point by the thumbnail load task. */
         this->setValue(fmt::format("{:016X}", this->app_metadata->title_id), false, false);
     }
 
@@ -81,8 +99,53 @@ namespace nxdt::views
         if (this->click_anim) brls::View::playClickAnimation();
     }
 
+    void TitlesTabItem::LoadThumbnail(void)
+    {
+        if (this->thumbnail_loaded) return;
+
+        /* Set thumbnail (if needed). */
+        if (this->app_metadata->icon && this->app_metadata->icon_size) this->setThumbnail(this->app_metadata->icon, this->app_metadata->icon_size);
+
+        /* Update flag. */
+        this->thumbnail_loaded = true;
+    }
+
+    ThumbnailLoadTask::ThumbnailLoadTask(void) : brls::RepeatingTask(THUMBNAIL_LOAD_INTERVAL)
+    {
+        brls::RepeatingTask::start();
+        LOG_MSG_DEBUG("Thumbnail load task started.");
+    }
+
+    void ThumbnailLoadTask::run(retro_time_t current_time)
+    {
+        brls::RepeatingTask::run(current_time);
+
+        if (this->pending_items.empty()) return;
+
+        /* Load thumbnails for the next batch of list items. */
+        size_t batch_size = std::min(this->pending_items.size(), static_cast<size_t>(THUMBNAIL_LOAD_BATCH_SIZE));
+        for(size_t i = 0; i < batch_size; i++) this->pending_items[i]->LoadThumbnail();
+
+        /* Remove processed list items from the pending item vector. */
+        this->pending_items.erase(this->pending_items.begin(), this->pending_items.begin() + batch_size);
+    }
+
+    void ThumbnailLoadTask::SetPendingItems(const std::vector<TitlesTabItem*>& pending_items)
+    {
+        this->pending_items = pending_items;
+    }
+
     TitlesTab::TitlesTab(RootView *root_view, bool is_system) : LayeredErrorFrame("titles_tab/no_titles_available"_i18n), root_view(root_view), is_system(is_system)
     {
+        /* Start thumbnail load task. */
+        this->thumbnail_load_task = new ThumbnailLoadTask();
+
+        /* Register search action. */
+        this->registerAction("titles_tab/search_action"_i18n, brls::Key::Y, [this](void) {
+            this->ShowSearchKeyboard();
+            return true;
+        });
+
         /* Populate list. */
         this->PopulateList(this->root_view->GetApplicationMetadata(this->is_system));
 
@@ -98,21 +161,47 @@ namespace nxdt::views
 
     TitlesTab::~TitlesTab(void)
     {
+        /* Stop thumbnail load task. */
+        this->thumbnail_load_task->stop();
+
         /* Unregister task listener if this is the user titles tab. */
         if (!this->is_system) this->root_view->UnregisterTitleTaskListener(this->title_task_sub);
     }
 
     void TitlesTab::PopulateList(const nxdt::tasks::TitleApplicationMetadataVector* app_metadata)
+    {
+        /* Cache the current metadata set and rebuild the lowercase-name search index. */
+        this->cached_app_metadata.clear();
+        this->search_index.clear();
+
+        if (app_metadata)
+        {
+            this->cached_app_metadata = *app_metadata;
+            this->search_index.reserve(this->cached_app_metadata.size());
+            for(const TitleApplicationMetadata *cur_app_metadata : this->cached_app_metadata) this->search_index.push_back(LowercaseString(cur_app_metadata->lang_entry.name));
+        }
+
+        /* Render the list using the current search query. */
+        this->UpdateList();
+    }
+
+    void TitlesTab::UpdateList(void)
     {
         /* Populate variables. */
-        size_t app_metadata_count = (app_metadata ? app_metadata->size() : 0);
+        size_t app_metadata_count = this->cached_app_metadata.size();
         bool update_focused_view = this->IsListItemFocused();
         int focus_stack_index = this->GetFocusStackViewIndex();
 
         /* If needed, switch to the error frame *before* cleaning up our list. */
-        if (!app_metadata_count) this->SwitchLayerView(true);
+        if (!app_metadata_count)
+        {
+            this->error_frame->SetMessage("titles_tab/no_titles_available"_i18n);
+            this->SwitchLayerView(true);
+        }
 
         /* Clear list. */
+        /* The thumbnail load task must let go of its list item pointers first - clearing the list deletes them. */
+        this->thumbnail_load_task->SetPendingItems({});
         this->list->clear();
         this->list->invalidate(true);
 
@@ -120,8 +209,15 @@ namespace nxdt::views
         if (!app_metadata_count) return;
 
         /* Populate list. */
-        for(const TitleApplicationMetadata *cur_app_metadata : *app_metadata)
+        std::vector<TitlesTabItem*> items{};
+
+        for(size_t i = 0; i < app_metadata_count; i++)
         {
+            const TitleApplicationMetadata *cur_app_metadata = this->cached_app_metadata[i];
+
+            /* Skip entries that don't match the current search query. The index holds prebuilt lowercase names, so each check boils down to a plain substring scan. */
+            if (!this->search_query.empty() && this->search_index[i].find(this->search_query) == std::string::npos) continue;
+
             /* Create list item. */
             TitlesTabItem *title = new TitlesTabItem(cur_app_metadata, this->is_system);
 
@@ -158,8 +254,21 @@ namespace nxdt::views
 
             /* Add list item to our view. */
             this->list->addView(title);
+            items.push_back(title);
         }
 
+        /* Switch to the error frame if the search query filtered out every single title. */
+        if (items.empty())
+        {
+            this->error_frame->SetMessage("titles_tab/no_search_results"_i18n);
+            this->SwitchLayerView(true);
+            return;
+        }
+
+        /* Hand the new list items over to the thumbnail load task. */
+        /* Thumbnails are loaded in batches to keep the UI thread responsive - each item is displayed right away and its icon gets swapped in later. */
+        this->thumbnail_load_task->SetPendingItems(items);
+
         /* Update focus stack, if needed. */
         if (focus_stack_index > -1) this->UpdateFocusStackViewAtIndex(focus_stack_index, this->GetListFirstFocusableChild());
 
@@ -167,4 +276,39 @@ namespace nxdt::views
         this->list->invalidate(true);
         this->SwitchLayerView(false, update_focused_view, focus_stack_index < 0);
     }
+
+    void TitlesTab::ShowSearchKeyboard(void)
+    {
+        SwkbdConfig kbd = {0};
+        char query[0x41] = {0};
+
+        /* Create software keyboard. */
+        Result rc = swkbdCreate(&kbd, 0);
+        if (R_FAILED(rc))
+        {
+            LOG_MSG_ERROR("swkbdCreate failed! (0x%X).", rc);
+            return;
+        }
+
+        /* Configure software keyboard. */
+        swkbdConfigMakePresetDefault(&kbd);
+        swkbdConfigSetGuideText(&kbd, "titles_tab/search_keyboard_guide"_i18n.c_str());
+        swkbdConfigSetInitialText(&kbd, this->search_query.c_str());
+        swkbdConfigSetStringLenMax(&kbd, sizeof(query) - 1);
+
+        /* Display software keyboard. */
+        rc = swkbdShow(&kbd, query, sizeof(query));
+        swkbdClose(&kbd);
+
+        /* A failed result means the user backed out of the keyboard - keep the current query in that case. */
+        if (R_FAILED(rc)) return;
+
+        /* Lowercase the typed query - the search index is lowercase as well. */
+        std::string new_query = LowercaseString(query);
+
+        /* Re-render the list, but only if the query actually changed. */
+        if (new_query == this->search_query) return;
+        this->search_query = new_query;
+        this->UpdateList();
+    }
 }